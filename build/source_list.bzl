@@ -47,9 +47,12 @@ quiche_core_hdrs = [
     "common/quiche_circular_deque.h",
     "common/quiche_data_reader.h",
     "common/quiche_data_writer.h",
+    "common/quiche_dynamic_header_table.h",
     "common/quiche_endian.h",
     "common/quiche_linked_hash_map.h",
     "common/quiche_mem_slice_storage.h",
+    "common/quiche_mpsc_queue.h",
+    "common/quiche_slab_buffer_allocator.h",
     "common/quiche_text_utils.h",
     "common/simple_buffer_allocator.h",
     "common/structured_headers.h",
@@ -263,6 +266,7 @@ quiche_core_hdrs = [
     "quic/core/quic_ack_listener_interface.h",
     "quic/core/quic_alarm.h",
     "quic/core/quic_alarm_factory.h",
+    "quic/core/quic_alarm_multiplexer.h",
     "quic/core/quic_arena_scoped_ptr.h",
     "quic/core/quic_bandwidth.h",
     "quic/core/quic_blocked_writer_interface.h",
@@ -291,7 +295,9 @@ quiche_core_hdrs = [
     "quic/core/quic_error_codes.h",
     "quic/core/quic_flags_list.h",
     "quic/core/quic_flow_controller.h",
+    "quic/core/quic_frame_arena.h",
     "quic/core/quic_framer.h",
+    "quic/core/quic_handshake_admission_controller.h",
     "quic/core/quic_idle_network_detector.h",
     "quic/core/quic_interval.h",
     "quic/core/quic_interval_deque.h",
@@ -310,10 +316,12 @@ quiche_core_hdrs = [
     "quic/core/quic_ping_manager.h",
     "quic/core/quic_process_packet_interface.h",
     "quic/core/quic_protocol_flags_list.h",
+    "quic/core/quic_received_packet_buffer.h",
     "quic/core/quic_received_packet_manager.h",
     "quic/core/quic_sent_packet_manager.h",
     "quic/core/quic_server_id.h",
     "quic/core/quic_session.h",
+    "quic/core/quic_session_table.h",
     "quic/core/quic_socket_address_coder.h",
     "quic/core/quic_stream.h",
     "quic/core/quic_stream_frame_data_producer.h",
@@ -321,11 +329,14 @@ quiche_core_hdrs = [
     "quic/core/quic_stream_send_buffer.h",
     "quic/core/quic_stream_sequencer.h",
     "quic/core/quic_stream_sequencer_buffer.h",
+    "quic/core/quic_stream_sequencer_buffer_block_pool.h",
     "quic/core/quic_sustained_bandwidth_recorder.h",
     "quic/core/quic_tag.h",
     "quic/core/quic_time.h",
     "quic/core/quic_time_accumulator.h",
     "quic/core/quic_time_wait_list_manager.h",
+    "quic/core/quic_time_wait_store.h",
+    "quic/core/quic_timer_wheel.h",
     "quic/core/quic_trace_visitor.h",
     "quic/core/quic_transmission_info.h",
     "quic/core/quic_types.h",
@@ -401,7 +412,9 @@ quiche_core_srcs = [
     "common/quiche_buffer_allocator.cc",
     "common/quiche_data_reader.cc",
     "common/quiche_data_writer.cc",
+    "common/quiche_dynamic_header_table.cc",
     "common/quiche_mem_slice_storage.cc",
+    "common/quiche_slab_buffer_allocator.cc",
     "common/quiche_text_utils.cc",
     "common/simple_buffer_allocator.cc",
     "common/structured_headers.cc",
@@ -591,6 +604,7 @@ quiche_core_srcs = [
     "quic/core/qpack/value_splitting_header_list.cc",
     "quic/core/quic_ack_listener_interface.cc",
     "quic/core/quic_alarm.cc",
+    "quic/core/quic_alarm_multiplexer.cc",
     "quic/core/quic_bandwidth.cc",
     "quic/core/quic_buffered_packet_store.cc",
     "quic/core/quic_chaos_protector.cc",
@@ -616,7 +630,9 @@ quiche_core_srcs = [
     "quic/core/quic_dispatcher.cc",
     "quic/core/quic_error_codes.cc",
     "quic/core/quic_flow_controller.cc",
+    "quic/core/quic_frame_arena.cc",
     "quic/core/quic_framer.cc",
+    "quic/core/quic_handshake_admission_controller.cc",
     "quic/core/quic_idle_network_detector.cc",
     "quic/core/quic_legacy_version_encapsulator.cc",
     "quic/core/quic_mtu_discovery.cc",
@@ -627,20 +643,25 @@ quiche_core_srcs = [
     "quic/core/quic_packets.cc",
     "quic/core/quic_path_validator.cc",
     "quic/core/quic_ping_manager.cc",
+    "quic/core/quic_received_packet_buffer.cc",
     "quic/core/quic_received_packet_manager.cc",
     "quic/core/quic_sent_packet_manager.cc",
     "quic/core/quic_server_id.cc",
     "quic/core/quic_session.cc",
+    "quic/core/quic_session_table.cc",
     "quic/core/quic_socket_address_coder.cc",
     "quic/core/quic_stream.cc",
     "quic/core/quic_stream_id_manager.cc",
     "quic/core/quic_stream_send_buffer.cc",
     "quic/core/quic_stream_sequencer.cc",
     "quic/core/quic_stream_sequencer_buffer.cc",
+    "quic/core/quic_stream_sequencer_buffer_block_pool.cc",
     "quic/core/quic_sustained_bandwidth_recorder.cc",
     "quic/core/quic_tag.cc",
     "quic/core/quic_time.cc",
     "quic/core/quic_time_wait_list_manager.cc",
+    "quic/core/quic_time_wait_store.cc",
+    "quic/core/quic_timer_wheel.cc",
     "quic/core/quic_trace_visitor.cc",
     "quic/core/quic_transmission_info.cc",
     "quic/core/quic_types.cc",
@@ -773,6 +794,7 @@ quiche_test_support_hdrs = [
     "quic/test_tools/qpack/qpack_encoder_test_utils.h",
     "quic/test_tools/qpack/qpack_offline_decoder.h",
     "quic/test_tools/qpack/qpack_test_utils.h",
+    "quic/test_tools/quic_alarm_peer.h",
     "quic/test_tools/quic_buffered_packet_store_peer.h",
     "quic/test_tools/quic_client_promised_info_peer.h",
     "quic/test_tools/quic_client_session_cache_peer.h",
@@ -871,6 +893,7 @@ quiche_test_support_srcs = [
     "quic/test_tools/qpack/qpack_encoder_test_utils.cc",
     "quic/test_tools/qpack/qpack_offline_decoder.cc",
     "quic/test_tools/qpack/qpack_test_utils.cc",
+    "quic/test_tools/quic_alarm_peer.cc",
     "quic/test_tools/quic_buffered_packet_store_peer.cc",
     "quic/test_tools/quic_client_promised_info_peer.cc",
     "quic/test_tools/quic_coalesced_packet_peer.cc",
@@ -931,13 +954,18 @@ epoll_tool_support_hdrs = [
     "quic/core/batch_writer/quic_batch_writer_buffer.h",
     "quic/core/batch_writer/quic_batch_writer_test.h",
     "quic/core/batch_writer/quic_gso_batch_writer.h",
+    "quic/core/batch_writer/quic_io_uring_batch_writer.h",
     "quic/core/batch_writer/quic_sendmmsg_batch_writer.h",
     "quic/core/quic_default_packet_writer.h",
     "quic/core/quic_epoll_alarm_factory.h",
     "quic/core/quic_epoll_clock.h",
     "quic/core/quic_epoll_connection_helper.h",
+    "quic/core/quic_epoll_timer_wheel_alarm_factory.h",
+    "quic/core/quic_io_uring.h",
+    "quic/core/quic_io_uring_packet_reader.h",
     "quic/core/quic_linux_socket_utils.h",
     "quic/core/quic_packet_reader.h",
+    "quic/core/quic_reuseport_steering.h",
     "quic/core/quic_syscall_wrapper.h",
     "quic/core/quic_udp_socket.h",
     "quic/masque/masque_client_session.h",
@@ -954,20 +982,27 @@ epoll_tool_support_hdrs = [
     "quic/platform/api/quic_udp_socket_platform_api.h",
     "quic/tools/quic_client.h",
     "quic/tools/quic_client_epoll_network_helper.h",
+    "quic/tools/quic_multi_threaded_server.h",
     "quic/tools/quic_server.h",
+    "quic/tools/quic_thread_pool_proof_source.h",
 ]
 epoll_tool_support_srcs = [
     "epoll_server/simple_epoll_server.cc",
     "quic/core/batch_writer/quic_batch_writer_base.cc",
     "quic/core/batch_writer/quic_batch_writer_buffer.cc",
     "quic/core/batch_writer/quic_gso_batch_writer.cc",
+    "quic/core/batch_writer/quic_io_uring_batch_writer.cc",
     "quic/core/batch_writer/quic_sendmmsg_batch_writer.cc",
     "quic/core/quic_default_packet_writer.cc",
     "quic/core/quic_epoll_alarm_factory.cc",
     "quic/core/quic_epoll_clock.cc",
     "quic/core/quic_epoll_connection_helper.cc",
+    "quic/core/quic_epoll_timer_wheel_alarm_factory.cc",
+    "quic/core/quic_io_uring.cc",
+    "quic/core/quic_io_uring_packet_reader.cc",
     "quic/core/quic_linux_socket_utils.cc",
     "quic/core/quic_packet_reader.cc",
+    "quic/core/quic_reuseport_steering.cc",
     "quic/core/quic_syscall_wrapper.cc",
     "quic/core/quic_udp_socket_posix.cc",
     "quic/masque/masque_client_session.cc",
@@ -982,7 +1017,9 @@ epoll_tool_support_srcs = [
     "quic/masque/masque_utils.cc",
     "quic/tools/quic_client.cc",
     "quic/tools/quic_client_epoll_network_helper.cc",
+    "quic/tools/quic_multi_threaded_server.cc",
     "quic/tools/quic_server.cc",
+    "quic/tools/quic_thread_pool_proof_source.cc",
 ]
 epoll_test_support_hdrs = [
     "common/platform/api/quiche_epoll_test_tools.h",
@@ -1027,9 +1064,12 @@ quiche_tests_srcs = [
     "common/quiche_circular_deque_test.cc",
     "common/quiche_data_reader_test.cc",
     "common/quiche_data_writer_test.cc",
+    "common/quiche_dynamic_header_table_test.cc",
     "common/quiche_endian_test.cc",
     "common/quiche_linked_hash_map_test.cc",
     "common/quiche_mem_slice_storage_test.cc",
+    "common/quiche_mpsc_queue_test.cc",
+    "common/quiche_slab_buffer_allocator_test.cc",
     "common/quiche_text_utils_test.cc",
     "common/simple_buffer_allocator_test.cc",
     "common/structured_headers_generated_test.cc",
@@ -1170,6 +1210,7 @@ quiche_tests_srcs = [
     "quic/core/qpack/qpack_send_stream_test.cc",
     "quic/core/qpack/qpack_static_table_test.cc",
     "quic/core/qpack/value_splitting_header_list_test.cc",
+    "quic/core/quic_alarm_multiplexer_test.cc",
     "quic/core/quic_alarm_test.cc",
     "quic/core/quic_arena_scoped_ptr_test.cc",
     "quic/core/quic_bandwidth_test.cc",
@@ -1191,7 +1232,9 @@ quiche_tests_srcs = [
     "quic/core/quic_dispatcher_test.cc",
     "quic/core/quic_error_codes_test.cc",
     "quic/core/quic_flow_controller_test.cc",
+    "quic/core/quic_frame_arena_test.cc",
     "quic/core/quic_framer_test.cc",
+    "quic/core/quic_handshake_admission_controller_test.cc",
     "quic/core/quic_idle_network_detector_test.cc",
     "quic/core/quic_interval_deque_test.cc",
     "quic/core/quic_interval_set_test.cc",
@@ -1205,14 +1248,17 @@ quiche_tests_srcs = [
     "quic/core/quic_packets_test.cc",
     "quic/core/quic_path_validator_test.cc",
     "quic/core/quic_ping_manager_test.cc",
+    "quic/core/quic_received_packet_buffer_test.cc",
     "quic/core/quic_received_packet_manager_test.cc",
     "quic/core/quic_sent_packet_manager_test.cc",
     "quic/core/quic_server_id_test.cc",
     "quic/core/quic_session_test.cc",
+    "quic/core/quic_session_table_test.cc",
     "quic/core/quic_socket_address_coder_test.cc",
     "quic/core/quic_stream_id_manager_test.cc",
     "quic/core/quic_stream_send_buffer_test.cc",
     "quic/core/quic_stream_sequencer_buffer_test.cc",
+    "quic/core/quic_stream_sequencer_buffer_block_pool_test.cc",
     "quic/core/quic_stream_sequencer_test.cc",
     "quic/core/quic_stream_test.cc",
     "quic/core/quic_sustained_bandwidth_recorder_test.cc",
@@ -1220,6 +1266,8 @@ quiche_tests_srcs = [
     "quic/core/quic_time_accumulator_test.cc",
     "quic/core/quic_time_test.cc",
     "quic/core/quic_time_wait_list_manager_test.cc",
+    "quic/core/quic_time_wait_store_test.cc",
+    "quic/core/quic_timer_wheel_test.cc",
     "quic/core/quic_trace_visitor_test.cc",
     "quic/core/quic_unacked_packet_map_test.cc",
     "quic/core/quic_utils_test.cc",
@@ -1269,6 +1317,7 @@ epoll_tests_srcs = [
     "quic/core/batch_writer/quic_batch_writer_buffer_test.cc",
     "quic/core/batch_writer/quic_batch_writer_test.cc",
     "quic/core/batch_writer/quic_gso_batch_writer_test.cc",
+    "quic/core/batch_writer/quic_io_uring_batch_writer_test.cc",
     "quic/core/batch_writer/quic_sendmmsg_batch_writer_test.cc",
     "quic/core/chlo_extractor_test.cc",
     "quic/core/http/end_to_end_test.cc",
@@ -1278,13 +1327,41 @@ epoll_tests_srcs = [
     "quic/core/quic_epoll_alarm_factory_test.cc",
     "quic/core/quic_epoll_clock_test.cc",
     "quic/core/quic_epoll_connection_helper_test.cc",
+    "quic/core/quic_epoll_timer_wheel_alarm_factory_test.cc",
+    "quic/core/quic_io_uring_packet_reader_test.cc",
     "quic/core/quic_linux_socket_utils_test.cc",
+    "quic/core/quic_packet_reader_test.cc",
+    "quic/core/quic_reuseport_steering_test.cc",
     "quic/tools/quic_client_test.cc",
+    "quic/tools/quic_multi_threaded_server_test.cc",
     "quic/tools/quic_server_test.cc",
     "quic/tools/quic_simple_server_session_test.cc",
     "quic/tools/quic_simple_server_stream_test.cc",
+    "quic/tools/quic_thread_pool_proof_source_test.cc",
     "quic/tools/quic_url_test.cc",
 ]
+quiche_benchmarks_hdrs = [
+
+]
+quiche_benchmarks_srcs = [
+    "balsa/balsa_frame_benchmark.cc",
+    "http2/decoder/http2_frame_decoder_benchmark.cc",
+    "http2/hpack/huffman/hpack_huffman_benchmark.cc",
+    "quic/core/crypto/aead_benchmark.cc",
+    "quic/core/qpack/qpack_benchmark.cc",
+    "quic/core/quic_framer_benchmark.cc",
+    "quic/core/quic_packet_creator_benchmark.cc",
+    "quic/core/quic_stream_sequencer_buffer_benchmark.cc",
+    "quic/core/quic_unacked_packet_map_benchmark.cc",
+    "spdy/core/hpack/hpack_benchmark.cc",
+]
+epoll_benchmarks_hdrs = [
+
+]
+epoll_benchmarks_srcs = [
+    "quic/core/quic_epoll_alarm_factory_benchmark.cc",
+    "quic/tools/quic_loopback_benchmark.cc",
+]
 fuzzers_hdrs = [
 
 ]
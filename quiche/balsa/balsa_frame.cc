@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <limits>
@@ -49,6 +50,42 @@ constexpr absl::string_view kContentLength = "content-length";
 constexpr absl::string_view kIdentity = "identity";
 constexpr absl::string_view kTransferEncoding = "transfer-encoding";
 
+// Returns a pointer to the first '\n' in [begin, end), or end if there is none.
+// Header lines are too short for memchr() to make up for its call overhead, so
+// this checks eight bytes at a time inline instead.
+inline const char* FindNewline(const char* begin, const char* end) {
+  constexpr uint64_t kOnes = 0x0101010101010101;
+  constexpr uint64_t kHighBits = 0x8080808080808080;
+  while (end - begin >= static_cast<ptrdiff_t>(sizeof(uint64_t))) {
+    uint64_t word;
+    memcpy(&word, begin, sizeof(word));
+    word ^= kOnes * '\n';
+    // Nonzero if and only if some byte of the word is zero.
+    if (((word - kOnes) & ~word & kHighBits) != 0) {
+      break;
+    }
+    begin += sizeof(uint64_t);
+  }
+  while (begin < end && *begin != '\n') {
+    ++begin;
+  }
+  return begin;
+}
+
+constexpr std::array<bool, 256> BuildHeaderKeyDelimiterTable() {
+  std::array<bool, 256> table{};
+  for (const char c : header_properties::kInvalidHeaderKeyCharList) {
+    table[static_cast<uint8_t>(c)] = true;
+  }
+  table[static_cast<uint8_t>(':')] = true;
+  return table;
+}
+
+// True for ':' and for the characters which are invalid in a header field name,
+// which are the characters that end the scan of a header line for its colon.
+constexpr std::array<bool, 256> kHeaderKeyDelimiter =
+    BuildHeaderKeyDelimiterTable();
+
 }  // namespace
 
 void BalsaFrame::Reset() {
@@ -56,6 +93,7 @@ void BalsaFrame::Reset() {
   saw_non_newline_char_ = false;
   start_was_space_ = true;
   chunk_length_character_extracted_ = false;
+  chunk_extension_held_back_slash_r_ = false;
   // is_request_ = true;               // not reset between messages.
   allow_reading_until_close_for_request_ = false;
   // request_was_head_ = false;        // not reset between messages.
@@ -402,18 +440,15 @@ bool BalsaFrame::FindColonsAndParseIntoKeyValue(const Lines& lines,
       // line.
       current = line_begin;
     }
-    for (; current < line_end; ++current) {
-      if (*current == ':') {
-        break;
-      }
-
-      if (header_properties::IsInvalidHeaderKeyChar(*current)) {
-        // Generally invalid characters were found earlier.
-        HandleError(is_trailer
-                        ? BalsaFrameEnums::INVALID_TRAILER_NAME_CHARACTER
-                        : BalsaFrameEnums::INVALID_HEADER_NAME_CHARACTER);
-        return false;
-      }
+    while (current < line_end &&
+           !kHeaderKeyDelimiter[static_cast<uint8_t>(*current)]) {
+      ++current;
+    }
+    if (current < line_end && *current != ':') {
+      // Generally invalid characters were found earlier.
+      HandleError(is_trailer ? BalsaFrameEnums::INVALID_TRAILER_NAME_CHARACTER
+                             : BalsaFrameEnums::INVALID_HEADER_NAME_CHARACTER);
+      return false;
     }
 
     if (current == line_end) {
@@ -528,13 +563,15 @@ bool BalsaFrame::CheckHeaderLinesForInvalidChars(const Lines& lines,
       headers->OriginalHeaderStreamBegin() + lines.front().first;
   const char* stream_end =
       headers->OriginalHeaderStreamBegin() + lines.back().second;
+  absl::string_view stream(stream_begin, stream_end - stream_begin);
   bool found_invalid = false;
 
-  for (const char* c = stream_begin; c < stream_end; c++) {
-    if (header_properties::IsInvalidHeaderChar(*c)) {
-      found_invalid = true;
-      invalid_chars_[*c]++;
-    }
+  for (size_t pos = header_properties::FindInvalidHeaderChar(stream);
+       pos != absl::string_view::npos;
+       pos = header_properties::FindInvalidHeaderChar(stream)) {
+    found_invalid = true;
+    invalid_chars_[stream[pos]]++;
+    stream.remove_prefix(pos + 1);
   }
 
   return found_invalid;
@@ -762,9 +799,9 @@ size_t BalsaFrame::ProcessHeaders(const char* message_start,
       checkpoint = message_current;
     }
     while (message_current < message_end) {
-      if (*message_current != '\n') {
-        ++message_current;
-        continue;
+      message_current = FindNewline(message_current, message_end);
+      if (message_current == message_end) {
+        break;
       }
       const size_t relative_idx = message_current - message_start;
       const size_t message_current_idx = 1 + base_idx + relative_idx;
@@ -1082,35 +1119,36 @@ size_t BalsaFrame::ProcessInput(const char* input, size_t size) {
         continue;
 
       case BalsaFrameEnums::READING_CHUNK_EXTENSION: {
-        // TODO(phython): Convert this scanning to be 16 bytes at a time if
-        // there is data to be read.
+        // The extension is everything between the chunk length and the "\r\n"
+        // or "\n" ending the line. It may span several inputs, in which case
+        // each part of it is reported as it arrives, as a view into the input.
         const char* extensions_start = current;
-        size_t extensions_length = 0;
         QUICHE_DCHECK_LE(current, end);
-        while (true) {
-          if (current == end) {
-            visitor_->OnChunkExtensionInput(
-                absl::string_view(extensions_start, extensions_length));
-            visitor_->OnRawBodyInput(
-                absl::string_view(on_entry, current - on_entry));
-            return current - input;
-          }
-          const char c = *current;
-          if (c == '\r' || c == '\n') {
-            extensions_length = (extensions_start == current)
-                                    ? 0
-                                    : current - extensions_start - 1;
-          }
-
-          ++current;
-          if (c == '\n') {
-            break;
+        current = FindNewline(current, end);
+        if (chunk_extension_held_back_slash_r_) {
+          chunk_extension_held_back_slash_r_ = false;
+          if (current != extensions_start) {
+            // The '\r' ending the previous input did not end the line.
+            visitor_->OnChunkExtensionInput("\r");
           }
         }
+        const char* extensions_end = current;
+        if (extensions_end != extensions_start && extensions_end[-1] == '\r') {
+          --extensions_end;
+          chunk_extension_held_back_slash_r_ = (current == end);
+        }
+        visitor_->OnChunkExtensionInput(
+            absl::string_view(extensions_start,
+                              extensions_end - extensions_start));
+        if (current == end) {
+          visitor_->OnRawBodyInput(
+              absl::string_view(on_entry, current - on_entry));
+          return current - input;
+        }
+        // Skip the '\n'.
+        ++current;
 
         chunk_length_character_extracted_ = false;
-        visitor_->OnChunkExtensionInput(
-            absl::string_view(extensions_start, extensions_length));
 
         if (chunk_length_remaining_ != 0) {
           parse_state_ = BalsaFrameEnums::READING_CHUNK_DATA;
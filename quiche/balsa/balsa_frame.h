@@ -49,6 +49,7 @@ class QUICHE_EXPORT_PRIVATE BalsaFrame : public FramerInterface {
         saw_non_newline_char_(false),
         start_was_space_(true),
         chunk_length_character_extracted_(false),
+        chunk_extension_held_back_slash_r_(false),
         is_request_(true),
         allow_reading_until_close_for_request_(false),
         request_was_head_(false),
@@ -276,6 +277,9 @@ class QUICHE_EXPORT_PRIVATE BalsaFrame : public FramerInterface {
   bool saw_non_newline_char_;
   bool start_was_space_;
   bool chunk_length_character_extracted_;
+  // True if the previous input ended with a '\r' in a chunk extension. It was
+  // not reported, as it may be the start of the "\r\n" ending the extension.
+  bool chunk_extension_held_back_slash_r_;
   bool is_request_;  // This is not reset in Reset()
   // Generally, requests are not allowed to frame with connection: close.  For
   // protocols which do their own protocol-specific chunking, such as streamed
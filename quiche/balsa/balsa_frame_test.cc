@@ -1368,6 +1368,94 @@ TEST_F(HTTPBalsaFrameTest, FramerRecognizesSemicolonAsChunkSizeDelimiter) {
   EXPECT_FALSE(balsa_frame_.Error());
 }
 
+// Chunk extensions are reported in full, without their line terminator, however
+// the input is split.
+TEST_F(HTTPBalsaFrameTest, ChunkExtensionsSplitAcrossInputs) {
+  const std::string headers =
+      "GET / HTTP/1.1\r\n"
+      "transfer-encoding: chunked\r\n"
+      "\r\n";
+  const std::string chunks =
+      "3; foo=bar\r\n"
+      "abc\r\n"
+      "2;lf-only\n"
+      "de\r\n"
+      "1; cr\rinside\r\n"
+      "f\r\n"
+      "0\r\n"
+      "\r\n";
+  const std::vector<std::string> expected_extensions = {
+      "; foo=bar", ";lf-only", "; cr\rinside", ""};
+
+  for (size_t split = 1; split < chunks.size(); ++split) {
+    balsa_frame_.Reset();
+    ASSERT_EQ(headers.size(),
+              balsa_frame_.ProcessInput(headers.data(), headers.size()));
+    std::vector<std::string> extensions;
+    EXPECT_CALL(visitor_mock_, OnChunkLength(_))
+        .WillRepeatedly([&extensions](size_t /*chunk_length*/) {
+          extensions.emplace_back();
+        });
+    EXPECT_CALL(visitor_mock_, OnChunkExtensionInput(_))
+        .WillRepeatedly([&extensions](absl::string_view input) {
+          ASSERT_FALSE(extensions.empty());
+          absl::StrAppend(&extensions.back(), input);
+        });
+
+    EXPECT_EQ(split, balsa_frame_.ProcessInput(chunks.data(), split));
+    EXPECT_EQ(chunks.size() - split,
+              balsa_frame_.ProcessInput(chunks.data() + split,
+                                        chunks.size() - split));
+    EXPECT_TRUE(balsa_frame_.MessageFullyRead()) << "split " << split;
+    EXPECT_EQ(expected_extensions, extensions) << "split " << split;
+  }
+}
+
+// Body data is passed to the visitor as views into the input, for both chunked
+// and content-length framed bodies.
+TEST_F(HTTPBalsaFrameTest, BodyIsPassedAsViewsIntoInput) {
+  const std::vector<std::string> messages = {
+      "POST / HTTP/1.1\r\n"
+      "transfer-encoding: chunked\r\n"
+      "\r\n"
+      "5;ext=1\r\n"
+      "hello\r\n"
+      "6\r\n"
+      " world\r\n"
+      "0\r\n"
+      "\r\n",
+      "POST / HTTP/1.1\r\n"
+      "content-length: 11\r\n"
+      "\r\n"
+      "hello world",
+  };
+  for (const std::string& message : messages) {
+    balsa_frame_.Reset();
+    const char* const input_begin = message.data();
+    const char* const input_end = message.data() + message.size();
+    std::string body;
+    EXPECT_CALL(visitor_mock_, OnBodyChunkInput(_))
+        .WillRepeatedly([&](absl::string_view input) {
+          EXPECT_LE(input_begin, input.data());
+          EXPECT_GE(input_end, input.data() + input.size());
+          absl::StrAppend(&body, input);
+        });
+    EXPECT_CALL(visitor_mock_, OnChunkExtensionInput(_))
+        .WillRepeatedly([&](absl::string_view input) {
+          EXPECT_TRUE(input.empty() || (input_begin <= input.data() &&
+                                        input.data() < input_end));
+        });
+
+    size_t consumed = 0;
+    while (consumed < message.size() && !balsa_frame_.Error()) {
+      consumed += balsa_frame_.ProcessInput(message.data() + consumed,
+                                            message.size() - consumed);
+    }
+    EXPECT_TRUE(balsa_frame_.MessageFullyRead());
+    EXPECT_EQ("hello world", body);
+  }
+}
+
 TEST_F(HTTPBalsaFrameTest, NonAsciiCharacterInChunkLength) {
   std::string headers =
       "GET / HTTP/1.1\r\n"
@@ -3481,6 +3569,29 @@ TEST_F(HTTPBalsaFrameTest, InvalidCharsAreCounted) {
   EXPECT_EQ(balsa_frame_.get_invalid_chars(), empty_count);
 }
 
+// Invalid characters are counted wherever they fall relative to the words the
+// framer scans at a time.
+TEST_F(HTTPBalsaFrameTest, InvalidCharsAreCountedAtEveryOffset) {
+  balsa_frame_.set_invalid_chars_level(BalsaFrame::InvalidCharsLevel::kWarning);
+  for (size_t offset = 0; offset < 20; ++offset) {
+    std::string value(20, 'v');
+    value[offset] = '\x01';
+    const std::string message =
+        absl::StrCat("GET / HTTP/1.1\r\nHeader: ", value, "\x7f\r\n\r\n");
+
+    balsa_frame_.Reset();
+    EXPECT_CALL(visitor_mock_,
+                HandleWarning(BalsaFrameEnums::INVALID_HEADER_CHARACTER));
+    EXPECT_EQ(message.size(),
+              balsa_frame_.ProcessInput(message.data(), message.size()));
+    EXPECT_TRUE(balsa_frame_.MessageFullyRead());
+    absl::flat_hash_map<char, int> expected_count = {{'\x01', 1},
+                                                     {'\x7f', 1}};
+    EXPECT_EQ(balsa_frame_.get_invalid_chars(), expected_count)
+        << "offset " << offset;
+  }
+}
+
 // Test gibberish in headers and trailer. GFE does not crash but garbage in
 // garbage out.
 TEST_F(HTTPBalsaFrameTest, GibberishInHeadersAndTrailer) {
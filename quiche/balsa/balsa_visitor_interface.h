@@ -30,6 +30,8 @@ class QUICHE_EXPORT_PRIVATE BalsaVisitorInterface {
   //   part of the body. To be clear, every byte of the Balsa that isn't part of
   //   the header (or its framing), or trailers will be passed through this
   //   function.  This includes data as well as chunking framing.
+  //   The body is never copied: input points into the buffer passed to
+  //   BalsaFrame::ProcessInput(), and is only valid during that call.
   // Arguments:
   //   input - the raw input that is part of the body.
   virtual void OnRawBodyInput(absl::string_view input) = 0;
@@ -39,6 +41,8 @@ class QUICHE_EXPORT_PRIVATE BalsaVisitorInterface {
   //   body that would be stored by a program such as wget, i.e. the bytes
   //   indicating chunking will have been removed. Trailers will not be passed
   //   in through this function-- they'll be passed in through OnTrailerInput.
+  //   Like OnRawBodyInput, input points into the buffer passed to
+  //   BalsaFrame::ProcessInput(), whether the body is chunked or not.
   // Arguments:
   //   input - the part of the body.
   virtual void OnBodyChunkInput(absl::string_view input) = 0;
@@ -113,7 +117,10 @@ class QUICHE_EXPORT_PRIVATE BalsaVisitorInterface {
 
   // Summary:
   //   BalsaFrame passes the raw chunk extension data through this function.
-  //   The data is not cleaned up at all.
+  //   The data is not cleaned up at all, except that the "\r\n" or "\n" ending
+  //   the chunk length line is removed. If the extension spans several calls
+  //   to BalsaFrame::ProcessInput(), this is called with each part of it as
+  //   it arrives, and the extension is the concatenation of the parts.
   // Arguments:
   //   input - contains the bytes available for read.
   virtual void OnChunkExtensionInput(absl::string_view input) = 0;
@@ -1,6 +1,8 @@
 #include "quiche/balsa/header_properties.h"
 
 #include <array>
+#include <cstdint>
+#include <cstring>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
@@ -77,6 +79,41 @@ std::array<bool, 256> buildInvalidCharLookupTable() {
   return invalidCharTable;
 }
 
+constexpr uint64_t kOnes = 0x0101010101010101;
+constexpr uint64_t kLowBits = 0x7f7f7f7f7f7f7f7f;
+constexpr uint64_t kHighBits = ~kLowBits;
+
+// `low` must have the high bit of each byte clear. Returns a word with the high
+// bit of each byte set if that byte of `low` equals `c`, which must be below
+// 0x80.
+uint64_t BytesEqual(uint64_t low, uint8_t c) {
+  // Bytes of `x` are below 0x80, so adding 0x7f carries into the high bit of
+  // each nonzero byte, and never into the next byte.
+  const uint64_t x = low ^ (kOnes * c);
+  return ~(x + kLowBits) & kHighBits;
+}
+
+// `low` must have the high bit of each byte clear. Returns a word with the high
+// bit of each byte set if that byte of `low` is less than `c`, which must be in
+// [1, 0x80].
+uint64_t BytesLessThan(uint64_t low, uint8_t c) {
+  return ~(low + kOnes * (0x80 - c)) & kHighBits;
+}
+
+// Returns a word with the high bit of each byte of `word` that is invalid in a
+// header field set, and all other bits clear. This matches
+// kInvalidHeaderCharList: control characters other than \t, \n and \r, and
+// \x7f. Bytes of 0x80 and above are valid.
+uint64_t InvalidHeaderCharMask(uint64_t word) {
+  const uint64_t low = word & kLowBits;
+  const uint64_t allowed_controls = BytesEqual(low, '\t') |
+                                    BytesEqual(low, '\n') |
+                                    BytesEqual(low, '\r');
+  const uint64_t invalid = (BytesLessThan(low, 0x20) & ~allowed_controls) |
+                           BytesEqual(low, 0x7f);
+  return invalid & ~word;
+}
+
 }  // anonymous namespace
 
 bool IsMultivaluedHeader(absl::string_view header) {
@@ -100,12 +137,25 @@ bool IsInvalidHeaderChar(uint8_t c) {
 }
 
 bool HasInvalidHeaderChars(absl::string_view value) {
-  for (const char c : value) {
-    if (IsInvalidHeaderChar(c)) {
-      return true;
+  return FindInvalidHeaderChar(value) != absl::string_view::npos;
+}
+
+size_t FindInvalidHeaderChar(absl::string_view value) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= value.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, value.data() + i, sizeof(word));
+    if (InvalidHeaderCharMask(word) != 0) {
+      // Let the loop below find which byte it is.
+      break;
+    }
+  }
+  for (; i < value.size(); ++i) {
+    if (IsInvalidHeaderChar(value[i])) {
+      return i;
     }
   }
-  return false;
+  return absl::string_view::npos;
 }
 
 }  // namespace quiche::header_properties
@@ -5,6 +5,7 @@
 #ifndef QUICHE_BALSA_HEADER_PROPERTIES_H_
 #define QUICHE_BALSA_HEADER_PROPERTIES_H_
 
+#include <cstddef>
 #include <cstdint>
 
 #include "absl/strings/string_view.h"
@@ -45,6 +46,12 @@ QUICHE_EXPORT_PRIVATE bool IsInvalidHeaderKeyChar(uint8_t c);
 QUICHE_EXPORT_PRIVATE bool IsInvalidHeaderChar(uint8_t c);
 QUICHE_EXPORT_PRIVATE bool HasInvalidHeaderChars(absl::string_view value);
 
+// Returns the index of the first character of `value` that is invalid in a
+// header field, or absl::string_view::npos if there is none. Checks eight
+// characters at a time, so it is much faster than calling IsInvalidHeaderChar()
+// on each character of a long value.
+QUICHE_EXPORT_PRIVATE size_t FindInvalidHeaderChar(absl::string_view value);
+
 }  // namespace quiche::header_properties
 
 #endif  // QUICHE_BALSA_HEADER_PROPERTIES_H_
@@ -1,5 +1,8 @@
 #include "quiche/balsa/header_properties.h"
 
+#include <string>
+
+#include "absl/strings/string_view.h"
 #include "quiche/common/platform/api/quiche_test.h"
 
 namespace quiche::header_properties::test {
@@ -76,5 +79,23 @@ TEST(HeaderPropertiesTest, HasInvalidHeaderChars) {
   EXPECT_FALSE(HasInvalidHeaderChars("\x42 is a nice character"));
 }
 
+TEST(HeaderPropertiesTest, FindInvalidHeaderChar) {
+  EXPECT_EQ(absl::string_view::npos, FindInvalidHeaderChar(""));
+  EXPECT_EQ(absl::string_view::npos,
+            FindInvalidHeaderChar("text/html; charset=utf-8\r\n\t\x80\xff"));
+  EXPECT_EQ(3u, FindInvalidHeaderChar("abc\x7f\x01"));
+
+  // Place every character at every offset of a value spanning several words.
+  for (int c = 0; c < 256; ++c) {
+    for (size_t offset = 0; offset < 24; ++offset) {
+      std::string value(24, 'a');
+      value[offset] = static_cast<char>(c);
+      EXPECT_EQ(IsInvalidHeaderChar(c) ? offset : absl::string_view::npos,
+                FindInvalidHeaderChar(value))
+          << "character " << c << " at offset " << offset;
+    }
+  }
+}
+
 }  // namespace
 }  // namespace quiche::header_properties::test
@@ -0,0 +1,287 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/common/quiche_dynamic_header_table.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "quiche/common/platform/api/quiche_logging.h"
+
+namespace quiche {
+
+namespace {
+
+// Returns whether [a, a + a_length) and [b, b + b_length) overlap.
+bool Overlaps(const char* a, size_t a_length, const char* b, size_t b_length) {
+  std::less<const char*> less;
+  return a_length > 0 && b_length > 0 && less(a, b + b_length) &&
+         less(b, a + a_length);
+}
+
+}  // namespace
+
+void QuicheDynamicHeaderTable::Index::Reset(size_t max_entries) {
+  // Keep the load factor at or below one half.
+  size_t num_slots = 4;
+  while (num_slots < 2 * max_entries) {
+    num_slots *= 2;
+  }
+  slots_.assign(num_slots, IndexSlot());
+  mask_ = num_slots - 1;
+}
+
+template <typename Matches>
+void QuicheDynamicHeaderTable::Index::Upsert(size_t hash, uint64_t entry,
+                                             Matches matches) {
+  for (size_t i = hash & mask_;; i = (i + 1) & mask_) {
+    IndexSlot& slot = slots_[i];
+    if (slot.entry == IndexSlot::kEmpty) {
+      slot.entry = entry;
+      slot.hash = hash;
+      return;
+    }
+    if (slot.hash == hash && matches(slot.entry)) {
+      QUICHE_DCHECK_GT(entry, slot.entry);
+      slot.entry = entry;
+      return;
+    }
+  }
+}
+
+template <typename Matches>
+absl::optional<uint64_t> QuicheDynamicHeaderTable::Index::Find(
+    size_t hash, Matches matches) const {
+  for (size_t i = hash & mask_;; i = (i + 1) & mask_) {
+    const IndexSlot& slot = slots_[i];
+    if (slot.entry == IndexSlot::kEmpty) {
+      return absl::nullopt;
+    }
+    if (slot.hash == hash && matches(slot.entry)) {
+      return slot.entry;
+    }
+  }
+}
+
+void QuicheDynamicHeaderTable::Index::Erase(size_t hash, uint64_t entry) {
+  size_t i = hash & mask_;
+  while (slots_[i].entry != entry) {
+    if (slots_[i].entry == IndexSlot::kEmpty) {
+      // A newer entry with the same key took over the slot.
+      return;
+    }
+    i = (i + 1) & mask_;
+  }
+  // Move later slots of the cluster back into the hole unless that would put
+  // them before their home slot.
+  size_t hole = i;
+  for (size_t j = (i + 1) & mask_; slots_[j].entry != IndexSlot::kEmpty;
+       j = (j + 1) & mask_) {
+    const size_t home = slots_[j].hash & mask_;
+    if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+      slots_[hole] = slots_[j];
+      hole = j;
+    }
+  }
+  slots_[hole] = IndexSlot();
+}
+
+QuicheDynamicHeaderTable::QuicheDynamicHeaderTable()
+    : capacity_(0),
+      entries_size_(0),
+      arena_capacity_(0),
+      arena_size_(0),
+      begin_position_(0),
+      end_position_(0),
+      records_(1),
+      inserted_entry_count_(0),
+      evicted_entry_count_(0) {
+  name_value_index_.Reset(records_.size());
+  name_index_.Reset(records_.size());
+}
+
+QuicheDynamicHeaderTable::~QuicheDynamicHeaderTable() = default;
+
+void QuicheDynamicHeaderTable::SetCapacity(size_t capacity) {
+  QUICHE_DCHECK_LE(entries_size_, capacity);
+  capacity_ = capacity;
+}
+
+uint64_t QuicheDynamicHeaderTable::Insert(absl::string_view name,
+                                          absl::string_view value) {
+  const size_t entry_size = QuicheHeaderTableEntry::Size(name, value);
+  QUICHE_DCHECK_LE(entries_size_ + entry_size, capacity_);
+
+  // |name| and |value| may point into the current arena, so keep it until they
+  // are copied.
+  std::unique_ptr<char[]> old_arena;
+  if (entries_size_ + entry_size > arena_capacity_) {
+    old_arena = GrowArena(std::min(
+        capacity_, std::max(2 * arena_capacity_, entries_size_ + entry_size)));
+  }
+  if (size() == records_.size()) {
+    GrowRecords();
+  }
+
+  if (empty()) {
+    begin_position_ = end_position_ = 0;
+  }
+
+  // Keep the entry contiguous: if it does not fit before the end of the
+  // arena, start it at the beginning.
+  const size_t length = name.size() + value.size();
+  uint64_t position = end_position_;
+  const size_t offset = position % arena_size_;
+  if (offset + length > arena_size_) {
+    position += arena_size_ - offset;
+  }
+  // Since entries are at least kQuicheHeaderTableEntrySizeOverhead bytes larger
+  // than their name and value, twice the arena capacity is always enough.
+  QUICHE_DCHECK_LE(position + length - begin_position_, arena_size_);
+
+  char* const name_destination = arena_.get() + position % arena_size_;
+  char* const value_destination = name_destination + name.size();
+  // |name| and |value| may point to evicted entries, and therefore to the
+  // space being written to. Copy them in an order which does not overwrite
+  // either before it is copied.
+  if (!Overlaps(name_destination, name.size(), value.data(), value.size())) {
+    memmove(name_destination, name.data(), name.size());
+    memmove(value_destination, value.data(), value.size());
+  } else if (!Overlaps(value_destination, value.size(), name.data(),
+                       name.size())) {
+    memmove(value_destination, value.data(), value.size());
+    memmove(name_destination, name.data(), name.size());
+  } else {
+    scratch_.assign(name.data(), name.size());
+    scratch_.append(value.data(), value.size());
+    memcpy(name_destination, scratch_.data(), length);
+  }
+
+  const uint64_t index = inserted_entry_count_++;
+  GetRecord(index) = Record{position, name.size(), value.size()};
+  end_position_ = position + length;
+  entries_size_ += entry_size;
+  IndexEntry(index);
+  return index;
+}
+
+void QuicheDynamicHeaderTable::EvictOldest() {
+  QUICHE_DCHECK(!empty());
+
+  const uint64_t index = evicted_entry_count_;
+  const QuicheHeaderTableEntry entry = Get(index);
+  name_value_index_.Erase(HashNameAndValue(entry.name(), entry.value()),
+                          index);
+  name_index_.Erase(HashName(entry.name()), index);
+
+  entries_size_ -= entry.Size();
+  ++evicted_entry_count_;
+  begin_position_ =
+      empty() ? end_position_ : GetRecord(evicted_entry_count_).position;
+}
+
+QuicheHeaderTableEntry QuicheDynamicHeaderTable::Get(uint64_t index) const {
+  QUICHE_DCHECK_LE(evicted_entry_count_, index);
+  QUICHE_DCHECK_LT(index, inserted_entry_count_);
+  return GetEntry(GetRecord(index));
+}
+
+absl::optional<uint64_t> QuicheDynamicHeaderTable::FindNameAndValue(
+    absl::string_view name, absl::string_view value) const {
+  return name_value_index_.Find(
+      HashNameAndValue(name, value), [this, name, value](uint64_t index) {
+        const QuicheHeaderTableEntry entry = Get(index);
+        return entry.name() == name && entry.value() == value;
+      });
+}
+
+absl::optional<uint64_t> QuicheDynamicHeaderTable::FindName(
+    absl::string_view name) const {
+  return name_index_.Find(HashName(name), [this, name](uint64_t index) {
+    return Get(index).name() == name;
+  });
+}
+
+// static
+size_t QuicheDynamicHeaderTable::HashName(absl::string_view name) {
+  return absl::Hash<absl::string_view>()(name);
+}
+
+// static
+size_t QuicheDynamicHeaderTable::HashNameAndValue(absl::string_view name,
+                                                  absl::string_view value) {
+  return absl::Hash<std::pair<absl::string_view, absl::string_view>>()(
+      std::make_pair(name, value));
+}
+
+QuicheHeaderTableEntry QuicheDynamicHeaderTable::GetEntry(
+    const Record& record) const {
+  const char* const name = arena_.get() + record.position % arena_size_;
+  return QuicheHeaderTableEntry(
+      absl::string_view(name, record.name_length),
+      absl::string_view(name + record.name_length, record.value_length));
+}
+
+std::unique_ptr<char[]> QuicheDynamicHeaderTable::GrowArena(
+    size_t arena_capacity) {
+  QUICHE_DCHECK_GT(arena_capacity, arena_capacity_);
+  const size_t arena_size = 2 * arena_capacity;
+  auto arena = std::make_unique<char[]>(arena_size);
+
+  // Lay out the entries from the beginning of the new arena.
+  uint64_t position = 0;
+  for (uint64_t index = evicted_entry_count_; index < inserted_entry_count_;
+       ++index) {
+    Record& record = GetRecord(index);
+    const size_t length = record.name_length + record.value_length;
+    memcpy(arena.get() + position, arena_.get() + record.position % arena_size_,
+           length);
+    record.position = position;
+    position += length;
+  }
+  begin_position_ = 0;
+  end_position_ = position;
+
+  arena_capacity_ = arena_capacity;
+  arena_size_ = arena_size;
+  std::swap(arena_, arena);
+  return arena;
+}
+
+void QuicheDynamicHeaderTable::GrowRecords() {
+  std::vector<Record> records(2 * records_.size());
+  for (uint64_t index = evicted_entry_count_; index < inserted_entry_count_;
+       ++index) {
+    records[index % records.size()] = GetRecord(index);
+  }
+  records_ = std::move(records);
+
+  name_value_index_.Reset(records_.size());
+  name_index_.Reset(records_.size());
+  for (uint64_t index = evicted_entry_count_; index < inserted_entry_count_;
+       ++index) {
+    IndexEntry(index);
+  }
+}
+
+void QuicheDynamicHeaderTable::IndexEntry(uint64_t index) {
+  const QuicheHeaderTableEntry entry = Get(index);
+  name_value_index_.Upsert(
+      HashNameAndValue(entry.name(), entry.value()), index,
+      [this, &entry](uint64_t other) {
+        const QuicheHeaderTableEntry other_entry = Get(other);
+        return other_entry.name() == entry.name() &&
+               other_entry.value() == entry.value();
+      });
+  name_index_.Upsert(HashName(entry.name()), index,
+                     [this, &entry](uint64_t other) {
+                       return Get(other).name() == entry.name();
+                     });
+}
+
+}  // namespace quiche
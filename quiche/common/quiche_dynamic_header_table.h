@@ -0,0 +1,203 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_COMMON_QUICHE_DYNAMIC_HEADER_TABLE_H_
+#define QUICHE_COMMON_QUICHE_DYNAMIC_HEADER_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "quiche/common/platform/api/quiche_export.h"
+
+namespace quiche {
+
+// The constant amount added to the length of the name and the value to get the
+// size of a header table entry, as defined by RFC 7541 Section 4.1 and RFC 9204
+// Section 3.2.1.
+constexpr size_t kQuicheHeaderTableEntrySizeOverhead = 32;
+
+// A name and value stored in a QuicheDynamicHeaderTable. Does not own the
+// strings it points to.
+class QUICHE_EXPORT_PRIVATE QuicheHeaderTableEntry {
+ public:
+  QuicheHeaderTableEntry(absl::string_view name, absl::string_view value)
+      : name_(name), value_(value) {}
+
+  absl::string_view name() const { return name_; }
+  absl::string_view value() const { return value_; }
+
+  // Returns the size of an entry as defined by RFC 7541 Section 4.1.
+  static size_t Size(absl::string_view name, absl::string_view value) {
+    return name.size() + value.size() + kQuicheHeaderTableEntrySizeOverhead;
+  }
+  size_t Size() const { return Size(name_, value_); }
+
+ private:
+  absl::string_view name_;
+  absl::string_view value_;
+};
+
+// Storage for the dynamic table of HPACK (RFC 7541 Section 2.3.2) and QPACK
+// (RFC 9204 Section 3.2). Entries are inserted at one end and evicted from the
+// other, and are addressed by absolute index: the first entry ever inserted
+// has index zero.
+//
+// Names and values are copied into a single circular byte arena, and the
+// latest entry for each name and for each name and value pair is found through
+// open addressing indexes over the arena. The arena and the indexes grow
+// geometrically with the size of the entries, up to what the capacity
+// requires, so once the table has filled up, inserting, evicting and looking
+// up entries does not allocate.
+//
+// The caller is responsible for eviction: the total size of the entries in the
+// table must never exceed capacity().
+class QUICHE_EXPORT_PRIVATE QuicheDynamicHeaderTable {
+ public:
+  QuicheDynamicHeaderTable();
+  QuicheDynamicHeaderTable(const QuicheDynamicHeaderTable&) = delete;
+  QuicheDynamicHeaderTable& operator=(const QuicheDynamicHeaderTable&) =
+      delete;
+  ~QuicheDynamicHeaderTable();
+
+  // Sets the maximum total size of the entries, which must not be less than
+  // entries_size(). Does not allocate.
+  void SetCapacity(size_t capacity);
+
+  // Appends an entry and returns its absolute index. The total size of the
+  // entries, including the new one, must not exceed capacity(). |name| and
+  // |value| may point into the table, even to entries which have just been
+  // evicted.
+  uint64_t Insert(absl::string_view name, absl::string_view value);
+
+  // Evicts the oldest entry. The table must not be empty.
+  void EvictOldest();
+
+  // Returns the entry at absolute index |index|, which must be at least
+  // evicted_entry_count() and less than inserted_entry_count(). The returned
+  // name and value are valid until the entry is evicted or an insertion grows
+  // the arena, which only happens while entries_size() exceeds its previous
+  // maximum.
+  QuicheHeaderTableEntry Get(uint64_t index) const;
+  QuicheHeaderTableEntry oldest() const { return Get(evicted_entry_count_); }
+  QuicheHeaderTableEntry newest() const {
+    return Get(inserted_entry_count_ - 1);
+  }
+
+  // Return the absolute index of the most recently inserted entry matching
+  // |name| and |value|, or |name| only, if any.
+  absl::optional<uint64_t> FindNameAndValue(absl::string_view name,
+                                            absl::string_view value) const;
+  absl::optional<uint64_t> FindName(absl::string_view name) const;
+
+  // Number of entries in the table.
+  size_t size() const { return inserted_entry_count_ - evicted_entry_count_; }
+  bool empty() const { return size() == 0; }
+
+  // Sum of the sizes of the entries in the table.
+  size_t entries_size() const { return entries_size_; }
+
+  size_t capacity() const { return capacity_; }
+
+  // Number of entries inserted into and evicted from the table so far.
+  uint64_t inserted_entry_count() const { return inserted_entry_count_; }
+  uint64_t evicted_entry_count() const { return evicted_entry_count_; }
+
+ private:
+  struct QUICHE_EXPORT_PRIVATE Record {
+    // Position of the name in the arena, counted from the last time the arena
+    // grew. The value follows the name.
+    uint64_t position;
+    size_t name_length;
+    size_t value_length;
+  };
+
+  // Slot of an index, pointing to the entry with absolute index |entry|.
+  struct QUICHE_EXPORT_PRIVATE IndexSlot {
+    static constexpr uint64_t kEmpty = ~uint64_t{0};
+
+    uint64_t entry = kEmpty;
+    size_t hash = 0;
+  };
+
+  // Linear probing hash table. Deletion shifts back the following slots of
+  // the cluster, so there are no tombstones.
+  class QUICHE_EXPORT_PRIVATE Index {
+   public:
+    // Creates an index for up to |max_entries| entries.
+    void Reset(size_t max_entries);
+
+    // Points the slot for |hash| whose entry matches |matches| at |entry|, or
+    // adds a slot if there is none.
+    template <typename Matches>
+    void Upsert(size_t hash, uint64_t entry, Matches matches);
+
+    // Returns the entry of the slot for |hash| whose entry matches |matches|.
+    template <typename Matches>
+    absl::optional<uint64_t> Find(size_t hash, Matches matches) const;
+
+    // Removes the slot pointing at |entry|, if any.
+    void Erase(size_t hash, uint64_t entry);
+
+   private:
+    std::vector<IndexSlot> slots_;
+    size_t mask_ = 0;
+  };
+
+  static size_t HashName(absl::string_view name);
+  static size_t HashNameAndValue(absl::string_view name,
+                                 absl::string_view value);
+
+  const Record& GetRecord(uint64_t index) const {
+    return records_[index % records_.size()];
+  }
+  Record& GetRecord(uint64_t index) {
+    return records_[index % records_.size()];
+  }
+  QuicheHeaderTableEntry GetEntry(const Record& record) const;
+
+  // Moves the entries to an arena for entries with a total size of up to
+  // |arena_capacity|. Returns the previous arena.
+  std::unique_ptr<char[]> GrowArena(size_t arena_capacity);
+
+  // Doubles the number of records and rebuilds the indexes.
+  void GrowRecords();
+
+  // Adds entry |index| to both indexes.
+  void IndexEntry(uint64_t index);
+
+  size_t capacity_;
+  size_t entries_size_;
+
+  // Twice |arena_capacity_|, which leaves room for an entry which does not fit
+  // at the end of the arena and has to start at its beginning.
+  std::unique_ptr<char[]> arena_;
+  size_t arena_capacity_;
+  size_t arena_size_;
+  // Positions of the first byte of the oldest entry and one past the last byte
+  // of the newest entry.
+  uint64_t begin_position_;
+  uint64_t end_position_;
+
+  // Ring of records, at least as many as there are entries.
+  std::vector<Record> records_;
+  uint64_t inserted_entry_count_;
+  uint64_t evicted_entry_count_;
+
+  // Sized for |records_|.
+  Index name_value_index_;
+  Index name_index_;
+
+  // Holds a copy of the name and value being inserted while they point to the
+  // arena space they are being copied to.
+  std::string scratch_;
+};
+
+}  // namespace quiche
+
+#endif  // QUICHE_COMMON_QUICHE_DYNAMIC_HEADER_TABLE_H_
@@ -0,0 +1,213 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/common/quiche_dynamic_header_table.h"
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "quiche/common/platform/api/quiche_test.h"
+
+namespace quiche {
+namespace test {
+namespace {
+
+class QuicheDynamicHeaderTableTest : public QuicheTest {
+ protected:
+  // Evicts entries until an entry of |entry_size| fits.
+  void EvictFor(size_t entry_size) {
+    while (table_.entries_size() + entry_size > table_.capacity()) {
+      table_.EvictOldest();
+    }
+  }
+
+  void ExpectEntry(uint64_t index, absl::string_view name,
+                   absl::string_view value) {
+    QuicheHeaderTableEntry entry = table_.Get(index);
+    EXPECT_EQ(name, entry.name());
+    EXPECT_EQ(value, entry.value());
+  }
+
+  QuicheDynamicHeaderTable table_;
+};
+
+TEST_F(QuicheDynamicHeaderTableTest, Empty) {
+  EXPECT_TRUE(table_.empty());
+  EXPECT_EQ(0u, table_.size());
+  EXPECT_EQ(0u, table_.entries_size());
+  EXPECT_EQ(0u, table_.capacity());
+  EXPECT_EQ(0u, table_.inserted_entry_count());
+  EXPECT_EQ(0u, table_.evicted_entry_count());
+  EXPECT_FALSE(table_.FindName("foo").has_value());
+  EXPECT_FALSE(table_.FindNameAndValue("foo", "bar").has_value());
+}
+
+TEST_F(QuicheDynamicHeaderTableTest, InsertAndEvict) {
+  table_.SetCapacity(1024);
+
+  EXPECT_EQ(0u, table_.Insert("foo", "bar"));
+  EXPECT_EQ(1u, table_.Insert("baz", "qux"));
+  EXPECT_EQ(2u, table_.size());
+  EXPECT_EQ(2 * QuicheHeaderTableEntry::Size("foo", "bar"),
+            table_.entries_size());
+  ExpectEntry(0, "foo", "bar");
+  ExpectEntry(1, "baz", "qux");
+  EXPECT_EQ("foo", table_.oldest().name());
+  EXPECT_EQ("baz", table_.newest().name());
+
+  table_.EvictOldest();
+  EXPECT_EQ(1u, table_.size());
+  EXPECT_EQ(1u, table_.evicted_entry_count());
+  EXPECT_EQ(2u, table_.inserted_entry_count());
+  EXPECT_FALSE(table_.FindName("foo").has_value());
+  EXPECT_EQ(1u, table_.FindName("baz"));
+}
+
+TEST_F(QuicheDynamicHeaderTableTest, FindMostRecentEntry) {
+  table_.SetCapacity(1024);
+
+  table_.Insert("foo", "bar");
+  table_.Insert("foo", "baz");
+  table_.Insert("foo", "bar");
+
+  EXPECT_EQ(2u, table_.FindName("foo"));
+  EXPECT_EQ(2u, table_.FindNameAndValue("foo", "bar"));
+  EXPECT_EQ(1u, table_.FindNameAndValue("foo", "baz"));
+  EXPECT_FALSE(table_.FindNameAndValue("foo", "qux").has_value());
+
+  // Evicting an entry which has been superseded in an index leaves the newer
+  // entry in place.
+  table_.EvictOldest();
+  EXPECT_EQ(2u, table_.FindName("foo"));
+  EXPECT_EQ(2u, table_.FindNameAndValue("foo", "bar"));
+
+  table_.EvictOldest();
+  EXPECT_FALSE(table_.FindNameAndValue("foo", "baz").has_value());
+  EXPECT_EQ(2u, table_.FindName("foo"));
+}
+
+TEST_F(QuicheDynamicHeaderTableTest, EmptyNameAndValue) {
+  table_.SetCapacity(1024);
+
+  EXPECT_EQ(0u, table_.Insert("", ""));
+  EXPECT_EQ(kQuicheHeaderTableEntrySizeOverhead, table_.entries_size());
+  EXPECT_EQ(0u, table_.FindNameAndValue("", ""));
+  ExpectEntry(0, "", "");
+}
+
+// Entries are inserted into a full table while evicting the oldest one, so
+// that the arena wraps around many times.
+TEST_F(QuicheDynamicHeaderTableTest, WrapAround) {
+  const size_t entry_size = QuicheHeaderTableEntry::Size("name00", "value00");
+  table_.SetCapacity(3 * entry_size + 5);
+
+  for (int i = 0; i < 100; ++i) {
+    const std::string name = absl::StrCat("name", i % 10, i % 7);
+    const std::string value = absl::StrCat("value", i % 10, i % 7);
+    EvictFor(QuicheHeaderTableEntry::Size(name, value));
+    EXPECT_EQ(static_cast<uint64_t>(i), table_.Insert(name, value));
+    ExpectEntry(i, name, value);
+    EXPECT_EQ(static_cast<uint64_t>(i), table_.FindNameAndValue(name, value));
+  }
+  EXPECT_EQ(3u, table_.size());
+  ExpectEntry(97, "name76", "value76");
+  ExpectEntry(98, "name80", "value80");
+  ExpectEntry(99, "name91", "value91");
+}
+
+// Duplicating an entry which is about to be evicted, as both HPACK and QPACK
+// allow, copies it before its space is reused.
+TEST_F(QuicheDynamicHeaderTableTest, InsertEvictedEntry) {
+  table_.SetCapacity(QuicheHeaderTableEntry::Size("foo", "barbaz"));
+
+  table_.Insert("foo", "barbaz");
+  for (int i = 1; i < 10; ++i) {
+    QuicheHeaderTableEntry oldest = table_.oldest();
+    table_.EvictOldest();
+    EXPECT_EQ(static_cast<uint64_t>(i),
+              table_.Insert(oldest.name(), oldest.value()));
+    ExpectEntry(i, "foo", "barbaz");
+  }
+}
+
+// Inserting an entry which refers to an existing one grows the arena while
+// the existing entry is being read.
+TEST_F(QuicheDynamicHeaderTableTest, InsertExistingEntryWhileGrowing) {
+  table_.SetCapacity(64 * 1024);
+
+  table_.Insert("foo", "bar");
+  for (int i = 1; i < 100; ++i) {
+    QuicheHeaderTableEntry newest = table_.newest();
+    table_.Insert(newest.name(), absl::StrCat(newest.value(), "x"));
+    EXPECT_EQ(3u + i, table_.newest().value().size());
+  }
+  EXPECT_EQ(100u, table_.size());
+  ExpectEntry(0, "foo", "bar");
+  EXPECT_EQ(99u, table_.FindName("foo"));
+}
+
+// Compares the table against a simple model under random operations.
+TEST_F(QuicheDynamicHeaderTableTest, RandomOperations) {
+  std::mt19937 random(1);
+  size_t capacity = 200;
+  table_.SetCapacity(capacity);
+
+  std::deque<std::pair<std::string, std::string>> entries;
+  for (int i = 0; i < 5000; ++i) {
+    if (random() % 500 == 0) {
+      capacity += random() % 100;
+      table_.SetCapacity(capacity);
+    }
+
+    std::string name;
+    std::string value;
+    if (random() % 4 == 0 && !entries.empty()) {
+      const auto& entry = entries[random() % entries.size()];
+      name = entry.first;
+      value = entry.second;
+    } else {
+      name = std::string(random() % 6, 'a' + random() % 3);
+      value = std::string(random() % 20, 'x' + random() % 3);
+    }
+    const size_t entry_size = QuicheHeaderTableEntry::Size(name, value);
+    while (table_.entries_size() + entry_size > capacity) {
+      table_.EvictOldest();
+      entries.pop_front();
+    }
+    table_.Insert(name, value);
+    entries.emplace_back(name, value);
+
+    ASSERT_EQ(entries.size(), table_.size());
+    const uint64_t first = table_.evicted_entry_count();
+    for (size_t j = 0; j < entries.size(); ++j) {
+      ExpectEntry(first + j, entries[j].first, entries[j].second);
+    }
+
+    const std::string query_name(random() % 6, 'a' + random() % 3);
+    const std::string query_value(random() % 20, 'x' + random() % 3);
+    absl::optional<uint64_t> expected_name;
+    absl::optional<uint64_t> expected_name_and_value;
+    for (size_t j = 0; j < entries.size(); ++j) {
+      if (entries[j].first == query_name) {
+        expected_name = first + j;
+        if (entries[j].second == query_value) {
+          expected_name_and_value = first + j;
+        }
+      }
+    }
+    EXPECT_EQ(expected_name, table_.FindName(query_name));
+    EXPECT_EQ(expected_name_and_value,
+              table_.FindNameAndValue(query_name, query_value));
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quiche
@@ -0,0 +1,84 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_COMMON_QUICHE_MPSC_QUEUE_H_
+#define QUICHE_COMMON_QUICHE_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+#include "absl/types/optional.h"
+#include "quiche/common/platform/api/quiche_export.h"
+
+namespace quiche {
+
+// Unbounded lock-free queue with any number of producers and a single
+// consumer, after Dmitry Vyukov's intrusive MPSC node-based queue. Push() is
+// wait-free and may be called from any thread. Pop() and empty() must only be
+// called from the consumer thread.
+//
+// A Pop() which races with a Push() may not see the pushed element yet; the
+// producer is expected to notify the consumer after Push() returns.
+template <typename T>
+class QUICHE_NO_EXPORT QuicheMpscQueue {
+ public:
+  QuicheMpscQueue() : head_(&stub_), tail_(&stub_) {}
+  QuicheMpscQueue(const QuicheMpscQueue&) = delete;
+  QuicheMpscQueue& operator=(const QuicheMpscQueue&) = delete;
+
+  ~QuicheMpscQueue() {
+    while (Pop().has_value()) {
+    }
+    if (tail_ != &stub_) {
+      delete tail_;
+    }
+  }
+
+  void Push(T value) {
+    Node* node = new Node(std::move(value));
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    // Between the exchange and this store the queue is briefly disconnected,
+    // which is what makes a concurrent Pop() miss |node|.
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  absl::optional<T> Pop() {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return absl::nullopt;
+    }
+    // |next| becomes the new stub; its value is moved out and |tail| freed.
+    tail_ = next;
+    absl::optional<T> value = std::move(next->value);
+    next->value.reset();
+    if (tail != &stub_) {
+      delete tail;
+    }
+    return value;
+  }
+
+  bool empty() const {
+    return tail_->next.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  struct QUICHE_NO_EXPORT Node {
+    Node() : next(nullptr) {}
+    explicit Node(T value) : next(nullptr), value(std::move(value)) {}
+
+    std::atomic<Node*> next;
+    absl::optional<T> value;
+  };
+
+  // Written by producers.
+  std::atomic<Node*> head_;
+  // Only accessed by the consumer.
+  Node* tail_;
+  Node stub_;
+};
+
+}  // namespace quiche
+
+#endif  // QUICHE_COMMON_QUICHE_MPSC_QUEUE_H_
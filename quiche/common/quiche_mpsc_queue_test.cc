@@ -0,0 +1,95 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/common/quiche_mpsc_queue.h"
+
+#include <memory>
+#include <vector>
+
+#include "quiche/common/platform/api/quiche_test.h"
+#include "quiche/common/platform/api/quiche_thread.h"
+
+namespace quiche {
+namespace test {
+namespace {
+
+class QuicheMpscQueueTest : public QuicheTest {};
+
+TEST_F(QuicheMpscQueueTest, PushAndPop) {
+  QuicheMpscQueue<int> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.Pop().has_value());
+
+  queue.Push(1);
+  queue.Push(2);
+  EXPECT_FALSE(queue.empty());
+  EXPECT_EQ(1, queue.Pop().value());
+  queue.Push(3);
+  EXPECT_EQ(2, queue.Pop().value());
+  EXPECT_EQ(3, queue.Pop().value());
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.Pop().has_value());
+}
+
+TEST_F(QuicheMpscQueueTest, MoveOnlyElementsAreFreed) {
+  QuicheMpscQueue<std::unique_ptr<int>> queue;
+  queue.Push(std::make_unique<int>(1));
+  queue.Push(std::make_unique<int>(2));
+  EXPECT_EQ(1, *queue.Pop().value());
+  // The remaining element is freed by the destructor.
+}
+
+class Producer : public QuicheThread {
+ public:
+  Producer(QuicheMpscQueue<int>* queue, int first, int count)
+      : QuicheThread("Producer"), queue_(queue), first_(first), count_(count) {}
+
+  void Run() override {
+    for (int i = first_; i < first_ + count_; ++i) {
+      queue_->Push(i);
+    }
+  }
+
+ private:
+  QuicheMpscQueue<int>* queue_;
+  const int first_;
+  const int count_;
+};
+
+TEST_F(QuicheMpscQueueTest, ConcurrentProducers) {
+  constexpr int kNumProducers = 4;
+  constexpr int kPushesPerProducer = 10000;
+  QuicheMpscQueue<int> queue;
+  std::vector<std::unique_ptr<Producer>> producers;
+  for (int i = 0; i < kNumProducers; ++i) {
+    producers.push_back(std::make_unique<Producer>(
+        &queue, i * kPushesPerProducer, kPushesPerProducer));
+    producers.back()->Start();
+  }
+
+  // Elements of each producer come out in the order they were pushed.
+  std::vector<int> next(kNumProducers);
+  for (int i = 0; i < kNumProducers; ++i) {
+    next[i] = i * kPushesPerProducer;
+  }
+  int popped = 0;
+  while (popped < kNumProducers * kPushesPerProducer) {
+    absl::optional<int> value = queue.Pop();
+    if (!value.has_value()) {
+      continue;
+    }
+    int producer = *value / kPushesPerProducer;
+    ASSERT_EQ(next[producer], *value);
+    ++next[producer];
+    ++popped;
+  }
+  for (auto& producer : producers) {
+    producer->Join();
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quiche
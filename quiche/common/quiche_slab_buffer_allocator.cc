@@ -0,0 +1,194 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/common/quiche_slab_buffer_allocator.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "quiche/common/platform/api/quiche_logging.h"
+
+namespace quiche {
+
+namespace {
+
+// Each buffer is preceded by a header of this size, which keeps the buffer
+// itself aligned for any type.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+}  // namespace
+
+struct QuicheSlabBufferAllocator::Slab {
+  Slab(size_t size_class, size_t num_buffers, size_t buffer_size)
+      : size_class(size_class),
+        num_buffers(num_buffers),
+        buffer_size(buffer_size),
+        memory(new char[num_buffers * buffer_size]) {}
+
+  const size_t size_class;
+  const size_t num_buffers;
+  // The size of each buffer, including its header.
+  const size_t buffer_size;
+  // Only updated on the owning thread.
+  size_t buffers_in_use = 0;
+  std::unique_ptr<char[]> memory;
+};
+
+struct QuicheSlabBufferAllocator::BufferHeader {
+  // The slab the buffer was carved from, or nullptr for a large buffer.
+  Slab* slab;
+};
+
+// Overlays the contents of a buffer which is not in use.
+struct QuicheSlabBufferAllocator::FreeBuffer {
+  FreeBuffer* next;
+};
+
+QuicheSlabBufferAllocator::QuicheSlabBufferAllocator()
+    : remote_free_list_(nullptr) {
+  static_assert(sizeof(BufferHeader) <= kHeaderSize,
+                "Buffer header does not fit");
+}
+
+QuicheSlabBufferAllocator::~QuicheSlabBufferAllocator() = default;
+
+// static
+size_t QuicheSlabBufferAllocator::SizeClassIndex(size_t size) {
+  return std::lower_bound(kSizeClasses, kSizeClasses + kNumSizeClasses, size) -
+         kSizeClasses;
+}
+
+// static
+QuicheSlabBufferAllocator::BufferHeader* QuicheSlabBufferAllocator::HeaderOf(
+    void* buffer) {
+  return reinterpret_cast<BufferHeader*>(static_cast<char*>(buffer) -
+                                         kHeaderSize);
+}
+
+char* QuicheSlabBufferAllocator::New(size_t size) {
+  if (owner_thread_ == std::thread::id()) {
+    owner_thread_ = std::this_thread::get_id();
+  }
+  QUICHE_DCHECK(OnOwnerThread());
+  ++stats_.buffers_allocated;
+  const size_t size_class = SizeClassIndex(size);
+  if (size_class == kNumSizeClasses) {
+    ++stats_.large_buffers_allocated;
+    char* memory = new char[kHeaderSize + size];
+    reinterpret_cast<BufferHeader*>(memory)->slab = nullptr;
+    return memory + kHeaderSize;
+  }
+
+  SizeClass& sizes = size_classes_[size_class];
+  if (sizes.free_list == nullptr) {
+    DrainRemoteFrees();
+    if (sizes.free_list == nullptr) {
+      AllocateSlab(size_class);
+    }
+  }
+  FreeBuffer* buffer = sizes.free_list;
+  sizes.free_list = buffer->next;
+  ++HeaderOf(buffer)->slab->buffers_in_use;
+  return reinterpret_cast<char*>(buffer);
+}
+
+char* QuicheSlabBufferAllocator::New(size_t size, bool /*flag_enable*/) {
+  return New(size);
+}
+
+void QuicheSlabBufferAllocator::Delete(char* buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  BufferHeader* header = HeaderOf(buffer);
+  if (header->slab == nullptr) {
+    delete[] reinterpret_cast<char*>(header);
+    return;
+  }
+  FreeBuffer* free_buffer = reinterpret_cast<FreeBuffer*>(buffer);
+  if (OnOwnerThread()) {
+    Recycle(free_buffer);
+    return;
+  }
+  // Only the owning thread ever removes buffers, and it takes the whole list
+  // at once, so pushing is not subject to ABA.
+  FreeBuffer* head = remote_free_list_.load(std::memory_order_relaxed);
+  do {
+    free_buffer->next = head;
+  } while (!remote_free_list_.compare_exchange_weak(
+      head, free_buffer, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void QuicheSlabBufferAllocator::MarkAllocatorIdle() {
+  QUICHE_DCHECK(owner_thread_ == std::thread::id() || OnOwnerThread());
+  DrainRemoteFrees();
+  for (SizeClass& sizes : size_classes_) {
+    // Unlink the free buffers of unused slabs before releasing the slabs.
+    FreeBuffer** link = &sizes.free_list;
+    while (*link != nullptr) {
+      if (HeaderOf(*link)->slab->buffers_in_use == 0) {
+        *link = (*link)->next;
+      } else {
+        link = &(*link)->next;
+      }
+    }
+    auto unused = std::partition(sizes.slabs.begin(), sizes.slabs.end(),
+                                 [](const std::unique_ptr<Slab>& slab) {
+                                   return slab->buffers_in_use > 0;
+                                 });
+    for (auto it = unused; it != sizes.slabs.end(); ++it) {
+      slab_bytes_ -= (*it)->num_buffers * (*it)->buffer_size;
+      ++stats_.slabs_released;
+    }
+    sizes.slabs.erase(unused, sizes.slabs.end());
+  }
+}
+
+bool QuicheSlabBufferAllocator::OnOwnerThread() const {
+  return std::this_thread::get_id() == owner_thread_;
+}
+
+void QuicheSlabBufferAllocator::AllocateSlab(size_t size_class) {
+  const size_t buffer_size = kHeaderSize + kSizeClasses[size_class];
+  const size_t num_buffers =
+      std::max(kMinBuffersPerSlab, kSlabSize / buffer_size);
+  auto slab = std::make_unique<Slab>(size_class, num_buffers, buffer_size);
+  SizeClass& sizes = size_classes_[size_class];
+  // Push in reverse so that buffers are handed out in address order.
+  for (size_t i = num_buffers; i > 0; --i) {
+    char* memory = slab->memory.get() + (i - 1) * buffer_size;
+    reinterpret_cast<BufferHeader*>(memory)->slab = slab.get();
+    FreeBuffer* buffer = reinterpret_cast<FreeBuffer*>(memory + kHeaderSize);
+    buffer->next = sizes.free_list;
+    sizes.free_list = buffer;
+  }
+  slab_bytes_ += num_buffers * buffer_size;
+  ++stats_.slabs_allocated;
+  sizes.slabs.push_back(std::move(slab));
+}
+
+void QuicheSlabBufferAllocator::Recycle(FreeBuffer* buffer) {
+  Slab* slab = HeaderOf(buffer)->slab;
+  QUICHE_DCHECK_GT(slab->buffers_in_use, 0u);
+  --slab->buffers_in_use;
+  SizeClass& sizes = size_classes_[slab->size_class];
+  buffer->next = sizes.free_list;
+  sizes.free_list = buffer;
+}
+
+void QuicheSlabBufferAllocator::DrainRemoteFrees() {
+  FreeBuffer* buffer =
+      remote_free_list_.exchange(nullptr, std::memory_order_acquire);
+  while (buffer != nullptr) {
+    FreeBuffer* next = buffer->next;
+    ++stats_.remote_frees;
+    Recycle(buffer);
+    buffer = next;
+  }
+}
+
+}  // namespace quiche
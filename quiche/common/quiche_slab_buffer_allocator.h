@@ -0,0 +1,113 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_COMMON_QUICHE_SLAB_BUFFER_ALLOCATOR_H_
+#define QUICHE_COMMON_QUICHE_SLAB_BUFFER_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "quiche/common/platform/api/quiche_export.h"
+#include "quiche/common/quiche_buffer_allocator.h"
+
+namespace quiche {
+
+// A QuicheBufferAllocator which serves buffers from slabs carved into fixed
+// size classes, tuned to the buffers QUIC allocates most often: packets and
+// stream send buffer slices. Buffers larger than the largest size class are
+// allocated with new[].
+//
+// The allocator belongs to the thread it is first used on, which must make all
+// New() and MarkAllocatorIdle() calls. Delete() may be called on any thread:
+// buffers freed on the owning thread go straight back to their size class,
+// while buffers freed elsewhere are pushed onto a lock-free list which the
+// owning thread takes over once a size class runs empty. A server running one
+// dispatcher per thread gets per-thread size classes by giving each
+// dispatcher's connection helper its own allocator.
+//
+// All buffers must be deleted before the allocator is destroyed.
+class QUICHE_EXPORT_PRIVATE QuicheSlabBufferAllocator
+    : public QuicheBufferAllocator {
+ public:
+  // The buffer sizes served from slabs. 1536 bytes hold a full QUIC packet,
+  // and 4096 bytes the default maximum stream send buffer slice.
+  static constexpr size_t kSizeClasses[] = {64,   128,  256,  512,  1024,
+                                            1536, 2048, 4096, 8192, 16384};
+  static constexpr size_t kNumSizeClasses =
+      sizeof(kSizeClasses) / sizeof(kSizeClasses[0]);
+  // Slabs are allocated in chunks of this size, unless that would hold fewer
+  // than kMinBuffersPerSlab buffers.
+  static constexpr size_t kSlabSize = 64 * 1024;
+  static constexpr size_t kMinBuffersPerSlab = 4;
+
+  struct QUICHE_EXPORT_PRIVATE Stats {
+    // The number of buffers returned by New(), and how many of those were too
+    // large for any size class.
+    uint64_t buffers_allocated = 0;
+    uint64_t large_buffers_allocated = 0;
+    // The number of buffers deleted on a thread other than the owning thread.
+    // Only counted once the owning thread takes them over.
+    uint64_t remote_frees = 0;
+    uint64_t slabs_allocated = 0;
+    uint64_t slabs_released = 0;
+  };
+
+  QuicheSlabBufferAllocator();
+  QuicheSlabBufferAllocator(const QuicheSlabBufferAllocator&) = delete;
+  QuicheSlabBufferAllocator& operator=(const QuicheSlabBufferAllocator&) =
+      delete;
+  ~QuicheSlabBufferAllocator() override;
+
+  // QuicheBufferAllocator
+  char* New(size_t size) override;
+  char* New(size_t size, bool flag_enable) override;
+  void Delete(char* buffer) override;
+  // Releases all slabs none of whose buffers are in use.
+  void MarkAllocatorIdle() override;
+
+  const Stats& stats() const { return stats_; }
+
+  // The number of bytes held in slabs, whether or not their buffers are in
+  // use.
+  size_t slab_bytes() const { return slab_bytes_; }
+
+ private:
+  struct Slab;
+  struct BufferHeader;
+  struct FreeBuffer;
+
+  struct SizeClass {
+    FreeBuffer* free_list = nullptr;
+    std::vector<std::unique_ptr<Slab>> slabs;
+  };
+
+  // Returns the index of the smallest size class holding |size| bytes, or
+  // kNumSizeClasses if there is none.
+  static size_t SizeClassIndex(size_t size);
+  static BufferHeader* HeaderOf(void* buffer);
+
+  bool OnOwnerThread() const;
+  void AllocateSlab(size_t size_class);
+  // Returns a free buffer to the free list of its size class.
+  void Recycle(FreeBuffer* buffer);
+  // Takes over the buffers deleted on other threads.
+  void DrainRemoteFrees();
+
+  // Set by the first call to New().
+  std::thread::id owner_thread_;
+  SizeClass size_classes_[kNumSizeClasses];
+  // Buffers deleted on other threads, as a lock-free stack which the owning
+  // thread takes over in a single exchange.
+  std::atomic<FreeBuffer*> remote_free_list_;
+  size_t slab_bytes_ = 0;
+  Stats stats_;
+};
+
+}  // namespace quiche
+
+#endif  // QUICHE_COMMON_QUICHE_SLAB_BUFFER_ALLOCATOR_H_
@@ -0,0 +1,150 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/common/quiche_slab_buffer_allocator.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "quiche/common/platform/api/quiche_test.h"
+#include "quiche/common/platform/api/quiche_thread.h"
+
+namespace quiche {
+namespace test {
+namespace {
+
+class QuicheSlabBufferAllocatorTest : public QuicheTest {};
+
+TEST_F(QuicheSlabBufferAllocatorTest, NewDelete) {
+  QuicheSlabBufferAllocator allocator;
+  std::vector<char*> buffers;
+  for (size_t size : {1, 64, 65, 1452, 4096, 16384, 16385, 100000}) {
+    char* buffer = allocator.New(size);
+    ASSERT_NE(nullptr, buffer);
+    memset(buffer, 'a', size);
+    buffers.push_back(buffer);
+  }
+  EXPECT_EQ(8u, allocator.stats().buffers_allocated);
+  EXPECT_EQ(2u, allocator.stats().large_buffers_allocated);
+  for (char* buffer : buffers) {
+    allocator.Delete(buffer);
+  }
+}
+
+TEST_F(QuicheSlabBufferAllocatorTest, DeleteNull) {
+  QuicheSlabBufferAllocator allocator;
+  allocator.Delete(nullptr);
+}
+
+TEST_F(QuicheSlabBufferAllocatorTest, ReusesBuffersOfSameSizeClass) {
+  QuicheSlabBufferAllocator allocator;
+  char* buffer = allocator.New(1200);
+  allocator.Delete(buffer);
+  EXPECT_EQ(buffer, allocator.New(1452));
+  EXPECT_EQ(1u, allocator.stats().slabs_allocated);
+  EXPECT_LE(QuicheSlabBufferAllocator::kSlabSize - 1536,
+            allocator.slab_bytes());
+  allocator.Delete(buffer);
+}
+
+TEST_F(QuicheSlabBufferAllocatorTest, AllocatesSlabsAsNeeded) {
+  QuicheSlabBufferAllocator allocator;
+  std::vector<char*> buffers;
+  for (int i = 0; i < 10; ++i) {
+    buffers.push_back(allocator.New(16384));
+  }
+  // At least kMinBuffersPerSlab buffers are carved from each slab.
+  EXPECT_EQ(3u, allocator.stats().slabs_allocated);
+  for (char* buffer : buffers) {
+    allocator.Delete(buffer);
+  }
+}
+
+TEST_F(QuicheSlabBufferAllocatorTest, MarkAllocatorIdleReleasesUnusedSlabs) {
+  QuicheSlabBufferAllocator allocator;
+  char* in_use = allocator.New(100);
+  allocator.Delete(allocator.New(1000));
+  allocator.Delete(allocator.New(10000));
+  EXPECT_EQ(3u, allocator.stats().slabs_allocated);
+
+  allocator.MarkAllocatorIdle();
+  EXPECT_EQ(2u, allocator.stats().slabs_released);
+  EXPECT_GT(allocator.slab_bytes(), 0u);
+  EXPECT_LE(allocator.slab_bytes(), QuicheSlabBufferAllocator::kSlabSize);
+
+  // Released size classes allocate new slabs.
+  char* buffer = allocator.New(1000);
+  EXPECT_EQ(4u, allocator.stats().slabs_allocated);
+  allocator.Delete(buffer);
+
+  allocator.Delete(in_use);
+  allocator.MarkAllocatorIdle();
+  EXPECT_EQ(0u, allocator.slab_bytes());
+  EXPECT_EQ(4u, allocator.stats().slabs_released);
+}
+
+class Deleter : public QuicheThread {
+ public:
+  Deleter(QuicheSlabBufferAllocator* allocator, std::vector<char*> buffers)
+      : QuicheThread("Deleter"),
+        allocator_(allocator),
+        buffers_(std::move(buffers)) {}
+
+  void Run() override {
+    for (char* buffer : buffers_) {
+      allocator_->Delete(buffer);
+    }
+  }
+
+ private:
+  QuicheSlabBufferAllocator* allocator_;
+  std::vector<char*> buffers_;
+};
+
+TEST_F(QuicheSlabBufferAllocatorTest, RemoteFreesAreReclaimedWhenIdle) {
+  QuicheSlabBufferAllocator allocator;
+  std::vector<char*> buffers;
+  for (int i = 0; i < 50; ++i) {
+    buffers.push_back(allocator.New(1000));
+  }
+  Deleter deleter(&allocator, buffers);
+  deleter.Start();
+  deleter.Join();
+  EXPECT_EQ(0u, allocator.stats().remote_frees);
+
+  allocator.MarkAllocatorIdle();
+  EXPECT_EQ(50u, allocator.stats().remote_frees);
+  EXPECT_EQ(1u, allocator.stats().slabs_released);
+  EXPECT_EQ(0u, allocator.slab_bytes());
+}
+
+TEST_F(QuicheSlabBufferAllocatorTest, EmptySizeClassTakesOverRemoteFrees) {
+  QuicheSlabBufferAllocator allocator;
+  // Use up the first slab of the largest size class, which holds
+  // kMinBuffersPerSlab buffers.
+  std::vector<char*> buffers;
+  for (size_t i = 0; i < QuicheSlabBufferAllocator::kMinBuffersPerSlab; ++i) {
+    buffers.push_back(allocator.New(16384));
+  }
+  ASSERT_EQ(1u, allocator.stats().slabs_allocated);
+
+  Deleter deleter(&allocator, {buffers.back()});
+  deleter.Start();
+  deleter.Join();
+  buffers.pop_back();
+
+  // The buffer deleted on the other thread is reused instead of a new slab
+  // being allocated.
+  buffers.push_back(allocator.New(16384));
+  EXPECT_EQ(1u, allocator.stats().remote_frees);
+  EXPECT_EQ(1u, allocator.stats().slabs_allocated);
+  for (char* buffer : buffers) {
+    allocator.Delete(buffer);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quiche
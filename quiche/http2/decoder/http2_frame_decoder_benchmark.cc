@@ -0,0 +1,73 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures Http2FrameDecoder splitting a connection's input into frames: a
+// HEADERS frame followed by DATA frames, interleaved with WINDOW_UPDATEs. The
+// listener discards everything, so HPACK decoding is not included; see
+// spdy/core/hpack/hpack_benchmark.cc for that.
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "quiche/http2/decoder/decode_buffer.h"
+#include "quiche/http2/decoder/decode_status.h"
+#include "quiche/http2/decoder/http2_frame_decoder.h"
+#include "quiche/http2/decoder/http2_frame_decoder_listener.h"
+#include "quiche/http2/http2_constants.h"
+#include "quiche/http2/http2_structures.h"
+#include "quiche/http2/test_tools/http2_frame_builder.h"
+
+namespace http2 {
+namespace {
+
+using test::Http2FrameBuilder;
+
+constexpr uint32_t kStreamId = 1;
+
+std::string Frames(size_t data_frame_size, int num_data_frames) {
+  // :method GET, :scheme https, :path / from the static table, and a literal
+  // :authority with an indexed name.
+  Http2FrameBuilder headers(Http2FrameType::HEADERS,
+                            Http2FrameFlag::END_HEADERS, kStreamId);
+  headers.Append("\x82\x87\x84\x41\x0fwww.example.com");
+  headers.SetPayloadLength();
+  std::string frames = headers.buffer();
+
+  for (int i = 0; i < num_data_frames; ++i) {
+    Http2FrameBuilder data(Http2FrameType::DATA, 0, kStreamId);
+    data.Append(std::string(data_frame_size, 'a'));
+    data.SetPayloadLength();
+    frames += data.buffer();
+
+    Http2FrameBuilder window_update(Http2FrameType::WINDOW_UPDATE, 0,
+                                    /*stream_id=*/0);
+    window_update.Append(Http2WindowUpdateFields{
+        static_cast<uint32_t>(data_frame_size)});
+    window_update.SetPayloadLength();
+    frames += window_update.buffer();
+  }
+  return frames;
+}
+
+void BM_DecodeFrames(benchmark::State& state) {
+  const std::string frames = Frames(state.range(0), /*num_data_frames=*/10);
+  Http2FrameDecoderNoOpListener listener;
+  Http2FrameDecoder decoder(&listener);
+  for (auto _ : state) {
+    DecodeBuffer db(frames.data(), frames.size());
+    while (db.HasData()) {
+      if (decoder.DecodeFrame(&db) != DecodeStatus::kDecodeDone) {
+        state.SkipWithError("Failed to decode frames");
+        return;
+      }
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * frames.size());
+}
+BENCHMARK(BM_DecodeFrames)->Arg(100)->Arg(16000);
+
+}  // namespace
+}  // namespace http2
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures HPACK Huffman encoding and decoding of typical header values, for
+// both the multi-symbol decoder and the symbol by symbol reference decoder,
+// and for both encoders.
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "quiche/http2/hpack/huffman/hpack_huffman_decoder.h"
+#include "quiche/http2/hpack/huffman/hpack_huffman_encoder.h"
+
+namespace http2 {
+namespace {
+
+// Header values of the kinds that are Huffman encoded in practice.
+constexpr absl::string_view kUserAgent =
+    "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/103.0.0.0 Safari/537.36";
+constexpr absl::string_view kCookie =
+    "SID=31d4d96e407aad42; lang=en-US; _ga=GA1.2.1234567890.1234567890; "
+    "session_token=QWxhZGRpbjpvcGVuIHNlc2FtZQ%3D%3D";
+constexpr absl::string_view kPath =
+    "/search?q=hpack+huffman&source=hp&ei=Yk3rYqPZIsmC9u8P7qqrgAE&oq=hpack";
+
+std::string Plain(int which) {
+  switch (which) {
+    case 0:
+      return std::string(kUserAgent);
+    case 1:
+      return std::string(kCookie);
+    default:
+      return std::string(kPath);
+  }
+}
+
+std::string Encoded(int which) {
+  const std::string plain = Plain(which);
+  std::string encoded;
+  HuffmanEncode(plain, HuffmanSize(plain), &encoded);
+  return encoded;
+}
+
+void BM_HuffmanSize(benchmark::State& state) {
+  const std::string plain = Plain(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HuffmanSize(plain));
+  }
+  state.SetBytesProcessed(state.iterations() * plain.size());
+}
+BENCHMARK(BM_HuffmanSize)->DenseRange(0, 2);
+
+void BM_HuffmanEncode(benchmark::State& state) {
+  const std::string plain = Plain(state.range(0));
+  const size_t encoded_size = HuffmanSize(plain);
+  std::string encoded;
+  for (auto _ : state) {
+    encoded.clear();
+    HuffmanEncode(plain, encoded_size, &encoded);
+    benchmark::DoNotOptimize(encoded.data());
+  }
+  state.SetBytesProcessed(state.iterations() * plain.size());
+}
+BENCHMARK(BM_HuffmanEncode)->DenseRange(0, 2);
+
+void BM_HuffmanEncodeFast(benchmark::State& state) {
+  const std::string plain = Plain(state.range(0));
+  const size_t encoded_size = HuffmanSize(plain);
+  std::string encoded;
+  for (auto _ : state) {
+    encoded.clear();
+    HuffmanEncodeFast(plain, encoded_size, &encoded);
+    benchmark::DoNotOptimize(encoded.data());
+  }
+  state.SetBytesProcessed(state.iterations() * plain.size());
+}
+BENCHMARK(BM_HuffmanEncodeFast)->DenseRange(0, 2);
+
+void BM_HuffmanDecode(benchmark::State& state) {
+  const std::string encoded = Encoded(state.range(0));
+  HpackHuffmanDecoder decoder;
+  std::string decoded;
+  for (auto _ : state) {
+    decoder.Reset();
+    decoded.clear();
+    if (!decoder.Decode(encoded, &decoded) ||
+        !decoder.InputProperlyTerminated()) {
+      state.SkipWithError("Failed to decode");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_HuffmanDecode)->DenseRange(0, 2);
+
+void BM_HuffmanDecodeSymbolBySymbol(benchmark::State& state) {
+  const std::string encoded = Encoded(state.range(0));
+  HpackHuffmanDecoder decoder;
+  std::string decoded;
+  for (auto _ : state) {
+    decoder.Reset();
+    decoded.clear();
+    if (!decoder.DecodeSymbolBySymbol(encoded, &decoded) ||
+        !decoder.InputProperlyTerminated()) {
+      state.SkipWithError("Failed to decode");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_HuffmanDecodeSymbolBySymbol)->DenseRange(0, 2);
+
+}  // namespace
+}  // namespace http2
+
+BENCHMARK_MAIN();
@@ -4,6 +4,7 @@
 
 #include "quiche/http2/hpack/huffman/hpack_huffman_decoder.h"
 
+#include <array>
 #include <bitset>
 #include <limits>
 
@@ -343,6 +344,55 @@ struct ShortCodeInfo {
     {0x7a, 7},  // Match: 0b1111011, Symbol: z
 };
 
+// Number of leading bits of the bit buffer used to index the multi-symbol
+// table. Since the shortest code is 5 bits long, up to two symbols can be
+// decoded with each lookup.
+constexpr HuffmanAccumulatorBitCount kMultiSymbolLookupBitCount = 12;
+constexpr size_t kMultiSymbolTableSize = 1 << kMultiSymbolLookupBitCount;
+constexpr size_t kMaxSymbolsPerLookup =
+    kMultiSymbolLookupBitCount / kMinCodeBitCount;
+
+// The symbols whose codes make up the leading bits of a lookup index, and the
+// total length of those codes. |symbol_count| is zero if the first code is
+// longer than kMultiSymbolLookupBitCount bits.
+struct MultiSymbolInfo {
+  uint8_t symbols[kMaxSymbolsPerLookup];
+  uint8_t symbol_count;
+  uint8_t length;
+};
+
+using MultiSymbolTable = std::array<MultiSymbolInfo, kMultiSymbolTableSize>;
+
+MultiSymbolTable* BuildMultiSymbolTable() {
+  auto* table = new MultiSymbolTable();
+  for (size_t index = 0; index < kMultiSymbolTableSize; ++index) {
+    MultiSymbolInfo& info = (*table)[index];
+    info.symbol_count = 0;
+    info.length = 0;
+    while (info.symbol_count < kMaxSymbolsPerLookup) {
+      // The bits of |index| that are not yet decoded, left justified. Bits past
+      // the end of |index| are zero, so a code is only taken if it fits.
+      const HuffmanCode bits =
+          static_cast<HuffmanCode>((index << info.length) &
+                                   (kMultiSymbolTableSize - 1))
+          << (kHuffmanCodeBitCount - kMultiSymbolLookupBitCount);
+      const PrefixInfo prefix_info = PrefixToInfo(bits);
+      if (info.length + prefix_info.code_length > kMultiSymbolLookupBitCount) {
+        break;
+      }
+      info.symbols[info.symbol_count++] =
+          kCanonicalToSymbol[prefix_info.DecodeToCanonical(bits)];
+      info.length += prefix_info.code_length;
+    }
+  }
+  return table;
+}
+
+const MultiSymbolTable& GetMultiSymbolTable() {
+  static const MultiSymbolTable* const table = BuildMultiSymbolTable();
+  return *table;
+}
+
 }  // namespace
 
 HuffmanBitBuffer::HuffmanBitBuffer() { Reset(); }
@@ -412,6 +462,82 @@ HpackHuffmanDecoder::~HpackHuffmanDecoder() = default;
 
 bool HpackHuffmanDecoder::Decode(absl::string_view input, std::string* output) {
   QUICHE_DVLOG(1) << "HpackHuffmanDecoder::Decode";
+  const MultiSymbolTable& table = GetMultiSymbolTable();
+
+  // Every code is at least kMinCodeBitCount bits long, which bounds the number
+  // of symbols decoded. Write them directly into |*output|, with room for the
+  // unused second symbol of the last lookup, and trim it before returning.
+  const size_t original_size = output->size();
+  output->resize(original_size +
+                 (bit_buffer_.count() + 8 * input.size()) / kMinCodeBitCount +
+                 kMaxSymbolsPerLookup);
+  char* const first = &*output->begin();
+  char* out = first + original_size;
+
+  // Work on a local copy of |bit_buffer_|, so that the compiler can keep it in
+  // registers even though |out| might alias it.
+  HuffmanBitBuffer bit_buffer = bit_buffer_;
+
+  // Fill bit_buffer from input.
+  input.remove_prefix(bit_buffer.AppendBytes(input));
+
+  while (true) {
+    if (bit_buffer.count() < kMultiSymbolLookupBitCount) {
+      size_t byte_count = bit_buffer.AppendBytes(input);
+      if (byte_count == 0) {
+        // The input is drained. Decode whatever whole symbols are left.
+        QUICHE_DCHECK_EQ(input.size(), 0u);
+        bit_buffer_ = bit_buffer;
+        output->resize(out - first);
+        return DecodeSymbolBySymbol(input, output);
+      }
+      input.remove_prefix(byte_count);
+      continue;
+    }
+
+    const MultiSymbolInfo& info =
+        table[bit_buffer.value() >>
+              (kHuffmanAccumulatorBitCount - kMultiSymbolLookupBitCount)];
+    if (info.symbol_count > 0) {
+      static_assert(kMaxSymbolsPerLookup == 2, "Unexpected lookup size.");
+      out[0] = static_cast<char>(info.symbols[0]);
+      out[1] = static_cast<char>(info.symbols[1]);
+      out += info.symbol_count;
+      bit_buffer.ConsumeBits(info.length);
+      continue;
+    }
+
+    // The code is more than kMultiSymbolLookupBitCount bits long.
+    HuffmanCode code_prefix = bit_buffer.value() >> kExtraAccumulatorBitCount;
+    PrefixInfo prefix_info = PrefixToInfo(code_prefix);
+    if (prefix_info.code_length > bit_buffer.count()) {
+      size_t byte_count = bit_buffer.AppendBytes(input);
+      if (byte_count == 0) {
+        QUICHE_DCHECK_EQ(input.size(), 0u);
+        bit_buffer_ = bit_buffer;
+        output->resize(out - first);
+        return true;
+      }
+      input.remove_prefix(byte_count);
+      continue;
+    }
+    uint32_t canonical = prefix_info.DecodeToCanonical(code_prefix);
+    if (canonical >= 256) {
+      // Encoder is not supposed to explicity encode the EOS symbol.
+      QUICHE_DLOG(ERROR) << "EOS explicitly encoded!\n " << bit_buffer << "\n "
+                         << prefix_info;
+      bit_buffer_ = bit_buffer;
+      output->resize(out - first);
+      return false;
+    }
+    *out++ = kCanonicalToSymbol[canonical];
+    bit_buffer.ConsumeBits(prefix_info.code_length);
+  }
+}
+
+bool HpackHuffmanDecoder::DecodeSymbolBySymbol(absl::string_view input,
+                                               std::string* output) {
+  QUICHE_DVLOG(1) << "HpackHuffmanDecoder::DecodeSymbolBySymbol";
 
   // Fill bit_buffer_ from input.
   input.remove_prefix(bit_buffer_.AppendBytes(input));
@@ -109,8 +109,15 @@ class QUICHE_EXPORT_PRIVATE HpackHuffmanDecoder {
   // will contain the leading bits of the code for that symbol, but not the
   // final bits of that code.
   // Note that output should be empty, but that it is not cleared by Decode().
+  // Decodes up to two symbols at a time using a lookup table indexed by the
+  // next 12 bits of input.
   bool Decode(absl::string_view input, std::string* output);
 
+  // Same as Decode(), but decodes one symbol at a time without the multi-symbol
+  // lookup table. This is the reference implementation that Decode() is tested
+  // against.
+  bool DecodeSymbolBySymbol(absl::string_view input, std::string* output);
+
   // Is what remains in the bit_buffer_ valid at the end of an encoded string?
   // Call after passing the the final portion of a Huffman string to Decode,
   // and getting true as the result.
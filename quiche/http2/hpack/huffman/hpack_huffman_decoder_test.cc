@@ -12,6 +12,8 @@
 #include "absl/strings/escaping.h"
 #include "quiche/http2/decoder/decode_buffer.h"
 #include "quiche/http2/decoder/decode_status.h"
+#include "quiche/http2/hpack/huffman/hpack_huffman_encoder.h"
+#include "quiche/http2/test_tools/http2_random.h"
 #include "quiche/http2/test_tools/random_decoder_test_base.h"
 #include "quiche/common/platform/api/quiche_expect_bug.h"
 #include "quiche/common/platform/api/quiche_test.h"
@@ -237,6 +239,68 @@ TEST_F(HpackHuffmanDecoderTest, SpecResponseExamples) {
   }
 }
 
+// Decodes |input| split into fragments at random points, using either the
+// multi-symbol table or the reference symbol by symbol decoder.
+struct DecodeResult {
+  bool success = true;
+  bool properly_terminated = false;
+  std::string output;
+
+  bool operator==(const DecodeResult& other) const {
+    return success == other.success &&
+           properly_terminated == other.properly_terminated &&
+           output == other.output;
+  }
+};
+
+DecodeResult DecodeInFragments(absl::string_view input, bool symbol_by_symbol,
+                               Http2Random* random) {
+  HpackHuffmanDecoder decoder;
+  DecodeResult result;
+  while (result.success && !input.empty()) {
+    const size_t fragment_size = 1 + random->Uniform(input.size());
+    const absl::string_view fragment = input.substr(0, fragment_size);
+    input.remove_prefix(fragment.size());
+    result.success =
+        symbol_by_symbol
+            ? decoder.DecodeSymbolBySymbol(fragment, &result.output)
+            : decoder.Decode(fragment, &result.output);
+  }
+  result.properly_terminated = decoder.InputProperlyTerminated();
+  return result;
+}
+
+// Compare Decode() against DecodeSymbolBySymbol() on valid encodings of random
+// strings, and on random bytes, most of which are not valid encodings.
+TEST(HpackHuffmanDecoderDifferentialTest, DecodeMatchesSymbolBySymbol) {
+  Http2Random random;
+  for (int i = 0; i < 2000; ++i) {
+    const size_t length = random.Uniform(64);
+    std::string input;
+    if (i % 2 == 0) {
+      const std::string plain = random.RandString(length);
+      HuffmanEncode(plain, HuffmanSize(plain), &input);
+    } else {
+      // Mostly bytes with leading 1 bits, which begin long codes and EOS.
+      input = random.RandStringWithAlphabet(length, "\xff\xfe\xfc\x80\x3f");
+    }
+
+    // Use the same fragmentation for both decoders.
+    const std::string fragment_key =
+        absl::BytesToHexString(random.RandString(32));
+    Http2Random fragment_random1(fragment_key);
+    Http2Random fragment_random2(fragment_key);
+    const DecodeResult expected =
+        DecodeInFragments(input, /*symbol_by_symbol=*/true, &fragment_random1);
+    const DecodeResult actual =
+        DecodeInFragments(input, /*symbol_by_symbol=*/false, &fragment_random2);
+    EXPECT_TRUE(expected == actual)
+        << "input: " << absl::BytesToHexString(input)
+        << "\nexpected: " << absl::BytesToHexString(expected.output)
+        << "\nactual: " << absl::BytesToHexString(actual.output);
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace http2
@@ -4,17 +4,81 @@
 
 #include "quiche/http2/hpack/huffman/hpack_huffman_encoder.h"
 
+#include <cstdint>
+#include <cstring>
+
 #include "quiche/http2/hpack/huffman/huffman_spec_tables.h"
 #include "quiche/common/platform/api/quiche_logging.h"
+#include "quiche/common/quiche_endian.h"
 
 namespace http2 {
 
+namespace {
+
+// Packs codes of up to 32 bits and writes them out 32 bits at a time.
+class HuffmanBitWriter {
+ public:
+  explicit HuffmanBitWriter(char* output) : output_(output) {}
+
+  // Appends the low |length| bits of |code|.
+  void Append(uint64_t code, size_t length) {
+    QUICHE_DCHECK_LE(length, 32u);
+    // |bit_count_| is less than 32, so the pending bits fit.
+    bits_ = (bits_ << length) | code;
+    bit_count_ += length;
+    if (bit_count_ >= 32) {
+      bit_count_ -= 32;
+      const uint32_t word = quiche::QuicheEndian::HostToNet32(
+          static_cast<uint32_t>(bits_ >> bit_count_));
+      memcpy(output_, &word, sizeof(word));
+      output_ += sizeof(word);
+    }
+  }
+
+  // Writes the pending bits, padding the last byte with the leading bits of
+  // the EOS symbol, which are all 1.  Returns one past the last byte written.
+  char* Finish() {
+    while (bit_count_ >= 8) {
+      bit_count_ -= 8;
+      *output_++ = static_cast<char>(bits_ >> bit_count_);
+    }
+    if (bit_count_ > 0) {
+      *output_++ = static_cast<char>((bits_ << (8 - bit_count_)) |
+                                     (0xff >> bit_count_));
+      bit_count_ = 0;
+    }
+    return output_;
+  }
+
+ private:
+  char* output_;
+  // The low |bit_count_| bits are yet to be written.
+  uint64_t bits_ = 0;
+  size_t bit_count_ = 0;
+};
+
+}  // namespace
+
 size_t HuffmanSize(absl::string_view plain) {
-  size_t bits = 0;
-  for (const uint8_t c : plain) {
-    bits += HuffmanSpecTables::kCodeLengths[c];
+  // Sum four lengths per iteration into independent counters, so that the
+  // table lookups do not wait on each other.
+  const uint8_t* const data = reinterpret_cast<const uint8_t*>(plain.data());
+  const size_t size = plain.size();
+  size_t bits0 = 0;
+  size_t bits1 = 0;
+  size_t bits2 = 0;
+  size_t bits3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    bits0 += HuffmanSpecTables::kCodeLengths[data[i]];
+    bits1 += HuffmanSpecTables::kCodeLengths[data[i + 1]];
+    bits2 += HuffmanSpecTables::kCodeLengths[data[i + 2]];
+    bits3 += HuffmanSpecTables::kCodeLengths[data[i + 3]];
+  }
+  for (; i < size; ++i) {
+    bits0 += HuffmanSpecTables::kCodeLengths[data[i]];
   }
-  return (bits + 7) / 8;
+  return (bits0 + bits1 + bits2 + bits3 + 7) / 8;
 }
 
 void HuffmanEncode(absl::string_view plain, size_t encoded_size,
@@ -67,61 +131,44 @@ void HuffmanEncode(absl::string_view plain, size_t encoded_size,
 void HuffmanEncodeFast(absl::string_view input, size_t encoded_size,
                        std::string* output) {
   const size_t original_size = output->size();
-  const size_t final_size = original_size + encoded_size;
-  // Reserve an extra four bytes to avoid accessing unallocated memory (even
-  // though it would only be OR'd with zeros and thus not modified).
-  output->resize(final_size + 4, 0);
-
-  // Pointer to first appended byte.
+  output->resize(original_size + encoded_size);
   char* const first = &*output->begin() + original_size;
-  size_t bit_counter = 0;
-  for (uint8_t c : input) {
-    // Align the Huffman code to byte boundaries as it needs to be written.
-    // The longest Huffman code is 30 bits long, and it can be shifted by up to
-    // 7 bits, requiring 37 bits in total.  The most significant 25 bits and
-    // least significant 2 bits of |code| are always zero.
-    uint64_t code = static_cast<uint64_t>(HuffmanSpecTables::kLeftCodes[c])
-                    << (8 - (bit_counter % 8));
-    // The byte where the first bit of |code| needs to be written.
-    char* const current = first + (bit_counter / 8);
-
-    bit_counter += HuffmanSpecTables::kCodeLengths[c];
-
-    *current |= code >> 32;
-
-    // Do not check if this write is zero before executing it, because with
-    // uniformly random shifts and an ideal random input distribution
-    // corresponding to the Huffman tree it would only be zero in 29% of the
-    // cases.
-    *(current + 1) |= (code >> 24) & 0xff;
-
-    // Continue to next input character if there is nothing else to write.
-    // (If next byte is zero, then rest must also be zero.)
-    if ((code & 0xff0000) == 0) {
-      continue;
-    }
-    *(current + 2) |= (code >> 16) & 0xff;
-
-    // Continue to next input character if there is nothing else to write.
-    // (If next byte is zero, then rest must also be zero.)
-    if ((code & 0xff00) == 0) {
-      continue;
+  HuffmanBitWriter writer(first);
+
+  const uint8_t* const data = reinterpret_cast<const uint8_t*>(input.data());
+  const size_t size = input.size();
+  size_t i = 0;
+  // Look up the codes of four symbols at a time.  Common characters have codes
+  // of at most 8 bits, in which case the four codes are written at once.
+  for (; i + 4 <= size; i += 4) {
+    const size_t length0 = HuffmanSpecTables::kCodeLengths[data[i]];
+    const size_t length1 = HuffmanSpecTables::kCodeLengths[data[i + 1]];
+    const size_t length2 = HuffmanSpecTables::kCodeLengths[data[i + 2]];
+    const size_t length3 = HuffmanSpecTables::kCodeLengths[data[i + 3]];
+    const uint64_t code0 = HuffmanSpecTables::kRightCodes[data[i]];
+    const uint64_t code1 = HuffmanSpecTables::kRightCodes[data[i + 1]];
+    const uint64_t code2 = HuffmanSpecTables::kRightCodes[data[i + 2]];
+    const uint64_t code3 = HuffmanSpecTables::kRightCodes[data[i + 3]];
+    const size_t length = length0 + length1 + length2 + length3;
+    if (length <= 32) {
+      writer.Append(
+          (((((code0 << length1) | code1) << length2) | code2) << length3) |
+              code3,
+          length);
+    } else {
+      writer.Append(code0, length0);
+      writer.Append(code1, length1);
+      writer.Append(code2, length2);
+      writer.Append(code3, length3);
     }
-    *(current + 3) |= (code >> 8) & 0xff;
-
-    // Do not check if this write is zero, because the check would probably be
-    // as expensive as the write.
-    *(current + 4) |= code & 0xff;
   }
-
-  QUICHE_DCHECK_EQ(encoded_size, (bit_counter + 7) / 8);
-
-  // EOF
-  if (bit_counter % 8 != 0) {
-    *(first + encoded_size - 1) |= 0xff >> (bit_counter & 7);
+  for (; i < size; ++i) {
+    writer.Append(HuffmanSpecTables::kRightCodes[data[i]],
+                  HuffmanSpecTables::kCodeLengths[data[i]]);
   }
 
-  output->resize(final_size);
+  char* const last = writer.Finish();
+  QUICHE_DCHECK_EQ(encoded_size, static_cast<size_t>(last - first));
 }
 
 }  // namespace http2
@@ -6,6 +6,7 @@
 
 #include "absl/base/macros.h"
 #include "absl/strings/escaping.h"
+#include "quiche/http2/test_tools/http2_random.h"
 #include "quiche/common/platform/api/quiche_test.h"
 
 namespace http2 {
@@ -126,5 +127,25 @@ TEST_P(HuffmanEncoderTest, AppendToOutput) {
   EXPECT_EQ(absl::HexStringToBytes("94e78c767f"), buffer);
 }
 
+// Compare the fast encoder, which packs several codes at a time, against the
+// simple one on random input of every length up to a few packing batches.
+TEST(HuffmanEncoderDifferentialTest, FastEncoderMatchesReference) {
+  test::Http2Random random;
+  for (size_t length = 0; length < 100; ++length) {
+    for (int i = 0; i < 10; ++i) {
+      // Alternate between short codes only and arbitrary bytes.
+      const std::string plain =
+          i % 2 == 0 ? random.RandStringWithAlphabet(length, "0123456789abcet")
+                     : random.RandString(length);
+      const size_t encoded_size = HuffmanSize(plain);
+      std::string expected = "prefix";
+      HuffmanEncode(plain, encoded_size, &expected);
+      std::string actual = "prefix";
+      HuffmanEncodeFast(plain, encoded_size, &actual);
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace http2
@@ -127,12 +127,24 @@ WriteResult QuicBatchWriterBase::InternalWritePacket(
   return result;
 }
 
+std::unique_ptr<QuicBatchWriterBuffer> QuicBatchWriterBase::SwapBatchBuffer(
+    std::unique_ptr<QuicBatchWriterBuffer> batch_buffer) {
+  QUICHE_DCHECK(buffered_writes().empty());
+  QUICHE_DCHECK(batch_buffer->buffered_writes().empty());
+  batch_buffer_.swap(batch_buffer);
+  return batch_buffer;
+}
+
 QuicBatchWriterBase::FlushImplResult QuicBatchWriterBase::CheckedFlush() {
   if (buffered_writes().empty()) {
     return FlushImplResult{WriteResult(WRITE_STATUS_OK, 0),
                            /*num_packets_sent=*/0, /*bytes_written=*/0};
   }
 
+  if (sealer_ != nullptr) {
+    sealer_->SealPendingPackets();
+  }
+
   const FlushImplResult flush_result = FlushImpl();
 
   // Either flush_result.write_result.status is not WRITE_STATUS_OK, or it is
@@ -173,4 +185,18 @@ WriteResult QuicBatchWriterBase::Flush() {
   return flush_result.write_result;
 }
 
+bool QuicBatchWriterBase::RegisterPacketSealer(QuicPacketSealer* sealer) {
+  if (sealer_ != nullptr && sealer_ != sealer) {
+    return false;
+  }
+  sealer_ = sealer;
+  return true;
+}
+
+void QuicBatchWriterBase::UnregisterPacketSealer(QuicPacketSealer* sealer) {
+  if (sealer_ == sealer) {
+    sealer_ = nullptr;
+  }
+}
+
 }  // namespace quic
@@ -60,10 +60,19 @@ class QUIC_EXPORT_PRIVATE QuicBatchWriterBase : public QuicPacketWriter {
 
   WriteResult Flush() override;
 
+  bool RegisterPacketSealer(QuicPacketSealer* sealer) override;
+  void UnregisterPacketSealer(QuicPacketSealer* sealer) override;
+
  protected:
   const QuicBatchWriterBuffer& batch_buffer() const { return *batch_buffer_; }
   QuicBatchWriterBuffer& batch_buffer() { return *batch_buffer_; }
 
+  // Replaces the batch buffer with |batch_buffer| and returns the old one, for
+  // writers whose sent data must outlive the flush. The old buffer must be
+  // empty, i.e. have been flushed entirely.
+  std::unique_ptr<QuicBatchWriterBuffer> SwapBatchBuffer(
+      std::unique_ptr<QuicBatchWriterBuffer> batch_buffer);
+
   const quiche::QuicheCircularDeque<BufferedWrite>& buffered_writes() const {
     return batch_buffer_->buffered_writes();
   }
@@ -136,6 +145,8 @@ class QUIC_EXPORT_PRIVATE QuicBatchWriterBase : public QuicPacketWriter {
 
   bool write_blocked_;
   std::unique_ptr<QuicBatchWriterBuffer> batch_buffer_;
+  // Not owned. Seals the buffered writes before they are flushed.
+  QuicPacketSealer* sealer_ = nullptr;
 };
 
 // QuicUdpBatchWriter is a batch writer backed by a UDP socket.
@@ -47,6 +47,14 @@ QuicGsoBatchWriter::QuicGsoBatchWriter(
   QUIC_DLOG(INFO) << "Release time forcefully enabled.";
 }
 
+bool QuicGsoBatchWriter::EnableZerocopy(size_t min_batch_size) {
+  if (!QuicLinuxSocketUtils::EnableZerocopy(fd())) {
+    return false;
+  }
+  min_zerocopy_batch_size_ = min_batch_size;
+  return true;
+}
+
 QuicGsoBatchWriter::CanBatchResult QuicGsoBatchWriter::CanBatch(
     const char* /*buffer*/, size_t buf_len, const QuicIpAddress& self_address,
     const QuicSocketAddress& peer_address, const PerPacketOptions* options,
@@ -152,6 +160,59 @@ void QuicGsoBatchWriter::BuildCmsg(QuicMsgHdr* hdr,
   }
 }
 
+bool QuicGsoBatchWriter::PrepareZerocopySend(size_t batch_size) {
+  if (!zerocopy_enabled() || batch_size < min_zerocopy_batch_size_) {
+    return false;
+  }
+  if (free_zerocopy_buffers_.empty() && !zerocopy_buffers_in_flight_.empty()) {
+    ReapZerocopyCompletions();
+  }
+  if (free_zerocopy_buffers_.empty()) {
+    if (zerocopy_buffers_in_flight_.size() >= kMaxZerocopyBuffersInFlight) {
+      QUIC_CODE_COUNT(quic_gso_batch_writer_zerocopy_out_of_buffers);
+      return false;
+    }
+    free_zerocopy_buffers_.push_back(std::make_unique<QuicBatchWriterBuffer>());
+  }
+  return true;
+}
+
+void QuicGsoBatchWriter::OnZerocopySent() {
+  QUICHE_DCHECK(!free_zerocopy_buffers_.empty());
+  std::unique_ptr<QuicBatchWriterBuffer> spare =
+      std::move(free_zerocopy_buffers_.back());
+  free_zerocopy_buffers_.pop_back();
+  zerocopy_buffers_in_flight_.push_back(
+      {next_zerocopy_id_++, /*released=*/false,
+       SwapBatchBuffer(std::move(spare))});
+}
+
+void QuicGsoBatchWriter::ReapZerocopyCompletions() {
+  uint32_t first_id;
+  uint32_t last_id;
+  bool copied;
+  while (QuicLinuxSocketUtils::ReadZerocopyCompletion(fd(), &first_id,
+                                                     &last_id, &copied)) {
+    if (copied) {
+      QUIC_CODE_COUNT(quic_gso_batch_writer_zerocopy_copied);
+    }
+    for (ZerocopyBuffer& in_flight : zerocopy_buffers_in_flight_) {
+      // Unsigned arithmetic, as ids wrap around.
+      if (in_flight.id - first_id <= last_id - first_id) {
+        in_flight.released = true;
+      }
+    }
+  }
+  // Completions may be reported out of order, but buffers are recycled in
+  // send order.
+  while (!zerocopy_buffers_in_flight_.empty() &&
+         zerocopy_buffers_in_flight_.front().released) {
+    free_zerocopy_buffers_.push_back(
+        std::move(zerocopy_buffers_in_flight_.front().buffer));
+    zerocopy_buffers_in_flight_.pop_front();
+  }
+}
+
 QuicGsoBatchWriter::FlushImplResult QuicGsoBatchWriter::FlushImpl() {
   return InternalFlushImpl<kCmsgSpace>(BuildCmsg);
 }
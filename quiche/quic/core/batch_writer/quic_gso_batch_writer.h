@@ -5,7 +5,13 @@
 #ifndef QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_GSO_BATCH_WRITER_H_
 #define QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_GSO_BATCH_WRITER_H_
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "quiche/quic/core/batch_writer/quic_batch_writer_base.h"
+#include "quiche/quic/platform/api/quic_flag_utils.h"
+#include "quiche/common/quiche_circular_deque.h"
 
 namespace quic {
 
@@ -21,6 +27,22 @@ class QUIC_EXPORT_PRIVATE QuicGsoBatchWriter : public QuicUdpBatchWriter {
 
   bool SupportsReleaseTime() const final { return supports_release_time_; }
 
+  // Sends batches of at least |min_batch_size| bytes with MSG_ZEROCOPY, which
+  // saves the kernel from copying them. Smaller batches are still copied, as
+  // zerocopy costs more than it saves for them. Returns false, and leaves
+  // zerocopy disabled, if the socket does not support it.
+  bool EnableZerocopy(size_t min_batch_size = kDefaultMinZerocopyBatchSize);
+
+  bool zerocopy_enabled() const { return min_zerocopy_batch_size_ > 0; }
+
+  // Recycles the batch buffers of completed zerocopy sends. Reads the socket's
+  // error queue until it is empty, so owners should call this when the socket
+  // reports EPOLLERR.
+  void ReapZerocopyCompletions();
+
+  // Zerocopy is generally only effective for writes over around 10KB.
+  static const size_t kDefaultMinZerocopyBatchSize = 16 * 1024;
+
   CanBatchResult CanBatch(const char* buffer, size_t buf_len,
                           const QuicIpAddress& self_address,
                           const QuicSocketAddress& peer_address,
@@ -41,6 +63,20 @@ class QUIC_EXPORT_PRIVATE QuicGsoBatchWriter : public QuicUdpBatchWriter {
   // Get the current time in nanos from |clockid_for_release_time_|.
   virtual uint64_t NowInNanosForReleaseTime() const;
 
+  // Test only, enables zerocopy without setting SO_ZEROCOPY on the socket.
+  void ForceEnableZerocopy(size_t min_batch_size) {
+    min_zerocopy_batch_size_ = min_batch_size;
+  }
+
+  // Returns true if a batch of |batch_size| bytes should be sent with
+  // MSG_ZEROCOPY, in which case a spare batch buffer is available to
+  // OnZerocopySent().
+  bool PrepareZerocopySend(size_t batch_size);
+
+  // Called after a batch was sent with MSG_ZEROCOPY. Moves the batch buffer,
+  // which the kernel still reads from, aside until the send completes.
+  void OnZerocopySent();
+
   static size_t MaxSegments(size_t gso_size) {
     // Max segments should be the min of UDP_MAX_SEGMENTS(64) and
     // (((64KB - sizeof(ip hdr) - sizeof(udp hdr)) / MSS) + 1), in the typical
@@ -73,7 +109,16 @@ class QUIC_EXPORT_PRIVATE QuicGsoBatchWriter : public QuicUdpBatchWriter {
     uint16_t gso_size = buffered_writes().size() > 1 ? first.buf_len : 0;
     cmsg_builder(&hdr, first.self_address, gso_size, first.release_time);
 
-    write_result = QuicLinuxSocketUtils::WritePacket(fd(), hdr);
+    bool zerocopy = PrepareZerocopySend(total_bytes);
+    write_result = QuicLinuxSocketUtils::WritePacket(
+        fd(), hdr, zerocopy ? MSG_ZEROCOPY : 0);
+    if (zerocopy && write_result.status == WRITE_STATUS_ERROR &&
+        write_result.error_code == ENOBUFS) {
+      // The socket is out of memory to track zerocopy sends, copy this batch.
+      QUIC_CODE_COUNT(quic_gso_batch_writer_zerocopy_enobufs);
+      zerocopy = false;
+      write_result = QuicLinuxSocketUtils::WritePacket(fd(), hdr);
+    }
     QUIC_DVLOG(1) << "Write GSO packet result: " << write_result
                   << ", fd: " << fd()
                   << ", self_address: " << first.self_address.ToString()
@@ -81,7 +126,8 @@ class QUIC_EXPORT_PRIVATE QuicGsoBatchWriter : public QuicUdpBatchWriter {
                   << ", num_segments: " << buffered_writes().size()
                   << ", total_bytes: " << total_bytes
                   << ", gso_size: " << gso_size
-                  << ", release_time: " << first.release_time;
+                  << ", release_time: " << first.release_time
+                  << ", zerocopy: " << zerocopy;
 
     // All segments in a GSO packet share the same fate - if the write failed,
     // none of them are sent, and it's not needed to call PopBufferedWrite().
@@ -95,6 +141,9 @@ class QUIC_EXPORT_PRIVATE QuicGsoBatchWriter : public QuicUdpBatchWriter {
     result.bytes_written = total_bytes;
 
     batch_buffer().PopBufferedWrite(buffered_writes().size());
+    if (zerocopy) {
+      OnZerocopySent();
+    }
 
     QUIC_BUG_IF(quic_bug_12544_1, !buffered_writes().empty())
         << "All packets should have been written on a successful return";
@@ -104,8 +153,28 @@ class QUIC_EXPORT_PRIVATE QuicGsoBatchWriter : public QuicUdpBatchWriter {
  private:
   static std::unique_ptr<QuicBatchWriterBuffer> CreateBatchWriterBuffer();
 
+  // A batch buffer the kernel may still read from, until the zerocopy send
+  // numbered |id| completes.
+  struct QUIC_EXPORT_PRIVATE ZerocopyBuffer {
+    uint32_t id;
+    bool released;
+    std::unique_ptr<QuicBatchWriterBuffer> buffer;
+  };
+
+  // Upper bound of the batch buffers held by zerocopy sends. Batches are
+  // copied while all of them are in flight.
+  static const size_t kMaxZerocopyBuffersInFlight = 16;
+
   const clockid_t clockid_for_release_time_;
   const bool supports_release_time_;
+
+  // 0 if zerocopy is disabled.
+  size_t min_zerocopy_batch_size_ = 0;
+  // The kernel numbers zerocopy sends on a socket from 0.
+  uint32_t next_zerocopy_id_ = 0;
+  // In send order.
+  quiche::QuicheCircularDeque<ZerocopyBuffer> zerocopy_buffers_in_flight_;
+  std::vector<std::unique_ptr<QuicBatchWriterBuffer>> free_zerocopy_buffers_;
 };
 
 }  // namespace quic
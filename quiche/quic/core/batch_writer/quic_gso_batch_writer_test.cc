@@ -4,6 +4,9 @@
 
 #include "quiche/quic/core/batch_writer/quic_gso_batch_writer.h"
 
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -15,6 +18,7 @@
 
 using testing::_;
 using testing::Invoke;
+using testing::Return;
 using testing::StrictMock;
 
 namespace quic {
@@ -31,12 +35,31 @@ size_t PacketLength(const msghdr* msg) {
 
 uint64_t MillisToNanos(uint64_t milliseconds) { return milliseconds * 1000000; }
 
+// Fills |msg| with a completion of the zerocopy sends |first_id| to |last_id|,
+// as read from the error queue.
+ssize_t FillZerocopyCompletion(msghdr* msg, uint32_t first_id,
+                               uint32_t last_id) {
+  cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+  cmsg->cmsg_level = SOL_IP;
+  cmsg->cmsg_type = IP_RECVERR;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(sock_extended_err));
+  sock_extended_err err;
+  memset(&err, 0, sizeof(err));
+  err.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+  err.ee_info = first_id;
+  err.ee_data = last_id;
+  memcpy(CMSG_DATA(cmsg), &err, sizeof(err));
+  msg->msg_controllen = CMSG_SPACE(sizeof(sock_extended_err));
+  return 0;
+}
+
 class QUIC_EXPORT_PRIVATE TestQuicGsoBatchWriter : public QuicGsoBatchWriter {
  public:
   using QuicGsoBatchWriter::batch_buffer;
   using QuicGsoBatchWriter::buffered_writes;
   using QuicGsoBatchWriter::CanBatch;
   using QuicGsoBatchWriter::CanBatchResult;
+  using QuicGsoBatchWriter::ForceEnableZerocopy;
   using QuicGsoBatchWriter::GetReleaseTime;
   using QuicGsoBatchWriter::MaxSegments;
   using QuicGsoBatchWriter::QuicGsoBatchWriter;
@@ -61,6 +84,11 @@ class QUIC_EXPORT_PRIVATE TestQuicGsoBatchWriter : public QuicGsoBatchWriter {
   uint64_t forced_release_time_ms_ = 1;
 };
 
+class MockPacketSealer : public QuicPacketSealer {
+ public:
+  MOCK_METHOD(void, SealPendingPackets, (), (override));
+};
+
 struct QUIC_EXPORT_PRIVATE TestPerPacketOptions : public PerPacketOptions {
   std::unique_ptr<quic::PerPacketOptions> Clone() const override {
     return std::make_unique<TestPerPacketOptions>(*this);
@@ -379,6 +407,126 @@ TEST_F(QuicGsoBatchWriterTest, FlushError) {
   ASSERT_EQ(0u, writer.buffered_writes().size());
 }
 
+TEST_F(QuicGsoBatchWriterTest, SealsPendingPacketsBeforeFlush) {
+  TestQuicGsoBatchWriter writer(/*fd=*/-1);
+  StrictMock<MockPacketSealer> sealer;
+  StrictMock<MockPacketSealer> other_sealer;
+  ASSERT_TRUE(writer.RegisterPacketSealer(&sealer));
+  EXPECT_TRUE(writer.RegisterPacketSealer(&sealer));
+  EXPECT_FALSE(writer.RegisterPacketSealer(&other_sealer));
+
+  // Buffering a packet does not seal it.
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 100));
+
+  // A write which cannot be batched flushes, and seals before sending.
+  {
+    testing::InSequence s;
+    EXPECT_CALL(sealer, SealPendingPackets());
+    EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, _)).WillOnce(Return(100));
+  }
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 100), WritePacket(&writer, 200));
+  testing::Mock::VerifyAndClearExpectations(&sealer);
+
+  {
+    testing::InSequence s;
+    EXPECT_CALL(sealer, SealPendingPackets());
+    EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, _)).WillOnce(Return(200));
+  }
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 200), writer.Flush());
+  testing::Mock::VerifyAndClearExpectations(&sealer);
+
+  // Nothing is sealed once the sealer is unregistered, nor on empty flushes.
+  writer.UnregisterPacketSealer(&other_sealer);
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), writer.Flush());
+  writer.UnregisterPacketSealer(&sealer);
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 100));
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, _)).WillOnce(Return(100));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 100), writer.Flush());
+  EXPECT_TRUE(writer.RegisterPacketSealer(&other_sealer));
+}
+
+TEST_F(QuicGsoBatchWriterTest, ZerocopyBelowThreshold) {
+  TestQuicGsoBatchWriter writer(/*fd=*/-1);
+  writer.ForceEnableZerocopy(/*min_batch_size=*/4000);
+
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, 0)).WillOnce(Return(2000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 2000), writer.Flush());
+}
+
+TEST_F(QuicGsoBatchWriterTest, ZerocopyKeepsBufferUntilCompletion) {
+  TestQuicGsoBatchWriter writer(/*fd=*/-1);
+  writer.ForceEnableZerocopy(/*min_batch_size=*/2000);
+
+  const char* first_buffer = writer.batch_buffer().GetNextWriteLocation();
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, MSG_ZEROCOPY))
+      .WillOnce(Invoke([first_buffer](int /*sockfd*/, const msghdr* msg,
+                                      int /*flags*/) {
+        EXPECT_EQ(first_buffer, msg->msg_iov[0].iov_base);
+        return 2000;
+      }));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 2000), writer.Flush());
+
+  // The kernel may still read the first buffer, the next batch goes to
+  // another one.
+  const char* second_buffer = writer.batch_buffer().GetNextWriteLocation();
+  EXPECT_NE(first_buffer, second_buffer);
+
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  // No completion yet, a third buffer is allocated.
+  EXPECT_CALL(mock_syscalls_, Recvmsg(_, _, MSG_ERRQUEUE | MSG_DONTWAIT))
+      .WillOnce(Invoke([](int /*sockfd*/, msghdr* /*msg*/, int /*flags*/) {
+        errno = EAGAIN;
+        return -1;
+      }));
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, MSG_ZEROCOPY))
+      .WillOnce(Return(2000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 2000), writer.Flush());
+  EXPECT_NE(first_buffer, writer.batch_buffer().GetNextWriteLocation());
+  EXPECT_NE(second_buffer, writer.batch_buffer().GetNextWriteLocation());
+
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  // Both sends completed, their buffers are reused.
+  EXPECT_CALL(mock_syscalls_, Recvmsg(_, _, MSG_ERRQUEUE | MSG_DONTWAIT))
+      .WillOnce(Invoke([](int /*sockfd*/, msghdr* msg, int /*flags*/) {
+        return FillZerocopyCompletion(msg, /*first_id=*/0, /*last_id=*/1);
+      }))
+      .WillOnce(Invoke([](int /*sockfd*/, msghdr* /*msg*/, int /*flags*/) {
+        errno = EAGAIN;
+        return -1;
+      }));
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, MSG_ZEROCOPY))
+      .WillOnce(Return(2000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 2000), writer.Flush());
+  const char* fourth_buffer = writer.batch_buffer().GetNextWriteLocation();
+  EXPECT_TRUE(fourth_buffer == first_buffer || fourth_buffer == second_buffer);
+}
+
+TEST_F(QuicGsoBatchWriterTest, ZerocopyFallsBackToCopyOnENOBUFS) {
+  TestQuicGsoBatchWriter writer(/*fd=*/-1);
+  writer.ForceEnableZerocopy(/*min_batch_size=*/2000);
+
+  const char* buffer = writer.batch_buffer().GetNextWriteLocation();
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 0), WritePacket(&writer, 1000));
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, MSG_ZEROCOPY))
+      .WillOnce(Invoke([](int /*sockfd*/, const msghdr* /*msg*/,
+                          int /*flags*/) {
+        errno = ENOBUFS;
+        return -1;
+      }));
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, 0)).WillOnce(Return(2000));
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 2000), writer.Flush());
+  // The batch was copied, the buffer can be reused right away.
+  EXPECT_EQ(buffer, writer.batch_buffer().GetNextWriteLocation());
+}
+
 TEST_F(QuicGsoBatchWriterTest, ReleaseTimeNullOptions) {
   auto writer = TestQuicGsoBatchWriter::NewInstanceWithReleaseTimeSupport();
   EXPECT_EQ(0u, writer->GetReleaseTime(nullptr).actual_release_time);
@@ -0,0 +1,254 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/batch_writer/quic_io_uring_batch_writer.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+
+#include <utility>
+
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_flag_utils.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+// Maximum number of packets sent per io_uring_enter().
+constexpr uint32_t kRingEntries = 64;
+// The completion queue holds twice as many entries as the submission queue,
+// one of which is kept for the writable poll.
+constexpr uint32_t kMaxSendsInFlight = 2 * kRingEntries - 1;
+// Sends are tagged with their batch id and packet index, which is less than
+// kRingEntries, so this never matches a send.
+constexpr uint64_t kWritablePollUserData = ~uint64_t{0};
+// Upper bound of the batch buffers held by sends in flight.
+constexpr size_t kMaxBatchesInFlight = 16;
+
+}  // namespace
+
+// static
+std::unique_ptr<QuicIoUringBatchWriter> QuicIoUringBatchWriter::Create(
+    std::unique_ptr<QuicBatchWriterBuffer> batch_buffer, int fd) {
+  std::unique_ptr<QuicIoUring> ring = QuicIoUring::Create(kRingEntries);
+  if (ring == nullptr || !ring->IsOpSupported(IORING_OP_SENDMSG)) {
+    return nullptr;
+  }
+  return std::unique_ptr<QuicIoUringBatchWriter>(
+      new QuicIoUringBatchWriter(std::move(batch_buffer), fd, std::move(ring)));
+}
+
+QuicIoUringBatchWriter::QuicIoUringBatchWriter(
+    std::unique_ptr<QuicBatchWriterBuffer> batch_buffer, int fd,
+    std::unique_ptr<QuicIoUring> ring)
+    : QuicUdpBatchWriter(std::move(batch_buffer), fd), ring_(std::move(ring)) {}
+
+QuicIoUringBatchWriter::~QuicIoUringBatchWriter() {
+  while (!batches_in_flight_.empty() && ReapCompletions(1)) {
+  }
+}
+
+QuicIoUringBatchWriter::CanBatchResult QuicIoUringBatchWriter::CanBatch(
+    const char* /*buffer*/, size_t /*buf_len*/,
+    const QuicIpAddress& /*self_address*/,
+    const QuicSocketAddress& /*peer_address*/,
+    const PerPacketOptions* /*options*/, uint64_t /*release_time*/) const {
+  // Every flush fits in the submission queue.
+  return CanBatchResult(
+      /*can_batch=*/true,
+      /*must_flush=*/buffered_writes().size() + 1 >= ring_->sq_entries());
+}
+
+QuicIoUringBatchWriter::FlushImplResult QuicIoUringBatchWriter::FlushImpl() {
+  QUICHE_DCHECK(!IsWriteBlocked());
+  QUICHE_DCHECK(!buffered_writes().empty());
+
+  FlushImplResult result = {WriteResult(WRITE_STATUS_OK, 0),
+                            /*num_packets_sent=*/0, /*bytes_written=*/0};
+  WriteResult& write_result = result.write_result;
+
+  ReapCompletions(0);
+  if (pending_error_ != 0) {
+    write_result = WriteResult(WRITE_STATUS_ERROR, pending_error_);
+    pending_error_ = 0;
+    return result;
+  }
+  if (socket_buffer_full_) {
+    // The packets stay buffered until the socket has room again.
+    QUIC_DVLOG(1) << "Socket buffer full, waiting for it to become writable";
+    write_result = WriteResult(WRITE_STATUS_BLOCKED, EWOULDBLOCK);
+    return result;
+  }
+
+  const uint32_t num_packets = buffered_writes().size();
+  while (num_sends_in_flight_ + num_packets > kMaxSendsInFlight ||
+         (free_buffers_.empty() &&
+          batches_in_flight_.size() >= kMaxBatchesInFlight)) {
+    QUIC_CODE_COUNT(quic_io_uring_batch_writer_wait_for_completions);
+    if (!ReapCompletions(1)) {
+      write_result = WriteResult(WRITE_STATUS_ERROR, EIO);
+      return result;
+    }
+  }
+
+  write_result = SubmitPackets();
+  QUIC_DVLOG(1) << "SubmitPackets submitted " << num_packets
+                << " packets. WriteResult=" << write_result;
+  if (write_result.status != WRITE_STATUS_OK) {
+    return result;
+  }
+
+  QUIC_BUG_IF(quic_io_uring_batch_writer_unsent_packets,
+              !buffered_writes().empty())
+      << "All packets should have been written on a successful return";
+  result.num_packets_sent = num_packets;
+  result.bytes_written = write_result.bytes_written;
+  return result;
+}
+
+bool QuicIoUringBatchWriter::OnCompletionsAvailable() {
+  ReapCompletions(0);
+  return IsWriteBlocked() && !socket_buffer_full_;
+}
+
+WriteResult QuicIoUringBatchWriter::SubmitPackets() {
+  auto mhdr = std::make_unique<QuicMMsgHdr>(
+      buffered_writes().begin(), buffered_writes().end(), kCmsgSpaceForIp,
+      [](QuicMMsgHdr* mhdr, int i, const BufferedWrite& buffered_write) {
+        mhdr->SetIpInNextCmsg(i, buffered_write.self_address);
+      });
+  const int num_msgs = mhdr->num_msgs();
+  QUICHE_DCHECK_LE(static_cast<uint32_t>(num_msgs), ring_->sq_entries());
+  const uint32_t batch_id = next_batch_id_;
+  for (int i = 0; i < num_msgs; ++i) {
+    io_uring_sqe* sqe = ring_->GetSqe();
+    QUICHE_DCHECK(sqe != nullptr);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd();
+    sqe->addr = reinterpret_cast<uint64_t>(&mhdr->mhdr()[i].msg_hdr);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_DONTWAIT;
+    sqe->user_data = (static_cast<uint64_t>(batch_id) << 32) | i;
+    if (i + 1 < num_msgs) {
+      // A failed send cancels all packets after it.
+      sqe->flags = IOSQE_IO_LINK;
+    }
+  }
+
+  const int num_submitted = ring_->Submit();
+  if (num_submitted <= 0) {
+    return WriteResult(WRITE_STATUS_ERROR, num_submitted < 0 ? -num_submitted
+                                                             : EIO);
+  }
+  // The ring is set up to submit all entries even if one of them fails.
+  QUICHE_DCHECK_EQ(num_msgs, num_submitted);
+
+  // The sends keep reading from the batch buffer, which is swapped out before
+  // it can be reused.
+  const int bytes_written = mhdr->num_bytes_sent(num_msgs);
+  batch_buffer().PopBufferedWrite(num_msgs);
+  std::unique_ptr<QuicBatchWriterBuffer> spare;
+  if (free_buffers_.empty()) {
+    spare = std::make_unique<QuicBatchWriterBuffer>();
+  } else {
+    spare = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  }
+  ++next_batch_id_;
+  num_sends_in_flight_ += num_msgs;
+  batches_in_flight_.push_back({batch_id, /*num_pending_sends=*/num_msgs,
+                                /*first_error_index=*/num_msgs,
+                                /*first_error=*/0,
+                                SwapBatchBuffer(std::move(spare)),
+                                std::move(mhdr)});
+  return WriteResult(WRITE_STATUS_OK, bytes_written);
+}
+
+bool QuicIoUringBatchWriter::ReapCompletions(uint32_t min_completions) {
+  if (min_completions > 0) {
+    const int rc = ring_->Submit(min_completions);
+    if (rc < 0) {
+      QUIC_LOG_FIRST_N(ERROR, 100)
+          << "Failed to wait for io_uring sends: " << strerror(-rc);
+      return false;
+    }
+  }
+  ring_->ReapCompletions([this](const io_uring_cqe& cqe) {
+    if (cqe.user_data == kWritablePollUserData) {
+      // On failure, fall back to trying the next flush.
+      QUIC_DVLOG(1) << "Writable poll completed: " << cqe.res;
+      writable_poll_in_flight_ = false;
+      socket_buffer_full_ = false;
+      return;
+    }
+    const uint32_t batch_id = static_cast<uint32_t>(cqe.user_data >> 32);
+    const int i = static_cast<int>(cqe.user_data & 0xffffffff);
+    // Batch ids are consecutive, and wrap around.
+    const size_t index = batch_id - batches_in_flight_.front().id;
+    QUICHE_DCHECK_LT(index, batches_in_flight_.size());
+    BatchInFlight& batch = batches_in_flight_[index];
+    --batch.num_pending_sends;
+    --num_sends_in_flight_;
+    // Completions of linked requests may be posted out of order.
+    if (cqe.res < 0 && i < batch.first_error_index) {
+      batch.first_error_index = i;
+      batch.first_error = -cqe.res;
+    }
+  });
+
+  // Batches may complete out of order, but buffers are recycled in flush
+  // order.
+  while (!batches_in_flight_.empty() &&
+         batches_in_flight_.front().num_pending_sends == 0) {
+    BatchInFlight& batch = batches_in_flight_.front();
+    const int num_lost = batch.mhdr->num_msgs() - batch.first_error_index;
+    if (num_lost > 0) {
+      if (batch.first_error == EAGAIN || batch.first_error == EWOULDBLOCK ||
+          batch.first_error == ENOBUFS) {
+        // The packets are lost as if the network dropped them, and the
+        // writer blocks until the socket has room.
+        QUIC_CODE_COUNT(quic_io_uring_batch_writer_send_blocked);
+        QUIC_DVLOG(1) << num_lost << " packets did not fit the socket buffer";
+        socket_buffer_full_ = true;
+      } else {
+        QUIC_LOG_FIRST_N(ERROR, 100)
+            << "Failed to send " << num_lost
+            << " packets: " << strerror(batch.first_error);
+        if (pending_error_ == 0) {
+          pending_error_ = batch.first_error;
+        }
+      }
+    }
+    free_buffers_.push_back(std::move(batch.buffer));
+    batches_in_flight_.pop_front();
+  }
+  if (socket_buffer_full_ && !writable_poll_in_flight_) {
+    ArmWritablePoll();
+  }
+  return true;
+}
+
+void QuicIoUringBatchWriter::ArmWritablePoll() {
+  io_uring_sqe* sqe = ring_->GetSqe();
+  QUICHE_DCHECK(sqe != nullptr);
+  if (sqe != nullptr) {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd();
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = kWritablePollUserData;
+    if (ring_->Submit() == 1) {
+      writable_poll_in_flight_ = true;
+      return;
+    }
+  }
+  // Without a poll nothing would unblock the writer, so let the next flush
+  // try the socket again.
+  QUIC_LOG_FIRST_N(ERROR, 100) << "Failed to poll for socket writability";
+  socket_buffer_full_ = false;
+}
+
+}  // namespace quic
@@ -0,0 +1,106 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_IO_URING_BATCH_WRITER_H_
+#define QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_IO_URING_BATCH_WRITER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/core/batch_writer/quic_batch_writer_base.h"
+#include "quiche/quic/core/quic_io_uring.h"
+#include "quiche/quic/core/quic_linux_socket_utils.h"
+#include "quiche/common/quiche_circular_deque.h"
+
+namespace quic {
+
+// Flushes batched packets with one io_uring_enter() per batch, each packet
+// being a sendmsg linked to the previous one so that the batch stops at the
+// first packet which cannot be sent, like sendmmsg() does.
+//
+// Flushes do not wait for the sends to complete. A flushed batch keeps its
+// buffer until all of its completions are reaped, either by a later flush or
+// by OnCompletionsAvailable(), which the event loop should call when
+// completion_fd() polls readable. A send which fails asynchronously is
+// reported by the next flush. Packets the socket had no room for are lost,
+// and flushes return WRITE_STATUS_BLOCKED until an io_uring poll finds the
+// socket writable again. Any other error fails the next flush.
+class QUIC_EXPORT_PRIVATE QuicIoUringBatchWriter : public QuicUdpBatchWriter {
+ public:
+  // Returns nullptr if io_uring is not available, in which case a
+  // QuicSendmmsgBatchWriter should be used instead.
+  static std::unique_ptr<QuicIoUringBatchWriter> Create(
+      std::unique_ptr<QuicBatchWriterBuffer> batch_buffer, int fd);
+
+  // Waits for the batches in flight, which reference buffers owned by the
+  // writer.
+  ~QuicIoUringBatchWriter() override;
+
+  CanBatchResult CanBatch(const char* buffer, size_t buf_len,
+                          const QuicIpAddress& self_address,
+                          const QuicSocketAddress& peer_address,
+                          const PerPacketOptions* options,
+                          uint64_t release_time) const override;
+
+  FlushImplResult FlushImpl() override;
+
+  // Polls readable while completions of flushed batches are waiting to be
+  // reaped.
+  int completion_fd() const { return ring_->fd(); }
+
+  // Reaps available completions, releasing the buffers of completed batches.
+  // Returns true if the writer is write blocked but the socket has become
+  // writable, in which case the owner should call OnCanWrite() of the
+  // writer's users.
+  bool OnCompletionsAvailable();
+
+  size_t num_batches_in_flight() const { return batches_in_flight_.size(); }
+
+ private:
+  // A flushed batch whose sends may not have completed yet.
+  struct QUIC_EXPORT_PRIVATE BatchInFlight {
+    uint32_t id;
+    int num_pending_sends;
+    // Index of the first packet which failed to send, or the number of
+    // packets if none did.
+    int first_error_index;
+    int first_error;
+    // Referenced by the sends.
+    std::unique_ptr<QuicBatchWriterBuffer> buffer;
+    std::unique_ptr<QuicMMsgHdr> mhdr;
+  };
+
+  QuicIoUringBatchWriter(std::unique_ptr<QuicBatchWriterBuffer> batch_buffer,
+                         int fd, std::unique_ptr<QuicIoUring> ring);
+
+  // Submits the sends of all buffered packets, without waiting for them to
+  // complete, and moves the batch buffer into |batches_in_flight_|.
+  WriteResult SubmitPackets();
+
+  // Processes available completions, waiting for at least |min_completions|
+  // of them, and releases the buffers of the oldest completed batches.
+  // Returns false if waiting failed.
+  bool ReapCompletions(uint32_t min_completions);
+
+  // Submits a poll which completes once the socket is writable.
+  void ArmWritablePoll();
+
+  std::unique_ptr<QuicIoUring> ring_;
+  uint32_t next_batch_id_ = 0;
+  quiche::QuicheCircularDeque<BatchInFlight> batches_in_flight_;
+  std::vector<std::unique_ptr<QuicBatchWriterBuffer>> free_buffers_;
+  // Sends in flight, which must not exceed the completion queue size.
+  uint32_t num_sends_in_flight_ = 0;
+  // First error of an asynchronous send, not reported yet. 0 if none.
+  int pending_error_ = 0;
+  // Set when a send finds the socket buffer full, until the writable poll
+  // completes.
+  bool socket_buffer_full_ = false;
+  bool writable_poll_in_flight_ = false;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_IO_URING_BATCH_WRITER_H_
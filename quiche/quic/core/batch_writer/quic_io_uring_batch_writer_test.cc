@@ -0,0 +1,221 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/batch_writer/quic_io_uring_batch_writer.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicIoUringBatchWriterTest : public QuicTest {
+ protected:
+  void SetUp() override {
+    server_fd_ = socket_api_.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, server_fd_);
+    ASSERT_TRUE(socket_api_.Bind(server_fd_, QuicSocketAddress(localhost_, 0)));
+    ASSERT_EQ(0, server_address_.FromSocket(server_fd_));
+
+    client_fd_ = socket_api_.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, client_fd_);
+    ASSERT_TRUE(socket_api_.Bind(client_fd_, QuicSocketAddress(localhost_, 0)));
+  }
+
+  void TearDown() override {
+    writer_.reset();
+    socket_api_.Destroy(server_fd_);
+    socket_api_.Destroy(client_fd_);
+  }
+
+  void WritePacket(const std::string& payload) {
+    EXPECT_EQ(WRITE_STATUS_OK,
+              writer_
+                  ->WritePacket(payload.data(), payload.size(), localhost_,
+                                server_address_, nullptr)
+                  .status);
+  }
+
+  // Receives until |num_packets| packets were received or nothing arrives
+  // for a second.
+  std::vector<std::string> ReceivePackets(size_t num_packets) {
+    std::vector<std::string> packets;
+    char buffer[kMaxOutgoingPacketSize];
+    while (packets.size() < num_packets) {
+      pollfd pfd = {server_fd_, POLLIN, 0};
+      if (poll(&pfd, 1, /*timeout=*/1000) <= 0) {
+        break;
+      }
+      ssize_t length = recv(server_fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if (length >= 0) {
+        packets.push_back(std::string(buffer, length));
+      }
+    }
+    return packets;
+  }
+
+  QuicIpAddress localhost_ = QuicIpAddress::Loopback4();
+  QuicUdpSocketApi socket_api_;
+  QuicUdpSocketFd server_fd_ = kQuicInvalidSocketFd;
+  QuicUdpSocketFd client_fd_ = kQuicInvalidSocketFd;
+  QuicSocketAddress server_address_;
+  std::unique_ptr<QuicIoUringBatchWriter> writer_;
+};
+
+TEST_F(QuicIoUringBatchWriterTest, FlushDoesNotWaitForSends) {
+  writer_ = QuicIoUringBatchWriter::Create(
+      std::make_unique<QuicBatchWriterBuffer>(), client_fd_);
+  if (writer_ == nullptr) {
+    // io_uring is not supported by the kernel running this test.
+    return;
+  }
+
+  const std::vector<std::string> payloads = {
+      std::string(1000, 'a'), std::string(1, 'b'), std::string(1350, 'c')};
+  for (const std::string& payload : payloads) {
+    WritePacket(payload);
+  }
+  WriteResult result = writer_->Flush();
+  EXPECT_EQ(WRITE_STATUS_OK, result.status);
+  EXPECT_EQ(2351, result.bytes_written);
+  // The batch is held until its completions are reaped.
+  EXPECT_EQ(1u, writer_->num_batches_in_flight());
+
+  pollfd pfd = {writer_->completion_fd(), POLLIN, 0};
+  ASSERT_EQ(1, poll(&pfd, 1, /*timeout=*/1000));
+  writer_->OnCompletionsAvailable();
+  EXPECT_EQ(0u, writer_->num_batches_in_flight());
+
+  EXPECT_EQ(payloads, ReceivePackets(payloads.size()));
+}
+
+TEST_F(QuicIoUringBatchWriterTest, ManyBatchesInFlight) {
+  writer_ = QuicIoUringBatchWriter::Create(
+      std::make_unique<QuicBatchWriterBuffer>(), client_fd_);
+  if (writer_ == nullptr) {
+    return;
+  }
+
+  // More batches than the writer keeps in flight, without ever reaping
+  // completions from the event loop.
+  std::vector<std::string> payloads;
+  for (int i = 0; i < 40; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      payloads.push_back(absl::StrCat("batch ", i, " packet ", j));
+      WritePacket(payloads.back());
+    }
+    EXPECT_EQ(WRITE_STATUS_OK, writer_->Flush().status);
+  }
+
+  EXPECT_EQ(payloads, ReceivePackets(payloads.size()));
+}
+
+TEST_F(QuicIoUringBatchWriterTest, FlushesFullSubmissionQueue) {
+  writer_ = QuicIoUringBatchWriter::Create(
+      std::make_unique<QuicBatchWriterBuffer>(), client_fd_);
+  if (writer_ == nullptr) {
+    return;
+  }
+
+  // Small packets, so that the submission queue fills up before the batch
+  // buffer does.
+  std::vector<std::string> payloads;
+  for (int i = 0; i < 200; ++i) {
+    payloads.push_back(absl::StrCat(i));
+    WritePacket(payloads.back());
+  }
+  EXPECT_EQ(WRITE_STATUS_OK, writer_->Flush().status);
+
+  EXPECT_EQ(payloads, ReceivePackets(payloads.size()));
+}
+
+TEST_F(QuicIoUringBatchWriterTest, BlocksWhileSocketBufferIsFull) {
+  // UDP over loopback never runs out of send buffer, so a TCP connection whose
+  // peer does not read stands in for a full socket. TCP ignores the
+  // destination address and IP cmsgs of each sendmsg.
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_LE(0, listener);
+  sockaddr_storage address = QuicSocketAddress(localhost_, 0).generic_address();
+  socklen_t address_len = sizeof(sockaddr_in);
+  ASSERT_EQ(0, bind(listener, reinterpret_cast<sockaddr*>(&address),
+                    address_len));
+  ASSERT_EQ(0, listen(listener, 1));
+  ASSERT_EQ(0, getsockname(listener, reinterpret_cast<sockaddr*>(&address),
+                           &address_len));
+  int sender = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  ASSERT_LE(0, sender);
+  int buffer_size = 4096;
+  setsockopt(sender, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+  connect(sender, reinterpret_cast<sockaddr*>(&address), address_len);
+  int receiver = accept(listener, nullptr, nullptr);
+  ASSERT_LE(0, receiver);
+  setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &buffer_size,
+             sizeof(buffer_size));
+
+  writer_ = QuicIoUringBatchWriter::Create(
+      std::make_unique<QuicBatchWriterBuffer>(), sender);
+  if (writer_ == nullptr) {
+    close(receiver);
+    close(sender);
+    close(listener);
+    return;
+  }
+
+  // Keep sending until a flush finds the socket buffer full.
+  const std::string payload(1000, 'a');
+  WriteResult result(WRITE_STATUS_OK, 0);
+  for (int i = 0; i < 10000 && result.status == WRITE_STATUS_OK; ++i) {
+    writer_->WritePacket(payload.data(), payload.size(), localhost_,
+                         server_address_, nullptr);
+    result = writer_->Flush();
+    pollfd pfd = {writer_->completion_fd(), POLLIN, 0};
+    if (poll(&pfd, 1, /*timeout=*/10) == 1) {
+      EXPECT_FALSE(writer_->OnCompletionsAvailable());
+    }
+  }
+  ASSERT_EQ(WRITE_STATUS_BLOCKED, result.status);
+  EXPECT_TRUE(writer_->IsWriteBlocked());
+
+  // Draining the peer makes the socket writable, which the writable poll
+  // reports through the completion queue.
+  char buffer[4096];
+  pollfd pfd = {writer_->completion_fd(), POLLIN, 0};
+  int num_ready = 0;
+  for (int i = 0; i < 100 && num_ready == 0; ++i) {
+    while (recv(receiver, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+    }
+    num_ready = poll(&pfd, 1, /*timeout=*/10);
+  }
+  ASSERT_EQ(1, num_ready);
+  EXPECT_TRUE(writer_->OnCompletionsAvailable());
+
+  // The packet buffered while blocked is sent by the next flush.
+  writer_->SetWritable();
+  result = writer_->Flush();
+  EXPECT_EQ(WRITE_STATUS_OK, result.status);
+  EXPECT_EQ(1000, result.bytes_written);
+
+  writer_.reset();
+  close(receiver);
+  close(sender);
+  close(listener);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
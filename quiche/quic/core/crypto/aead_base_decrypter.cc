@@ -163,16 +163,7 @@ bool AeadBaseDecrypter::DecryptPacket(uint64_t packet_number,
   }
 
   uint8_t nonce[kMaxNonceSize];
-  memcpy(nonce, iv_, nonce_size_);
-  size_t prefix_len = nonce_size_ - sizeof(packet_number);
-  if (use_ietf_nonce_construction_) {
-    for (size_t i = 0; i < sizeof(packet_number); ++i) {
-      nonce[prefix_len + i] ^=
-          (packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff;
-    }
-  } else {
-    memcpy(nonce + prefix_len, &packet_number, sizeof(packet_number));
-  }
+  MakeNonce(packet_number, nonce);
   if (!EVP_AEAD_CTX_open(
           ctx_.get(), reinterpret_cast<uint8_t*>(output), output_length,
           max_output_length, reinterpret_cast<const uint8_t*>(nonce),
@@ -188,6 +179,49 @@ bool AeadBaseDecrypter::DecryptPacket(uint64_t packet_number,
   return true;
 }
 
+size_t AeadBaseDecrypter::DecryptPackets(absl::Span<PacketToDecrypt> packets) {
+  if (have_preliminary_key_) {
+    return QuicDecrypter::DecryptPackets(packets);
+  }
+  size_t num_decrypted = 0;
+  uint8_t nonce[kMaxNonceSize];
+  for (PacketToDecrypt& packet : packets) {
+    packet.decrypted = false;
+    if (packet.ciphertext.length() < auth_tag_size_) {
+      continue;
+    }
+    MakeNonce(packet.packet_number, nonce);
+    if (!EVP_AEAD_CTX_open(
+            ctx_.get(), reinterpret_cast<uint8_t*>(packet.output),
+            &packet.output_length, packet.max_output_length, nonce,
+            nonce_size_,
+            reinterpret_cast<const uint8_t*>(packet.ciphertext.data()),
+            packet.ciphertext.size(),
+            reinterpret_cast<const uint8_t*>(packet.associated_data.data()),
+            packet.associated_data.size())) {
+      ClearOpenSslErrors();
+      continue;
+    }
+    packet.decrypted = true;
+    ++num_decrypted;
+  }
+  return num_decrypted;
+}
+
+void AeadBaseDecrypter::MakeNonce(uint64_t packet_number,
+                                  uint8_t* nonce) const {
+  memcpy(nonce, iv_, nonce_size_);
+  size_t prefix_len = nonce_size_ - sizeof(packet_number);
+  if (use_ietf_nonce_construction_) {
+    for (size_t i = 0; i < sizeof(packet_number); ++i) {
+      nonce[prefix_len + i] ^=
+          (packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff;
+    }
+  } else {
+    memcpy(nonce + prefix_len, &packet_number, sizeof(packet_number));
+  }
+}
+
 size_t AeadBaseDecrypter::GetKeySize() const { return key_size_; }
 
 size_t AeadBaseDecrypter::GetNoncePrefixSize() const {
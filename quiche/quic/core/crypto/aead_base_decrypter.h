@@ -8,6 +8,7 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "openssl/aead.h"
 #include "quiche/quic/core/crypto/quic_decrypter.h"
 #include "quiche/quic/platform/api/quic_export.h"
@@ -35,6 +36,9 @@ class QUIC_EXPORT_PRIVATE AeadBaseDecrypter : public QuicDecrypter {
   bool DecryptPacket(uint64_t packet_number, absl::string_view associated_data,
                      absl::string_view ciphertext, char* output,
                      size_t* output_length, size_t max_output_length) override;
+  // Opens the packets back to back with the same context, without framing in
+  // between, which keeps the expanded key and cipher code hot in cache.
+  size_t DecryptPackets(absl::Span<PacketToDecrypt> packets) override;
   size_t GetKeySize() const override;
   size_t GetNoncePrefixSize() const override;
   size_t GetIVSize() const override;
@@ -49,6 +53,10 @@ class QUIC_EXPORT_PRIVATE AeadBaseDecrypter : public QuicDecrypter {
   static const size_t kMaxNonceSize = 12;
 
  private:
+  // Writes the nonce of |packet_number| to |nonce|, which must hold
+  // |nonce_size_| bytes.
+  void MakeNonce(uint64_t packet_number, uint8_t* nonce) const;
+
   const EVP_AEAD* const aead_alg_;
   const size_t key_size_;
   const size_t auth_tag_size_;
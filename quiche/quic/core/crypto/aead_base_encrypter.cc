@@ -135,16 +135,7 @@ bool AeadBaseEncrypter::EncryptPacket(uint64_t packet_number,
   // TODO(ianswett): Introduce a check to ensure that we don't encrypt with the
   // same packet number twice.
   alignas(4) char nonce_buffer[kMaxNonceSize];
-  memcpy(nonce_buffer, iv_, nonce_size_);
-  size_t prefix_len = nonce_size_ - sizeof(packet_number);
-  if (use_ietf_nonce_construction_) {
-    for (size_t i = 0; i < sizeof(packet_number); ++i) {
-      nonce_buffer[prefix_len + i] ^=
-          (packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff;
-    }
-  } else {
-    memcpy(nonce_buffer + prefix_len, &packet_number, sizeof(packet_number));
-  }
+  MakeNonce(packet_number, nonce_buffer);
 
   if (!Encrypt(absl::string_view(nonce_buffer, nonce_size_), associated_data,
                plaintext, reinterpret_cast<unsigned char*>(output))) {
@@ -154,6 +145,44 @@ bool AeadBaseEncrypter::EncryptPacket(uint64_t packet_number,
   return true;
 }
 
+bool AeadBaseEncrypter::EncryptPackets(absl::Span<PacketToEncrypt> packets) {
+  alignas(4) char nonce_buffer[kMaxNonceSize];
+  for (PacketToEncrypt& packet : packets) {
+    const size_t ciphertext_size = GetCiphertextSize(packet.plaintext.length());
+    if (packet.max_output_length < ciphertext_size) {
+      return false;
+    }
+    MakeNonce(packet.packet_number, nonce_buffer);
+    size_t ciphertext_len;
+    if (!EVP_AEAD_CTX_seal(
+            ctx_.get(), reinterpret_cast<uint8_t*>(packet.output),
+            &ciphertext_len, ciphertext_size,
+            reinterpret_cast<const uint8_t*>(nonce_buffer), nonce_size_,
+            reinterpret_cast<const uint8_t*>(packet.plaintext.data()),
+            packet.plaintext.size(),
+            reinterpret_cast<const uint8_t*>(packet.associated_data.data()),
+            packet.associated_data.size())) {
+      DLogOpenSslErrors();
+      return false;
+    }
+    packet.output_length = ciphertext_size;
+  }
+  return true;
+}
+
+void AeadBaseEncrypter::MakeNonce(uint64_t packet_number, char* nonce) const {
+  memcpy(nonce, iv_, nonce_size_);
+  size_t prefix_len = nonce_size_ - sizeof(packet_number);
+  if (use_ietf_nonce_construction_) {
+    for (size_t i = 0; i < sizeof(packet_number); ++i) {
+      nonce[prefix_len + i] ^=
+          (packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff;
+    }
+  } else {
+    memcpy(nonce + prefix_len, &packet_number, sizeof(packet_number));
+  }
+}
+
 size_t AeadBaseEncrypter::GetKeySize() const { return key_size_; }
 
 size_t AeadBaseEncrypter::GetNoncePrefixSize() const {
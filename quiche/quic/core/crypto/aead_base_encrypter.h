@@ -8,6 +8,7 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "openssl/aead.h"
 #include "quiche/quic/core/crypto/quic_encrypter.h"
 #include "quiche/quic/platform/api/quic_export.h"
@@ -33,6 +34,9 @@ class QUIC_EXPORT_PRIVATE AeadBaseEncrypter : public QuicEncrypter {
   bool EncryptPacket(uint64_t packet_number, absl::string_view associated_data,
                      absl::string_view plaintext, char* output,
                      size_t* output_length, size_t max_output_length) override;
+  // Seals the packets back to back with the same context, without framing in
+  // between, which keeps the expanded key and cipher code hot in cache.
+  bool EncryptPackets(absl::Span<PacketToEncrypt> packets) override;
   size_t GetKeySize() const override;
   size_t GetNoncePrefixSize() const override;
   size_t GetIVSize() const override;
@@ -54,6 +58,10 @@ class QUIC_EXPORT_PRIVATE AeadBaseEncrypter : public QuicEncrypter {
   enum : size_t { kMaxNonceSize = 12 };
 
  private:
+  // Writes the nonce of |packet_number| to |nonce|, which must hold
+  // |nonce_size_| bytes.
+  void MakeNonce(uint64_t packet_number, char* nonce) const;
+
   const EVP_AEAD* const aead_alg_;
   const size_t key_size_;
   const size_t auth_tag_size_;
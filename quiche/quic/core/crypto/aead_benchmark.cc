@@ -0,0 +1,144 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures sealing and opening packet payloads with each of the AEADs QUIC
+// supports.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/crypto/aes_128_gcm_12_decrypter.h"
+#include "quiche/quic/core/crypto/aes_128_gcm_12_encrypter.h"
+#include "quiche/quic/core/crypto/aes_128_gcm_decrypter.h"
+#include "quiche/quic/core/crypto/aes_128_gcm_encrypter.h"
+#include "quiche/quic/core/crypto/aes_256_gcm_decrypter.h"
+#include "quiche/quic/core/crypto/aes_256_gcm_encrypter.h"
+#include "quiche/quic/core/crypto/chacha20_poly1305_decrypter.h"
+#include "quiche/quic/core/crypto/chacha20_poly1305_encrypter.h"
+#include "quiche/quic/core/crypto/chacha20_poly1305_tls_decrypter.h"
+#include "quiche/quic/core/crypto/chacha20_poly1305_tls_encrypter.h"
+#include "quiche/quic/core/crypto/quic_crypter.h"
+#include "quiche/quic/core/quic_constants.h"
+
+namespace quic {
+namespace {
+
+// Length of a short header with an 8 byte connection ID and a 4 byte packet
+// number, authenticated as associated data.
+constexpr size_t kAssociatedDataLength = 13;
+
+// IETF QUIC AEADs take a full IV, Google QUIC ones a nonce prefix.
+enum class NonceConstruction { kIetf, kGoogle };
+
+bool InitializeCrypter(QuicCrypter* crypter,
+                       NonceConstruction nonce_construction) {
+  if (!crypter->SetKey(std::string(crypter->GetKeySize(), 'k'))) {
+    return false;
+  }
+  if (nonce_construction == NonceConstruction::kIetf) {
+    return crypter->SetIV(std::string(crypter->GetIVSize(), 'i'));
+  }
+  return crypter->SetNoncePrefix(
+      std::string(crypter->GetNoncePrefixSize(), 'n'));
+}
+
+template <typename Encrypter, NonceConstruction nonce_construction>
+void BM_Seal(benchmark::State& state) {
+  Encrypter encrypter;
+  if (!InitializeCrypter(&encrypter, nonce_construction)) {
+    state.SkipWithError("Failed to initialize encrypter");
+    return;
+  }
+  const std::string associated_data(kAssociatedDataLength, 'a');
+  const std::string plaintext(state.range(0), 'p');
+  char ciphertext[kMaxOutgoingPacketSize];
+  uint64_t packet_number = 1;
+  for (auto _ : state) {
+    size_t ciphertext_length;
+    if (!encrypter.EncryptPacket(packet_number++, associated_data, plaintext,
+                                 ciphertext, &ciphertext_length,
+                                 sizeof(ciphertext))) {
+      state.SkipWithError("Failed to encrypt");
+      return;
+    }
+    benchmark::DoNotOptimize(ciphertext_length);
+  }
+  state.SetBytesProcessed(state.iterations() * plaintext.size());
+}
+
+template <typename Encrypter, typename Decrypter,
+          NonceConstruction nonce_construction>
+void BM_Open(benchmark::State& state) {
+  Encrypter encrypter;
+  Decrypter decrypter;
+  if (!InitializeCrypter(&encrypter, nonce_construction) ||
+      !InitializeCrypter(&decrypter, nonce_construction)) {
+    state.SkipWithError("Failed to initialize crypters");
+    return;
+  }
+  const std::string associated_data(kAssociatedDataLength, 'a');
+  const std::string plaintext(state.range(0), 'p');
+  char ciphertext[kMaxOutgoingPacketSize];
+  size_t ciphertext_length;
+  if (!encrypter.EncryptPacket(/*packet_number=*/1, associated_data, plaintext,
+                               ciphertext, &ciphertext_length,
+                               sizeof(ciphertext))) {
+    state.SkipWithError("Failed to encrypt");
+    return;
+  }
+  char output[kMaxOutgoingPacketSize];
+  for (auto _ : state) {
+    size_t output_length;
+    if (!decrypter.DecryptPacket(
+            /*packet_number=*/1, associated_data,
+            absl::string_view(ciphertext, ciphertext_length), output,
+            &output_length, sizeof(output))) {
+      state.SkipWithError("Failed to decrypt");
+      return;
+    }
+    benchmark::DoNotOptimize(output_length);
+  }
+  state.SetBytesProcessed(state.iterations() * plaintext.size());
+}
+
+// Small packets such as ACKs, and full packets.
+void PacketSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(50)->Arg(1350);
+}
+
+BENCHMARK_TEMPLATE(BM_Seal, Aes128GcmEncrypter, NonceConstruction::kIetf)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Open, Aes128GcmEncrypter, Aes128GcmDecrypter,
+                   NonceConstruction::kIetf)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Seal, Aes256GcmEncrypter, NonceConstruction::kIetf)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Open, Aes256GcmEncrypter, Aes256GcmDecrypter,
+                   NonceConstruction::kIetf)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Seal, ChaCha20Poly1305TlsEncrypter,
+                   NonceConstruction::kIetf)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Open, ChaCha20Poly1305TlsEncrypter,
+                   ChaCha20Poly1305TlsDecrypter, NonceConstruction::kIetf)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Seal, Aes128Gcm12Encrypter, NonceConstruction::kGoogle)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Open, Aes128Gcm12Encrypter, Aes128Gcm12Decrypter,
+                   NonceConstruction::kGoogle)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Seal, ChaCha20Poly1305Encrypter,
+                   NonceConstruction::kGoogle)
+    ->Apply(PacketSizes);
+BENCHMARK_TEMPLATE(BM_Open, ChaCha20Poly1305Encrypter,
+                   ChaCha20Poly1305Decrypter, NonceConstruction::kGoogle)
+    ->Apply(PacketSizes);
+
+}  // namespace
+}  // namespace quic
+
+BENCHMARK_MAIN();
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/escaping.h"
@@ -255,5 +256,36 @@ TEST_F(Aes256GcmEncrypterTest, GenerateHeaderProtectionMask) {
       expected_mask.size());
 }
 
+TEST_F(Aes256GcmEncrypterTest, GenerateHeaderProtectionMasks) {
+  Aes256GcmEncrypter encrypter;
+  std::string key = absl::HexStringToBytes(
+      "ed23ecbf54d426def5c52c3dcfc84434e62e57781d3125bb21ed91b7d3e07788");
+  ASSERT_TRUE(encrypter.SetHeaderProtectionKey(key));
+  // More samples than are encrypted in one pass.
+  std::string samples_data;
+  for (int i = 0; i < 100; ++i) {
+    samples_data += absl::HexStringToBytes("4d190c474be2b8babafb49ec4e38e810");
+    samples_data[samples_data.size() - 1] = static_cast<char>(i);
+  }
+  std::vector<absl::string_view> samples;
+  for (size_t i = 0; i < 100; ++i) {
+    samples.push_back(absl::string_view(samples_data).substr(
+        i * QuicEncrypter::kHeaderProtectionSampleLength,
+        QuicEncrypter::kHeaderProtectionSampleLength));
+  }
+  std::string masks(samples.size() * QuicEncrypter::kHeaderProtectionMaskLength,
+                    0);
+  ASSERT_TRUE(encrypter.GenerateHeaderProtectionMasks(samples, &masks[0]));
+  for (size_t i = 0; i < samples.size(); ++i) {
+    std::string expected_mask =
+        encrypter.GenerateHeaderProtectionMask(samples[i]);
+    quiche::test::CompareCharArraysWithHexError(
+        "header protection mask",
+        masks.data() + i * QuicEncrypter::kHeaderProtectionMaskLength,
+        QuicEncrypter::kHeaderProtectionMaskLength, expected_mask.data(),
+        QuicEncrypter::kHeaderProtectionMaskLength);
+  }
+}
+
 }  // namespace test
 }  // namespace quic
@@ -4,8 +4,13 @@
 
 #include "quiche/quic/core/crypto/aes_base_encrypter.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
 #include "absl/strings/string_view.h"
 #include "openssl/aes.h"
+#include "openssl/cipher.h"
 #include "quiche/quic/platform/api/quic_bug_tracker.h"
 
 namespace quic {
@@ -21,6 +26,16 @@ bool AesBaseEncrypter::SetHeaderProtectionKey(absl::string_view key) {
     QUIC_BUG(quic_bug_10726_2) << "Unexpected failure of AES_set_encrypt_key";
     return false;
   }
+  const EVP_CIPHER* ecb =
+      key.size() == 16 ? EVP_aes_128_ecb() : EVP_aes_256_ecb();
+  if (!EVP_EncryptInit_ex(pne_ecb_ctx_.get(), ecb, nullptr,
+                          reinterpret_cast<const uint8_t*>(key.data()),
+                          nullptr) ||
+      !EVP_CIPHER_CTX_set_padding(pne_ecb_ctx_.get(), 0)) {
+    QUIC_BUG(quic_aes_base_encrypter_ecb_init_failed)
+        << "Unexpected failure of EVP_EncryptInit_ex";
+    return false;
+  }
   return true;
 }
 
@@ -36,6 +51,38 @@ std::string AesBaseEncrypter::GenerateHeaderProtectionMask(
   return out;
 }
 
+bool AesBaseEncrypter::GenerateHeaderProtectionMasks(
+    absl::Span<const absl::string_view> samples, char* masks) {
+  static_assert(kHeaderProtectionSampleLength == AES_BLOCK_SIZE,
+                "Header protection samples are one AES block");
+  // Samples are gathered into a contiguous buffer, a bounded number at a
+  // time so that it fits on the stack.
+  constexpr size_t kMaxSamplesPerPass = 64;
+  uint8_t in[kMaxSamplesPerPass * AES_BLOCK_SIZE];
+  uint8_t out[kMaxSamplesPerPass * AES_BLOCK_SIZE];
+  while (!samples.empty()) {
+    const size_t num_samples = std::min(samples.size(), kMaxSamplesPerPass);
+    for (size_t i = 0; i < num_samples; ++i) {
+      if (samples[i].size() != AES_BLOCK_SIZE) {
+        return false;
+      }
+      memcpy(in + i * AES_BLOCK_SIZE, samples[i].data(), AES_BLOCK_SIZE);
+    }
+    int out_length = 0;
+    if (!EVP_EncryptUpdate(pne_ecb_ctx_.get(), out, &out_length, in,
+                           static_cast<int>(num_samples * AES_BLOCK_SIZE)) ||
+        static_cast<size_t>(out_length) != num_samples * AES_BLOCK_SIZE) {
+      return false;
+    }
+    for (size_t i = 0; i < num_samples; ++i) {
+      memcpy(masks, out + i * AES_BLOCK_SIZE, kHeaderProtectionMaskLength);
+      masks += kHeaderProtectionMaskLength;
+    }
+    samples.remove_prefix(num_samples);
+  }
+  return true;
+}
+
 QuicPacketCount AesBaseEncrypter::GetConfidentialityLimit() const {
   // For AEAD_AES_128_GCM and AEAD_AES_256_GCM ... endpoints that do not send
   // packets larger than 2^11 bytes cannot protect more than 2^28 packets.
@@ -6,9 +6,12 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/strings/escaping.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "quiche/quic/core/crypto/chacha20_poly1305_tls_encrypter.h"
 #include "quiche/quic/core/quic_utils.h"
 #include "quiche/quic/platform/api/quic_test.h"
 #include "quiche/quic/test_tools/quic_test_utils.h"
@@ -184,5 +187,93 @@ TEST_F(ChaCha20Poly1305TlsDecrypterTest, GenerateHeaderProtectionMask) {
       expected_mask.size());
 }
 
+TEST_F(ChaCha20Poly1305TlsDecrypterTest, GenerateHeaderProtectionMasks) {
+  ChaCha20Poly1305TlsDecrypter decrypter;
+  std::string key = absl::HexStringToBytes(
+      "6a067f432787bd6034dd3f08f07fc9703a27e58c70e2d88d948b7f6489923cc7");
+  ASSERT_TRUE(decrypter.SetHeaderProtectionKey(key));
+  // More samples than are encrypted in one pass.
+  std::string samples_data;
+  for (int i = 0; i < 100; ++i) {
+    samples_data += absl::HexStringToBytes("1210d91cceb45c716b023f492c29e612");
+    samples_data[samples_data.size() - 1] = static_cast<char>(i);
+  }
+  std::vector<absl::string_view> samples;
+  for (size_t i = 0; i < 100; ++i) {
+    samples.push_back(absl::string_view(samples_data).substr(
+        i * QuicDecrypter::kHeaderProtectionSampleLength,
+        QuicDecrypter::kHeaderProtectionSampleLength));
+  }
+  std::string masks(samples.size() * QuicDecrypter::kHeaderProtectionMaskLength,
+                    0);
+  ASSERT_TRUE(decrypter.GenerateHeaderProtectionMasks(samples, &masks[0]));
+  for (size_t i = 0; i < samples.size(); ++i) {
+    QuicDataReader sample_reader(samples[i]);
+    std::string expected_mask =
+        decrypter.GenerateHeaderProtectionMask(&sample_reader);
+    quiche::test::CompareCharArraysWithHexError(
+        "header protection mask",
+        masks.data() + i * QuicDecrypter::kHeaderProtectionMaskLength,
+        QuicDecrypter::kHeaderProtectionMaskLength, expected_mask.data(),
+        QuicDecrypter::kHeaderProtectionMaskLength);
+  }
+}
+
+TEST_F(ChaCha20Poly1305TlsDecrypterTest, DecryptPackets) {
+  ChaCha20Poly1305TlsEncrypter encrypter;
+  ChaCha20Poly1305TlsDecrypter decrypter;
+  const std::string key(32, 'k');
+  ASSERT_TRUE(encrypter.SetKey(key));
+  ASSERT_TRUE(decrypter.SetKey(key));
+  ASSERT_TRUE(encrypter.SetIV("abcdefghijkl"));
+  ASSERT_TRUE(decrypter.SetIV("abcdefghijkl"));
+
+  const std::string associated_data = "associated_data";
+  std::vector<std::string> plaintexts;
+  std::vector<std::string> ciphertexts;
+  for (int i = 0; i < 10; ++i) {
+    plaintexts.push_back(std::string(100 * i + 1, static_cast<char>('a' + i)));
+    char encrypted[1024];
+    size_t length;
+    ASSERT_TRUE(encrypter.EncryptPacket(1000 + i, associated_data,
+                                        plaintexts.back(), encrypted, &length,
+                                        sizeof(encrypted)));
+    ciphertexts.push_back(std::string(encrypted, length));
+  }
+  // A corrupted packet, and one shorter than the tag, do not stop the others.
+  ciphertexts[3][0] ^= 1;
+  ciphertexts[6].resize(4);
+
+  std::vector<std::vector<char>> outputs(ciphertexts.size(),
+                                         std::vector<char>(1024));
+  std::vector<QuicDecrypter::PacketToDecrypt> packets;
+  for (size_t i = 0; i < ciphertexts.size(); ++i) {
+    QuicDecrypter::PacketToDecrypt packet;
+    packet.packet_number = 1000 + i;
+    packet.associated_data = associated_data;
+    packet.ciphertext = ciphertexts[i];
+    packet.output = outputs[i].data();
+    packet.max_output_length = outputs[i].size();
+    packets.push_back(packet);
+  }
+  EXPECT_EQ(8u, decrypter.DecryptPackets(absl::MakeSpan(packets)));
+  for (size_t i = 0; i < packets.size(); ++i) {
+    char expected[1024];
+    size_t expected_length = 0;
+    const bool decrypted = decrypter.DecryptPacket(
+        1000 + i, associated_data, ciphertexts[i], expected, &expected_length,
+        sizeof(expected));
+    EXPECT_EQ(i != 3 && i != 6, decrypted);
+    EXPECT_EQ(decrypted, packets[i].decrypted);
+    if (!decrypted) {
+      continue;
+    }
+    EXPECT_EQ(plaintexts[i], absl::string_view(expected, expected_length));
+    quiche::test::CompareCharArraysWithHexError(
+        "plaintext", outputs[i].data(), packets[i].output_length, expected,
+        expected_length);
+  }
+}
+
 }  // namespace test
 }  // namespace quic
@@ -4,12 +4,15 @@
 
 #include "quiche/quic/core/crypto/chacha20_poly1305_tls_encrypter.h"
 
+#include <cstring>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/chacha20_poly1305_tls_decrypter.h"
 #include "quiche/quic/core/quic_utils.h"
 #include "quiche/quic/platform/api/quic_test.h"
@@ -169,5 +172,81 @@ TEST_F(ChaCha20Poly1305TlsEncrypterTest, GenerateHeaderProtectionMask) {
       expected_mask.size());
 }
 
+TEST_F(ChaCha20Poly1305TlsEncrypterTest, GenerateHeaderProtectionMasks) {
+  ChaCha20Poly1305TlsEncrypter encrypter;
+  std::string key = absl::HexStringToBytes(
+      "6a067f432787bd6034dd3f08f07fc9703a27e58c70e2d88d948b7f6489923cc7");
+  ASSERT_TRUE(encrypter.SetHeaderProtectionKey(key));
+  // More samples than are encrypted in one pass.
+  std::string samples_data;
+  for (int i = 0; i < 100; ++i) {
+    samples_data += absl::HexStringToBytes("1210d91cceb45c716b023f492c29e612");
+    samples_data[samples_data.size() - 1] = static_cast<char>(i);
+  }
+  std::vector<absl::string_view> samples;
+  for (size_t i = 0; i < 100; ++i) {
+    samples.push_back(absl::string_view(samples_data).substr(
+        i * QuicEncrypter::kHeaderProtectionSampleLength,
+        QuicEncrypter::kHeaderProtectionSampleLength));
+  }
+  std::string masks(samples.size() * QuicEncrypter::kHeaderProtectionMaskLength,
+                    0);
+  ASSERT_TRUE(encrypter.GenerateHeaderProtectionMasks(samples, &masks[0]));
+  for (size_t i = 0; i < samples.size(); ++i) {
+    std::string expected_mask =
+        encrypter.GenerateHeaderProtectionMask(samples[i]);
+    quiche::test::CompareCharArraysWithHexError(
+        "header protection mask",
+        masks.data() + i * QuicEncrypter::kHeaderProtectionMaskLength,
+        QuicEncrypter::kHeaderProtectionMaskLength, expected_mask.data(),
+        QuicEncrypter::kHeaderProtectionMaskLength);
+  }
+}
+
+TEST_F(ChaCha20Poly1305TlsEncrypterTest, EncryptPackets) {
+  ChaCha20Poly1305TlsEncrypter encrypter;
+  ASSERT_TRUE(encrypter.SetKey(std::string(32, 'k')));
+  ASSERT_TRUE(encrypter.SetIV("abcdefghijkl"));
+
+  const std::string associated_data = "associated_data";
+  std::vector<std::string> plaintexts;
+  std::vector<std::vector<char>> buffers;
+  for (int i = 0; i < 10; ++i) {
+    plaintexts.push_back(std::string(100 * i + 1, static_cast<char>('a' + i)));
+    buffers.push_back(std::vector<char>(
+        encrypter.GetCiphertextSize(plaintexts.back().size())));
+    memcpy(buffers.back().data(), plaintexts.back().data(),
+           plaintexts.back().size());
+  }
+  // The packets are encrypted in place, as QuicFramer does.
+  std::vector<QuicEncrypter::PacketToEncrypt> packets;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    QuicEncrypter::PacketToEncrypt packet;
+    packet.packet_number = 1000 + i;
+    packet.associated_data = associated_data;
+    packet.plaintext =
+        absl::string_view(buffers[i].data(), plaintexts[i].size());
+    packet.output = buffers[i].data();
+    packet.max_output_length = buffers[i].size();
+    packets.push_back(packet);
+  }
+  ASSERT_TRUE(encrypter.EncryptPackets(absl::MakeSpan(packets)));
+  for (size_t i = 0; i < packets.size(); ++i) {
+    char expected[1024];
+    size_t expected_length;
+    ASSERT_TRUE(encrypter.EncryptPacket(1000 + i, associated_data,
+                                        plaintexts[i], expected,
+                                        &expected_length, sizeof(expected)));
+    EXPECT_EQ(expected_length, packets[i].output_length);
+    quiche::test::CompareCharArraysWithHexError(
+        "ciphertext", buffers[i].data(), packets[i].output_length, expected,
+        expected_length);
+  }
+
+  // A packet without room for the tag fails the batch.
+  packets[5].max_output_length = plaintexts[5].size();
+  EXPECT_FALSE(encrypter.EncryptPackets(absl::MakeSpan(packets)));
+}
+
 }  // namespace test
 }  // namespace quic
@@ -24,21 +24,43 @@ bool ChaChaBaseDecrypter::SetHeaderProtectionKey(absl::string_view key) {
   return true;
 }
 
+namespace {
+
+// Writes the 5 byte header protection mask of the 16 byte |sample| to |out|.
+void GenerateMask(const unsigned char* key, absl::string_view sample,
+                  char* out) {
+  const uint8_t* nonce = reinterpret_cast<const uint8_t*>(sample.data()) + 4;
+  uint32_t counter;
+  QuicDataReader(sample.data(), 4, quiche::HOST_BYTE_ORDER)
+      .ReadUInt32(&counter);
+  const uint8_t zeroes[] = {0, 0, 0, 0, 0};
+  CRYPTO_chacha_20(reinterpret_cast<uint8_t*>(out), zeroes,
+                   ABSL_ARRAYSIZE(zeroes), key, nonce, counter);
+}
+
+}  // namespace
+
 std::string ChaChaBaseDecrypter::GenerateHeaderProtectionMask(
     QuicDataReader* sample_reader) {
   absl::string_view sample;
   if (!sample_reader->ReadStringPiece(&sample, 16)) {
     return std::string();
   }
-  const uint8_t* nonce = reinterpret_cast<const uint8_t*>(sample.data()) + 4;
-  uint32_t counter;
-  QuicDataReader(sample.data(), 4, quiche::HOST_BYTE_ORDER)
-      .ReadUInt32(&counter);
-  const uint8_t zeroes[] = {0, 0, 0, 0, 0};
-  std::string out(ABSL_ARRAYSIZE(zeroes), 0);
-  CRYPTO_chacha_20(reinterpret_cast<uint8_t*>(const_cast<char*>(out.data())),
-                   zeroes, ABSL_ARRAYSIZE(zeroes), pne_key_, nonce, counter);
+  std::string out(kHeaderProtectionMaskLength, 0);
+  GenerateMask(pne_key_, sample, &out[0]);
   return out;
 }
 
+bool ChaChaBaseDecrypter::GenerateHeaderProtectionMasks(
+    absl::Span<const absl::string_view> samples, char* masks) {
+  for (absl::string_view sample : samples) {
+    if (sample.size() != kHeaderProtectionSampleLength) {
+      return false;
+    }
+    GenerateMask(pne_key_, sample, masks);
+    masks += kHeaderProtectionMaskLength;
+  }
+  return true;
+}
+
 }  // namespace quic
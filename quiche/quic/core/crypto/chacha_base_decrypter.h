@@ -8,6 +8,7 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/aead_base_decrypter.h"
 #include "quiche/quic/platform/api/quic_export.h"
 
@@ -20,6 +21,9 @@ class QUIC_EXPORT_PRIVATE ChaChaBaseDecrypter : public AeadBaseDecrypter {
   bool SetHeaderProtectionKey(absl::string_view key) override;
   std::string GenerateHeaderProtectionMask(
       QuicDataReader* sample_reader) override;
+  // Writes each mask in place, without allocating a string per sample.
+  bool GenerateHeaderProtectionMasks(
+      absl::Span<const absl::string_view> samples, char* masks) override;
 
  private:
   // The key used for packet number encryption.
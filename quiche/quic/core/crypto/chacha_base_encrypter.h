@@ -8,6 +8,7 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/aead_base_encrypter.h"
 #include "quiche/quic/platform/api/quic_export.h"
 
@@ -19,6 +20,9 @@ class QUIC_EXPORT_PRIVATE ChaChaBaseEncrypter : public AeadBaseEncrypter {
 
   bool SetHeaderProtectionKey(absl::string_view key) override;
   std::string GenerateHeaderProtectionMask(absl::string_view sample) override;
+  // Writes each mask in place, without allocating a string per sample.
+  bool GenerateHeaderProtectionMasks(
+      absl::Span<const absl::string_view> samples, char* masks) override;
 
  private:
   // The key used for packet number encryption.
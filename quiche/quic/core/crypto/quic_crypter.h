@@ -5,6 +5,8 @@
 #ifndef QUICHE_QUIC_CORE_CRYPTO_QUIC_CRYPTER_H_
 #define QUICHE_QUIC_CORE_CRYPTO_QUIC_CRYPTER_H_
 
+#include <cstddef>
+
 #include "absl/strings/string_view.h"
 #include "quiche/quic/core/quic_versions.h"
 #include "quiche/quic/platform/api/quic_export.h"
@@ -78,6 +80,14 @@ class QUIC_EXPORT_PRIVATE QuicCrypter {
   // Sets the key to use for header protection.
   virtual bool SetHeaderProtectionKey(absl::string_view key) = 0;
 
+  // Length of the ciphertext samples header protection masks are generated
+  // from, for all the ciphers QUIC uses.
+  static constexpr size_t kHeaderProtectionSampleLength = 16;
+  // Length of the masks written by the batched GenerateHeaderProtectionMasks()
+  // of encrypters and decrypters, which covers the first byte of the header and
+  // the longest packet number.
+  static constexpr size_t kHeaderProtectionMaskLength = 5;
+
   // GetKeySize, GetIVSize, and GetNoncePrefixSize are used to know how many
   // bytes of key material needs to be derived from the master secret.
 
@@ -4,6 +4,7 @@
 
 #include "quiche/quic/core/crypto/quic_decrypter.h"
 
+#include <cstring>
 #include <string>
 #include <utility>
 
@@ -60,6 +61,33 @@ std::unique_ptr<QuicDecrypter> QuicDecrypter::CreateFromCipherSuite(
   }
 }
 
+bool QuicDecrypter::GenerateHeaderProtectionMasks(
+    absl::Span<const absl::string_view> samples, char* masks) {
+  for (absl::string_view sample : samples) {
+    QuicDataReader sample_reader(sample);
+    const std::string mask = GenerateHeaderProtectionMask(&sample_reader);
+    if (mask.size() < kHeaderProtectionMaskLength) {
+      return false;
+    }
+    memcpy(masks, mask.data(), kHeaderProtectionMaskLength);
+    masks += kHeaderProtectionMaskLength;
+  }
+  return true;
+}
+
+size_t QuicDecrypter::DecryptPackets(absl::Span<PacketToDecrypt> packets) {
+  size_t num_decrypted = 0;
+  for (PacketToDecrypt& packet : packets) {
+    packet.decrypted = DecryptPacket(
+        packet.packet_number, packet.associated_data, packet.ciphertext,
+        packet.output, &packet.output_length, packet.max_output_length);
+    if (packet.decrypted) {
+      ++num_decrypted;
+    }
+  }
+  return num_decrypted;
+}
+
 // static
 void QuicDecrypter::DiversifyPreliminaryKey(absl::string_view preliminary_key,
                                             absl::string_view nonce_prefix,
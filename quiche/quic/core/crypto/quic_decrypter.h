@@ -11,6 +11,7 @@
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/quic_crypter.h"
 #include "quiche/quic/core/quic_data_reader.h"
 #include "quiche/quic/core/quic_packets.h"
@@ -61,6 +62,25 @@ class QUIC_EXPORT_PRIVATE QuicDecrypter : public QuicCrypter {
                              size_t* output_length,
                              size_t max_output_length) = 0;
 
+  // A packet to decrypt with DecryptPackets(), with the arguments of
+  // DecryptPacket().
+  struct QUIC_EXPORT_PRIVATE PacketToDecrypt {
+    uint64_t packet_number;
+    absl::string_view associated_data;
+    absl::string_view ciphertext;
+    char* output;
+    size_t max_output_length;
+    // Set by DecryptPackets(). |output_length| is only valid if |decrypted|.
+    size_t output_length = 0;
+    bool decrypted = false;
+  };
+
+  // Decrypts each of |packets| as DecryptPacket() would, one after the other,
+  // and returns how many were decrypted. A packet which fails to decrypt does
+  // not stop the others. The default implementation calls DecryptPacket() for
+  // each packet.
+  virtual size_t DecryptPackets(absl::Span<PacketToDecrypt> packets);
+
   // Reads a sample of ciphertext from |sample_reader| and uses the header
   // protection key to generate a mask to use for header protection. If
   // successful, this function returns this mask, which is at least 5 bytes
@@ -68,6 +88,15 @@ class QUIC_EXPORT_PRIVATE QuicDecrypter : public QuicCrypter {
   virtual std::string GenerateHeaderProtectionMask(
       QuicDataReader* sample_reader) = 0;
 
+  // Generates the header protection masks of several packets at once, from
+  // |samples| which are kHeaderProtectionSampleLength bytes each, and writes
+  // kHeaderProtectionMaskLength bytes per sample to |masks|. Each mask starts
+  // like the one GenerateHeaderProtectionMask() returns for the same sample.
+  // Returns false on failure. The default implementation generates the masks
+  // one at a time.
+  virtual bool GenerateHeaderProtectionMasks(
+      absl::Span<const absl::string_view> samples, char* masks);
+
   // The ID of the cipher. Return 0x03000000 ORed with the 'cryptographic suite
   // selector'.
   virtual uint32_t cipher_id() const = 0;
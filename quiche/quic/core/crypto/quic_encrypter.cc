@@ -4,6 +4,7 @@
 
 #include "quiche/quic/core/crypto/quic_encrypter.h"
 
+#include <cstring>
 #include <utility>
 
 #include "openssl/tls1.h"
@@ -57,4 +58,28 @@ std::unique_ptr<QuicEncrypter> QuicEncrypter::CreateFromCipherSuite(
   }
 }
 
+bool QuicEncrypter::GenerateHeaderProtectionMasks(
+    absl::Span<const absl::string_view> samples, char* masks) {
+  for (absl::string_view sample : samples) {
+    const std::string mask = GenerateHeaderProtectionMask(sample);
+    if (mask.size() < kHeaderProtectionMaskLength) {
+      return false;
+    }
+    memcpy(masks, mask.data(), kHeaderProtectionMaskLength);
+    masks += kHeaderProtectionMaskLength;
+  }
+  return true;
+}
+
+bool QuicEncrypter::EncryptPackets(absl::Span<PacketToEncrypt> packets) {
+  for (PacketToEncrypt& packet : packets) {
+    if (!EncryptPacket(packet.packet_number, packet.associated_data,
+                       packet.plaintext, packet.output, &packet.output_length,
+                       packet.max_output_length)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace quic
@@ -9,6 +9,7 @@
 #include <memory>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/quic_crypter.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/platform/api/quic_export.h"
@@ -41,6 +42,23 @@ class QUIC_EXPORT_PRIVATE QuicEncrypter : public QuicCrypter {
                              size_t* output_length,
                              size_t max_output_length) = 0;
 
+  // A packet to encrypt with EncryptPackets(), with the arguments of
+  // EncryptPacket().
+  struct QUIC_EXPORT_PRIVATE PacketToEncrypt {
+    uint64_t packet_number;
+    absl::string_view associated_data;
+    absl::string_view plaintext;
+    char* output;
+    size_t max_output_length;
+    // Set by EncryptPackets().
+    size_t output_length = 0;
+  };
+
+  // Encrypts each of |packets| as EncryptPacket() would, one after the other.
+  // Returns false as soon as one fails. The default implementation calls
+  // EncryptPacket() for each packet.
+  virtual bool EncryptPackets(absl::Span<PacketToEncrypt> packets);
+
   // Takes a |sample| of ciphertext and uses the header protection key to
   // generate a mask to use for header protection, and returns that mask. On
   // success, the mask will be at least 5 bytes long; on failure the string will
@@ -48,6 +66,15 @@ class QUIC_EXPORT_PRIVATE QuicEncrypter : public QuicCrypter {
   virtual std::string GenerateHeaderProtectionMask(
       absl::string_view sample) = 0;
 
+  // Generates the header protection masks of several packets at once, from
+  // |samples| which are kHeaderProtectionSampleLength bytes each, and writes
+  // kHeaderProtectionMaskLength bytes per sample to |masks|. Each mask starts
+  // like the one GenerateHeaderProtectionMask() returns for the same sample.
+  // Returns false on failure. The default implementation generates the masks
+  // one at a time.
+  virtual bool GenerateHeaderProtectionMasks(
+      absl::Span<const absl::string_view> samples, char* masks);
+
   // Returns the maximum length of plaintext that can be encrypted
   // to ciphertext no larger than |ciphertext_size|.
   virtual size_t GetMaxPlaintextSize(size_t ciphertext_size) const = 0;
@@ -514,7 +514,7 @@ std::ostream& operator<<(std::ostream& os, const QuicFrame& frame) {
   return os;
 }
 
-std::string QuicFramesToString(const QuicFrames& frames) {
+std::string QuicFramesToString(absl::Span<const QuicFrame> frames) {
   std::ostringstream os;
   for (const QuicFrame& frame : frames) {
     os << frame;
@@ -0,0 +1,94 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures QpackEncoder and QpackDecoder on a typical browser request header
+// list, with the dynamic table disabled as is the default for HTTP/3.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/qpack/qpack_decoder.h"
+#include "quiche/quic/core/qpack/qpack_encoder.h"
+#include "quiche/quic/core/qpack/qpack_progressive_decoder.h"
+#include "quiche/quic/test_tools/qpack/qpack_decoder_test_utils.h"
+#include "quiche/quic/test_tools/qpack/qpack_encoder_test_utils.h"
+#include "quiche/quic/test_tools/qpack/qpack_test_utils.h"
+#include "quiche/spdy/core/spdy_header_block.h"
+
+namespace quic {
+namespace {
+
+using test::NoopDecoderStreamErrorDelegate;
+using test::NoopEncoderStreamErrorDelegate;
+using test::NoOpHeadersHandler;
+using test::NoopQpackStreamSenderDelegate;
+
+spdy::Http2HeaderBlock RequestHeaders() {
+  spdy::Http2HeaderBlock headers;
+  headers[":method"] = "GET";
+  headers[":scheme"] = "https";
+  headers[":authority"] = "www.example.com";
+  headers[":path"] = "/static/js/main.4f1c2a9b.chunk.js";
+  headers["user-agent"] =
+      "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+      "Chrome/104.0.0.0 Safari/537.36";
+  headers["accept"] = "*/*";
+  headers["accept-encoding"] = "gzip, deflate, br";
+  headers["accept-language"] = "en-US,en;q=0.9";
+  headers["referer"] = "https://www.example.com/";
+  headers["cookie"] = "session=0123456789abcdef0123456789abcdef; theme=dark";
+  return headers;
+}
+
+void BM_QpackEncode(benchmark::State& state) {
+  const spdy::Http2HeaderBlock headers = RequestHeaders();
+  NoopDecoderStreamErrorDelegate decoder_stream_error_delegate;
+  NoopQpackStreamSenderDelegate encoder_stream_sender_delegate;
+  QpackEncoder encoder(&decoder_stream_error_delegate);
+  encoder.set_qpack_stream_sender_delegate(&encoder_stream_sender_delegate);
+  QuicStreamId stream_id = 0;
+  size_t encoded_bytes = 0;
+  for (auto _ : state) {
+    const std::string encoded = encoder.EncodeHeaderList(
+        stream_id, headers, /*encoder_stream_sent_byte_count=*/nullptr);
+    encoded_bytes += encoded.size();
+    stream_id += 4;
+  }
+  state.SetBytesProcessed(encoded_bytes);
+}
+BENCHMARK(BM_QpackEncode);
+
+void BM_QpackDecode(benchmark::State& state) {
+  NoopDecoderStreamErrorDelegate decoder_stream_error_delegate;
+  NoopQpackStreamSenderDelegate encoder_stream_sender_delegate;
+  QpackEncoder encoder(&decoder_stream_error_delegate);
+  encoder.set_qpack_stream_sender_delegate(&encoder_stream_sender_delegate);
+  const std::string encoded =
+      encoder.EncodeHeaderList(/*stream_id=*/0, RequestHeaders(),
+                               /*encoder_stream_sent_byte_count=*/nullptr);
+
+  NoopEncoderStreamErrorDelegate encoder_stream_error_delegate;
+  NoopQpackStreamSenderDelegate decoder_stream_sender_delegate;
+  QpackDecoder decoder(/*maximum_dynamic_table_capacity=*/0,
+                       /*maximum_blocked_streams=*/0,
+                       &encoder_stream_error_delegate);
+  decoder.set_qpack_stream_sender_delegate(&decoder_stream_sender_delegate);
+  NoOpHeadersHandler handler;
+  QuicStreamId stream_id = 0;
+  for (auto _ : state) {
+    std::unique_ptr<QpackProgressiveDecoder> progressive_decoder =
+        decoder.CreateProgressiveDecoder(stream_id, &handler);
+    progressive_decoder->Decode(encoded);
+    progressive_decoder->EndHeaderBlock();
+    stream_id += 4;
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_QpackDecode);
+
+}  // namespace
+}  // namespace quic
+
+BENCHMARK_MAIN();
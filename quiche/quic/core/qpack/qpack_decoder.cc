@@ -97,7 +97,7 @@ void QpackDecoder::OnInsertWithNameReference(bool is_static,
     return;
   }
 
-  const QpackEntry* entry =
+  auto entry =
       header_table_.LookupEntry(/* is_static = */ false, absolute_index);
   if (!entry) {
     OnErrorDetected(QUIC_QPACK_ENCODER_STREAM_INSERTION_DYNAMIC_ENTRY_NOT_FOUND,
@@ -131,7 +131,7 @@ void QpackDecoder::OnDuplicate(uint64_t index) {
     return;
   }
 
-  const QpackEntry* entry =
+  auto entry =
       header_table_.LookupEntry(/* is_static = */ false, absolute_index);
   if (!entry) {
     OnErrorDetected(QUIC_QPACK_ENCODER_STREAM_DUPLICATE_DYNAMIC_ENTRY_NOT_FOUND,
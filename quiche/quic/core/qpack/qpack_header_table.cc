@@ -5,52 +5,71 @@
 #include "quiche/quic/core/qpack/qpack_header_table.h"
 
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "quiche/quic/core/qpack/qpack_static_table.h"
 #include "quiche/quic/platform/api/quic_logging.h"
 #include "quiche/common/platform/api/quiche_logging.h"
 
 namespace quic {
 
-QpackEncoderHeaderTable::QpackEncoderHeaderTable()
-    : static_index_(ObtainQpackStaticTable().GetStaticIndex()),
-      static_name_index_(ObtainQpackStaticTable().GetStaticNameIndex()) {}
+QpackHeaderTableBase::QpackHeaderTableBase()
+    : dynamic_table_capacity_(0),
+      maximum_dynamic_table_capacity_(0),
+      max_entries_(0),
+      dynamic_table_entry_referenced_(false) {}
 
-uint64_t QpackEncoderHeaderTable::InsertEntry(absl::string_view name,
-                                              absl::string_view value) {
-  const uint64_t index =
-      QpackHeaderTableBase<QpackEncoderDynamicTable>::InsertEntry(name, value);
-
-  // Make name and value point to the new entry.
-  name = dynamic_entries().back()->name();
-  value = dynamic_entries().back()->value();
-
-  auto index_result = dynamic_index_.insert(
-      std::make_pair(QpackLookupEntry{name, value}, index));
-  if (!index_result.second) {
-    // An entry with the same name and value already exists.  It needs to be
-    // replaced, because |dynamic_index_| tracks the most recent entry for a
-    // given name and value.
-    QUICHE_DCHECK_GT(index, index_result.first->second);
-    dynamic_index_.erase(index_result.first);
-    auto result = dynamic_index_.insert(
-        std::make_pair(QpackLookupEntry{name, value}, index));
-    QUICHE_CHECK(result.second);
-  }
-
-  auto name_result = dynamic_name_index_.insert({name, index});
-  if (!name_result.second) {
-    // An entry with the same name already exists.  It needs to be replaced,
-    // because |dynamic_name_index_| tracks the most recent entry for a given
-    // name.
-    QUICHE_DCHECK_GT(index, name_result.first->second);
-    dynamic_name_index_.erase(name_result.first);
-    auto result = dynamic_name_index_.insert({name, index});
-    QUICHE_CHECK(result.second);
+bool QpackHeaderTableBase::EntryFitsDynamicTableCapacity(
+    absl::string_view name, absl::string_view value) const {
+  return QpackEntry::Size(name, value) <= dynamic_table_capacity_;
+}
+
+uint64_t QpackHeaderTableBase::InsertEntry(absl::string_view name,
+                                           absl::string_view value) {
+  QUICHE_DCHECK(EntryFitsDynamicTableCapacity(name, value));
+
+  // Evicted entries stay in the arena until the new entry is copied, so |name|
+  // and |value| may point to them.
+  EvictDownToCapacity(dynamic_table_capacity_ - QpackEntry::Size(name, value));
+
+  return dynamic_entries_.Insert(name, value);
+}
+
+bool QpackHeaderTableBase::SetDynamicTableCapacity(uint64_t capacity) {
+  if (capacity > maximum_dynamic_table_capacity_) {
+    return false;
   }
 
-  return index;
+  dynamic_table_capacity_ = capacity;
+  EvictDownToCapacity(capacity);
+  dynamic_entries_.SetCapacity(capacity);
+
+  QUICHE_DCHECK_LE(dynamic_table_size(), dynamic_table_capacity_);
+
+  return true;
+}
+
+bool QpackHeaderTableBase::SetMaximumDynamicTableCapacity(
+    uint64_t maximum_dynamic_table_capacity) {
+  if (maximum_dynamic_table_capacity_ == 0) {
+    maximum_dynamic_table_capacity_ = maximum_dynamic_table_capacity;
+    max_entries_ = maximum_dynamic_table_capacity / 32;
+    return true;
+  }
+  // If the value is already set, it should not be changed.
+  return maximum_dynamic_table_capacity == maximum_dynamic_table_capacity_;
 }
 
+void QpackHeaderTableBase::EvictDownToCapacity(uint64_t capacity) {
+  while (dynamic_table_size() > capacity) {
+    QUICHE_DCHECK(!dynamic_entries_.empty());
+    dynamic_entries_.EvictOldest();
+  }
+}
+
+QpackEncoderHeaderTable::QpackEncoderHeaderTable()
+    : static_index_(ObtainQpackStaticTable().GetStaticIndex()),
+      static_name_index_(ObtainQpackStaticTable().GetStaticNameIndex()) {}
+
 QpackEncoderHeaderTable::MatchType QpackEncoderHeaderTable::FindHeaderField(
     absl::string_view name, absl::string_view value, bool* is_static,
     uint64_t* index) const {
@@ -65,9 +84,10 @@ QpackEncoderHeaderTable::MatchType QpackEncoderHeaderTable::FindHeaderField(
   }
 
   // Look for exact match in dynamic table.
-  index_it = dynamic_index_.find(query);
-  if (index_it != dynamic_index_.end()) {
-    *index = index_it->second;
+  absl::optional<uint64_t> dynamic_index =
+      dynamic_entries().FindNameAndValue(name, value);
+  if (dynamic_index.has_value()) {
+    *index = *dynamic_index;
     *is_static = false;
     return MatchType::kNameAndValue;
   }
@@ -81,9 +101,9 @@ QpackEncoderHeaderTable::MatchType QpackEncoderHeaderTable::FindHeaderField(
   }
 
   // Look for name match in dynamic table.
-  name_index_it = dynamic_name_index_.find(name);
-  if (name_index_it != dynamic_name_index_.end()) {
-    *index = name_index_it->second;
+  dynamic_index = dynamic_entries().FindName(name);
+  if (dynamic_index.has_value()) {
+    *index = *dynamic_index;
     *is_static = false;
     return MatchType::kName;
   }
@@ -103,13 +123,9 @@ uint64_t QpackEncoderHeaderTable::MaxInsertSizeWithoutEvictingGivenEntry(
   // Initialize to current available capacity.
   uint64_t max_insert_size = dynamic_table_capacity() - dynamic_table_size();
 
-  uint64_t entry_index = dropped_entry_count();
-  for (const auto& entry : dynamic_entries()) {
-    if (entry_index >= index) {
-      break;
-    }
-    ++entry_index;
-    max_insert_size += entry->Size();
+  for (uint64_t entry_index = dropped_entry_count(); entry_index < index;
+       ++entry_index) {
+    max_insert_size += dynamic_entries().Get(entry_index).Size();
   }
 
   return max_insert_size;
@@ -129,13 +145,11 @@ uint64_t QpackEncoderHeaderTable::draining_index(
     return dropped_entry_count();
   }
 
-  auto it = dynamic_entries().begin();
   uint64_t entry_index = dropped_entry_count();
   while (space_above_draining_index < required_space) {
-    space_above_draining_index += (*it)->Size();
-    ++it;
+    space_above_draining_index += dynamic_entries().Get(entry_index).Size();
     ++entry_index;
-    if (it == dynamic_entries().end()) {
+    if (entry_index == inserted_entry_count()) {
       return inserted_entry_count();
     }
   }
@@ -143,27 +157,6 @@ uint64_t QpackEncoderHeaderTable::draining_index(
   return entry_index;
 }
 
-void QpackEncoderHeaderTable::RemoveEntryFromEnd() {
-  const QpackEntry* const entry = dynamic_entries().front().get();
-  const uint64_t index = dropped_entry_count();
-
-  auto index_it = dynamic_index_.find({entry->name(), entry->value()});
-  // Remove |dynamic_index_| entry only if it points to the same
-  // QpackEntry in dynamic_entries().
-  if (index_it != dynamic_index_.end() && index_it->second == index) {
-    dynamic_index_.erase(index_it);
-  }
-
-  auto name_it = dynamic_name_index_.find(entry->name());
-  // Remove |dynamic_name_index_| entry only if it points to the same
-  // QpackEntry in dynamic_entries().
-  if (name_it != dynamic_name_index_.end() && name_it->second == index) {
-    dynamic_name_index_.erase(name_it);
-  }
-
-  QpackHeaderTableBase<QpackEncoderDynamicTable>::RemoveEntryFromEnd();
-}
-
 QpackDecoderHeaderTable::QpackDecoderHeaderTable()
     : static_entries_(ObtainQpackStaticTable().GetStaticEntries()) {}
 
@@ -176,7 +169,7 @@ QpackDecoderHeaderTable::~QpackDecoderHeaderTable() {
 uint64_t QpackDecoderHeaderTable::InsertEntry(absl::string_view name,
                                               absl::string_view value) {
   const uint64_t index =
-      QpackHeaderTableBase<QpackDecoderDynamicTable>::InsertEntry(name, value);
+      QpackHeaderTableBase::InsertEntry(name, value);
 
   // Notify and deregister observers whose threshold is met, if any.
   while (!observers_.empty()) {
@@ -192,27 +185,22 @@ uint64_t QpackDecoderHeaderTable::InsertEntry(absl::string_view name,
   return index;
 }
 
-const QpackEntry* QpackDecoderHeaderTable::LookupEntry(bool is_static,
-                                                       uint64_t index) const {
+absl::optional<quiche::QuicheHeaderTableEntry>
+QpackDecoderHeaderTable::LookupEntry(bool is_static, uint64_t index) const {
   if (is_static) {
     if (index >= static_entries_.size()) {
-      return nullptr;
+      return absl::nullopt;
     }
 
-    return &static_entries_[index];
+    const QpackEntry& entry = static_entries_[index];
+    return quiche::QuicheHeaderTableEntry(entry.name(), entry.value());
   }
 
-  if (index < dropped_entry_count()) {
-    return nullptr;
-  }
-
-  index -= dropped_entry_count();
-
-  if (index >= dynamic_entries().size()) {
-    return nullptr;
+  if (index < dropped_entry_count() || index >= inserted_entry_count()) {
+    return absl::nullopt;
   }
 
-  return &dynamic_entries()[index];
+  return dynamic_entries().Get(index);
 }
 
 void QpackDecoderHeaderTable::RegisterObserver(uint64_t required_insert_count,
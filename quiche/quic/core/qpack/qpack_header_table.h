@@ -6,11 +6,12 @@
 #define QUICHE_QUIC_CORE_QPACK_QPACK_HEADER_TABLE_H_
 
 #include <cstdint>
-#include <deque>
+#include <map>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "quiche/quic/platform/api/quic_export.h"
-#include "quiche/common/quiche_circular_deque.h"
+#include "quiche/common/quiche_dynamic_header_table.h"
 #include "quiche/spdy/core/hpack/hpack_entry.h"
 #include "quiche/spdy/core/hpack/hpack_header_table.h"
 
@@ -20,20 +21,14 @@ using QpackEntry = spdy::HpackEntry;
 using QpackLookupEntry = spdy::HpackLookupEntry;
 constexpr size_t kQpackEntrySizeOverhead = spdy::kHpackEntrySizeOverhead;
 
-// Encoder needs pointer stability for |dynamic_index_| and
-// |dynamic_name_index_|.  However, it does not need random access.
-using QpackEncoderDynamicTable =
-    quiche::QuicheCircularDeque<std::unique_ptr<QpackEntry>>;
-
-// Decoder needs random access for LookupEntry().
-// However, it does not need pointer stability.
-using QpackDecoderDynamicTable = quiche::QuicheCircularDeque<QpackEntry>;
+// Both encoder and decoder store dynamic table entries contiguously in a
+// circular byte arena, see QuicheDynamicHeaderTable.
+using QpackDynamicEntryTable = quiche::QuicheDynamicHeaderTable;
 
 // This is a base class for encoder and decoder classes that manage the QPACK
 // static and dynamic tables.  For dynamic entries, it only has a concept of
 // absolute indices.  The caller needs to perform the necessary transformations
 // to and from relative indices and post-base indices.
-template <typename DynamicEntryTable>
 class QUIC_EXPORT_PRIVATE QpackHeaderTableBase {
  public:
   QpackHeaderTableBase();
@@ -49,11 +44,9 @@ class QUIC_EXPORT_PRIVATE QpackHeaderTableBase {
                                      absl::string_view value) const;
 
   // Inserts (name, value) into the dynamic table.  Entry must not be larger
-  // than the capacity of the dynamic table.  May evict entries.  |name| and
-  // |value| are copied first, therefore it is safe for them to point to an
-  // entry in the dynamic table, even if it is about to be evicted, or even if
-  // the underlying container might move entries around when resizing for
-  // insertion.
+  // than the capacity of the dynamic table.  May evict entries.  It is safe for
+  // |name| and |value| to point to an entry in the dynamic table, even if it is
+  // about to be evicted.
   // Returns the absolute index of the inserted dynamic table entry.
   virtual uint64_t InsertEntry(absl::string_view name, absl::string_view value);
 
@@ -72,7 +65,10 @@ class QUIC_EXPORT_PRIVATE QpackHeaderTableBase {
   // returning false.
   bool SetMaximumDynamicTableCapacity(uint64_t maximum_dynamic_table_capacity);
 
-  uint64_t dynamic_table_size() const { return dynamic_table_size_; }
+  // Size of the dynamic table.  This is the sum of the size of its entries.
+  uint64_t dynamic_table_size() const {
+    return dynamic_entries_.entries_size();
+  }
   uint64_t dynamic_table_capacity() const { return dynamic_table_capacity_; }
   uint64_t maximum_dynamic_table_capacity() const {
     return maximum_dynamic_table_capacity_;
@@ -82,11 +78,13 @@ class QUIC_EXPORT_PRIVATE QpackHeaderTableBase {
   // The number of entries inserted to the dynamic table (including ones that
   // were dropped since).  Used for relative indexing on the encoder stream.
   uint64_t inserted_entry_count() const {
-    return dynamic_entries_.size() + dropped_entry_count_;
+    return dynamic_entries_.inserted_entry_count();
   }
 
   // The number of entries dropped from the dynamic table.
-  uint64_t dropped_entry_count() const { return dropped_entry_count_; }
+  uint64_t dropped_entry_count() const {
+    return dynamic_entries_.evicted_entry_count();
+  }
 
   void set_dynamic_table_entry_referenced() {
     dynamic_table_entry_referenced_ = true;
@@ -96,25 +94,21 @@ class QUIC_EXPORT_PRIVATE QpackHeaderTableBase {
   }
 
  protected:
-  // Removes a single entry from the end of the dynamic table, updates
-  // |dynamic_table_size_| and |dropped_entry_count_|.
-  virtual void RemoveEntryFromEnd();
-
-  const DynamicEntryTable& dynamic_entries() const { return dynamic_entries_; }
+  const QpackDynamicEntryTable& dynamic_entries() const {
+    return dynamic_entries_;
+  }
 
  private:
   // Evict entries from the dynamic table until table size is less than or equal
   // to |capacity|.
   void EvictDownToCapacity(uint64_t capacity);
 
-  // Dynamic Table entries.
-  DynamicEntryTable dynamic_entries_;
-
-  // Size of the dynamic table.  This is the sum of the size of its entries.
-  uint64_t dynamic_table_size_;
+  // Dynamic Table entries.  Also tracks the dynamic table size and the number
+  // of inserted and dropped entries.
+  QpackDynamicEntryTable dynamic_entries_;
 
   // Dynamic Table Capacity is the maximum allowed value of
-  // |dynamic_table_size_|.  Entries are evicted if necessary before inserting a
+  // dynamic_table_size().  Entries are evicted if necessary before inserting a
   // new entry to ensure that dynamic table size never exceeds capacity.
   // Initial value is |maximum_dynamic_table_capacity_|.  Capacity can be
   // changed by the encoder, as long as it does not exceed
@@ -130,120 +124,13 @@ class QUIC_EXPORT_PRIVATE QpackHeaderTableBase {
   // decode Required Insert Count.
   uint64_t max_entries_;
 
-  // The number of entries dropped from the dynamic table.
-  uint64_t dropped_entry_count_;
-
   // True if any dynamic table entries have been referenced from a header block.
   // Set directly by the encoder or decoder.  Used for stats.
   bool dynamic_table_entry_referenced_;
 };
 
-template <typename DynamicEntryTable>
-QpackHeaderTableBase<DynamicEntryTable>::QpackHeaderTableBase()
-    : dynamic_table_size_(0),
-      dynamic_table_capacity_(0),
-      maximum_dynamic_table_capacity_(0),
-      max_entries_(0),
-      dropped_entry_count_(0),
-      dynamic_table_entry_referenced_(false) {}
-
-template <typename DynamicEntryTable>
-bool QpackHeaderTableBase<DynamicEntryTable>::EntryFitsDynamicTableCapacity(
-    absl::string_view name, absl::string_view value) const {
-  return QpackEntry::Size(name, value) <= dynamic_table_capacity_;
-}
-
-namespace internal {
-
-QUIC_NO_EXPORT inline size_t GetSize(const QpackEntry& entry) {
-  return entry.Size();
-}
-
-QUIC_NO_EXPORT inline size_t GetSize(const std::unique_ptr<QpackEntry>& entry) {
-  return entry->Size();
-}
-
-QUIC_NO_EXPORT inline std::unique_ptr<QpackEntry> NewEntry(
-    std::string name, std::string value, QpackEncoderDynamicTable& /*t*/) {
-  return std::make_unique<QpackEntry>(std::move(name), std::move(value));
-}
-
-QUIC_NO_EXPORT inline QpackEntry NewEntry(std::string name, std::string value,
-                                          QpackDecoderDynamicTable& /*t*/) {
-  return QpackEntry{std::move(name), std::move(value)};
-}
-
-}  // namespace internal
-
-template <typename DynamicEntryTable>
-uint64_t QpackHeaderTableBase<DynamicEntryTable>::InsertEntry(
-    absl::string_view name, absl::string_view value) {
-  QUICHE_DCHECK(EntryFitsDynamicTableCapacity(name, value));
-
-  const uint64_t index = dropped_entry_count_ + dynamic_entries_.size();
-
-  // Copy name and value before modifying the container, because evicting
-  // entries or even inserting a new one might invalidate |name| or |value| if
-  // they point to an entry.
-  auto new_entry = internal::NewEntry(std::string(name), std::string(value),
-                                      dynamic_entries_);
-  const size_t entry_size = internal::GetSize(new_entry);
-  EvictDownToCapacity(dynamic_table_capacity_ - entry_size);
-
-  dynamic_table_size_ += entry_size;
-  dynamic_entries_.push_back(std::move(new_entry));
-
-  return index;
-}
-
-template <typename DynamicEntryTable>
-bool QpackHeaderTableBase<DynamicEntryTable>::SetDynamicTableCapacity(
-    uint64_t capacity) {
-  if (capacity > maximum_dynamic_table_capacity_) {
-    return false;
-  }
-
-  dynamic_table_capacity_ = capacity;
-  EvictDownToCapacity(capacity);
-
-  QUICHE_DCHECK_LE(dynamic_table_size_, dynamic_table_capacity_);
-
-  return true;
-}
-
-template <typename DynamicEntryTable>
-bool QpackHeaderTableBase<DynamicEntryTable>::SetMaximumDynamicTableCapacity(
-    uint64_t maximum_dynamic_table_capacity) {
-  if (maximum_dynamic_table_capacity_ == 0) {
-    maximum_dynamic_table_capacity_ = maximum_dynamic_table_capacity;
-    max_entries_ = maximum_dynamic_table_capacity / 32;
-    return true;
-  }
-  // If the value is already set, it should not be changed.
-  return maximum_dynamic_table_capacity == maximum_dynamic_table_capacity_;
-}
-
-template <typename DynamicEntryTable>
-void QpackHeaderTableBase<DynamicEntryTable>::RemoveEntryFromEnd() {
-  const uint64_t entry_size = internal::GetSize(dynamic_entries_.front());
-  QUICHE_DCHECK_GE(dynamic_table_size_, entry_size);
-  dynamic_table_size_ -= entry_size;
-
-  dynamic_entries_.pop_front();
-  ++dropped_entry_count_;
-}
-
-template <typename DynamicEntryTable>
-void QpackHeaderTableBase<DynamicEntryTable>::EvictDownToCapacity(
-    uint64_t capacity) {
-  while (dynamic_table_size_ > capacity) {
-    QUICHE_DCHECK(!dynamic_entries_.empty());
-    RemoveEntryFromEnd();
-  }
-}
-
 class QUIC_EXPORT_PRIVATE QpackEncoderHeaderTable
-    : public QpackHeaderTableBase<QpackEncoderDynamicTable> {
+    : public QpackHeaderTableBase {
  public:
   // Result of header table lookup.
   enum class MatchType { kNameAndValue, kName, kNoMatch };
@@ -251,9 +138,6 @@ class QUIC_EXPORT_PRIVATE QpackEncoderHeaderTable
   QpackEncoderHeaderTable();
   ~QpackEncoderHeaderTable() override = default;
 
-  uint64_t InsertEntry(absl::string_view name,
-                       absl::string_view value) override;
-
   // Returns the absolute index of an entry with matching name and value if such
   // exists, otherwise one with matching name is such exists.  |index| is zero
   // based for both the static and the dynamic table.
@@ -274,9 +158,6 @@ class QUIC_EXPORT_PRIVATE QpackEncoderHeaderTable
   // The returned index might not be the index of a valid entry.
   uint64_t draining_index(float draining_fraction) const;
 
- protected:
-  void RemoveEntryFromEnd() override;
-
  private:
   using NameValueToEntryMap = spdy::HpackHeaderTable::NameValueToEntryMap;
   using NameToEntryMap = spdy::HpackHeaderTable::NameToEntryMap;
@@ -292,23 +173,12 @@ class QUIC_EXPORT_PRIVATE QpackEncoderHeaderTable
   // Tracks the first static entry for a given header name.
   const NameToEntryMap& static_name_index_;
 
-  // Dynamic Table
-
-  // An unordered set of QpackEntry pointers with a comparison operator that
-  // only cares about name and value.  This allows fast lookup of the most
-  // recently inserted dynamic entry for a given header name and value pair.
-  // Entries point to entries owned by |QpackHeaderTableBase::dynamic_entries_|.
-  NameValueToEntryMap dynamic_index_;
-
-  // An unordered map of QpackEntry pointers keyed off header name.  This allows
-  // fast lookup of the most recently inserted dynamic entry for a given header
-  // name.  Entries point to entries owned by
+  // Dynamic table lookups go through the indexes of
   // |QpackHeaderTableBase::dynamic_entries_|.
-  NameToEntryMap dynamic_name_index_;
 };
 
 class QUIC_EXPORT_PRIVATE QpackDecoderHeaderTable
-    : public QpackHeaderTableBase<QpackDecoderDynamicTable> {
+    : public QpackHeaderTableBase {
  public:
   // Observer interface for dynamic table insertion.
   class QUIC_EXPORT_PRIVATE Observer {
@@ -333,10 +203,11 @@ class QUIC_EXPORT_PRIVATE QpackDecoderHeaderTable
 
   // Returns the entry at absolute index |index| from the static or dynamic
   // table according to |is_static|.  |index| is zero based for both the static
-  // and the dynamic table.  The returned pointer is valid until the entry is
-  // evicted, even if other entries are inserted into the dynamic table.
-  // Returns nullptr if entry does not exist.
-  const QpackEntry* LookupEntry(bool is_static, uint64_t index) const;
+  // and the dynamic table.  The returned name and value of a dynamic entry are
+  // valid until the next insertion into the dynamic table.  Returns
+  // absl::nullopt if entry does not exist.
+  absl::optional<quiche::QuicheHeaderTableEntry> LookupEntry(
+      bool is_static, uint64_t index) const;
 
   // Register an observer to be notified when inserted_entry_count() reaches
   // |required_insert_count|.  After the notification, |observer| automatically
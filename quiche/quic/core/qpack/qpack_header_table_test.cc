@@ -411,7 +411,7 @@ class QpackDecoderHeaderTableTest
   void ExpectEntryAtIndex(bool is_static, uint64_t index,
                           absl::string_view expected_name,
                           absl::string_view expected_value) const {
-    const auto* entry = table_.LookupEntry(is_static, index);
+    auto entry = table_.LookupEntry(is_static, index);
     ASSERT_TRUE(entry);
     EXPECT_EQ(expected_name, entry->name());
     EXPECT_EQ(expected_value, entry->value());
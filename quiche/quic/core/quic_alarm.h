@@ -12,6 +12,10 @@
 
 namespace quic {
 
+namespace test {
+class QuicAlarmPeer;
+}  // namespace test
+
 // Abstract class which represents an alarm which will go off at a
 // scheduled time, and execute the |OnAlarm| method of the delegate.
 // An alarm may be cancelled, in which case it may or may not be
@@ -114,6 +118,8 @@ class QUIC_EXPORT_PRIVATE QuicAlarm {
   void Fire();
 
  private:
+  friend class test::QuicAlarmPeer;
+
   void CancelInternal(bool permanent);
 
   QuicArenaScopedPtr<Delegate> delegate_;
@@ -0,0 +1,210 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_alarm_multiplexer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/numeric/bits.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+int64_t ToMicroseconds(QuicTime time) {
+  return (time - QuicTime::Zero()).ToMicroseconds();
+}
+
+QuicTime FromMicroseconds(int64_t us) {
+  return QuicTime::Zero() + QuicTime::Delta::FromMicroseconds(us);
+}
+
+}  // namespace
+
+class QuicAlarmMultiplexer::MultiplexedAlarm : public QuicAlarm {
+ public:
+  MultiplexedAlarm(QuicAlarmMultiplexer* multiplexer,
+                   QuicArenaScopedPtr<QuicAlarm::Delegate> delegate)
+      : QuicAlarm(std::move(delegate)), multiplexer_(multiplexer), slot_(-1) {}
+
+  ~MultiplexedAlarm() override { multiplexer_->FreeSlot(slot_); }
+
+  void set_slot(int slot) { slot_ = slot; }
+
+  // Runs the alarm if it is still set to |deadline_us|. The alarm may have been
+  // fired by other means since its slot was last updated.
+  void FireIfDue(int64_t deadline_us) {
+    if (IsSet() && ToMicroseconds(deadline()) == deadline_us) {
+      Fire();
+    }
+  }
+
+ protected:
+  void SetImpl() override { multiplexer_->SetDeadline(slot_, deadline()); }
+
+  void CancelImpl() override {
+    multiplexer_->SetDeadline(slot_, QuicTime::Zero());
+  }
+
+  void UpdateImpl() override { multiplexer_->SetDeadline(slot_, deadline()); }
+
+ private:
+  QuicAlarmMultiplexer* multiplexer_;  // Not owned.
+  int slot_;
+};
+
+class QuicAlarmMultiplexer::UnderlyingAlarmDelegate
+    : public QuicAlarm::DelegateWithoutContext {
+ public:
+  explicit UnderlyingAlarmDelegate(QuicAlarmMultiplexer* multiplexer)
+      : multiplexer_(multiplexer) {}
+
+  void OnAlarm() override { multiplexer_->FireAlarms(); }
+
+ private:
+  QuicAlarmMultiplexer* multiplexer_;  // Not owned.
+};
+
+QuicAlarmMultiplexer::QuicAlarmMultiplexer(QuicAlarmFactory* alarm_factory,
+                                           const QuicClock* clock,
+                                           QuicConnectionArena* arena)
+    : alarm_factory_(alarm_factory),
+      clock_(clock),
+      used_slots_(0),
+      firing_(false) {
+  std::fill(std::begin(deadlines_), std::end(deadlines_), kNoDeadline);
+  std::fill(std::begin(alarms_), std::end(alarms_), nullptr);
+  QuicArenaScopedPtr<UnderlyingAlarmDelegate> delegate =
+      arena == nullptr
+          ? QuicArenaScopedPtr<UnderlyingAlarmDelegate>(
+                new UnderlyingAlarmDelegate(this))
+          : arena->New<UnderlyingAlarmDelegate>(this);
+  alarm_ = alarm_factory_->CreateAlarm(std::move(delegate), arena);
+}
+
+QuicAlarmMultiplexer::~QuicAlarmMultiplexer() {
+  QUIC_BUG_IF(quic_alarm_multiplexer_outlived, used_slots_ != 0)
+      << "Multiplexed alarms outlive their multiplexer";
+  alarm_->Cancel();
+}
+
+QuicAlarm* QuicAlarmMultiplexer::CreateAlarm(QuicAlarm::Delegate* delegate) {
+  if (used_slots_ == kAllSlots) {
+    return alarm_factory_->CreateAlarm(delegate);
+  }
+  auto* alarm = new MultiplexedAlarm(
+      this, QuicArenaScopedPtr<QuicAlarm::Delegate>(delegate));
+  AllocateSlot(alarm);
+  return alarm;
+}
+
+QuicArenaScopedPtr<QuicAlarm> QuicAlarmMultiplexer::CreateAlarm(
+    QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
+    QuicConnectionArena* arena) {
+  if (used_slots_ == kAllSlots) {
+    return alarm_factory_->CreateAlarm(std::move(delegate), arena);
+  }
+  QuicArenaScopedPtr<MultiplexedAlarm> alarm =
+      arena == nullptr
+          ? QuicArenaScopedPtr<MultiplexedAlarm>(
+                new MultiplexedAlarm(this, std::move(delegate)))
+          : arena->New<MultiplexedAlarm>(this, std::move(delegate));
+  AllocateSlot(alarm.get());
+  return alarm;
+}
+
+int QuicAlarmMultiplexer::num_alarms() const {
+  return absl::popcount(used_slots_);
+}
+
+void QuicAlarmMultiplexer::AllocateSlot(MultiplexedAlarm* alarm) {
+  QUICHE_DCHECK_NE(used_slots_, kAllSlots);
+  const int slot = absl::countr_one(used_slots_);
+  used_slots_ |= uint32_t{1} << slot;
+  alarms_[slot] = alarm;
+  deadlines_[slot] = kNoDeadline;
+  alarm->set_slot(slot);
+}
+
+void QuicAlarmMultiplexer::FreeSlot(int slot) {
+  const int64_t deadline = deadlines_[slot];
+  used_slots_ &= ~(uint32_t{1} << slot);
+  alarms_[slot] = nullptr;
+  deadlines_[slot] = kNoDeadline;
+  if (firing_ || deadline == kNoDeadline || !alarm_->IsSet() ||
+      deadline != ToMicroseconds(alarm_->deadline())) {
+    return;
+  }
+  // The underlying alarm was set for the alarm being destroyed, which will not
+  // be set again, so waking up early for it would always be wasted.
+  const int64_t earliest = EarliestDeadline();
+  if (earliest == kNoDeadline) {
+    alarm_->Cancel();
+  } else {
+    alarm_->Update(FromMicroseconds(earliest), QuicTime::Delta::Zero());
+  }
+}
+
+void QuicAlarmMultiplexer::SetDeadline(int slot, QuicTime deadline) {
+  deadlines_[slot] =
+      deadline.IsInitialized() ? ToMicroseconds(deadline) : kNoDeadline;
+  UpdateUnderlyingAlarm();
+}
+
+int64_t QuicAlarmMultiplexer::EarliestDeadline() const {
+  int64_t earliest = kNoDeadline;
+  for (int64_t deadline : deadlines_) {
+    earliest = std::min(earliest, deadline);
+  }
+  return earliest;
+}
+
+void QuicAlarmMultiplexer::FireAlarms() {
+  const int64_t now = ToMicroseconds(clock_->ApproximateNow());
+  firing_ = true;
+  // Each alarm runs at most once per call, even if it sets itself to a time
+  // which has already passed.
+  uint32_t pending = used_slots_;
+  while (pending != 0) {
+    int next = -1;
+    for (uint32_t slots = pending; slots != 0; slots &= slots - 1) {
+      const int slot = absl::countr_zero(slots);
+      if (next < 0 || deadlines_[slot] < deadlines_[next]) {
+        next = slot;
+      }
+    }
+    const int64_t deadline = deadlines_[next];
+    if (deadline > now) {
+      break;
+    }
+    pending &= ~(uint32_t{1} << next);
+    deadlines_[next] = kNoDeadline;
+    alarms_[next]->FireIfDue(deadline);
+    // Alarms may have been destroyed by the one which just ran.
+    pending &= used_slots_;
+  }
+  firing_ = false;
+  UpdateUnderlyingAlarm();
+}
+
+void QuicAlarmMultiplexer::UpdateUnderlyingAlarm() {
+  if (firing_) {
+    return;
+  }
+  const int64_t earliest = EarliestDeadline();
+  if (earliest == kNoDeadline) {
+    alarm_->Cancel();
+    return;
+  }
+  if (!alarm_->IsSet()) {
+    alarm_->Set(FromMicroseconds(earliest));
+  } else if (earliest < ToMicroseconds(alarm_->deadline())) {
+    alarm_->Update(FromMicroseconds(earliest), QuicTime::Delta::Zero());
+  }
+}
+
+}  // namespace quic
@@ -0,0 +1,93 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_ALARM_MULTIPLEXER_H_
+#define QUICHE_QUIC_CORE_QUIC_ALARM_MULTIPLEXER_H_
+
+#include <cstdint>
+#include <limits>
+
+#include "quiche/quic/core/quic_alarm.h"
+#include "quiche/quic/core/quic_alarm_factory.h"
+#include "quiche/quic/core/quic_clock.h"
+#include "quiche/quic/core/quic_one_block_arena.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// A QuicAlarmFactory whose alarms share a single alarm of an underlying
+// factory. The deadlines of up to kMaxAlarms alarms are kept in an inline
+// array and only the earliest one is set on the underlying alarm, so that a
+// connection costs one event loop registration instead of one per alarm.
+//
+// The underlying alarm is moved earlier eagerly but is never postponed: if the
+// earliest deadline moves later, e.g. the retransmission alarm on every ack,
+// the underlying alarm goes off early and is then set to the new earliest
+// deadline. The exception is an alarm destroyed while it holds the earliest
+// deadline, after which the underlying alarm is moved to the next deadline.
+//
+// Alarms created once kMaxAlarms alarms exist are created by the underlying
+// factory. The multiplexer must outlive all alarms it creates.
+class QUIC_EXPORT_PRIVATE QuicAlarmMultiplexer : public QuicAlarmFactory {
+ public:
+  static constexpr int kMaxAlarms = 16;
+
+  // |alarm_factory| and |clock| must outlive the multiplexer. The underlying
+  // alarm is allocated in |arena| if not null.
+  QuicAlarmMultiplexer(QuicAlarmFactory* alarm_factory, const QuicClock* clock,
+                       QuicConnectionArena* arena);
+  QuicAlarmMultiplexer(const QuicAlarmMultiplexer&) = delete;
+  QuicAlarmMultiplexer& operator=(const QuicAlarmMultiplexer&) = delete;
+  ~QuicAlarmMultiplexer() override;
+
+  // QuicAlarmFactory interface.
+  QuicAlarm* CreateAlarm(QuicAlarm::Delegate* delegate) override;
+  QuicArenaScopedPtr<QuicAlarm> CreateAlarm(
+      QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
+      QuicConnectionArena* arena) override;
+
+  // Number of multiplexed alarms, set or not.
+  int num_alarms() const;
+
+ private:
+  class MultiplexedAlarm;
+  class UnderlyingAlarmDelegate;
+
+  // Deadline of a slot with no alarm or an alarm which is not set.
+  static constexpr int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+  static constexpr uint32_t kAllSlots = (uint32_t{1} << kMaxAlarms) - 1;
+
+  // Assigns the lowest free slot to |alarm|. There must be one.
+  void AllocateSlot(MultiplexedAlarm* alarm);
+  // Also moves the underlying alarm to the next deadline if it was set for the
+  // alarm in |slot|.
+  void FreeSlot(int slot);
+  void SetDeadline(int slot, QuicTime deadline);
+
+  // Returns the earliest deadline of all slots, or kNoDeadline.
+  int64_t EarliestDeadline() const;
+
+  // Runs the alarms which are due, in deadline order.
+  void FireAlarms();
+  // Makes the underlying alarm go off no later than the earliest deadline.
+  void UpdateUnderlyingAlarm();
+
+  QuicAlarmFactory* alarm_factory_;  // Not owned.
+  const QuicClock* clock_;           // Not owned.
+  // Deadlines in microseconds since QuicTime::Zero(), indexed by slot. Kept
+  // apart from |alarms_| so that finding the earliest is a scan of two cache
+  // lines.
+  int64_t deadlines_[kMaxAlarms];
+  MultiplexedAlarm* alarms_[kMaxAlarms];
+  // Bit i is set iff slot i holds an alarm.
+  uint32_t used_slots_;
+  // True while FireAlarms() runs alarms.
+  bool firing_;
+  QuicArenaScopedPtr<QuicAlarm> alarm_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_ALARM_MULTIPLEXER_H_
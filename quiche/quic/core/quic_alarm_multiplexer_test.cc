@@ -0,0 +1,229 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_alarm_multiplexer.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+// Keeps track of the alarms it creates.
+class RecordingAlarmFactory : public MockAlarmFactory {
+ public:
+  QuicArenaScopedPtr<QuicAlarm> CreateAlarm(
+      QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
+      QuicConnectionArena* arena) override {
+    QuicArenaScopedPtr<QuicAlarm> alarm =
+        MockAlarmFactory::CreateAlarm(std::move(delegate), arena);
+    alarms_.push_back(alarm.get());
+    return alarm;
+  }
+
+  const std::vector<QuicAlarm*>& alarms() const { return alarms_; }
+
+ private:
+  std::vector<QuicAlarm*> alarms_;
+};
+
+class TestDelegate : public QuicAlarm::DelegateWithoutContext {
+ public:
+  TestDelegate(int id, std::vector<int>* fired) : id_(id), fired_(fired) {}
+
+  void OnAlarm() override {
+    fired_->push_back(id_);
+    if (on_alarm_) {
+      on_alarm_();
+    }
+  }
+
+  void set_on_alarm(std::function<void()> on_alarm) {
+    on_alarm_ = std::move(on_alarm);
+  }
+
+ private:
+  const int id_;
+  std::vector<int>* fired_;
+  std::function<void()> on_alarm_;
+};
+
+class QuicAlarmMultiplexerTest : public QuicTest {
+ protected:
+  QuicAlarmMultiplexerTest() : multiplexer_(&alarm_factory_, &clock_, &arena_) {
+    clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+    underlying_alarm_ = alarm_factory_.alarms().back();
+  }
+
+  QuicArenaScopedPtr<QuicAlarm> CreateAlarm(int id) {
+    auto* delegate = new TestDelegate(id, &fired_);
+    delegates_.push_back(delegate);
+    return multiplexer_.CreateAlarm(
+        QuicArenaScopedPtr<QuicAlarm::Delegate>(delegate), &arena_);
+  }
+
+  QuicTime Ms(int64_t ms) const {
+    return clock_.ApproximateNow() + QuicTime::Delta::FromMilliseconds(ms);
+  }
+
+  // Advances the clock to the underlying alarm's deadline and fires it.
+  void FireUnderlyingAlarm() {
+    ASSERT_TRUE(underlying_alarm_->IsSet());
+    clock_.AdvanceTime(underlying_alarm_->deadline() - clock_.ApproximateNow());
+    alarm_factory_.FireAlarm(underlying_alarm_);
+  }
+
+  MockClock clock_;
+  RecordingAlarmFactory alarm_factory_;
+  QuicConnectionArena arena_;
+  QuicAlarmMultiplexer multiplexer_;
+  QuicAlarm* underlying_alarm_;
+  std::vector<TestDelegate*> delegates_;
+  std::vector<int> fired_;
+};
+
+TEST_F(QuicAlarmMultiplexerTest, UnderlyingAlarmTracksEarliestDeadline) {
+  QuicArenaScopedPtr<QuicAlarm> alarm1 = CreateAlarm(1);
+  QuicArenaScopedPtr<QuicAlarm> alarm2 = CreateAlarm(2);
+  EXPECT_EQ(2, multiplexer_.num_alarms());
+  EXPECT_FALSE(underlying_alarm_->IsSet());
+
+  alarm1->Set(Ms(20));
+  EXPECT_EQ(Ms(20), underlying_alarm_->deadline());
+  alarm2->Set(Ms(10));
+  EXPECT_EQ(Ms(10), underlying_alarm_->deadline());
+
+  // Postponing the earliest alarm leaves the underlying alarm in place.
+  alarm2->Update(Ms(30), QuicTime::Delta::Zero());
+  EXPECT_EQ(Ms(10), underlying_alarm_->deadline());
+
+  alarm1->Cancel();
+  alarm2->Cancel();
+  EXPECT_FALSE(underlying_alarm_->IsSet());
+}
+
+TEST_F(QuicAlarmMultiplexerTest, DestroyingEarliestAlarmReschedules) {
+  QuicArenaScopedPtr<QuicAlarm> alarm1 = CreateAlarm(1);
+  QuicArenaScopedPtr<QuicAlarm> alarm2 = CreateAlarm(2);
+  QuicArenaScopedPtr<QuicAlarm> alarm3 = CreateAlarm(3);
+  alarm1->Set(Ms(10));
+  alarm2->Set(Ms(20));
+  alarm3->Set(Ms(30));
+
+  // Destroying an alarm which is not the earliest leaves the underlying alarm
+  // in place.
+  alarm2.reset();
+  EXPECT_EQ(Ms(10), underlying_alarm_->deadline());
+
+  alarm1.reset();
+  EXPECT_EQ(Ms(30), underlying_alarm_->deadline());
+
+  alarm3.reset();
+  EXPECT_FALSE(underlying_alarm_->IsSet());
+  EXPECT_EQ(0, multiplexer_.num_alarms());
+}
+
+TEST_F(QuicAlarmMultiplexerTest, FiresDueAlarmsInDeadlineOrder) {
+  QuicArenaScopedPtr<QuicAlarm> alarm1 = CreateAlarm(1);
+  QuicArenaScopedPtr<QuicAlarm> alarm2 = CreateAlarm(2);
+  QuicArenaScopedPtr<QuicAlarm> alarm3 = CreateAlarm(3);
+  alarm1->Set(Ms(10));
+  alarm2->Set(Ms(5));
+  alarm3->Set(Ms(50));
+
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(10));
+  alarm_factory_.FireAlarm(underlying_alarm_);
+  EXPECT_EQ(std::vector<int>({2, 1}), fired_);
+  EXPECT_FALSE(alarm1->IsSet());
+  EXPECT_FALSE(alarm2->IsSet());
+  EXPECT_TRUE(alarm3->IsSet());
+  EXPECT_EQ(alarm3->deadline(), underlying_alarm_->deadline());
+
+  FireUnderlyingAlarm();
+  EXPECT_EQ(std::vector<int>({2, 1, 3}), fired_);
+  EXPECT_FALSE(underlying_alarm_->IsSet());
+}
+
+TEST_F(QuicAlarmMultiplexerTest, EarlyWakeUpReschedules) {
+  QuicArenaScopedPtr<QuicAlarm> alarm = CreateAlarm(1);
+  alarm->Set(Ms(10));
+  alarm->Update(Ms(40), QuicTime::Delta::Zero());
+
+  FireUnderlyingAlarm();
+  EXPECT_TRUE(fired_.empty());
+  EXPECT_EQ(alarm->deadline(), underlying_alarm_->deadline());
+  FireUnderlyingAlarm();
+  EXPECT_EQ(std::vector<int>({1}), fired_);
+}
+
+TEST_F(QuicAlarmMultiplexerTest, AlarmsChangedWhileFiring) {
+  QuicArenaScopedPtr<QuicAlarm> alarm1 = CreateAlarm(1);
+  QuicArenaScopedPtr<QuicAlarm> alarm2 = CreateAlarm(2);
+  QuicArenaScopedPtr<QuicAlarm> alarm3 = CreateAlarm(3);
+  alarm1->Set(Ms(10));
+  alarm2->Set(Ms(10));
+  alarm3->Set(Ms(10));
+  // The first alarm re-arms itself in the past, cancels the second one and
+  // destroys the third one.
+  delegates_[0]->set_on_alarm([&] {
+    alarm1->Set(clock_.ApproximateNow());
+    alarm2->Cancel();
+    alarm3.reset();
+  });
+
+  FireUnderlyingAlarm();
+  // The re-armed alarm runs on the next wake-up, not in the same one.
+  EXPECT_EQ(std::vector<int>({1}), fired_);
+  EXPECT_EQ(2, multiplexer_.num_alarms());
+  EXPECT_EQ(alarm1->deadline(), underlying_alarm_->deadline());
+
+  delegates_[0]->set_on_alarm(nullptr);
+  alarm_factory_.FireAlarm(underlying_alarm_);
+  EXPECT_EQ(std::vector<int>({1, 1}), fired_);
+}
+
+TEST_F(QuicAlarmMultiplexerTest, AlarmFiredDirectlyIsNotFiredAgain) {
+  QuicArenaScopedPtr<QuicAlarm> alarm = CreateAlarm(1);
+  alarm->Set(Ms(10));
+  alarm_factory_.FireAlarm(alarm.get());
+  EXPECT_EQ(std::vector<int>({1}), fired_);
+
+  FireUnderlyingAlarm();
+  EXPECT_EQ(std::vector<int>({1}), fired_);
+  EXPECT_FALSE(underlying_alarm_->IsSet());
+}
+
+TEST_F(QuicAlarmMultiplexerTest, SlotsAreReusedAndOverflow) {
+  std::vector<QuicArenaScopedPtr<QuicAlarm>> alarms;
+  for (int i = 0; i < QuicAlarmMultiplexer::kMaxAlarms; ++i) {
+    alarms.push_back(CreateAlarm(i));
+  }
+  EXPECT_EQ(QuicAlarmMultiplexer::kMaxAlarms, multiplexer_.num_alarms());
+  const size_t num_underlying_alarms = alarm_factory_.alarms().size();
+
+  // Beyond kMaxAlarms, alarms come from the underlying factory.
+  QuicArenaScopedPtr<QuicAlarm> overflow = CreateAlarm(100);
+  EXPECT_EQ(num_underlying_alarms + 1, alarm_factory_.alarms().size());
+  EXPECT_EQ(overflow.get(), alarm_factory_.alarms().back());
+
+  alarms[3].reset();
+  EXPECT_EQ(QuicAlarmMultiplexer::kMaxAlarms - 1, multiplexer_.num_alarms());
+  alarms[3] = CreateAlarm(3);
+  EXPECT_EQ(QuicAlarmMultiplexer::kMaxAlarms, multiplexer_.num_alarms());
+  EXPECT_EQ(num_underlying_alarms + 1, alarm_factory_.alarms().size());
+
+  alarms[3]->Set(Ms(1));
+  FireUnderlyingAlarm();
+  EXPECT_EQ(std::vector<int>({3}), fired_);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -16,9 +16,11 @@
 #include <string>
 #include <utility>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/congestion_control/rtt_stats.h"
 #include "quiche/quic/core/congestion_control/send_algorithm_interface.h"
 #include "quiche/quic/core/crypto/crypto_protocol.h"
@@ -63,6 +65,14 @@ const QuicPacketCount kMaxConsecutiveNonRetransmittablePackets = 19;
 // The minimum release time into future in ms.
 const int kMinReleaseTimeIntoFutureMs = 1;
 
+// Per-packet options which only carry release times.
+class ReleaseTimeOptions : public PerPacketOptions {
+ public:
+  std::unique_ptr<PerPacketOptions> Clone() const override {
+    return std::make_unique<ReleaseTimeOptions>(*this);
+  }
+};
+
 // Base class of all alarms owned by a QuicConnection.
 class QuicConnectionAlarmDelegate : public QuicAlarm::Delegate {
  public:
@@ -271,28 +281,43 @@ QuicConnection::QuicConnection(
       stop_waiting_count_(0),
       pending_retransmission_alarm_(false),
       defer_send_in_response_to_packets_(false),
+      processing_packet_batch_(false),
+      send_in_response_to_packet_batch_(false),
       keep_alive_ping_timeout_(QuicTime::Delta::FromSeconds(kPingTimeoutSecs)),
       initial_retransmittable_on_wire_timeout_(QuicTime::Delta::Infinite()),
       consecutive_retransmittable_on_wire_ping_count_(0),
       retransmittable_on_wire_ping_count_(0),
       arena_(),
-      ack_alarm_(alarm_factory_->CreateAlarm(arena_.New<AckAlarmDelegate>(this),
-                                             &arena_)),
-      retransmission_alarm_(alarm_factory_->CreateAlarm(
+      alarm_multiplexer_(
+          GetQuicReloadableFlag(quic_multiplex_connection_alarms)
+              ? std::make_unique<QuicAlarmMultiplexer>(alarm_factory, clock_,
+                                                       &arena_)
+              : nullptr),
+      connection_alarm_factory_(alarm_multiplexer_ != nullptr
+                                    ? alarm_multiplexer_.get()
+                                    : alarm_factory_),
+      ack_alarm_(connection_alarm_factory_->CreateAlarm(
+          arena_.New<AckAlarmDelegate>(this), &arena_)),
+      retransmission_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<RetransmissionAlarmDelegate>(this), &arena_)),
-      send_alarm_(alarm_factory_->CreateAlarm(
+      send_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<SendAlarmDelegate>(this), &arena_)),
-      ping_alarm_(alarm_factory_->CreateAlarm(
+      ping_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<PingAlarmDelegate>(this), &arena_)),
-      mtu_discovery_alarm_(alarm_factory_->CreateAlarm(
+      mtu_discovery_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<MtuDiscoveryAlarmDelegate>(this), &arena_)),
-      process_undecryptable_packets_alarm_(alarm_factory_->CreateAlarm(
-          arena_.New<ProcessUndecryptablePacketsAlarmDelegate>(this), &arena_)),
-      discard_previous_one_rtt_keys_alarm_(alarm_factory_->CreateAlarm(
-          arena_.New<DiscardPreviousOneRttKeysAlarmDelegate>(this), &arena_)),
-      discard_zero_rtt_decryption_keys_alarm_(alarm_factory_->CreateAlarm(
-          arena_.New<DiscardZeroRttDecryptionKeysAlarmDelegate>(this),
-          &arena_)),
+      process_undecryptable_packets_alarm_(
+          connection_alarm_factory_->CreateAlarm(
+              arena_.New<ProcessUndecryptablePacketsAlarmDelegate>(this),
+              &arena_)),
+      discard_previous_one_rtt_keys_alarm_(
+          connection_alarm_factory_->CreateAlarm(
+              arena_.New<DiscardPreviousOneRttKeysAlarmDelegate>(this),
+              &arena_)),
+      discard_zero_rtt_decryption_keys_alarm_(
+          connection_alarm_factory_->CreateAlarm(
+              arena_.New<DiscardZeroRttDecryptionKeysAlarmDelegate>(this),
+              &arena_)),
       visitor_(nullptr),
       debug_visitor_(nullptr),
       packet_creator_(server_connection_id, &framer_, random_generator_, this),
@@ -320,12 +345,13 @@ QuicConnection::QuicConnection(
       processing_ack_frame_(false),
       supports_release_time_(false),
       release_time_into_future_(QuicTime::Delta::Zero()),
-      blackhole_detector_(this, &arena_, alarm_factory_, &context_),
+      blackhole_detector_(this, &arena_, connection_alarm_factory_, &context_),
       idle_network_detector_(this, clock_->ApproximateNow(), &arena_,
-                             alarm_factory_, &context_),
-      path_validator_(alarm_factory_, &arena_, this, random_generator_,
-                      &context_),
-      ping_manager_(perspective, this, &arena_, alarm_factory_, &context_) {
+                             connection_alarm_factory_, &context_),
+      path_validator_(connection_alarm_factory_, &arena_, this,
+                      random_generator_, &context_),
+      ping_manager_(perspective, this, &arena_, connection_alarm_factory_,
+                    &context_) {
   QUICHE_DCHECK(perspective_ == Perspective::IS_CLIENT ||
                 default_path_.self_address.IsInitialized());
 
@@ -337,6 +363,9 @@ QuicConnection::QuicConnection(
                                     server_connection_id, transport_version()))
       << "QuicConnection: attempted to use server connection ID "
       << server_connection_id << " which is invalid with version " << version();
+  if (alarm_multiplexer_ != nullptr) {
+    QUIC_RELOADABLE_FLAG_COUNT(quic_multiplex_connection_alarms);
+  }
   framer_.set_visitor(this);
   stats_.connection_creation_time = clock_->ApproximateNow();
   // TODO(ianswett): Supply the NetworkChangeVisitor as a constructor argument
@@ -388,6 +417,7 @@ void QuicConnection::InstallInitialCrypters(QuicConnectionId connection_id) {
 
 QuicConnection::~QuicConnection() {
   QUICHE_DCHECK_GE(stats_.max_egress_mtu, long_term_mtu_);
+  QUICHE_DCHECK(!deferring_sealing_);
   if (owns_writer_) {
     delete writer_;
   }
@@ -677,6 +707,19 @@ void QuicConnection::SetFromConfig(const QuicConfig& config) {
   if (supports_release_time_) {
     UpdateReleaseTimeIntoFuture();
   }
+
+  // Without per-packet options, the release times CalculatePacketSentTime()
+  // computes would never reach the writer, which would leave pacing to the
+  // send alarm.
+  if (supports_release_time_ && per_packet_options_ == nullptr &&
+      GetQuicReloadableFlag(quic_pace_with_release_times)) {
+    QUIC_RELOADABLE_FLAG_COUNT(quic_pace_with_release_times);
+    release_time_options_ = std::make_unique<ReleaseTimeOptions>();
+    per_packet_options_ = release_time_options_.get();
+  } else if (!supports_release_time_ && release_time_options_ != nullptr &&
+             per_packet_options_ == release_time_options_.get()) {
+    per_packet_options_ = nullptr;
+  }
 }
 
 void QuicConnection::EnableLegacyVersionEncapsulation(
@@ -2412,6 +2455,12 @@ void QuicConnection::MaybeSendInResponseToPacket() {
     return;
   }
 
+  if (processing_packet_batch_) {
+    // Send once the rest of the batch has been processed.
+    send_in_response_to_packet_batch_ = true;
+    return;
+  }
+
   // If the writer is blocked, don't attempt to send packets now or in the send
   // alarm. When the writer unblocks, OnCanWrite() will be called for this
   // connection to send.
@@ -2819,6 +2868,51 @@ void QuicConnection::ProcessUdpPacket(const QuicSocketAddress& self_address,
   is_current_packet_connectivity_probing_ = false;
 }
 
+size_t QuicConnection::ProcessUdpPackets(
+    absl::Span<const ReceivedUdpPacket> packets) {
+  QUICHE_DCHECK(!processing_packet_batch_);
+  size_t num_processed = 0;
+  {
+    // Acks are bundled and packets flushed when this outermost flusher goes
+    // out of scope, after the last packet of the batch.
+    ScopedPacketFlusher flusher(this);
+    processing_packet_batch_ = true;
+    const bool precompute_masks =
+        GetQuicReloadableFlag(quic_batch_header_protection_masks) &&
+        packets.size() > 1;
+    if (precompute_masks) {
+      QUIC_RELOADABLE_FLAG_COUNT_N(quic_batch_header_protection_masks, 1, 2);
+      absl::InlinedVector<absl::string_view, 16> packet_data;
+      for (const ReceivedUdpPacket& packet : packets) {
+        packet_data.push_back(packet.packet->AsStringPiece());
+      }
+      framer_.PrecomputeHeaderProtectionMasks(packet_data);
+      if (GetQuicReloadableFlag(quic_batch_aead)) {
+        QUIC_RELOADABLE_FLAG_COUNT_N(quic_batch_aead, 2, 2);
+        framer_.PredecryptPackets(packet_data);
+      }
+    }
+    for (const ReceivedUdpPacket& packet : packets) {
+      if (!connected_) {
+        break;
+      }
+      ProcessUdpPacket(packet.self_address, packet.peer_address,
+                       *packet.packet);
+      ++num_processed;
+    }
+    if (precompute_masks) {
+      framer_.ClearPredecryptedPackets();
+      framer_.ClearHeaderProtectionMasks();
+    }
+    processing_packet_batch_ = false;
+    if (send_in_response_to_packet_batch_) {
+      send_in_response_to_packet_batch_ = false;
+      MaybeSendInResponseToPacket();
+    }
+  }
+  return num_processed;
+}
+
 void QuicConnection::OnBlockedWriterCanWrite() {
   writer_->SetWritable();
   OnCanWrite();
@@ -3342,6 +3436,7 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
     QUIC_BUG(quic_bug_10511_23)
         << "Attempt to write packet:" << packet->packet_number
         << " after:" << sent_packet_manager_.GetLargestSentPacket();
+    SealPendingPackets();
     CloseConnection(QUIC_INTERNAL_ERROR, "Packet written out of order.",
                     ConnectionCloseBehavior::SEND_CONNECTION_CLOSE_PACKET);
     return true;
@@ -3352,6 +3447,11 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
   // Termination packets are encrypted and saved, so don't exit early.
   QuicErrorCode error_code = QUIC_NO_ERROR;
   const bool is_termination_packet = IsTerminationPacket(*packet, &error_code);
+  if (deferring_sealing_ &&
+      (is_termination_packet || fate != SEND_TO_WRITER)) {
+    // Only packets written in place may be sealed by the writer.
+    SealPendingPackets();
+  }
   QuicPacketNumber packet_number = packet->packet_number;
   QuicPacketLength encrypted_length = packet->encrypted_length;
   // Termination packets are eventually owned by TimeWaitListManager.
@@ -3540,6 +3640,11 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
       WRITE_STATUS_NUM_VALUES,
       "Status code returned by writer_->WritePacket() in QuicConnection.");
 
+  if (deferring_sealing_ && result.status != WRITE_STATUS_OK) {
+    // The packet may be copied, or dropped by the writer.
+    SealPendingPackets();
+  }
+
   if (IsWriteBlockedStatus(result.status)) {
     // Ensure the writer is still write blocked, otherwise QUIC may continue
     // trying to write when it will not be able to.
@@ -3653,13 +3758,16 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
       QUIC_BUG(quic_bug_10511_25)
           << "Unacked map is empty right after packet is sent";
     } else {
+      const absl::Span<const QuicFrame> retransmittable_frames =
+          sent_packet_manager_.unacked_packets()
+              .rbegin()
+              ->retransmittable_frames();
       debug_visitor_->OnPacketSent(
           packet->packet_number, packet->encrypted_length,
           packet->has_crypto_handshake, packet->transmission_type,
           packet->encryption_level,
-          sent_packet_manager_.unacked_packets()
-              .rbegin()
-              ->retransmittable_frames,
+          QuicFrames(retransmittable_frames.begin(),
+                     retransmittable_frames.end()),
           packet->nonretransmittable_frames, packet_send_time);
     }
   }
@@ -3964,6 +4072,9 @@ void QuicConnection::OnSerializedPacket(SerializedPacket serialized_packet) {
   if (retransmittable_on_wire_behavior_ == SEND_FIRST_FORWARD_SECURE_PACKET &&
       first_serialized_one_rtt_packet_ == nullptr &&
       serialized_packet.encryption_level == ENCRYPTION_FORWARD_SECURE) {
+    if (deferring_sealing_) {
+      SealPendingPackets();
+    }
     first_serialized_one_rtt_packet_ = std::make_unique<BufferedPacket>(
         serialized_packet, self_address(), peer_address());
   }
@@ -4834,11 +4945,18 @@ QuicConnection::ScopedPacketFlusher::ScopedPacketFlusher(
   if (!connection_->packet_creator_.PacketFlusherAttached()) {
     flush_and_set_pending_retransmission_alarm_on_delete_ = true;
     connection->packet_creator_.AttachPacketFlusher();
+    connection->MaybeStartDeferringSealing();
   }
 }
 
 QuicConnection::ScopedPacketFlusher::~ScopedPacketFlusher() {
-  if (connection_ == nullptr || !connection_->connected()) {
+  if (connection_ == nullptr) {
+    return;
+  }
+  if (!connection_->connected()) {
+    if (flush_and_set_pending_retransmission_alarm_on_delete_) {
+      connection_->StopDeferringSealing();
+    }
     return;
   }
 
@@ -4889,6 +5007,7 @@ QuicConnection::ScopedPacketFlusher::~ScopedPacketFlusher() {
       connection_->FlushCoalescedPacket();
     }
     connection_->FlushPackets();
+    connection_->StopDeferringSealing();
     if (!handshake_packet_sent_ && connection_->handshake_packet_sent_) {
       // This would cause INITIAL key to be dropped. Drop keys here to avoid
       // missing the write keys in the middle of writing.
@@ -5159,13 +5278,16 @@ bool QuicConnection::WritePacketUsingWriter(
       QUIC_BUG(quic_bug_10511_32)
           << "Unacked map is empty right after packet is sent";
     } else {
+      const absl::Span<const QuicFrame> retransmittable_frames =
+          sent_packet_manager_.unacked_packets()
+              .rbegin()
+              ->retransmittable_frames();
       debug_visitor_->OnPacketSent(
           packet->packet_number, packet->encrypted_length,
           packet->has_crypto_handshake, packet->transmission_type,
           packet->encryption_level,
-          sent_packet_manager_.unacked_packets()
-              .rbegin()
-              ->retransmittable_frames,
+          QuicFrames(retransmittable_frames.begin(),
+                     retransmittable_frames.end()),
           packet->nonretransmittable_frames, packet_send_time);
     }
   }
@@ -6394,6 +6516,39 @@ void QuicConnection::OnRetransmittableOnWireTimeout() {
   SendPingAtLevel(framer().GetEncryptionLevelToSendApplicationData());
 }
 
+void QuicConnection::SealPendingPackets() {
+  if (framer_.SealPendingPackets()) {
+    return;
+  }
+  // The pending packets were scrubbed. This may run while the writer flushes,
+  // so close without writing anything.
+  if (connected_) {
+    CloseConnection(QUIC_ENCRYPTION_FAILURE, "Failed to seal pending packets.",
+                    ConnectionCloseBehavior::SILENT_CLOSE);
+  }
+}
+
+void QuicConnection::MaybeStartDeferringSealing() {
+  if (deferring_sealing_ || !connected_ ||
+      !GetQuicReloadableFlag(quic_batch_header_protection_masks) ||
+      !writer_->IsBatchMode() || !writer_->RegisterPacketSealer(this)) {
+    return;
+  }
+  QUIC_RELOADABLE_FLAG_COUNT_N(quic_batch_header_protection_masks, 2, 2);
+  deferring_sealing_ = true;
+  packet_creator_.set_defer_sealing(true);
+}
+
+void QuicConnection::StopDeferringSealing() {
+  if (!deferring_sealing_) {
+    return;
+  }
+  deferring_sealing_ = false;
+  packet_creator_.set_defer_sealing(false);
+  SealPendingPackets();
+  writer_->UnregisterPacketSealer(this);
+}
+
 void QuicConnection::OnPeerIssuedConnectionIdRetired() {
   QUICHE_DCHECK(peer_issued_cid_manager_ != nullptr);
   QuicConnectionId* default_path_cid =
@@ -6767,6 +6922,22 @@ void QuicConnection::SendPingAtLevel(EncryptionLevel level) {
   SendControlFrame(QuicFrame(QuicPingFrame()));
 }
 
+void QuicConnection::AddReceivedPacketBufferUser() {
+  if (num_received_packet_buffer_users_++ == 0) {
+    framer_.set_use_received_packet_buffers(true);
+  }
+}
+
+void QuicConnection::RemoveReceivedPacketBufferUser() {
+  QUICHE_DCHECK_GT(num_received_packet_buffer_users_, 0u);
+  if (num_received_packet_buffer_users_ == 0) {
+    return;
+  }
+  if (--num_received_packet_buffer_users_ == 0) {
+    framer_.set_use_received_packet_buffers(false);
+  }
+}
+
 bool QuicConnection::HasPendingPathValidation() const {
   return path_validator_.HasPendingPathValidation();
 }
@@ -26,6 +26,7 @@
 
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/quic_decrypter.h"
 #include "quiche/quic/core/crypto/quic_encrypter.h"
 #include "quiche/quic/core/crypto/transport_parameters.h"
@@ -35,6 +36,7 @@
 #include "quiche/quic/core/proto/cached_network_parameters_proto.h"
 #include "quiche/quic/core/quic_alarm.h"
 #include "quiche/quic/core/quic_alarm_factory.h"
+#include "quiche/quic/core/quic_alarm_multiplexer.h"
 #include "quiche/quic/core/quic_blocked_writer_interface.h"
 #include "quiche/quic/core/quic_connection_context.h"
 #include "quiche/quic/core/quic_connection_id.h"
@@ -67,6 +69,7 @@ class QuicClock;
 class QuicConfig;
 class QuicConnection;
 class QuicRandom;
+class QuicStreamSequencerBufferBlockPool;
 
 namespace test {
 class QuicConnectionPeer;
@@ -451,6 +454,13 @@ class QUIC_EXPORT_PRIVATE QuicConnectionHelperInterface {
 
   // Returns a QuicheBufferAllocator to be used for stream send buffers.
   virtual quiche::QuicheBufferAllocator* GetStreamSendBufferAllocator() = 0;
+
+  // Returns a pool for the blocks of stream receive buffers, or nullptr if
+  // they should be allocated individually.
+  virtual QuicStreamSequencerBufferBlockPool*
+  GetStreamSequencerBufferBlockPool() {
+    return nullptr;
+  }
 };
 
 class QUIC_EXPORT_PRIVATE QuicConnection
@@ -462,7 +472,8 @@ class QUIC_EXPORT_PRIVATE QuicConnection
       public QuicIdleNetworkDetector::Delegate,
       public QuicPathValidator::SendDelegate,
       public QuicConnectionIdManagerVisitorInterface,
-      public QuicPingManager::Delegate {
+      public QuicPingManager::Delegate,
+      public QuicPacketSealer {
  public:
   // Constructs a new QuicConnection for |connection_id| and
   // |initial_peer_address| using |writer| to write packets. |owns_writer|
@@ -572,6 +583,12 @@ class QUIC_EXPORT_PRIVATE QuicConnection
                                 const QuicSocketAddress& peer_address,
                                 const QuicReceivedPacket& packet);
 
+  // Processes |packets| in order, as ProcessUdpPacket() does, but decides on
+  // acks and writes once for the whole batch rather than once per packet.
+  // Stops early if the connection is closed. Returns the number of packets
+  // processed.
+  size_t ProcessUdpPackets(absl::Span<const ReceivedUdpPacket> packets);
+
   // QuicBlockedWriterInterface
   // Called when the underlying connection becomes writable to allow queued
   // writes to happen.
@@ -598,6 +615,7 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   // Set the packet writer.
   void SetQuicPacketWriter(QuicPacketWriter* writer, bool owns_writer) {
     QUICHE_DCHECK(writer != nullptr);
+    StopDeferringSealing();
     if (writer_ != nullptr && owns_writer_) {
       delete writer_;
     }
@@ -719,6 +737,9 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   void OnKeepAliveTimeout() override;
   void OnRetransmittableOnWireTimeout() override;
 
+  // QuicPacketSealer
+  void SealPendingPackets() override;
+
   // QuicConnectionIdManagerVisitorInterface
   void OnPeerIssuedConnectionIdRetired() override;
   bool SendNewConnectionId(const QuicNewConnectionIdFrame& frame) override;
@@ -1142,6 +1163,15 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   // false.
   bool MaybeTestLiveness();
 
+  // Registers this connection as the packet sealer of |writer_|, if it
+  // supports one, so that the header protection of the 1-RTT packets written
+  // while the outermost packet flusher is attached is applied in batches.
+  void MaybeStartDeferringSealing();
+
+  // Seals the packets whose sealing was deferred and unregisters from
+  // |writer_|, so that packets left in it can be flushed by anyone.
+  void StopDeferringSealing();
+
   // QuicPathValidator::SendDelegate
   // Send PATH_CHALLENGE using the given path information. If |writer| is the
   // default writer, PATH_CHALLENGE can be bundled with other frames, and the
@@ -1180,6 +1210,13 @@ class QUIC_EXPORT_PRIVATE QuicConnection
 
   bool is_processing_packet() const { return framer_.is_processing_packet(); }
 
+  // Makes the framer decrypt packets into reference-counted buffers, so that
+  // streams can keep references to received data instead of copying it, until
+  // each call has been matched by RemoveReceivedPacketBufferUser(). See
+  // QuicFramer::set_use_received_packet_buffers().
+  void AddReceivedPacketBufferUser();
+  void RemoveReceivedPacketBufferUser();
+
   bool HasPendingPathValidation() const;
 
   QuicPathValidationContext* GetPathValidationContext() const;
@@ -1888,8 +1925,16 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   QuicConnectionHelperInterface* helper_;  // Not owned.
   QuicAlarmFactory* alarm_factory_;        // Not owned.
   PerPacketOptions* per_packet_options_;   // Not owned.
+  // Carries release times to the writer if no per-packet options were set.
+  std::unique_ptr<PerPacketOptions> release_time_options_;
   QuicPacketWriter* writer_;  // Owned or not depending on |owns_writer_|.
   bool owns_writer_;
+  // Whether this connection is registered as |writer_|'s packet sealer, and
+  // lets 1-RTT packets written to it be sealed as they are flushed.
+  bool deferring_sealing_ = false;
+  // Number of AddReceivedPacketBufferUser() calls not yet matched by
+  // RemoveReceivedPacketBufferUser().
+  size_t num_received_packet_buffer_users_ = 0;
   // Encryption level for new packets. Should only be changed via
   // SetDefaultEncryptionLevel().
   EncryptionLevel encryption_level_;
@@ -1994,6 +2039,13 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   // SendAlarm.
   bool defer_send_in_response_to_packets_;
 
+  // True while ProcessUdpPackets() is processing a batch of packets.
+  bool processing_packet_batch_;
+
+  // True if a packet of the batch being processed called for sending data in
+  // response, which is then done once the whole batch has been processed.
+  bool send_in_response_to_packet_batch_;
+
   // TODO(fayang): remove PING related fields below when deprecating
   // quic_use_ping_manager2.
   // The timeout for keep-alive PING.
@@ -2012,6 +2064,14 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   // Arena to store class implementations within the QuicConnection.
   QuicConnectionArena arena_;
 
+  // Multiplexes the connection's own alarms onto a single alarm of
+  // |alarm_factory_|. Only created if quic_multiplex_connection_alarms is
+  // true. Must outlive the alarms below.
+  std::unique_ptr<QuicAlarmMultiplexer> alarm_multiplexer_;
+  // Creates the connection's own alarms: |alarm_multiplexer_| if set,
+  // |alarm_factory_| otherwise.
+  QuicAlarmFactory* connection_alarm_factory_;  // Not owned.
+
   // An alarm that fires when an ACK should be sent to the peer.
   QuicArenaScopedPtr<QuicAlarm> ack_alarm_;
   // An alarm that fires when a packet needs to be retransmitted.
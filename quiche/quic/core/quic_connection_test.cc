@@ -42,6 +42,7 @@
 #include "quiche/quic/platform/api/quic_test.h"
 #include "quiche/quic/test_tools/mock_clock.h"
 #include "quiche/quic/test_tools/mock_random.h"
+#include "quiche/quic/test_tools/quic_alarm_peer.h"
 #include "quiche/quic/test_tools/quic_coalesced_packet_peer.h"
 #include "quiche/quic/test_tools/quic_config_peer.h"
 #include "quiche/quic/test_tools/quic_connection_peer.h"
@@ -399,63 +400,58 @@ class TestConnection : public QuicConnection {
         .WillRepeatedly(Return(QuicBandwidth::Infinite()));
   }
 
-  TestAlarmFactory::TestAlarm* GetAckAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
-        QuicConnectionPeer::GetAckAlarm(this));
+  QuicTestAlarmProxy GetAckAlarm() {
+    return QuicTestAlarmProxy(QuicConnectionPeer::GetAckAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetPingAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
-        QuicConnectionPeer::GetPingAlarm(this));
+  QuicTestAlarmProxy GetPingAlarm() {
+    return QuicTestAlarmProxy(QuicConnectionPeer::GetPingAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetRetransmissionAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
-        QuicConnectionPeer::GetRetransmissionAlarm(this));
+  QuicTestAlarmProxy GetRetransmissionAlarm() {
+    return QuicTestAlarmProxy(QuicConnectionPeer::GetRetransmissionAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetSendAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
-        QuicConnectionPeer::GetSendAlarm(this));
+  QuicTestAlarmProxy GetSendAlarm() {
+    return QuicTestAlarmProxy(QuicConnectionPeer::GetSendAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetTimeoutAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
+  QuicTestAlarmProxy GetTimeoutAlarm() {
+    return QuicTestAlarmProxy(
         QuicConnectionPeer::GetIdleNetworkDetectorAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetMtuDiscoveryAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
-        QuicConnectionPeer::GetMtuDiscoveryAlarm(this));
+  QuicTestAlarmProxy GetMtuDiscoveryAlarm() {
+    return QuicTestAlarmProxy(QuicConnectionPeer::GetMtuDiscoveryAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetProcessUndecryptablePacketsAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
+  QuicTestAlarmProxy GetProcessUndecryptablePacketsAlarm() {
+    return QuicTestAlarmProxy(
         QuicConnectionPeer::GetProcessUndecryptablePacketsAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetDiscardPreviousOneRttKeysAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
+  QuicTestAlarmProxy GetDiscardPreviousOneRttKeysAlarm() {
+    return QuicTestAlarmProxy(
         QuicConnectionPeer::GetDiscardPreviousOneRttKeysAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetDiscardZeroRttDecryptionKeysAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
+  QuicTestAlarmProxy GetDiscardZeroRttDecryptionKeysAlarm() {
+    return QuicTestAlarmProxy(
         QuicConnectionPeer::GetDiscardZeroRttDecryptionKeysAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetBlackholeDetectorAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
+  QuicTestAlarmProxy GetBlackholeDetectorAlarm() {
+    return QuicTestAlarmProxy(
         QuicConnectionPeer::GetBlackholeDetectorAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetRetirePeerIssuedConnectionIdAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
+  QuicTestAlarmProxy GetRetirePeerIssuedConnectionIdAlarm() {
+    return QuicTestAlarmProxy(
         QuicConnectionPeer::GetRetirePeerIssuedConnectionIdAlarm(this));
   }
 
-  TestAlarmFactory::TestAlarm* GetRetireSelfIssuedConnectionIdAlarm() {
-    return reinterpret_cast<TestAlarmFactory::TestAlarm*>(
+  QuicTestAlarmProxy GetRetireSelfIssuedConnectionIdAlarm() {
+    return QuicTestAlarmProxy(
         QuicConnectionPeer::GetRetireSelfIssuedConnectionIdAlarm(this));
   }
 
@@ -532,14 +528,17 @@ enum class AckResponse { kDefer, kImmediate };
 // Run tests with combinations of {ParsedQuicVersion, AckResponse}.
 struct TestParams {
   TestParams(ParsedQuicVersion version, AckResponse ack_response,
-             bool no_stop_waiting)
+             bool no_stop_waiting, bool multiplex_alarms = false)
       : version(version),
         ack_response(ack_response),
-        no_stop_waiting(no_stop_waiting) {}
+        no_stop_waiting(no_stop_waiting),
+        multiplex_alarms(multiplex_alarms) {}
 
   ParsedQuicVersion version;
   AckResponse ack_response;
   bool no_stop_waiting;
+  // Value of quic_multiplex_connection_alarms.
+  bool multiplex_alarms;
 };
 
 // Used by ::testing::PrintToStringParamName().
@@ -547,7 +546,8 @@ std::string PrintToString(const TestParams& p) {
   return absl::StrCat(
       ParsedQuicVersionToString(p.version), "_",
       (p.ack_response == AckResponse::kDefer ? "defer" : "immediate"), "_",
-      (p.no_stop_waiting ? "No" : ""), "StopWaiting");
+      (p.no_stop_waiting ? "No" : ""), "StopWaiting",
+      (p.multiplex_alarms ? "_MultiplexedAlarms" : ""));
 }
 
 // Constructs various test permutations.
@@ -565,10 +565,22 @@ std::vector<TestParams> GetTestParams() {
             TestParams(all_supported_versions[i], ack_response, false));
       }
     }
+    // The alarms of a multiplexed connection are set and fired through
+    // QuicAlarmMultiplexer, so run every test once more that way.
+    params.push_back(TestParams(all_supported_versions[i], AckResponse::kDefer,
+                                true, /*multiplex_alarms=*/true));
   }
   return params;
 }
 
+// Sets quic_multiplex_connection_alarms as |params| asks. The flag is read
+// when the connection is created, so this runs before the fixture's members.
+bool SetAlarmMultiplexing(const TestParams& params) {
+  SetQuicReloadableFlag(quic_multiplex_connection_alarms,
+                        params.multiplex_alarms);
+  return params.multiplex_alarms;
+}
+
 class QuicConnectionTest : public QuicTestWithParam<TestParams> {
  public:
   // For tests that do silent connection closes, no such packet is generated. In
@@ -583,7 +595,8 @@ class QuicConnectionTest : public QuicTestWithParam<TestParams> {
 
  protected:
   QuicConnectionTest()
-      : connection_id_(TestConnectionId()),
+      : multiplex_alarms_(SetAlarmMultiplexing(GetParam())),
+        connection_id_(TestConnectionId()),
         framer_(SupportedVersions(version()), QuicTime::Zero(),
                 Perspective::IS_CLIENT, connection_id_.length()),
         send_algorithm_(new StrictMock<MockSendAlgorithm>),
@@ -1329,7 +1342,8 @@ class QuicConnectionTest : public QuicTestWithParam<TestParams> {
   bool IsDefaultTestConfiguration() {
     TestParams p = GetParam();
     return p.ack_response == AckResponse::kImmediate &&
-           p.version == AllSupportedVersions()[0] && p.no_stop_waiting;
+           p.version == AllSupportedVersions()[0] && p.no_stop_waiting &&
+           !p.multiplex_alarms;
   }
 
   void TestConnectionCloseQuicErrorCode(QuicErrorCode expected_code) {
@@ -1449,6 +1463,8 @@ class QuicConnectionTest : public QuicTestWithParam<TestParams> {
 
   void TestReplaceConnectionIdFromInitial();
 
+  // Declared first so that the flag is set before |connection_| is created.
+  const bool multiplex_alarms_;
   QuicConnectionId connection_id_;
   QuicFramer framer_;
 
@@ -2242,10 +2258,8 @@ TEST_P(QuicConnectionTest, ReversePathValidationFailureAtServer) {
 
   for (size_t i = 0; i < QuicPathValidator::kMaxRetryTimes; ++i) {
     clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(3 * kInitialRttMs));
-    static_cast<TestAlarmFactory::TestAlarm*>(
-        QuicPathValidatorPeer::retry_timer(
-            QuicConnectionPeer::path_validator(&connection_)))
-        ->Fire();
+    QuicAlarmPeer::Fire(QuicPathValidatorPeer::retry_timer(
+        QuicConnectionPeer::path_validator(&connection_)));
   }
   EXPECT_EQ(IPV6_TO_IPV4_CHANGE,
             connection_.active_effective_peer_migration_type());
@@ -2259,10 +2273,8 @@ TEST_P(QuicConnectionTest, ReversePathValidationFailureAtServer) {
 
   // Advance the time so that the reverse path validation times out.
   clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(3 * kInitialRttMs));
-  static_cast<TestAlarmFactory::TestAlarm*>(
-      QuicPathValidatorPeer::retry_timer(
-          QuicConnectionPeer::path_validator(&connection_)))
-      ->Fire();
+  QuicAlarmPeer::Fire(QuicPathValidatorPeer::retry_timer(
+      QuicConnectionPeer::path_validator(&connection_)));
   EXPECT_EQ(NO_CHANGE, connection_.active_effective_peer_migration_type());
   EXPECT_EQ(kPeerAddress, connection_.peer_address());
   EXPECT_EQ(kPeerAddress, connection_.effective_peer_address());
@@ -2275,7 +2287,7 @@ TEST_P(QuicConnectionTest, ReversePathValidationFailureAtServer) {
   EXPECT_EQ(default_path->server_connection_id, server_cid0);
   EXPECT_TRUE(alternative_path->server_connection_id.IsEmpty());
   EXPECT_FALSE(alternative_path->stateless_reset_token.has_value());
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_TRUE(retire_peer_issued_cid_alarm->IsSet());
   EXPECT_CALL(visitor_, SendRetireConnectionId(/*sequence_number=*/1u));
@@ -6137,6 +6149,42 @@ TEST_P(QuicConnectionTest, SendDelayedAckOnSecondPacket) {
   EXPECT_FALSE(connection_.HasPendingAcks());
 }
 
+TEST_P(QuicConnectionTest, ProcessUdpPacketsSendsOneAckForBatch) {
+  EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
+  EXPECT_CALL(visitor_, OnStreamFrame(_)).Times(4);
+  peer_creator_.set_encryption_level(ENCRYPTION_FORWARD_SECURE);
+  std::vector<std::string> encrypted_packets;
+  for (uint64_t number = 1; number <= 4; ++number) {
+    std::unique_ptr<QuicPacket> packet(
+        ConstructDataPacket(number, false, ENCRYPTION_FORWARD_SECURE));
+    char buffer[kMaxOutgoingPacketSize];
+    size_t encrypted_length = peer_framer_.EncryptPayload(
+        ENCRYPTION_FORWARD_SECURE, QuicPacketNumber(number), *packet, buffer,
+        kMaxOutgoingPacketSize);
+    encrypted_packets.push_back(std::string(buffer, encrypted_length));
+  }
+  std::vector<std::unique_ptr<QuicReceivedPacket>> received_packets;
+  std::vector<ReceivedUdpPacket> batch;
+  for (const std::string& encrypted_packet : encrypted_packets) {
+    received_packets.push_back(std::make_unique<QuicReceivedPacket>(
+        encrypted_packet.data(), encrypted_packet.length(), clock_.Now(),
+        false));
+    batch.push_back(
+        {kSelfAddress, kPeerAddress, received_packets.back().get()});
+  }
+
+  // Processed one at a time, the second and the fourth packet would each be
+  // acked right away.
+  EXPECT_CALL(*send_algorithm_, OnPacketSent(_, _, _, _, _)).Times(1);
+  EXPECT_EQ(4u, connection_.ProcessUdpPackets(batch));
+  if (connection_.GetSendAlarm()->IsSet()) {
+    connection_.GetSendAlarm()->Fire();
+  }
+  EXPECT_EQ(1u, writer_->packets_write_attempts());
+  EXPECT_FALSE(writer_->ack_frames().empty());
+  EXPECT_FALSE(connection_.HasPendingAcks());
+}
+
 TEST_P(QuicConnectionTest, NoAckOnOldNacks) {
   EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
   EXPECT_CALL(*send_algorithm_, OnPacketSent(_, _, _, _, _)).Times(0);
@@ -8775,6 +8823,51 @@ TEST_P(QuicConnectionTest, DisablePacingOffloadConnectionOptions) {
   EXPECT_FALSE(QuicConnectionPeer::SupportsReleaseTime(&connection_));
 }
 
+TEST_P(QuicConnectionTest, PacesWithReleaseTimes) {
+  SetQuicReloadableFlag(quic_pace_with_release_times, true);
+  EXPECT_EQ(nullptr, QuicConnectionPeer::GetPerPacketOptions(&connection_));
+  writer_->set_supports_release_time(true);
+  QuicConfig config;
+  EXPECT_CALL(*send_algorithm_, SetFromConfig(_, _));
+  connection_.SetFromConfig(config);
+  ASSERT_TRUE(QuicConnectionPeer::SupportsReleaseTime(&connection_));
+  // The connection carries release times to the writer in options of its own.
+  EXPECT_NE(nullptr, QuicConnectionPeer::GetPerPacketOptions(&connection_));
+
+  // Pace 1000 byte packets at about a millisecond apart, well within the 10ms
+  // the connection may release packets into the future.
+  QuicSentPacketManagerPeer::DisablePacerBursts(manager_);
+  SetQuicFlag(FLAGS_quic_lumpy_pacing_size, 1);
+  EXPECT_CALL(*send_algorithm_, PacingRate(_))
+      .WillRepeatedly(Return(QuicBandwidth::FromBytesPerSecond(1000 * 1000)));
+  EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
+  const QuicStreamId stream_id =
+      GetNthClientInitiatedStreamId(1, connection_.transport_version());
+  const size_t kNumPackets = 5;
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    connection_.SendStreamDataWithString(stream_id, std::string(1000, 'a'),
+                                         i * 1000, NO_FIN);
+  }
+  // Every packet is written right away, the later ones with increasing
+  // release time delays for the kernel to pace them, rather than waiting for
+  // the send alarm.
+  EXPECT_FALSE(connection_.GetSendAlarm()->IsSet());
+  const std::vector<QuicTime::Delta>& delays = writer_->release_time_delays();
+  ASSERT_EQ(kNumPackets, delays.size());
+  EXPECT_EQ(QuicTime::Delta::Zero(), delays[0]);
+  for (size_t i = 1; i < delays.size(); ++i) {
+    EXPECT_LT(delays[i - 1], delays[i]);
+  }
+  EXPECT_GE(QuicTime::Delta::FromMilliseconds(10), delays.back());
+
+  QuicTagVector connection_options;
+  connection_options.push_back(kNPCO);
+  config.SetConnectionOptionsToSend(connection_options);
+  EXPECT_CALL(*send_algorithm_, SetFromConfig(_, _));
+  connection_.SetFromConfig(config);
+  EXPECT_EQ(nullptr, QuicConnectionPeer::GetPerPacketOptions(&connection_));
+}
+
 // Regression test for b/110259444
 // Get a path response without having issued a path challenge...
 TEST_P(QuicConnectionTest, OrphanPathResponse) {
@@ -11361,7 +11454,8 @@ TEST_P(QuicConnectionTest, DuplicateAckCausesLostPackets) {
                       Return(LossDetectionInterface::DetectionStats())));
   ProcessAckPacket(1, &frame);
   EXPECT_TRUE(connection_.BlackholeDetectionInProgress());
-  QuicAlarm* retransmission_alarm = connection_.GetRetransmissionAlarm();
+  QuicTestAlarmProxy retransmission_alarm =
+      connection_.GetRetransmissionAlarm();
   EXPECT_TRUE(retransmission_alarm->IsSet());
 
   // ACK packet 1 - 5 and 7.
@@ -11585,10 +11679,8 @@ TEST_P(QuicConnectionTest, PathValidationRetry) {
   // Retry after time out.
   clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(3 * kInitialRttMs));
   static_cast<test::MockRandom*>(helper_->GetRandomGenerator())->ChangeValue();
-  static_cast<TestAlarmFactory::TestAlarm*>(
-      QuicPathValidatorPeer::retry_timer(
-          QuicConnectionPeer::path_validator(&connection_)))
-      ->Fire();
+  QuicAlarmPeer::Fire(QuicPathValidatorPeer::retry_timer(
+      QuicConnectionPeer::path_validator(&connection_)));
   EXPECT_EQ(2u, writer_->packets_write_attempts());
 }
 
@@ -11734,10 +11826,8 @@ TEST_P(QuicConnectionTest, SendPathChallengeUsingBlockedDefaultSocket) {
   // PATH_CHALLENGE shouldn't be serialized, but be dropped.
   clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(3 * kInitialRttMs));
   static_cast<test::MockRandom*>(helper_->GetRandomGenerator())->ChangeValue();
-  static_cast<TestAlarmFactory::TestAlarm*>(
-      QuicPathValidatorPeer::retry_timer(
-          QuicConnectionPeer::path_validator(&connection_)))
-      ->Fire();
+  QuicAlarmPeer::Fire(QuicPathValidatorPeer::retry_timer(
+      QuicConnectionPeer::path_validator(&connection_)));
 
   // No more write attempt should be made.
   EXPECT_EQ(1u, writer_->packets_write_attempts());
@@ -13457,7 +13547,7 @@ TEST_P(QuicConnectionTest, PathChallengeBeforePeerIpAddressChangeAtServer) {
   EXPECT_TRUE(alternative_path->client_connection_id.IsEmpty());
   EXPECT_TRUE(alternative_path->server_connection_id.IsEmpty());
   EXPECT_FALSE(alternative_path->stateless_reset_token.has_value());
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_TRUE(retire_peer_issued_cid_alarm->IsSet());
   EXPECT_CALL(visitor_, SendRetireConnectionId(/*sequence_number=*/0u));
@@ -13692,15 +13782,11 @@ TEST_P(QuicConnectionTest, NoNonProbingFrameOnAlternativePath) {
           EXPECT_FALSE(writer_->ack_frames().empty());
           EXPECT_FALSE(writer_->window_update_frames().empty());
         }));
-    static_cast<TestAlarmFactory::TestAlarm*>(
-        QuicPathValidatorPeer::retry_timer(
-            QuicConnectionPeer::path_validator(&connection_)))
-        ->Fire();
+    QuicAlarmPeer::Fire(QuicPathValidatorPeer::retry_timer(
+        QuicConnectionPeer::path_validator(&connection_)));
   } else {
-    EXPECT_QUIC_BUG(static_cast<TestAlarmFactory::TestAlarm*>(
-                        QuicPathValidatorPeer::retry_timer(
-                            QuicConnectionPeer::path_validator(&connection_)))
-                        ->Fire(),
+    EXPECT_QUIC_BUG(QuicAlarmPeer::Fire(QuicPathValidatorPeer::retry_timer(
+                        QuicConnectionPeer::path_validator(&connection_))),
                     "quic_bug_12645_2");
   }
 }
@@ -13860,7 +13946,7 @@ TEST_P(QuicConnectionTest,
   ASSERT_EQ(packet_creator->GetDestinationConnectionId(), server_cid1);
 
   // Client will retire server connection ID on old default_path.
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_TRUE(retire_peer_issued_cid_alarm->IsSet());
   EXPECT_CALL(visitor_, SendRetireConnectionId(/*sequence_number=*/0u));
@@ -13930,7 +14016,7 @@ TEST_P(QuicConnectionTest, ServerConnectionIdRetiredUponPathValidationFailure) {
   EXPECT_FALSE(alternative_path->stateless_reset_token.has_value());
 
   // Client will retire server connection ID on alternative_path.
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_TRUE(retire_peer_issued_cid_alarm->IsSet());
   EXPECT_CALL(visitor_, SendRetireConnectionId(/*sequence_number=*/1u));
@@ -14006,7 +14092,7 @@ TEST_P(QuicConnectionTest,
   EXPECT_EQ(default_path->stateless_reset_token, frame1.stateless_reset_token);
 
   // Client will retire server connection ID on old default_path.
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_TRUE(retire_peer_issued_cid_alarm->IsSet());
   EXPECT_CALL(visitor_, SendRetireConnectionId(/*sequence_number=*/0u));
@@ -14095,7 +14181,7 @@ TEST_P(QuicConnectionTest,
   frame.retire_prior_to = 0u;
 
   EXPECT_TRUE(connection_.OnNewConnectionIdFrame(frame));
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_FALSE(retire_peer_issued_cid_alarm->IsSet());
 
@@ -14132,7 +14218,7 @@ TEST_P(QuicConnectionTest,
   frame.retire_prior_to = 0u;
 
   EXPECT_TRUE(connection_.OnNewConnectionIdFrame(frame));
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_FALSE(retire_peer_issued_cid_alarm->IsSet());
 
@@ -14186,7 +14272,7 @@ TEST_P(
   frame.retire_prior_to = 0u;
 
   EXPECT_TRUE(connection_.OnNewConnectionIdFrame(frame));
-  auto* retire_peer_issued_cid_alarm =
+  auto retire_peer_issued_cid_alarm =
       connection_.GetRetirePeerIssuedConnectionIdAlarm();
   ASSERT_FALSE(retire_peer_issued_cid_alarm->IsSet());
 
@@ -14265,7 +14351,7 @@ TEST_P(QuicConnectionTest,
   set_perspective(Perspective::IS_SERVER);
   connection_.CreateConnectionIdManager();
 
-  auto* retire_self_issued_cid_alarm =
+  auto retire_self_issued_cid_alarm =
       connection_.GetRetireSelfIssuedConnectionIdAlarm();
   ASSERT_FALSE(retire_self_issued_cid_alarm->IsSet());
 
@@ -14309,7 +14395,7 @@ TEST_P(QuicConnectionTest, ServerRetireSelfIssuedConnectionId) {
   connection_.MaybeSendConnectionIdToClient();
   cid1 = recorded_cid;
 
-  auto* retire_self_issued_cid_alarm =
+  auto retire_self_issued_cid_alarm =
       connection_.GetRetireSelfIssuedConnectionIdAlarm();
   ASSERT_FALSE(retire_self_issued_cid_alarm->IsSet());
 
@@ -15432,6 +15518,28 @@ TEST_P(QuicConnectionTest, EarliestSentTimeNotInitializedWhenPtoFires) {
   EXPECT_FALSE(connection_.GetRetransmissionAlarm()->IsSet());
 }
 
+TEST_P(QuicConnectionTest, AlarmsAreMultiplexedWhenEnabled) {
+  QuicAlarmMultiplexer* multiplexer =
+      QuicConnectionPeer::GetAlarmMultiplexer(&connection_);
+  if (!multiplex_alarms_) {
+    EXPECT_EQ(nullptr, multiplexer);
+    return;
+  }
+  ASSERT_NE(nullptr, multiplexer);
+  // All of the connection's own alarms fit in the multiplexer.
+  const int num_alarms = multiplexer->num_alarms();
+  EXPECT_GT(num_alarms, 0);
+  EXPECT_LT(num_alarms, QuicAlarmMultiplexer::kMaxAlarms);
+
+  // Alarms are set and fired through the multiplexer like any other alarm.
+  EXPECT_FALSE(connection_.GetSendAlarm()->IsSet());
+  connection_.GetSendAlarm()->Set(clock_.ApproximateNow() +
+                                  QuicTime::Delta::FromMilliseconds(1));
+  EXPECT_TRUE(connection_.GetSendAlarm()->IsSet());
+  connection_.GetSendAlarm()->Cancel();
+  EXPECT_FALSE(connection_.GetSendAlarm()->IsSet());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
@@ -17,6 +17,7 @@
 #include "quiche/quic/core/quic_connection_id.h"
 #include "quiche/quic/core/quic_error_codes.h"
 #include "quiche/quic/core/quic_session.h"
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
 #include "quiche/quic/core/quic_time_wait_list_manager.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/core/quic_utils.h"
@@ -355,6 +356,14 @@ QuicDispatcher::QuicDispatcher(
       should_update_expected_server_connection_id_length_(false) {
   QUIC_BUG_IF(quic_bug_12724_1, GetSupportedVersions().empty())
       << "Trying to create dispatcher without any supported versions";
+  if (GetQuicReloadableFlag(quic_dispatcher_flat_session_table) &&
+      expected_server_connection_id_length_ > 0 &&
+      expected_server_connection_id_length_ <=
+          kQuicMaxConnectionIdWithLengthPrefixLength) {
+    QUIC_RELOADABLE_FLAG_COUNT(quic_dispatcher_flat_session_table);
+    session_table_ = std::make_unique<QuicSessionTable>(
+        expected_server_connection_id_length_, helper_->GetRandomGenerator());
+  }
   QUIC_DLOG(INFO) << "Created QuicDispatcher with versions: "
                   << ParsedQuicVersionVectorToString(GetSupportedVersions());
 }
@@ -367,6 +376,9 @@ QuicDispatcher::~QuicDispatcher() {
     clear_stateless_reset_addresses_alarm_->PermanentCancel();
   }
   reference_counted_session_map_.clear();
+  if (session_table_ != nullptr) {
+    session_table_->Clear();
+  }
   closed_session_list_.clear();
   num_sessions_in_session_map_ = 0;
 }
@@ -385,59 +397,66 @@ void QuicDispatcher::ProcessPacket(const QuicSocketAddress& self_address,
                 << quiche::QuicheTextUtils::HexDump(
                        absl::string_view(packet.data(), packet.length()));
   ReceivedPacketInfo packet_info(self_address, peer_address, packet);
+  if (!ParsePacketHeader(&packet_info)) {
+    return;
+  }
+  if (MaybeDispatchPacket(packet_info)) {
+    // Packet has been dropped or successfully dispatched, stop processing.
+    return;
+  }
+  ProcessHeader(&packet_info);
+}
+
+bool QuicDispatcher::ParsePacketHeader(ReceivedPacketInfo* packet_info) {
+  const QuicReceivedPacket& packet = packet_info->packet;
   std::string detailed_error;
   const QuicErrorCode error = QuicFramer::ParsePublicHeaderDispatcher(
-      packet, expected_server_connection_id_length_, &packet_info.form,
-      &packet_info.long_packet_type, &packet_info.version_flag,
-      &packet_info.use_length_prefix, &packet_info.version_label,
-      &packet_info.version, &packet_info.destination_connection_id,
-      &packet_info.source_connection_id, &packet_info.retry_token,
+      packet, expected_server_connection_id_length_, &packet_info->form,
+      &packet_info->long_packet_type, &packet_info->version_flag,
+      &packet_info->use_length_prefix, &packet_info->version_label,
+      &packet_info->version, &packet_info->destination_connection_id,
+      &packet_info->source_connection_id, &packet_info->retry_token,
       &detailed_error);
   if (error != QUIC_NO_ERROR) {
     // Packet has framing error.
     SetLastError(error);
     QUIC_DLOG(ERROR) << detailed_error;
-    return;
+    return false;
   }
-  if (packet_info.destination_connection_id.length() !=
+  if (packet_info->destination_connection_id.length() !=
           expected_server_connection_id_length_ &&
       !should_update_expected_server_connection_id_length_ &&
-      packet_info.version.IsKnown() &&
-      !packet_info.version.AllowsVariableLengthConnectionIds()) {
+      packet_info->version.IsKnown() &&
+      !packet_info->version.AllowsVariableLengthConnectionIds()) {
     SetLastError(QUIC_INVALID_PACKET_HEADER);
     QUIC_DLOG(ERROR) << "Invalid Connection Id Length";
-    return;
+    return false;
   }
 
-  if (packet_info.version_flag && IsSupportedVersion(packet_info.version)) {
+  if (packet_info->version_flag && IsSupportedVersion(packet_info->version)) {
     if (!QuicUtils::IsConnectionIdValidForVersion(
-            packet_info.destination_connection_id,
-            packet_info.version.transport_version)) {
+            packet_info->destination_connection_id,
+            packet_info->version.transport_version)) {
       SetLastError(QUIC_INVALID_PACKET_HEADER);
       QUIC_DLOG(ERROR)
           << "Invalid destination connection ID length for version";
-      return;
+      return false;
     }
-    if (packet_info.version.SupportsClientConnectionIds() &&
+    if (packet_info->version.SupportsClientConnectionIds() &&
         !QuicUtils::IsConnectionIdValidForVersion(
-            packet_info.source_connection_id,
-            packet_info.version.transport_version)) {
+            packet_info->source_connection_id,
+            packet_info->version.transport_version)) {
       SetLastError(QUIC_INVALID_PACKET_HEADER);
       QUIC_DLOG(ERROR) << "Invalid source connection ID length for version";
-      return;
+      return false;
     }
   }
 
   if (should_update_expected_server_connection_id_length_) {
     expected_server_connection_id_length_ =
-        packet_info.destination_connection_id.length();
-  }
-
-  if (MaybeDispatchPacket(packet_info)) {
-    // Packet has been dropped or successfully dispatched, stop processing.
-    return;
+        packet_info->destination_connection_id.length();
   }
-  ProcessHeader(&packet_info);
+  return true;
 }
 
 QuicConnectionId QuicDispatcher::MaybeReplaceServerConnectionId(
@@ -579,11 +598,10 @@ bool QuicDispatcher::MaybeDispatchPacket(
 
   // Packets with connection IDs for active connections are processed
   // immediately.
-  auto it = reference_counted_session_map_.find(server_connection_id);
-  if (it != reference_counted_session_map_.end()) {
+  QuicSession* session = FindSession(server_connection_id);
+  if (session != nullptr) {
     QUICHE_DCHECK(!buffered_packets_.HasBufferedPackets(server_connection_id));
-    if (packet_info.version_flag &&
-        packet_info.version != it->second->version() &&
+    if (packet_info.version_flag && packet_info.version != session->version() &&
         packet_info.version == LegacyVersionForEncapsulation()) {
       // This packet is using the Legacy Version Encapsulation version but the
       // corresponding session isn't, attempt extraction of inner packet.
@@ -600,8 +618,8 @@ bool QuicDispatcher::MaybeDispatchPacket(
         }
       }
     }
-    it->second->ProcessUdpPacket(packet_info.self_address,
-                                 packet_info.peer_address, packet_info.packet);
+    session->ProcessUdpPacket(packet_info.self_address,
+                              packet_info.peer_address, packet_info.packet);
     return true;
   }
   if (packet_info.version.IsKnown()) {
@@ -615,13 +633,13 @@ bool QuicDispatcher::MaybeDispatchPacket(
         server_connection_id, packet_info.version);
     if (replaced_connection_id != server_connection_id) {
       // Search for the replacement.
-      auto it2 = reference_counted_session_map_.find(replaced_connection_id);
-      if (it2 != reference_counted_session_map_.end()) {
+      QuicSession* replaced_session = FindSession(replaced_connection_id);
+      if (replaced_session != nullptr) {
         QUICHE_DCHECK(
             !buffered_packets_.HasBufferedPackets(replaced_connection_id));
-        it2->second->ProcessUdpPacket(packet_info.self_address,
-                                      packet_info.peer_address,
-                                      packet_info.packet);
+        replaced_session->ProcessUdpPacket(packet_info.self_address,
+                                           packet_info.peer_address,
+                                           packet_info.packet);
         return true;
       }
     }
@@ -704,6 +722,119 @@ bool QuicDispatcher::MaybeDispatchPacket(
   return false;
 }
 
+void QuicDispatcher::ProcessPackets(
+    absl::Span<const ReceivedUdpPacket> packets) {
+  // Parsing every header before dispatching any packet is only equivalent to
+  // ProcessPacket() if the expected connection ID length cannot change.
+  if (!GetQuicReloadableFlag(quic_dispatcher_batch_packets_by_connection) ||
+      should_update_expected_server_connection_id_length_ ||
+      packets.size() < 2) {
+    ProcessPacketInterface::ProcessPackets(packets);
+    return;
+  }
+  QUIC_RELOADABLE_FLAG_COUNT(quic_dispatcher_batch_packets_by_connection);
+
+  batch_packet_infos_.clear();
+  batch_packet_infos_.reserve(packets.size());
+  batch_packet_dispatched_.assign(packets.size(), false);
+  batch_packet_sessions_.assign(packets.size(), nullptr);
+  batch_packet_batchable_.assign(packets.size(), false);
+  for (size_t i = 0; i < packets.size(); ++i) {
+    const ReceivedUdpPacket& packet = packets[i];
+    QUIC_DVLOG(2) << "Dispatcher received encrypted "
+                  << packet.packet->length() << " bytes:" << std::endl
+                  << quiche::QuicheTextUtils::HexDump(absl::string_view(
+                         packet.packet->data(), packet.packet->length()));
+    batch_packet_infos_.emplace_back(packet.self_address, packet.peer_address,
+                                     *packet.packet);
+    if (!ParsePacketHeader(&batch_packet_infos_.back())) {
+      batch_packet_dispatched_[i] = true;
+    } else if (session_table_ != nullptr) {
+      // Loads the session table entries of the whole batch while the rest of
+      // it is parsed, instead of waiting for each of them when dispatching.
+      session_table_->Prefetch(
+          batch_packet_infos_.back().destination_connection_id);
+    }
+  }
+
+  // Looks up the session of every packet once, after all the prefetches have
+  // been issued, so that grouping below compares pointers rather than doing a
+  // lookup per pair of packets.
+  for (size_t i = 0; i < packets.size(); ++i) {
+    if (batch_packet_dispatched_[i]) {
+      continue;
+    }
+    const ReceivedPacketInfo& packet_info = batch_packet_infos_[i];
+    batch_packet_sessions_[i] =
+        FindSession(packet_info.destination_connection_id);
+    batch_packet_batchable_[i] = CanBatchPacket(packet_info);
+    QUICHE_DCHECK(!batch_packet_batchable_[i] ||
+                  batch_packet_sessions_[i] == nullptr ||
+                  !buffered_packets_.HasBufferedPackets(
+                      packet_info.destination_connection_id));
+  }
+
+  for (size_t i = 0; i < packets.size(); ++i) {
+    if (batch_packet_dispatched_[i]) {
+      continue;
+    }
+    ReceivedPacketInfo& packet_info = batch_packet_infos_[i];
+    batch_packet_dispatched_[i] = true;
+    QuicSession* session =
+        batch_packet_batchable_[i] ? batch_packet_sessions_[i] : nullptr;
+    // A session closed by an earlier packet of the batch is no longer mapped
+    // to its connection IDs, so its packets take the regular path.
+    if (session == nullptr || !session->connection()->connected()) {
+      if (!MaybeDispatchPacket(packet_info)) {
+        ProcessHeader(&packet_info);
+      }
+      continue;
+    }
+
+    // Group the later packets of the session, whichever of its connection IDs
+    // they carry, up to the first one which has to be dispatched on its own,
+    // so that they stay in order.
+    batch_group_.assign(1, i);
+    for (size_t j = i + 1; j < packets.size(); ++j) {
+      if (batch_packet_dispatched_[j] || batch_packet_sessions_[j] != session) {
+        continue;
+      }
+      if (!batch_packet_batchable_[j]) {
+        break;
+      }
+      batch_group_.push_back(j);
+      batch_packet_dispatched_[j] = true;
+    }
+    if (batch_group_.size() == 1) {
+      session->ProcessUdpPacket(packet_info.self_address,
+                                packet_info.peer_address, packet_info.packet);
+      continue;
+    }
+
+    batch_group_packets_.clear();
+    for (size_t index : batch_group_) {
+      batch_group_packets_.push_back(packets[index]);
+    }
+    const size_t num_processed =
+        session->ProcessUdpPackets(batch_group_packets_);
+    // The session closed its connection part way through the group. Its
+    // remaining packets go wherever ProcessPacket() would send them now.
+    for (size_t k = num_processed; k < batch_group_.size(); ++k) {
+      ReceivedPacketInfo& remaining = batch_packet_infos_[batch_group_[k]];
+      if (!MaybeDispatchPacket(remaining)) {
+        ProcessHeader(&remaining);
+      }
+    }
+  }
+}
+
+bool QuicDispatcher::CanBatchPacket(const ReceivedPacketInfo& packet_info) {
+  // Long header packets may need Legacy Version Encapsulation extraction or
+  // connection ID checks, see MaybeDispatchPacket().
+  return !packet_info.version_flag &&
+         !IsSourceUdpPortBlocked(packet_info.peer_address.port());
+}
+
 void QuicDispatcher::ProcessHeader(ReceivedPacketInfo* packet_info) {
   QuicConnectionId server_connection_id =
       packet_info->destination_connection_id;
@@ -731,6 +862,10 @@ void QuicDispatcher::ProcessHeader(ReceivedPacketInfo* packet_info) {
         return;
       }
 
+      if (MaybeRefuseHandshake(*packet_info)) {
+        return;
+      }
+
       ProcessChlo(*std::move(parsed_chlo), packet_info);
       return;
     }
@@ -980,6 +1115,17 @@ void QuicDispatcher::DeleteSessions() {
     }
   }
   closed_session_list_.clear();
+
+  if (num_sessions_in_session_map_ == 0) {
+    // The last session is gone; don't hold on to the buffers its streams
+    // retired while the dispatcher sits idle.
+    helper_->GetStreamSendBufferAllocator()->MarkAllocatorIdle();
+    QuicStreamSequencerBufferBlockPool* block_pool =
+        helper_->GetStreamSequencerBufferBlockPool();
+    if (block_pool != nullptr) {
+      block_pool->ReleaseRetainedBlocks();
+    }
+  }
 }
 
 void QuicDispatcher::ClearStatelessResetAddresses() {
@@ -1064,6 +1210,9 @@ void QuicDispatcher::OnConnectionClosed(QuicConnectionId server_connection_id,
   for (const QuicConnectionId& cid :
        connection->GetActiveServerConnectionIds()) {
     reference_counted_session_map_.erase(cid);
+    if (session_table_ != nullptr) {
+      session_table_->Erase(cid);
+    }
   }
   --num_sessions_in_session_map_;
 }
@@ -1104,11 +1253,19 @@ void QuicDispatcher::OnNewConnectionIdSent(
   auto insertion_result = reference_counted_session_map_.insert(
       std::make_pair(new_connection_id, it->second));
   QUICHE_DCHECK(insertion_result.second);
+  // |it| may have been invalidated by the insertion.
+  if (insertion_result.second && session_table_ != nullptr) {
+    session_table_->Insert(new_connection_id,
+                           insertion_result.first->second.get());
+  }
 }
 
 void QuicDispatcher::OnConnectionIdRetired(
     const QuicConnectionId& server_connection_id) {
   reference_counted_session_map_.erase(server_connection_id);
+  if (session_table_ != nullptr) {
+    session_table_->Erase(server_connection_id);
+  }
 }
 
 void QuicDispatcher::OnConnectionAddedToTimeWaitList(
@@ -1193,10 +1350,16 @@ void QuicDispatcher::OnExpiredPackets(
 }
 
 void QuicDispatcher::ProcessBufferedChlos(size_t max_connections_to_create) {
+  if (handshake_admission_controller_ != nullptr) {
+    max_connections_to_create =
+        handshake_admission_controller_->MaxSessionsPerEventLoop(
+            max_connections_to_create);
+  }
   // Reset the counter before starting creating connections.
   new_sessions_allowed_per_event_loop_ = max_connections_to_create;
   for (; new_sessions_allowed_per_event_loop_ > 0;
        --new_sessions_allowed_per_event_loop_) {
+    const QuicTime start = HandshakeProcessingStart();
     QuicConnectionId server_connection_id;
     BufferedPacketList packet_list =
         buffered_packets_.DeliverPacketsForNextConnection(
@@ -1235,8 +1398,13 @@ void QuicDispatcher::ProcessBufferedChlos(size_t max_connections_to_create) {
           << server_connection_id;
     } else {
       ++num_sessions_in_session_map_;
+      if (session_table_ != nullptr) {
+        session_table_->Insert(server_connection_id,
+                               insertion_result.first->second.get());
+      }
     }
     DeliverPacketsToSession(packets, insertion_result.first->second.get());
+    OnHandshakeProcessed(start);
   }
 }
 
@@ -1256,6 +1424,19 @@ bool QuicDispatcher::HasBufferedPackets(QuicConnectionId server_connection_id) {
   return buffered_packets_.HasBufferedPackets(server_connection_id);
 }
 
+QuicSession* QuicDispatcher::FindSession(
+    const QuicConnectionId& server_connection_id) const {
+  if (session_table_ != nullptr &&
+      session_table_->Handles(server_connection_id)) {
+    return session_table_->Find(server_connection_id);
+  }
+  auto it = reference_counted_session_map_.find(server_connection_id);
+  if (it == reference_counted_session_map_.end()) {
+    return nullptr;
+  }
+  return it->second.get();
+}
+
 void QuicDispatcher::OnBufferPacketFailure(
     EnqueuePacketResult result, QuicConnectionId server_connection_id) {
   QUIC_DLOG(INFO) << "Fail to buffer packet on connection "
@@ -1308,6 +1489,7 @@ void QuicDispatcher::ProcessChlo(ParsedClientHello parsed_chlo,
     return;
   }
 
+  const QuicTime start = HandshakeProcessingStart();
   QuicConnectionId original_connection_id =
       packet_info->destination_connection_id;
   packet_info->destination_connection_id = MaybeReplaceServerConnectionId(
@@ -1345,6 +1527,10 @@ void QuicDispatcher::ProcessChlo(ParsedClientHello parsed_chlo,
         << packet_info->destination_connection_id;
   } else {
     ++num_sessions_in_session_map_;
+    if (session_table_ != nullptr) {
+      session_table_->Insert(packet_info->destination_connection_id,
+                             insertion_result.first->second.get());
+    }
   }
   session_ptr = insertion_result.first->second.get();
   std::list<BufferedPacket> packets =
@@ -1361,6 +1547,59 @@ void QuicDispatcher::ProcessChlo(ParsedClientHello parsed_chlo,
   // buffered in the store before flag is turned off.
   DeliverPacketsToSession(packets, session_ptr);
   --new_sessions_allowed_per_event_loop_;
+  OnHandshakeProcessed(start);
+}
+
+void QuicDispatcher::SetHandshakeAdmissionController(
+    std::unique_ptr<QuicHandshakeAdmissionController> controller) {
+  handshake_admission_controller_ = std::move(controller);
+}
+
+bool QuicDispatcher::MaybeRefuseHandshake(
+    const ReceivedPacketInfo& packet_info) {
+  if (handshake_admission_controller_ == nullptr) {
+    return false;
+  }
+  // The packet's receipt time is taken when it is read, so only the kernel's
+  // timestamp accounts for the time it waited in the socket queue, which is
+  // where an overloaded event loop's lag builds up.
+  const QuicClock* clock = helper_->GetClock();
+  const QuicWallTime kernel_receipt_time =
+      packet_info.packet.kernel_receipt_time();
+  const QuicTime receipt_time =
+      kernel_receipt_time.IsZero()
+          ? packet_info.packet.receipt_time()
+          : clock->ConvertWallTimeToQuicTime(kernel_receipt_time);
+  if (handshake_admission_controller_->ShouldAdmitHandshake(
+          packet_info.peer_address.host(), receipt_time, clock->Now())) {
+    return false;
+  }
+  QUIC_CODE_COUNT(quic_dispatcher_refused_handshake_under_load);
+  StatelesslyTerminateConnection(
+      packet_info.destination_connection_id, packet_info.form,
+      packet_info.version_flag, packet_info.use_length_prefix,
+      packet_info.version, QUIC_SERVER_OVERLOADED, "Server overloaded",
+      QuicTimeWaitListManager::SEND_CONNECTION_CLOSE_PACKETS);
+  time_wait_list_manager_->ProcessPacket(
+      packet_info.self_address, packet_info.peer_address,
+      packet_info.destination_connection_id, packet_info.form,
+      packet_info.packet.length(), GetPerPacketContext());
+  buffered_packets_.DiscardPackets(packet_info.destination_connection_id);
+  OnNewConnectionRejected();
+  return true;
+}
+
+QuicTime QuicDispatcher::HandshakeProcessingStart() const {
+  return handshake_admission_controller_ == nullptr
+             ? QuicTime::Zero()
+             : helper_->GetClock()->Now();
+}
+
+void QuicDispatcher::OnHandshakeProcessed(QuicTime start) {
+  if (handshake_admission_controller_ != nullptr) {
+    handshake_admission_controller_->OnHandshakeProcessed(
+        helper_->GetClock()->Now() - start);
+  }
 }
 
 bool QuicDispatcher::ShouldDestroySessionAsynchronously() { return true; }
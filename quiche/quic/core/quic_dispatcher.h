@@ -15,6 +15,7 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/quic_compressed_certs_cache.h"
 #include "quiche/quic/core/crypto/quic_random.h"
 #include "quiche/quic/core/quic_blocked_writer_interface.h"
@@ -22,9 +23,11 @@
 #include "quiche/quic/core/quic_connection.h"
 #include "quiche/quic/core/quic_connection_id.h"
 #include "quiche/quic/core/quic_crypto_server_stream_base.h"
+#include "quiche/quic/core/quic_handshake_admission_controller.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/core/quic_process_packet_interface.h"
 #include "quiche/quic/core/quic_session.h"
+#include "quiche/quic/core/quic_session_table.h"
 #include "quiche/quic/core/quic_time_wait_list_manager.h"
 #include "quiche/quic/core/quic_version_manager.h"
 #include "quiche/quic/platform/api/quic_socket_address.h"
@@ -69,6 +72,12 @@ class QUIC_NO_EXPORT QuicDispatcher
                      const QuicSocketAddress& peer_address,
                      const QuicReceivedPacket& packet) override;
 
+  // Processes a batch of packets as ProcessPacket() does, except that the short
+  // header packets of the batch for the same existing session are passed to it
+  // in one call, which decides on acks and writes once for all of them.
+  // Packets are only reordered across sessions.
+  void ProcessPackets(absl::Span<const ReceivedUdpPacket> packets) override;
+
   // Called when the socket becomes writable to allow queued writes to happen.
   virtual void OnCanWrite();
 
@@ -125,7 +134,8 @@ class QUIC_NO_EXPORT QuicDispatcher
 
   size_t NumSessions() const;
 
-  // Deletes all sessions on the closed session list and clears the list.
+  // Deletes all sessions on the closed session list and clears the list. Once
+  // no sessions remain, frees the buffers cached by the helper's allocators.
   virtual void DeleteSessions();
 
   // Clear recent_stateless_reset_addresses_.
@@ -146,6 +156,17 @@ class QUIC_NO_EXPORT QuicDispatcher
   // Return true if there is CHLO buffered.
   virtual bool HasChlosBuffered() const;
 
+  // Lets |controller| decide which new connections get a session, and how
+  // many sessions ProcessBufferedChlos() creates. Refused connections are
+  // closed statelessly with QUIC_SERVER_OVERLOADED.
+  void SetHandshakeAdmissionController(
+      std::unique_ptr<QuicHandshakeAdmissionController> controller);
+
+  const QuicHandshakeAdmissionController* handshake_admission_controller()
+      const {
+    return handshake_admission_controller_.get();
+  }
+
   // Start accepting new ConnectionIds.
   void StartAcceptingNewConnections();
 
@@ -297,6 +318,10 @@ class QUIC_NO_EXPORT QuicDispatcher
 
   bool HasBufferedPackets(QuicConnectionId server_connection_id);
 
+  // Returns the session that |server_connection_id| maps to, or nullptr if
+  // there is none.
+  QuicSession* FindSession(const QuicConnectionId& server_connection_id) const;
+
   // Called when BufferEarlyPacket() fail to buffer the packet.
   virtual void OnBufferPacketFailure(
       QuicBufferedPacketStore::EnqueuePacketResult result,
@@ -351,10 +376,12 @@ class QUIC_NO_EXPORT QuicDispatcher
   std::string SelectAlpn(const std::vector<std::string>& alpns);
 
   // If the connection ID length is different from what the dispatcher expects,
-  // replace the connection ID with one of the right length.
+  // replace the connection ID with one of the right length. Subclasses may
+  // also replace connection IDs of the expected length, e.g. to encode routing
+  // information in them.
   // Note that this MUST produce a deterministic result (calling this method
   // with two connection IDs that are equal must produce the same result).
-  QuicConnectionId MaybeReplaceServerConnectionId(
+  virtual QuicConnectionId MaybeReplaceServerConnectionId(
       const QuicConnectionId& server_connection_id,
       const ParsedQuicVersion& version) const;
 
@@ -366,10 +393,28 @@ class QUIC_NO_EXPORT QuicDispatcher
  private:
   friend class test::QuicDispatcherPeer;
 
+  // Parses the public header of |packet_info->packet| into |packet_info|.
+  // Returns false if the packet is to be dropped.
+  bool ParsePacketHeader(ReceivedPacketInfo* packet_info);
+
+  // Returns true if a packet with a parsed header can be passed to its session
+  // along with other packets of its batch, false if it needs to go through
+  // MaybeDispatchPacket() on its own.
+  bool CanBatchPacket(const ReceivedPacketInfo& packet_info);
+
   // TODO(fayang): Consider to rename this function to
   // ProcessValidatedPacketWithUnknownConnectionId.
   void ProcessHeader(ReceivedPacketInfo* packet_info);
 
+  // Closes the connection of the client hello in |packet_info| if the
+  // handshake admission controller refuses it. Returns true if it did.
+  bool MaybeRefuseHandshake(const ReceivedPacketInfo& packet_info);
+
+  // Returns the time a handshake starts being processed, to be passed to
+  // OnHandshakeProcessed() once the session processed its first packets.
+  QuicTime HandshakeProcessingStart() const;
+  void OnHandshakeProcessed(QuicTime start);
+
   // Try to extract information(sni, alpns, ...) if the full Client Hello has
   // been parsed.
   //
@@ -401,6 +446,11 @@ class QUIC_NO_EXPORT QuicDispatcher
 
   ReferenceCountedSessionMap reference_counted_session_map_;
 
+  // Sessions of reference_counted_session_map_ by their connection IDs of the
+  // expected length, which FindSession() looks up instead of the map. Only
+  // set if quic_dispatcher_flat_session_table was enabled on construction.
+  std::unique_ptr<QuicSessionTable> session_table_;
+
   // Entity that manages connection_ids in time wait state.
   std::unique_ptr<QuicTimeWaitListManager> time_wait_list_manager_;
 
@@ -440,6 +490,10 @@ class QUIC_NO_EXPORT QuicDispatcher
   // event loop. When reaches 0, it means can't create sessions for now.
   int16_t new_sessions_allowed_per_event_loop_;
 
+  // Decides which new connections get a session, if set.
+  std::unique_ptr<QuicHandshakeAdmissionController>
+      handshake_admission_controller_;
+
   // True if this dispatcher is accepting new ConnectionIds (new client
   // connections), false otherwise.
   bool accept_new_connections_;
@@ -467,6 +521,18 @@ class QUIC_NO_EXPORT QuicDispatcher
   // If true, change expected_server_connection_id_length_ to be the received
   // destination connection ID length of all IETF long headers.
   bool should_update_expected_server_connection_id_length_;
+
+  // Scratch space of ProcessPackets(), kept to reuse its storage. The parsed
+  // packets of the batch, whether each of them has been dispatched, the
+  // session each of them was mapped to when the batch was read, whether each
+  // of them can be grouped with others, and the indices of the packets passed
+  // to a session together.
+  std::vector<ReceivedPacketInfo> batch_packet_infos_;
+  std::vector<bool> batch_packet_dispatched_;
+  std::vector<QuicSession*> batch_packet_sessions_;
+  std::vector<bool> batch_packet_batchable_;
+  std::vector<size_t> batch_group_;
+  std::vector<ReceivedUdpPacket> batch_group_packets_;
 };
 
 }  // namespace quic
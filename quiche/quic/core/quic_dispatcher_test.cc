@@ -8,6 +8,7 @@
 #include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/str_cat.h"
@@ -24,6 +25,7 @@
 #include "quiche/quic/core/quic_packet_writer_wrapper.h"
 #include "quiche/quic/core/quic_time_wait_list_manager.h"
 #include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
 #include "quiche/quic/core/quic_utils.h"
 #include "quiche/quic/core/quic_versions.h"
 #include "quiche/quic/platform/api/quic_expect_bug.h"
@@ -41,6 +43,7 @@
 #include "quiche/quic/test_tools/quic_test_utils.h"
 #include "quiche/quic/test_tools/quic_time_wait_list_manager_peer.h"
 #include "quiche/quic/tools/quic_simple_crypto_server_stream_helper.h"
+#include "quiche/common/quiche_slab_buffer_allocator.h"
 #include "quiche/common/test_tools/quiche_test_utils.h"
 
 using testing::_;
@@ -756,6 +759,92 @@ TEST_P(QuicDispatcherTestAllVersions, ProcessPackets) {
   ProcessPacket(client_address, TestConnectionId(1), false, "data");
 }
 
+TEST_P(QuicDispatcherTestAllVersions, ProcessPacketsGroupsByConnection) {
+  SetQuicReloadableFlag(quic_dispatcher_batch_packets_by_connection, true);
+  QuicSocketAddress client_address(QuicIpAddress::Loopback4(), 1);
+
+  EXPECT_CALL(
+      *dispatcher_,
+      CreateQuicSession(TestConnectionId(1), _, client_address,
+                        Eq(ExpectedAlpn()), _, Eq(ParsedClientHelloForTest())))
+      .WillOnce(Return(ByMove(CreateSession(
+          dispatcher_.get(), config_, TestConnectionId(1), client_address,
+          &mock_helper_, &mock_alarm_factory_, &crypto_config_,
+          QuicDispatcherPeer::GetCache(dispatcher_.get()), &session1_))));
+  EXPECT_CALL(*reinterpret_cast<MockQuicConnection*>(session1_->connection()),
+              ProcessUdpPacket(_, _, _))
+      .WillOnce(WithArg<2>(Invoke([this](const QuicEncryptedPacket& packet) {
+        ValidatePacket(TestConnectionId(1), packet);
+      })));
+  EXPECT_CALL(*dispatcher_,
+              ShouldCreateOrBufferPacketForConnection(
+                  ReceivedPacketInfoConnectionIdEquals(TestConnectionId(1))));
+  ProcessFirstFlight(client_address, TestConnectionId(1));
+
+  EXPECT_CALL(
+      *dispatcher_,
+      CreateQuicSession(TestConnectionId(2), _, client_address,
+                        Eq(ExpectedAlpn()), _, Eq(ParsedClientHelloForTest())))
+      .WillOnce(Return(ByMove(CreateSession(
+          dispatcher_.get(), config_, TestConnectionId(2), client_address,
+          &mock_helper_, &mock_alarm_factory_, &crypto_config_,
+          QuicDispatcherPeer::GetCache(dispatcher_.get()), &session2_))));
+  EXPECT_CALL(*reinterpret_cast<MockQuicConnection*>(session2_->connection()),
+              ProcessUdpPacket(_, _, _))
+      .WillOnce(WithArg<2>(Invoke([this](const QuicEncryptedPacket& packet) {
+        ValidatePacket(TestConnectionId(2), packet);
+      })));
+  EXPECT_CALL(*dispatcher_,
+              ShouldCreateOrBufferPacketForConnection(
+                  ReceivedPacketInfoConnectionIdEquals(TestConnectionId(2))));
+  ProcessFirstFlight(client_address, TestConnectionId(2));
+
+  // A batch of packets of the two connections, interleaved.
+  const QuicConnectionId connection_ids[] = {
+      TestConnectionId(1), TestConnectionId(2), TestConnectionId(1),
+      TestConnectionId(2), TestConnectionId(1)};
+  ParsedQuicVersionVector versions(SupportedVersions(version_));
+  std::vector<std::unique_ptr<QuicReceivedPacket>> received_packets;
+  std::vector<ReceivedUdpPacket> batch;
+  uint64_t packet_number = 2;
+  for (const QuicConnectionId& connection_id : connection_ids) {
+    std::unique_ptr<QuicEncryptedPacket> packet(ConstructEncryptedPacket(
+        connection_id, EmptyQuicConnectionId(), false, false, packet_number++,
+        "data", true, CONNECTION_ID_PRESENT, CONNECTION_ID_ABSENT,
+        PACKET_4BYTE_PACKET_NUMBER, &versions));
+    received_packets.emplace_back(
+        ConstructReceivedPacket(*packet, mock_helper_.GetClock()->Now()));
+    data_connection_map_[connection_id].push_back(std::string(
+        received_packets.back()->data(), received_packets.back()->length()));
+    batch.push_back(
+        {server_address_, client_address, received_packets.back().get()});
+  }
+
+  // Each connection gets its packets in order, and in one go.
+  std::vector<QuicConnectionId> processed;
+  EXPECT_CALL(*reinterpret_cast<MockQuicConnection*>(session1_->connection()),
+              ProcessUdpPacket(_, _, _))
+      .Times(3)
+      .WillRepeatedly(WithArg<2>(
+          Invoke([this, &processed](const QuicEncryptedPacket& packet) {
+            ValidatePacket(TestConnectionId(1), packet);
+            processed.push_back(TestConnectionId(1));
+          })));
+  EXPECT_CALL(*reinterpret_cast<MockQuicConnection*>(session2_->connection()),
+              ProcessUdpPacket(_, _, _))
+      .Times(2)
+      .WillRepeatedly(WithArg<2>(
+          Invoke([this, &processed](const QuicEncryptedPacket& packet) {
+            ValidatePacket(TestConnectionId(2), packet);
+            processed.push_back(TestConnectionId(2));
+          })));
+  dispatcher_->ProcessPackets(batch);
+  EXPECT_EQ(std::vector<QuicConnectionId>(
+                {TestConnectionId(1), TestConnectionId(1), TestConnectionId(1),
+                 TestConnectionId(2), TestConnectionId(2)}),
+            processed);
+}
+
 // Regression test of b/93325907.
 TEST_P(QuicDispatcherTestAllVersions, DispatcherDoesNotRejectPacketNumberZero) {
   QuicSocketAddress client_address(QuicIpAddress::Loopback4(), 1);
@@ -935,6 +1024,57 @@ TEST_P(QuicDispatcherTestAllVersions, TimeWaitListManager) {
   ProcessPacket(client_address, connection_id, true, "data");
 }
 
+TEST_P(QuicDispatcherTestAllVersions, ReleasesCachedBuffersOnceIdle) {
+  CreateTimeWaitListManager();
+  QuicStreamSequencerBufferBlockPool block_pool(/*max_retained_blocks=*/4);
+  block_pool.Release(block_pool.Acquire());
+  quiche::QuicheSlabBufferAllocator slab_allocator;
+  slab_allocator.Delete(slab_allocator.New(100));
+  ASSERT_LT(0u, slab_allocator.slab_bytes());
+  MockQuicConnectionHelper* helper = static_cast<MockQuicConnectionHelper*>(
+      QuicDispatcherPeer::GetHelper(dispatcher_.get()));
+  quiche::QuicheBufferAllocator* default_allocator =
+      helper->GetStreamSendBufferAllocator();
+  helper->set_stream_sequencer_buffer_block_pool(&block_pool);
+  helper->set_stream_send_buffer_allocator(&slab_allocator);
+
+  QuicSocketAddress client_address(QuicIpAddress::Loopback4(), 1);
+  QuicConnectionId connection_id = TestConnectionId(1);
+  EXPECT_CALL(*dispatcher_, CreateQuicSession(connection_id, _, client_address,
+                                              Eq(ExpectedAlpn()), _, _))
+      .WillOnce(Return(ByMove(CreateSession(
+          dispatcher_.get(), config_, connection_id, client_address,
+          &mock_helper_, &mock_alarm_factory_, &crypto_config_,
+          QuicDispatcherPeer::GetCache(dispatcher_.get()), &session1_))));
+  EXPECT_CALL(*reinterpret_cast<MockQuicConnection*>(session1_->connection()),
+              ProcessUdpPacket(_, _, _))
+      .WillOnce(WithArg<2>(Invoke([this](const QuicEncryptedPacket& packet) {
+        ValidatePacket(TestConnectionId(1), packet);
+      })));
+  EXPECT_CALL(*dispatcher_,
+              ShouldCreateOrBufferPacketForConnection(
+                  ReceivedPacketInfoConnectionIdEquals(TestConnectionId(1))));
+  ProcessFirstFlight(client_address, connection_id);
+
+  // The buffers are kept while a session is open.
+  dispatcher_->DeleteSessions();
+  EXPECT_EQ(1u, block_pool.retained_blocks());
+  EXPECT_LT(0u, slab_allocator.slab_bytes());
+
+  session1_->connection()->CloseConnection(
+      QUIC_PEER_GOING_AWAY, "Closed by test.",
+      ConnectionCloseBehavior::SILENT_CLOSE);
+  EXPECT_EQ(0u, dispatcher_->NumSessions());
+  EXPECT_EQ(1u, block_pool.retained_blocks());
+
+  dispatcher_->DeleteSessions();
+  MarkSession1Deleted();
+  EXPECT_EQ(0u, block_pool.retained_blocks());
+  EXPECT_EQ(0u, slab_allocator.slab_bytes());
+  helper->set_stream_sequencer_buffer_block_pool(nullptr);
+  helper->set_stream_send_buffer_allocator(default_allocator);
+}
+
 TEST_P(QuicDispatcherTestAllVersions, NoVersionPacketToTimeWaitListManager) {
   CreateTimeWaitListManager();
 
@@ -1838,6 +1978,61 @@ TEST_P(QuicDispatcherTestAllVersions, StartAcceptingNewConnections) {
   ProcessFirstFlight(client_address, TestConnectionId(1));
 }
 
+TEST_P(QuicDispatcherTestAllVersions, AdmissionControllerRefusesHandshakes) {
+  CreateTimeWaitListManager();
+  QuicHandshakeAdmissionController::Options options;
+  // Consider the dispatcher overloaded whatever the lag.
+  options.elevated_lag = QuicTime::Delta::Zero();
+  options.overloaded_lag = QuicTime::Delta::Zero();
+  dispatcher_->SetHandshakeAdmissionController(
+      std::make_unique<QuicHandshakeAdmissionController>(options));
+  QuicSocketAddress client_address(QuicIpAddress::Loopback4(), 1);
+
+  EXPECT_CALL(*dispatcher_, CreateQuicSession(_, _, _, _, _, _)).Times(0);
+  EXPECT_CALL(*time_wait_list_manager_,
+              ProcessPacket(_, _, TestConnectionId(1), _, _, _))
+      .Times(1);
+  ProcessFirstFlight(client_address, TestConnectionId(1));
+  EXPECT_TRUE(
+      time_wait_list_manager_->IsConnectionIdInTimeWait(TestConnectionId(1)));
+  EXPECT_EQ(1u, dispatcher_->handshake_admission_controller()
+                    ->stats()
+                    .handshakes_refused_overloaded);
+}
+
+TEST_P(QuicDispatcherTestAllVersions,
+       AdmissionControllerMeasuresLagFromKernelReceiptTime) {
+  CreateTimeWaitListManager();
+  QuicHandshakeAdmissionController::Options options;
+  options.elevated_lag = QuicTime::Delta::FromMilliseconds(1);
+  options.overloaded_lag = QuicTime::Delta::FromMilliseconds(1);
+  dispatcher_->SetHandshakeAdmissionController(
+      std::make_unique<QuicHandshakeAdmissionController>(options));
+  QuicSocketAddress client_address(QuicIpAddress::Loopback4(), 1);
+  mock_helper_.AdvanceTime(QuicTime::Delta::FromSeconds(10));
+
+  // The packets were read just now, but waited a second in the socket queue.
+  EXPECT_CALL(*dispatcher_, CreateQuicSession(_, _, _, _, _, _)).Times(0);
+  EXPECT_CALL(*time_wait_list_manager_,
+              ProcessPacket(_, _, TestConnectionId(1), _, _, _))
+      .Times(1);
+  std::vector<std::unique_ptr<QuicReceivedPacket>> packets =
+      GetFirstFlightOfPackets(version_, DefaultQuicConfig(),
+                              TestConnectionId(1), EmptyQuicConnectionId(),
+                              TestClientCryptoConfig());
+  for (auto&& packet : packets) {
+    packet->set_kernel_receipt_time(mock_helper_.GetClock()->WallNow().Subtract(
+        QuicTime::Delta::FromSeconds(1)));
+    ProcessReceivedPacket(std::move(packet), client_address, version_,
+                          TestConnectionId(1));
+  }
+  EXPECT_LT(QuicTime::Delta::FromMilliseconds(1),
+            dispatcher_->handshake_admission_controller()->smoothed_lag());
+  EXPECT_EQ(1u, dispatcher_->handshake_admission_controller()
+                    ->stats()
+                    .handshakes_refused_overloaded);
+}
+
 TEST_P(QuicDispatcherTestOneVersion, SelectAlpn) {
   EXPECT_EQ(QuicDispatcherPeer::SelectAlpn(dispatcher_.get(), {}), "");
   EXPECT_EQ(QuicDispatcherPeer::SelectAlpn(dispatcher_.get(), {""}), "");
@@ -2225,6 +2420,14 @@ class QuicDispatcherSupportMultipleConnectionIdPerConnectionTest
     ProcessFirstFlight(client_address, TestConnectionId(2));
   }
 
+  // Shared with QuicDispatcherSessionTableTest, which runs them with
+  // quic_dispatcher_flat_session_table enabled.
+  void TestOnNewConnectionIdSent();
+  void TestProcessPacketsGroupsBySession();
+  void TestRetireConnectionIdFromSingleConnection();
+  void TestRetireConnectionIdFromMultipleConnections();
+  void TestTimeWaitListPoplulateCorrectly();
+
  protected:
   MockQuicConnectionHelper helper_;
   MockAlarmFactory alarm_factory_;
@@ -2236,8 +2439,8 @@ INSTANTIATE_TEST_SUITE_P(
     ::testing::Values(CurrentSupportedVersions().front()),
     ::testing::PrintToStringParamName());
 
-TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
-       OnNewConnectionIdSent) {
+void QuicDispatcherSupportMultipleConnectionIdPerConnectionTest::
+    TestOnNewConnectionIdSent() {
   AddConnection1();
   ASSERT_EQ(dispatcher_->NumSessions(), 1u);
   ASSERT_THAT(session1_, testing::NotNull());
@@ -2266,7 +2469,82 @@ TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
 }
 
 TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
-       RetireConnectionIdFromSingleConnection) {
+       OnNewConnectionIdSent) {
+  TestOnNewConnectionIdSent();
+}
+
+void QuicDispatcherSupportMultipleConnectionIdPerConnectionTest::
+    TestProcessPacketsGroupsBySession() {
+  SetQuicReloadableFlag(quic_dispatcher_batch_packets_by_connection, true);
+  AddConnection1();
+  ASSERT_THAT(session1_, testing::NotNull());
+  reinterpret_cast<MockServerConnection*>(connection1())
+      ->AddNewConnectionId(TestConnectionId(3));
+  QuicSocketAddress client_address(QuicIpAddress::Loopback4(), 1);
+  ParsedQuicVersionVector versions(SupportedVersions(version_));
+  uint64_t packet_number = 2;
+
+  // Processes a batch of packets of connection 1, whose connection IDs are
+  // 1 and 3, and returns the connection IDs in the order the session saw
+  // them.
+  auto process_batch = [&](const std::vector<std::pair<uint64_t, bool>>&
+                               connection_ids_and_version_flags) {
+    std::vector<std::unique_ptr<QuicReceivedPacket>> received_packets;
+    std::vector<ReceivedUdpPacket> batch;
+    for (const auto& [id, version_flag] : connection_ids_and_version_flags) {
+      std::unique_ptr<QuicEncryptedPacket> packet(ConstructEncryptedPacket(
+          TestConnectionId(id), EmptyQuicConnectionId(), version_flag, false,
+          packet_number++, "data", true, CONNECTION_ID_PRESENT,
+          CONNECTION_ID_ABSENT, PACKET_4BYTE_PACKET_NUMBER, &versions));
+      received_packets.emplace_back(
+          ConstructReceivedPacket(*packet, mock_helper_.GetClock()->Now()));
+      data_connection_map_[TestConnectionId(id)].push_back(std::string(
+          received_packets.back()->data(), received_packets.back()->length()));
+      batch.push_back(
+          {server_address_, client_address, received_packets.back().get()});
+    }
+    std::vector<QuicConnectionId> processed;
+    EXPECT_CALL(*connection1(), ProcessUdpPacket(_, _, _))
+        .Times(batch.size())
+        .WillRepeatedly(WithArg<2>(
+            Invoke([this, &processed](const QuicEncryptedPacket& packet) {
+              // Packets only differ in their connection ID and number.
+              QuicConnectionId id = TestConnectionId(1);
+              if (data_connection_map_[id].empty() ||
+                  data_connection_map_[id].front() != packet.AsStringPiece()) {
+                id = TestConnectionId(3);
+              }
+              ValidatePacket(id, packet);
+              processed.push_back(id);
+            })));
+    dispatcher_->ProcessPackets(batch);
+    return processed;
+  };
+
+  // Packets of the same session stay in order whichever connection ID they
+  // carry.
+  EXPECT_EQ(std::vector<QuicConnectionId>({TestConnectionId(1),
+                                           TestConnectionId(3),
+                                           TestConnectionId(1)}),
+            process_batch({{1, false}, {3, false}, {1, false}}));
+
+  // Including when one of them has to be dispatched on its own.
+  EXPECT_EQ(std::vector<QuicConnectionId>({TestConnectionId(1),
+                                           TestConnectionId(3),
+                                           TestConnectionId(1)}),
+            process_batch({{1, false}, {3, true}, {1, false}}));
+
+  EXPECT_CALL(*connection1(), CloseConnection(QUIC_PEER_GOING_AWAY, _, _));
+  dispatcher_->Shutdown();
+}
+
+TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
+       ProcessPacketsGroupsBySession) {
+  TestProcessPacketsGroupsBySession();
+}
+
+void QuicDispatcherSupportMultipleConnectionIdPerConnectionTest::
+    TestRetireConnectionIdFromSingleConnection() {
   AddConnection1();
   ASSERT_EQ(dispatcher_->NumSessions(), 1u);
   ASSERT_THAT(session1_, testing::NotNull());
@@ -2296,7 +2574,12 @@ TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
 }
 
 TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
-       RetireConnectionIdFromMultipleConnections) {
+       RetireConnectionIdFromSingleConnection) {
+  TestRetireConnectionIdFromSingleConnection();
+}
+
+void QuicDispatcherSupportMultipleConnectionIdPerConnectionTest::
+    TestRetireConnectionIdFromMultipleConnections() {
   AddConnection1();
   AddConnection2();
   ASSERT_EQ(dispatcher_->NumSessions(), 2u);
@@ -2328,7 +2611,12 @@ TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
 }
 
 TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
-       TimeWaitListPoplulateCorrectly) {
+       RetireConnectionIdFromMultipleConnections) {
+  TestRetireConnectionIdFromMultipleConnections();
+}
+
+void QuicDispatcherSupportMultipleConnectionIdPerConnectionTest::
+    TestTimeWaitListPoplulateCorrectly() {
   QuicTimeWaitListManager* time_wait_list_manager =
       QuicDispatcherPeer::GetTimeWaitListManager(dispatcher_.get());
   AddConnection1();
@@ -2358,6 +2646,79 @@ TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
   dispatcher_->Shutdown();
 }
 
+TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
+       TimeWaitListPoplulateCorrectly) {
+  TestTimeWaitListPoplulateCorrectly();
+}
+
+class QuicDispatcherSessionTableTest
+    : public QuicDispatcherSupportMultipleConnectionIdPerConnectionTest {
+ public:
+  QuicDispatcherSessionTableTest() {
+    SetQuicReloadableFlag(quic_dispatcher_flat_session_table, true);
+    dispatcher_ = std::make_unique<NiceMock<TestDispatcher>>(
+        &config_, &crypto_config_, &version_manager_,
+        mock_helper_.GetRandomGenerator());
+  }
+};
+
+INSTANTIATE_TEST_SUITE_P(QuicDispatcherSessionTableTests,
+                         QuicDispatcherSessionTableTest,
+                         ::testing::Values(CurrentSupportedVersions().front()),
+                         ::testing::PrintToStringParamName());
+
+TEST_P(QuicDispatcherSessionTableTest, OnNewConnectionIdSent) {
+  TestOnNewConnectionIdSent();
+}
+
+TEST_P(QuicDispatcherSessionTableTest, ProcessPacketsGroupsBySession) {
+  TestProcessPacketsGroupsBySession();
+}
+
+TEST_P(QuicDispatcherSessionTableTest, RetireConnectionIdFromSingleConnection) {
+  TestRetireConnectionIdFromSingleConnection();
+}
+
+TEST_P(QuicDispatcherSessionTableTest,
+       RetireConnectionIdFromMultipleConnections) {
+  TestRetireConnectionIdFromMultipleConnections();
+}
+
+TEST_P(QuicDispatcherSessionTableTest, TimeWaitListPoplulateCorrectly) {
+  TestTimeWaitListPoplulateCorrectly();
+}
+
+TEST_P(QuicDispatcherSessionTableTest, TracksConnectionIds) {
+  const QuicSessionTable* session_table =
+      QuicDispatcherPeer::GetSessionTable(dispatcher_.get());
+  ASSERT_THAT(session_table, testing::NotNull());
+  AddConnection1();
+  AddConnection2();
+  EXPECT_EQ(session1_, session_table->Find(TestConnectionId(1)));
+  EXPECT_EQ(session2_, session_table->Find(TestConnectionId(2)));
+
+  MockServerConnection* mock_server_connection1 =
+      reinterpret_cast<MockServerConnection*>(connection1());
+  mock_server_connection1->AddNewConnectionId(TestConnectionId(3));
+  mock_server_connection1->RetireConnectionId(TestConnectionId(1));
+  EXPECT_EQ(nullptr, session_table->Find(TestConnectionId(1)));
+  EXPECT_EQ(session1_, session_table->Find(TestConnectionId(3)));
+  EXPECT_EQ(2u, session_table->size());
+
+  // Packets to the new connection ID are dispatched through the table.
+  EXPECT_CALL(*connection1(), ProcessUdpPacket(_, _, _))
+      .WillOnce(WithArg<2>(Invoke([this](const QuicEncryptedPacket& packet) {
+        ValidatePacket(TestConnectionId(3), packet);
+      })));
+  ProcessPacket(QuicSocketAddress(QuicIpAddress::Loopback4(), 1),
+                TestConnectionId(3), false, "data");
+
+  EXPECT_CALL(*connection1(), CloseConnection(QUIC_PEER_GOING_AWAY, _, _));
+  EXPECT_CALL(*connection2(), CloseConnection(QUIC_PEER_GOING_AWAY, _, _));
+  dispatcher_->Shutdown();
+  EXPECT_TRUE(session_table->empty());
+}
+
 class BufferedPacketStoreTest : public QuicDispatcherTestBase {
  public:
   BufferedPacketStoreTest()
@@ -0,0 +1,88 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares QuicEpollAlarmFactory, which registers every alarm with the epoll
+// server, against QuicEpollTimerWheelAlarmFactory under the alarm churn of a
+// server with many connections: retransmission-like alarms pushed back on
+// every ack, occasional cancels, and time moving forward.
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/quic_alarm.h"
+#include "quiche/quic/core/quic_epoll_alarm_factory.h"
+#include "quiche/quic/core/quic_epoll_clock.h"
+#include "quiche/quic/core/quic_epoll_timer_wheel_alarm_factory.h"
+#include "quiche/common/platform/api/quiche_epoll_test_tools.h"
+
+namespace quic {
+namespace {
+
+// Alarms per connection, roughly what QuicConnection owns.
+constexpr int kAlarmsPerConnection = 10;
+
+class CountingDelegate : public QuicAlarm::DelegateWithoutContext {
+ public:
+  explicit CountingDelegate(int64_t* fired) : fired_(fired) {}
+
+  void OnAlarm() override { ++*fired_; }
+
+ private:
+  int64_t* fired_;
+};
+
+template <typename AlarmFactory>
+void BM_AlarmChurn(benchmark::State& state) {
+  const int num_alarms = state.range(0) * kAlarmsPerConnection;
+  quiche::QuicheFakeEpollServer epoll_server;
+  QuicEpollClock clock(&epoll_server);
+  AlarmFactory alarm_factory(&epoll_server);
+  int64_t fired = 0;
+  std::vector<std::unique_ptr<QuicAlarm>> alarms;
+  for (int i = 0; i < num_alarms; ++i) {
+    alarms.emplace_back(
+        alarm_factory.CreateAlarm(new CountingDelegate(&fired)));
+  }
+  std::mt19937 random(1);
+  for (auto& alarm : alarms) {
+    alarm->Set(clock.Now() +
+               QuicTime::Delta::FromMilliseconds(1 + random() % 200));
+  }
+
+  int64_t operations = 0;
+  for (auto _ : state) {
+    // One event loop iteration: a burst of alarm updates, then time moves.
+    for (int i = 0; i < 64; ++i) {
+      QuicAlarm* alarm = alarms[random() % num_alarms].get();
+      if (random() % 8 == 0) {
+        alarm->Cancel();
+      } else {
+        alarm->Update(clock.Now() +
+                          QuicTime::Delta::FromMilliseconds(1 + random() % 200),
+                      QuicTime::Delta::FromMicroseconds(1));
+      }
+    }
+    operations += 64;
+    epoll_server.AdvanceByExactlyAndCallCallbacks(100);
+  }
+  state.SetItemsProcessed(operations);
+  state.counters["fired"] = fired;
+}
+
+BENCHMARK_TEMPLATE(BM_AlarmChurn, QuicEpollAlarmFactory)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000);
+BENCHMARK_TEMPLATE(BM_AlarmChurn, QuicEpollTimerWheelAlarmFactory)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000);
+
+}  // namespace
+}  // namespace quic
+
+BENCHMARK_MAIN();
@@ -8,13 +8,26 @@
 #include <sys/socket.h>
 
 #include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/platform/api/quic_flags.h"
 
 namespace quic {
 
+namespace {
+
+// A negative flag value keeps no blocks rather than wrapping around.
+size_t MaxRetainedSequencerBufferBlocks() {
+  const int32_t max_blocks =
+      GetQuicFlag(FLAGS_quic_stream_sequencer_buffer_block_pool_max_blocks);
+  return max_blocks > 0 ? static_cast<size_t>(max_blocks) : 0;
+}
+
+}  // namespace
+
 QuicEpollConnectionHelper::QuicEpollConnectionHelper(
     QuicEpollServer* epoll_server, QuicAllocator allocator_type)
     : clock_(epoll_server),
       random_generator_(QuicRandom::GetInstance()),
+      stream_sequencer_buffer_block_pool_(MaxRetainedSequencerBufferBlocks()),
       allocator_type_(allocator_type) {}
 
 QuicEpollConnectionHelper::~QuicEpollConnectionHelper() = default;
@@ -29,10 +42,20 @@ quiche::QuicheBufferAllocator*
 QuicEpollConnectionHelper::GetStreamSendBufferAllocator() {
   if (allocator_type_ == QuicAllocator::BUFFER_POOL) {
     return &stream_buffer_allocator_;
+  } else if (allocator_type_ == QuicAllocator::SLAB) {
+    return &slab_buffer_allocator_;
   } else {
     QUICHE_DCHECK(allocator_type_ == QuicAllocator::SIMPLE);
     return &simple_buffer_allocator_;
   }
 }
 
+QuicStreamSequencerBufferBlockPool*
+QuicEpollConnectionHelper::GetStreamSequencerBufferBlockPool() {
+  if (allocator_type_ == QuicAllocator::BUFFER_POOL) {
+    return &stream_sequencer_buffer_block_pool_;
+  }
+  return nullptr;
+}
+
 }  // namespace quic
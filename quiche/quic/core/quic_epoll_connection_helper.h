@@ -17,16 +17,20 @@
 #include "quiche/quic/core/quic_epoll_clock.h"
 #include "quiche/quic/core/quic_packet_writer.h"
 #include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
 #include "quiche/quic/core/quic_time.h"
 #include "quiche/quic/platform/api/quic_epoll.h"
 #include "quiche/common/platform/api/quiche_stream_buffer_allocator.h"
+#include "quiche/common/quiche_slab_buffer_allocator.h"
 #include "quiche/common/simple_buffer_allocator.h"
 
 namespace quic {
 
 class QuicRandom;
 
-enum class QuicAllocator { SIMPLE, BUFFER_POOL };
+// SLAB serves stream send buffers from a QuicheSlabBufferAllocator, which is
+// owned by the thread that first allocates from it; use one helper per thread.
+enum class QuicAllocator { SIMPLE, BUFFER_POOL, SLAB };
 
 class QUIC_EXPORT_PRIVATE QuicEpollConnectionHelper
     : public QuicConnectionHelperInterface {
@@ -42,6 +46,8 @@ class QUIC_EXPORT_PRIVATE QuicEpollConnectionHelper
   const QuicClock* GetClock() const override;
   QuicRandom* GetRandomGenerator() override;
   quiche::QuicheBufferAllocator* GetStreamSendBufferAllocator() override;
+  QuicStreamSequencerBufferBlockPool* GetStreamSequencerBufferBlockPool()
+      override;
 
  private:
   const QuicEpollClock clock_;
@@ -50,6 +56,9 @@ class QUIC_EXPORT_PRIVATE QuicEpollConnectionHelper
   // Allocator for stream send buffers.
   quiche::QuicheStreamBufferAllocator stream_buffer_allocator_;
   quiche::SimpleBufferAllocator simple_buffer_allocator_;
+  quiche::QuicheSlabBufferAllocator slab_buffer_allocator_;
+  // Pool for stream receive buffer blocks, only used with BUFFER_POOL.
+  QuicStreamSequencerBufferBlockPool stream_sequencer_buffer_block_pool_;
   QuicAllocator allocator_type_;
 };
 
@@ -5,6 +5,7 @@
 #include "quiche/quic/core/quic_epoll_connection_helper.h"
 
 #include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/platform/api/quic_flags.h"
 #include "quiche/quic/platform/api/quic_test.h"
 #include "quiche/common/platform/api/quiche_epoll_test_tools.h"
 
@@ -36,6 +37,18 @@ TEST_F(QuicEpollConnectionHelperTest, GetRandomGenerator) {
   EXPECT_EQ(QuicRandom::GetInstance(), random);
 }
 
+TEST_F(QuicEpollConnectionHelperTest, NegativeBlockPoolSizeKeepsNoBlocks) {
+  SetQuicFlag(FLAGS_quic_stream_sequencer_buffer_block_pool_max_blocks, -1);
+  QuicEpollConnectionHelper helper(&epoll_server_, QuicAllocator::BUFFER_POOL);
+  QuicStreamSequencerBufferBlockPool* pool =
+      helper.GetStreamSequencerBufferBlockPool();
+  ASSERT_NE(nullptr, pool);
+  EXPECT_EQ(0u, pool->max_retained_blocks());
+
+  pool->Release(pool->Acquire());
+  EXPECT_EQ(0u, pool->retained_blocks());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
@@ -0,0 +1,130 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_epoll_timer_wheel_alarm_factory.h"
+
+#include <utility>
+
+#include "quiche/quic/core/quic_arena_scoped_ptr.h"
+
+namespace quic {
+
+namespace {
+
+// Matches the granularity QuicConnection updates its alarms with.
+constexpr QuicTime::Delta kDefaultTick = QuicTime::Delta::FromMilliseconds(1);
+
+QuicTime ToQuicTime(int64_t epoll_time_us) {
+  return QuicTime::Zero() + QuicTime::Delta::FromMicroseconds(epoll_time_us);
+}
+
+int64_t ToEpollTime(QuicTime time) {
+  return (time - QuicTime::Zero()).ToMicroseconds();
+}
+
+}  // namespace
+
+class QuicTimerWheelAlarm : public QuicAlarm, public QuicTimerWheel::Timer {
+ public:
+  QuicTimerWheelAlarm(QuicEpollTimerWheelAlarmFactory* factory,
+                      QuicArenaScopedPtr<QuicAlarm::Delegate> delegate)
+      : QuicAlarm(std::move(delegate)), factory_(factory) {}
+
+ protected:
+  void SetImpl() override {
+    QUICHE_DCHECK(deadline().IsInitialized());
+    factory_->Schedule(this, deadline());
+  }
+
+  void CancelImpl() override {
+    QUICHE_DCHECK(!deadline().IsInitialized());
+    factory_->Cancel(this);
+  }
+
+  void UpdateImpl() override {
+    QUICHE_DCHECK(deadline().IsInitialized());
+    // Schedule() moves the alarm if it is already on the wheel.
+    factory_->Schedule(this, deadline());
+  }
+
+  void OnExpired() override { Fire(); }
+
+ private:
+  QuicEpollTimerWheelAlarmFactory* factory_;  // Unowned.
+};
+
+QuicEpollTimerWheelAlarmFactory::QuicEpollTimerWheelAlarmFactory(
+    QuicEpollServer* epoll_server, QuicTime::Delta tick)
+    : epoll_server_(epoll_server),
+      wheel_(ToQuicTime(epoll_server->ApproximateNowInUsec()), tick),
+      driver_(this),
+      driver_deadline_us_(0),
+      advancing_(false) {}
+
+QuicEpollTimerWheelAlarmFactory::QuicEpollTimerWheelAlarmFactory(
+    QuicEpollServer* epoll_server)
+    : QuicEpollTimerWheelAlarmFactory(epoll_server, kDefaultTick) {}
+
+QuicEpollTimerWheelAlarmFactory::~QuicEpollTimerWheelAlarmFactory() = default;
+
+QuicAlarm* QuicEpollTimerWheelAlarmFactory::CreateAlarm(
+    QuicAlarm::Delegate* delegate) {
+  return new QuicTimerWheelAlarm(
+      this, QuicArenaScopedPtr<QuicAlarm::Delegate>(delegate));
+}
+
+QuicArenaScopedPtr<QuicAlarm> QuicEpollTimerWheelAlarmFactory::CreateAlarm(
+    QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
+    QuicConnectionArena* arena) {
+  if (arena != nullptr) {
+    return arena->New<QuicTimerWheelAlarm>(this, std::move(delegate));
+  }
+  return QuicArenaScopedPtr<QuicAlarm>(
+      new QuicTimerWheelAlarm(this, std::move(delegate)));
+}
+
+void QuicEpollTimerWheelAlarmFactory::Schedule(QuicTimerWheel::Timer* timer,
+                                               QuicTime deadline) {
+  wheel_.Schedule(timer, deadline);
+  UpdateDriver();
+}
+
+void QuicEpollTimerWheelAlarmFactory::Cancel(QuicTimerWheel::Timer* timer) {
+  // The driver is left registered; going off with nothing to do is cheaper
+  // than re-registering it on every cancel.
+  wheel_.Cancel(timer);
+}
+
+void QuicEpollTimerWheelAlarmFactory::UpdateDriver() {
+  if (advancing_) {
+    return;
+  }
+  const int64_t next_us = ToEpollTime(wheel_.NextDeadline());
+  if (!driver_.registered()) {
+    epoll_server_->RegisterAlarm(next_us, &driver_);
+  } else if (next_us < driver_deadline_us_) {
+    driver_.ReregisterAlarm(next_us);
+  } else {
+    return;
+  }
+  driver_deadline_us_ = next_us;
+}
+
+int64_t QuicEpollTimerWheelAlarmFactory::OnDriverAlarm() {
+  advancing_ = true;
+  wheel_.Advance(ToQuicTime(epoll_server_->ApproximateNowInUsec()));
+  advancing_ = false;
+  if (wheel_.empty()) {
+    return 0;
+  }
+  driver_deadline_us_ = ToEpollTime(wheel_.NextDeadline());
+  return driver_deadline_us_;
+}
+
+int64_t QuicEpollTimerWheelAlarmFactory::WheelDriver::OnAlarm() {
+  QuicEpollAlarmBase::OnAlarm();
+  return factory_->OnDriverAlarm();
+}
+
+}  // namespace quic
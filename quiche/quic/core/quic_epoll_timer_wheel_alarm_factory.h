@@ -0,0 +1,84 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_EPOLL_TIMER_WHEEL_ALARM_FACTORY_H_
+#define QUICHE_QUIC_CORE_QUIC_EPOLL_TIMER_WHEEL_ALARM_FACTORY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "quiche/quic/core/quic_alarm.h"
+#include "quiche/quic/core/quic_alarm_factory.h"
+#include "quiche/quic/core/quic_one_block_arena.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_timer_wheel.h"
+#include "quiche/quic/platform/api/quic_epoll.h"
+
+namespace quic {
+
+// Creates alarms which are kept in a QuicTimerWheel instead of being
+// registered with the epoll server one by one. Setting, updating and
+// cancelling an alarm is O(1) and does not allocate; only the wheel's next
+// deadline is registered with the epoll server.
+//
+// Alarms fire up to one |tick| after their deadline, never before it.
+class QUIC_EXPORT_PRIVATE QuicEpollTimerWheelAlarmFactory
+    : public QuicAlarmFactory {
+ public:
+  QuicEpollTimerWheelAlarmFactory(QuicEpollServer* epoll_server,
+                                  QuicTime::Delta tick);
+  explicit QuicEpollTimerWheelAlarmFactory(QuicEpollServer* epoll_server);
+  QuicEpollTimerWheelAlarmFactory(const QuicEpollTimerWheelAlarmFactory&) =
+      delete;
+  QuicEpollTimerWheelAlarmFactory& operator=(
+      const QuicEpollTimerWheelAlarmFactory&) = delete;
+  ~QuicEpollTimerWheelAlarmFactory() override;
+
+  // QuicAlarmFactory interface.
+  QuicAlarm* CreateAlarm(QuicAlarm::Delegate* delegate) override;
+  QuicArenaScopedPtr<QuicAlarm> CreateAlarm(
+      QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
+      QuicConnectionArena* arena) override;
+
+  // Number of alarms currently set.
+  size_t num_set_alarms() const { return wheel_.size(); }
+
+ private:
+  friend class QuicTimerWheelAlarm;
+
+  // The single epoll alarm which turns the wheel.
+  class QUIC_EXPORT_PRIVATE WheelDriver : public QuicEpollAlarmBase {
+   public:
+    explicit WheelDriver(QuicEpollTimerWheelAlarmFactory* factory)
+        : factory_(factory) {}
+
+    int64_t OnAlarm() override;
+
+   private:
+    QuicEpollTimerWheelAlarmFactory* factory_;  // Unowned.
+  };
+
+  void Schedule(QuicTimerWheel::Timer* timer, QuicTime deadline);
+  void Cancel(QuicTimerWheel::Timer* timer);
+
+  // Makes sure the driver goes off no later than the wheel's next deadline.
+  void UpdateDriver();
+
+  // Advances the wheel to the current time and returns the epoll time at which
+  // the driver should go off next, or 0 if no alarm is set.
+  int64_t OnDriverAlarm();
+
+  QuicEpollServer* epoll_server_;  // Not owned.
+  QuicTimerWheel wheel_;
+  WheelDriver driver_;
+  // Epoll time the driver is registered for, valid while it is registered.
+  int64_t driver_deadline_us_;
+  // True while the wheel is advancing, during which the driver is not
+  // registered and is re-registered by OnDriverAlarm() once done.
+  bool advancing_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_EPOLL_TIMER_WHEEL_ALARM_FACTORY_H_
@@ -0,0 +1,181 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_epoll_timer_wheel_alarm_factory.h"
+
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/core/quic_epoll_clock.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/common/platform/api/quiche_epoll_test_tools.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class TestDelegate : public QuicAlarm::DelegateWithoutContext {
+ public:
+  TestDelegate() : fired_(false) {}
+
+  void OnAlarm() override { fired_ = true; }
+
+  bool fired() const { return fired_; }
+
+ private:
+  bool fired_;
+};
+
+// The boolean parameter denotes whether or not to use an arena.
+class QuicEpollTimerWheelAlarmFactoryTest : public QuicTestWithParam<bool> {
+ protected:
+  QuicEpollTimerWheelAlarmFactoryTest()
+      : clock_(&epoll_server_), alarm_factory_(&epoll_server_) {}
+
+  QuicConnectionArena* GetArenaParam() {
+    return GetParam() ? &arena_ : nullptr;
+  }
+
+  quiche::QuicheFakeEpollServer epoll_server_;
+  const QuicEpollClock clock_;
+  QuicEpollTimerWheelAlarmFactory alarm_factory_;
+  QuicConnectionArena arena_;
+};
+
+INSTANTIATE_TEST_SUITE_P(UseArena, QuicEpollTimerWheelAlarmFactoryTest,
+                         ::testing::ValuesIn({true, false}),
+                         ::testing::PrintToStringParamName());
+
+TEST_P(QuicEpollTimerWheelAlarmFactoryTest, CreateAlarm) {
+  QuicArenaScopedPtr<TestDelegate> delegate =
+      QuicArenaScopedPtr<TestDelegate>(new TestDelegate());
+  TestDelegate* unowned_delegate = delegate.get();
+  QuicArenaScopedPtr<QuicAlarm> alarm(
+      alarm_factory_.CreateAlarm(std::move(delegate), GetArenaParam()));
+
+  QuicTime start = clock_.Now();
+  QuicTime::Delta delta = QuicTime::Delta::FromMilliseconds(1);
+  alarm->Set(start + delta);
+  EXPECT_EQ(1u, alarm_factory_.num_set_alarms());
+
+  epoll_server_.AdvanceByAndWaitForEventsAndExecuteCallbacks(
+      delta.ToMicroseconds());
+  EXPECT_EQ(start + delta, clock_.Now());
+  EXPECT_TRUE(unowned_delegate->fired());
+  EXPECT_EQ(0u, alarm_factory_.num_set_alarms());
+}
+
+TEST_P(QuicEpollTimerWheelAlarmFactoryTest, CreateAlarmAndCancel) {
+  QuicArenaScopedPtr<TestDelegate> delegate =
+      QuicArenaScopedPtr<TestDelegate>(new TestDelegate());
+  TestDelegate* unowned_delegate = delegate.get();
+  QuicArenaScopedPtr<QuicAlarm> alarm(
+      alarm_factory_.CreateAlarm(std::move(delegate), GetArenaParam()));
+
+  QuicTime start = clock_.Now();
+  QuicTime::Delta delta = QuicTime::Delta::FromMilliseconds(1);
+  alarm->Set(start + delta);
+  alarm->Cancel();
+  EXPECT_EQ(0u, alarm_factory_.num_set_alarms());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(delta.ToMicroseconds());
+  EXPECT_EQ(start + delta, clock_.Now());
+  EXPECT_FALSE(unowned_delegate->fired());
+}
+
+TEST_P(QuicEpollTimerWheelAlarmFactoryTest, CreateAlarmAndReset) {
+  QuicArenaScopedPtr<TestDelegate> delegate =
+      QuicArenaScopedPtr<TestDelegate>(new TestDelegate());
+  TestDelegate* unowned_delegate = delegate.get();
+  QuicArenaScopedPtr<QuicAlarm> alarm(
+      alarm_factory_.CreateAlarm(std::move(delegate), GetArenaParam()));
+
+  QuicTime start = clock_.Now();
+  QuicTime::Delta delta = QuicTime::Delta::FromMilliseconds(1);
+  alarm->Set(clock_.Now() + delta);
+  alarm->Cancel();
+  QuicTime::Delta new_delta = QuicTime::Delta::FromMilliseconds(3);
+  alarm->Set(clock_.Now() + new_delta);
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(delta.ToMicroseconds());
+  EXPECT_EQ(start + delta, clock_.Now());
+  EXPECT_FALSE(unowned_delegate->fired());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(
+      (new_delta - delta).ToMicroseconds());
+  EXPECT_EQ(start + new_delta, clock_.Now());
+  EXPECT_TRUE(unowned_delegate->fired());
+}
+
+TEST_P(QuicEpollTimerWheelAlarmFactoryTest, CreateAlarmAndUpdate) {
+  QuicArenaScopedPtr<TestDelegate> delegate =
+      QuicArenaScopedPtr<TestDelegate>(new TestDelegate());
+  TestDelegate* unowned_delegate = delegate.get();
+  QuicArenaScopedPtr<QuicAlarm> alarm(
+      alarm_factory_.CreateAlarm(std::move(delegate), GetArenaParam()));
+
+  QuicTime start = clock_.Now();
+  QuicTime::Delta delta = QuicTime::Delta::FromMilliseconds(1);
+  alarm->Set(clock_.Now() + delta);
+  QuicTime::Delta new_delta = QuicTime::Delta::FromMilliseconds(3);
+  alarm->Update(clock_.Now() + new_delta, QuicTime::Delta::FromMilliseconds(1));
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(delta.ToMicroseconds());
+  EXPECT_EQ(start + delta, clock_.Now());
+  EXPECT_FALSE(unowned_delegate->fired());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(
+      (new_delta - delta).ToMicroseconds());
+  EXPECT_EQ(start + new_delta, clock_.Now());
+  EXPECT_TRUE(unowned_delegate->fired());
+
+  // Update it with an uninitialized time and ensure it's cancelled.
+  alarm->Update(clock_.Now() + new_delta, QuicTime::Delta::FromMilliseconds(1));
+  EXPECT_TRUE(alarm->IsSet());
+  alarm->Update(QuicTime::Zero(), QuicTime::Delta::FromMilliseconds(1));
+  EXPECT_FALSE(alarm->IsSet());
+  EXPECT_EQ(0u, alarm_factory_.num_set_alarms());
+}
+
+TEST_P(QuicEpollTimerWheelAlarmFactoryTest, DeadlineIsRoundedUpToTick) {
+  QuicArenaScopedPtr<TestDelegate> delegate =
+      QuicArenaScopedPtr<TestDelegate>(new TestDelegate());
+  TestDelegate* unowned_delegate = delegate.get();
+  QuicArenaScopedPtr<QuicAlarm> alarm(
+      alarm_factory_.CreateAlarm(std::move(delegate), GetArenaParam()));
+
+  QuicTime start = clock_.Now();
+  alarm->Set(start + QuicTime::Delta::FromMicroseconds(1500));
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(1500);
+  EXPECT_FALSE(unowned_delegate->fired());
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(500);
+  EXPECT_TRUE(unowned_delegate->fired());
+}
+
+TEST_P(QuicEpollTimerWheelAlarmFactoryTest, ManyAlarmsShareOneEpollAlarm) {
+  std::vector<TestDelegate*> delegates;
+  std::vector<QuicArenaScopedPtr<QuicAlarm>> alarms;
+  QuicTime start = clock_.Now();
+  for (int i = 0; i < 10; ++i) {
+    QuicArenaScopedPtr<TestDelegate> delegate =
+        QuicArenaScopedPtr<TestDelegate>(new TestDelegate());
+    delegates.push_back(delegate.get());
+    alarms.push_back(alarm_factory_.CreateAlarm(std::move(delegate), nullptr));
+    alarms.back()->Set(start + QuicTime::Delta::FromMilliseconds(100 - 10 * i));
+  }
+  EXPECT_EQ(1u, epoll_server_.NumberOfAlarms());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(
+      QuicTime::Delta::FromMilliseconds(50).ToMicroseconds());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i >= 5, delegates[i]->fired()) << i;
+  }
+  EXPECT_EQ(5u, alarm_factory_.num_set_alarms());
+  EXPECT_EQ(1u, epoll_server_.NumberOfAlarms());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
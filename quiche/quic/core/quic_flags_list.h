@@ -109,6 +109,18 @@ QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_bbr2_exit_startup_on_persistent_queue2
 QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_bbr2_add_bytes_acked_after_inflight_hi_limited, true)
 // When true, the BBR4 copt sets the extra_acked window to 20 RTTs and BBR5 sets it to 40 RTTs.
 QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_bbr2_extra_acked_window, true)
+// If true, QuicConnection multiplexes its alarms onto a single alarm of its alarm factory.
+QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_multiplex_connection_alarms, false)
+// If true, QuicDispatcher delivers the packets of a read batch which belong to the same existing connection in one call.
+QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_dispatcher_batch_packets_by_connection, false)
+// If true, QuicDispatcher looks up sessions of fixed length server connection IDs in a flat table, prefetching the entries of a read batch.
+QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_dispatcher_flat_session_table, false)
+// If true, QuicConnection passes the release time of each packet to writers which support release times, unless per-packet options were set.
+QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_pace_with_release_times, false)
+// If true, QuicConnection computes the header protection masks of a batch of received short header packets together before processing them, and lets batch writers seal the 1-RTT packets written to them together as they are flushed.
+QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_batch_header_protection_masks, false)
+// If true and --quic_reloadable_flag_quic_batch_header_protection_masks is true, QuicConnection decrypts the 1-RTT packets of a received batch together, and seals the AEAD of the 1-RTT packets it writes to a batch writer together when they are flushed.
+QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_batch_aead, false)
 
 #endif
 
@@ -0,0 +1,106 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_frame_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace quic {
+
+namespace {
+
+// A size class's first chunk holds this many arrays. Each further chunk holds
+// as many arrays as all previous ones together, up to kMaxChunkSize bytes.
+constexpr size_t kMinSlotsPerChunk = 4;
+constexpr size_t kMaxChunkSize = 16 * 1024;
+
+static_assert(std::is_trivially_copyable<QuicFrame>::value,
+              "Free slots are linked by overwriting their first frame");
+static_assert(sizeof(QuicFrame) >= sizeof(QuicFrame*),
+              "Free slots must have room for a pointer");
+
+QuicFrame* NextFree(const QuicFrame* slot) {
+  QuicFrame* next;
+  memcpy(&next, slot, sizeof(next));
+  return next;
+}
+
+void SetNextFree(QuicFrame* slot, QuicFrame* next) {
+  memcpy(static_cast<void*>(slot), &next, sizeof(next));
+}
+
+}  // namespace
+
+QuicFrameArena::QuicFrameArena() = default;
+
+QuicFrameArena::~QuicFrameArena() = default;
+
+// static
+size_t QuicFrameArena::SizeClassIndex(size_t num_frames) {
+  size_t index = 0;
+  while ((size_t{1} << index) < num_frames) {
+    ++index;
+  }
+  return index;
+}
+
+absl::Span<QuicFrame> QuicFrameArena::Copy(
+    absl::Span<const QuicFrame> frames) {
+  if (frames.empty()) {
+    return {};
+  }
+  QuicFrame* storage;
+  if (frames.size() > kMaxArenaFrames) {
+    storage = new QuicFrame[frames.size()];
+    bytes_allocated_ += frames.size() * sizeof(QuicFrame);
+  } else {
+    const size_t size_class = SizeClassIndex(frames.size());
+    SizeClass& sizes = size_classes_[size_class];
+    if (sizes.free_list == nullptr) {
+      AllocateChunk(size_class);
+    }
+    storage = sizes.free_list;
+    sizes.free_list = NextFree(storage);
+  }
+  std::copy(frames.begin(), frames.end(), storage);
+  return absl::MakeSpan(storage, frames.size());
+}
+
+void QuicFrameArena::Free(absl::Span<QuicFrame> frames) {
+  if (frames.empty()) {
+    return;
+  }
+  if (frames.size() > kMaxArenaFrames) {
+    delete[] frames.data();
+    bytes_allocated_ -= frames.size() * sizeof(QuicFrame);
+    return;
+  }
+  SizeClass& sizes = size_classes_[SizeClassIndex(frames.size())];
+  SetNextFree(frames.data(), sizes.free_list);
+  sizes.free_list = frames.data();
+}
+
+void QuicFrameArena::AllocateChunk(size_t size_class) {
+  SizeClass& sizes = size_classes_[size_class];
+  const size_t frames_per_slot = size_t{1} << size_class;
+  const size_t slot_size = frames_per_slot * sizeof(QuicFrame);
+  const size_t num_slots = std::max(
+      kMinSlotsPerChunk, std::min(sizes.num_slots, kMaxChunkSize / slot_size));
+  auto chunk = std::make_unique<QuicFrame[]>(num_slots * frames_per_slot);
+  // Push in reverse so that slots are handed out in address order.
+  for (size_t i = num_slots; i > 0; --i) {
+    QuicFrame* slot = chunk.get() + (i - 1) * frames_per_slot;
+    SetNextFree(slot, sizes.free_list);
+    sizes.free_list = slot;
+  }
+  sizes.num_slots += num_slots;
+  bytes_allocated_ += num_slots * slot_size;
+  sizes.chunks.push_back(std::move(chunk));
+}
+
+}  // namespace quic
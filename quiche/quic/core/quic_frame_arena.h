@@ -0,0 +1,70 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_FRAME_ARENA_H_
+#define QUICHE_QUIC_CORE_QUIC_FRAME_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "quiche/quic/core/frames/quic_frame.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Stores arrays of QuicFrames, such as the retransmittable frames of the
+// packets a connection has in flight, without a heap allocation per array.
+// Arrays of up to kMaxArenaFrames frames are carved from chunks, with one free
+// list for each power of two array size. Chunks grow with the number of arrays
+// in use, and are kept until the arena is destroyed, so a connection which has
+// reached a congestion window keeps reusing the same memory.
+class QUIC_EXPORT_PRIVATE QuicFrameArena {
+ public:
+  // Larger arrays are allocated on the heap.
+  static constexpr size_t kMaxArenaFrames = 16;
+
+  QuicFrameArena();
+  QuicFrameArena(const QuicFrameArena&) = delete;
+  QuicFrameArena& operator=(const QuicFrameArena&) = delete;
+  ~QuicFrameArena();
+
+  // Returns a copy of |frames| in storage owned by the arena, or an empty span
+  // if |frames| is empty. Only the QuicFrames are copied: frames stored out of
+  // line are shared with |frames|.
+  absl::Span<QuicFrame> Copy(absl::Span<const QuicFrame> frames);
+
+  // Returns the storage of |frames|, which must have been returned by Copy(),
+  // to the arena. Does not delete frames stored out of line.
+  void Free(absl::Span<QuicFrame> frames);
+
+  // The number of bytes held in chunks, whether or not they are in use, plus
+  // the bytes of arrays allocated on the heap.
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
+ private:
+  struct SizeClass {
+    // Slots which are not in use. The first bytes of a free slot point to the
+    // next free slot.
+    QuicFrame* free_list = nullptr;
+    size_t num_slots = 0;
+    std::vector<std::unique_ptr<QuicFrame[]>> chunks;
+  };
+
+  // Returns the index of the size class of arrays of |num_frames| frames.
+  static size_t SizeClassIndex(size_t num_frames);
+
+  void AllocateChunk(size_t size_class);
+
+  static constexpr size_t kNumSizeClasses = 5;
+  static_assert(size_t{1} << (kNumSizeClasses - 1) == kMaxArenaFrames,
+                "Largest size class must hold kMaxArenaFrames frames");
+  SizeClass size_classes_[kNumSizeClasses];
+  size_t bytes_allocated_ = 0;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_FRAME_ARENA_H_
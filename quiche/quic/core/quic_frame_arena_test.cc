@@ -0,0 +1,96 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_frame_arena.h"
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "quiche/quic/core/frames/quic_frame.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic::test {
+namespace {
+
+class QuicFrameArenaTest : public QuicTest {
+ protected:
+  // Returns |num_frames| stream frames of stream 3, at consecutive offsets.
+  static QuicFrames MakeFrames(size_t num_frames) {
+    QuicFrames frames;
+    for (size_t i = 0; i < num_frames; ++i) {
+      frames.push_back(QuicFrame(QuicStreamFrame(3, false, i * 100, 100)));
+    }
+    return frames;
+  }
+};
+
+TEST_F(QuicFrameArenaTest, CopyEmpty) {
+  QuicFrameArena arena;
+  absl::Span<QuicFrame> copy = arena.Copy({});
+  EXPECT_TRUE(copy.empty());
+  arena.Free(copy);
+  EXPECT_EQ(0u, arena.bytes_allocated());
+}
+
+TEST_F(QuicFrameArenaTest, Copy) {
+  QuicFrameArena arena;
+  for (size_t num_frames : {1, 2, 3, 16, 17, 100}) {
+    const QuicFrames frames = MakeFrames(num_frames);
+    absl::Span<QuicFrame> copy = arena.Copy(frames);
+    ASSERT_EQ(num_frames, copy.size());
+    EXPECT_NE(frames.data(), copy.data());
+    for (size_t i = 0; i < num_frames; ++i) {
+      EXPECT_EQ(STREAM_FRAME, copy[i].type);
+      EXPECT_EQ(frames[i].stream_frame, copy[i].stream_frame);
+    }
+    arena.Free(copy);
+  }
+}
+
+TEST_F(QuicFrameArenaTest, ReusesFreedArrays) {
+  QuicFrameArena arena;
+  const QuicFrames frames = MakeFrames(3);
+  absl::Span<QuicFrame> copy = arena.Copy(frames);
+  const size_t bytes_allocated = arena.bytes_allocated();
+  arena.Free(copy);
+  // Arrays of 3 and 4 frames share a size class.
+  absl::Span<QuicFrame> reused = arena.Copy(MakeFrames(4));
+  EXPECT_EQ(copy.data(), reused.data());
+  EXPECT_EQ(bytes_allocated, arena.bytes_allocated());
+  arena.Free(reused);
+}
+
+TEST_F(QuicFrameArenaTest, ChunksGrow) {
+  QuicFrameArena arena;
+  const QuicFrames frames = MakeFrames(1);
+  std::vector<absl::Span<QuicFrame>> copies;
+  copies.push_back(arena.Copy(frames));
+  const size_t first_chunk_bytes = arena.bytes_allocated();
+  EXPECT_LT(0u, first_chunk_bytes);
+  for (int i = 0; i < 1000; ++i) {
+    copies.push_back(arena.Copy(frames));
+  }
+  // Chunks grow geometrically, so the memory held stays within a small factor
+  // of the memory in use.
+  EXPECT_LE(copies.size() * sizeof(QuicFrame), arena.bytes_allocated());
+  EXPECT_GT(2 * copies.size() * sizeof(QuicFrame), arena.bytes_allocated());
+  for (absl::Span<QuicFrame> copy : copies) {
+    arena.Free(copy);
+  }
+  // Freed memory is kept by the arena.
+  EXPECT_LE(copies.size() * sizeof(QuicFrame), arena.bytes_allocated());
+}
+
+TEST_F(QuicFrameArenaTest, LargeArraysAreReleased) {
+  QuicFrameArena arena;
+  absl::Span<QuicFrame> copy =
+      arena.Copy(MakeFrames(QuicFrameArena::kMaxArenaFrames + 1));
+  EXPECT_EQ((QuicFrameArena::kMaxArenaFrames + 1) * sizeof(QuicFrame),
+            arena.bytes_allocated());
+  arena.Free(copy);
+  EXPECT_EQ(0u, arena.bytes_allocated());
+}
+
+}  // namespace
+}  // namespace quic::test
@@ -426,7 +426,9 @@ QuicFramer::QuicFramer(const ParsedQuicVersionVector& supported_versions,
       peer_ack_delay_exponent_(kDefaultAckDelayExponent),
       local_ack_delay_exponent_(kDefaultAckDelayExponent),
       current_received_frame_type_(0),
-      previously_received_frame_type_(0) {
+      previously_received_frame_type_(0),
+      use_received_packet_buffers_(false),
+      current_received_packet_buffer_(nullptr) {
   QUICHE_DCHECK(!supported_versions.empty());
   version_ = supported_versions_[0];
   QUICHE_DCHECK(version_.IsKnown())
@@ -1529,6 +1531,28 @@ bool QuicFramer::ProcessPacketInternal(const QuicEncryptedPacket& packet) {
     rv = ProcessRetryPacket(&reader, header);
   } else if (header.reset_flag) {
     rv = ProcessPublicResetPacket(&reader, header);
+  } else if (use_received_packet_buffers_ &&
+             packet.length() <= QuicReceivedPacketBuffer::size()) {
+    // Reuse the buffer of the previous packet unless frame data in it is still
+    // referenced. The local reference also keeps packets processed from within
+    // the visitor callbacks of this one from reusing it.
+    if (received_packet_buffer_ == nullptr ||
+        !received_packet_buffer_->HasUniqueReference()) {
+      received_packet_buffer_ = QuicReceivedPacketBuffer::Create();
+    }
+    QuicReceivedPacketBuffer::Pointer buffer =
+        received_packet_buffer_->NewReference();
+    QuicReceivedPacketBuffer* const previous_received_packet_buffer =
+        current_received_packet_buffer_;
+    current_received_packet_buffer_ = buffer.get();
+    if (packet_has_ietf_packet_header) {
+      rv = ProcessIetfDataPacket(&reader, &header, packet, buffer->data(),
+                                 buffer->size());
+    } else {
+      rv = ProcessDataPacket(&reader, &header, packet, buffer->data(),
+                             buffer->size());
+    }
+    current_received_packet_buffer_ = previous_received_packet_buffer;
   } else if (packet.length() <= kMaxIncomingPacketSize) {
     // The optimized decryption algorithm implementations run faster when
     // operating on aligned memory.
@@ -4378,6 +4402,7 @@ void QuicFramer::SetDecrypter(EncryptionLevel level,
   QUICHE_DCHECK(!version_.KnowsWhichDecrypterToUse());
   QUIC_DVLOG(1) << ENDPOINT << "Setting decrypter from level "
                 << decrypter_level_ << " to " << level;
+  ClearPredecryptedPackets();
   decrypter_[decrypter_level_] = nullptr;
   decrypter_[level] = std::move(decrypter);
   decrypter_level_ = level;
@@ -4390,6 +4415,7 @@ void QuicFramer::SetAlternativeDecrypter(
   QUICHE_DCHECK(!version_.KnowsWhichDecrypterToUse());
   QUIC_DVLOG(1) << ENDPOINT << "Setting alternative decrypter from level "
                 << alternative_decrypter_level_ << " to " << level;
+  ClearPredecryptedPackets();
   if (alternative_decrypter_level_ != NUM_ENCRYPTION_LEVELS) {
     decrypter_[alternative_decrypter_level_] = nullptr;
   }
@@ -4402,12 +4428,14 @@ void QuicFramer::InstallDecrypter(EncryptionLevel level,
                                   std::unique_ptr<QuicDecrypter> decrypter) {
   QUICHE_DCHECK(version_.KnowsWhichDecrypterToUse());
   QUIC_DVLOG(1) << ENDPOINT << "Installing decrypter at level " << level;
+  ClearPredecryptedPackets();
   decrypter_[level] = std::move(decrypter);
 }
 
 void QuicFramer::RemoveDecrypter(EncryptionLevel level) {
   QUICHE_DCHECK(version_.KnowsWhichDecrypterToUse());
   QUIC_DVLOG(1) << ENDPOINT << "Removing decrypter at level " << level;
+  ClearPredecryptedPackets();
   decrypter_[level] = nullptr;
 }
 
@@ -4419,6 +4447,7 @@ void QuicFramer::SetKeyUpdateSupportForConnection(bool enabled) {
 void QuicFramer::DiscardPreviousOneRttKeys() {
   QUICHE_DCHECK(support_key_update_for_connection_);
   QUIC_DVLOG(1) << ENDPOINT << "Discarding previous set of 1-RTT keys";
+  ClearPredecryptedPackets();
   previous_decrypter_ = nullptr;
 }
 
@@ -4435,6 +4464,10 @@ bool QuicFramer::DoKeyUpdate(KeyUpdateReason reason) {
     QUIC_BUG(quic_bug_10850_58) << "Failed to create next crypters";
     return false;
   }
+  // Pending packets are sealed with the keys they were encrypted with.
+  if (!SealPendingPacketsOrRaiseError()) {
+    return false;
+  }
   key_update_performed_ = true;
   current_key_phase_bit_ = !current_key_phase_bit_;
   QUIC_DLOG(INFO) << ENDPOINT << "DoKeyUpdate: new current_key_phase_bit_="
@@ -4492,11 +4525,17 @@ void QuicFramer::SetEncrypter(EncryptionLevel level,
   QUICHE_DCHECK_GE(level, 0);
   QUICHE_DCHECK_LT(level, NUM_ENCRYPTION_LEVELS);
   QUIC_DVLOG(1) << ENDPOINT << "Setting encrypter at level " << level;
+  if (level == ENCRYPTION_FORWARD_SECURE) {
+    SealPendingPacketsOrRaiseError();
+  }
   encrypter_[level] = std::move(encrypter);
 }
 
 void QuicFramer::RemoveEncrypter(EncryptionLevel level) {
   QUIC_DVLOG(1) << ENDPOINT << "Removing encrypter of " << level;
+  if (level == ENCRYPTION_FORWARD_SECURE) {
+    SealPendingPacketsOrRaiseError();
+  }
   encrypter_[level] = nullptr;
 }
 
@@ -4552,6 +4591,129 @@ constexpr bool IsLongHeader(uint8_t type_byte) {
 
 }  // namespace
 
+size_t QuicFramer::EncryptInPlaceDeferred(EncryptionLevel level,
+                                          QuicPacketNumber packet_number,
+                                          size_t ad_len, size_t total_len,
+                                          size_t buffer_len, char* buffer) {
+  if (level != ENCRYPTION_FORWARD_SECURE || !version_.HasHeaderProtection() ||
+      encrypter_[level] == nullptr || ad_len == 0 ||
+      IsLongHeader(static_cast<uint8_t>(buffer[0]))) {
+    return EncryptInPlace(level, packet_number, ad_len, total_len, buffer_len,
+                          buffer);
+  }
+  QUICHE_DCHECK(packet_number.IsInitialized());
+
+  QuicEncrypter* encrypter = encrypter_[level].get();
+  const size_t length =
+      ad_len + encrypter->GetCiphertextSize(total_len - ad_len);
+  if (length > buffer_len || ad_len < last_written_packet_number_length_ ||
+      ad_len - last_written_packet_number_length_ + 4 + kHPSampleLen >
+          length) {
+    // Let EncryptInPlace() report the error.
+    return EncryptInPlace(level, packet_number, ad_len, total_len, buffer_len,
+                          buffer);
+  }
+  PendingSeal seal;
+  seal.buffer = buffer;
+  seal.ad_len = ad_len;
+  seal.length = length;
+  seal.packet_number_length = last_written_packet_number_length_;
+  seal.packet_number = packet_number.ToUint64();
+  seal.plaintext_length = total_len - ad_len;
+  seal.encrypted = !GetQuicReloadableFlag(quic_batch_aead);
+  if (seal.encrypted) {
+    size_t output_length = 0;
+    if (!encrypter->EncryptPacket(
+            seal.packet_number,
+            absl::string_view(buffer, ad_len),  // Associated data
+            absl::string_view(buffer + ad_len,
+                              total_len - ad_len),  // Plaintext
+            buffer + ad_len,                        // Destination buffer
+            &output_length, buffer_len - ad_len)) {
+      RaiseError(QUIC_ENCRYPTION_FAILURE);
+      return 0;
+    }
+    QUICHE_DCHECK_EQ(length, ad_len + output_length);
+  } else {
+    QUIC_RELOADABLE_FLAG_COUNT_N(quic_batch_aead, 1, 2);
+  }
+  pending_seals_.push_back(seal);
+  return length;
+}
+
+bool QuicFramer::SealPendingPackets() {
+  if (pending_seals_.empty()) {
+    return true;
+  }
+  QuicEncrypter* encrypter = encrypter_[ENCRYPTION_FORWARD_SECURE].get();
+  bool success = encrypter != nullptr;
+  if (success) {
+    // The samples are taken from the ciphertext, so the deferred AEADs run
+    // first, in one batch.
+    pending_encryptions_.clear();
+    for (const PendingSeal& seal : pending_seals_) {
+      if (seal.encrypted) {
+        continue;
+      }
+      QuicEncrypter::PacketToEncrypt packet;
+      packet.packet_number = seal.packet_number;
+      packet.associated_data = absl::string_view(seal.buffer, seal.ad_len);
+      packet.plaintext =
+          absl::string_view(seal.buffer + seal.ad_len, seal.plaintext_length);
+      packet.output = seal.buffer + seal.ad_len;
+      packet.max_output_length = seal.length - seal.ad_len;
+      pending_encryptions_.push_back(packet);
+    }
+    success = pending_encryptions_.empty() ||
+              encrypter->EncryptPackets(absl::MakeSpan(pending_encryptions_));
+  }
+  if (success) {
+    pending_seal_samples_.clear();
+    for (const PendingSeal& seal : pending_seals_) {
+      // The sample starts 4 bytes after the start of the packet number.
+      pending_seal_samples_.push_back(absl::string_view(
+          seal.buffer + seal.ad_len - seal.packet_number_length + 4,
+          kHPSampleLen));
+    }
+    pending_seal_masks_.resize(pending_seal_samples_.size() *
+                               QuicEncrypter::kHeaderProtectionMaskLength);
+    success = encrypter->GenerateHeaderProtectionMasks(
+        pending_seal_samples_, pending_seal_masks_.data());
+  }
+  if (!success) {
+    QUIC_BUG(quic_framer_seal_pending_packets_failed)
+        << ENDPOINT << "Failed to seal " << pending_seals_.size()
+        << " packets";
+    // Never let a packet out unsealed.
+    for (const PendingSeal& seal : pending_seals_) {
+      memset(seal.buffer, 0, seal.length);
+    }
+    pending_seals_.clear();
+    return false;
+  }
+  const char* mask = pending_seal_masks_.data();
+  for (const PendingSeal& seal : pending_seals_) {
+    // Short header, so the mask covers the 5 least significant bits of the
+    // first byte, and the packet number ends the associated data.
+    seal.buffer[0] ^= mask[0] & 0x1f;
+    char* packet_number = seal.buffer + seal.ad_len - seal.packet_number_length;
+    for (size_t i = 0; i < seal.packet_number_length; ++i) {
+      packet_number[i] ^= mask[1 + i];
+    }
+    mask += QuicEncrypter::kHeaderProtectionMaskLength;
+  }
+  pending_seals_.clear();
+  return true;
+}
+
+bool QuicFramer::SealPendingPacketsOrRaiseError() {
+  if (SealPendingPackets()) {
+    return true;
+  }
+  set_detailed_error("Failed to seal pending packets.");
+  return RaiseError(QUIC_ENCRYPTION_FAILURE);
+}
+
 bool QuicFramer::ApplyHeaderProtection(EncryptionLevel level, char* buffer,
                                        size_t buffer_len, size_t ad_len) {
   QuicDataReader buffer_reader(buffer, buffer_len);
@@ -4638,6 +4800,227 @@ bool QuicFramer::ApplyHeaderProtection(EncryptionLevel level, char* buffer,
   return true;
 }
 
+void QuicFramer::PrecomputeHeaderProtectionMasks(
+    absl::Span<const absl::string_view> packets) {
+  ClearHeaderProtectionMasks();
+  QuicDecrypter* decrypter = decrypter_[ENCRYPTION_FORWARD_SECURE].get();
+  if (decrypter == nullptr || !version_.HasHeaderProtection() ||
+      !version_.HasLengthPrefixedConnectionIds()) {
+    return;
+  }
+  // Short headers are the type byte and the destination connection ID,
+  // followed by the packet number, whose first 4 bytes the sample skips.
+  const size_t sample_offset = 1 +
+                               (perspective_ == Perspective::IS_CLIENT
+                                    ? expected_client_connection_id_length_
+                                    : expected_server_connection_id_length_) +
+                               4;
+  for (absl::string_view packet : packets) {
+    if (packet.empty() || IsLongHeader(packet[0]) ||
+        packet.size() <
+            sample_offset + QuicDecrypter::kHeaderProtectionSampleLength) {
+      continue;
+    }
+    precomputed_mask_samples_.push_back(packet.substr(
+        sample_offset, QuicDecrypter::kHeaderProtectionSampleLength));
+  }
+  if (precomputed_mask_samples_.size() < 2) {
+    // Nothing to gain over computing the mask while processing the packet.
+    ClearHeaderProtectionMasks();
+    return;
+  }
+  precomputed_masks_.resize(precomputed_mask_samples_.size() *
+                            QuicDecrypter::kHeaderProtectionMaskLength);
+  if (!decrypter->GenerateHeaderProtectionMasks(precomputed_mask_samples_,
+                                                precomputed_masks_.data())) {
+    QUIC_DVLOG(1) << ENDPOINT << "Failed to precompute header protection masks";
+    ClearHeaderProtectionMasks();
+    return;
+  }
+  precomputed_masks_decrypter_ = decrypter;
+}
+
+void QuicFramer::ClearHeaderProtectionMasks() {
+  precomputed_mask_samples_.clear();
+  precomputed_masks_.clear();
+  precomputed_masks_decrypter_ = nullptr;
+  next_precomputed_mask_ = 0;
+}
+
+void QuicFramer::PredecryptPackets(
+    absl::Span<const absl::string_view> packets) {
+  ClearPredecryptedPackets();
+  QuicDecrypter* decrypter = decrypter_[ENCRYPTION_FORWARD_SECURE].get();
+  if (decrypter == nullptr || decrypter != precomputed_masks_decrypter_) {
+    return;
+  }
+  const size_t packet_number_offset =
+      1 + (perspective_ == Perspective::IS_CLIENT
+               ? expected_client_connection_id_length_
+               : expected_server_connection_id_length_);
+  size_t data_length = 0;
+  for (absl::string_view packet : packets) {
+    data_length += packet.size();
+  }
+  predecrypted_data_.resize(data_length);
+  // The packet numbers are decoded as if every packet before was processed,
+  // which they usually are. A packet whose number ends up decoded differently
+  // while being processed is decrypted again.
+  QuicPacketNumber largest_packet_number =
+      supports_multiple_packet_number_spaces_
+          ? largest_decrypted_packet_numbers_[APPLICATION_DATA]
+          : largest_packet_number_;
+  size_t mask_index = 0;
+  data_length = 0;
+  for (absl::string_view packet : packets) {
+    if (mask_index == precomputed_mask_samples_.size()) {
+      break;
+    }
+    // Only the packets whose mask was precomputed are decrypted.
+    if (packet.size() < packet_number_offset + 4 ||
+        precomputed_mask_samples_[mask_index].data() !=
+            packet.data() + packet_number_offset + 4) {
+      continue;
+    }
+    const char* mask = precomputed_masks_.data() +
+                       mask_index * QuicDecrypter::kHeaderProtectionMaskLength;
+    ++mask_index;
+    const uint8_t type_byte = static_cast<uint8_t>(packet[0]) ^
+                              (static_cast<uint8_t>(mask[0]) & 0x1f);
+    if (support_key_update_for_connection_ &&
+        ((type_byte & FLAGS_KEY_PHASE_BIT) != 0) != current_key_phase_bit_) {
+      // Not decrypted with the current keys, if at all.
+      continue;
+    }
+    const size_t packet_number_length = (type_byte & 0x03) + 1;
+    const size_t ad_length = packet_number_offset + packet_number_length;
+    char* associated_data = predecrypted_data_.data() + data_length;
+    memcpy(associated_data, packet.data(), ad_length);
+    associated_data[0] = static_cast<char>(type_byte);
+    uint64_t truncated_packet_number = 0;
+    for (size_t i = 0; i < packet_number_length; ++i) {
+      associated_data[packet_number_offset + i] ^= mask[1 + i];
+      truncated_packet_number =
+          (truncated_packet_number << 8) |
+          static_cast<uint8_t>(associated_data[packet_number_offset + i]);
+    }
+    const uint64_t packet_number = CalculatePacketNumberFromWire(
+        static_cast<QuicPacketNumberLength>(packet_number_length),
+        largest_packet_number, truncated_packet_number);
+    if (!IsValidFullPacketNumber(packet_number, version())) {
+      continue;
+    }
+    if (!largest_packet_number.IsInitialized() ||
+        packet_number > largest_packet_number.ToUint64()) {
+      largest_packet_number = QuicPacketNumber(packet_number);
+    }
+    PredecryptedPacket predecrypted;
+    predecrypted.ciphertext = packet.substr(ad_length);
+    predecrypted.packet_number = packet_number;
+    predecrypted.associated_data_offset = data_length;
+    predecrypted.associated_data_length = ad_length;
+    predecrypted.plaintext_offset = data_length + ad_length;
+    predecrypted.plaintext_length = 0;
+    predecrypted_packets_.push_back(predecrypted);
+    data_length += packet.size();
+  }
+  packets_to_decrypt_.clear();
+  for (const PredecryptedPacket& predecrypted : predecrypted_packets_) {
+    QuicDecrypter::PacketToDecrypt packet;
+    packet.packet_number = predecrypted.packet_number;
+    packet.associated_data = absl::string_view(
+        predecrypted_data_.data() + predecrypted.associated_data_offset,
+        predecrypted.associated_data_length);
+    packet.ciphertext = predecrypted.ciphertext;
+    packet.output = predecrypted_data_.data() + predecrypted.plaintext_offset;
+    packet.max_output_length = predecrypted.ciphertext.size();
+    packets_to_decrypt_.push_back(packet);
+  }
+  if (packets_to_decrypt_.empty() ||
+      decrypter->DecryptPackets(absl::MakeSpan(packets_to_decrypt_)) == 0) {
+    ClearPredecryptedPackets();
+    return;
+  }
+  // Keep the packets which decrypted; the others fall back to DecryptPacket()
+  // and are counted as failures there, if they fail again.
+  size_t num_decrypted = 0;
+  for (size_t i = 0; i < packets_to_decrypt_.size(); ++i) {
+    if (!packets_to_decrypt_[i].decrypted) {
+      continue;
+    }
+    predecrypted_packets_[num_decrypted] = predecrypted_packets_[i];
+    predecrypted_packets_[num_decrypted].plaintext_length =
+        packets_to_decrypt_[i].output_length;
+    ++num_decrypted;
+  }
+  predecrypted_packets_.resize(num_decrypted);
+  predecrypted_packets_decrypter_ = decrypter;
+}
+
+void QuicFramer::ClearPredecryptedPackets() {
+  predecrypted_packets_.clear();
+  packets_to_decrypt_.clear();
+  // The plaintexts take as much room as the batch, so they are not kept
+  // around by idle connections.
+  std::vector<char>().swap(predecrypted_data_);
+  predecrypted_packets_decrypter_ = nullptr;
+  next_predecrypted_packet_ = 0;
+}
+
+bool QuicFramer::LookUpPredecryptedPacket(const QuicDecrypter* decrypter,
+                                          uint64_t packet_number,
+                                          absl::string_view associated_data,
+                                          absl::string_view ciphertext,
+                                          char* output, size_t* output_length,
+                                          size_t max_output_length) {
+  if (decrypter != predecrypted_packets_decrypter_) {
+    return false;
+  }
+  // Packets are processed in the order they were decrypted, so the search
+  // resumes after the last packet found.
+  for (size_t i = next_predecrypted_packet_; i < predecrypted_packets_.size();
+       ++i) {
+    const PredecryptedPacket& packet = predecrypted_packets_[i];
+    if (packet.ciphertext.data() != ciphertext.data()) {
+      continue;
+    }
+    next_predecrypted_packet_ = i + 1;
+    if (packet.ciphertext.size() != ciphertext.size() ||
+        packet.packet_number != packet_number ||
+        packet.plaintext_length > max_output_length ||
+        absl::string_view(
+            predecrypted_data_.data() + packet.associated_data_offset,
+            packet.associated_data_length) != associated_data) {
+      return false;
+    }
+    memcpy(output, predecrypted_data_.data() + packet.plaintext_offset,
+           packet.plaintext_length);
+    *output_length = packet.plaintext_length;
+    return true;
+  }
+  return false;
+}
+
+absl::string_view QuicFramer::LookUpHeaderProtectionMask(
+    const QuicDecrypter* decrypter, const char* sample) {
+  if (decrypter != precomputed_masks_decrypter_) {
+    return absl::string_view();
+  }
+  // Packets are processed in the order their masks were computed, so the
+  // search resumes after the last mask found.
+  for (size_t i = next_precomputed_mask_; i < precomputed_mask_samples_.size();
+       ++i) {
+    if (precomputed_mask_samples_[i].data() == sample) {
+      next_precomputed_mask_ = i + 1;
+      return absl::string_view(
+          precomputed_masks_.data() +
+              i * QuicDecrypter::kHeaderProtectionMaskLength,
+          QuicDecrypter::kHeaderProtectionMaskLength);
+    }
+  }
+  return absl::string_view();
+}
+
 bool QuicFramer::RemoveHeaderProtection(QuicDataReader* reader,
                                         const QuicEncryptedPacket& packet,
                                         QuicPacketHeader* header,
@@ -4678,7 +5061,13 @@ bool QuicFramer::RemoveHeaderProtection(QuicDataReader* reader,
       return false;
     }
   }
-  std::string mask = decrypter->GenerateHeaderProtectionMask(&sample_reader);
+  std::string generated_mask;
+  absl::string_view mask = LookUpHeaderProtectionMask(
+      decrypter, sample_reader.PeekRemainingPayload().data());
+  if (mask.empty()) {
+    generated_mask = decrypter->GenerateHeaderProtectionMask(&sample_reader);
+    mask = generated_mask;
+  }
   QuicDataReader mask_reader(mask.data(), mask.size());
   if (mask.empty()) {
     QUIC_DVLOG(1) << "Failed to compute mask";
@@ -4941,9 +5330,13 @@ bool QuicFramer::DecryptPayload(size_t udp_packet_length,
     return false;
   }
 
-  bool success = decrypter->DecryptPacket(
-      header.packet_number.ToUint64(), associated_data, encrypted,
-      decrypted_buffer, decrypted_length, buffer_length);
+  bool success =
+      LookUpPredecryptedPacket(decrypter, header.packet_number.ToUint64(),
+                               associated_data, encrypted, decrypted_buffer,
+                               decrypted_length, buffer_length) ||
+      decrypter->DecryptPacket(header.packet_number.ToUint64(),
+                               associated_data, encrypted, decrypted_buffer,
+                               decrypted_length, buffer_length);
   if (success) {
     visitor_->OnDecryptedPacket(udp_packet_length, level);
     if (level == ENCRYPTION_ZERO_RTT &&
@@ -9,13 +9,16 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/quic_decrypter.h"
 #include "quiche/quic/core/crypto/quic_encrypter.h"
 #include "quiche/quic/core/crypto/quic_random.h"
 #include "quiche/quic/core/quic_connection_id.h"
 #include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_received_packet_buffer.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/platform/api/quic_export.h"
 
@@ -326,6 +329,27 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
     receive_timestamps_exponent_ = exponent;
   }
 
+  // If true, packets are decrypted into reference-counted
+  // QuicReceivedPacketBuffers instead of a buffer on the stack, so that the
+  // visitor can keep references to frame data past the end of the callback.
+  // Turning this off frees the buffer kept for the next packet.
+  void set_use_received_packet_buffers(bool use_received_packet_buffers) {
+    use_received_packet_buffers_ = use_received_packet_buffers;
+    if (!use_received_packet_buffers_) {
+      received_packet_buffer_.reset();
+    }
+  }
+  bool use_received_packet_buffers() const {
+    return use_received_packet_buffers_;
+  }
+
+  // Returns the buffer the packet being processed was decrypted into, or
+  // nullptr if it was not decrypted into a QuicReceivedPacketBuffer. Frame data
+  // passed to the visitor points into this buffer.
+  QuicReceivedPacketBuffer* current_received_packet_buffer() const {
+    return current_received_packet_buffer_;
+  }
+
   // Pass a UDP packet into the framer for parsing.
   // Return true if the packet was processed successfully. |packet| must be a
   // single, complete UDP packet (not a frame of a packet).  This packet
@@ -546,6 +570,23 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
   // successfully decrypted packet.
   QuicPacketCount PotentialPeerKeyUpdateAttemptCount() const;
 
+  // Computes the header protection masks of the 1-RTT short header packets
+  // among |packets| in one batch, ahead of processing them, so that the
+  // decrypter can compute several at once. The masks are used as the packets
+  // are processed, until ClearHeaderProtectionMasks() is called.
+  void PrecomputeHeaderProtectionMasks(
+      absl::Span<const absl::string_view> packets);
+  void ClearHeaderProtectionMasks();
+
+  // Decrypts, in one batch, the packets among |packets| whose header
+  // protection masks were precomputed, ahead of processing them. The
+  // plaintexts are used as the packets are processed, until
+  // ClearPredecryptedPackets() is called, which also happens when a decrypter
+  // is destroyed; packets processed differently than expected are decrypted
+  // again.
+  void PredecryptPackets(absl::Span<const absl::string_view> packets);
+  void ClearPredecryptedPackets();
+
   const QuicDecrypter* GetDecrypter(EncryptionLevel level) const;
   const QuicDecrypter* decrypter() const;
   const QuicDecrypter* alternative_decrypter() const;
@@ -567,6 +608,26 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
                         size_t ad_len, size_t total_len, size_t buffer_len,
                         char* buffer);
 
+  // Same as EncryptInPlace(), except that the header protection of 1-RTT short
+  // header packets is deferred until SealPendingPackets(), so that the masks of
+  // a burst of packets are generated together, as is their AEAD with
+  // --quic_reloadable_flag_quic_batch_aead. Until then, |buffer| must stay
+  // valid and the packet must neither be copied nor sent. Returns the length
+  // the packet has once sealed.
+  size_t EncryptInPlaceDeferred(EncryptionLevel level,
+                                QuicPacketNumber packet_number, size_t ad_len,
+                                size_t total_len, size_t buffer_len,
+                                char* buffer);
+
+  // Applies the AEAD and header protection deferred by
+  // EncryptInPlaceDeferred(). On failure, scrubs the pending packets and
+  // returns false without raising an error, as this may be called while the
+  // packets are being written.
+  bool SealPendingPackets();
+
+  // Whether any packet encrypted by EncryptInPlaceDeferred() is not sealed.
+  bool HasPendingSeals() const { return !pending_seals_.empty(); }
+
   // Returns the length of the data encrypted into |buffer| if |buffer_len| is
   // long enough, and otherwise 0.
   size_t EncryptPayload(EncryptionLevel level, QuicPacketNumber packet_number,
@@ -742,6 +803,25 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
   bool ApplyHeaderProtection(EncryptionLevel level, char* buffer,
                              size_t buffer_len, size_t ad_len);
 
+  // Calls SealPendingPackets() before the 1-RTT keys change, and raises an
+  // error if it fails.
+  bool SealPendingPacketsOrRaiseError();
+
+  // Returns the mask precomputed for the header protection sample at |sample|
+  // with |decrypter|, or an empty string_view if there is none.
+  absl::string_view LookUpHeaderProtectionMask(const QuicDecrypter* decrypter,
+                                               const char* sample);
+
+  // Copies the plaintext PredecryptPackets() got for |ciphertext| with
+  // |decrypter|, |packet_number| and |associated_data| to |output|. Returns
+  // false if there is none.
+  bool LookUpPredecryptedPacket(const QuicDecrypter* decrypter,
+                                uint64_t packet_number,
+                                absl::string_view associated_data,
+                                absl::string_view ciphertext, char* output,
+                                size_t* output_length,
+                                size_t max_output_length);
+
   // Removes header protection from an IETF QUIC packet header.
   //
   // The packet number from the header is read from |reader|, where the packet
@@ -1188,6 +1268,69 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
   // The type of the IETF frame preceding the frame currently being processed. 0
   // when not processing a frame or only 1 frame has been processed.
   uint64_t previously_received_frame_type_;
+
+  // Whether packets are decrypted into |received_packet_buffer_|.
+  bool use_received_packet_buffers_;
+  // The buffer the next packet is decrypted into. Replaced when something
+  // still references it.
+  QuicReceivedPacketBuffer::Pointer received_packet_buffer_;
+  // The buffer of the packet being processed, if any.
+  QuicReceivedPacketBuffer* current_received_packet_buffer_;
+
+  // Header protection samples passed to PrecomputeHeaderProtectionMasks(), in
+  // the order of their packets, and their masks. A mask is only used for the
+  // sample it was computed from, so packets which are not processed, or are
+  // processed from a copy, fall back to computing their own. Both keep their
+  // capacity from one batch to the next.
+  std::vector<absl::string_view> precomputed_mask_samples_;
+  std::vector<char> precomputed_masks_;
+  // The decrypter |precomputed_masks_| were computed with.
+  const QuicDecrypter* precomputed_masks_decrypter_ = nullptr;
+  // Index of the first mask not looked up yet.
+  size_t next_precomputed_mask_ = 0;
+
+  // A packet decrypted by PredecryptPackets().
+  struct QUIC_NO_EXPORT PredecryptedPacket {
+    // Points into the packet passed to PredecryptPackets().
+    absl::string_view ciphertext;
+    uint64_t packet_number;
+    // Where the unprotected header and the plaintext are in
+    // |predecrypted_data_|.
+    size_t associated_data_offset;
+    size_t associated_data_length;
+    size_t plaintext_offset;
+    size_t plaintext_length;
+  };
+  // Packets decrypted by PredecryptPackets(), in the order of the batch.
+  std::vector<PredecryptedPacket> predecrypted_packets_;
+  std::vector<QuicDecrypter::PacketToDecrypt> packets_to_decrypt_;
+  std::vector<char> predecrypted_data_;
+  // The decrypter |predecrypted_packets_| were decrypted with.
+  const QuicDecrypter* predecrypted_packets_decrypter_ = nullptr;
+  // Index of the first packet not looked up yet.
+  size_t next_predecrypted_packet_ = 0;
+
+  // A packet passed to EncryptInPlaceDeferred() and not sealed yet.
+  struct QUIC_NO_EXPORT PendingSeal {
+    char* buffer;
+    // Length of the associated data, which ends with the packet number.
+    size_t ad_len;
+    // Length of the sealed packet.
+    size_t length;
+    size_t packet_number_length;
+    uint64_t packet_number;
+    size_t plaintext_length;
+    // Whether the payload is already encrypted, and only header protection is
+    // pending.
+    bool encrypted;
+  };
+  // Packets waiting for SealPendingPackets(), and the AEAD inputs, samples and
+  // masks used to seal them, which keep their capacity from one burst to the
+  // next.
+  std::vector<PendingSeal> pending_seals_;
+  std::vector<QuicEncrypter::PacketToEncrypt> pending_encryptions_;
+  std::vector<absl::string_view> pending_seal_samples_;
+  std::vector<char> pending_seal_masks_;
 };
 
 // Look for and parse the error code from the "<quic_error_code>:" text that
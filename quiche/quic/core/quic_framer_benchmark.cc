@@ -0,0 +1,119 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures serializing and parsing a short header packet carrying a single
+// STREAM frame, as sent and received by a connection past the handshake. The
+// packets are protected with NullEncrypter, see aead_benchmark.cc for the cost
+// of the AEADs.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/crypto/null_decrypter.h"
+#include "quiche/quic/core/crypto/null_encrypter.h"
+#include "quiche/quic/core/frames/quic_stream_frame.h"
+#include "quiche/quic/core/quic_framer.h"
+#include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_utils.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace {
+
+using test::NoOpFramerVisitor;
+using test::TestConnectionId;
+
+QuicPacketHeader ShortHeader(uint64_t packet_number) {
+  QuicPacketHeader header;
+  header.destination_connection_id = TestConnectionId();
+  header.destination_connection_id_included = CONNECTION_ID_PRESENT;
+  header.source_connection_id_included = CONNECTION_ID_ABSENT;
+  header.form = IETF_QUIC_SHORT_HEADER_PACKET;
+  header.version_flag = false;
+  header.reset_flag = false;
+  header.packet_number = QuicPacketNumber(packet_number);
+  header.packet_number_length = PACKET_4BYTE_PACKET_NUMBER;
+  return header;
+}
+
+QuicStreamId ClientStreamId(const ParsedQuicVersion& version) {
+  return QuicUtils::GetFirstBidirectionalStreamId(version.transport_version,
+                                                  Perspective::IS_CLIENT);
+}
+
+void BM_BuildDataPacket(benchmark::State& state) {
+  const ParsedQuicVersion version = ParsedQuicVersion::RFCv1();
+  QuicFramer framer({version}, QuicTime::Zero(), Perspective::IS_CLIENT,
+                    kQuicDefaultConnectionIdLength);
+  NoOpFramerVisitor visitor;
+  framer.set_visitor(&visitor);
+  framer.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                      std::make_unique<NullEncrypter>(Perspective::IS_CLIENT));
+
+  const std::string payload(state.range(0), 'a');
+  char buffer[kMaxOutgoingPacketSize];
+  uint64_t packet_number = 1;
+  QuicStreamOffset offset = 0;
+  for (auto _ : state) {
+    QuicFrames frames = {QuicFrame(QuicStreamFrame(
+        ClientStreamId(version), /*fin=*/false, offset, payload))};
+    const size_t length =
+        framer.BuildDataPacket(ShortHeader(packet_number++), frames, buffer,
+                               sizeof(buffer), ENCRYPTION_FORWARD_SECURE);
+    benchmark::DoNotOptimize(length);
+    offset += payload.size();
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_BuildDataPacket)->Arg(100)->Arg(1000);
+
+void BM_ProcessPacket(benchmark::State& state) {
+  const ParsedQuicVersion version = ParsedQuicVersion::RFCv1();
+  QuicFramer sender({version}, QuicTime::Zero(), Perspective::IS_CLIENT,
+                    kQuicDefaultConnectionIdLength);
+  sender.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                      std::make_unique<NullEncrypter>(Perspective::IS_CLIENT));
+  QuicFramer receiver({version}, QuicTime::Zero(), Perspective::IS_SERVER,
+                      kQuicDefaultConnectionIdLength);
+  NoOpFramerVisitor visitor;
+  receiver.set_visitor(&visitor);
+  receiver.InstallDecrypter(
+      ENCRYPTION_FORWARD_SECURE,
+      std::make_unique<NullDecrypter>(Perspective::IS_SERVER));
+
+  const std::string payload(state.range(0), 'a');
+  const QuicPacketHeader header = ShortHeader(/*packet_number=*/1);
+  QuicFrames frames = {QuicFrame(QuicStreamFrame(
+      ClientStreamId(version), /*fin=*/false, /*offset=*/0, payload))};
+  std::unique_ptr<QuicPacket> packet =
+      test::BuildUnsizedDataPacket(&sender, header, frames);
+  char buffer[kMaxOutgoingPacketSize];
+  const size_t length =
+      sender.EncryptPayload(ENCRYPTION_FORWARD_SECURE, header.packet_number,
+                            *packet, buffer, sizeof(buffer));
+  if (length == 0) {
+    state.SkipWithError("Failed to encrypt packet");
+    return;
+  }
+  const QuicEncryptedPacket encrypted(buffer, length);
+
+  for (auto _ : state) {
+    // The same packet is processed repeatedly. The framer does not track
+    // duplicates, that is left to the connection.
+    if (!receiver.ProcessPacket(encrypted)) {
+      state.SkipWithError("Failed to process packet");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_ProcessPacket)->Arg(100)->Arg(1000);
+
+}  // namespace
+}  // namespace quic
+
+BENCHMARK_MAIN();
@@ -17,6 +17,7 @@
 #include "absl/strings/escaping.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/aes_128_gcm_encrypter.h"
 #include "quiche/quic/core/crypto/null_decrypter.h"
 #include "quiche/quic/core/crypto/null_encrypter.h"
 #include "quiche/quic/core/crypto/quic_decrypter.h"
@@ -16368,6 +16369,276 @@ TEST_P(QuicFramerTest, ErrorWhenUnexpectedFrameTypeEncountered) {
       framer_.detailed_error());
 }
 
+// Counts how header protection masks are generated and packets decrypted.
+class MaskCountingDecrypter : public StrictTaggingDecrypter {
+ public:
+  MaskCountingDecrypter() : StrictTaggingDecrypter(/*tag=*/0) {}
+
+  bool DecryptPacket(uint64_t packet_number, absl::string_view associated_data,
+                     absl::string_view ciphertext, char* output,
+                     size_t* output_length, size_t max_output_length) override {
+    ++num_packets_decrypted_;
+    return StrictTaggingDecrypter::DecryptPacket(
+        packet_number, associated_data, ciphertext, output, output_length,
+        max_output_length);
+  }
+  size_t DecryptPackets(absl::Span<PacketToDecrypt> packets) override {
+    ++num_packet_batches_decrypted_;
+    return StrictTaggingDecrypter::DecryptPackets(packets);
+  }
+
+  std::string GenerateHeaderProtectionMask(
+      QuicDataReader* sample_reader) override {
+    ++num_masks_generated_;
+    return StrictTaggingDecrypter::GenerateHeaderProtectionMask(sample_reader);
+  }
+  bool GenerateHeaderProtectionMasks(
+      absl::Span<const absl::string_view> samples, char* masks) override {
+    ++num_mask_batches_generated_;
+    memset(masks, 0, samples.size() * kHeaderProtectionMaskLength);
+    return true;
+  }
+
+  int num_masks_generated_ = 0;
+  int num_mask_batches_generated_ = 0;
+  int num_packets_decrypted_ = 0;
+  int num_packet_batches_decrypted_ = 0;
+};
+
+TEST_P(QuicFramerTest, PrecomputeHeaderProtectionMasks) {
+  if (!framer_.version().UsesTls()) {
+    return;
+  }
+  ASSERT_TRUE(framer_.version().KnowsWhichDecrypterToUse());
+  auto decrypter = std::make_unique<MaskCountingDecrypter>();
+  MaskCountingDecrypter* counting_decrypter = decrypter.get();
+  framer_.InstallDecrypter(ENCRYPTION_FORWARD_SECURE, std::move(decrypter));
+
+  QuicPacketHeader header;
+  header.destination_connection_id = FramerTestConnectionId();
+  header.reset_flag = false;
+  header.version_flag = false;
+  header.packet_number = kPacketNumber;
+  QuicFrames frames = {QuicFrame(QuicPaddingFrame())};
+
+  QuicFramerPeer::SetPerspective(&framer_, Perspective::IS_CLIENT);
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> packets;
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<QuicPacket> data(BuildDataPacket(header, frames));
+    ASSERT_TRUE(data != nullptr);
+    packets.push_back(EncryptPacketWithTagAndPhase(*data, 0, false));
+    ASSERT_TRUE(packets.back() != nullptr);
+    header.packet_number += 1;
+  }
+  QuicFramerPeer::SetPerspective(&framer_, Perspective::IS_SERVER);
+
+  framer_.PrecomputeHeaderProtectionMasks(
+      {packets[0]->AsStringPiece(), packets[1]->AsStringPiece()});
+  EXPECT_EQ(1, counting_decrypter->num_mask_batches_generated_);
+  EXPECT_TRUE(framer_.ProcessPacket(*packets[0]));
+  EXPECT_TRUE(framer_.ProcessPacket(*packets[1]));
+  EXPECT_EQ(0, counting_decrypter->num_masks_generated_);
+
+  // A packet which was not part of the batch computes its own mask.
+  EXPECT_TRUE(framer_.ProcessPacket(*packets[2]));
+  EXPECT_EQ(1, counting_decrypter->num_masks_generated_);
+  framer_.ClearHeaderProtectionMasks();
+}
+
+TEST_P(QuicFramerTest, PredecryptPackets) {
+  if (!framer_.version().UsesTls()) {
+    return;
+  }
+  ASSERT_TRUE(framer_.version().KnowsWhichDecrypterToUse());
+  auto decrypter = std::make_unique<MaskCountingDecrypter>();
+  MaskCountingDecrypter* counting_decrypter = decrypter.get();
+  framer_.InstallDecrypter(ENCRYPTION_FORWARD_SECURE, std::move(decrypter));
+
+  QuicPacketHeader header;
+  header.destination_connection_id = FramerTestConnectionId();
+  header.reset_flag = false;
+  header.version_flag = false;
+  header.packet_number = kPacketNumber;
+  QuicFrames frames = {QuicFrame(QuicPaddingFrame())};
+
+  QuicFramerPeer::SetPerspective(&framer_, Perspective::IS_CLIENT);
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> packets;
+  for (int i = 0; i < 4; ++i) {
+    std::unique_ptr<QuicPacket> data(BuildDataPacket(header, frames));
+    ASSERT_TRUE(data != nullptr);
+    // The third packet does not authenticate.
+    packets.push_back(EncryptPacketWithTagAndPhase(*data, i == 2 ? 1 : 0,
+                                                   /*phase=*/false));
+    ASSERT_TRUE(packets.back() != nullptr);
+    header.packet_number += 1;
+  }
+  QuicFramerPeer::SetPerspective(&framer_, Perspective::IS_SERVER);
+
+  // Predecrypting requires the masks.
+  framer_.PredecryptPackets(
+      {packets[0]->AsStringPiece(), packets[1]->AsStringPiece()});
+  EXPECT_EQ(0, counting_decrypter->num_packet_batches_decrypted_);
+
+  std::vector<absl::string_view> batch = {packets[0]->AsStringPiece(),
+                                          packets[1]->AsStringPiece(),
+                                          packets[2]->AsStringPiece()};
+  framer_.PrecomputeHeaderProtectionMasks(batch);
+  framer_.PredecryptPackets(batch);
+  EXPECT_EQ(1, counting_decrypter->num_packet_batches_decrypted_);
+  EXPECT_EQ(3, counting_decrypter->num_packets_decrypted_);
+
+  // The packets which were decrypted in the batch are not decrypted again.
+  EXPECT_TRUE(framer_.ProcessPacket(*packets[0]));
+  EXPECT_TRUE(framer_.ProcessPacket(*packets[1]));
+  EXPECT_EQ(kPacketNumber + 1, visitor_.header_->packet_number);
+  EXPECT_EQ(3, counting_decrypter->num_packets_decrypted_);
+
+  // The packet which failed to decrypt in the batch is decrypted again, and
+  // fails again.
+  EXPECT_FALSE(framer_.ProcessPacket(*packets[2]));
+  EXPECT_EQ(4, counting_decrypter->num_packets_decrypted_);
+
+  // So is a packet which was not part of the batch.
+  EXPECT_TRUE(framer_.ProcessPacket(*packets[3]));
+  EXPECT_EQ(5, counting_decrypter->num_packets_decrypted_);
+  framer_.ClearPredecryptedPackets();
+  framer_.ClearHeaderProtectionMasks();
+}
+
+std::unique_ptr<QuicEncrypter> CreateAes128GcmEncrypter(char key_byte) {
+  auto encrypter = std::make_unique<Aes128GcmEncrypter>();
+  EXPECT_TRUE(encrypter->SetKey(std::string(16, key_byte)));
+  EXPECT_TRUE(encrypter->SetIV(std::string(12, key_byte)));
+  EXPECT_TRUE(encrypter->SetHeaderProtectionKey(std::string(16, key_byte)));
+  return encrypter;
+}
+
+TEST_P(QuicFramerTest, EncryptInPlaceDeferred) {
+  if (!framer_.version().HasHeaderProtection()) {
+    return;
+  }
+  framer_.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                       CreateAes128GcmEncrypter('a'));
+
+  QuicPacketHeader header;
+  header.destination_connection_id = FramerTestConnectionId();
+  header.reset_flag = false;
+  header.version_flag = false;
+  header.packet_number = kPacketNumber;
+  QuicFrames frames = {QuicFrame(QuicPaddingFrame())};
+
+  std::vector<std::string> expected_packets;
+  std::vector<std::string> buffers;
+  buffers.reserve(3);
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<QuicPacket> data(BuildDataPacket(header, frames));
+    ASSERT_TRUE(data != nullptr);
+    const size_t ad_len =
+        data->AssociatedData(framer_.transport_version()).length();
+
+    char expected_buffer[kMaxOutgoingPacketSize];
+    memcpy(expected_buffer, data->data(), data->length());
+    const size_t expected_length = framer_.EncryptInPlace(
+        ENCRYPTION_FORWARD_SECURE, header.packet_number, ad_len,
+        data->length(), kMaxOutgoingPacketSize, expected_buffer);
+    ASSERT_NE(0u, expected_length);
+    expected_packets.push_back(std::string(expected_buffer, expected_length));
+
+    buffers.push_back(std::string(kMaxOutgoingPacketSize, '\0'));
+    memcpy(&buffers.back()[0], data->data(), data->length());
+    EXPECT_EQ(expected_length,
+              framer_.EncryptInPlaceDeferred(
+                  ENCRYPTION_FORWARD_SECURE, header.packet_number, ad_len,
+                  data->length(), kMaxOutgoingPacketSize, &buffers.back()[0]));
+    // Only the header protection is deferred.
+    EXPECT_EQ(expected_packets.back().substr(ad_len),
+              buffers.back().substr(ad_len, expected_length - ad_len));
+    header.packet_number += 1;
+  }
+  EXPECT_TRUE(framer_.HasPendingSeals());
+
+  EXPECT_TRUE(framer_.SealPendingPackets());
+  EXPECT_FALSE(framer_.HasPendingSeals());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    EXPECT_EQ(expected_packets[i],
+              buffers[i].substr(0, expected_packets[i].size()));
+  }
+
+  // Changing the 1-RTT encrypter seals pending packets with the previous one.
+  std::unique_ptr<QuicPacket> data(BuildDataPacket(header, frames));
+  ASSERT_TRUE(data != nullptr);
+  const size_t ad_len =
+      data->AssociatedData(framer_.transport_version()).length();
+  char expected_buffer[kMaxOutgoingPacketSize];
+  memcpy(expected_buffer, data->data(), data->length());
+  const size_t expected_length = framer_.EncryptInPlace(
+      ENCRYPTION_FORWARD_SECURE, header.packet_number, ad_len, data->length(),
+      kMaxOutgoingPacketSize, expected_buffer);
+  ASSERT_NE(0u, expected_length);
+  char buffer[kMaxOutgoingPacketSize];
+  memcpy(buffer, data->data(), data->length());
+  EXPECT_EQ(expected_length,
+            framer_.EncryptInPlaceDeferred(
+                ENCRYPTION_FORWARD_SECURE, header.packet_number, ad_len,
+                data->length(), kMaxOutgoingPacketSize, buffer));
+  framer_.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                       CreateAes128GcmEncrypter('b'));
+  EXPECT_FALSE(framer_.HasPendingSeals());
+  EXPECT_EQ(absl::string_view(expected_buffer, expected_length),
+            absl::string_view(buffer, expected_length));
+}
+
+TEST_P(QuicFramerTest, EncryptInPlaceDeferredAead) {
+  if (!framer_.version().HasHeaderProtection()) {
+    return;
+  }
+  SetQuicReloadableFlag(quic_batch_aead, true);
+  framer_.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                       CreateAes128GcmEncrypter('a'));
+
+  QuicPacketHeader header;
+  header.destination_connection_id = FramerTestConnectionId();
+  header.reset_flag = false;
+  header.version_flag = false;
+  header.packet_number = kPacketNumber;
+  QuicFrames frames = {QuicFrame(QuicPaddingFrame())};
+
+  std::vector<std::string> expected_packets;
+  std::vector<std::string> buffers;
+  buffers.reserve(3);
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<QuicPacket> data(BuildDataPacket(header, frames));
+    ASSERT_TRUE(data != nullptr);
+    const size_t ad_len =
+        data->AssociatedData(framer_.transport_version()).length();
+
+    char expected_buffer[kMaxOutgoingPacketSize];
+    memcpy(expected_buffer, data->data(), data->length());
+    const size_t expected_length = framer_.EncryptInPlace(
+        ENCRYPTION_FORWARD_SECURE, header.packet_number, ad_len,
+        data->length(), kMaxOutgoingPacketSize, expected_buffer);
+    ASSERT_NE(0u, expected_length);
+    expected_packets.push_back(std::string(expected_buffer, expected_length));
+
+    buffers.push_back(std::string(kMaxOutgoingPacketSize, '\0'));
+    memcpy(&buffers.back()[0], data->data(), data->length());
+    EXPECT_EQ(expected_length,
+              framer_.EncryptInPlaceDeferred(
+                  ENCRYPTION_FORWARD_SECURE, header.packet_number, ad_len,
+                  data->length(), kMaxOutgoingPacketSize, &buffers.back()[0]));
+    // Nothing is encrypted yet.
+    EXPECT_EQ(data->AsStringPiece(), buffers.back().substr(0, data->length()));
+    header.packet_number += 1;
+  }
+
+  EXPECT_TRUE(framer_.SealPendingPackets());
+  EXPECT_FALSE(framer_.HasPendingSeals());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    EXPECT_EQ(expected_packets[i],
+              buffers[i].substr(0, expected_packets[i].size()));
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
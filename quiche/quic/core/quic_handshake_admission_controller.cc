@@ -0,0 +1,143 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_handshake_admission_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+const float kAlpha = 0.125f;
+const float kOneMinusAlpha = (1 - kAlpha);
+
+}  // namespace
+
+QuicHandshakeAdmissionController::QuicHandshakeAdmissionController(
+    const Options& options)
+    : options_(options),
+      smoothed_lag_(QuicTime::Delta::Zero()),
+      last_lag_sample_time_(QuicTime::Zero()),
+      smoothed_handshake_time_(QuicTime::Delta::Zero()),
+      buckets_(options.max_tracked_prefixes) {}
+
+bool QuicHandshakeAdmissionController::ShouldAdmitHandshake(
+    const QuicIpAddress& peer_address, QuicTime receipt_time, QuicTime now) {
+  DecayLag(now);
+  if (receipt_time.IsInitialized() && now >= receipt_time) {
+    smoothed_lag_ =
+        kOneMinusAlpha * smoothed_lag_ + kAlpha * (now - receipt_time);
+  }
+
+  switch (load_level()) {
+    case NORMAL_LOAD:
+      break;
+    case ELEVATED_LOAD:
+      if (!TakePrefixToken(peer_address, now)) {
+        QUIC_DVLOG(1) << "Refusing handshake from " << peer_address
+                      << ", smoothed lag " << smoothed_lag_;
+        ++stats_.handshakes_refused_for_prefix;
+        return false;
+      }
+      break;
+    case OVERLOADED:
+      QUIC_DVLOG(1) << "Refusing handshake from " << peer_address
+                    << " while overloaded, smoothed lag " << smoothed_lag_;
+      ++stats_.handshakes_refused_overloaded;
+      return false;
+  }
+  ++stats_.handshakes_admitted;
+  return true;
+}
+
+void QuicHandshakeAdmissionController::OnHandshakeProcessed(
+    QuicTime::Delta processing_time) {
+  if (smoothed_handshake_time_.IsZero()) {
+    smoothed_handshake_time_ = processing_time;
+    return;
+  }
+  smoothed_handshake_time_ =
+      kOneMinusAlpha * smoothed_handshake_time_ + kAlpha * processing_time;
+}
+
+size_t QuicHandshakeAdmissionController::MaxSessionsPerEventLoop(
+    size_t max_sessions) const {
+  if (smoothed_handshake_time_.IsZero()) {
+    return max_sessions;
+  }
+  const int64_t affordable =
+      options_.handshake_time_per_event_loop.ToMicroseconds() /
+      std::max<int64_t>(1, smoothed_handshake_time_.ToMicroseconds());
+  // Always make progress, even if a single handshake exceeds the budget.
+  return std::clamp<size_t>(affordable, 1, max_sessions);
+}
+
+void QuicHandshakeAdmissionController::DecayLag(QuicTime now) {
+  if (now <= last_lag_sample_time_) {
+    return;
+  }
+  if (!options_.lag_half_life.IsZero()) {
+    const double half_lives =
+        static_cast<double>((now - last_lag_sample_time_).ToMicroseconds()) /
+        options_.lag_half_life.ToMicroseconds();
+    smoothed_lag_ = smoothed_lag_ * std::exp2(-half_lives);
+  }
+  last_lag_sample_time_ = now;
+}
+
+QuicHandshakeAdmissionController::LoadLevel
+QuicHandshakeAdmissionController::load_level() const {
+  if (smoothed_lag_ >= options_.overloaded_lag) {
+    return OVERLOADED;
+  }
+  if (smoothed_lag_ >= options_.elevated_lag) {
+    return ELEVATED_LOAD;
+  }
+  return NORMAL_LOAD;
+}
+
+std::string QuicHandshakeAdmissionController::PrefixKey(
+    const QuicIpAddress& address) const {
+  const QuicIpAddress normalized = address.Normalized();
+  const int prefix_length = normalized.IsIPv4() ? options_.ipv4_prefix_length
+                                                : options_.ipv6_prefix_length;
+  std::string key = normalized.ToPackedString();
+  const size_t prefix_bytes = (prefix_length + 7) / 8;
+  if (prefix_bytes < key.size()) {
+    key.resize(prefix_bytes);
+  }
+  if (prefix_length % 8 != 0 && !key.empty()) {
+    key.back() &= static_cast<char>(0xff << (8 - prefix_length % 8));
+  }
+  return key;
+}
+
+bool QuicHandshakeAdmissionController::TakePrefixToken(
+    const QuicIpAddress& address, QuicTime now) {
+  const std::string key = PrefixKey(address);
+  auto it = buckets_.Lookup(key);
+  if (it == buckets_.end()) {
+    buckets_.Insert(key, std::make_unique<TokenBucket>(TokenBucket{
+                             options_.handshake_burst_per_prefix - 1, now}));
+    return true;
+  }
+  TokenBucket& bucket = *it->second;
+  const double refill = (now - bucket.last_refill).ToMicroseconds() *
+                        options_.handshakes_per_second_per_prefix / 1e6;
+  bucket.tokens =
+      std::min(options_.handshake_burst_per_prefix, bucket.tokens + refill);
+  bucket.last_refill = now;
+  if (bucket.tokens < 1) {
+    return false;
+  }
+  bucket.tokens -= 1;
+  return true;
+}
+
+}  // namespace quic
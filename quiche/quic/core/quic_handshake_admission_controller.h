@@ -0,0 +1,131 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_HANDSHAKE_ADMISSION_CONTROLLER_H_
+#define QUICHE_QUIC_CORE_QUIC_HANDSHAKE_ADMISSION_CONTROLLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "quiche/quic/core/quic_lru_cache.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+
+namespace quic {
+
+// Decides whether a dispatcher creates sessions for new client hellos, so that
+// a storm of handshakes cannot starve the connections it already serves.
+//
+// Load is measured as event loop lag: the time client hellos wait between the
+// kernel receiving them and the dispatcher processing them, which includes
+// their time in the socket queue and so grows with everything the event loop
+// does. Sockets which do not report kernel receive timestamps only yield the
+// time since the packet was read, which misses the queueing. While the
+// smoothed lag is low, every handshake is admitted. Above |elevated_lag|, each
+// source prefix gets a token bucket of handshakes, so that a few sources
+// cannot crowd out the others. Above |overloaded_lag|, no handshake is
+// admitted until the lag recedes. Lag is only sampled from client hellos, so
+// the smoothed lag also decays with the time since the last sample, and an
+// idle server recovers even when no handshake arrives to measure it.
+//
+// The measured cost of handshakes also bounds how many sessions the dispatcher
+// creates per event loop, so that their total cost fits in a time budget.
+class QUIC_EXPORT_PRIVATE QuicHandshakeAdmissionController {
+ public:
+  struct QUIC_EXPORT_PRIVATE Options {
+    // Smoothed lag from which handshakes are limited per source prefix.
+    QuicTime::Delta elevated_lag = QuicTime::Delta::FromMilliseconds(5);
+    // Smoothed lag from which all handshakes are refused.
+    QuicTime::Delta overloaded_lag = QuicTime::Delta::FromMilliseconds(50);
+    // Time in which the smoothed lag halves while no lag is sampled.
+    QuicTime::Delta lag_half_life = QuicTime::Delta::FromMilliseconds(200);
+    // Time the sessions created in one event loop may take to process their
+    // first packets.
+    QuicTime::Delta handshake_time_per_event_loop =
+        QuicTime::Delta::FromMilliseconds(5);
+    // Length of the prefixes sources are grouped by.
+    int ipv4_prefix_length = 24;
+    int ipv6_prefix_length = 48;
+    // Sustained rate and burst of handshakes admitted per source prefix while
+    // the lag is elevated.
+    double handshakes_per_second_per_prefix = 10;
+    double handshake_burst_per_prefix = 20;
+    // Most source prefixes tracked. The least recently seen are forgotten
+    // first, and start again with a full bucket.
+    size_t max_tracked_prefixes = 16384;
+  };
+
+  enum LoadLevel : uint8_t {
+    NORMAL_LOAD,
+    ELEVATED_LOAD,
+    OVERLOADED,
+  };
+
+  struct QUIC_EXPORT_PRIVATE Stats {
+    uint64_t handshakes_admitted = 0;
+    // Handshakes refused because their source prefix ran out of tokens.
+    uint64_t handshakes_refused_for_prefix = 0;
+    // Handshakes refused because the dispatcher was overloaded.
+    uint64_t handshakes_refused_overloaded = 0;
+  };
+
+  explicit QuicHandshakeAdmissionController(const Options& options);
+  QuicHandshakeAdmissionController(const QuicHandshakeAdmissionController&) =
+      delete;
+  QuicHandshakeAdmissionController& operator=(
+      const QuicHandshakeAdmissionController&) = delete;
+
+  // Called for each new client hello received by the kernel at |receipt_time|
+  // from |peer_address| and processed at |now|. Returns true if a session
+  // should be created for it.
+  bool ShouldAdmitHandshake(const QuicIpAddress& peer_address,
+                            QuicTime receipt_time, QuicTime now);
+
+  // Called after a session processed the first packets of a handshake, which
+  // took |processing_time|.
+  void OnHandshakeProcessed(QuicTime::Delta processing_time);
+
+  // Returns how many sessions to create in an event loop, at most
+  // |max_sessions|.
+  size_t MaxSessionsPerEventLoop(size_t max_sessions) const;
+
+  LoadLevel load_level() const;
+
+  QuicTime::Delta smoothed_lag() const { return smoothed_lag_; }
+  QuicTime::Delta smoothed_handshake_time() const {
+    return smoothed_handshake_time_;
+  }
+  size_t num_tracked_prefixes() const { return buckets_.Size(); }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct QUIC_EXPORT_PRIVATE TokenBucket {
+    double tokens;
+    QuicTime last_refill;
+  };
+
+  // Decays |smoothed_lag_| for the time between the last sample and |now|.
+  void DecayLag(QuicTime now);
+
+  // Returns the bytes of the prefix of |address| handshakes are counted by.
+  std::string PrefixKey(const QuicIpAddress& address) const;
+
+  // Takes a token from the bucket of |address|'s prefix, returning false if it
+  // is empty.
+  bool TakePrefixToken(const QuicIpAddress& address, QuicTime now);
+
+  const Options options_;
+  // Exponentially weighted moving averages, as RttStats computes.
+  QuicTime::Delta smoothed_lag_;
+  QuicTime last_lag_sample_time_;
+  QuicTime::Delta smoothed_handshake_time_;
+  QuicLRUCache<std::string, TokenBucket> buckets_;
+  Stats stats_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_HANDSHAKE_ADMISSION_CONTROLLER_H_
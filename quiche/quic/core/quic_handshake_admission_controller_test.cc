@@ -0,0 +1,172 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_handshake_admission_controller.h"
+
+#include <cstdint>
+#include <string>
+
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicHandshakeAdmissionControllerTest : public QuicTest {
+ protected:
+  QuicHandshakeAdmissionControllerTest()
+      : now_(QuicTime::Zero() + QuicTime::Delta::FromSeconds(1)) {
+    options_.elevated_lag = QuicTime::Delta::FromMilliseconds(5);
+    options_.overloaded_lag = QuicTime::Delta::FromMilliseconds(50);
+    options_.handshakes_per_second_per_prefix = 10;
+    options_.handshake_burst_per_prefix = 2;
+  }
+
+  static QuicIpAddress Address(const std::string& address) {
+    QuicIpAddress ip;
+    EXPECT_TRUE(ip.FromString(address));
+    return ip;
+  }
+
+  // Offers a handshake from |address| whose packet waited |lag|.
+  bool Admit(QuicHandshakeAdmissionController* controller,
+             const std::string& address, QuicTime::Delta lag) {
+    return controller->ShouldAdmitHandshake(Address(address), now_ - lag,
+                                            now_);
+  }
+
+  // Feeds lag samples until the smoothed lag settles at |lag|.
+  void SettleLag(QuicHandshakeAdmissionController* controller,
+                 QuicTime::Delta lag) {
+    for (int i = 0; i < 100; ++i) {
+      controller->ShouldAdmitHandshake(Address("192.0.2.1"), now_ - lag, now_);
+    }
+  }
+
+  QuicHandshakeAdmissionController::Options options_;
+  QuicTime now_;
+};
+
+TEST_F(QuicHandshakeAdmissionControllerTest, AdmitsEverythingWithoutLag) {
+  QuicHandshakeAdmissionController controller(options_);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(Admit(&controller, "192.0.2.1", QuicTime::Delta::Zero()));
+  }
+  EXPECT_EQ(QuicHandshakeAdmissionController::NORMAL_LOAD,
+            controller.load_level());
+  EXPECT_EQ(100u, controller.stats().handshakes_admitted);
+  EXPECT_EQ(0u, controller.num_tracked_prefixes());
+}
+
+TEST_F(QuicHandshakeAdmissionControllerTest, LimitsPrefixesUnderElevatedLoad) {
+  QuicHandshakeAdmissionController controller(options_);
+  const QuicTime::Delta lag = QuicTime::Delta::FromMilliseconds(10);
+  SettleLag(&controller, lag);
+  ASSERT_EQ(QuicHandshakeAdmissionController::ELEVATED_LOAD,
+            controller.load_level());
+  const uint64_t refused = controller.stats().handshakes_refused_for_prefix;
+
+  // Each /24 gets a burst of two handshakes.
+  EXPECT_TRUE(Admit(&controller, "198.51.100.1", lag));
+  EXPECT_TRUE(Admit(&controller, "198.51.100.2", lag));
+  EXPECT_FALSE(Admit(&controller, "198.51.100.3", lag));
+  EXPECT_TRUE(Admit(&controller, "198.51.101.1", lag));
+  EXPECT_EQ(refused + 1, controller.stats().handshakes_refused_for_prefix);
+
+  // And ten more per second.
+  now_ = now_ + QuicTime::Delta::FromMilliseconds(100);
+  EXPECT_TRUE(Admit(&controller, "198.51.100.4", lag));
+  EXPECT_FALSE(Admit(&controller, "198.51.100.4", lag));
+}
+
+TEST_F(QuicHandshakeAdmissionControllerTest, GroupsIpv6ByPrefix) {
+  QuicHandshakeAdmissionController controller(options_);
+  const QuicTime::Delta lag = QuicTime::Delta::FromMilliseconds(10);
+  SettleLag(&controller, lag);
+
+  EXPECT_TRUE(Admit(&controller, "2001:db8:1:1::1", lag));
+  EXPECT_TRUE(Admit(&controller, "2001:db8:1:2::1", lag));
+  EXPECT_FALSE(Admit(&controller, "2001:db8:1:ffff::1", lag));
+  EXPECT_TRUE(Admit(&controller, "2001:db8:2::1", lag));
+  // IPv4-mapped addresses share the bucket of their IPv4 address.
+  EXPECT_TRUE(Admit(&controller, "::ffff:203.0.113.1", lag));
+  EXPECT_TRUE(Admit(&controller, "203.0.113.2", lag));
+  EXPECT_FALSE(Admit(&controller, "203.0.113.3", lag));
+}
+
+TEST_F(QuicHandshakeAdmissionControllerTest, RefusesEverythingWhenOverloaded) {
+  QuicHandshakeAdmissionController controller(options_);
+  const QuicTime::Delta lag = QuicTime::Delta::FromMilliseconds(100);
+  SettleLag(&controller, lag);
+  EXPECT_EQ(QuicHandshakeAdmissionController::OVERLOADED,
+            controller.load_level());
+  EXPECT_FALSE(Admit(&controller, "198.51.100.1", lag));
+
+  // Admits handshakes again once the lag recedes.
+  SettleLag(&controller, QuicTime::Delta::Zero());
+  EXPECT_EQ(QuicHandshakeAdmissionController::NORMAL_LOAD,
+            controller.load_level());
+  EXPECT_TRUE(Admit(&controller, "198.51.100.1", QuicTime::Delta::Zero()));
+}
+
+TEST_F(QuicHandshakeAdmissionControllerTest, RecoversAfterIdle) {
+  options_.lag_half_life = QuicTime::Delta::FromMilliseconds(200);
+  QuicHandshakeAdmissionController controller(options_);
+  const QuicTime::Delta lag = QuicTime::Delta::FromMilliseconds(100);
+  SettleLag(&controller, lag);
+  ASSERT_EQ(QuicHandshakeAdmissionController::OVERLOADED,
+            controller.load_level());
+
+  // No client hello samples the lag while the server is idle, yet the next one
+  // is admitted. 100ms of lag decays below 5ms in five half-lives.
+  now_ = now_ + QuicTime::Delta::FromSeconds(1);
+  EXPECT_TRUE(Admit(&controller, "198.51.100.1", QuicTime::Delta::Zero()));
+  EXPECT_EQ(QuicHandshakeAdmissionController::NORMAL_LOAD,
+            controller.load_level());
+}
+
+TEST_F(QuicHandshakeAdmissionControllerTest, DecaysLagOverShortGaps) {
+  QuicHandshakeAdmissionController controller(options_);
+  SettleLag(&controller, QuicTime::Delta::FromMilliseconds(100));
+  // A gap of one half-life halves the smoothed lag before the next sample.
+  now_ = now_ + options_.lag_half_life;
+  EXPECT_FALSE(Admit(&controller, "198.51.100.1",
+                     QuicTime::Delta::FromMilliseconds(100)));
+  EXPECT_NEAR(0.875 * 50 + 0.125 * 100,
+              controller.smoothed_lag().ToMicroseconds() / 1000.0, 0.01);
+}
+
+TEST_F(QuicHandshakeAdmissionControllerTest, ForgetsLeastRecentPrefixes) {
+  options_.max_tracked_prefixes = 2;
+  QuicHandshakeAdmissionController controller(options_);
+  const QuicTime::Delta lag = QuicTime::Delta::FromMilliseconds(10);
+  SettleLag(&controller, lag);
+  EXPECT_TRUE(Admit(&controller, "198.51.100.1", lag));
+  EXPECT_TRUE(Admit(&controller, "198.51.101.1", lag));
+  EXPECT_TRUE(Admit(&controller, "198.51.102.1", lag));
+  EXPECT_EQ(2u, controller.num_tracked_prefixes());
+}
+
+TEST_F(QuicHandshakeAdmissionControllerTest, BoundsSessionsPerEventLoop) {
+  options_.handshake_time_per_event_loop = QuicTime::Delta::FromMilliseconds(5);
+  QuicHandshakeAdmissionController controller(options_);
+  // Nothing is known about handshakes yet.
+  EXPECT_EQ(16u, controller.MaxSessionsPerEventLoop(16));
+
+  controller.OnHandshakeProcessed(QuicTime::Delta::FromMilliseconds(1));
+  EXPECT_EQ(5u, controller.MaxSessionsPerEventLoop(16));
+  EXPECT_EQ(3u, controller.MaxSessionsPerEventLoop(3));
+
+  // At least one session is created per event loop.
+  for (int i = 0; i < 100; ++i) {
+    controller.OnHandshakeProcessed(QuicTime::Delta::FromMilliseconds(20));
+  }
+  EXPECT_EQ(1u, controller.MaxSessionsPerEventLoop(16));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
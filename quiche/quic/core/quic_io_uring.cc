@@ -0,0 +1,292 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_io_uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+int IoUringSetup(uint32_t entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int fd, uint32_t to_submit, uint32_t min_complete,
+                 uint32_t flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(int fd, uint32_t opcode, void* arg, uint32_t nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// The queue heads and tails are shared with the kernel, which reads and
+// writes them concurrently.
+uint32_t LoadAcquire(const uint32_t* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+void StoreRelease(T* p, T value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+T* At(void* base, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+QuicIoUring::BufferRing::BufferRing(int ring_fd, uint16_t group_id,
+                                    uint16_t num_buffers, uint32_t buffer_size,
+                                    io_uring_buf_ring* entries)
+    : ring_fd_(ring_fd),
+      group_id_(group_id),
+      num_buffers_(num_buffers),
+      buffer_size_(buffer_size),
+      entries_(entries),
+      tail_(0),
+      buffers_(new char[static_cast<size_t>(num_buffers) * buffer_size]) {}
+
+QuicIoUring::BufferRing::~BufferRing() {
+  io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.bgid = group_id_;
+  IoUringRegister(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  munmap(entries_, num_buffers_ * sizeof(io_uring_buf));
+}
+
+void QuicIoUring::BufferRing::Recycle(uint16_t buffer_id) {
+  // Not &entries_->bufs[i]: compiled as C++, the flexible array in
+  // io_uring_buf_ring is preceded by an empty struct, which moves it off the
+  // start of the ring where the kernel expects it.
+  io_uring_buf* entry =
+      reinterpret_cast<io_uring_buf*>(entries_) + (tail_ & (num_buffers_ - 1));
+  entry->addr = reinterpret_cast<uint64_t>(buffer(buffer_id));
+  entry->len = buffer_size_;
+  entry->bid = buffer_id;
+  ++tail_;
+}
+
+void QuicIoUring::BufferRing::Commit() { StoreRelease(&entries_->tail, tail_); }
+
+// static
+std::unique_ptr<QuicIoUring> QuicIoUring::Create(uint32_t sq_entries,
+                                                 uint32_t cq_entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER;
+  if (cq_entries > 0) {
+    params.flags |= IORING_SETUP_CQSIZE;
+    params.cq_entries = cq_entries;
+  }
+  int fd = IoUringSetup(sq_entries, &params);
+  if (fd < 0 && errno == EINVAL) {
+    // Kernels older than 6.0 do not know all of the flags above.
+    params.flags &= IORING_SETUP_CQSIZE;
+    fd = IoUringSetup(sq_entries, &params);
+  }
+  if (fd < 0) {
+    QUIC_DLOG(INFO) << "io_uring_setup failed: " << strerror(errno);
+    return nullptr;
+  }
+  std::unique_ptr<QuicIoUring> ring(new QuicIoUring(fd, params));
+  if (!ring->MapRings(params)) {
+    QUIC_LOG(ERROR) << "Failed to map io_uring queues: " << strerror(errno);
+    return nullptr;
+  }
+  return ring;
+}
+
+QuicIoUring::QuicIoUring(int fd, const io_uring_params& params)
+    : fd_(fd), sq_entries_(params.sq_entries) {}
+
+QuicIoUring::~QuicIoUring() {
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  close(fd_);
+}
+
+bool QuicIoUring::MapRings(const io_uring_params& params) {
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  void* sq_ring = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return false;
+  }
+  sq_ring_ = sq_ring;
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    void* cq_ring = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = cq_ring;
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  sq_head_ = At<uint32_t>(sq_ring_, params.sq_off.head);
+  sq_tail_ = At<uint32_t>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = *At<uint32_t>(sq_ring_, params.sq_off.ring_mask);
+  // Submission queue entries are always used in order, so the indirection
+  // array maps every slot to itself.
+  uint32_t* sq_array = At<uint32_t>(sq_ring_, params.sq_off.array);
+  for (uint32_t i = 0; i < params.sq_entries; ++i) {
+    sq_array[i] = i;
+  }
+  sqe_head_ = sqe_tail_ = *sq_tail_;
+
+  cq_head_ = At<uint32_t>(cq_ring_, params.cq_off.head);
+  cq_tail_ = At<uint32_t>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *At<uint32_t>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = At<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+  return true;
+}
+
+bool QuicIoUring::IsOpSupported(uint8_t opcode) const {
+  constexpr size_t kNumOps = 256;
+  const size_t probe_size =
+      sizeof(io_uring_probe) + kNumOps * sizeof(io_uring_probe_op);
+  std::unique_ptr<char[]> buffer(new char[probe_size]);
+  memset(buffer.get(), 0, probe_size);
+  auto* probe = reinterpret_cast<io_uring_probe*>(buffer.get());
+  if (IoUringRegister(fd_, IORING_REGISTER_PROBE, probe, kNumOps) < 0) {
+    return false;
+  }
+  return opcode <= probe->last_op &&
+         (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+}
+
+io_uring_sqe* QuicIoUring::GetSqe() {
+  if (sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+    return nullptr;
+  }
+  io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+  ++sqe_tail_;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int QuicIoUring::Submit(uint32_t min_complete) {
+  const uint32_t to_submit = sqe_tail_ - sqe_head_;
+  StoreRelease(sq_tail_, sqe_tail_);
+  sqe_head_ = sqe_tail_;
+  if (to_submit == 0 && min_complete == 0) {
+    return 0;
+  }
+  const uint32_t flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  int rc;
+  do {
+    rc = IoUringEnter(fd_, to_submit, min_complete, flags);
+  } while (rc < 0 && errno == EINTR);
+  const int error = rc < 0 ? errno : 0;
+  // Without SQPOLL the kernel only consumes entries inside io_uring_enter(),
+  // so the ones it did not get to, if it failed or stopped at an invalid entry,
+  // can be taken back.
+  const uint32_t head = LoadAcquire(sq_head_);
+  if (head != sqe_tail_) {
+    sqe_head_ = sqe_tail_ = head;
+    StoreRelease(sq_tail_, sqe_tail_);
+  }
+  return rc < 0 ? -error : rc;
+}
+
+size_t QuicIoUring::ReapCompletions(
+    absl::FunctionRef<void(const io_uring_cqe& cqe)> visitor,
+    size_t max_completions) {
+  uint32_t head = *cq_head_;
+  const uint32_t tail = LoadAcquire(cq_tail_);
+  size_t num_completions = 0;
+  while (head != tail && num_completions < max_completions) {
+    visitor(cqes_[head & cq_mask_]);
+    ++head;
+    ++num_completions;
+  }
+  StoreRelease(cq_head_, head);
+  return num_completions;
+}
+
+const io_uring_cqe* QuicIoUring::PeekCompletion() const {
+  const uint32_t head = *cq_head_;
+  if (head == LoadAcquire(cq_tail_)) {
+    return nullptr;
+  }
+  return &cqes_[head & cq_mask_];
+}
+
+std::unique_ptr<QuicIoUring::BufferRing> QuicIoUring::RegisterBufferRing(
+    uint16_t group_id, uint16_t num_buffers, uint32_t buffer_size) {
+  if (num_buffers == 0 || (num_buffers & (num_buffers - 1)) != 0) {
+    QUIC_BUG(quic_io_uring_buffer_ring_size)
+        << "Buffer ring size must be a power of two: " << num_buffers;
+    return nullptr;
+  }
+  void* entries = mmap(nullptr, num_buffers * sizeof(io_uring_buf),
+                       PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE,
+                       -1, 0);
+  if (entries == MAP_FAILED) {
+    return nullptr;
+  }
+  io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(entries);
+  reg.ring_entries = num_buffers;
+  reg.bgid = group_id;
+  if (IoUringRegister(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    if (errno == EINVAL) {
+      QUIC_DLOG(INFO) << "Kernel does not support io_uring buffer rings";
+    } else {
+      QUIC_LOG(ERROR) << "Failed to register io_uring buffer ring: "
+                      << strerror(errno);
+    }
+    munmap(entries, num_buffers * sizeof(io_uring_buf));
+    return nullptr;
+  }
+  std::unique_ptr<BufferRing> ring(
+      new BufferRing(fd_, group_id, num_buffers, buffer_size,
+                     static_cast<io_uring_buf_ring*>(entries)));
+  for (uint16_t i = 0; i < num_buffers; ++i) {
+    ring->Recycle(i);
+  }
+  ring->Commit();
+  return ring;
+}
+
+}  // namespace quic
@@ -0,0 +1,147 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A minimal wrapper around a Linux io_uring instance, talking to the kernel
+// through the raw system calls.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_IO_URING_H_
+#define QUICHE_QUIC_CORE_QUIC_IO_URING_H_
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/functional/function_ref.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Owns an io_uring submission and completion queue pair. Not thread-safe: all
+// methods must be called from the thread which created the ring.
+class QUIC_EXPORT_PRIVATE QuicIoUring {
+ public:
+  // A ring of equally sized buffers the kernel picks from when completing
+  // requests flagged with IOSQE_BUFFER_SELECT and this ring's group ID.
+  class QUIC_EXPORT_PRIVATE BufferRing {
+   public:
+    BufferRing(const BufferRing&) = delete;
+    BufferRing& operator=(const BufferRing&) = delete;
+    ~BufferRing();
+
+    uint16_t group_id() const { return group_id_; }
+    uint16_t num_buffers() const { return num_buffers_; }
+    uint32_t buffer_size() const { return buffer_size_; }
+
+    char* buffer(uint16_t buffer_id) {
+      return buffers_.get() + static_cast<size_t>(buffer_id) * buffer_size_;
+    }
+
+    // Hands |buffer_id| back to the kernel once Commit() is called.
+    void Recycle(uint16_t buffer_id);
+    // Makes all recycled buffers available to the kernel.
+    void Commit();
+
+   private:
+    friend class QuicIoUring;
+
+    BufferRing(int ring_fd, uint16_t group_id, uint16_t num_buffers,
+               uint32_t buffer_size, io_uring_buf_ring* entries);
+
+    const int ring_fd_;
+    const uint16_t group_id_;
+    const uint16_t num_buffers_;
+    const uint32_t buffer_size_;
+    // Shared with the kernel, |num_buffers_| entries.
+    io_uring_buf_ring* entries_;
+    // Local copy of the tail, published to the kernel by Commit().
+    uint16_t tail_;
+    std::unique_ptr<char[]> buffers_;
+  };
+
+  // Returns nullptr if io_uring is not available, e.g. because the kernel is
+  // too old or io_uring is disabled by sysctl or seccomp. The completion queue
+  // holds |cq_entries| completions, or twice |sq_entries| if 0.
+  static std::unique_ptr<QuicIoUring> Create(uint32_t sq_entries,
+                                             uint32_t cq_entries = 0);
+
+  QuicIoUring(const QuicIoUring&) = delete;
+  QuicIoUring& operator=(const QuicIoUring&) = delete;
+  ~QuicIoUring();
+
+  // The ring's file descriptor. It polls readable while completions are
+  // available, which allows driving the ring from an epoll loop.
+  int fd() const { return fd_; }
+
+  uint32_t sq_entries() const { return sq_entries_; }
+
+  // Returns true if the kernel supports |opcode|.
+  bool IsOpSupported(uint8_t opcode) const;
+
+  // Returns a zeroed submission queue entry, or nullptr if the submission
+  // queue is full. The entry is handed to the kernel by the next Submit().
+  io_uring_sqe* GetSqe();
+
+  // Submits all entries returned by GetSqe() since the last call, then waits
+  // until at least |min_complete| completions are available. Returns the
+  // number of entries submitted, or a negative errno. Entries which were not
+  // submitted are discarded.
+  int Submit(uint32_t min_complete = 0);
+
+  // Calls |visitor| for up to |max_completions| available completions, oldest
+  // first, and removes them from the completion queue. Returns the number of
+  // completions visited.
+  size_t ReapCompletions(
+      absl::FunctionRef<void(const io_uring_cqe& cqe)> visitor,
+      size_t max_completions = SIZE_MAX);
+
+  // Returns the oldest available completion without removing it from the
+  // completion queue, or nullptr if there is none.
+  const io_uring_cqe* PeekCompletion() const;
+
+  // Registers a ring of |num_buffers| buffers of |buffer_size| bytes under
+  // |group_id|, all of them initially available to the kernel. |num_buffers|
+  // must be a power of two. Returns nullptr on failure, including when the
+  // kernel does not support provided buffer rings (Linux 5.19), which it
+  // reports by failing the registration with EINVAL.
+  std::unique_ptr<BufferRing> RegisterBufferRing(uint16_t group_id,
+                                                 uint16_t num_buffers,
+                                                 uint32_t buffer_size);
+
+ private:
+  QuicIoUring(int fd, const io_uring_params& params);
+
+  // Maps the rings shared with the kernel. Returns false on failure.
+  bool MapRings(const io_uring_params& params);
+
+  int fd_;
+  uint32_t sq_entries_;
+
+  // Submission queue, shared with the kernel.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  // Entries handed out by GetSqe() up to |sqe_tail_|, of which the ones from
+  // |sqe_head_| have not been submitted yet.
+  uint32_t sqe_head_ = 0;
+  uint32_t sqe_tail_ = 0;
+
+  // Completion queue, shared with the kernel. May share its mapping with the
+  // submission queue.
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_IO_URING_H_
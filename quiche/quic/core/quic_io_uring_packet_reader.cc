@@ -0,0 +1,211 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_io_uring_packet_reader.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_flag_utils.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+constexpr uint16_t kBufferGroupId = 0;
+// Number of buffers the kernel can fill before the reader hands them back.
+constexpr uint16_t kNumReadBuffers = 256;
+constexpr uint16_t kNumGroReadBuffers = 64;
+// Upper bound of completions handled per ReadAndDispatchPackets() call, so
+// that a busy socket does not starve the rest of the event loop.
+constexpr size_t kMaxPacketsPerRead = 64;
+constexpr uint64_t kReceiveUserData = 1;
+
+const BitMask64 kPacketInfoInterested(
+    QuicUdpPacketInfoBit::DROPPED_PACKETS, QuicUdpPacketInfoBit::PEER_ADDRESS,
+    QuicUdpPacketInfoBit::V4_SELF_IP, QuicUdpPacketInfoBit::V6_SELF_IP,
+    QuicUdpPacketInfoBit::RECV_TIMESTAMP, QuicUdpPacketInfoBit::TTL,
+    QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER,
+    QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE);
+
+}  // namespace
+
+// static
+std::unique_ptr<QuicIoUringPacketReader> QuicIoUringPacketReader::Create(
+    QuicUdpSocketFd fd, bool udp_gro_enabled) {
+  const uint16_t num_buffers =
+      udp_gro_enabled ? kNumGroReadBuffers : kNumReadBuffers;
+  // Every buffer can complete once before the reader runs, plus the final
+  // completion of the recvmsg when it runs out of buffers.
+  std::unique_ptr<QuicIoUring> ring =
+      QuicIoUring::Create(/*sq_entries=*/4, /*cq_entries=*/2 * num_buffers);
+  if (ring == nullptr) {
+    return nullptr;
+  }
+  if (!ring->IsOpSupported(IORING_OP_RECVMSG)) {
+    QUIC_DLOG(INFO) << "Kernel does not support io_uring recvmsg";
+    return nullptr;
+  }
+  const size_t payload_size =
+      udp_gro_enabled ? kMaxGroPacketBufferSize : kMaxIncomingPacketSize;
+  std::unique_ptr<QuicIoUring::BufferRing> buffers = ring->RegisterBufferRing(
+      kBufferGroupId, num_buffers,
+      sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_storage) +
+          kDefaultUdpPacketControlBufferSize + payload_size);
+  if (buffers == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<QuicIoUringPacketReader> reader(new QuicIoUringPacketReader(
+      fd, std::move(ring), std::move(buffers)));
+  if (!reader->ArmReceive()) {
+    return nullptr;
+  }
+  // Multishot recvmsg cannot be probed for, but kernels which predate it
+  // reject its flag with EINVAL while the request is submitted, so the failure
+  // is already in the completion queue.
+  const io_uring_cqe* cqe = reader->ring_->PeekCompletion();
+  if (cqe != nullptr && cqe->user_data == kReceiveUserData &&
+      cqe->res == -EINVAL) {
+    QUIC_DLOG(INFO) << "Kernel does not support multishot io_uring recvmsg";
+    return nullptr;
+  }
+  return reader;
+}
+
+QuicIoUringPacketReader::QuicIoUringPacketReader(
+    QuicUdpSocketFd fd, std::unique_ptr<QuicIoUring> ring,
+    std::unique_ptr<QuicIoUring::BufferRing> buffers)
+    : fd_(fd), ring_(std::move(ring)), buffers_(std::move(buffers)) {
+  batch_buffer_ids_.reserve(kMaxPacketsPerRead);
+  memset(&msg_, 0, sizeof(msg_));
+  msg_.msg_namelen = sizeof(sockaddr_storage);
+  msg_.msg_controllen = kDefaultUdpPacketControlBufferSize;
+}
+
+QuicIoUringPacketReader::~QuicIoUringPacketReader() = default;
+
+bool QuicIoUringPacketReader::ArmReceive() {
+  io_uring_sqe* sqe = ring_->GetSqe();
+  if (sqe == nullptr) {
+    QUIC_BUG(quic_io_uring_reader_queue_full)
+        << "No room to queue io_uring recvmsg";
+    return false;
+  }
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&msg_);
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroupId;
+  sqe->user_data = kReceiveUserData;
+  const int rc = ring_->Submit();
+  if (rc < 0) {
+    QUIC_LOG_FIRST_N(ERROR, 100)
+        << "Failed to submit io_uring recvmsg: " << strerror(-rc);
+    return false;
+  }
+  return true;
+}
+
+bool QuicIoUringPacketReader::ReadAndDispatchPackets(
+    int port, const QuicClock& clock, ProcessPacketInterface* processor,
+    QuicPacketCount* packets_dropped) {
+  // Use clock.Now() as the packet receipt time, the time between packet
+  // arriving at the host and now is considered part of the network delay.
+  QuicTime now = clock.Now();
+
+  bool receive_terminated = false;
+  const size_t num_completions = ring_->ReapCompletions(
+      [&](const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+          // The kernel stops a multishot recvmsg on errors, including running
+          // out of buffers, and the reader has to queue a new one.
+          receive_terminated = true;
+        }
+        if (cqe.res < 0) {
+          if (cqe.res == -ENOBUFS) {
+            QUIC_CODE_COUNT(quic_io_uring_reader_out_of_buffers);
+          } else {
+            QUIC_LOG_FIRST_N(ERROR, 100)
+                << "Error reading packets: " << strerror(-cqe.res);
+          }
+          return;
+        }
+        if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+          QUIC_BUG(quic_io_uring_reader_no_buffer)
+              << "io_uring recvmsg completed without a buffer";
+          return;
+        }
+        const uint16_t buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+        AddToBatch(buffers_->buffer(buffer_id), cqe.res, port, now, processor,
+                   packets_dropped);
+        batch_buffer_ids_.push_back(buffer_id);
+      },
+      kMaxPacketsPerRead);
+  batch_.Dispatch(processor);
+  for (uint16_t buffer_id : batch_buffer_ids_) {
+    buffers_->Recycle(buffer_id);
+  }
+  batch_buffer_ids_.clear();
+  buffers_->Commit();
+
+  if (receive_terminated && !ArmReceive()) {
+    return false;
+  }
+  return num_completions == kMaxPacketsPerRead;
+}
+
+void QuicIoUringPacketReader::AddToBatch(char* buffer, size_t length, int port,
+                                         QuicTime now,
+                                         ProcessPacketInterface* processor,
+                                         QuicPacketCount* packets_dropped) {
+  // |buffer| holds an io_uring_recvmsg_out followed by space for the name and
+  // control data as sized in |msg_|, then the payload.
+  const size_t header_length =
+      sizeof(io_uring_recvmsg_out) + msg_.msg_namelen + msg_.msg_controllen;
+  if (length < header_length) {
+    QUIC_BUG(quic_io_uring_reader_short_buffer)
+        << "io_uring recvmsg result too short: " << length;
+    return;
+  }
+  const auto* out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+  char* name = buffer + sizeof(io_uring_recvmsg_out);
+  char* control = name + msg_.msg_namelen;
+  char* payload = control + msg_.msg_controllen;
+
+  if (ABSL_PREDICT_FALSE(out->flags & MSG_CTRUNC)) {
+    QUIC_BUG(quic_io_uring_reader_control_truncated)
+        << "Control buffer too small. size:" << msg_.msg_controllen;
+    return;
+  }
+  if (ABSL_PREDICT_FALSE(out->flags & MSG_TRUNC)) {
+    QUIC_LOG_FIRST_N(WARNING, 100)
+        << "Received truncated QUIC packet: buffer size:"
+        << length - header_length << " packet size:" << out->payloadlen;
+    return;
+  }
+
+  QuicUdpPacketInfo packet_info;
+  sockaddr_storage peer_address;
+  memset(&peer_address, 0, sizeof(peer_address));
+  memcpy(&peer_address, name,
+         std::min<size_t>(out->namelen, sizeof(peer_address)));
+  packet_info.SetPeerAddress(QuicSocketAddress(peer_address));
+  socket_api_.ParseControlMessages(control, out->controllen,
+                                   kPacketInfoInterested, &packet_info);
+  if (packets_dropped != nullptr &&
+      packet_info.HasValue(QuicUdpPacketInfoBit::DROPPED_PACKETS)) {
+    *packets_dropped = packet_info.dropped_packets();
+  }
+
+  batch_.Add(packet_info, payload, out->payloadlen, port, now, processor);
+}
+
+}  // namespace quic
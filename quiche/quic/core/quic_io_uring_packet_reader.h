@@ -0,0 +1,86 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_IO_URING_PACKET_READER_H_
+#define QUICHE_QUIC_CORE_QUIC_IO_URING_PACKET_READER_H_
+
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/core/quic_clock.h"
+#include "quiche/quic/core/quic_io_uring.h"
+#include "quiche/quic/core/quic_packet_reader.h"
+#include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_process_packet_interface.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Reads packets from a UDP socket with a single multishot io_uring recvmsg into
+// a ring of provided buffers. Once armed, the kernel keeps receiving packets
+// without any system call from the reader; they are picked up from the
+// completion queue, which polls readable through ring_fd().
+//
+// Unlike QuicPacketReader, which is told which socket to read on each call,
+// an instance is bound to one socket.
+class QUIC_EXPORT_PRIVATE QuicIoUringPacketReader {
+ public:
+  // Returns nullptr if the kernel does not support io_uring, provided buffer
+  // rings or multishot recvmsg (Linux 6.0), in which case |fd| should be read
+  // with QuicPacketReader instead. |udp_gro_enabled| must be true if UDP GRO
+  // is enabled on |fd|.
+  static std::unique_ptr<QuicIoUringPacketReader> Create(QuicUdpSocketFd fd,
+                                                         bool udp_gro_enabled);
+
+  QuicIoUringPacketReader(const QuicIoUringPacketReader&) = delete;
+  QuicIoUringPacketReader& operator=(const QuicIoUringPacketReader&) = delete;
+  ~QuicIoUringPacketReader();
+
+  // Readable while received packets are waiting to be dispatched. Register it
+  // with the event loop instead of the socket for EPOLLIN.
+  int ring_fd() const { return ring_->fd(); }
+
+  // Passes packets received so far to |processor| in batches, with |port| as
+  // self port. Returns true if there may be more packets waiting. Populates
+  // |packets_dropped| if it is non-null and the socket is configured to track
+  // dropped packets.
+  bool ReadAndDispatchPackets(int port, const QuicClock& clock,
+                              ProcessPacketInterface* processor,
+                              QuicPacketCount* packets_dropped);
+
+ private:
+  QuicIoUringPacketReader(QuicUdpSocketFd fd,
+                          std::unique_ptr<QuicIoUring> ring,
+                          std::unique_ptr<QuicIoUring::BufferRing> buffers);
+
+  // Queues a multishot recvmsg on |fd_| and submits it. Returns false on
+  // failure.
+  bool ArmReceive();
+
+  // Adds the packet in |buffer|, as laid out by multishot recvmsg, to
+  // |batch_|.
+  void AddToBatch(char* buffer, size_t length, int port, QuicTime now,
+                  ProcessPacketInterface* processor,
+                  QuicPacketCount* packets_dropped);
+
+  const QuicUdpSocketFd fd_;
+  QuicUdpSocketApi socket_api_;
+  // Template for the layout of each received buffer: name and control space.
+  msghdr msg_;
+  // |buffers_| is registered with |ring_| and must be destroyed first.
+  std::unique_ptr<QuicIoUring> ring_;
+  std::unique_ptr<QuicIoUring::BufferRing> buffers_;
+  QuicPacketReader::DatagramBatch batch_;
+  // Buffers holding packets in |batch_|, handed back to the kernel once the
+  // batch is dispatched.
+  std::vector<uint16_t> batch_buffer_ids_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_IO_URING_PACKET_READER_H_
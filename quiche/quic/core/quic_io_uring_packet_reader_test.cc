@@ -0,0 +1,153 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_io_uring_packet_reader.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class RecordingPacketProcessor : public ProcessPacketInterface {
+ public:
+  void ProcessPackets(absl::Span<const ReceivedUdpPacket> packets) override {
+    ++num_batches_;
+    ProcessPacketInterface::ProcessPackets(packets);
+  }
+
+  void ProcessPacket(const QuicSocketAddress& /*self_address*/,
+                     const QuicSocketAddress& peer_address,
+                     const QuicReceivedPacket& packet) override {
+    packets_.push_back(std::string(packet.data(), packet.length()));
+    peer_addresses_.push_back(peer_address);
+  }
+
+  size_t num_batches() const { return num_batches_; }
+  const std::vector<std::string>& packets() const { return packets_; }
+  const std::vector<QuicSocketAddress>& peer_addresses() const {
+    return peer_addresses_;
+  }
+
+ private:
+  std::vector<std::string> packets_;
+  std::vector<QuicSocketAddress> peer_addresses_;
+  size_t num_batches_ = 0;
+};
+
+class QuicIoUringPacketReaderTest : public QuicTest {
+ protected:
+  void SetUp() override {
+    QuicIpAddress localhost = QuicIpAddress::Loopback4();
+    server_fd_ = socket_api_.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, server_fd_);
+    ASSERT_TRUE(socket_api_.Bind(server_fd_, QuicSocketAddress(localhost, 0)));
+    ASSERT_EQ(0, server_address_.FromSocket(server_fd_));
+
+    client_fd_ = socket_api_.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, client_fd_);
+    ASSERT_TRUE(socket_api_.Bind(client_fd_, QuicSocketAddress(localhost, 0)));
+    ASSERT_EQ(0, client_address_.FromSocket(client_fd_));
+  }
+
+  void TearDown() override {
+    reader_.reset();
+    socket_api_.Destroy(server_fd_);
+    socket_api_.Destroy(client_fd_);
+  }
+
+  void SendToServer(const std::string& payload) {
+    QuicUdpPacketInfo packet_info;
+    packet_info.SetPeerAddress(server_address_);
+    ASSERT_EQ(WRITE_STATUS_OK,
+              socket_api_
+                  .WritePacket(client_fd_, payload.data(), payload.size(),
+                               packet_info)
+                  .status);
+  }
+
+  // Reads until |num_packets| packets were dispatched or the reader has
+  // nothing to read for a second.
+  void ReadPackets(size_t num_packets) {
+    while (processor_.packets().size() < num_packets) {
+      pollfd pfd = {reader_->ring_fd(), POLLIN, 0};
+      if (poll(&pfd, 1, /*timeout=*/1000) <= 0) {
+        return;
+      }
+      reader_->ReadAndDispatchPackets(server_address_.port(), clock_,
+                                      &processor_, nullptr);
+    }
+  }
+
+  QuicUdpSocketApi socket_api_;
+  QuicUdpSocketFd server_fd_ = kQuicInvalidSocketFd;
+  QuicUdpSocketFd client_fd_ = kQuicInvalidSocketFd;
+  QuicSocketAddress server_address_;
+  QuicSocketAddress client_address_;
+  MockClock clock_;
+  RecordingPacketProcessor processor_;
+  std::unique_ptr<QuicIoUringPacketReader> reader_;
+};
+
+TEST_F(QuicIoUringPacketReaderTest, ReadPackets) {
+  reader_ = QuicIoUringPacketReader::Create(server_fd_,
+                                            /*udp_gro_enabled=*/false);
+  if (reader_ == nullptr) {
+    // io_uring is not supported by the kernel running this test.
+    return;
+  }
+
+  const std::vector<std::string> payloads = {
+      std::string(1000, 'a'), std::string(1, 'b'), std::string(1350, 'c')};
+  for (const std::string& payload : payloads) {
+    SendToServer(payload);
+  }
+  ReadPackets(payloads.size());
+
+  EXPECT_EQ(payloads, processor_.packets());
+  for (const QuicSocketAddress& peer_address : processor_.peer_addresses()) {
+    EXPECT_EQ(client_address_, peer_address);
+  }
+}
+
+TEST_F(QuicIoUringPacketReaderTest, RearmAfterRunningOutOfBuffers) {
+  reader_ = QuicIoUringPacketReader::Create(server_fd_,
+                                            /*udp_gro_enabled=*/false);
+  if (reader_ == nullptr) {
+    return;
+  }
+
+  // More packets than the reader has buffers, so that the kernel stops
+  // receiving until the reader hands buffers back and receives again.
+  constexpr int kNumPackets = 300;
+  std::vector<std::string> payloads;
+  for (int i = 0; i < kNumPackets; ++i) {
+    payloads.push_back(absl::StrCat("packet ", i));
+    SendToServer(payloads.back());
+  }
+  ReadPackets(payloads.size());
+
+  EXPECT_EQ(payloads, processor_.packets());
+  // Packets are dispatched in batches, not one by one.
+  EXPECT_LT(processor_.num_batches(), payloads.size());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -4,6 +4,7 @@
 
 #include "quiche/quic/core/quic_linux_socket_utils.h"
 
+#include <linux/errqueue.h>
 #include <linux/net_tstamp.h>
 #include <netinet/in.h>
 
@@ -194,6 +195,60 @@ bool QuicLinuxSocketUtils::EnableReleaseTime(int fd, clockid_t clockid) {
   return true;
 }
 
+// static
+bool QuicLinuxSocketUtils::EnableZerocopy(int fd) {
+  int enable = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) != 0) {
+    QUIC_LOG_EVERY_N_SEC(INFO, 10)
+        << "setsockopt(SOL_SOCKET,SO_ZEROCOPY) failed: " << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+// static
+bool QuicLinuxSocketUtils::ReadZerocopyCompletion(int fd, uint32_t* first_id,
+                                                  uint32_t* last_id,
+                                                  bool* copied) {
+  char cbuf[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_storage))];
+  while (true) {
+    msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_control = cbuf;
+    hdr.msg_controllen = sizeof(cbuf);
+    int rc;
+    do {
+      rc = GetGlobalSyscallWrapper()->Recvmsg(fd, &hdr,
+                                              MSG_ERRQUEUE | MSG_DONTWAIT);
+    } while (rc < 0 && errno == EINTR);
+    if (rc < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        QUIC_LOG_FIRST_N(ERROR, 100)
+            << "Failed to read error queue: " << strerror(errno);
+      }
+      return false;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+      if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+            (cmsg->cmsg_level == SOL_IPV6 &&
+             cmsg->cmsg_type == IPV6_RECVERR))) {
+        continue;
+      }
+      const auto* err =
+          reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+      if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      *first_id = err->ee_info;
+      *last_id = err->ee_data;
+      *copied = (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+      return true;
+    }
+    // Not a zerocopy completion, e.g. an ICMP error if IP_RECVERR is set.
+  }
+}
+
 // static
 bool QuicLinuxSocketUtils::GetTtlFromMsghdr(struct msghdr* hdr, int* ttl) {
   if (hdr->msg_controllen > 0) {
@@ -260,10 +315,11 @@ size_t QuicLinuxSocketUtils::SetIpInfoInCmsg(const QuicIpAddress& self_address,
 }
 
 // static
-WriteResult QuicLinuxSocketUtils::WritePacket(int fd, const QuicMsgHdr& hdr) {
+WriteResult QuicLinuxSocketUtils::WritePacket(int fd, const QuicMsgHdr& hdr,
+                                              int flags) {
   int rc;
   do {
-    rc = GetGlobalSyscallWrapper()->Sendmsg(fd, hdr.hdr(), 0);
+    rc = GetGlobalSyscallWrapper()->Sendmsg(fd, hdr.hdr(), flags);
   } while (rc < 0 && errno == EINTR);
   if (rc >= 0) {
     return WriteResult(WRITE_STATUS_OK, rc);
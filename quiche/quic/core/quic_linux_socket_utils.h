@@ -41,6 +41,14 @@
 #define SO_TXTIME 61
 #endif
 
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
 namespace quic {
 
 const int kCmsgSpaceForIpv4 = CMSG_SPACE(sizeof(in_pktinfo));
@@ -257,6 +265,17 @@ class QUIC_EXPORT_PRIVATE QuicLinuxSocketUtils {
   // Enable release time on |fd|.
   static bool EnableReleaseTime(int fd, clockid_t clockid);
 
+  // Enable MSG_ZEROCOPY sends on |fd|.
+  static bool EnableZerocopy(int fd);
+
+  // Reads one MSG_ZEROCOPY completion from the error queue of |fd|: the kernel
+  // no longer uses the buffers of the zerocopy sends numbered |*first_id|
+  // through |*last_id|. |*copied| is set to true if the kernel copied the data
+  // anyway, e.g. because the device does not support scatter-gather. Returns
+  // false if no completion is pending.
+  static bool ReadZerocopyCompletion(int fd, uint32_t* first_id,
+                                     uint32_t* last_id, bool* copied);
+
   // If the msghdr contains an IP_TTL entry, this will set ttl to the correct
   // value and return true. Otherwise it will return false.
   static bool GetTtlFromMsghdr(struct msghdr* hdr, int* ttl);
@@ -273,7 +292,8 @@ class QUIC_EXPORT_PRIVATE QuicLinuxSocketUtils {
                                 cmsghdr* cmsg);
 
   // Writes the packet in |hdr| to the socket, using ::sendmsg.
-  static WriteResult WritePacket(int fd, const QuicMsgHdr& hdr);
+  static WriteResult WritePacket(int fd, const QuicMsgHdr& hdr,
+                                 int flags = 0);
 
   // Writes the packets in |mhdr| to the socket, using ::sendmmsg if available.
   static WriteResult WriteMultiplePackets(int fd, QuicMMsgHdr* mhdr,
@@ -465,8 +465,9 @@ void QuicPacketCreator::FlushCurrentPacket() {
   }
 
   QUICHE_DCHECK_EQ(nullptr, packet_.encrypted_buffer) << ENDPOINT;
+  const bool allow_deferred_sealing = external_buffer.buffer != stack_buffer;
   if (!SerializePacket(std::move(external_buffer), kMaxOutgoingPacketSize,
-                       /*allow_padding=*/true)) {
+                       /*allow_padding=*/true, allow_deferred_sealing)) {
     return;
   }
   OnSerializedPacket();
@@ -549,7 +550,8 @@ size_t QuicPacketCreator::ReserializeInitialPacketInCoalescedPacket(
   }
 
   if (!SerializePacket(QuicOwnedPacketBuffer(buffer, nullptr), buffer_len,
-                       /*allow_padding=*/false)) {
+                       /*allow_padding=*/false,
+                       /*allow_deferred_sealing=*/false)) {
     return 0;
   }
   const size_t encrypted_length = packet_.encrypted_length;
@@ -657,10 +659,10 @@ void QuicPacketCreator::CreateAndSerializeStreamFrame(
   QUICHE_DCHECK(packet_.encryption_level == ENCRYPTION_FORWARD_SECURE ||
                 packet_.encryption_level == ENCRYPTION_ZERO_RTT)
       << ENDPOINT << packet_.encryption_level;
-  size_t encrypted_length = framer_->EncryptInPlace(
-      packet_.encryption_level, packet_.packet_number,
+  size_t encrypted_length = EncryptPacketInPlace(
       GetStartOfEncryptedData(framer_->transport_version(), header),
-      writer.length(), kMaxOutgoingPacketSize, encrypted_buffer);
+      writer.length(), kMaxOutgoingPacketSize, encrypted_buffer,
+      /*allow_deferred_sealing=*/encrypted_buffer != stack_buffer);
   if (encrypted_length == 0) {
     QUIC_BUG(quic_bug_10752_13)
         << ENDPOINT << "Failed to encrypt packet number "
@@ -776,7 +778,8 @@ QuicPacketCreator::MaybeBuildDataPacketWithChaosProtection(
 
 bool QuicPacketCreator::SerializePacket(QuicOwnedPacketBuffer encrypted_buffer,
                                         size_t encrypted_buffer_len,
-                                        bool allow_padding) {
+                                        bool allow_padding,
+                                        bool allow_deferred_sealing) {
   if (packet_.encrypted_buffer != nullptr) {
     const std::string error_details =
         "Packet's encrypted buffer is not empty before serialization";
@@ -865,10 +868,9 @@ bool QuicPacketCreator::SerializePacket(QuicOwnedPacketBuffer encrypted_buffer,
   if (!possibly_truncated_by_length) {
     QUICHE_DCHECK_EQ(packet_size_, length) << ENDPOINT;
   }
-  const size_t encrypted_length = framer_->EncryptInPlace(
-      packet_.encryption_level, packet_.packet_number,
+  const size_t encrypted_length = EncryptPacketInPlace(
       GetStartOfEncryptedData(framer_->transport_version(), header), length,
-      encrypted_buffer_len, encrypted_buffer.buffer);
+      encrypted_buffer_len, encrypted_buffer.buffer, allow_deferred_sealing);
   if (encrypted_length == 0) {
     QUIC_BUG(quic_bug_10752_17)
         << ENDPOINT << "Failed to encrypt packet number "
@@ -885,6 +887,20 @@ bool QuicPacketCreator::SerializePacket(QuicOwnedPacketBuffer encrypted_buffer,
   return true;
 }
 
+size_t QuicPacketCreator::EncryptPacketInPlace(size_t ad_len, size_t total_len,
+                                               size_t buffer_len, char* buffer,
+                                               bool allow_deferred_sealing) {
+  if (defer_sealing_ && allow_deferred_sealing &&
+      packet_.fate == SEND_TO_WRITER) {
+    return framer_->EncryptInPlaceDeferred(packet_.encryption_level,
+                                           packet_.packet_number, ad_len,
+                                           total_len, buffer_len, buffer);
+  }
+  return framer_->EncryptInPlace(packet_.encryption_level,
+                                 packet_.packet_number, ad_len, total_len,
+                                 buffer_len, buffer);
+}
+
 std::unique_ptr<SerializedPacket>
 QuicPacketCreator::SerializeConnectivityProbingPacket() {
   QUIC_BUG_IF(quic_bug_12398_11,
@@ -309,6 +309,11 @@ class QUIC_EXPORT_PRIVATE QuicPacketCreator {
     chaos_protection_enabled_ = chaos_protection_enabled;
   }
 
+  // Sets whether 1-RTT packets serialized into a buffer from the delegate's
+  // GetPacketBuffer() are sealed by QuicFramer::SealPendingPackets() rather
+  // than as they are serialized. See QuicFramer::EncryptInPlaceDeferred().
+  void set_defer_sealing(bool defer_sealing) { defer_sealing_ = defer_sealing; }
+
   // packet number of the last created packet, or 0 if no packets have been
   // created.
   QuicPacketNumber packet_number() const { return packet_.packet_number; }
@@ -530,9 +535,18 @@ class QUIC_EXPORT_PRIVATE QuicPacketCreator {
   //
   // Padding may be added if |allow_padding|. Currently, the only case where it
   // is disallowed is reserializing a coalesced initial packet.
+  //
+  // Sealing may be deferred if |allow_deferred_sealing|, which requires
+  // |encrypted_buffer| to come from the delegate's GetPacketBuffer().
   ABSL_MUST_USE_RESULT bool SerializePacket(
       QuicOwnedPacketBuffer encrypted_buffer, size_t encrypted_buffer_len,
-      bool allow_padding);
+      bool allow_padding, bool allow_deferred_sealing);
+
+  // Encrypts the packet serialized in |buffer|, deferring its sealing if
+  // |allow_deferred_sealing| and packet_ is sent to the writer.
+  size_t EncryptPacketInPlace(size_t ad_len, size_t total_len,
+                              size_t buffer_len, char* buffer,
+                              bool allow_deferred_sealing);
 
   // Called after a new SerialiedPacket is created to call the delegate's
   // OnSerializedPacket and reset state.
@@ -688,6 +702,10 @@ class QUIC_EXPORT_PRIVATE QuicPacketCreator {
 
   // Whether to attempt protecting initial packets with chaos.
   bool chaos_protection_enabled_;
+
+  // Whether packets serialized into the delegate's packet buffer may be sealed
+  // later. See set_defer_sealing().
+  bool defer_sealing_ = false;
 };
 
 }  // namespace quic
@@ -0,0 +1,131 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures QuicPacketCreator::ConsumeData packetizing stream data into full
+// packets, for writes which go through the regular path and writes large
+// enough to take the fast path.
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/crypto/null_encrypter.h"
+#include "quiche/quic/core/quic_data_writer.h"
+#include "quiche/quic/core/quic_framer.h"
+#include "quiche/quic/core/quic_packet_creator.h"
+#include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_stream_frame_data_producer.h"
+#include "quiche/quic/core/quic_utils.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace {
+
+// Sends every packet and serializes into a single reused buffer, as a
+// connection writing to an unblocked socket does.
+class CountingDelegate : public QuicPacketCreator::DelegateInterface {
+ public:
+  QuicPacketBuffer GetPacketBuffer() override { return {buffer_, nullptr}; }
+
+  void OnSerializedPacket(SerializedPacket /*serialized_packet*/) override {
+    ++packets_serialized_;
+  }
+
+  void OnUnrecoverableError(QuicErrorCode /*error*/,
+                            const std::string& error_details) override {
+    error_details_ = error_details;
+  }
+
+  bool ShouldGeneratePacket(HasRetransmittableData /*retransmittable*/,
+                            IsHandshake /*handshake*/) override {
+    return true;
+  }
+
+  const QuicFrames MaybeBundleAckOpportunistically() override { return {}; }
+
+  SerializedPacketFate GetSerializedPacketFate(
+      bool /*is_mtu_discovery*/,
+      EncryptionLevel /*encryption_level*/) override {
+    return SEND_TO_WRITER;
+  }
+
+  int64_t packets_serialized() const { return packets_serialized_; }
+  const std::string& error_details() const { return error_details_; }
+
+ private:
+  char buffer_[kMaxOutgoingPacketSize];
+  int64_t packets_serialized_ = 0;
+  std::string error_details_;
+};
+
+// Produces stream data without storing it, so that the benchmark measures
+// packetization rather than the send buffer.
+class ConstantDataProducer : public QuicStreamFrameDataProducer {
+ public:
+  WriteStreamDataResult WriteStreamData(QuicStreamId /*id*/,
+                                        QuicStreamOffset /*offset*/,
+                                        QuicByteCount data_length,
+                                        QuicDataWriter* writer) override {
+    while (data_length > 0) {
+      const QuicByteCount length =
+          std::min<QuicByteCount>(data_length, sizeof(data_));
+      if (!writer->WriteBytes(data_, length)) {
+        return WRITE_FAILED;
+      }
+      data_length -= length;
+    }
+    return WRITE_SUCCESS;
+  }
+
+  bool WriteCryptoData(EncryptionLevel /*level*/, QuicStreamOffset /*offset*/,
+                       QuicByteCount /*data_length*/,
+                       QuicDataWriter* /*writer*/) override {
+    return false;
+  }
+
+ private:
+  char data_[kMaxOutgoingPacketSize] = {};
+};
+
+void BM_ConsumeData(benchmark::State& state) {
+  const ParsedQuicVersion version = ParsedQuicVersion::RFCv1();
+  QuicFramer framer({version}, QuicTime::Zero(), Perspective::IS_SERVER,
+                    kQuicDefaultConnectionIdLength);
+  ConstantDataProducer data_producer;
+  framer.set_data_producer(&data_producer);
+  CountingDelegate delegate;
+  QuicPacketCreator creator(test::TestConnectionId(), &framer, &delegate);
+  creator.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                       std::make_unique<NullEncrypter>(Perspective::IS_SERVER));
+  creator.set_encryption_level(ENCRYPTION_FORWARD_SECURE);
+
+  const QuicStreamId stream_id = QuicUtils::GetFirstBidirectionalStreamId(
+      version.transport_version, Perspective::IS_CLIENT);
+  const size_t write_length = state.range(0);
+  QuicStreamOffset offset = 0;
+  for (auto _ : state) {
+    creator.AttachPacketFlusher();
+    const QuicConsumedData consumed =
+        creator.ConsumeData(stream_id, write_length, offset, NO_FIN);
+    creator.Flush();
+    offset += consumed.bytes_consumed;
+  }
+  if (!delegate.error_details().empty()) {
+    state.SkipWithError(delegate.error_details().c_str());
+    return;
+  }
+  state.SetBytesProcessed(offset);
+  state.counters["packets"] = delegate.packets_serialized();
+}
+// Writes below kMaxOutgoingPacketSize take the regular path, larger ones the
+// fast path.
+BENCHMARK(BM_ConsumeData)->Arg(100)->Arg(1000)->Arg(10000)->Arg(100000);
+
+}  // namespace
+}  // namespace quic
+
+BENCHMARK_MAIN();
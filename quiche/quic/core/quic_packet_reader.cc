@@ -4,6 +4,9 @@
 
 #include "quiche/quic/core/quic_packet_reader.h"
 
+#include <algorithm>
+#include <memory>
+
 #include "absl/base/macros.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/core/quic_process_packet_interface.h"
@@ -34,13 +37,29 @@ QuicPacketReader::QuicPacketReader()
 
 QuicPacketReader::~QuicPacketReader() = default;
 
+bool QuicPacketReader::EnableUdpGro(int fd) {
+  if (udp_gro_enabled()) {
+    return true;
+  }
+  if (!socket_api_.EnableUdpGro(fd)) {
+    return false;
+  }
+  gro_packet_buffers_ = std::make_unique<char[]>(kMaxGroPacketBufferSize *
+                                                 read_results_.size());
+  for (size_t i = 0; i < read_results_.size(); ++i) {
+    read_results_[i].packet_buffer.buffer =
+        gro_packet_buffers_.get() + i * kMaxGroPacketBufferSize;
+    read_results_[i].packet_buffer.buffer_len = kMaxGroPacketBufferSize;
+  }
+  return true;
+}
+
 bool QuicPacketReader::ReadAndDispatchPackets(
     int fd, int port, const QuicClock& clock, ProcessPacketInterface* processor,
     QuicPacketCount* /*packets_dropped*/) {
   // Reset all read_results for reuse.
   for (size_t i = 0; i < read_results_.size(); ++i) {
-    read_results_[i].Reset(
-        /*packet_buffer_length=*/sizeof(read_buffers_[i].packet_buffer));
+    read_results_[i].Reset(/*packet_buffer_length=*/packet_buffer_size());
   }
 
   // Use clock.Now() as the packet receipt time, the time between packet
@@ -54,7 +73,8 @@ bool QuicPacketReader::ReadAndDispatchPackets(
                 QuicUdpPacketInfoBit::V4_SELF_IP,
                 QuicUdpPacketInfoBit::V6_SELF_IP,
                 QuicUdpPacketInfoBit::RECV_TIMESTAMP, QuicUdpPacketInfoBit::TTL,
-                QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER),
+                QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER,
+                QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE),
       &read_results_);
   for (size_t i = 0; i < packets_read; ++i) {
     auto& result = read_results_[i];
@@ -62,49 +82,102 @@ bool QuicPacketReader::ReadAndDispatchPackets(
       QUIC_CODE_COUNT(quic_packet_reader_read_failure);
       continue;
     }
+    batch_.Add(result.packet_info, result.packet_buffer.buffer,
+               result.packet_buffer.buffer_len, port, now, processor);
+  }
+  batch_.Dispatch(processor);
 
-    if (!result.packet_info.HasValue(QuicUdpPacketInfoBit::PEER_ADDRESS)) {
-      QUIC_BUG(quic_bug_10329_1) << "Unable to get peer socket address.";
-      continue;
-    }
+  // We may not have read all of the packets available on the socket.
+  return packets_read == kNumPacketsPerReadMmsgCall;
+}
 
-    QuicSocketAddress peer_address =
-        result.packet_info.peer_address().Normalized();
+QuicPacketReader::DatagramBatch::DatagramBatch()
+    : received_packets_(kMaxPacketsPerBatch) {
+  packets_.reserve(kMaxPacketsPerBatch);
+}
 
-    QuicIpAddress self_ip = GetSelfIpFromPacketInfo(
-        result.packet_info, peer_address.host().IsIPv6());
-    if (!self_ip.IsInitialized()) {
-      QUIC_BUG(quic_bug_10329_2) << "Unable to get self IP address.";
-      continue;
+void QuicPacketReader::DatagramBatch::Add(const QuicUdpPacketInfo& packet_info,
+                                          char* buffer, size_t length,
+                                          int port, QuicTime now,
+                                          ProcessPacketInterface* processor) {
+  DatagramInfo info;
+  if (!GetDatagramInfo(packet_info, length, port, &info)) {
+    return;
+  }
+  // An empty datagram is still passed on, as a single empty packet.
+  QUICHE_DCHECK(info.segment_size > 0 || length == 0);
+  size_t offset = 0;
+  do {
+    if (packets_.size() == kMaxPacketsPerBatch) {
+      Dispatch(processor);
     }
+    absl::optional<QuicReceivedPacket>& packet =
+        received_packets_[packets_.size()];
+    packet.emplace(buffer + offset,
+                   std::min(info.segment_size, length - offset), now,
+                   /*owns_buffer=*/false, info.ttl, info.has_ttl, info.headers,
+                   info.headers_length, /*owns_header_buffer=*/false);
+    packet->set_kernel_receipt_time(info.kernel_receipt_time);
+    packets_.push_back({info.self_address, info.peer_address, &*packet});
+    offset += info.segment_size;
+  } while (offset < length);
+}
 
-    bool has_ttl = result.packet_info.HasValue(QuicUdpPacketInfoBit::TTL);
-    int ttl = has_ttl ? result.packet_info.ttl() : 0;
-    if (!has_ttl) {
-      QUIC_CODE_COUNT(quic_packet_reader_no_ttl);
-    }
+void QuicPacketReader::DatagramBatch::Dispatch(
+    ProcessPacketInterface* processor) {
+  if (packets_.empty()) {
+    return;
+  }
+  processor->ProcessPackets(packets_);
+  packets_.clear();
+}
 
-    char* headers = nullptr;
-    size_t headers_length = 0;
-    if (result.packet_info.HasValue(
-            QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER)) {
-      headers = result.packet_info.google_packet_headers().buffer;
-      headers_length = result.packet_info.google_packet_headers().buffer_len;
-    } else {
-      QUIC_CODE_COUNT(quic_packet_reader_no_google_packet_header);
-    }
+// static
+bool QuicPacketReader::GetDatagramInfo(const QuicUdpPacketInfo& packet_info,
+                                       size_t length, int port,
+                                       DatagramInfo* info) {
+  if (!packet_info.HasValue(QuicUdpPacketInfoBit::PEER_ADDRESS)) {
+    QUIC_BUG(quic_bug_10329_1) << "Unable to get peer socket address.";
+    return false;
+  }
 
-    QuicReceivedPacket packet(
-        result.packet_buffer.buffer, result.packet_buffer.buffer_len, now,
-        /*owns_buffer=*/false, ttl, has_ttl, headers, headers_length,
-        /*owns_header_buffer=*/false);
+  info->peer_address = packet_info.peer_address().Normalized();
 
-    QuicSocketAddress self_address(self_ip, port);
-    processor->ProcessPacket(self_address, peer_address, packet);
+  QuicIpAddress self_ip = GetSelfIpFromPacketInfo(
+      packet_info, info->peer_address.host().IsIPv6());
+  if (!self_ip.IsInitialized()) {
+    QUIC_BUG(quic_bug_10329_2) << "Unable to get self IP address.";
+    return false;
   }
+  info->self_address = QuicSocketAddress(self_ip, port);
 
-  // We may not have read all of the packets available on the socket.
-  return packets_read == kNumPacketsPerReadMmsgCall;
+  info->has_ttl = packet_info.HasValue(QuicUdpPacketInfoBit::TTL);
+  info->ttl = info->has_ttl ? packet_info.ttl() : 0;
+  if (!info->has_ttl) {
+    QUIC_CODE_COUNT(quic_packet_reader_no_ttl);
+  }
+
+  if (packet_info.HasValue(QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER)) {
+    info->headers = packet_info.google_packet_headers().buffer;
+    info->headers_length = packet_info.google_packet_headers().buffer_len;
+  } else {
+    QUIC_CODE_COUNT(quic_packet_reader_no_google_packet_header);
+  }
+
+  if (packet_info.HasValue(QuicUdpPacketInfoBit::RECV_TIMESTAMP)) {
+    info->kernel_receipt_time = packet_info.receive_timestamp();
+  }
+
+  // With UDP GRO, the buffer may hold several datagrams back to back. A
+  // segment size of zero is not a split and is ignored.
+  info->segment_size = length;
+  if (packet_info.HasValue(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE) &&
+      packet_info.gro_segment_size() > 0 &&
+      packet_info.gro_segment_size() < length) {
+    info->segment_size = packet_info.gro_segment_size();
+    QUIC_CODE_COUNT(quic_packet_reader_gro_coalesced_read);
+  }
+  return true;
 }
 
 // static
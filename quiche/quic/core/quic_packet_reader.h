@@ -7,7 +7,11 @@
 #ifndef QUICHE_QUIC_CORE_QUIC_PACKET_READER_H_
 #define QUICHE_QUIC_CORE_QUIC_PACKET_READER_H_
 
+#include <memory>
+#include <vector>
+
 #include "absl/base/optimization.h"
+#include "absl/types/optional.h"
 #include "quiche/quic/core/quic_clock.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/core/quic_process_packet_interface.h"
@@ -29,8 +33,9 @@ class QUIC_EXPORT_PRIVATE QuicPacketReader {
   virtual ~QuicPacketReader();
 
   // Reads a number of packets from the given fd, and then passes them off to
-  // the PacketProcessInterface.  Returns true if there may be additional
-  // packets available on the socket.
+  // the PacketProcessInterface in batches of up to kMaxPacketsPerBatch
+  // datagrams.  Returns true if there may be additional packets available on
+  // the socket.
   // Populates |packets_dropped| if it is non-null and the socket is configured
   // to track dropped packets and some packets are read.
   // If the socket has timestamping enabled, the per packet timestamps will be
@@ -39,7 +44,64 @@ class QUIC_EXPORT_PRIVATE QuicPacketReader {
                                       ProcessPacketInterface* processor,
                                       QuicPacketCount* packets_dropped);
 
+  // Enables UDP GRO on |fd| and switches to read buffers large enough to hold
+  // a coalesced super-buffer. Each coalesced read is split into its datagrams
+  // in place, and every datagram is passed to the processor separately without
+  // being copied. Returns false, leaving the reader in one-datagram-per-buffer
+  // mode, if the kernel does not support UDP GRO.
+  bool EnableUdpGro(int fd);
+
+  bool udp_gro_enabled() const { return gro_packet_buffers_ != nullptr; }
+
+  // Datagrams read but not yet passed to a ProcessPacketInterface. Used by all
+  // packet readers.
+  class QUIC_EXPORT_PRIVATE DatagramBatch {
+   public:
+    DatagramBatch();
+    DatagramBatch(const DatagramBatch&) = delete;
+    DatagramBatch& operator=(const DatagramBatch&) = delete;
+
+    // Adds the packet in |buffer|, received on |port| with |packet_info|, to
+    // the batch. If the packet was read with UDP GRO, each of the datagrams
+    // coalesced into |buffer| is added separately. A full batch is passed to
+    // |processor| early. |buffer| must stay valid until the batch is passed.
+    void Add(const QuicUdpPacketInfo& packet_info, char* buffer, size_t length,
+             int port, QuicTime now, ProcessPacketInterface* processor);
+
+    // Passes the datagrams added so far to |processor| and empties the batch.
+    void Dispatch(ProcessPacketInterface* processor);
+
+   private:
+    // |packets_[i].packet| points into |received_packets_[i]|, which points
+    // into the buffers passed to Add().
+    std::vector<ReceivedUdpPacket> packets_;
+    std::vector<absl::optional<QuicReceivedPacket>> received_packets_;
+  };
+
  private:
+  // The most datagrams passed to ProcessPackets() in one call. A batch is
+  // dispatched early if UDP GRO splits the read results into more datagrams.
+  static constexpr size_t kMaxPacketsPerBatch = 64;
+
+  // What a read result says about each of the datagrams in its packet buffer.
+  struct QUIC_EXPORT_PRIVATE DatagramInfo {
+    QuicSocketAddress self_address;
+    QuicSocketAddress peer_address;
+    int ttl = 0;
+    bool has_ttl = false;
+    char* headers = nullptr;
+    size_t headers_length = 0;
+    // Zero if the socket did not report when the kernel received the packet.
+    QuicWallTime kernel_receipt_time = QuicWallTime::Zero();
+    // Every datagram but the last one is exactly |segment_size| bytes long.
+    size_t segment_size = 0;
+  };
+
+  // Fills |info| from |packet_info|, for a read of |length| bytes on |port|.
+  // Returns false if the packet cannot be dispatched.
+  static bool GetDatagramInfo(const QuicUdpPacketInfo& packet_info,
+                              size_t length, int port, DatagramInfo* info);
+
   // Return the self ip from |packet_info|.
   // For dual stack sockets, |packet_info| may contain both a v4 and a v6 ip, in
   // that case, |prefer_v6_ip| is used to determine which one is used as the
@@ -54,9 +116,19 @@ class QUIC_EXPORT_PRIVATE QuicPacketReader {
     ABSL_CACHELINE_ALIGNED char packet_buffer[kMaxIncomingPacketSize];
   };
 
+  // The size of the packet buffer behind each element of |read_results_|.
+  size_t packet_buffer_size() const {
+    return udp_gro_enabled() ? kMaxGroPacketBufferSize
+                             : sizeof(ReadBuffer::packet_buffer);
+  }
+
   QuicUdpSocketApi socket_api_;
   std::vector<ReadBuffer> read_buffers_;
+  // Packet buffers used instead of |read_buffers_[i].packet_buffer| once UDP
+  // GRO is enabled, |kMaxGroPacketBufferSize| bytes per read result.
+  std::unique_ptr<char[]> gro_packet_buffers_;
   QuicUdpSocketApi::ReadPacketResults read_results_;
+  DatagramBatch batch_;
 };
 
 }  // namespace quic
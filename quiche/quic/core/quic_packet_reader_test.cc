@@ -0,0 +1,221 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_packet_reader.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "quiche/quic/core/quic_linux_socket_utils.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class RecordingPacketProcessor : public ProcessPacketInterface {
+ public:
+  void ProcessPacket(const QuicSocketAddress& /*self_address*/,
+                     const QuicSocketAddress& /*peer_address*/,
+                     const QuicReceivedPacket& packet) override {
+    packets_.push_back(std::string(packet.data(), packet.length()));
+    kernel_receipt_times_.push_back(packet.kernel_receipt_time());
+  }
+
+  void ProcessPackets(absl::Span<const ReceivedUdpPacket> packets) override {
+    batch_sizes_.push_back(packets.size());
+    ProcessPacketInterface::ProcessPackets(packets);
+  }
+
+  const std::vector<std::string>& packets() const { return packets_; }
+  const std::vector<size_t>& batch_sizes() const { return batch_sizes_; }
+  const std::vector<QuicWallTime>& kernel_receipt_times() const {
+    return kernel_receipt_times_;
+  }
+
+ private:
+  std::vector<std::string> packets_;
+  std::vector<QuicWallTime> kernel_receipt_times_;
+  std::vector<size_t> batch_sizes_;
+};
+
+class QuicPacketReaderTest : public QuicTest {
+ protected:
+  void SetUp() override {
+    QuicIpAddress localhost = QuicIpAddress::Loopback4();
+    server_fd_ = socket_api_.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, server_fd_);
+    ASSERT_TRUE(socket_api_.Bind(server_fd_, QuicSocketAddress(localhost, 0)));
+    ASSERT_EQ(0, server_address_.FromSocket(server_fd_));
+
+    client_fd_ = socket_api_.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, client_fd_);
+    ASSERT_TRUE(socket_api_.Bind(client_fd_, QuicSocketAddress(localhost, 0)));
+  }
+
+  void TearDown() override {
+    socket_api_.Destroy(server_fd_);
+    socket_api_.Destroy(client_fd_);
+  }
+
+  // Sends |payload| to the server socket as a single UDP GSO send, which the
+  // kernel splits into |segment_size|-byte datagrams.
+  bool SendWithGso(const std::string& payload, uint16_t segment_size) {
+    char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+    sockaddr_storage peer = server_address_.generic_address();
+    iovec iov = {const_cast<char*>(payload.data()), payload.size()};
+    msghdr hdr = {};
+    hdr.msg_name = &peer;
+    hdr.msg_namelen = sizeof(sockaddr_in);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    *reinterpret_cast<uint16_t*>(CMSG_DATA(cmsg)) = segment_size;
+    return sendmsg(client_fd_, &hdr, 0) == static_cast<ssize_t>(payload.size());
+  }
+
+  QuicUdpSocketApi socket_api_;
+  QuicUdpSocketFd server_fd_ = kQuicInvalidSocketFd;
+  QuicUdpSocketFd client_fd_ = kQuicInvalidSocketFd;
+  QuicSocketAddress server_address_;
+  MockClock clock_;
+  RecordingPacketProcessor processor_;
+};
+
+TEST_F(QuicPacketReaderTest, ReadWithoutGro) {
+  QuicPacketReader reader;
+  EXPECT_FALSE(reader.udp_gro_enabled());
+
+  const std::string payload(1000, 'a');
+  QuicUdpPacketInfo packet_info;
+  packet_info.SetPeerAddress(server_address_);
+  ASSERT_EQ(WRITE_STATUS_OK,
+            socket_api_
+                .WritePacket(client_fd_, payload.data(), payload.size(),
+                             packet_info)
+                .status);
+  ASSERT_TRUE(socket_api_.WaitUntilReadable(server_fd_,
+                                            QuicTime::Delta::FromSeconds(1)));
+
+  reader.ReadAndDispatchPackets(server_fd_, server_address_.port(), clock_,
+                                &processor_, nullptr);
+  ASSERT_EQ(1u, processor_.packets().size());
+  EXPECT_EQ(payload, processor_.packets()[0]);
+}
+
+TEST_F(QuicPacketReaderTest, DispatchesPacketsReadTogetherInOneBatch) {
+  QuicPacketReader reader;
+  QuicUdpPacketInfo packet_info;
+  packet_info.SetPeerAddress(server_address_);
+  for (char c : {'a', 'b', 'c'}) {
+    const std::string payload(1000, c);
+    ASSERT_EQ(WRITE_STATUS_OK,
+              socket_api_
+                  .WritePacket(client_fd_, payload.data(), payload.size(),
+                               packet_info)
+                  .status);
+  }
+  ASSERT_TRUE(socket_api_.WaitUntilReadable(server_fd_,
+                                            QuicTime::Delta::FromSeconds(1)));
+
+  reader.ReadAndDispatchPackets(server_fd_, server_address_.port(), clock_,
+                                &processor_, nullptr);
+  ASSERT_EQ(3u, processor_.packets().size());
+  EXPECT_EQ(std::string(1000, 'a'), processor_.packets()[0]);
+  EXPECT_EQ(std::string(1000, 'b'), processor_.packets()[1]);
+  EXPECT_EQ(std::string(1000, 'c'), processor_.packets()[2]);
+  EXPECT_EQ(std::vector<size_t>({3}), processor_.batch_sizes());
+}
+
+TEST_F(QuicPacketReaderTest, PassesKernelReceiptTime) {
+  if (!socket_api_.EnableReceiveTimestamp(server_fd_)) {
+    // SO_TIMESTAMPING is not supported by the kernel running this test.
+    return;
+  }
+  QuicPacketReader reader;
+  const std::string payload(1000, 'a');
+  QuicUdpPacketInfo packet_info;
+  packet_info.SetPeerAddress(server_address_);
+  ASSERT_EQ(WRITE_STATUS_OK,
+            socket_api_
+                .WritePacket(client_fd_, payload.data(), payload.size(),
+                             packet_info)
+                .status);
+  ASSERT_TRUE(socket_api_.WaitUntilReadable(server_fd_,
+                                            QuicTime::Delta::FromSeconds(1)));
+
+  reader.ReadAndDispatchPackets(server_fd_, server_address_.port(), clock_,
+                                &processor_, nullptr);
+  ASSERT_EQ(1u, processor_.kernel_receipt_times().size());
+  EXPECT_FALSE(processor_.kernel_receipt_times()[0].IsZero());
+}
+
+// Regression test for the GRO split loop never advancing on a zero segment
+// size, and dropping empty datagrams, such as those the io_uring reader adds.
+TEST_F(QuicPacketReaderTest, AddsDatagramsWithZeroLengthOrSegmentSize) {
+  QuicUdpPacketInfo packet_info;
+  packet_info.SetPeerAddress(server_address_);
+  packet_info.SetSelfIp(server_address_.host());
+  packet_info.SetGroSegmentSize(0);
+  char buffer[1000];
+  memset(buffer, 'a', sizeof(buffer));
+
+  QuicPacketReader::DatagramBatch batch;
+  batch.Add(packet_info, buffer, sizeof(buffer), server_address_.port(),
+            clock_.Now(), &processor_);
+  batch.Add(packet_info, buffer, 0, server_address_.port(), clock_.Now(),
+            &processor_);
+  batch.Dispatch(&processor_);
+  ASSERT_EQ(2u, processor_.packets().size());
+  EXPECT_EQ(std::string(sizeof(buffer), 'a'), processor_.packets()[0]);
+  EXPECT_EQ("", processor_.packets()[1]);
+}
+
+TEST_F(QuicPacketReaderTest, ReadCoalescedDatagramsWithGro) {
+  QuicPacketReader reader;
+  if (!reader.EnableUdpGro(server_fd_)) {
+    // UDP GRO is not supported by the kernel running this test.
+    return;
+  }
+  EXPECT_TRUE(reader.udp_gro_enabled());
+
+  // Three full segments and a short trailing one.
+  const std::string payload = std::string(1200, 'a') + std::string(1200, 'b') +
+                              std::string(1200, 'c') + std::string(100, 'd');
+  if (!SendWithGso(payload, 1200)) {
+    // UDP GSO is not supported either, nothing to coalesce.
+    return;
+  }
+  ASSERT_TRUE(socket_api_.WaitUntilReadable(server_fd_,
+                                            QuicTime::Delta::FromSeconds(1)));
+
+  while (reader.ReadAndDispatchPackets(server_fd_, server_address_.port(),
+                                       clock_, &processor_, nullptr)) {
+  }
+  ASSERT_EQ(4u, processor_.packets().size());
+  EXPECT_EQ(std::string(1200, 'a'), processor_.packets()[0]);
+  EXPECT_EQ(std::string(1200, 'b'), processor_.packets()[1]);
+  EXPECT_EQ(std::string(1200, 'c'), processor_.packets()[2]);
+  EXPECT_EQ(std::string(100, 'd'), processor_.packets()[3]);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
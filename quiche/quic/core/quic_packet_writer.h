@@ -36,6 +36,17 @@ struct QUIC_EXPORT_PRIVATE PerPacketOptions {
   bool allow_burst = false;
 };
 
+// Seals packets which were handed to a batch writer before being fully
+// encrypted, so that a burst of them can be encrypted together right before it
+// is sent. See QuicPacketWriter::RegisterPacketSealer().
+class QUIC_EXPORT_PRIVATE QuicPacketSealer {
+ public:
+  virtual ~QuicPacketSealer() {}
+
+  // Finishes encrypting, in place, every packet handed to the writer unsealed.
+  virtual void SealPendingPackets() = 0;
+};
+
 // An interface between writers and the entity managing the
 // socket (in our case the QuicDispatcher).  This allows the Dispatcher to
 // control writes, and manage any writers who end up write blocked.
@@ -162,6 +173,22 @@ class QUIC_EXPORT_PRIVATE QuicPacketWriter {
   //   were on memory acquired via GetNextWriteLocation() should be released and
   //   the batch should be dropped.
   virtual WriteResult Flush() = 0;
+
+  // PassThrough mode: Return false.
+  //
+  // Batch mode:
+  // Registers |sealer|, which the writer calls before it sends any buffered
+  // packet, including when WritePacket() flushes. Packets serialized to the
+  // location returned by GetNextWriteLocation() may then be passed to
+  // WritePacket() before they are sealed, as long as |sealer| seals them in
+  // place when called. Returns false if the writer does not support sealers or
+  // another sealer is registered.
+  virtual bool RegisterPacketSealer(QuicPacketSealer* /*sealer*/) {
+    return false;
+  }
+
+  // Unregisters |sealer|, if it is registered.
+  virtual void UnregisterPacketSealer(QuicPacketSealer* /*sealer*/) {}
 };
 
 }  // namespace quic
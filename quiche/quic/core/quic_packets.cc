@@ -356,6 +356,7 @@ QuicReceivedPacket::QuicReceivedPacket(const char* buffer, size_t length,
                                        bool owns_header_buffer)
     : QuicEncryptedPacket(buffer, length, owns_buffer),
       receipt_time_(receipt_time),
+      kernel_receipt_time_(QuicWallTime::Zero()),
       ttl_(ttl_valid ? ttl : -1),
       packet_headers_(packet_headers),
       headers_length_(headers_length),
@@ -370,16 +371,19 @@ QuicReceivedPacket::~QuicReceivedPacket() {
 std::unique_ptr<QuicReceivedPacket> QuicReceivedPacket::Clone() const {
   char* buffer = new char[this->length()];
   memcpy(buffer, this->data(), this->length());
+  std::unique_ptr<QuicReceivedPacket> clone;
   if (this->packet_headers()) {
     char* headers_buffer = new char[this->headers_length()];
     memcpy(headers_buffer, this->packet_headers(), this->headers_length());
-    return std::make_unique<QuicReceivedPacket>(
+    clone = std::make_unique<QuicReceivedPacket>(
         buffer, this->length(), receipt_time(), true, ttl(), ttl() >= 0,
         headers_buffer, this->headers_length(), true);
+  } else {
+    clone = std::make_unique<QuicReceivedPacket>(
+        buffer, this->length(), receipt_time(), true, ttl(), ttl() >= 0);
   }
-
-  return std::make_unique<QuicReceivedPacket>(
-      buffer, this->length(), receipt_time(), true, ttl(), ttl() >= 0);
+  clone->set_kernel_receipt_time(kernel_receipt_time());
+  return clone;
 }
 
 std::ostream& operator<<(std::ostream& os, const QuicReceivedPacket& s) {
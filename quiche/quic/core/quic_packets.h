@@ -300,6 +300,14 @@ class QUIC_EXPORT_PRIVATE QuicReceivedPacket : public QuicEncryptedPacket {
   // Returns the time at which the packet was received.
   QuicTime receipt_time() const { return receipt_time_; }
 
+  // Returns the time at which the kernel received the packet, or zero if the
+  // socket did not report it. Unlike receipt_time(), which is taken when the
+  // packet is read, this includes the time it waited in the socket queue.
+  QuicWallTime kernel_receipt_time() const { return kernel_receipt_time_; }
+  void set_kernel_receipt_time(QuicWallTime kernel_receipt_time) {
+    kernel_receipt_time_ = kernel_receipt_time;
+  }
+
   // This is the TTL of the packet, assuming ttl_vaild_ is true.
   int ttl() const { return ttl_; }
 
@@ -318,6 +326,7 @@ class QUIC_EXPORT_PRIVATE QuicReceivedPacket : public QuicEncryptedPacket {
 
  private:
   const QuicTime receipt_time_;
+  QuicWallTime kernel_receipt_time_;
   int ttl_;
   // Points to the start of packet headers.
   char* packet_headers_;
@@ -397,6 +406,14 @@ struct QUIC_EXPORT_PRIVATE QuicPerPacketContext {
   virtual ~QuicPerPacketContext() {}
 };
 
+// A packet received on a UDP socket, with the addresses it was received on and
+// from. Used to pass a batch of received packets in one call.
+struct QUIC_EXPORT_PRIVATE ReceivedUdpPacket {
+  QuicSocketAddress self_address;
+  QuicSocketAddress peer_address;
+  const QuicReceivedPacket* packet;
+};
+
 // ReceivedPacketInfo comprises information obtained by parsing the unencrypted
 // bytes of a received packet.
 struct QUIC_EXPORT_PRIVATE ReceivedPacketInfo {
@@ -5,6 +5,7 @@
 #ifndef QUICHE_QUIC_CORE_QUIC_PROCESS_PACKET_INTERFACE_H_
 #define QUICHE_QUIC_CORE_QUIC_PROCESS_PACKET_INTERFACE_H_
 
+#include "absl/types/span.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/platform/api/quic_socket_address.h"
 
@@ -17,6 +18,14 @@ class QUIC_NO_EXPORT ProcessPacketInterface {
   virtual void ProcessPacket(const QuicSocketAddress& self_address,
                              const QuicSocketAddress& peer_address,
                              const QuicReceivedPacket& packet) = 0;
+
+  // Processes the packets read from a socket in one batch. The default
+  // implementation processes them one by one, in order.
+  virtual void ProcessPackets(absl::Span<const ReceivedUdpPacket> packets) {
+    for (const ReceivedUdpPacket& packet : packets) {
+      ProcessPacket(packet.self_address, packet.peer_address, *packet.packet);
+    }
+  }
 };
 
 }  // namespace quic
@@ -215,4 +215,54 @@ QUIC_PROTOCOL_FLAG(
 
 QUIC_PROTOCOL_FLAG(bool, quic_use_lower_server_response_mtu_for_test, false,
                    "If true, cap server response packet size at 1250.")
+
+QUIC_PROTOCOL_FLAG(bool, quic_server_enable_udp_gro, false,
+                   "If true, QuicServer enables UDP GRO on its listening "
+                   "socket and reads coalesced datagrams when the kernel "
+                   "supports it.")
+
+QUIC_PROTOCOL_FLAG(bool, quic_server_enable_io_uring, false,
+                   "If true, QuicServer receives with a multishot io_uring "
+                   "recvmsg and sends batches of packets through io_uring, "
+                   "falling back to recvmmsg and sendmsg if the kernel does "
+                   "not support it. Cannot be combined with "
+                   "--quic_server_edt_pacing.")
+
+QUIC_PROTOCOL_FLAG(bool, quic_server_handshake_admission_control, false,
+                   "If true, QuicServer refuses new connections while its "
+                   "event loop lags, limiting them per source prefix first, "
+                   "and bounds the sessions it creates per event loop by the "
+                   "measured cost of handshakes.")
+
+QUIC_PROTOCOL_FLAG(bool, quic_server_edt_pacing, false,
+                   "If true, QuicServer writes with SO_TXTIME, so that "
+                   "connections hand the departure time of paced packets to "
+                   "the fq qdisc instead of waking up to send each of them. "
+                   "Needs "
+                   "--quic_restart_flag_quic_support_release_time_for_gso and "
+                   "--quic_reloadable_flag_quic_pace_with_release_times. "
+                   "Cannot be combined with --quic_server_enable_io_uring.")
+
+QUIC_PROTOCOL_FLAG(bool, quic_server_enable_zerocopy, false,
+                   "If true, QuicServer sends large GSO batches with "
+                   "MSG_ZEROCOPY, falling back to copying if the socket does "
+                   "not support it. Cannot be combined with "
+                   "--quic_server_enable_io_uring.")
+
+QUIC_PROTOCOL_FLAG(int32_t, quic_server_signing_threads, 0,
+                   "If positive, QuicServer computes TLS signatures on this "
+                   "many worker threads instead of on its event loop.")
+
+QUIC_PROTOCOL_FLAG(int32_t, quic_server_signing_max_queue_depth, 1024,
+                   "Most TLS signatures waiting for a signing thread. Further "
+                   "handshakes fail until the queue drains.")
+
+QUIC_PROTOCOL_FLAG(int32_t, quic_server_signing_max_queue_delay_ms, 0,
+                   "If positive, TLS signatures which waited longer than this "
+                   "for a signing thread fail without being computed.")
+
+QUIC_PROTOCOL_FLAG(
+    int32_t, quic_stream_sequencer_buffer_block_pool_max_blocks, 256,
+    "Maximum number of 8 KB stream receive buffer blocks a connection helper "
+    "using a buffer pool keeps for reuse once streams have retired them.")
 #endif
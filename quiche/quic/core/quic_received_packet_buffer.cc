@@ -0,0 +1,68 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_received_packet_buffer.h"
+
+#include <functional>
+
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+// static
+QuicReceivedPacketBuffer::Pointer QuicReceivedPacketBuffer::Create() {
+  return Pointer(new QuicReceivedPacketBuffer());
+}
+
+QuicReceivedPacketBuffer::Pointer QuicReceivedPacketBuffer::NewReference() {
+  AddReference();
+  return Pointer(this);
+}
+
+bool QuicReceivedPacketBuffer::Contains(absl::string_view data) const {
+  std::less_equal<const char*> less_equal;
+  return less_equal(buffer_, data.data()) &&
+         less_equal(data.data() + data.size(), buffer_ + size());
+}
+
+quiche::QuicheMemSlice QuicReceivedPacketBuffer::MakeSlice(
+    absl::string_view data) {
+  QUICHE_DCHECK(!data.empty());
+  QUICHE_DCHECK(Contains(data));
+  AddReference();
+  return quiche::QuicheMemSlice(quiche::QuicheBuffer(
+      quiche::QuicheUniqueBufferPtr(const_cast<char*>(data.data()),
+                                    quiche::QuicheBufferDeleter(this)),
+      data.size()));
+}
+
+char* QuicReceivedPacketBuffer::New(size_t /*size*/) {
+  QUIC_BUG(quic_received_packet_buffer_new)
+      << "QuicReceivedPacketBuffer does not allocate buffers";
+  return nullptr;
+}
+
+char* QuicReceivedPacketBuffer::New(size_t size, bool /*flag_enable*/) {
+  return New(size);
+}
+
+void QuicReceivedPacketBuffer::Delete(char* buffer) {
+  QUICHE_DCHECK(Contains(absl::string_view(buffer, 0)));
+  RemoveReference();
+}
+
+void QuicReceivedPacketBuffer::AddReference() {
+  reference_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QuicReceivedPacketBuffer::RemoveReference() {
+  // Whoever drops the last reference must see all writes made through the
+  // others before deleting the buffer.
+  if (reference_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+}  // namespace quic
@@ -0,0 +1,90 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_RECEIVED_PACKET_BUFFER_H_
+#define QUICHE_QUIC_CORE_QUIC_RECEIVED_PACKET_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/quic_constants.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
+#include "quiche/common/quiche_buffer_allocator.h"
+
+namespace quic {
+
+// A reference-counted buffer which QuicFramer decrypts a received packet
+// into, so that frame data of the packet can be handed out as
+// QuicheMemSlices without being copied. Each slice holds a reference to the
+// buffer, which is freed once the framer and all slices have released it.
+//
+// The buffer acts as the QuicheBufferAllocator of the slices it hands out:
+// releasing a slice calls Delete(), which drops its reference. Slices may be
+// released on any thread.
+class QUIC_EXPORT_PRIVATE QuicReceivedPacketBuffer
+    : public quiche::QuicheBufferAllocator {
+ public:
+  // Drops the reference held by a Pointer.
+  struct QUIC_EXPORT_PRIVATE Unreference {
+    void operator()(QuicReceivedPacketBuffer* buffer) const {
+      buffer->RemoveReference();
+    }
+  };
+  // Holds one reference to a buffer.
+  using Pointer = std::unique_ptr<QuicReceivedPacketBuffer, Unreference>;
+
+  // Returns a new buffer, whose only reference is held by the returned
+  // pointer.
+  static Pointer Create();
+
+  QuicReceivedPacketBuffer(const QuicReceivedPacketBuffer&) = delete;
+  QuicReceivedPacketBuffer& operator=(const QuicReceivedPacketBuffer&) =
+      delete;
+
+  // Returns a pointer holding a new reference to this buffer.
+  Pointer NewReference();
+
+  // Returns true if the caller's reference is the only one, i.e. nothing else
+  // can read from the buffer any more.
+  bool HasUniqueReference() const {
+    return reference_count_.load(std::memory_order_acquire) == 1;
+  }
+
+  char* data() { return buffer_; }
+  static constexpr size_t size() { return kMaxIncomingPacketSize; }
+
+  // Returns whether |data| lies entirely within this buffer.
+  bool Contains(absl::string_view data) const;
+
+  // Returns a slice referencing |data|, which must be non-empty and lie within
+  // this buffer.
+  quiche::QuicheMemSlice MakeSlice(absl::string_view data);
+
+  // QuicheBufferAllocator. Slices are only created by MakeSlice(), so New()
+  // must not be called.
+  char* New(size_t size) override;
+  char* New(size_t size, bool flag_enable) override;
+  void Delete(char* buffer) override;
+
+ private:
+  QuicReceivedPacketBuffer() = default;
+  ~QuicReceivedPacketBuffer() override = default;
+
+  void AddReference();
+  // Deletes the buffer when the last reference is removed.
+  void RemoveReference();
+
+  std::atomic<int> reference_count_{1};
+  // The optimized decryption algorithm implementations run faster when
+  // operating on aligned memory.
+  ABSL_CACHELINE_ALIGNED char buffer_[kMaxIncomingPacketSize];
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_RECEIVED_PACKET_BUFFER_H_
@@ -0,0 +1,71 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_received_packet_buffer.h"
+
+#include <cstring>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+TEST(QuicReceivedPacketBufferTest, SlicesKeepBufferAlive) {
+  QuicReceivedPacketBuffer::Pointer buffer = QuicReceivedPacketBuffer::Create();
+  memcpy(buffer->data(), "hello world", 11);
+  EXPECT_TRUE(buffer->HasUniqueReference());
+
+  quiche::QuicheMemSlice hello =
+      buffer->MakeSlice(absl::string_view(buffer->data(), 5));
+  quiche::QuicheMemSlice world =
+      buffer->MakeSlice(absl::string_view(buffer->data() + 6, 5));
+  EXPECT_FALSE(buffer->HasUniqueReference());
+
+  buffer.reset();
+  EXPECT_EQ("hello", hello.AsStringView());
+  EXPECT_EQ("world", world.AsStringView());
+
+  quiche::QuicheMemSlice moved = std::move(hello);
+  hello.Reset();
+  EXPECT_EQ("hello", moved.AsStringView());
+  moved.Reset();
+  EXPECT_EQ("world", world.AsStringView());
+}
+
+TEST(QuicReceivedPacketBufferTest, ReleasingSlicesRestoresUniqueReference) {
+  QuicReceivedPacketBuffer::Pointer buffer = QuicReceivedPacketBuffer::Create();
+  {
+    quiche::QuicheMemSlice slice =
+        buffer->MakeSlice(absl::string_view(buffer->data(), 1));
+    EXPECT_FALSE(buffer->HasUniqueReference());
+  }
+  EXPECT_TRUE(buffer->HasUniqueReference());
+}
+
+TEST(QuicReceivedPacketBufferTest, NewReference) {
+  QuicReceivedPacketBuffer::Pointer buffer = QuicReceivedPacketBuffer::Create();
+  QuicReceivedPacketBuffer::Pointer other = buffer->NewReference();
+  EXPECT_EQ(buffer.get(), other.get());
+  EXPECT_FALSE(buffer->HasUniqueReference());
+  other.reset();
+  EXPECT_TRUE(buffer->HasUniqueReference());
+}
+
+TEST(QuicReceivedPacketBufferTest, Contains) {
+  QuicReceivedPacketBuffer::Pointer buffer = QuicReceivedPacketBuffer::Create();
+  const char* data = buffer->data();
+  EXPECT_TRUE(buffer->Contains(absl::string_view(data, buffer->size())));
+  EXPECT_TRUE(buffer->Contains(absl::string_view(data + 10, 5)));
+  EXPECT_FALSE(buffer->Contains(absl::string_view(data + 1, buffer->size())));
+  const char other[] = "other";
+  EXPECT_FALSE(buffer->Contains(absl::string_view(other, 5)));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,224 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_reuseport_steering.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <cstdint>
+
+#include "quiche/quic/core/quic_utils.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
+
+#if defined(__linux__) && !defined(SO_ATTACH_REUSEPORT_CBPF)
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+namespace quic {
+
+namespace {
+
+// Long header packets carry the destination connection ID length in byte 5
+// and the destination connection ID from byte 6 on. Short header packets carry
+// the destination connection ID from byte 1 on.
+constexpr uint32_t kLongHeaderConnectionIdLengthOffset = 5;
+constexpr uint32_t kLongHeaderConnectionIdOffset = 6;
+constexpr uint32_t kShortHeaderConnectionIdOffset = 1;
+
+// The two most significant bits of the first connection ID byte carry the
+// QUIC-LB config ID.
+constexpr uint8_t kConfigIdShift = 6;
+
+// Returned by the steering program to fall back to the kernel's default hash.
+constexpr uint32_t kFallbackToHash = 0xffffffff;
+
+}  // namespace
+
+// static
+absl::optional<QuicReuseportSteering> QuicReuseportSteering::Create(
+    const LoadBalancerConfig& config, size_t num_sockets) {
+  if (config.IsEncrypted()) {
+    QUIC_LOG(ERROR) << "Cannot steer on encrypted QUIC-LB config "
+                    << static_cast<int>(config.config_id());
+    return absl::nullopt;
+  }
+  if (num_sockets == 0 || num_sockets > kFallbackToHash) {
+    QUIC_BUG(quic_reuseport_steering_bad_num_sockets)
+        << "Invalid number of sockets " << num_sockets;
+    return absl::nullopt;
+  }
+  return QuicReuseportSteering(config, num_sockets);
+}
+
+QuicReuseportSteering::QuicReuseportSteering(const LoadBalancerConfig& config,
+                                             size_t num_sockets)
+    : config_(config), num_sockets_(num_sockets) {}
+
+size_t QuicReuseportSteering::key_length() const {
+  // Classic BPF loads 1, 2 or 4 bytes at a time.
+  if (config_.server_id_len() >= 4) {
+    return 4;
+  }
+  return config_.server_id_len() >= 2 ? 2 : 1;
+}
+
+size_t QuicReuseportSteering::key_offset() const {
+  return 1 + config_.server_id_len() - key_length();
+}
+
+absl::optional<size_t> QuicReuseportSteering::SocketIndexForConnectionIdBytes(
+    absl::string_view connection_id) const {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(connection_id.data());
+  if ((bytes[0] >> kConfigIdShift) != config_.config_id()) {
+    return absl::nullopt;
+  }
+  uint32_t key = 0;
+  for (size_t i = 0; i < key_length(); ++i) {
+    key = (key << 8) | bytes[key_offset() + i];
+  }
+  return key % num_sockets_;
+}
+
+absl::optional<size_t> QuicReuseportSteering::SocketIndexForConnectionId(
+    const QuicConnectionId& connection_id) const {
+  if (connection_id.length() != config_.total_len()) {
+    return absl::nullopt;
+  }
+  return SocketIndexForConnectionIdBytes(
+      absl::string_view(connection_id.data(), connection_id.length()));
+}
+
+absl::optional<size_t> QuicReuseportSteering::SocketIndexForPacket(
+    absl::string_view packet) const {
+  if (packet.empty()) {
+    return absl::nullopt;
+  }
+  size_t connection_id_offset = kShortHeaderConnectionIdOffset;
+  if (static_cast<uint8_t>(packet[0]) & FLAGS_LONG_HEADER) {
+    if (packet.size() < kLongHeaderConnectionIdOffset + config_.total_len() ||
+        static_cast<uint8_t>(packet[kLongHeaderConnectionIdLengthOffset]) !=
+            config_.total_len()) {
+      return absl::nullopt;
+    }
+    connection_id_offset = kLongHeaderConnectionIdOffset;
+  } else if (packet.size() <
+             kShortHeaderConnectionIdOffset + config_.total_len()) {
+    return absl::nullopt;
+  }
+  return SocketIndexForConnectionIdBytes(packet.substr(connection_id_offset));
+}
+
+LoadBalancerServerId QuicReuseportSteering::ServerIdForSocket(
+    size_t socket_index) const {
+  QUICHE_DCHECK_LT(socket_index, num_sockets_);
+  uint8_t data[kLoadBalancerMaxServerIdLen] = {};
+  uint32_t key = static_cast<uint32_t>(socket_index);
+  for (size_t i = key_length(); i > 0; --i) {
+    data[key_offset() - 1 + i - 1] = static_cast<uint8_t>(key & 0xff);
+    key >>= 8;
+  }
+  return *LoadBalancerServerId::Create(
+      absl::MakeConstSpan(data, config_.server_id_len()));
+}
+
+QuicConnectionId QuicReuseportSteering::MakeRoutableConnectionId(
+    const QuicConnectionId& connection_id, size_t socket_index) const {
+  QUICHE_DCHECK_EQ(connection_id.length(), config_.total_len());
+  if (SocketIndexForConnectionId(connection_id) == socket_index) {
+    return connection_id;
+  }
+  // Hash the original connection ID so that the nonce bytes stay unpredictable,
+  // then write the config ID, the self-encoded length and the server ID over it
+  // the way LoadBalancerEncoder does.
+  QuicConnectionId routable = QuicUtils::CreateReplacementConnectionId(
+      connection_id, config_.total_len());
+  char* data = routable.mutable_data();
+  data[0] = static_cast<char>((config_.config_id() << kConfigIdShift) |
+                              (config_.total_len() - 1));
+  LoadBalancerServerId server_id = ServerIdForSocket(socket_index);
+  memcpy(data + 1, server_id.data().data(), server_id.length());
+  QUICHE_DCHECK_EQ(SocketIndexForConnectionId(routable), socket_index);
+  return routable;
+}
+
+bool QuicReuseportSteering::AttachToSocket(QuicUdpSocketFd fd) const {
+#if defined(__linux__)
+  // Mirrors SocketIndexForPacket(). The kernel runs the program on the UDP
+  // payload and uses its return value as the index of the socket in the
+  // reuseport group, falling back to the 4-tuple hash if it is out of range.
+  const uint32_t total_len = config_.total_len();
+  uint16_t key_load_size = BPF_B;
+  if (key_length() == 4) {
+    key_load_size = BPF_W;
+  } else if (key_length() == 2) {
+    key_load_size = BPF_H;
+  }
+  // Indices of the jump targets in the program below.
+  constexpr uint8_t kLongHeader = 4;
+  constexpr uint8_t kShortHeader = 10;
+  constexpr uint8_t kCheck = 13;
+  constexpr uint8_t kFallback = 19;
+  sock_filter program[] = {
+      // 0: X = packet length.
+      BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+      BPF_STMT(BPF_MISC | BPF_TAX, 0),
+      // 2: Branch on the header form.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+      BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, FLAGS_LONG_HEADER,
+               kLongHeader - 4, kShortHeader - 4),
+      // 4: Long header, X = offset of the connection ID.
+      BPF_STMT(BPF_MISC | BPF_TXA, 0),
+      BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K,
+               kLongHeaderConnectionIdOffset + total_len, 0, kFallback - 6),
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, kLongHeaderConnectionIdLengthOffset),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, total_len, 0, kFallback - 8),
+      BPF_STMT(BPF_LDX | BPF_W | BPF_IMM, kLongHeaderConnectionIdOffset),
+      BPF_STMT(BPF_JMP | BPF_JA, kCheck - 10),
+      // 10: Short header, X = offset of the connection ID.
+      BPF_STMT(BPF_MISC | BPF_TXA, 0),
+      BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K,
+               kShortHeaderConnectionIdOffset + total_len, 0, kFallback - 12),
+      BPF_STMT(BPF_LDX | BPF_W | BPF_IMM, kShortHeaderConnectionIdOffset),
+      // 13: Check the config ID.
+      BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),
+      BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, kConfigIdShift),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, config_.config_id(), 0,
+               kFallback - 16),
+      // 16: Return the server ID modulo the number of sockets.
+      BPF_STMT(BPF_LD | key_load_size | BPF_IND,
+               static_cast<uint32_t>(key_offset())),
+      BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(num_sockets_)),
+      BPF_STMT(BPF_RET | BPF_A, 0),
+      // 19: Fall back to the kernel's hash.
+      BPF_STMT(BPF_RET | BPF_K, kFallbackToHash),
+  };
+  static_assert(sizeof(program) / sizeof(program[0]) == kFallback + 1,
+                "Steering program jump targets are out of date");
+
+  sock_fprog fprog;
+  fprog.len = sizeof(program) / sizeof(program[0]);
+  fprog.filter = program;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog,
+                 sizeof(fprog)) != 0) {
+    QUIC_LOG_FIRST_N(ERROR, 10)
+        << "Failed to attach reuseport steering program: " << strerror(errno);
+    return false;
+  }
+  return true;
+#else
+  (void)fd;
+  QUIC_LOG_FIRST_N(ERROR, 10)
+      << "Reuseport steering is not supported on this platform.";
+  return false;
+#endif
+}
+
+}  // namespace quic
@@ -0,0 +1,88 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_REUSEPORT_STEERING_H_
+#define QUICHE_QUIC_CORE_QUIC_REUSEPORT_STEERING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "quiche/quic/core/quic_connection_id.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/load_balancer/load_balancer_config.h"
+#include "quiche/quic/load_balancer/load_balancer_server_id.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Steers packets arriving on a SO_REUSEPORT socket group to the socket that
+// owns their connection, using the server ID which LoadBalancerEncoder writes
+// into server connection IDs. Socket i of the group owns the connection IDs
+// whose server ID, read as a big-endian integer from its last (up to) four
+// bytes, is congruent to i modulo the number of sockets.
+//
+// Only unencrypted QUIC-LB configs can be steered on, since the server ID of an
+// encrypted config is not visible in the packet. Packets whose destination
+// connection ID is not routable under the config are left to the kernel's
+// default 4-tuple hash.
+class QUIC_EXPORT_PRIVATE QuicReuseportSteering {
+ public:
+  // Returns steering over |num_sockets| sockets for connection IDs encoded
+  // with |config|, or nullopt if |config| is encrypted or |num_sockets| is 0.
+  static absl::optional<QuicReuseportSteering> Create(
+      const LoadBalancerConfig& config, size_t num_sockets);
+
+  // Attaches a classic BPF program implementing this steering to the reuseport
+  // group of |fd|. All sockets must have joined the group, in socket index
+  // order, before packets are steered correctly. Returns false if the platform
+  // does not support reuseport BPF programs.
+  bool AttachToSocket(QuicUdpSocketFd fd) const;
+
+  // Returns the index of the socket which owns |connection_id|, or nullopt if
+  // it is not routable under the config.
+  absl::optional<size_t> SocketIndexForConnectionId(
+      const QuicConnectionId& connection_id) const;
+
+  // Returns the index of the socket which the attached program picks for
+  // |packet|, a UDP payload. Returns nullopt if the packet is left to the
+  // kernel's default hash.
+  absl::optional<size_t> SocketIndexForPacket(absl::string_view packet) const;
+
+  // Returns the server ID to configure the LoadBalancerEncoder of the owner of
+  // socket |socket_index| with.
+  LoadBalancerServerId ServerIdForSocket(size_t socket_index) const;
+
+  // Returns |connection_id| if it already routes to socket |socket_index|.
+  // Otherwise returns a connection ID of the same length which does, derived
+  // deterministically from |connection_id|. |connection_id| must be
+  // config.total_len() bytes long.
+  QuicConnectionId MakeRoutableConnectionId(
+      const QuicConnectionId& connection_id, size_t socket_index) const;
+
+  size_t num_sockets() const { return num_sockets_; }
+  const LoadBalancerConfig& config() const { return config_; }
+
+ private:
+  QuicReuseportSteering(const LoadBalancerConfig& config, size_t num_sockets);
+
+  // Offset of the server ID bytes steered on, relative to the start of the
+  // connection ID, and their number.
+  size_t key_offset() const;
+  size_t key_length() const;
+
+  // Returns the socket picked by the server ID bytes of |connection_id|, which
+  // must be at least config.total_len() bytes long, or nullopt if its config ID
+  // does not match.
+  absl::optional<size_t> SocketIndexForConnectionIdBytes(
+      absl::string_view connection_id) const;
+
+  LoadBalancerConfig config_;
+  size_t num_sockets_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_REUSEPORT_STEERING_H_
@@ -0,0 +1,175 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_reuseport_steering.h"
+
+#include <sys/socket.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/load_balancer/load_balancer_encoder.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr size_t kNumSockets = 3;
+constexpr uint8_t kConfigId = 1;
+
+std::string ShortHeaderPacket(const QuicConnectionId& connection_id) {
+  std::string packet(1, '\x40');
+  packet.append(connection_id.data(), connection_id.length());
+  packet.append(20, '\0');
+  return packet;
+}
+
+std::string LongHeaderPacket(const QuicConnectionId& connection_id) {
+  std::string packet = {'\xc0', '\0', '\0', '\0', '\x01'};
+  packet.push_back(static_cast<char>(connection_id.length()));
+  packet.append(connection_id.data(), connection_id.length());
+  packet.append(20, '\0');
+  return packet;
+}
+
+class QuicReuseportSteeringTest : public QuicTestWithParam<int> {
+ protected:
+  QuicReuseportSteeringTest()
+      : config_(*LoadBalancerConfig::CreateUnencrypted(
+            kConfigId, /*server_id_len=*/GetParam(), /*nonce_len=*/4)),
+        steering_(*QuicReuseportSteering::Create(config_, kNumSockets)) {}
+
+  // Returns a connection ID generated by a LoadBalancerEncoder configured with
+  // the server ID of socket |socket_index|.
+  QuicConnectionId GenerateConnectionId(size_t socket_index) {
+    absl::optional<LoadBalancerEncoder> encoder = LoadBalancerEncoder::Create(
+        *QuicRandom::GetInstance(), nullptr, /*len_self_encoded=*/true);
+    EXPECT_TRUE(encoder->UpdateConfig(
+        config_, steering_.ServerIdForSocket(socket_index)));
+    return encoder->GenerateConnectionId();
+  }
+
+  LoadBalancerConfig config_;
+  QuicReuseportSteering steering_;
+};
+
+INSTANTIATE_TEST_SUITE_P(ServerIdLengths, QuicReuseportSteeringTest,
+                         ::testing::Values(1, 2, 3, 4, 8),
+                         ::testing::PrintToStringParamName());
+
+TEST_P(QuicReuseportSteeringTest, EncryptedConfigIsRejected) {
+  absl::optional<LoadBalancerConfig> encrypted = LoadBalancerConfig::Create(
+      kConfigId, static_cast<uint8_t>(GetParam()), 4,
+      std::string(kLoadBalancerKeyLen, 'k'));
+  ASSERT_TRUE(encrypted.has_value());
+  EXPECT_FALSE(
+      QuicReuseportSteering::Create(*encrypted, kNumSockets).has_value());
+}
+
+TEST_P(QuicReuseportSteeringTest, EncodedConnectionIdsRouteToTheirSocket) {
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    QuicConnectionId connection_id = GenerateConnectionId(i);
+    EXPECT_EQ(i, steering_.SocketIndexForConnectionId(connection_id));
+    EXPECT_EQ(i, steering_.SocketIndexForPacket(
+                     ShortHeaderPacket(connection_id)));
+    EXPECT_EQ(i,
+              steering_.SocketIndexForPacket(LongHeaderPacket(connection_id)));
+  }
+}
+
+TEST_P(QuicReuseportSteeringTest, UnroutableConnectionIds) {
+  QuicConnectionId connection_id = GenerateConnectionId(1);
+  // Wrong config ID.
+  connection_id.mutable_data()[0] = '\xc0';
+  EXPECT_EQ(absl::nullopt, steering_.SocketIndexForConnectionId(connection_id));
+  EXPECT_EQ(absl::nullopt,
+            steering_.SocketIndexForPacket(ShortHeaderPacket(connection_id)));
+  // Wrong length.
+  EXPECT_EQ(absl::nullopt,
+            steering_.SocketIndexForConnectionId(TestConnectionId()));
+  EXPECT_EQ(absl::nullopt, steering_.SocketIndexForPacket(
+                               LongHeaderPacket(TestConnectionId())));
+  // Truncated packet.
+  EXPECT_EQ(absl::nullopt,
+            steering_.SocketIndexForPacket(
+                ShortHeaderPacket(GenerateConnectionId(1)).substr(0, 3)));
+  EXPECT_EQ(absl::nullopt, steering_.SocketIndexForPacket(absl::string_view()));
+}
+
+TEST_P(QuicReuseportSteeringTest, MakeRoutableConnectionId) {
+  QuicConnectionId connection_id = GenerateConnectionId(2);
+  EXPECT_EQ(connection_id,
+            steering_.MakeRoutableConnectionId(connection_id, 2));
+
+  QuicConnectionId routable =
+      steering_.MakeRoutableConnectionId(connection_id, 0);
+  EXPECT_NE(connection_id, routable);
+  EXPECT_EQ(config_.total_len(), routable.length());
+  EXPECT_EQ(0u, steering_.SocketIndexForConnectionId(routable));
+  // The result is deterministic.
+  EXPECT_EQ(routable, steering_.MakeRoutableConnectionId(connection_id, 0));
+}
+
+TEST_P(QuicReuseportSteeringTest, KernelSteersToOwningSocket) {
+  QuicUdpSocketApi socket_api;
+  QuicIpAddress localhost = QuicIpAddress::Loopback4();
+  std::vector<QuicUdpSocketFd> fds;
+  QuicSocketAddress server_address(localhost, 0);
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    QuicUdpSocketFd fd = socket_api.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                           kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, fd);
+    fds.push_back(fd);
+    ASSERT_TRUE(socket_api.EnableReusePort(fd));
+    ASSERT_TRUE(socket_api.Bind(fd, server_address));
+    if (i == 0) {
+      ASSERT_EQ(0, server_address.FromSocket(fd));
+    }
+  }
+  if (!steering_.AttachToSocket(fds[0])) {
+    // Reuseport BPF programs are not supported by the kernel running this test.
+    for (QuicUdpSocketFd fd : fds) {
+      socket_api.Destroy(fd);
+    }
+    return;
+  }
+
+  QuicUdpSocketFd client_fd = socket_api.Create(
+      AF_INET, kDefaultSocketReceiveBuffer, kDefaultSocketReceiveBuffer);
+  ASSERT_NE(kQuicInvalidSocketFd, client_fd);
+  QuicUdpPacketInfo packet_info;
+  packet_info.SetPeerAddress(server_address);
+  for (size_t i = 0; i < 2 * kNumSockets; ++i) {
+    const size_t expected_socket = i % kNumSockets;
+    const std::string packet =
+        (i < kNumSockets ? ShortHeaderPacket : LongHeaderPacket)(
+            GenerateConnectionId(expected_socket));
+    ASSERT_EQ(WRITE_STATUS_OK,
+              socket_api
+                  .WritePacket(client_fd, packet.data(), packet.size(),
+                               packet_info)
+                  .status);
+    ASSERT_TRUE(socket_api.WaitUntilReadable(fds[expected_socket],
+                                             QuicTime::Delta::FromSeconds(1)));
+    char buffer[1500];
+    EXPECT_EQ(static_cast<ssize_t>(packet.size()),
+              recv(fds[expected_socket], buffer, sizeof(buffer), 0));
+  }
+
+  socket_api.Destroy(client_fd);
+  for (QuicUdpSocketFd fd : fds) {
+    socket_api.Destroy(fd);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -8,6 +8,7 @@
 #include <cstddef>
 #include <string>
 
+#include "absl/types/span.h"
 #include "quiche/quic/core/congestion_control/general_loss_algorithm.h"
 #include "quiche/quic/core/congestion_control/pacing_sender.h"
 #include "quiche/quic/core/congestion_control/send_algorithm_interface.h"
@@ -513,9 +514,10 @@ void QuicSentPacketManager::MarkForRetransmission(
   QUICHE_DCHECK(!transmission_info->has_crypto_handshake ||
                 transmission_type != PROBING_RETRANSMISSION);
   if (ShouldForceRetransmission(transmission_type)) {
+    const absl::Span<const QuicFrame> frames =
+        transmission_info->retransmittable_frames();
     if (!unacked_packets_.RetransmitFrames(
-            QuicFrames(transmission_info->retransmittable_frames),
-            transmission_type)) {
+            QuicFrames(frames.begin(), frames.end()), transmission_type)) {
       // Do not set packet state if the data is not fully retransmitted.
       // This should only happen if packet payload size decreases which can be
       // caused by:
@@ -531,16 +533,18 @@ void QuicSentPacketManager::MarkForRetransmission(
   } else {
     unacked_packets_.NotifyFramesLost(*transmission_info, transmission_type);
 
-    if (!transmission_info->retransmittable_frames.empty()) {
+    if (!transmission_info->retransmittable_frames().empty()) {
       if (transmission_type == LOSS_RETRANSMISSION) {
         // Record the first packet sent after loss, which allows to wait 1
         // more RTT before giving up on this lost packet.
-        transmission_info->first_sent_after_loss =
+        unacked_packets_.GetMutableColdTransmissionInfo(packet_number)
+            ->first_sent_after_loss =
             unacked_packets_.largest_sent_packet() + 1;
       } else {
         // Clear the recorded first packet sent after loss when version or
         // encryption changes.
-        transmission_info->first_sent_after_loss.Clear();
+        unacked_packets_.GetMutableColdTransmissionInfo(packet_number)
+            ->first_sent_after_loss.Clear();
       }
     }
   }
@@ -571,7 +575,7 @@ void QuicSentPacketManager::MarkPacketHandled(QuicPacketNumber packet_number,
                                               QuicTime::Delta ack_delay_time,
                                               QuicTime receive_timestamp) {
   if (info->has_ack_frequency) {
-    for (const auto& frame : info->retransmittable_frames) {
+    for (const auto& frame : info->retransmittable_frames()) {
       if (frame.type == ACK_FREQUENCY_FRAME) {
         OnAckFrequencyFrameAcked(*frame.ack_frequency_frame);
       }
@@ -620,7 +624,7 @@ void QuicSentPacketManager::MarkPacketHandled(QuicPacketNumber packet_number,
     network_change_visitor_->OnPathMtuIncreased(largest_mtu_acked_);
   }
   unacked_packets_.RemoveFromInFlight(info);
-  unacked_packets_.RemoveRetransmittability(info);
+  unacked_packets_.RemoveRetransmittability(packet_number, info);
   info->state = ACKED;
 }
 
@@ -1314,10 +1318,13 @@ AckResult QuicSentPacketManager::OnAckFrameEnd(
     } else if (info->encryption_level == ENCRYPTION_FORWARD_SECURE) {
       one_rtt_packet_acked_ = true;
     }
-    largest_packet_peer_knows_is_acked_.UpdateMax(info->largest_acked);
+    const QuicPacketNumber largest_acked_in_packet =
+        unacked_packets_.GetColdTransmissionInfo(acked_packet.packet_number)
+            .largest_acked;
+    largest_packet_peer_knows_is_acked_.UpdateMax(largest_acked_in_packet);
     if (supports_multiple_packet_number_spaces()) {
       largest_packets_peer_knows_is_acked_[packet_number_space].UpdateMax(
-          info->largest_acked);
+          largest_acked_in_packet);
     }
     // If data is associated with the most recent transmission of this
     // packet, then inform the caller.
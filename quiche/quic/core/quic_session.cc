@@ -777,6 +777,12 @@ void QuicSession::ProcessUdpPacket(const QuicSocketAddress& self_address,
   connection_->ProcessUdpPacket(self_address, peer_address, packet);
 }
 
+size_t QuicSession::ProcessUdpPackets(
+    absl::Span<const ReceivedUdpPacket> packets) {
+  QuicConnectionContextSwitcher cs(connection_->context());
+  return connection_->ProcessUdpPackets(packets);
+}
+
 QuicConsumedData QuicSession::WritevData(QuicStreamId id, size_t write_length,
                                          QuicStreamOffset offset,
                                          StreamSendingState state,
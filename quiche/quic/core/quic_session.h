@@ -206,6 +206,12 @@ class QUIC_EXPORT_PRIVATE QuicSession
                                 const QuicSocketAddress& peer_address,
                                 const QuicReceivedPacket& packet);
 
+  // Passes a batch of incoming packets through to |connection_|, which decides
+  // on acks and writes once for the whole batch. Returns the number of packets
+  // processed, which is less than |packets.size()| if the connection was
+  // closed part way through.
+  virtual size_t ProcessUdpPackets(absl::Span<const ReceivedUdpPacket> packets);
+
   // Sends |message| as a QUIC DATAGRAM frame (QUIC MESSAGE frame in gQUIC).
   // See <https://datatracker.ietf.org/doc/html/draft-ietf-quic-datagram> for
   // more details.
@@ -0,0 +1,144 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_session_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/common/platform/api/quiche_prefetch.h"
+
+namespace quic {
+
+namespace {
+
+const size_t kInitialCapacity = 16;
+const int kInitialShift = 60;  // 64 - log2(kInitialCapacity)
+
+// Odd constant of Fibonacci hashing, 2^64 divided by the golden ratio.
+const uint64_t kMultiplier = UINT64_C(0x9e3779b97f4a7c15);
+
+}  // namespace
+
+QuicSessionTable::QuicSessionTable(uint8_t connection_id_length,
+                                   QuicRandom* random)
+    : connection_id_length_(connection_id_length),
+      seed_(random->RandUint64()),
+      slots_(kInitialCapacity),
+      shift_(kInitialShift),
+      size_(0) {
+  static_assert(sizeof(Slot) == 32 && alignof(Slot) == 32,
+                "Slots should not straddle cache lines");
+  QUIC_BUG_IF(quic_session_table_bad_length,
+              connection_id_length == 0 ||
+                  connection_id_length >
+                      kQuicMaxConnectionIdWithLengthPrefixLength)
+      << "Invalid connection ID length "
+      << static_cast<int>(connection_id_length);
+}
+
+bool QuicSessionTable::Insert(const QuicConnectionId& connection_id,
+                              QuicSession* session) {
+  if (!Handles(connection_id) || session == nullptr) {
+    return false;
+  }
+  if ((size_ + 1) * 4 > slots_.size() * 3) {
+    Grow();
+  }
+  Slot& slot = slots_[FindSlot(connection_id.data())];
+  if (slot.session != nullptr) {
+    return false;
+  }
+  memcpy(slot.connection_id, connection_id.data(), connection_id_length_);
+  slot.session = session;
+  ++size_;
+  return true;
+}
+
+bool QuicSessionTable::Erase(const QuicConnectionId& connection_id) {
+  if (!Handles(connection_id)) {
+    return false;
+  }
+  size_t hole = FindSlot(connection_id.data());
+  if (slots_[hole].session == nullptr) {
+    return false;
+  }
+  // Shifts the rest of the probe sequence back, so that lookups never need to
+  // skip over deleted entries.
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = (hole + 1) & mask; slots_[i].session != nullptr;
+       i = (i + 1) & mask) {
+    const size_t home = HomeSlot(slots_[i].connection_id);
+    // The entry at |i| can fill the hole if the hole is on its probe sequence,
+    // i.e. between its home slot and |i|.
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots_[hole] = slots_[i];
+      hole = i;
+    }
+  }
+  slots_[hole].session = nullptr;
+  --size_;
+  return true;
+}
+
+QuicSession* QuicSessionTable::Find(
+    const QuicConnectionId& connection_id) const {
+  if (!Handles(connection_id)) {
+    return nullptr;
+  }
+  return slots_[FindSlot(connection_id.data())].session;
+}
+
+void QuicSessionTable::Prefetch(const QuicConnectionId& connection_id) const {
+  if (!Handles(connection_id)) {
+    return;
+  }
+  quiche::QuichePrefetchT0(&slots_[HomeSlot(connection_id.data())]);
+}
+
+void QuicSessionTable::Clear() {
+  for (Slot& slot : slots_) {
+    slot.session = nullptr;
+  }
+  size_ = 0;
+}
+
+size_t QuicSessionTable::HomeSlot(const char* connection_id) const {
+  uint64_t hash = seed_;
+  for (size_t offset = 0; offset < connection_id_length_; offset += 8) {
+    uint64_t word = 0;
+    memcpy(&word, connection_id + offset,
+           std::min<size_t>(8, connection_id_length_ - offset));
+    hash = (hash ^ word) * kMultiplier;
+  }
+  // The high bits of a product depend on all bits of its factors.
+  return static_cast<size_t>(hash >> shift_);
+}
+
+size_t QuicSessionTable::FindSlot(const char* connection_id) const {
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = HomeSlot(connection_id);; i = (i + 1) & mask) {
+    const Slot& slot = slots_[i];
+    if (slot.session == nullptr ||
+        memcmp(slot.connection_id, connection_id, connection_id_length_) ==
+            0) {
+      return i;
+    }
+  }
+}
+
+void QuicSessionTable::Grow() {
+  std::vector<Slot> old_slots(slots_.size() * 2);
+  old_slots.swap(slots_);
+  --shift_;
+  for (const Slot& slot : old_slots) {
+    if (slot.session != nullptr) {
+      slots_[FindSlot(slot.connection_id)] = slot;
+    }
+  }
+}
+
+}  // namespace quic
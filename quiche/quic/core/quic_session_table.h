@@ -0,0 +1,98 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_SESSION_TABLE_H_
+#define QUICHE_QUIC_CORE_QUIC_SESSION_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/quic_connection_id.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+class QuicSession;
+
+// Maps server connection IDs of one fixed length to sessions, for the
+// dispatcher to find the session of a packet in as few cache misses as
+// possible.
+//
+// Connection IDs are stored inline in a flat, linearly probed array, so that a
+// lookup usually touches a single cache line, which Prefetch() can bring in
+// ahead of time. Server connection IDs, whether random or encoded by a
+// LoadBalancerEncoder, are nearly uniformly random, so they are hashed with a
+// multiply per word instead of SipHash. The multiplication is seeded per table,
+// so that clients cannot choose connection IDs which collide.
+//
+// The table does not own sessions. Connection IDs of any other length are
+// ignored, so that the table can index the connection IDs of one length of a
+// map which also holds others.
+class QUIC_EXPORT_PRIVATE QuicSessionTable {
+ public:
+  // |connection_id_length| must be between 1 and
+  // kQuicMaxConnectionIdWithLengthPrefixLength.
+  QuicSessionTable(uint8_t connection_id_length, QuicRandom* random);
+  QuicSessionTable(const QuicSessionTable&) = delete;
+  QuicSessionTable& operator=(const QuicSessionTable&) = delete;
+
+  // Returns true if connection IDs of the length of |connection_id| are kept
+  // in this table.
+  bool Handles(const QuicConnectionId& connection_id) const {
+    return connection_id.length() == connection_id_length_;
+  }
+
+  // Maps |connection_id| to |session|. Returns false, changing nothing, if
+  // |connection_id| is already mapped or not handled.
+  bool Insert(const QuicConnectionId& connection_id, QuicSession* session);
+
+  // Removes |connection_id|. Returns false if it was not mapped.
+  bool Erase(const QuicConnectionId& connection_id);
+
+  // Returns the session |connection_id| is mapped to, or nullptr.
+  QuicSession* Find(const QuicConnectionId& connection_id) const;
+
+  // Starts loading the slot Find(|connection_id|) looks at first into the
+  // cache.
+  void Prefetch(const QuicConnectionId& connection_id) const;
+
+  void Clear();
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  // 32 bytes and aligned to 32 bytes, so that slots do not straddle cache
+  // lines. The alignment carries over to |slots_| through aligned new.
+  struct alignas(32) Slot {
+    char connection_id[kQuicMaxConnectionIdWithLengthPrefixLength];
+    // nullptr if the slot is empty.
+    QuicSession* session;
+  };
+
+  // Returns the slot at which a lookup of |connection_id| starts.
+  size_t HomeSlot(const char* connection_id) const;
+
+  // Returns the index of the slot holding |connection_id|, or of the empty slot
+  // which ends its probe sequence.
+  size_t FindSlot(const char* connection_id) const;
+
+  // Doubles the number of slots, reinserting every entry.
+  void Grow();
+
+  const uint8_t connection_id_length_;
+  const uint64_t seed_;
+  // A power of two number of slots, kept at most 3/4 full.
+  std::vector<Slot> slots_;
+  // Right shift which takes a hash to an index into |slots_|.
+  int shift_;
+  size_t size_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_SESSION_TABLE_H_
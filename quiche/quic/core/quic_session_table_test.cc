@@ -0,0 +1,115 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_session_table.h"
+
+#include <cstdint>
+
+#include "absl/container/flat_hash_map.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_random.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+// Returns a connection ID of |length| bytes ending with |number|.
+QuicConnectionId ConnectionId(uint64_t number, uint8_t length = 8) {
+  char bytes[kQuicMaxConnectionIdWithLengthPrefixLength] = {};
+  for (uint8_t i = 0; i < length && i < 8; ++i) {
+    bytes[length - 1 - i] = static_cast<char>(number >> (8 * i));
+  }
+  return QuicConnectionId(bytes, length);
+}
+
+// The table never dereferences sessions.
+QuicSession* Session(uintptr_t number) {
+  return reinterpret_cast<QuicSession*>((number + 1) * alignof(void*));
+}
+
+class QuicSessionTableTest : public QuicTest {
+ protected:
+  MockRandom random_;
+};
+
+TEST_F(QuicSessionTableTest, InsertFindErase) {
+  QuicSessionTable table(8, &random_);
+  EXPECT_TRUE(table.empty());
+  EXPECT_EQ(nullptr, table.Find(ConnectionId(1)));
+
+  EXPECT_TRUE(table.Insert(ConnectionId(1), Session(1)));
+  EXPECT_TRUE(table.Insert(ConnectionId(2), Session(1)));
+  EXPECT_FALSE(table.Insert(ConnectionId(1), Session(2)));
+  EXPECT_EQ(2u, table.size());
+  EXPECT_EQ(Session(1), table.Find(ConnectionId(1)));
+  EXPECT_EQ(Session(1), table.Find(ConnectionId(2)));
+  table.Prefetch(ConnectionId(1));
+
+  EXPECT_TRUE(table.Erase(ConnectionId(1)));
+  EXPECT_FALSE(table.Erase(ConnectionId(1)));
+  EXPECT_EQ(nullptr, table.Find(ConnectionId(1)));
+  EXPECT_EQ(Session(1), table.Find(ConnectionId(2)));
+  EXPECT_EQ(1u, table.size());
+
+  table.Clear();
+  EXPECT_TRUE(table.empty());
+  EXPECT_EQ(nullptr, table.Find(ConnectionId(2)));
+}
+
+TEST_F(QuicSessionTableTest, IgnoresOtherLengths) {
+  QuicSessionTable table(8, &random_);
+  EXPECT_FALSE(table.Handles(ConnectionId(1, 4)));
+  EXPECT_FALSE(table.Insert(ConnectionId(1, 4), Session(1)));
+  EXPECT_FALSE(table.Insert(EmptyQuicConnectionId(), Session(1)));
+  EXPECT_TRUE(table.Insert(ConnectionId(1, 8), Session(2)));
+  EXPECT_EQ(nullptr, table.Find(ConnectionId(1, 4)));
+  EXPECT_FALSE(table.Erase(ConnectionId(1, 4)));
+  table.Prefetch(ConnectionId(1, 20));
+  EXPECT_EQ(Session(2), table.Find(ConnectionId(1, 8)));
+  EXPECT_EQ(1u, table.size());
+}
+
+TEST_F(QuicSessionTableTest, LongConnectionIds) {
+  QuicSessionTable table(kQuicMaxConnectionIdWithLengthPrefixLength, &random_);
+  char bytes[kQuicMaxConnectionIdWithLengthPrefixLength] = {};
+  QuicConnectionId first(bytes, sizeof(bytes));
+  // Differs from |first| only in bytes past the first two words.
+  bytes[sizeof(bytes) - 1] = 1;
+  QuicConnectionId last(bytes, sizeof(bytes));
+  EXPECT_TRUE(table.Insert(first, Session(1)));
+  EXPECT_TRUE(table.Insert(last, Session(2)));
+  EXPECT_EQ(Session(1), table.Find(first));
+  EXPECT_EQ(Session(2), table.Find(last));
+}
+
+// Checks the table against a map through growth and many erasures, which
+// shift probe sequences around.
+TEST_F(QuicSessionTableTest, MatchesMap) {
+  QuicSessionTable table(8, &random_);
+  absl::flat_hash_map<uint64_t, uintptr_t> map;
+  uint64_t state = 1;
+  for (int i = 0; i < 20000; ++i) {
+    // Draws from a small range, so that inserts and erases of present and
+    // absent connection IDs are all common.
+    state = state * 6364136223846793005u + 1442695040888963407u;
+    const uint64_t number = (state >> 33) % 2048;
+    if ((state >> 20) % 3 == 0) {
+      EXPECT_EQ(map.erase(number) == 1, table.Erase(ConnectionId(number)));
+    } else {
+      EXPECT_EQ(map.emplace(number, i).second,
+                table.Insert(ConnectionId(number), Session(i)));
+    }
+    ASSERT_EQ(map.size(), table.size());
+  }
+  EXPECT_LE(table.size() * 4, table.capacity() * 3);
+  for (uint64_t number = 0; number < 2048; ++number) {
+    auto it = map.find(number);
+    EXPECT_EQ(it == map.end() ? nullptr : Session(it->second),
+              table.Find(ConnectionId(number)));
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
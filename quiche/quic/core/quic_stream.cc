@@ -132,7 +132,10 @@ PendingStream::PendingStream(QuicStreamId id, QuicSession* session)
                        kStreamReceiveWindowLimit,
                        session->flow_controller()->auto_tune_receive_window(),
                        session->flow_controller()),
-      sequencer_(this) {}
+      sequencer_(this) {
+  sequencer_.set_block_pool(
+      session->connection()->helper()->GetStreamSequencerBufferBlockPool());
+}
 
 void PendingStream::OnDataAvailable() {
   // Data should be kept in the sequencer so that
@@ -330,7 +333,10 @@ QuicStream::QuicStream(QuicStreamId id, QuicSession* session, bool is_static,
                        StreamType type)
     : QuicStream(id, session, QuicStreamSequencer(this), is_static, type, 0,
                  false, FlowController(id, session, type),
-                 session->flow_controller()) {}
+                 session->flow_controller()) {
+  sequencer_.set_block_pool(
+      session->connection()->helper()->GetStreamSequencerBufferBlockPool());
+}
 
 QuicStream::QuicStream(QuicStreamId id, QuicSession* session,
                        QuicStreamSequencer sequencer, bool is_static,
@@ -357,6 +363,7 @@ QuicStream::QuicStream(QuicStreamId id, QuicSession* session,
       rst_sent_(false),
       rst_received_(false),
       stop_sending_sent_(false),
+      uses_received_packet_buffers_(false),
       flow_controller_(std::move(flow_controller)),
       connection_flow_controller_(connection_flow_controller),
       stream_contributes_to_connection_flow_control_(true),
@@ -484,7 +491,24 @@ void QuicStream::OnStreamFrame(const QuicStreamFrame& frame) {
     }
   }
 
-  sequencer_.OnStreamFrame(frame);
+  sequencer_.OnStreamFrame(
+      frame,
+      session_->connection()->framer().current_received_packet_buffer());
+}
+
+void QuicStream::DeliverInOrderDataAsSlices(
+    QuicStreamSequencer::SliceVisitor* visitor) {
+  const bool use_received_packet_buffers =
+      visitor != nullptr && !read_side_closed_;
+  if (use_received_packet_buffers != uses_received_packet_buffers_) {
+    if (use_received_packet_buffers) {
+      session_->connection()->AddReceivedPacketBufferUser();
+    } else {
+      session_->connection()->RemoveReceivedPacketBufferUser();
+    }
+    uses_received_packet_buffers_ = use_received_packet_buffers;
+  }
+  sequencer_.set_slice_visitor(visitor);
 }
 
 bool QuicStream::OnStopSending(QuicResetStreamError error) {
@@ -832,6 +856,7 @@ void QuicStream::CloseReadSide() {
 
   read_side_closed_ = true;
   sequencer_.ReleaseBuffer();
+  DeliverInOrderDataAsSlices(nullptr);
 
   if (write_side_closed_) {
     QUIC_DVLOG(1) << ENDPOINT << "Closing stream " << id();
@@ -476,6 +476,19 @@ class QUIC_EXPORT_PRIVATE QuicStream
   const QuicStreamSequencer* sequencer() const { return &sequencer_; }
   QuicStreamSequencer* sequencer() { return &sequencer_; }
 
+  // Makes data which arrives in order be passed to |visitor| as slices of the
+  // decrypted packet rather than copied into the sequencer. Only meant for
+  // streams which consume their data as is, not through a decoder reading
+  // from the sequencer. A nullptr |visitor| goes back to copying.
+  //
+  // While any stream of the connection delivers data as slices, the
+  // connection decrypts all of its packets into heap-allocated,
+  // reference-counted buffers rather than a buffer on the stack, and a packet
+  // stays in memory for as long as a slice of it is held. It goes back to the
+  // stack buffer once every such stream has passed nullptr or closed its read
+  // side.
+  void DeliverInOrderDataAsSlices(QuicStreamSequencer::SliceVisitor* visitor);
+
   void DisableConnectionFlowControlForThisStream() {
     stream_contributes_to_connection_flow_control_ = false;
   }
@@ -576,6 +589,10 @@ class QUIC_EXPORT_PRIVATE QuicStream
   // True if the stream has sent STOP_SENDING to the session.
   bool stop_sending_sent_;
 
+  // True if DeliverInOrderDataAsSlices() has made the connection use received
+  // packet buffers on behalf of this stream.
+  bool uses_received_packet_buffers_;
+
   absl::optional<QuicFlowController> flow_controller_;
 
   // The connection level flow controller. Not owned.
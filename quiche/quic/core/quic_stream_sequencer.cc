@@ -15,6 +15,7 @@
 #include "quiche/quic/core/quic_clock.h"
 #include "quiche/quic/core/quic_error_codes.h"
 #include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_received_packet_buffer.h"
 #include "quiche/quic/core/quic_stream.h"
 #include "quiche/quic/core/quic_stream_sequencer_buffer.h"
 #include "quiche/quic/core/quic_types.h"
@@ -36,7 +37,8 @@ QuicStreamSequencer::QuicStreamSequencer(StreamInterface* quic_stream)
       num_frames_received_(0),
       num_duplicate_frames_received_(0),
       ignore_read_data_(false),
-      level_triggered_(false) {}
+      level_triggered_(false),
+      slice_visitor_(nullptr) {}
 
 QuicStreamSequencer::~QuicStreamSequencer() {
   if (stream_ == nullptr) {
@@ -47,6 +49,11 @@ QuicStreamSequencer::~QuicStreamSequencer() {
 }
 
 void QuicStreamSequencer::OnStreamFrame(const QuicStreamFrame& frame) {
+  OnStreamFrame(frame, /*packet_buffer=*/nullptr);
+}
+
+void QuicStreamSequencer::OnStreamFrame(
+    const QuicStreamFrame& frame, QuicReceivedPacketBuffer* packet_buffer) {
   QUICHE_DCHECK_LE(frame.offset + frame.data_length, close_offset_);
   ++num_frames_received_;
   const QuicStreamOffset byte_offset = frame.offset;
@@ -61,7 +68,7 @@ void QuicStreamSequencer::OnStreamFrame(const QuicStreamFrame& frame) {
     // Ignore empty frame with no fin.
     return;
   }
-  OnFrameData(byte_offset, data_len, frame.data_buffer);
+  OnFrameData(byte_offset, data_len, frame.data_buffer, packet_buffer);
 }
 
 void QuicStreamSequencer::OnCryptoFrame(const QuicCryptoFrame& frame) {
@@ -70,13 +77,17 @@ void QuicStreamSequencer::OnCryptoFrame(const QuicCryptoFrame& frame) {
     // Ignore empty crypto frame.
     return;
   }
-  OnFrameData(frame.offset, frame.data_length, frame.data_buffer);
+  OnFrameData(frame.offset, frame.data_length, frame.data_buffer,
+              /*packet_buffer=*/nullptr);
 }
 
-void QuicStreamSequencer::OnFrameData(QuicStreamOffset byte_offset,
-                                      size_t data_len,
-                                      const char* data_buffer) {
+void QuicStreamSequencer::OnFrameData(
+    QuicStreamOffset byte_offset, size_t data_len, const char* data_buffer,
+    QuicReceivedPacketBuffer* packet_buffer) {
   highest_offset_ = std::max(highest_offset_, byte_offset + data_len);
+  if (MaybeDeliverSlice(byte_offset, data_len, data_buffer, packet_buffer)) {
+    return;
+  }
   const size_t previous_readable_bytes = buffered_frames_.ReadableBytes();
   size_t bytes_written;
   std::string error_details;
@@ -126,6 +137,31 @@ void QuicStreamSequencer::OnFrameData(QuicStreamOffset byte_offset,
   }
 }
 
+bool QuicStreamSequencer::MaybeDeliverSlice(
+    QuicStreamOffset byte_offset, size_t data_len, const char* data_buffer,
+    QuicReceivedPacketBuffer* packet_buffer) {
+  if (slice_visitor_ == nullptr || packet_buffer == nullptr || blocked_ ||
+      ignore_read_data_ || buffered_frames_.BytesBuffered() != 0) {
+    return false;
+  }
+  // Out of order and duplicate data are left to the buffer.
+  const QuicStreamOffset bytes_consumed = buffered_frames_.BytesConsumed();
+  if (byte_offset > bytes_consumed ||
+      byte_offset + data_len <= bytes_consumed ||
+      !packet_buffer->Contains(absl::string_view(data_buffer, data_len))) {
+    return false;
+  }
+
+  const size_t bytes_already_consumed = bytes_consumed - byte_offset;
+  const size_t bytes_to_deliver = data_len - bytes_already_consumed;
+  buffered_frames_.ConsumeUnbufferedData(bytes_to_deliver);
+  slice_visitor_->OnDataSlice(packet_buffer->MakeSlice(absl::string_view(
+      data_buffer + bytes_already_consumed, bytes_to_deliver)));
+  stream_->AddBytesConsumed(bytes_to_deliver);
+  MaybeCloseStream();
+  return true;
+}
+
 bool QuicStreamSequencer::CloseStreamAtOffset(QuicStreamOffset offset) {
   const QuicStreamOffset kMaxOffset =
       std::numeric_limits<QuicStreamOffset>::max();
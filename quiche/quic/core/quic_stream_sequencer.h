@@ -13,6 +13,7 @@
 #include "quiche/quic/core/quic_stream_sequencer_buffer.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
 
 namespace quic {
 
@@ -20,6 +21,8 @@ namespace test {
 class QuicStreamSequencerPeer;
 }  // namespace test
 
+class QuicReceivedPacketBuffer;
+
 // Buffers frames until we have something which can be passed
 // up to the next layer.
 class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
@@ -54,6 +57,17 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
     virtual ParsedQuicVersion version() const = 0;
   };
 
+  // Receives in-order data without it being copied into the sequencer. See
+  // set_slice_visitor().
+  class QUIC_EXPORT_PRIVATE SliceVisitor {
+   public:
+    virtual ~SliceVisitor() = default;
+
+    // Called with received data which immediately follows all data consumed
+    // so far. The data counts as consumed once this returns.
+    virtual void OnDataSlice(quiche::QuicheMemSlice slice) = 0;
+  };
+
   explicit QuicStreamSequencer(StreamInterface* quic_stream);
   QuicStreamSequencer(const QuicStreamSequencer&) = delete;
   QuicStreamSequencer(QuicStreamSequencer&&) = default;
@@ -68,6 +82,13 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
   // buffered.
   void OnStreamFrame(const QuicStreamFrame& frame);
 
+  // Same as above, for a frame whose data may lie in |packet_buffer|, which
+  // may be null. If there is a slice visitor and the data does lie in
+  // |packet_buffer|, data which is next in order is passed to the visitor as a
+  // slice of |packet_buffer| instead of being buffered.
+  void OnStreamFrame(const QuicStreamFrame& frame,
+                     QuicReceivedPacketBuffer* packet_buffer);
+
   // If the frame is the next one we need in order to process in-order data,
   // ProcessData will be immediately called on the crypto stream until all
   // buffered data is processed or the crypto stream fails to consume data. Any
@@ -157,6 +178,19 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
 
   void set_stream(StreamInterface* stream) { stream_ = stream; }
 
+  // If |visitor| is not null, in-order data of frames received in a
+  // QuicReceivedPacketBuffer is passed to it rather than buffered, as long as
+  // the sequencer is not blocked, not ignoring data and has no data buffered.
+  // Data received out of order is buffered, and is read as usual once
+  // OnDataAvailable() reports it readable.
+  void set_slice_visitor(SliceVisitor* visitor) { slice_visitor_ = visitor; }
+
+  // Makes the buffer draw its blocks from |block_pool|, which may be null. Must
+  // be called before any data is buffered.
+  void set_block_pool(QuicStreamSequencerBufferBlockPool* block_pool) {
+    buffered_frames_.set_block_pool(block_pool);
+  }
+
   // Returns string describing internal state.
   const std::string DebugString() const;
 
@@ -178,7 +212,14 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
 
   // Shared implementation between OnStreamFrame and OnCryptoFrame.
   void OnFrameData(QuicStreamOffset byte_offset, size_t data_len,
-                   const char* data_buffer);
+                   const char* data_buffer,
+                   QuicReceivedPacketBuffer* packet_buffer);
+
+  // Passes the part of the frame data which is next in order to
+  // |slice_visitor_|, if possible. Returns true if it did.
+  bool MaybeDeliverSlice(QuicStreamOffset byte_offset, size_t data_len,
+                         const char* data_buffer,
+                         QuicReceivedPacketBuffer* packet_buffer);
 
   // The stream which owns this sequencer.
   StreamInterface* stream_;
@@ -209,6 +250,9 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
   // If false, only call OnDataAvailable() when it becomes newly unblocked.
   // Otherwise, call OnDataAvailable() when number of readable bytes changes.
   bool level_triggered_;
+
+  // If not null, receives in-order data which does not need to be buffered.
+  SliceVisitor* slice_visitor_;
 };
 
 }  // namespace quic
@@ -13,6 +13,7 @@
 #include "absl/strings/string_view.h"
 #include "quiche/quic/core/quic_constants.h"
 #include "quiche/quic/core/quic_interval.h"
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
 #include "quiche/quic/platform/api/quic_bug_tracker.h"
 #include "quiche/quic/platform/api/quic_flag_utils.h"
 #include "quiche/quic/platform/api/quic_flags.h"
@@ -45,7 +46,8 @@ QuicStreamSequencerBuffer::QuicStreamSequencerBuffer(size_t max_capacity_bytes)
       max_blocks_count_(CalculateBlockCount(max_capacity_bytes)),
       current_blocks_count_(0u),
       total_bytes_read_(0),
-      blocks_(nullptr) {
+      blocks_(nullptr),
+      block_pool_(nullptr) {
   QUICHE_DCHECK_GE(max_blocks_count_, kInitialBlockCount);
   Clear();
 }
@@ -70,7 +72,11 @@ bool QuicStreamSequencerBuffer::RetireBlock(size_t index) {
     QUIC_BUG(quic_bug_10610_1) << "Try to retire block twice";
     return false;
   }
-  delete blocks_[index];
+  if (block_pool_ != nullptr) {
+    block_pool_->Release(blocks_[index]);
+  } else {
+    delete blocks_[index];
+  }
   blocks_[index] = nullptr;
   QUIC_DVLOG(1) << "Retired block with index: " << index;
   return true;
@@ -217,9 +223,10 @@ bool QuicStreamSequencerBuffer::CopyStreamData(QuicStreamOffset offset,
       return false;
     }
     if (blocks_[write_block_num] == nullptr) {
-      // TODO(danzh): Investigate if using a freelist would improve performance.
       // Same as RetireBlock().
-      blocks_[write_block_num] = new BufferBlock();
+      blocks_[write_block_num] = block_pool_ != nullptr
+                                     ? block_pool_->Acquire()
+                                     : new BufferBlock();
     }
 
     const size_t bytes_to_copy =
@@ -430,12 +437,33 @@ size_t QuicStreamSequencerBuffer::FlushBufferedFrames() {
   return total_bytes_read_ - prev_total_bytes_read;
 }
 
+void QuicStreamSequencerBuffer::ConsumeUnbufferedData(size_t length) {
+  QUICHE_DCHECK_EQ(0u, num_bytes_buffered_);
+  // With nothing buffered, the only block which can still be allocated is the
+  // one in which the consumed data ends. Retire it once it has been passed.
+  const size_t block_index = NextBlockToRead();
+  if (block_index < current_blocks_count_ && blocks_[block_index] != nullptr &&
+      GetInBlockOffset(total_bytes_read_) + length >=
+          GetBlockCapacity(block_index)) {
+    RetireBlock(block_index);
+  }
+  bytes_received_.AddOptimizedForAppend(total_bytes_read_,
+                                        total_bytes_read_ + length);
+  total_bytes_read_ += length;
+}
+
 void QuicStreamSequencerBuffer::ReleaseWholeBuffer() {
   Clear();
   current_blocks_count_ = 0;
   blocks_.reset(nullptr);
 }
 
+void QuicStreamSequencerBuffer::set_block_pool(
+    QuicStreamSequencerBufferBlockPool* block_pool) {
+  QUICHE_DCHECK(blocks_ == nullptr);
+  block_pool_ = block_pool;
+}
+
 size_t QuicStreamSequencerBuffer::ReadableBytes() const {
   return FirstMissingByte() - total_bytes_read_;
 }
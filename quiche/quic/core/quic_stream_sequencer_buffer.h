@@ -77,6 +77,8 @@ namespace test {
 class QuicStreamSequencerBufferPeer;
 }  // namespace test
 
+class QuicStreamSequencerBufferBlockPool;
+
 class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
  public:
   // Size of blocks used by this buffer.
@@ -144,6 +146,11 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   // (To be called only after sequencer's StopReading has been called.)
   size_t FlushBufferedFrames();
 
+  // Records the |length| bytes following the consumed data as received and
+  // consumed, for data which is delivered without being buffered. No data may
+  // be buffered.
+  void ConsumeUnbufferedData(size_t length);
+
   // Free the memory of buffered data.
   void ReleaseWholeBuffer();
 
@@ -159,6 +166,11 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   // Returns number of bytes available to be read out.
   size_t ReadableBytes() const;
 
+  // Makes the buffer take blocks from and return them to |block_pool| instead
+  // of allocating and freeing them. |block_pool| must outlive the buffer, and
+  // must be set before any data is buffered.
+  void set_block_pool(QuicStreamSequencerBufferBlockPool* block_pool);
+
  private:
   friend class test::QuicStreamSequencerBufferPeer;
 
@@ -234,6 +246,9 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
 
   // Currently received data.
   QuicIntervalSet<QuicStreamOffset> bytes_received_;
+
+  // If not null, blocks are acquired from and released to this pool.
+  QuicStreamSequencerBufferBlockPool* block_pool_;
 };
 
 }  // namespace quic
@@ -0,0 +1,80 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures QuicStreamSequencerBuffer buffering stream frames and reading them
+// out, for frames which arrive in order and frames which arrive in reverse
+// order within a window, with and without a block pool.
+
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/quic_error_codes.h"
+#include "quiche/quic/core/quic_stream_sequencer_buffer.h"
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
+#include "quiche/quic/core/quic_types.h"
+
+namespace quic {
+namespace {
+
+constexpr size_t kFrameSize = 1200;
+constexpr size_t kMaxCapacity = 16 * 1024 * 1024;
+
+// Buffers |frames_per_read| frames, then reads all of them. If |reverse| is
+// true, the frames of each group are delivered last to first. Blocks are taken
+// from |block_pool| if it is not null.
+void BufferAndRead(benchmark::State& state, bool reverse,
+                   QuicStreamSequencerBufferBlockPool* block_pool = nullptr) {
+  const size_t frames_per_read = state.range(0);
+  QuicStreamSequencerBuffer buffer(kMaxCapacity);
+  buffer.set_block_pool(block_pool);
+  const std::string frame(kFrameSize, 'a');
+  std::vector<char> read_buffer(kFrameSize * frames_per_read);
+  QuicStreamOffset offset = 0;
+  std::string error_details;
+  for (auto _ : state) {
+    for (size_t i = 0; i < frames_per_read; ++i) {
+      const size_t index = reverse ? frames_per_read - 1 - i : i;
+      size_t bytes_buffered;
+      if (buffer.OnStreamData(offset + index * kFrameSize, frame,
+                              &bytes_buffered,
+                              &error_details) != QUIC_NO_ERROR) {
+        state.SkipWithError(error_details.c_str());
+        return;
+      }
+    }
+    iovec iov = {read_buffer.data(), read_buffer.size()};
+    size_t bytes_read;
+    if (buffer.Readv(&iov, 1, &bytes_read, &error_details) != QUIC_NO_ERROR ||
+        bytes_read != read_buffer.size()) {
+      state.SkipWithError("Failed to read buffered data");
+      return;
+    }
+    offset += bytes_read;
+  }
+  state.SetBytesProcessed(offset);
+}
+
+void BM_InOrder(benchmark::State& state) {
+  BufferAndRead(state, /*reverse=*/false);
+}
+BENCHMARK(BM_InOrder)->Arg(1)->Arg(10);
+
+void BM_Reordered(benchmark::State& state) {
+  BufferAndRead(state, /*reverse=*/true);
+}
+BENCHMARK(BM_Reordered)->Arg(10)->Arg(100);
+
+void BM_InOrderPooled(benchmark::State& state) {
+  QuicStreamSequencerBufferBlockPool block_pool(/*max_retained_blocks=*/16);
+  BufferAndRead(state, /*reverse=*/false, &block_pool);
+}
+BENCHMARK(BM_InOrderPooled)->Arg(1)->Arg(10);
+
+}  // namespace
+}  // namespace quic
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
+
+#include <memory>
+
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+QuicStreamSequencerBufferBlockPool::QuicStreamSequencerBufferBlockPool(
+    size_t max_retained_blocks)
+    : max_retained_blocks_(max_retained_blocks) {}
+
+QuicStreamSequencerBufferBlockPool::~QuicStreamSequencerBufferBlockPool() =
+    default;
+
+QuicStreamSequencerBufferBlockPool::BufferBlock*
+QuicStreamSequencerBufferBlockPool::Acquire() {
+  ++stats_.blocks_acquired;
+  if (free_blocks_.empty()) {
+    // Unlike the blocks QuicStreamSequencerBuffer allocates itself, these are
+    // not zeroed: only bytes which have been written are ever read.
+    return new BufferBlock;
+  }
+  ++stats_.pool_hits;
+  BufferBlock* block = free_blocks_.back().release();
+  free_blocks_.pop_back();
+  return block;
+}
+
+void QuicStreamSequencerBufferBlockPool::Release(BufferBlock* block) {
+  QUICHE_DCHECK(block != nullptr);
+  if (free_blocks_.size() >= max_retained_blocks_) {
+    ++stats_.blocks_freed;
+    delete block;
+    return;
+  }
+  free_blocks_.emplace_back(block);
+}
+
+void QuicStreamSequencerBufferBlockPool::ReleaseRetainedBlocks() {
+  QUIC_DVLOG(1) << "Releasing " << retained_bytes()
+                << " bytes of retained stream sequencer buffer blocks";
+  TrimTo(0);
+}
+
+void QuicStreamSequencerBufferBlockPool::SetMaxRetainedBlocks(
+    size_t max_retained_blocks) {
+  max_retained_blocks_ = max_retained_blocks;
+  TrimTo(max_retained_blocks_);
+}
+
+void QuicStreamSequencerBufferBlockPool::TrimTo(size_t max_blocks) {
+  while (free_blocks_.size() > max_blocks) {
+    ++stats_.blocks_freed;
+    free_blocks_.pop_back();
+  }
+}
+
+}  // namespace quic
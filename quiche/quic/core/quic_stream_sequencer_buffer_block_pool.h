@@ -0,0 +1,81 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_STREAM_SEQUENCER_BUFFER_BLOCK_POOL_H_
+#define QUICHE_QUIC_CORE_QUIC_STREAM_SEQUENCER_BUFFER_BLOCK_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/core/quic_stream_sequencer_buffer.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Keeps the blocks retired by QuicStreamSequencerBuffers for reuse, so that
+// receiving stream data does not allocate and free a block from the global
+// allocator for every kBlockSizeBytes of data. Up to max_retained_blocks()
+// blocks are kept; blocks released beyond that are freed.
+//
+// A pool is meant to be shared by all connections using the same
+// QuicConnectionHelperInterface, and is not thread-safe.
+class QUIC_EXPORT_PRIVATE QuicStreamSequencerBufferBlockPool {
+ public:
+  using BufferBlock = QuicStreamSequencerBuffer::BufferBlock;
+
+  struct QUIC_EXPORT_PRIVATE Stats {
+    // Number of blocks handed out by Acquire().
+    uint64_t blocks_acquired = 0;
+    // Number of those blocks which were taken from the pool rather than
+    // allocated.
+    uint64_t pool_hits = 0;
+    // Number of blocks freed because the pool was full or was released.
+    uint64_t blocks_freed = 0;
+  };
+
+  explicit QuicStreamSequencerBufferBlockPool(size_t max_retained_blocks);
+  QuicStreamSequencerBufferBlockPool(
+      const QuicStreamSequencerBufferBlockPool&) = delete;
+  QuicStreamSequencerBufferBlockPool& operator=(
+      const QuicStreamSequencerBufferBlockPool&) = delete;
+  ~QuicStreamSequencerBufferBlockPool();
+
+  // Returns a block from the pool, or a newly allocated one if the pool is
+  // empty. The contents of the block are unspecified.
+  BufferBlock* Acquire();
+
+  // Returns |block|, which must have been obtained from Acquire(), to the pool.
+  void Release(BufferBlock* block);
+
+  // Frees all retained blocks. Meant to be called when the process is under
+  // memory pressure or the connections using the pool have gone idle.
+  void ReleaseRetainedBlocks();
+
+  // Changes the number of blocks kept, freeing any in excess.
+  void SetMaxRetainedBlocks(size_t max_retained_blocks);
+  size_t max_retained_blocks() const { return max_retained_blocks_; }
+
+  size_t retained_blocks() const { return free_blocks_.size(); }
+  size_t retained_bytes() const {
+    return free_blocks_.size() * sizeof(BufferBlock);
+  }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // Frees blocks until at most |max_blocks| are retained.
+  void TrimTo(size_t max_blocks);
+
+  size_t max_retained_blocks_;
+  // Used as a stack, so that the most recently retired block, which is the
+  // most likely to be in cache, is reused first.
+  std::vector<std::unique_ptr<BufferBlock>> free_blocks_;
+  Stats stats_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_STREAM_SEQUENCER_BUFFER_BLOCK_POOL_H_
@@ -0,0 +1,77 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
+
+#include <vector>
+
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+using BufferBlock = QuicStreamSequencerBufferBlockPool::BufferBlock;
+
+TEST(QuicStreamSequencerBufferBlockPoolTest, ReusesMostRecentlyReleasedBlock) {
+  QuicStreamSequencerBufferBlockPool pool(/*max_retained_blocks=*/2);
+  BufferBlock* first = pool.Acquire();
+  BufferBlock* second = pool.Acquire();
+  EXPECT_EQ(2u, pool.stats().blocks_acquired);
+  EXPECT_EQ(0u, pool.stats().pool_hits);
+
+  pool.Release(first);
+  pool.Release(second);
+  EXPECT_EQ(2u, pool.retained_blocks());
+  EXPECT_EQ(2 * sizeof(BufferBlock), pool.retained_bytes());
+
+  EXPECT_EQ(second, pool.Acquire());
+  EXPECT_EQ(first, pool.Acquire());
+  EXPECT_EQ(4u, pool.stats().blocks_acquired);
+  EXPECT_EQ(2u, pool.stats().pool_hits);
+  EXPECT_EQ(0u, pool.retained_blocks());
+
+  pool.Release(first);
+  pool.Release(second);
+}
+
+TEST(QuicStreamSequencerBufferBlockPoolTest, FreesBlocksBeyondLimit) {
+  QuicStreamSequencerBufferBlockPool pool(/*max_retained_blocks=*/2);
+  std::vector<BufferBlock*> blocks;
+  for (int i = 0; i < 5; ++i) {
+    blocks.push_back(pool.Acquire());
+  }
+  for (BufferBlock* block : blocks) {
+    pool.Release(block);
+  }
+  EXPECT_EQ(2u, pool.retained_blocks());
+  EXPECT_EQ(3u, pool.stats().blocks_freed);
+
+  pool.SetMaxRetainedBlocks(1);
+  EXPECT_EQ(1u, pool.retained_blocks());
+  EXPECT_EQ(4u, pool.stats().blocks_freed);
+}
+
+TEST(QuicStreamSequencerBufferBlockPoolTest, ReleaseRetainedBlocks) {
+  QuicStreamSequencerBufferBlockPool pool(/*max_retained_blocks=*/4);
+  BufferBlock* first = pool.Acquire();
+  BufferBlock* second = pool.Acquire();
+  pool.Release(first);
+  pool.Release(second);
+  EXPECT_EQ(2u, pool.retained_blocks());
+
+  pool.ReleaseRetainedBlocks();
+  EXPECT_EQ(0u, pool.retained_blocks());
+  EXPECT_EQ(0u, pool.retained_bytes());
+  EXPECT_EQ(2u, pool.stats().blocks_freed);
+
+  // The pool keeps working afterwards.
+  pool.Release(pool.Acquire());
+  EXPECT_EQ(1u, pool.retained_blocks());
+  EXPECT_EQ(0u, pool.stats().pool_hits);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -13,6 +13,7 @@
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "quiche/quic/core/quic_stream_sequencer_buffer_block_pool.h"
 #include "quiche/quic/platform/api/quic_logging.h"
 #include "quiche/quic/platform/api/quic_test.h"
 #include "quiche/quic/test_tools/quic_stream_sequencer_buffer_peer.h"
@@ -1132,6 +1133,37 @@ TEST_F(QuicStreamSequencerBufferTest, GrowBlockSizeOnDemand) {
   ASSERT_EQ(helper_->current_blocks_count(), 1024u);
 }
 
+TEST_F(QuicStreamSequencerBufferTest, BlocksAreReusedThroughPool) {
+  QuicStreamSequencerBufferBlockPool pool(/*max_retained_blocks=*/8);
+  Initialize();
+  buffer_->set_block_pool(&pool);
+
+  // Write and read three blocks' worth of data twice. The second time, the
+  // blocks retired the first time are reused.
+  std::string source(3 * kBlockSizeBytes, 'a');
+  buffer_->OnStreamData(0, source, &written_, &error_details_);
+  EXPECT_EQ(3u, pool.stats().blocks_acquired);
+  EXPECT_EQ(0u, pool.stats().pool_hits);
+  EXPECT_TRUE(buffer_->MarkConsumed(source.size()));
+  EXPECT_EQ(3u, pool.retained_blocks());
+  EXPECT_EQ(3 * sizeof(BufferBlock), pool.retained_bytes());
+
+  source = std::string(3 * kBlockSizeBytes, 'b');
+  buffer_->OnStreamData(3 * kBlockSizeBytes, source, &written_,
+                        &error_details_);
+  EXPECT_EQ(6u, pool.stats().blocks_acquired);
+  EXPECT_EQ(3u, pool.stats().pool_hits);
+  EXPECT_EQ(0u, pool.retained_blocks());
+  iovec iov;
+  ASSERT_TRUE(buffer_->GetReadableRegion(&iov));
+  EXPECT_EQ(std::string(kBlockSizeBytes, 'b'), IovecToStringPiece(iov));
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+
+  // Blocks still in use are returned to the pool when the buffer goes away.
+  buffer_.reset();
+  EXPECT_EQ(3u, pool.retained_blocks());
+}
+
 }  // anonymous namespace
 
 }  // namespace test
@@ -13,6 +13,7 @@
 
 #include "absl/base/macros.h"
 #include "absl/strings/string_view.h"
+#include "quiche/quic/core/quic_received_packet_buffer.h"
 #include "quiche/quic/core/quic_stream.h"
 #include "quiche/quic/core/quic_utils.h"
 #include "quiche/quic/platform/api/quic_expect_bug.h"
@@ -21,6 +22,7 @@
 #include "quiche/quic/platform/api/quic_test.h"
 #include "quiche/quic/test_tools/quic_stream_sequencer_peer.h"
 #include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
 
 using testing::_;
 using testing::AnyNumber;
@@ -770,6 +772,110 @@ TEST_F(QuicStreamSequencerTest, ReceiveFinLessThanHighestOffset) {
   OnFinFrame(0u, "");
 }
 
+class CollectingSliceVisitor : public QuicStreamSequencer::SliceVisitor {
+ public:
+  void OnDataSlice(quiche::QuicheMemSlice slice) override {
+    slices_.push_back(std::move(slice));
+  }
+
+  std::vector<quiche::QuicheMemSlice>& slices() { return slices_; }
+
+ private:
+  std::vector<quiche::QuicheMemSlice> slices_;
+};
+
+class QuicStreamSequencerSliceTest : public QuicStreamSequencerTest {
+ protected:
+  QuicStreamSequencerSliceTest()
+      : packet_buffer_(QuicReceivedPacketBuffer::Create()) {
+    // Byte i of the stream is at position i of the packet buffer.
+    memcpy(packet_buffer_->data(), kPayload, strlen(kPayload));
+    sequencer_->set_slice_visitor(&visitor_);
+  }
+
+  void OnPacketBufferFrame(QuicStreamOffset byte_offset, size_t length,
+                           bool fin = false) {
+    QuicStreamFrame frame;
+    frame.stream_id = 1;
+    frame.offset = byte_offset;
+    frame.data_buffer = packet_buffer_->data() + byte_offset;
+    frame.data_length = length;
+    frame.fin = fin;
+    sequencer_->OnStreamFrame(frame, packet_buffer_.get());
+  }
+
+  std::vector<quiche::QuicheMemSlice>& slices() { return visitor_.slices(); }
+
+  QuicReceivedPacketBuffer::Pointer packet_buffer_;
+  CollectingSliceVisitor visitor_;
+};
+
+TEST_F(QuicStreamSequencerSliceTest, InOrderDataIsNotBuffered) {
+  EXPECT_CALL(stream_, AddBytesConsumed(3)).Times(2);
+  OnPacketBufferFrame(0, 3);
+  OnPacketBufferFrame(3, 3);
+
+  EXPECT_EQ(0u, NumBufferedBytes());
+  EXPECT_EQ(6u, sequencer_->NumBytesConsumed());
+  ASSERT_EQ(2u, slices().size());
+  EXPECT_EQ("ABC", slices()[0].AsStringView());
+  EXPECT_EQ("DEF", slices()[1].AsStringView());
+  EXPECT_EQ(packet_buffer_->data(), slices()[0].data());
+
+  // The slices keep the packet data alive.
+  packet_buffer_ = nullptr;
+  EXPECT_EQ("ABC", slices()[0].AsStringView());
+  slices().clear();
+}
+
+TEST_F(QuicStreamSequencerSliceTest, OutOfOrderDataIsBuffered) {
+  EXPECT_CALL(stream_, AddBytesConsumed(3));
+  OnPacketBufferFrame(0, 3);
+
+  // A gap: the data is buffered, and is not readable yet.
+  OnPacketBufferFrame(6, 3);
+  EXPECT_EQ(3u, NumBufferedBytes());
+
+  // Filling the gap makes the buffered data readable, and it is read as usual.
+  EXPECT_CALL(stream_, OnDataAvailable()).WillOnce(testing::Invoke([this]() {
+    ConsumeData(6);
+  }));
+  EXPECT_CALL(stream_, AddBytesConsumed(6));
+  OnPacketBufferFrame(3, 3);
+  EXPECT_EQ(0u, NumBufferedBytes());
+  EXPECT_EQ(1u, slices().size());
+
+  // Once the buffer is drained, in-order data is delivered as slices again,
+  // without the part which was already consumed.
+  EXPECT_CALL(stream_, AddBytesConsumed(3));
+  OnPacketBufferFrame(7, 5);
+  ASSERT_EQ(2u, slices().size());
+  EXPECT_EQ("JKL", slices()[1].AsStringView());
+  EXPECT_EQ(12u, sequencer_->NumBytesConsumed());
+
+  // Duplicates are ignored.
+  OnPacketBufferFrame(0, 12);
+  EXPECT_EQ(2u, slices().size());
+  EXPECT_EQ(1, sequencer_->num_duplicate_frames_received());
+}
+
+TEST_F(QuicStreamSequencerSliceTest, FinIsDeliveredAfterLastSlice) {
+  InSequence s;
+  EXPECT_CALL(stream_, AddBytesConsumed(3));
+  EXPECT_CALL(stream_, OnDataAvailable());
+  OnPacketBufferFrame(0, 3, /*fin=*/true);
+  EXPECT_TRUE(sequencer_->IsClosed());
+  ASSERT_EQ(1u, slices().size());
+  EXPECT_EQ("ABC", slices()[0].AsStringView());
+}
+
+TEST_F(QuicStreamSequencerSliceTest, DataOutsidePacketBufferIsBuffered) {
+  EXPECT_CALL(stream_, OnDataAvailable());
+  OnFrame(0, "abc");
+  EXPECT_EQ(3u, NumBufferedBytes());
+  EXPECT_TRUE(slices().empty());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
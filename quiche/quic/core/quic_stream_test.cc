@@ -69,6 +69,7 @@ class TestStream : public QuicStream {
 
   using QuicStream::CanWriteNewData;
   using QuicStream::CanWriteNewDataAfterData;
+  using QuicStream::CloseReadSide;
   using QuicStream::CloseWriteSide;
   using QuicStream::fin_buffered;
   using QuicStream::MaybeSendStopSending;
@@ -80,6 +81,11 @@ class TestStream : public QuicStream {
   std::string data_;
 };
 
+class NoopSliceVisitor : public QuicStreamSequencer::SliceVisitor {
+ public:
+  void OnDataSlice(quiche::QuicheMemSlice /*slice*/) override {}
+};
+
 class QuicStreamTest : public QuicTestWithParam<ParsedQuicVersion> {
  public:
   QuicStreamTest()
@@ -1730,6 +1736,34 @@ TEST_P(QuicStreamTest, SendRstWithCustomIetfCode) {
   EXPECT_TRUE(rst_sent());
 }
 
+TEST_P(QuicStreamTest, StopDeliveringInOrderDataAsSlices) {
+  Initialize();
+  auto stream2 = new TestStream(GetNthClientInitiatedBidirectionalStreamId(
+                                    GetParam().transport_version, 2),
+                                session_.get(), BIDIRECTIONAL);
+  session_->ActivateStream(absl::WrapUnique(stream2));
+  const QuicFramer& framer = connection_->framer();
+  NoopSliceVisitor visitor;
+  EXPECT_FALSE(framer.use_received_packet_buffers());
+
+  stream_->DeliverInOrderDataAsSlices(&visitor);
+  stream2->DeliverInOrderDataAsSlices(&visitor);
+  // Opting in again does not take another reference.
+  stream_->DeliverInOrderDataAsSlices(&visitor);
+  EXPECT_TRUE(framer.use_received_packet_buffers());
+
+  stream_->DeliverInOrderDataAsSlices(nullptr);
+  EXPECT_TRUE(framer.use_received_packet_buffers());
+
+  // The connection goes back to copying once the last stream stops.
+  stream2->CloseReadSide();
+  EXPECT_FALSE(framer.use_received_packet_buffers());
+
+  // A stream which can no longer receive data does not opt in again.
+  stream2->DeliverInOrderDataAsSlices(&visitor);
+  EXPECT_FALSE(framer.use_received_packet_buffers());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
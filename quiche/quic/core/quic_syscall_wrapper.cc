@@ -26,6 +26,10 @@ int QuicSyscallWrapper::Sendmmsg(int sockfd, mmsghdr* msgvec, unsigned int vlen,
 #endif
 }
 
+ssize_t QuicSyscallWrapper::Recvmsg(int sockfd, msghdr* msg, int flags) {
+  return ::recvmsg(sockfd, msg, flags);
+}
+
 QuicSyscallWrapper* GetGlobalSyscallWrapper() {
   return global_syscall_wrapper.load();
 }
@@ -22,6 +22,8 @@ class QUIC_EXPORT_PRIVATE QuicSyscallWrapper {
 
   virtual int Sendmmsg(int sockfd, mmsghdr* msgvec, unsigned int vlen,
                        int flags);
+
+  virtual ssize_t Recvmsg(int sockfd, msghdr* msg, int flags);
 };
 
 // A global instance of QuicSyscallWrapper, used by some socket util functions.
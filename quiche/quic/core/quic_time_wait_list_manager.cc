@@ -10,6 +10,7 @@
 #include <utility>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "quiche/quic/core/crypto/crypto_protocol.h"
 #include "quiche/quic/core/crypto/quic_decrypter.h"
 #include "quiche/quic/core/crypto/quic_encrypter.h"
@@ -17,6 +18,7 @@
 #include "quiche/quic/core/quic_connection_id.h"
 #include "quiche/quic/core/quic_framer.h"
 #include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_time_wait_store.h"
 #include "quiche/quic/core/quic_utils.h"
 #include "quiche/quic/platform/api/quic_bug_tracker.h"
 #include "quiche/quic/platform/api/quic_flag_utils.h"
@@ -70,7 +72,14 @@ TimeWaitConnectionInfo::TimeWaitConnectionInfo(
 QuicTimeWaitListManager::QuicTimeWaitListManager(
     QuicPacketWriter* writer, Visitor* visitor, const QuicClock* clock,
     QuicAlarmFactory* alarm_factory)
-    : time_wait_period_(QuicTime::Delta::FromSeconds(
+    : QuicTimeWaitListManager(writer, visitor, clock, alarm_factory,
+                              std::make_shared<QuicTimeWaitStore>()) {}
+
+QuicTimeWaitListManager::QuicTimeWaitListManager(
+    QuicPacketWriter* writer, Visitor* visitor, const QuicClock* clock,
+    QuicAlarmFactory* alarm_factory, std::shared_ptr<QuicTimeWaitStore> store)
+    : store_(std::move(store)),
+      time_wait_period_(QuicTime::Delta::FromSeconds(
           GetQuicFlag(FLAGS_quic_time_wait_list_seconds))),
       connection_id_clean_up_alarm_(
           alarm_factory->CreateAlarm(new ConnectionIdCleanUpAlarm(this))),
@@ -84,36 +93,6 @@ QuicTimeWaitListManager::~QuicTimeWaitListManager() {
   connection_id_clean_up_alarm_->Cancel();
 }
 
-QuicTimeWaitListManager::ConnectionIdMap::iterator
-QuicTimeWaitListManager::FindConnectionIdDataInMap(
-    const QuicConnectionId& connection_id) {
-  auto it = indirect_connection_id_map_.find(connection_id);
-  if (it == indirect_connection_id_map_.end()) {
-    return connection_id_map_.end();
-  }
-  return connection_id_map_.find(it->second);
-}
-
-void QuicTimeWaitListManager::AddConnectionIdDataToMap(
-    const QuicConnectionId& canonical_connection_id, int num_packets,
-    TimeWaitAction action, TimeWaitConnectionInfo info) {
-  for (const auto& cid : info.active_connection_ids) {
-    indirect_connection_id_map_[cid] = canonical_connection_id;
-  }
-  ConnectionIdData data(num_packets, clock_->ApproximateNow(), action,
-                        std::move(info));
-  connection_id_map_.emplace(
-      std::make_pair(canonical_connection_id, std::move(data)));
-}
-
-void QuicTimeWaitListManager::RemoveConnectionDataFromMap(
-    ConnectionIdMap::iterator it) {
-  for (const auto& cid : it->second.info.active_connection_ids) {
-    indirect_connection_id_map_.erase(cid);
-  }
-  connection_id_map_.erase(it);
-}
-
 void QuicTimeWaitListManager::AddConnectionIdToTimeWait(
     TimeWaitAction action, TimeWaitConnectionInfo info) {
   QUICHE_DCHECK(!info.active_connection_ids.empty());
@@ -123,29 +102,34 @@ void QuicTimeWaitListManager::AddConnectionIdToTimeWait(
                 !info.termination_packets.empty());
   QUICHE_DCHECK(action != DO_NOTHING || info.ietf_quic);
   int num_packets = 0;
-  auto it = FindConnectionIdDataInMap(canonical_connection_id);
-  const bool new_connection_id = it == connection_id_map_.end();
+  std::shared_ptr<QuicTimeWaitEntry> existing_entry =
+      store_->Find(canonical_connection_id);
+  const bool new_connection_id = existing_entry == nullptr;
   if (!new_connection_id) {  // Replace record if it is reinserted.
-    num_packets = it->second.num_packets;
-    RemoveConnectionDataFromMap(it);
+    num_packets = existing_entry->num_packets.load(std::memory_order_relaxed);
+    store_->Remove(*existing_entry);
   }
   TrimTimeWaitListIfNeeded();
-  int64_t max_connections =
-      GetQuicFlag(FLAGS_quic_time_wait_list_max_connections);
-  QUICHE_DCHECK(connection_id_map_.empty() ||
-                num_connections() < static_cast<size_t>(max_connections));
   if (new_connection_id) {
     for (const auto& cid : info.active_connection_ids) {
       visitor_->OnConnectionAddedToTimeWaitList(cid);
     }
   }
-  AddConnectionIdDataToMap(canonical_connection_id, num_packets, action,
-                           std::move(info));
+  std::shared_ptr<const QuicTimeWaitTerminationPackets> termination_packets =
+      store_->InternTerminationPackets(std::move(info.termination_packets));
+  store_->Add(std::make_shared<QuicTimeWaitEntry>(
+      clock_->ApproximateNow(), action, info.ietf_quic, info.srtt,
+      std::move(info.active_connection_ids), std::move(termination_packets),
+      num_packets));
 }
 
 bool QuicTimeWaitListManager::IsConnectionIdInTimeWait(
     QuicConnectionId connection_id) const {
-  return indirect_connection_id_map_.contains(connection_id);
+  return store_->Contains(connection_id);
+}
+
+size_t QuicTimeWaitListManager::num_connections() const {
+  return store_->size();
 }
 
 void QuicTimeWaitListManager::OnBlockedWriterCanWrite() {
@@ -167,20 +151,24 @@ void QuicTimeWaitListManager::ProcessPacket(
   QUICHE_DCHECK(IsConnectionIdInTimeWait(connection_id));
   // TODO(satyamshekhar): Think about handling packets from different peer
   // addresses.
-  auto it = FindConnectionIdDataInMap(connection_id);
-  QUICHE_DCHECK(it != connection_id_map_.end());
+  std::shared_ptr<QuicTimeWaitEntry> connection_data =
+      store_->Find(connection_id);
+  if (connection_data == nullptr) {
+    // Expired by the manager of another dispatcher sharing the store.
+    QUIC_CODE_COUNT(quic_time_wait_list_entry_expired_concurrently);
+    return;
+  }
   // Increment the received packet count.
-  ConnectionIdData* connection_data = &it->second;
-  ++(connection_data->num_packets);
+  const int num_packets =
+      connection_data->num_packets.fetch_add(1, std::memory_order_relaxed) + 1;
   const QuicTime now = clock_->ApproximateNow();
   QuicTime::Delta delta = QuicTime::Delta::Zero();
   if (now > connection_data->time_added) {
     delta = now - connection_data->time_added;
   }
-  OnPacketReceivedForKnownConnection(connection_data->num_packets, delta,
-                                     connection_data->info.srtt);
+  OnPacketReceivedForKnownConnection(num_packets, delta, connection_data->srtt);
 
-  if (!ShouldSendResponse(connection_data->num_packets)) {
+  if (!ShouldSendResponse(num_packets)) {
     QUIC_DLOG(INFO) << "Processing " << connection_id << " in time wait state: "
                     << "throttled";
     return;
@@ -188,55 +176,51 @@ void QuicTimeWaitListManager::ProcessPacket(
 
   QUIC_DLOG(INFO) << "Processing " << connection_id << " in time wait state: "
                   << "header format=" << header_format
-                  << " ietf=" << connection_data->info.ietf_quic
+                  << " ietf=" << connection_data->ietf_quic
                   << ", action=" << connection_data->action
                   << ", number termination packets="
-                  << connection_data->info.termination_packets.size();
+                  << connection_data->termination_packets->size();
   switch (connection_data->action) {
     case SEND_TERMINATION_PACKETS:
-      if (connection_data->info.termination_packets.empty()) {
+      if (connection_data->termination_packets->empty()) {
         QUIC_BUG(quic_bug_10608_1) << "There are no termination packets.";
         return;
       }
       switch (header_format) {
         case IETF_QUIC_LONG_HEADER_PACKET:
-          if (!connection_data->info.ietf_quic) {
+          if (!connection_data->ietf_quic) {
             QUIC_CODE_COUNT(quic_received_long_header_packet_for_gquic);
           }
           break;
         case IETF_QUIC_SHORT_HEADER_PACKET:
-          if (!connection_data->info.ietf_quic) {
+          if (!connection_data->ietf_quic) {
             QUIC_CODE_COUNT(quic_received_short_header_packet_for_gquic);
           }
           // Send stateless reset in response to short header packets.
           SendPublicReset(self_address, peer_address, connection_id,
-                          connection_data->info.ietf_quic,
-                          received_packet_length, std::move(packet_context));
+                          connection_data->ietf_quic, received_packet_length,
+                          std::move(packet_context));
           return;
         case GOOGLE_QUIC_PACKET:
-          if (connection_data->info.ietf_quic) {
+          if (connection_data->ietf_quic) {
             QUIC_CODE_COUNT(quic_received_gquic_packet_for_ietf_quic);
           }
           break;
       }
 
-      for (const auto& packet : connection_data->info.termination_packets) {
-        SendOrQueuePacket(std::make_unique<QueuedPacket>(
-                              self_address, peer_address, packet->Clone()),
-                          packet_context.get());
-      }
+      SendTerminationPackets(self_address, peer_address,
+                             connection_data->termination_packets,
+                             packet_context.get());
       return;
 
     case SEND_CONNECTION_CLOSE_PACKETS:
-      if (connection_data->info.termination_packets.empty()) {
+      if (connection_data->termination_packets->empty()) {
         QUIC_BUG(quic_bug_10608_2) << "There are no termination packets.";
         return;
       }
-      for (const auto& packet : connection_data->info.termination_packets) {
-        SendOrQueuePacket(std::make_unique<QueuedPacket>(
-                              self_address, peer_address, packet->Clone()),
-                          packet_context.get());
-      }
+      SendTerminationPackets(self_address, peer_address,
+                             connection_data->termination_packets,
+                             packet_context.get());
       return;
 
     case SEND_STATELESS_RESET:
@@ -244,12 +228,12 @@ void QuicTimeWaitListManager::ProcessPacket(
         QUIC_CODE_COUNT(quic_stateless_reset_long_header_packet);
       }
       SendPublicReset(self_address, peer_address, connection_id,
-                      connection_data->info.ietf_quic, received_packet_length,
+                      connection_data->ietf_quic, received_packet_length,
                       std::move(packet_context));
       return;
     case DO_NOTHING:
       QUIC_CODE_COUNT(quic_time_wait_list_do_nothing);
-      QUICHE_DCHECK(connection_data->info.ietf_quic);
+      QUICHE_DCHECK(connection_data->ietf_quic);
   }
 }
 
@@ -276,6 +260,21 @@ void QuicTimeWaitListManager::SendVersionNegotiationPacket(
                     packet_context.get());
 }
 
+void QuicTimeWaitListManager::SendTerminationPackets(
+    const QuicSocketAddress& self_address,
+    const QuicSocketAddress& peer_address,
+    const std::shared_ptr<const QuicTimeWaitTerminationPackets>& packets,
+    const QuicPerPacketContext* packet_context) {
+  for (const auto& packet : *packets) {
+    // Aliases |packets|, which keeps |packet| alive while it is queued.
+    SendOrQueuePacket(std::make_unique<QueuedPacket>(
+                          self_address, peer_address,
+                          std::shared_ptr<const QuicEncryptedPacket>(
+                              packets, packet.get())),
+                      packet_context);
+  }
+}
+
 // Returns true if the number of packets received for this connection_id is a
 // power of 2 to throttle the number of public reset packets we send to a peer.
 bool QuicTimeWaitListManager::ShouldSendResponse(int received_packet_count) {
@@ -402,9 +401,9 @@ bool QuicTimeWaitListManager::WriteToWire(QueuedPacket* queued_packet) {
 
 void QuicTimeWaitListManager::SetConnectionIdCleanUpAlarm() {
   QuicTime::Delta next_alarm_interval = QuicTime::Delta::Zero();
-  if (!connection_id_map_.empty()) {
-    QuicTime oldest_connection_id =
-        connection_id_map_.begin()->second.time_added;
+  absl::optional<QuicTime> oldest_time_added = store_->OldestTimeAdded();
+  if (oldest_time_added.has_value()) {
+    QuicTime oldest_connection_id = *oldest_time_added;
     QuicTime now = clock_->ApproximateNow();
     if (now - oldest_connection_id < time_wait_period_) {
       next_alarm_interval = oldest_connection_id + time_wait_period_ - now;
@@ -421,35 +420,11 @@ void QuicTimeWaitListManager::SetConnectionIdCleanUpAlarm() {
       clock_->ApproximateNow() + next_alarm_interval, QuicTime::Delta::Zero());
 }
 
-bool QuicTimeWaitListManager::MaybeExpireOldestConnection(
-    QuicTime expiration_time) {
-  if (connection_id_map_.empty()) {
-    return false;
-  }
-  auto it = connection_id_map_.begin();
-  QuicTime oldest_connection_id_time = it->second.time_added;
-  if (oldest_connection_id_time > expiration_time) {
-    // Too recent, don't retire.
-    return false;
-  }
-  // This connection_id has lived its age, retire it now.
-  QUIC_DLOG(INFO) << "Connection " << it->first
-                  << " expired from time wait list";
-  RemoveConnectionDataFromMap(it);
-  if (expiration_time == QuicTime::Infinite()) {
-    QUIC_CODE_COUNT(quic_time_wait_list_trim_full);
-  } else {
-    QUIC_CODE_COUNT(quic_time_wait_list_expire_connections);
-  }
-  return true;
-}
-
 void QuicTimeWaitListManager::CleanUpOldConnectionIds() {
   QuicTime now = clock_->ApproximateNow();
   QuicTime expiration = now - time_wait_period_;
 
-  while (MaybeExpireOldestConnection(expiration)) {
-  }
+  store_->ExpireEntries(expiration);
 
   SetConnectionIdCleanUpAlarm();
 }
@@ -460,25 +435,12 @@ void QuicTimeWaitListManager::TrimTimeWaitListIfNeeded() {
   if (kMaxConnections < 0) {
     return;
   }
-  while (!connection_id_map_.empty() &&
-         num_connections() >= static_cast<size_t>(kMaxConnections)) {
-    MaybeExpireOldestConnection(QuicTime::Infinite());
+  while (num_connections() >= static_cast<size_t>(kMaxConnections) &&
+         store_->RemoveOldestEntry()) {
+    QUIC_CODE_COUNT(quic_time_wait_list_trim_full);
   }
 }
 
-QuicTimeWaitListManager::ConnectionIdData::ConnectionIdData(
-    int num_packets, QuicTime time_added, TimeWaitAction action,
-    TimeWaitConnectionInfo info)
-    : num_packets(num_packets),
-      time_added(time_added),
-      action(action),
-      info(std::move(info)) {}
-
-QuicTimeWaitListManager::ConnectionIdData::ConnectionIdData(
-    ConnectionIdData&& other) = default;
-
-QuicTimeWaitListManager::ConnectionIdData::~ConnectionIdData() = default;
-
 StatelessResetToken QuicTimeWaitListManager::GetStatelessResetToken(
     QuicConnectionId connection_id) const {
   return QuicUtils::GenerateStatelessResetToken(connection_id);
@@ -11,7 +11,6 @@
 #include <cstddef>
 #include <memory>
 
-#include "absl/container/flat_hash_map.h"
 #include "quiche/quic/core/quic_blocked_writer_interface.h"
 #include "quiche/quic/core/quic_connection_id.h"
 #include "quiche/quic/core/quic_framer.h"
@@ -20,15 +19,21 @@
 #include "quiche/quic/core/quic_session.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/platform/api/quic_flags.h"
-#include "quiche/common/quiche_linked_hash_map.h"
+#include "quiche/common/quiche_circular_deque.h"
 
 namespace quic {
 
+class QuicTimeWaitStore;
+
 namespace test {
 class QuicDispatcherPeer;
 class QuicTimeWaitListManagerPeer;
 }  // namespace test
 
+// The termination packets of a connection in time wait.
+using QuicTimeWaitTerminationPackets =
+    std::vector<std::unique_ptr<QuicEncryptedPacket>>;
+
 // TimeWaitConnectionInfo comprises information of a connection which is in the
 // time wait list.
 struct QUIC_NO_EXPORT TimeWaitConnectionInfo {
@@ -94,6 +99,14 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   QuicTimeWaitListManager(QuicPacketWriter* writer, Visitor* visitor,
                           const QuicClock* clock,
                           QuicAlarmFactory* alarm_factory);
+  // As above, but keeps the connections in |store|, which may be shared with
+  // the managers of other dispatchers running on other threads. Each manager
+  // sends termination packets for any connection in |store| through its own
+  // writer.
+  QuicTimeWaitListManager(QuicPacketWriter* writer, Visitor* visitor,
+                          const QuicClock* clock,
+                          QuicAlarmFactory* alarm_factory,
+                          std::shared_ptr<QuicTimeWaitStore> store);
   QuicTimeWaitListManager(const QuicTimeWaitListManager&) = delete;
   QuicTimeWaitListManager& operator=(const QuicTimeWaitListManager&) = delete;
   ~QuicTimeWaitListManager() override;
@@ -143,7 +156,7 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   void TrimTimeWaitListIfNeeded();
 
   // The number of connections on the time-wait list.
-  size_t num_connections() const { return connection_id_map_.size(); }
+  size_t num_connections() const;
 
   // Sends a version negotiation packet for |server_connection_id| and
   // |client_connection_id| announcing support for |supported_versions| to
@@ -191,12 +204,20 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
         : self_address_(self_address),
           peer_address_(peer_address),
           packet_(std::move(packet)) {}
+    // |packet| may be shared with a connection in time wait, to avoid copying
+    // its termination packets for every response.
+    QueuedPacket(const QuicSocketAddress& self_address,
+                 const QuicSocketAddress& peer_address,
+                 std::shared_ptr<const QuicEncryptedPacket> packet)
+        : self_address_(self_address),
+          peer_address_(peer_address),
+          packet_(std::move(packet)) {}
     QueuedPacket(const QueuedPacket&) = delete;
     QueuedPacket& operator=(const QueuedPacket&) = delete;
 
     const QuicSocketAddress& self_address() const { return self_address_; }
     const QuicSocketAddress& peer_address() const { return peer_address_; }
-    QuicEncryptedPacket* packet() { return packet_.get(); }
+    const QuicEncryptedPacket* packet() const { return packet_.get(); }
 
    private:
     // Server address on which a packet was received for a connection_id in
@@ -205,7 +226,7 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
     // Address of the peer to send this packet to.
     const QuicSocketAddress peer_address_;
     // The pending termination packet that is to be sent to the peer.
-    std::unique_ptr<QuicEncryptedPacket> packet_;
+    std::shared_ptr<const QuicEncryptedPacket> packet_;
   };
 
   // Called right after |packet| is serialized. Either sends the packet and
@@ -238,15 +259,6 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   // Register the alarm server to wake up at appropriate time.
   void SetConnectionIdCleanUpAlarm();
 
-  // Removes the oldest connection from the time-wait list if it was added prior
-  // to "expiration_time".  To unconditionally remove the oldest connection, use
-  // a QuicTime::Delta:Infinity().  This function modifies the
-  // connection_id_map_.  If you plan to call this function in a loop, any
-  // iterators that you hold before the call to this function may be invalid
-  // afterward.  Returns true if the oldest connection was expired.  Returns
-  // false if the map is empty or the oldest connection has not expired.
-  bool MaybeExpireOldestConnection(QuicTime expiration_time);
-
   // Called when a packet is received for a connection in this time wait list.
   virtual void OnPacketReceivedForKnownConnection(
       int /*num_packets*/, QuicTime::Delta /*delta*/,
@@ -255,54 +267,15 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   std::unique_ptr<QuicEncryptedPacket> BuildIetfStatelessResetPacket(
       QuicConnectionId connection_id, size_t received_packet_length);
 
-  // A map from a recently closed connection_id to the number of packets
-  // received after the termination of the connection bound to the
-  // connection_id.
-  struct QUIC_NO_EXPORT ConnectionIdData {
-    ConnectionIdData(int num_packets, QuicTime time_added,
-                     TimeWaitAction action, TimeWaitConnectionInfo info);
-
-    ConnectionIdData(const ConnectionIdData& other) = delete;
-    ConnectionIdData(ConnectionIdData&& other);
-
-    ~ConnectionIdData();
-
-    int num_packets;
-    QuicTime time_added;
-    TimeWaitAction action;
-    TimeWaitConnectionInfo info;
-  };
+  // Sends or queues |packets| without copying them.
+  void SendTerminationPackets(
+      const QuicSocketAddress& self_address,
+      const QuicSocketAddress& peer_address,
+      const std::shared_ptr<const QuicTimeWaitTerminationPackets>& packets,
+      const QuicPerPacketContext* packet_context);
 
-  // QuicheLinkedHashMap allows lookup by ConnectionId
-  // and traversal in add order.
-  using ConnectionIdMap =
-      quiche::QuicheLinkedHashMap<QuicConnectionId, ConnectionIdData,
-                                  QuicConnectionIdHash>;
-  // Do not use find/emplace/erase on this map directly. Use
-  // FindConnectionIdDataInMap, AddConnectionIdDateToMap,
-  // RemoveConnectionDataFromMap instead.
-  ConnectionIdMap connection_id_map_;
-
-  // TODO(haoyuewang) Consider making connection_id_map_ a map of shared pointer
-  // and remove the indirect map.
-  // A connection can have multiple unretired ConnectionIds when it is closed.
-  // These Ids have the same ConnectionIdData entry in connection_id_map_. To
-  // find the entry, look up the cannoical ConnectionId in
-  // indirect_connection_id_map_ first, and look up connection_id_map_ with the
-  // cannoical ConnectionId.
-  absl::flat_hash_map<QuicConnectionId, QuicConnectionId, QuicConnectionIdHash>
-      indirect_connection_id_map_;
-
-  // Find an iterator for the given connection_id. Returns
-  // connection_id_map_.end() if none found.
-  ConnectionIdMap::iterator FindConnectionIdDataInMap(
-      const QuicConnectionId& connection_id);
-  // Inserts a ConnectionIdData entry to connection_id_map_.
-  void AddConnectionIdDataToMap(const QuicConnectionId& canonical_connection_id,
-                                int num_packets, TimeWaitAction action,
-                                TimeWaitConnectionInfo info);
-  // Removes a ConnectionIdData entry in connection_id_map_.
-  void RemoveConnectionDataFromMap(ConnectionIdMap::iterator it);
+  // Connections in time wait, possibly shared with other managers.
+  std::shared_ptr<QuicTimeWaitStore> store_;
 
   // Pending termination packets that need to be sent out to the peer when we
   // are given a chance to write by the dispatcher.
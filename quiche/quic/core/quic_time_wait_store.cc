@@ -0,0 +1,375 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_time_wait_store.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "quiche/quic/platform/api/quic_flag_utils.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+// Per shard table capacity when empty. Must be a power of two.
+constexpr size_t kMinShardCapacity = 16;
+
+// The interned packets are swept once their number doubles, and no earlier
+// than at this size.
+constexpr size_t kMinInternSweepSize = 64;
+
+size_t HashTerminationPackets(const QuicTimeWaitTerminationPackets& packets) {
+  size_t hash = packets.size();
+  for (const auto& packet : packets) {
+    hash = absl::Hash<std::tuple<size_t, absl::string_view>>()(std::make_tuple(
+        hash, absl::string_view(packet->data(), packet->length())));
+  }
+  return hash;
+}
+
+bool TerminationPacketsEqual(const QuicTimeWaitTerminationPackets& a,
+                             const QuicTimeWaitTerminationPackets& b) {
+  return std::equal(
+      a.begin(), a.end(), b.begin(), b.end(),
+      [](const std::unique_ptr<QuicEncryptedPacket>& x,
+         const std::unique_ptr<QuicEncryptedPacket>& y) {
+        return absl::string_view(x->data(), x->length()) ==
+               absl::string_view(y->data(), y->length());
+      });
+}
+
+}  // namespace
+
+QuicTimeWaitEntry::QuicTimeWaitEntry(
+    QuicTime time_added, QuicTimeWaitListManager::TimeWaitAction action,
+    bool ietf_quic, QuicTime::Delta srtt,
+    std::vector<QuicConnectionId> connection_ids,
+    std::shared_ptr<const QuicTimeWaitTerminationPackets> termination_packets,
+    int num_packets)
+    : time_added(time_added),
+      action(action),
+      ietf_quic(ietf_quic),
+      srtt(srtt),
+      connection_ids(std::move(connection_ids)),
+      termination_packets(std::move(termination_packets)),
+      num_packets(num_packets) {
+  QUICHE_DCHECK(!this->connection_ids.empty());
+  QUICHE_DCHECK(this->termination_packets != nullptr);
+}
+
+QuicTimeWaitEntry::~QuicTimeWaitEntry() = default;
+
+QuicTimeWaitStore::Shard::Shard() : slots(kMinShardCapacity) {}
+
+QuicTimeWaitStore::Shard::~Shard() = default;
+
+QuicTimeWaitStore::Slot* QuicTimeWaitStore::Shard::FindSlot(
+    const QuicConnectionId& connection_id, size_t hash) {
+  return const_cast<Slot*>(
+      static_cast<const Shard*>(this)->FindSlot(connection_id, hash));
+}
+
+const QuicTimeWaitStore::Slot* QuicTimeWaitStore::Shard::FindSlot(
+    const QuicConnectionId& connection_id, size_t hash) const {
+  const size_t mask = slots.size() - 1;
+  size_t index = (hash / kNumShards) & mask;
+  for (size_t probes = 0; probes < slots.size(); ++probes) {
+    const Slot& slot = slots[index];
+    if (slot.state == Slot::kEmpty) {
+      return nullptr;
+    }
+    if (slot.state == Slot::kFull && slot.connection_id == connection_id) {
+      return &slot;
+    }
+    index = (index + 1) & mask;
+  }
+  return nullptr;
+}
+
+QuicTimeWaitStore::Slot* QuicTimeWaitStore::Shard::FindOrInsertSlot(
+    const QuicConnectionId& connection_id, size_t hash) {
+  // Keep at least a quarter of the slots empty so that probe sequences of
+  // missing connection IDs, the common case for lookups, stay short.
+  if ((num_full + num_deleted + 1) * 4 > slots.size() * 3) {
+    Rehash((num_full + 1) * 2 > slots.size() ? slots.size() * 2
+                                             : slots.size());
+  }
+  const size_t mask = slots.size() - 1;
+  size_t index = (hash / kNumShards) & mask;
+  Slot* first_deleted = nullptr;
+  while (true) {
+    Slot& slot = slots[index];
+    if (slot.state == Slot::kFull && slot.connection_id == connection_id) {
+      return &slot;
+    }
+    if (slot.state == Slot::kDeleted && first_deleted == nullptr) {
+      first_deleted = &slot;
+    }
+    if (slot.state == Slot::kEmpty) {
+      Slot* inserted = &slot;
+      if (first_deleted != nullptr) {
+        inserted = first_deleted;
+        --num_deleted;
+      }
+      inserted->state = Slot::kFull;
+      inserted->connection_id = connection_id;
+      ++num_full;
+      return inserted;
+    }
+    index = (index + 1) & mask;
+  }
+}
+
+void QuicTimeWaitStore::Shard::EraseSlot(Slot* slot) {
+  QUICHE_DCHECK_EQ(Slot::kFull, slot->state);
+  slot->state = Slot::kDeleted;
+  slot->connection_id = QuicConnectionId();
+  slot->entry.reset();
+  --num_full;
+  ++num_deleted;
+  // Give memory back once a burst of connections has expired.
+  if (slots.size() > kMinShardCapacity && num_full * 8 < slots.size()) {
+    Rehash(slots.size() / 2);
+  }
+}
+
+void QuicTimeWaitStore::Shard::Rehash(size_t capacity) {
+  std::vector<Slot> old_slots(capacity);
+  old_slots.swap(slots);
+  const size_t mask = slots.size() - 1;
+  for (Slot& old_slot : old_slots) {
+    if (old_slot.state != Slot::kFull) {
+      continue;
+    }
+    size_t index = (old_slot.connection_id.Hash() / kNumShards) & mask;
+    while (slots[index].state != Slot::kEmpty) {
+      index = (index + 1) & mask;
+    }
+    slots[index] = std::move(old_slot);
+  }
+  num_deleted = 0;
+}
+
+bool QuicTimeWaitStore::Shard::IsLive(const QuicTimeWaitEntry& entry) const {
+  const Slot* slot = FindSlot(entry.canonical_connection_id(),
+                              entry.canonical_connection_id().Hash());
+  return slot != nullptr && slot->entry.get() == &entry;
+}
+
+QuicTimeWaitStore::QuicTimeWaitStore()
+    : next_intern_sweep_size_(kMinInternSweepSize) {}
+
+QuicTimeWaitStore::~QuicTimeWaitStore() = default;
+
+std::shared_ptr<const QuicTimeWaitTerminationPackets>
+QuicTimeWaitStore::InternTerminationPackets(
+    QuicTimeWaitTerminationPackets packets) {
+  if (packets.empty()) {
+    static const auto* const kNoPackets =
+        new std::shared_ptr<const QuicTimeWaitTerminationPackets>(
+            std::make_shared<const QuicTimeWaitTerminationPackets>());
+    return *kNoPackets;
+  }
+  const size_t hash = HashTerminationPackets(packets);
+  QuicWriterMutexLock lock(&intern_mutex_);
+  auto it = interned_packets_.find(hash);
+  if (it != interned_packets_.end()) {
+    std::shared_ptr<const QuicTimeWaitTerminationPackets> interned =
+        it->second.lock();
+    if (interned != nullptr && TerminationPacketsEqual(*interned, packets)) {
+      QUIC_CODE_COUNT(quic_time_wait_termination_packets_shared);
+      return interned;
+    }
+  }
+  auto interned = std::make_shared<const QuicTimeWaitTerminationPackets>(
+      std::move(packets));
+  interned_packets_[hash] = interned;
+  if (interned_packets_.size() >= next_intern_sweep_size_) {
+    SweepInternedPackets();
+  }
+  return interned;
+}
+
+void QuicTimeWaitStore::SweepInternedPackets() {
+  for (auto it = interned_packets_.begin(); it != interned_packets_.end();) {
+    if (it->second.expired()) {
+      interned_packets_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  next_intern_sweep_size_ =
+      std::max(kMinInternSweepSize, 2 * interned_packets_.size());
+}
+
+void QuicTimeWaitStore::Add(std::shared_ptr<QuicTimeWaitEntry> entry) {
+  std::vector<std::shared_ptr<QuicTimeWaitEntry>> replaced_entries;
+  for (const QuicConnectionId& connection_id : entry->connection_ids) {
+    const size_t hash = connection_id.Hash();
+    Shard& shard = shards_[ShardIndex(hash)];
+    QuicWriterMutexLock lock(&shard.mutex);
+    Slot* slot = shard.FindOrInsertSlot(connection_id, hash);
+    if (slot->entry == entry) {
+      continue;
+    }
+    if (slot->entry != nullptr &&
+        slot->entry->canonical_connection_id() == connection_id) {
+      // The replaced entry is gone, its remaining connection IDs are removed
+      // below.
+      num_entries_.fetch_sub(1, std::memory_order_relaxed);
+      replaced_entries.push_back(std::move(slot->entry));
+    }
+    slot->entry = entry;
+    if (connection_id == entry->canonical_connection_id()) {
+      entry->sequence_number =
+          next_sequence_number_.fetch_add(1, std::memory_order_relaxed);
+      num_entries_.fetch_add(1, std::memory_order_relaxed);
+      shard.expiry_ring.push_back(entry);
+    }
+  }
+  for (const auto& replaced_entry : replaced_entries) {
+    RemoveNonCanonicalConnectionIds(*replaced_entry);
+  }
+}
+
+void QuicTimeWaitStore::Remove(const QuicTimeWaitEntry& entry) {
+  {
+    const QuicConnectionId& connection_id = entry.canonical_connection_id();
+    const size_t hash = connection_id.Hash();
+    Shard& shard = shards_[ShardIndex(hash)];
+    QuicWriterMutexLock lock(&shard.mutex);
+    Slot* slot = shard.FindSlot(connection_id, hash);
+    if (slot != nullptr && slot->entry.get() == &entry) {
+      // The entry is left in the expiry ring, which skips it once it is no
+      // longer live.
+      shard.EraseSlot(slot);
+      num_entries_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+  RemoveNonCanonicalConnectionIds(entry);
+}
+
+void QuicTimeWaitStore::RemoveNonCanonicalConnectionIds(
+    const QuicTimeWaitEntry& entry) {
+  for (size_t i = 1; i < entry.connection_ids.size(); ++i) {
+    const QuicConnectionId& connection_id = entry.connection_ids[i];
+    const size_t hash = connection_id.Hash();
+    Shard& shard = shards_[ShardIndex(hash)];
+    QuicWriterMutexLock lock(&shard.mutex);
+    Slot* slot = shard.FindSlot(connection_id, hash);
+    if (slot != nullptr && slot->entry.get() == &entry) {
+      shard.EraseSlot(slot);
+    }
+  }
+}
+
+std::shared_ptr<QuicTimeWaitEntry> QuicTimeWaitStore::Find(
+    const QuicConnectionId& connection_id) const {
+  const size_t hash = connection_id.Hash();
+  const Shard& shard = shards_[ShardIndex(hash)];
+  QuicReaderMutexLock lock(&shard.mutex);
+  const Slot* slot = shard.FindSlot(connection_id, hash);
+  return slot == nullptr ? nullptr : slot->entry;
+}
+
+bool QuicTimeWaitStore::Contains(const QuicConnectionId& connection_id) const {
+  const size_t hash = connection_id.Hash();
+  const Shard& shard = shards_[ShardIndex(hash)];
+  QuicReaderMutexLock lock(&shard.mutex);
+  return shard.FindSlot(connection_id, hash) != nullptr;
+}
+
+std::shared_ptr<QuicTimeWaitEntry> QuicTimeWaitStore::PopOldestEntry(
+    Shard* shard, QuicTime expiration_time) {
+  QuicWriterMutexLock lock(&shard->mutex);
+  while (!shard->expiry_ring.empty()) {
+    if (!shard->IsLive(*shard->expiry_ring.front())) {
+      shard->expiry_ring.pop_front();
+      continue;
+    }
+    if (shard->expiry_ring.front()->time_added > expiration_time) {
+      return nullptr;
+    }
+    std::shared_ptr<QuicTimeWaitEntry> entry =
+        std::move(shard->expiry_ring.front());
+    shard->expiry_ring.pop_front();
+    shard->EraseSlot(shard->FindSlot(entry->canonical_connection_id(),
+                                     entry->canonical_connection_id().Hash()));
+    num_entries_.fetch_sub(1, std::memory_order_relaxed);
+    return entry;
+  }
+  return nullptr;
+}
+
+size_t QuicTimeWaitStore::ExpireEntries(QuicTime expiration_time) {
+  size_t num_expired = 0;
+  for (Shard& shard : shards_) {
+    while (std::shared_ptr<QuicTimeWaitEntry> entry =
+               PopOldestEntry(&shard, expiration_time)) {
+      QUIC_DLOG(INFO) << "Connection " << entry->canonical_connection_id()
+                      << " expired from time wait list";
+      QUIC_CODE_COUNT(quic_time_wait_list_expire_connections);
+      RemoveNonCanonicalConnectionIds(*entry);
+      ++num_expired;
+    }
+  }
+  return num_expired;
+}
+
+bool QuicTimeWaitStore::RemoveOldestEntry() {
+  while (!empty()) {
+    Shard* oldest_shard = nullptr;
+    uint64_t oldest_sequence_number = 0;
+    for (Shard& shard : shards_) {
+      QuicReaderMutexLock lock(&shard.mutex);
+      for (const auto& entry : shard.expiry_ring) {
+        if (!shard.IsLive(*entry)) {
+          continue;
+        }
+        if (oldest_shard == nullptr ||
+            entry->sequence_number < oldest_sequence_number) {
+          oldest_shard = &shard;
+          oldest_sequence_number = entry->sequence_number;
+        }
+        break;
+      }
+    }
+    if (oldest_shard == nullptr) {
+      return false;
+    }
+    // Another thread may have removed the entry in the meantime, in which
+    // case this removes the next one in that shard.
+    std::shared_ptr<QuicTimeWaitEntry> entry =
+        PopOldestEntry(oldest_shard, QuicTime::Infinite());
+    if (entry != nullptr) {
+      RemoveNonCanonicalConnectionIds(*entry);
+      return true;
+    }
+  }
+  return false;
+}
+
+absl::optional<QuicTime> QuicTimeWaitStore::OldestTimeAdded() const {
+  absl::optional<QuicTime> oldest_time;
+  for (const Shard& shard : shards_) {
+    QuicReaderMutexLock lock(&shard.mutex);
+    for (const auto& entry : shard.expiry_ring) {
+      if (!shard.IsLive(*entry)) {
+        continue;
+      }
+      if (!oldest_time.has_value() || entry->time_added < *oldest_time) {
+        oldest_time = entry->time_added;
+      }
+      break;
+    }
+  }
+  return oldest_time;
+}
+
+}  // namespace quic
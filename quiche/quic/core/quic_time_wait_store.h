@@ -0,0 +1,185 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_TIME_WAIT_STORE_H_
+#define QUICHE_QUIC_CORE_QUIC_TIME_WAIT_STORE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "quiche/quic/core/quic_connection_id.h"
+#include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_time_wait_list_manager.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+#include "quiche/common/quiche_circular_deque.h"
+
+namespace quic {
+
+// A connection in time wait, shared by all of its connection IDs. Everything
+// but |num_packets| is immutable once the entry is added to a
+// QuicTimeWaitStore, so an entry returned by the store can be read without
+// holding any lock.
+struct QUIC_NO_EXPORT QuicTimeWaitEntry {
+  QuicTimeWaitEntry(QuicTime time_added,
+                    QuicTimeWaitListManager::TimeWaitAction action,
+                    bool ietf_quic, QuicTime::Delta srtt,
+                    std::vector<QuicConnectionId> connection_ids,
+                    std::shared_ptr<const QuicTimeWaitTerminationPackets>
+                        termination_packets,
+                    int num_packets);
+  QuicTimeWaitEntry(const QuicTimeWaitEntry&) = delete;
+  QuicTimeWaitEntry& operator=(const QuicTimeWaitEntry&) = delete;
+  ~QuicTimeWaitEntry();
+
+  // The first connection ID is the canonical one, which determines the shard
+  // holding the entry in expiry order.
+  const QuicConnectionId& canonical_connection_id() const {
+    return connection_ids.front();
+  }
+
+  const QuicTime time_added;
+  const QuicTimeWaitListManager::TimeWaitAction action;
+  const bool ietf_quic;
+  const QuicTime::Delta srtt;
+  const std::vector<QuicConnectionId> connection_ids;
+  // Never null, possibly empty.
+  const std::shared_ptr<const QuicTimeWaitTerminationPackets>
+      termination_packets;
+  // Number of packets received for any of |connection_ids|.
+  std::atomic<int> num_packets;
+  // Order in which entries were added, set by QuicTimeWaitStore::Add(). Breaks
+  // ties between entries added at the same time in different shards.
+  uint64_t sequence_number = 0;
+};
+
+// Connections in time wait, keyed by connection ID. Can be shared by the
+// QuicTimeWaitListManagers of several dispatchers running on different
+// threads, so that a packet arriving on any of them finds the connection.
+//
+// Connection IDs are spread over a fixed number of shards, each guarded by its
+// own reader/writer lock. A shard keeps an open addressing table from
+// connection ID to entry and a ring buffer of the entries whose canonical
+// connection ID it holds, in the order they were added. Since every entry
+// stays for the same time wait period, that is also expiry order.
+//
+// Termination packets are interned, so byte-identical packets of different
+// connections are stored once.
+class QUIC_NO_EXPORT QuicTimeWaitStore {
+ public:
+  QuicTimeWaitStore();
+  QuicTimeWaitStore(const QuicTimeWaitStore&) = delete;
+  QuicTimeWaitStore& operator=(const QuicTimeWaitStore&) = delete;
+  ~QuicTimeWaitStore();
+
+  // Returns |packets|, or a previously interned identical set of packets which
+  // is still in use.
+  std::shared_ptr<const QuicTimeWaitTerminationPackets>
+  InternTerminationPackets(QuicTimeWaitTerminationPackets packets);
+
+  // Adds |entry| for all of its connection IDs, replacing existing mappings.
+  void Add(std::shared_ptr<QuicTimeWaitEntry> entry);
+
+  // Removes the mappings of all connection IDs of |entry| which still refer to
+  // it.
+  void Remove(const QuicTimeWaitEntry& entry);
+
+  // Returns the entry for |connection_id|, or nullptr.
+  std::shared_ptr<QuicTimeWaitEntry> Find(
+      const QuicConnectionId& connection_id) const;
+
+  bool Contains(const QuicConnectionId& connection_id) const;
+
+  // Removes the entries added at or before |expiration_time|. Returns the
+  // number of entries removed.
+  size_t ExpireEntries(QuicTime expiration_time);
+
+  // Removes the oldest entry. Returns false if the store is empty.
+  bool RemoveOldestEntry();
+
+  // Returns the time the oldest entry was added, if any.
+  absl::optional<QuicTime> OldestTimeAdded() const;
+
+  // Number of entries, i.e. connections, in the store.
+  size_t size() const { return num_entries_.load(std::memory_order_relaxed); }
+  bool empty() const { return size() == 0; }
+
+ private:
+  static constexpr size_t kNumShards = 16;
+
+  struct QUIC_NO_EXPORT Slot {
+    enum State : uint8_t { kEmpty, kFull, kDeleted };
+
+    State state = kEmpty;
+    QuicConnectionId connection_id;
+    std::shared_ptr<QuicTimeWaitEntry> entry;
+  };
+
+  struct QUIC_NO_EXPORT Shard {
+    Shard();
+    ~Shard();
+
+    // Returns the slot holding |connection_id|, or nullptr.
+    Slot* FindSlot(const QuicConnectionId& connection_id, size_t hash)
+        QUIC_SHARED_LOCKS_REQUIRED(mutex);
+    const Slot* FindSlot(const QuicConnectionId& connection_id,
+                         size_t hash) const QUIC_SHARED_LOCKS_REQUIRED(mutex);
+    // Returns the slot to store |connection_id| in, growing the table if
+    // needed.
+    Slot* FindOrInsertSlot(const QuicConnectionId& connection_id, size_t hash)
+        QUIC_EXCLUSIVE_LOCKS_REQUIRED(mutex);
+    void EraseSlot(Slot* slot) QUIC_EXCLUSIVE_LOCKS_REQUIRED(mutex);
+    void Rehash(size_t capacity) QUIC_EXCLUSIVE_LOCKS_REQUIRED(mutex);
+
+    // Whether |entry|'s canonical connection ID still maps to it.
+    bool IsLive(const QuicTimeWaitEntry& entry) const
+        QUIC_SHARED_LOCKS_REQUIRED(mutex);
+
+    mutable QuicMutex mutex;
+    // Power of two sized.
+    std::vector<Slot> slots QUIC_GUARDED_BY(mutex);
+    size_t num_full QUIC_GUARDED_BY(mutex) = 0;
+    size_t num_deleted QUIC_GUARDED_BY(mutex) = 0;
+    // Entries whose canonical connection ID is in this shard, oldest first.
+    // Entries which have been removed or replaced are dropped lazily.
+    quiche::QuicheCircularDeque<std::shared_ptr<QuicTimeWaitEntry>>
+        expiry_ring QUIC_GUARDED_BY(mutex);
+  };
+
+  static size_t ShardIndex(size_t hash) { return hash % kNumShards; }
+
+  // Removes the oldest live entry of |shard| if it was added at or before
+  // |expiration_time|, and returns it.
+  std::shared_ptr<QuicTimeWaitEntry> PopOldestEntry(Shard* shard,
+                                                    QuicTime expiration_time);
+
+  // Removes the mappings of the non-canonical connection IDs of |entry| which
+  // still refer to it.
+  void RemoveNonCanonicalConnectionIds(const QuicTimeWaitEntry& entry);
+
+  // Drops interned packets which are no longer used by any entry.
+  void SweepInternedPackets() QUIC_EXCLUSIVE_LOCKS_REQUIRED(intern_mutex_);
+
+  std::array<Shard, kNumShards> shards_;
+  std::atomic<size_t> num_entries_{0};
+  std::atomic<uint64_t> next_sequence_number_{0};
+
+  QuicMutex intern_mutex_;
+  // Keyed by a hash of the packets' contents.
+  absl::flat_hash_map<size_t,
+                      std::weak_ptr<const QuicTimeWaitTerminationPackets>>
+      interned_packets_ QUIC_GUARDED_BY(intern_mutex_);
+  size_t next_intern_sweep_size_ QUIC_GUARDED_BY(intern_mutex_);
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_TIME_WAIT_STORE_H_
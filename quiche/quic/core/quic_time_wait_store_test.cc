@@ -0,0 +1,201 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_time_wait_store.h"
+
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+QuicTime TimeAt(int64_t ms) {
+  return QuicTime::Zero() + QuicTime::Delta::FromMilliseconds(ms);
+}
+
+class QuicTimeWaitStoreTest : public QuicTest {
+ protected:
+  std::shared_ptr<QuicTimeWaitEntry> Add(
+      std::vector<QuicConnectionId> connection_ids, QuicTime time_added,
+      QuicTimeWaitTerminationPackets termination_packets = {}) {
+    auto entry = std::make_shared<QuicTimeWaitEntry>(
+        time_added, QuicTimeWaitListManager::SEND_STATELESS_RESET,
+        /*ietf_quic=*/true, QuicTime::Delta::Zero(), std::move(connection_ids),
+        store_.InternTerminationPackets(std::move(termination_packets)),
+        /*num_packets=*/0);
+    store_.Add(entry);
+    return entry;
+  }
+
+  QuicTimeWaitStore store_;
+};
+
+TEST_F(QuicTimeWaitStoreTest, AddFindAndRemove) {
+  EXPECT_TRUE(store_.empty());
+  EXPECT_FALSE(store_.OldestTimeAdded().has_value());
+
+  std::shared_ptr<QuicTimeWaitEntry> entry =
+      Add({TestConnectionId(1), TestConnectionId(2)}, TimeAt(1));
+  EXPECT_EQ(1u, store_.size());
+  EXPECT_EQ(entry, store_.Find(TestConnectionId(1)));
+  EXPECT_EQ(entry, store_.Find(TestConnectionId(2)));
+  EXPECT_FALSE(store_.Contains(TestConnectionId(3)));
+  EXPECT_EQ(TimeAt(1), store_.OldestTimeAdded());
+
+  store_.Remove(*entry);
+  EXPECT_TRUE(store_.empty());
+  EXPECT_FALSE(store_.Contains(TestConnectionId(1)));
+  EXPECT_FALSE(store_.Contains(TestConnectionId(2)));
+  EXPECT_FALSE(store_.OldestTimeAdded().has_value());
+}
+
+TEST_F(QuicTimeWaitStoreTest, ReplacingCanonicalConnectionIdRemovesEntry) {
+  Add({TestConnectionId(1), TestConnectionId(2)}, TimeAt(1));
+  std::shared_ptr<QuicTimeWaitEntry> entry =
+      Add({TestConnectionId(1)}, TimeAt(2));
+
+  EXPECT_EQ(1u, store_.size());
+  EXPECT_EQ(entry, store_.Find(TestConnectionId(1)));
+  EXPECT_FALSE(store_.Contains(TestConnectionId(2)));
+  EXPECT_EQ(TimeAt(2), store_.OldestTimeAdded());
+}
+
+TEST_F(QuicTimeWaitStoreTest, ExpireEntries) {
+  for (int i = 1; i <= 10; ++i) {
+    Add({TestConnectionId(i), TestConnectionId(100 + i)}, TimeAt(i));
+  }
+  EXPECT_EQ(10u, store_.size());
+
+  EXPECT_EQ(4u, store_.ExpireEntries(TimeAt(4)));
+  EXPECT_EQ(6u, store_.size());
+  EXPECT_EQ(TimeAt(5), store_.OldestTimeAdded());
+  for (int i = 1; i <= 10; ++i) {
+    EXPECT_EQ(i > 4, store_.Contains(TestConnectionId(i)));
+    EXPECT_EQ(i > 4, store_.Contains(TestConnectionId(100 + i)));
+  }
+
+  EXPECT_EQ(0u, store_.ExpireEntries(TimeAt(4)));
+  EXPECT_EQ(6u, store_.ExpireEntries(QuicTime::Infinite()));
+  EXPECT_TRUE(store_.empty());
+}
+
+TEST_F(QuicTimeWaitStoreTest, RemoveOldestEntryInAddOrder) {
+  // All entries are added at the same time, so only the order of addition
+  // tells them apart.
+  for (int i = 1; i <= 100; ++i) {
+    Add({TestConnectionId(i)}, TimeAt(1));
+  }
+  for (int i = 1; i <= 100; ++i) {
+    EXPECT_TRUE(store_.Contains(TestConnectionId(i)));
+    EXPECT_TRUE(store_.RemoveOldestEntry());
+    EXPECT_FALSE(store_.Contains(TestConnectionId(i)));
+  }
+  EXPECT_FALSE(store_.RemoveOldestEntry());
+}
+
+TEST_F(QuicTimeWaitStoreTest, RemovedEntriesAreSkipped) {
+  std::shared_ptr<QuicTimeWaitEntry> first = Add({TestConnectionId(1)},
+                                                 TimeAt(1));
+  Add({TestConnectionId(2)}, TimeAt(2));
+  store_.Remove(*first);
+  EXPECT_EQ(TimeAt(2), store_.OldestTimeAdded());
+  EXPECT_EQ(0u, store_.ExpireEntries(TimeAt(1)));
+  EXPECT_EQ(1u, store_.size());
+}
+
+TEST_F(QuicTimeWaitStoreTest, TableGrowsAndShrinks) {
+  constexpr int kNumEntries = 10000;
+  for (int i = 0; i < kNumEntries; ++i) {
+    Add({TestConnectionId(i)}, TimeAt(i));
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumEntries), store_.size());
+  for (int i = 0; i < kNumEntries; ++i) {
+    EXPECT_TRUE(store_.Contains(TestConnectionId(i)));
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumEntries - 1),
+            store_.ExpireEntries(TimeAt(kNumEntries - 2)));
+  EXPECT_TRUE(store_.Contains(TestConnectionId(kNumEntries - 1)));
+  EXPECT_FALSE(store_.Contains(TestConnectionId(0)));
+}
+
+TEST_F(QuicTimeWaitStoreTest, IdenticalTerminationPacketsAreShared) {
+  auto make_packets = [](const std::string& data) {
+    QuicTimeWaitTerminationPackets packets;
+    packets.push_back(std::make_unique<QuicEncryptedPacket>(data.data(),
+                                                            data.length()));
+    return packets;
+  };
+  std::shared_ptr<const QuicTimeWaitTerminationPackets> a =
+      store_.InternTerminationPackets(make_packets("close"));
+  std::shared_ptr<const QuicTimeWaitTerminationPackets> b =
+      store_.InternTerminationPackets(make_packets("close"));
+  std::shared_ptr<const QuicTimeWaitTerminationPackets> c =
+      store_.InternTerminationPackets(make_packets("other"));
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  ASSERT_EQ(1u, a->size());
+  EXPECT_EQ("close", a->front()->AsStringPiece());
+}
+
+class AddingThread : public QuicThread {
+ public:
+  AddingThread(QuicTimeWaitStore* store, uint64_t first_connection_id,
+               int num_entries)
+      : QuicThread("AddingThread"),
+        store_(store),
+        first_connection_id_(first_connection_id),
+        num_entries_(num_entries) {}
+
+  void Run() override {
+    for (int i = 0; i < num_entries_; ++i) {
+      const QuicConnectionId connection_id =
+          TestConnectionId(first_connection_id_ + i);
+      store_->Add(std::make_shared<QuicTimeWaitEntry>(
+          TimeAt(i), QuicTimeWaitListManager::SEND_STATELESS_RESET,
+          /*ietf_quic=*/true, QuicTime::Delta::Zero(),
+          std::vector<QuicConnectionId>{connection_id},
+          store_->InternTerminationPackets({}), /*num_packets=*/0));
+      if (store_->Contains(connection_id)) {
+        ++found_;
+      }
+    }
+  }
+
+  int found() const { return found_; }
+
+ private:
+  QuicTimeWaitStore* store_;
+  const uint64_t first_connection_id_;
+  const int num_entries_;
+  int found_ = 0;
+};
+
+TEST_F(QuicTimeWaitStoreTest, ConcurrentAdds) {
+  constexpr int kNumThreads = 4;
+  constexpr int kEntriesPerThread = 1000;
+  std::vector<std::unique_ptr<AddingThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(std::make_unique<AddingThread>(
+        &store_, i * kEntriesPerThread, kEntriesPerThread));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads) {
+    thread->Join();
+    EXPECT_EQ(kEntriesPerThread, thread->found());
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kEntriesPerThread),
+            store_.size());
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kEntriesPerThread),
+            store_.ExpireEntries(QuicTime::Infinite()));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
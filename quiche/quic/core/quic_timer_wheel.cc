@@ -0,0 +1,232 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_timer_wheel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "absl/numeric/bits.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+// Unlinks |link| from the circular list it is in.
+void Unlink(QuicTimerWheel::Link* link) {
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+  link->prev = nullptr;
+  link->next = nullptr;
+}
+
+// Links |link| at the back of the circular list headed by |head|.
+void PushBack(QuicTimerWheel::Link* head, QuicTimerWheel::Link* link) {
+  link->prev = head->prev;
+  link->next = head;
+  head->prev->next = link;
+  head->prev = link;
+}
+
+// Moves all links of the list headed by |from| to the empty list |to|.
+void MoveList(QuicTimerWheel::Link* from, QuicTimerWheel::Link* to) {
+  QUICHE_DCHECK_EQ(to->next, to);
+  if (from->next == from) {
+    return;
+  }
+  to->next = from->next;
+  to->prev = from->prev;
+  to->next->prev = to;
+  to->prev->next = to;
+  from->next = from;
+  from->prev = from;
+}
+
+}  // namespace
+
+QuicTimerWheel::Timer::~Timer() {
+  if (wheel_ != nullptr) {
+    wheel_->Cancel(this);
+  }
+}
+
+QuicTimerWheel::Level::Level() {
+  for (Link& slot : slots) {
+    slot.prev = &slot;
+    slot.next = &slot;
+  }
+}
+
+QuicTimerWheel::QuicTimerWheel(QuicTime now, QuicTime::Delta tick)
+    : tick_(tick) {
+  QUICHE_DCHECK_GT(tick_.ToMicroseconds(), 0);
+  current_tick_ = TickFloor(now);
+}
+
+QuicTimerWheel::~QuicTimerWheel() {
+  for (Level& level : levels_) {
+    for (Link& slot : level.slots) {
+      while (slot.next != &slot) {
+        Timer* timer = static_cast<Timer*>(slot.next);
+        Unlink(timer);
+        timer->wheel_ = nullptr;
+      }
+    }
+  }
+}
+
+uint64_t QuicTimerWheel::TickCeil(QuicTime time) const {
+  const uint64_t us = (time - QuicTime::Zero()).ToMicroseconds();
+  const uint64_t tick_us = tick_.ToMicroseconds();
+  return us / tick_us + (us % tick_us != 0 ? 1 : 0);
+}
+
+uint64_t QuicTimerWheel::TickFloor(QuicTime time) const {
+  return (time - QuicTime::Zero()).ToMicroseconds() / tick_.ToMicroseconds();
+}
+
+void QuicTimerWheel::Schedule(Timer* timer, QuicTime deadline) {
+  if (timer->wheel_ != nullptr && timer->wheel_ != this) {
+    QUIC_BUG(quic_timer_wheel_timer_on_other_wheel)
+        << "Timer is scheduled on another wheel";
+    return;
+  }
+  if (timer->wheel_ == this) {
+    Remove(timer);
+  } else {
+    timer->wheel_ = this;
+    ++size_;
+  }
+  // Deadlines in the past expire on the next tick.
+  timer->expiry_tick_ = std::max(TickCeil(deadline), current_tick_ + 1);
+  Insert(timer);
+}
+
+void QuicTimerWheel::Cancel(Timer* timer) {
+  if (timer->wheel_ != this) {
+    QUIC_BUG_IF(quic_timer_wheel_cancel_on_other_wheel,
+                timer->wheel_ != nullptr)
+        << "Timer is scheduled on another wheel";
+    return;
+  }
+  Remove(timer);
+  timer->wheel_ = nullptr;
+  --size_;
+}
+
+void QuicTimerWheel::Insert(Timer* timer) {
+  QUICHE_DCHECK_GE(timer->expiry_tick_, current_tick_);
+  uint64_t ticks_ahead = timer->expiry_tick_ - current_tick_;
+  uint64_t placement_tick = timer->expiry_tick_;
+  if (ticks_ahead >= kMaxTicksAhead) {
+    // Park the timer in the top level slot which is cascaded last; it is
+    // reinserted with its real expiry tick then.
+    placement_tick = current_tick_ + kMaxTicksAhead - 1;
+    ticks_ahead = kMaxTicksAhead - 1;
+  }
+  int level = 0;
+  while (ticks_ahead >= (uint64_t{1} << (kBitsPerLevel * (level + 1)))) {
+    ++level;
+  }
+  const int slot = (placement_tick >> (kBitsPerLevel * level)) & kSlotMask;
+  timer->level_ = level;
+  timer->slot_ = slot;
+  PushBack(&levels_[level].slots[slot], timer);
+  levels_[level].occupied |= uint64_t{1} << slot;
+}
+
+void QuicTimerWheel::Remove(Timer* timer) {
+  Unlink(timer);
+  Level& level = levels_[timer->level_];
+  Link& slot = level.slots[timer->slot_];
+  if (slot.next == &slot) {
+    level.occupied &= ~(uint64_t{1} << timer->slot_);
+  }
+}
+
+uint64_t QuicTimerWheel::NextEventTick() const {
+  uint64_t next = std::numeric_limits<uint64_t>::max();
+  for (int level = 0; level < kNumLevels; ++level) {
+    const uint64_t occupied = levels_[level].occupied;
+    if (occupied == 0) {
+      continue;
+    }
+    // Slots are visited in order starting right after the current one; a
+    // timer in the current slot of an upper level is a full turn away.
+    const int shift = kBitsPerLevel * level;
+    const uint64_t current = current_tick_ >> shift;
+    const int start = (current + 1) & kSlotMask;
+    const uint64_t rotated = absl::rotr(occupied, start);
+    const uint64_t distance = absl::countr_zero(rotated) + 1;
+    next = std::min(next, (current + distance) << shift);
+  }
+  return next;
+}
+
+QuicTime QuicTimerWheel::NextDeadline() const {
+  const uint64_t next = NextEventTick();
+  if (next == std::numeric_limits<uint64_t>::max()) {
+    return QuicTime::Infinite();
+  }
+  return QuicTime::Zero() +
+         QuicTime::Delta::FromMicroseconds(tick_.ToMicroseconds() * next);
+}
+
+void QuicTimerWheel::Advance(QuicTime now) {
+  const uint64_t target_tick = TickFloor(now);
+  while (!empty()) {
+    const uint64_t next = NextEventTick();
+    if (next > target_tick) {
+      break;
+    }
+    current_tick_ = next;
+    // Cascade the upper levels first, so that timers due at |next| end up in
+    // level 0 before it is expired.
+    for (int level = kNumLevels - 1; level > 0; --level) {
+      const int shift = kBitsPerLevel * level;
+      if ((next & ((uint64_t{1} << shift) - 1)) == 0) {
+        Cascade(level, (next >> shift) & kSlotMask);
+      }
+    }
+    Expire(next & kSlotMask);
+  }
+  current_tick_ = std::max(current_tick_, target_tick);
+}
+
+void QuicTimerWheel::Cascade(int level, int slot) {
+  Link timers;
+  timers.prev = &timers;
+  timers.next = &timers;
+  MoveList(&levels_[level].slots[slot], &timers);
+  levels_[level].occupied &= ~(uint64_t{1} << slot);
+  while (timers.next != &timers) {
+    Timer* timer = static_cast<Timer*>(timers.next);
+    Unlink(timer);
+    Insert(timer);
+  }
+}
+
+void QuicTimerWheel::Expire(int slot) {
+  Link expired;
+  expired.prev = &expired;
+  expired.next = &expired;
+  MoveList(&levels_[0].slots[slot], &expired);
+  levels_[0].occupied &= ~(uint64_t{1} << slot);
+  // OnExpired() may schedule or cancel any timer, including ones still in
+  // |expired|. Cancelling those is safe: newly scheduled timers are due after
+  // the current tick, so they never land in the level 0 slot being expired.
+  while (expired.next != &expired) {
+    Timer* timer = static_cast<Timer*>(expired.next);
+    QUICHE_DCHECK_EQ(timer->expiry_tick_, current_tick_);
+    Unlink(timer);
+    timer->wheel_ = nullptr;
+    --size_;
+    timer->OnExpired();
+  }
+}
+
+}  // namespace quic
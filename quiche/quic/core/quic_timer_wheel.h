@@ -0,0 +1,134 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_TIMER_WHEEL_H_
+#define QUICHE_QUIC_CORE_QUIC_TIMER_WHEEL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Hierarchical timing wheel (Varghese & Lauck). Time is divided into ticks of
+// a fixed length; timers are kept in intrusive lists hashed by the bits of
+// their expiry tick, six bits per level, so that scheduling and cancelling a
+// timer is O(1) and does not allocate. Timers in the upper levels are moved
+// down ("cascaded") as the wheel turns.
+//
+// Timers never expire early: a deadline is rounded up to the next tick, and
+// expires on the first call to Advance() at or after that tick. Deadlines more
+// than 2^36 ticks in the future are supported but are cascaded through the top
+// level more than once.
+//
+// Not thread-safe.
+class QUIC_EXPORT_PRIVATE QuicTimerWheel {
+ public:
+  // Intrusive list link. Slot lists are circular with a sentinel Link.
+  struct QUIC_EXPORT_PRIVATE Link {
+    Link* prev = nullptr;
+    Link* next = nullptr;
+  };
+
+  // Base class of timers scheduled on a wheel. A timer is cancelled when it is
+  // destroyed.
+  class QUIC_EXPORT_PRIVATE Timer : private Link {
+   public:
+    Timer() = default;
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+    virtual ~Timer();
+
+    bool IsScheduled() const { return wheel_ != nullptr; }
+
+   protected:
+    // Called from QuicTimerWheel::Advance() once the timer's deadline has
+    // passed. The timer is no longer scheduled and may reschedule itself.
+    virtual void OnExpired() = 0;
+
+   private:
+    friend class QuicTimerWheel;
+
+    QuicTimerWheel* wheel_ = nullptr;  // Unowned, set while scheduled.
+    uint64_t expiry_tick_ = 0;
+    uint8_t level_ = 0;
+    uint8_t slot_ = 0;
+  };
+
+  // |now| is the time the wheel starts turning at, |tick| its resolution.
+  QuicTimerWheel(QuicTime now, QuicTime::Delta tick);
+  QuicTimerWheel(const QuicTimerWheel&) = delete;
+  QuicTimerWheel& operator=(const QuicTimerWheel&) = delete;
+  // Unschedules all remaining timers without running them.
+  ~QuicTimerWheel();
+
+  // Schedules |timer| to expire at |deadline|, replacing any deadline it was
+  // scheduled with before. |timer| may be scheduled on at most one wheel.
+  void Schedule(Timer* timer, QuicTime deadline);
+
+  // Unschedules |timer|. No-op if it is not scheduled.
+  void Cancel(Timer* timer);
+
+  // Turns the wheel to |now| and runs all timers whose deadline is at or
+  // before |now|, in deadline order (at tick resolution).
+  void Advance(QuicTime now);
+
+  // Returns the earliest time at which Advance() has work to do, either
+  // expiring timers or cascading them to a lower level, or
+  // QuicTime::Infinite() if no timer is scheduled.
+  QuicTime NextDeadline() const;
+
+  // Number of scheduled timers.
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  QuicTime::Delta tick() const { return tick_; }
+
+ private:
+  static constexpr int kBitsPerLevel = 6;
+  static constexpr int kSlotsPerLevel = 1 << kBitsPerLevel;
+  static constexpr int kNumLevels = 6;
+  static constexpr uint64_t kSlotMask = kSlotsPerLevel - 1;
+  static constexpr uint64_t kMaxTicksAhead = uint64_t{1}
+                                             << (kBitsPerLevel * kNumLevels);
+
+  struct QUIC_EXPORT_PRIVATE Level {
+    Level();
+
+    std::array<Link, kSlotsPerLevel> slots;
+    // Bit i is set iff slots[i] is not empty.
+    uint64_t occupied = 0;
+  };
+
+  // Converts |time| to a tick, rounding up or down.
+  uint64_t TickCeil(QuicTime time) const;
+  uint64_t TickFloor(QuicTime time) const;
+
+  // Links |timer|, whose |expiry_tick_| must not be earlier than
+  // |current_tick_|, into the slot matching its expiry tick.
+  void Insert(Timer* timer);
+  // Unlinks |timer| from its slot.
+  void Remove(Timer* timer);
+
+  // Returns the next tick at which a timer expires or is cascaded, or
+  // UINT64_MAX if no timer is scheduled.
+  uint64_t NextEventTick() const;
+
+  // Moves the timers in |slot| of |level| to the lower levels.
+  void Cascade(int level, int slot);
+  // Runs the timers in |slot| of level 0.
+  void Expire(int slot);
+
+  const QuicTime::Delta tick_;
+  uint64_t current_tick_;
+  size_t size_ = 0;
+  std::array<Level, kNumLevels> levels_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_TIMER_WHEEL_H_
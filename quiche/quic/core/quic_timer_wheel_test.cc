@@ -0,0 +1,237 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_timer_wheel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class TestTimer : public QuicTimerWheel::Timer {
+ public:
+  TestTimer(int id, std::vector<int>* expired) : id_(id), expired_(expired) {}
+
+  void set_on_expired(std::function<void()> on_expired) {
+    on_expired_ = std::move(on_expired);
+  }
+
+ protected:
+  void OnExpired() override {
+    expired_->push_back(id_);
+    if (on_expired_) {
+      on_expired_();
+    }
+  }
+
+ private:
+  const int id_;
+  std::vector<int>* expired_;
+  std::function<void()> on_expired_;
+};
+
+class QuicTimerWheelTest : public QuicTest {
+ protected:
+  QuicTimerWheelTest()
+      : start_(QuicTime::Zero() + QuicTime::Delta::FromSeconds(100)),
+        wheel_(start_, QuicTime::Delta::FromMilliseconds(1)) {}
+
+  QuicTime Ms(int64_t ms) const {
+    return start_ + QuicTime::Delta::FromMilliseconds(ms);
+  }
+
+  const QuicTime start_;
+  QuicTimerWheel wheel_;
+  std::vector<int> expired_;
+};
+
+TEST_F(QuicTimerWheelTest, ExpiresAtDeadline) {
+  TestTimer timer(1, &expired_);
+  EXPECT_EQ(QuicTime::Infinite(), wheel_.NextDeadline());
+  wheel_.Schedule(&timer, Ms(10));
+  EXPECT_TRUE(timer.IsScheduled());
+  EXPECT_EQ(1u, wheel_.size());
+  EXPECT_EQ(Ms(10), wheel_.NextDeadline());
+
+  wheel_.Advance(Ms(9));
+  EXPECT_TRUE(expired_.empty());
+  wheel_.Advance(Ms(10));
+  EXPECT_EQ(std::vector<int>({1}), expired_);
+  EXPECT_FALSE(timer.IsScheduled());
+  EXPECT_TRUE(wheel_.empty());
+  EXPECT_EQ(QuicTime::Infinite(), wheel_.NextDeadline());
+}
+
+TEST_F(QuicTimerWheelTest, DeadlinesAreRoundedUp) {
+  TestTimer timer(1, &expired_);
+  wheel_.Schedule(&timer, Ms(10) + QuicTime::Delta::FromMicroseconds(1));
+  EXPECT_EQ(Ms(11), wheel_.NextDeadline());
+  wheel_.Advance(Ms(10) + QuicTime::Delta::FromMicroseconds(999));
+  EXPECT_TRUE(expired_.empty());
+  wheel_.Advance(Ms(11));
+  EXPECT_EQ(std::vector<int>({1}), expired_);
+}
+
+TEST_F(QuicTimerWheelTest, PastDeadlineExpiresOnNextTick) {
+  TestTimer timer(1, &expired_);
+  wheel_.Schedule(&timer, start_ - QuicTime::Delta::FromSeconds(1));
+  EXPECT_EQ(Ms(1), wheel_.NextDeadline());
+  wheel_.Advance(Ms(1));
+  EXPECT_EQ(std::vector<int>({1}), expired_);
+}
+
+TEST_F(QuicTimerWheelTest, ExpiresInDeadlineOrder) {
+  TestTimer timer1(1, &expired_);
+  TestTimer timer2(2, &expired_);
+  TestTimer timer3(3, &expired_);
+  wheel_.Schedule(&timer1, Ms(5000));
+  wheel_.Schedule(&timer2, Ms(30));
+  wheel_.Schedule(&timer3, Ms(70));
+  wheel_.Advance(Ms(10000));
+  EXPECT_EQ(std::vector<int>({2, 3, 1}), expired_);
+}
+
+TEST_F(QuicTimerWheelTest, CancelAndReschedule) {
+  TestTimer timer1(1, &expired_);
+  TestTimer timer2(2, &expired_);
+  wheel_.Schedule(&timer1, Ms(10));
+  wheel_.Schedule(&timer2, Ms(20));
+  wheel_.Cancel(&timer1);
+  EXPECT_FALSE(timer1.IsScheduled());
+  EXPECT_EQ(1u, wheel_.size());
+  // Cancelling twice is a no-op.
+  wheel_.Cancel(&timer1);
+
+  wheel_.Schedule(&timer2, Ms(200));
+  EXPECT_EQ(1u, wheel_.size());
+  wheel_.Advance(Ms(199));
+  EXPECT_TRUE(expired_.empty());
+  wheel_.Advance(Ms(200));
+  EXPECT_EQ(std::vector<int>({2}), expired_);
+}
+
+TEST_F(QuicTimerWheelTest, DestroyedTimerIsCancelled) {
+  auto timer = std::make_unique<TestTimer>(1, &expired_);
+  wheel_.Schedule(timer.get(), Ms(10));
+  timer.reset();
+  EXPECT_TRUE(wheel_.empty());
+  wheel_.Advance(Ms(10));
+  EXPECT_TRUE(expired_.empty());
+}
+
+TEST_F(QuicTimerWheelTest, ExpiryCallbackSchedulesAndCancels) {
+  TestTimer timer1(1, &expired_);
+  TestTimer timer2(2, &expired_);
+  TestTimer timer3(3, &expired_);
+  // All three are due at the same tick. The first one to run reschedules
+  // itself and cancels the others.
+  timer1.set_on_expired([&] {
+    wheel_.Schedule(&timer1, Ms(20));
+    wheel_.Cancel(&timer2);
+    wheel_.Cancel(&timer3);
+  });
+  wheel_.Schedule(&timer1, Ms(10));
+  wheel_.Schedule(&timer2, Ms(10));
+  wheel_.Schedule(&timer3, Ms(10));
+  wheel_.Advance(Ms(10));
+  EXPECT_EQ(std::vector<int>({1}), expired_);
+  EXPECT_EQ(1u, wheel_.size());
+  timer1.set_on_expired(nullptr);
+  wheel_.Advance(Ms(20));
+  EXPECT_EQ(std::vector<int>({1, 1}), expired_);
+}
+
+TEST_F(QuicTimerWheelTest, VeryDistantDeadline) {
+  TestTimer timer(1, &expired_);
+  // More than 2^36 ticks ahead.
+  const QuicTime deadline =
+      start_ + QuicTime::Delta::FromMilliseconds((int64_t{1} << 37) + 5);
+  wheel_.Schedule(&timer, deadline);
+  wheel_.Advance(deadline - QuicTime::Delta::FromMilliseconds(1));
+  EXPECT_TRUE(expired_.empty());
+  EXPECT_EQ(deadline, wheel_.NextDeadline());
+  wheel_.Advance(deadline);
+  EXPECT_EQ(std::vector<int>({1}), expired_);
+}
+
+// Compares the wheel against a plain list of deadlines under a random mix of
+// schedules, cancels and advances.
+TEST_F(QuicTimerWheelTest, MatchesReference) {
+  constexpr int kNumTimers = 200;
+  std::mt19937_64 random(0x5eed);
+  std::vector<std::unique_ptr<TestTimer>> timers;
+  std::vector<absl::optional<int64_t>> deadlines(kNumTimers);
+  for (int i = 0; i < kNumTimers; ++i) {
+    timers.push_back(std::make_unique<TestTimer>(i, &expired_));
+  }
+
+  int64_t now = 0;
+  for (int step = 0; step < 20000; ++step) {
+    const int i = random() % kNumTimers;
+    switch (random() % 4) {
+      case 0:
+      case 1: {
+        // Spread deadlines over several wheel levels.
+        const int64_t delay = random() % (int64_t{1} << (random() % 20));
+        deadlines[i] = now + 1 + delay;
+        wheel_.Schedule(timers[i].get(), Ms(*deadlines[i]));
+        break;
+      }
+      case 2:
+        deadlines[i].reset();
+        wheel_.Cancel(timers[i].get());
+        break;
+      case 3: {
+        now += random() % 2000;
+        std::map<int, int64_t> due;
+        for (int j = 0; j < kNumTimers; ++j) {
+          if (deadlines[j].has_value() && *deadlines[j] <= now) {
+            due[j] = *deadlines[j];
+            deadlines[j].reset();
+          }
+        }
+        expired_.clear();
+        wheel_.Advance(Ms(now));
+        // Every due timer expires exactly once, in deadline order.
+        ASSERT_EQ(due.size(), expired_.size());
+        int64_t last_deadline = 0;
+        for (int id : expired_) {
+          ASSERT_EQ(1u, due.count(id)) << "Timer " << id << " expired early";
+          ASSERT_LE(last_deadline, due[id]);
+          last_deadline = due[id];
+          ASSERT_FALSE(timers[id]->IsScheduled());
+        }
+        break;
+      }
+    }
+    size_t scheduled = 0;
+    int64_t earliest = INT64_MAX;
+    for (const auto& deadline : deadlines) {
+      if (deadline.has_value()) {
+        ++scheduled;
+        earliest = std::min(earliest, *deadline);
+      }
+    }
+    ASSERT_EQ(scheduled, wheel_.size());
+    if (scheduled > 0) {
+      // NextDeadline() may be earlier than the earliest timer when it is due
+      // to be cascaded, but never later.
+      ASSERT_LE(wheel_.NextDeadline(), Ms(earliest));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -4,7 +4,10 @@
 
 #include "quiche/quic/core/quic_transmission_info.h"
 
+#include <limits>
+
 #include "absl/strings/str_cat.h"
+#include "quiche/quic/platform/api/quic_logging.h"
 
 namespace quic {
 
@@ -13,10 +16,12 @@ QuicTransmissionInfo::QuicTransmissionInfo()
       bytes_sent(0),
       encryption_level(ENCRYPTION_INITIAL),
       transmission_type(NOT_RETRANSMISSION),
-      in_flight(false),
       state(OUTSTANDING),
+      in_flight(false),
       has_crypto_handshake(false),
-      has_ack_frequency(false) {}
+      has_ack_frequency(false),
+      num_retransmittable_frames_(0),
+      retransmittable_frames_(nullptr) {}
 
 QuicTransmissionInfo::QuicTransmissionInfo(EncryptionLevel level,
                                            TransmissionType transmission_type,
@@ -28,16 +33,80 @@ QuicTransmissionInfo::QuicTransmissionInfo(EncryptionLevel level,
       bytes_sent(bytes_sent),
       encryption_level(level),
       transmission_type(transmission_type),
-      in_flight(false),
       state(OUTSTANDING),
+      in_flight(false),
       has_crypto_handshake(has_crypto_handshake),
-      has_ack_frequency(has_ack_frequency) {}
+      has_ack_frequency(has_ack_frequency),
+      num_retransmittable_frames_(0),
+      retransmittable_frames_(nullptr) {}
 
-QuicTransmissionInfo::QuicTransmissionInfo(const QuicTransmissionInfo& other) =
-    default;
+QuicTransmissionInfo::QuicTransmissionInfo(QuicTransmissionInfo&& other)
+    : sent_time(other.sent_time),
+      bytes_sent(other.bytes_sent),
+      encryption_level(other.encryption_level),
+      transmission_type(other.transmission_type),
+      state(other.state),
+      in_flight(other.in_flight),
+      has_crypto_handshake(other.has_crypto_handshake),
+      has_ack_frequency(other.has_ack_frequency),
+      num_retransmittable_frames_(0),
+      retransmittable_frames_(nullptr) {
+  TakeRetransmittableFrames(&other);
+}
+
+QuicTransmissionInfo& QuicTransmissionInfo::operator=(
+    QuicTransmissionInfo&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  QUICHE_DCHECK_EQ(0u, num_retransmittable_frames_);
+  sent_time = other.sent_time;
+  bytes_sent = other.bytes_sent;
+  encryption_level = other.encryption_level;
+  transmission_type = other.transmission_type;
+  state = other.state;
+  in_flight = other.in_flight;
+  has_crypto_handshake = other.has_crypto_handshake;
+  has_ack_frequency = other.has_ack_frequency;
+  TakeRetransmittableFrames(&other);
+  return *this;
+}
 
 QuicTransmissionInfo::~QuicTransmissionInfo() {}
 
+void QuicTransmissionInfo::SetRetransmittableFrames(
+    absl::Span<const QuicFrame> frames, QuicFrameArena* arena) {
+  QUICHE_DCHECK_EQ(0u, num_retransmittable_frames_);
+  QUICHE_DCHECK_LE(frames.size(), std::numeric_limits<uint16_t>::max());
+  if (frames.size() == 1) {
+    retransmittable_frame_ = frames[0];
+  } else {
+    retransmittable_frames_ = arena->Copy(frames).data();
+  }
+  num_retransmittable_frames_ = static_cast<uint16_t>(frames.size());
+}
+
+void QuicTransmissionInfo::ClearRetransmittableFrames(QuicFrameArena* arena) {
+  if (num_retransmittable_frames_ > 1) {
+    arena->Free(
+        absl::MakeSpan(retransmittable_frames_, num_retransmittable_frames_));
+  }
+  num_retransmittable_frames_ = 0;
+  retransmittable_frames_ = nullptr;
+}
+
+void QuicTransmissionInfo::TakeRetransmittableFrames(
+    QuicTransmissionInfo* other) {
+  if (other->num_retransmittable_frames_ == 1) {
+    retransmittable_frame_ = other->retransmittable_frame_;
+  } else {
+    retransmittable_frames_ = other->retransmittable_frames_;
+  }
+  num_retransmittable_frames_ = other->num_retransmittable_frames_;
+  other->num_retransmittable_frames_ = 0;
+  other->retransmittable_frames_ = nullptr;
+}
+
 std::string QuicTransmissionInfo::DebugString() const {
   return absl::StrCat(
       "{sent_time: ", sent_time.ToDebuggingValue(),
@@ -47,10 +116,15 @@ std::string QuicTransmissionInfo::DebugString() const {
       ", in_flight: ", in_flight, ", state: ", state,
       ", has_crypto_handshake: ", has_crypto_handshake,
       ", has_ack_frequency: ", has_ack_frequency,
-      ", first_sent_after_loss: ", first_sent_after_loss.ToString(),
-      ", largest_acked: ", largest_acked.ToString(),
-      ", retransmittable_frames: ", QuicFramesToString(retransmittable_frames),
+      ", retransmittable_frames: ",
+      QuicFramesToString(retransmittable_frames()),
       "}");
 }
 
+std::string QuicTransmissionColdInfo::DebugString() const {
+  return absl::StrCat(
+      "{first_sent_after_loss: ", first_sent_after_loss.ToString(),
+      ", largest_acked: ", largest_acked.ToString(), "}");
+}
+
 }  // namespace quic
@@ -5,10 +5,13 @@
 #ifndef QUICHE_QUIC_CORE_QUIC_TRANSMISSION_INFO_H_
 #define QUICHE_QUIC_CORE_QUIC_TRANSMISSION_INFO_H_
 
+#include <cstdint>
 #include <list>
 
+#include "absl/types/span.h"
 #include "quiche/quic/core/frames/quic_frame.h"
 #include "quiche/quic/core/quic_ack_listener_interface.h"
+#include "quiche/quic/core/quic_frame_arena.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/platform/api/quic_export.h"
 
@@ -26,26 +29,90 @@ struct QUIC_EXPORT_PRIVATE QuicTransmissionInfo {
                        QuicPacketLength bytes_sent, bool has_crypto_handshake,
                        bool has_ack_frequency);
 
-  QuicTransmissionInfo(const QuicTransmissionInfo& other);
+  // Move-only, as retransmittable frames stored in a QuicFrameArena must be
+  // returned to it exactly once. Moving leaves |other| without retransmittable
+  // frames.
+  QuicTransmissionInfo(const QuicTransmissionInfo&) = delete;
+  QuicTransmissionInfo& operator=(const QuicTransmissionInfo&) = delete;
+  QuicTransmissionInfo(QuicTransmissionInfo&& other);
+  // This transmission must have no retransmittable frames.
+  QuicTransmissionInfo& operator=(QuicTransmissionInfo&& other);
 
   ~QuicTransmissionInfo();
 
   std::string DebugString() const;
 
-  QuicFrames retransmittable_frames;
+  // The retransmittable frames of this packet.
+  absl::Span<const QuicFrame> retransmittable_frames() const {
+    return absl::MakeConstSpan(retransmittable_frames_data(),
+                               num_retransmittable_frames_);
+  }
+  absl::Span<QuicFrame> mutable_retransmittable_frames() {
+    return absl::MakeSpan(retransmittable_frames_data(),
+                          num_retransmittable_frames_);
+  }
+
+  // Copies |frames| into this transmission, which must have no
+  // retransmittable frames. A single frame is stored inline, and more in
+  // storage allocated from |arena|.
+  void SetRetransmittableFrames(absl::Span<const QuicFrame> frames,
+                                QuicFrameArena* arena);
+
+  // Removes the retransmittable frames of this transmission, returning their
+  // storage to |arena|, which must be the arena they were set with. Does not
+  // delete the frames' contents.
+  void ClearRetransmittableFrames(QuicFrameArena* arena);
+
+  // Fields are ordered so that those read while processing acks and detecting
+  // losses come first, and no space is lost to padding.
   QuicTime sent_time;
   QuicPacketLength bytes_sent;
   EncryptionLevel encryption_level;
   // Reason why this packet was transmitted.
   TransmissionType transmission_type;
-  // In flight packets have not been abandoned or lost.
-  bool in_flight;
   // State of this packet.
   SentPacketState state;
+  // In flight packets have not been abandoned or lost.
+  bool in_flight : 1;
   // True if the packet contains stream data from the crypto stream.
-  bool has_crypto_handshake;
+  bool has_crypto_handshake : 1;
   // True if the packet contains ack frequency frame.
-  bool has_ack_frequency;
+  bool has_ack_frequency : 1;
+
+ private:
+  QuicFrame* retransmittable_frames_data() {
+    return num_retransmittable_frames_ == 1 ? &retransmittable_frame_
+                                            : retransmittable_frames_;
+  }
+  const QuicFrame* retransmittable_frames_data() const {
+    return num_retransmittable_frames_ == 1 ? &retransmittable_frame_
+                                            : retransmittable_frames_;
+  }
+
+  // Takes the retransmittable frames of |other|, leaving it with none.
+  void TakeRetransmittableFrames(QuicTransmissionInfo* other);
+
+  // Rather than a QuicFrames, which takes 32 bytes and a heap allocation for
+  // more than one frame, the common case of a single frame is stored in place
+  // and anything more in a QuicFrameArena.
+  uint16_t num_retransmittable_frames_;
+  union {
+    QuicFrame* retransmittable_frames_;
+    QuicFrame retransmittable_frame_;
+  };
+
+};
+// QuicUnackedPacketMap stores one of these per packet sent and not yet acked,
+// which may be tens of thousands on paths with a large bandwidth-delay product.
+static_assert(sizeof(QuicTransmissionInfo) <= 40,
+              "QuicTransmissionInfo should not grow");
+
+// Details of a single sent packet which are only read when the packet is
+// acked or declared lost. QuicUnackedPacketMap keeps them apart from the
+// QuicTransmissionInfos it walks on every ack, so that those stay small.
+struct QUIC_EXPORT_PRIVATE QuicTransmissionColdInfo {
+  std::string DebugString() const;
+
   // Records the first sent packet after this packet was detected lost. Zero if
   // this packet has not been detected lost. This is used to keep lost packet
   // for another RTT (for potential spurious loss detection)
@@ -53,11 +120,6 @@ struct QUIC_EXPORT_PRIVATE QuicTransmissionInfo {
   // The largest_acked in the ack frame, if the packet contains an ack.
   QuicPacketNumber largest_acked;
 };
-// TODO(ianswett): Add static_assert when size of this struct is reduced below
-// 64 bytes.
-// NOTE(vlovich): Existing static_assert removed because padding differences on
-// 64-bit iOS resulted in an 88-byte struct that is greater than the 84-byte
-// limit on other platforms.  Removing per ianswett's request.
 
 }  // namespace quic
 
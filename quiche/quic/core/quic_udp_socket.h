@@ -26,6 +26,9 @@ const QuicUdpSocketFd kQuicInvalidSocketFd = -1;
 
 const size_t kDefaultUdpPacketControlBufferSize = 512;
 
+// The largest buffer the kernel may return from a single UDP GRO read.
+const size_t kMaxGroPacketBufferSize = 64 * 1024;
+
 enum class QuicUdpPacketInfoBit : uint8_t {
   DROPPED_PACKETS = 0,   // Read
   V4_SELF_IP,            // Read
@@ -34,6 +37,7 @@ enum class QuicUdpPacketInfoBit : uint8_t {
   RECV_TIMESTAMP,        // Read
   TTL,                   // Read & Write
   GOOGLE_PACKET_HEADER,  // Read
+  GRO_SEGMENT_SIZE,      // Read
   NUM_BITS,
 };
 static_assert(static_cast<size_t>(QuicUdpPacketInfoBit::NUM_BITS) <=
@@ -142,6 +146,18 @@ class QUIC_EXPORT_PRIVATE QuicUdpPacketInfo {
     bitmask_.Set(QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER);
   }
 
+  // The size of each datagram within a buffer that the kernel coalesced with
+  // UDP GRO. All segments but the last one have exactly this size.
+  size_t gro_segment_size() const {
+    QUICHE_DCHECK(HasValue(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE));
+    return gro_segment_size_;
+  }
+
+  void SetGroSegmentSize(size_t gro_segment_size) {
+    gro_segment_size_ = gro_segment_size;
+    bitmask_.Set(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE);
+  }
+
  private:
   BitMask64 bitmask_;
   QuicPacketCount dropped_packets_;
@@ -151,6 +167,7 @@ class QUIC_EXPORT_PRIVATE QuicUdpPacketInfo {
   QuicWallTime receive_timestamp_ = QuicWallTime::Zero();
   int ttl_;
   BufferSpan google_packet_headers_;
+  size_t gro_segment_size_ = 0;
 };
 
 // QuicUdpSocketApi provides a minimal set of apis for sending and receiving
@@ -172,6 +189,11 @@ class QUIC_EXPORT_PRIVATE QuicUdpSocketApi {
   // Closes |fd|. No-op if |fd| equals to kQuicInvalidSocketFd.
   void Destroy(QuicUdpSocketFd fd);
 
+  // Allow several sockets to bind to the same address and port. Must be called
+  // before Bind(). The kernel then spreads incoming packets across those
+  // sockets by hashing the 4-tuple. Return true on success.
+  bool EnableReusePort(QuicUdpSocketFd fd);
+
   // Bind |fd| to |address|. If |address|'s port number is 0, kernel will choose
   // a random port to bind to. Caller can use QuicSocketAddress::FromSocket(fd)
   // to get the bound random port.
@@ -184,6 +206,14 @@ class QUIC_EXPORT_PRIVATE QuicUdpSocketApi {
   bool EnableReceiveTtlForV4(QuicUdpSocketFd fd);
   bool EnableReceiveTtlForV6(QuicUdpSocketFd fd);
 
+  // Enable UDP generic receive offload on |fd|. Once enabled, a single read may
+  // return several consecutive datagrams of the same flow coalesced into one
+  // buffer, and QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE reports the size of each
+  // of them. Callers must provide packet buffers of at least
+  // |kMaxGroPacketBufferSize| bytes. Return false if the kernel does not
+  // support UDP GRO, in which case reads stay one datagram per buffer.
+  bool EnableUdpGro(QuicUdpSocketFd fd);
+
   // Wait for |fd| to become readable, up to |timeout|.
   // Return true if |fd| is readable upon return.
   bool WaitUntilReadable(QuicUdpSocketFd fd, QuicTime::Delta timeout);
@@ -226,6 +256,12 @@ class QUIC_EXPORT_PRIVATE QuicUdpSocketApi {
                              BitMask64 packet_info_interested,
                              ReadPacketResults* results);
 
+  // Populates |packet_info| from the control messages received along with a
+  // packet by other means than ReadPacket(), e.g. an io_uring recvmsg.
+  void ParseControlMessages(char* control_buffer, size_t control_buffer_len,
+                            BitMask64 packet_info_interested,
+                            QuicUdpPacketInfo* packet_info);
+
   // Write a packet to |fd|.
   // packet_buffer, packet_buffer_len:  The packet buffer to write.
   // packet_info:                       The per packet information to set.
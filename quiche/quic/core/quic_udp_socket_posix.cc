@@ -26,6 +26,17 @@
 
 #if defined(__linux__) && !defined(__ANDROID__)
 #define QUIC_UDP_SOCKET_SUPPORT_TTL 1
+#define QUIC_UDP_SOCKET_SUPPORT_GRO 1
+#endif
+
+#if defined(QUIC_UDP_SOCKET_SUPPORT_GRO)
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
 #endif
 
 namespace quic {
@@ -51,12 +62,18 @@ const size_t kCmsgSpaceForRecvTimestamp =
 const size_t kCmsgSpaceForRecvTimestamp = 0;
 #endif
 
+#if defined(QUIC_UDP_SOCKET_SUPPORT_GRO)
+const size_t kCmsgSpaceForGroSegmentSize = CMSG_SPACE(sizeof(int));
+#else
+const size_t kCmsgSpaceForGroSegmentSize = 0;
+#endif
+
 const size_t kMinCmsgSpaceForRead =
     CMSG_SPACE(sizeof(uint32_t))       // Dropped packet count
     + CMSG_SPACE(sizeof(in_pktinfo))   // V4 Self IP
     + CMSG_SPACE(sizeof(in6_pktinfo))  // V6 Self IP
     + kCmsgSpaceForRecvTimestamp + CMSG_SPACE(sizeof(int))  // TTL
-    + kCmsgSpaceForGooglePacketHeader;
+    + kCmsgSpaceForGooglePacketHeader + kCmsgSpaceForGroSegmentSize;
 
 QuicUdpSocketFd CreateNonblockingSocket(int address_family) {
 #if defined(__linux__) && defined(SOCK_NONBLOCK)
@@ -149,6 +166,18 @@ void PopulatePacketInfoFromControlMessage(struct cmsghdr* cmsg,
   }
 #endif
 
+#if defined(QUIC_UDP_SOCKET_SUPPORT_GRO)
+  if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+    if (packet_info_interested.IsSet(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE)) {
+      int gso_size = *(reinterpret_cast<int*>(CMSG_DATA(cmsg)));
+      if (gso_size > 0) {
+        packet_info->SetGroSegmentSize(gso_size);
+      }
+    }
+    return;
+  }
+#endif
+
   if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
     if (packet_info_interested.IsSet(QuicUdpPacketInfoBit::V6_SELF_IP)) {
       const in6_pktinfo* info = reinterpret_cast<in6_pktinfo*>(CMSG_DATA(cmsg));
@@ -294,6 +323,17 @@ void QuicUdpSocketApi::Destroy(QuicUdpSocketFd fd) {
   }
 }
 
+bool QuicUdpSocketApi::EnableReusePort(QuicUdpSocketFd fd) {
+#if defined(SO_REUSEPORT)
+  int reuse_port = 1;
+  return 0 == setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse_port,
+                         sizeof(reuse_port));
+#else
+  (void)fd;
+  return false;
+#endif
+}
+
 bool QuicUdpSocketApi::Bind(QuicUdpSocketFd fd, QuicSocketAddress address) {
   sockaddr_storage addr = address.generic_address();
   int addr_len =
@@ -356,6 +396,21 @@ bool QuicUdpSocketApi::EnableReceiveTtlForV6(QuicUdpSocketFd fd) {
 #endif
 }
 
+bool QuicUdpSocketApi::EnableUdpGro(QuicUdpSocketFd fd) {
+#if defined(QUIC_UDP_SOCKET_SUPPORT_GRO)
+  int enable_gro = 1;
+  if (setsockopt(fd, SOL_UDP, UDP_GRO, &enable_gro, sizeof(enable_gro)) != 0) {
+    QUIC_LOG_FIRST_N(WARNING, 10)
+        << "Failed to enable UDP GRO: " << strerror(errno);
+    return false;
+  }
+  return true;
+#else
+  (void)fd;
+  return false;
+#endif
+}
+
 bool QuicUdpSocketApi::WaitUntilReadable(QuicUdpSocketFd fd,
                                          QuicTime::Delta timeout) {
   fd_set read_fds;
@@ -553,6 +608,21 @@ size_t QuicUdpSocketApi::ReadMultiplePackets(QuicUdpSocketFd fd,
 #endif
 }
 
+void QuicUdpSocketApi::ParseControlMessages(char* control_buffer,
+                                            size_t control_buffer_len,
+                                            BitMask64 packet_info_interested,
+                                            QuicUdpPacketInfo* packet_info) {
+  msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_control = control_buffer;
+  hdr.msg_controllen = control_buffer_len;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+    PopulatePacketInfoFromControlMessage(cmsg, packet_info,
+                                         packet_info_interested);
+  }
+}
+
 WriteResult QuicUdpSocketApi::WritePacket(
     QuicUdpSocketFd fd, const char* packet_buffer, size_t packet_buffer_len,
     const QuicUdpPacketInfo& packet_info) {
@@ -9,6 +9,7 @@
 #include <type_traits>
 
 #include "absl/container/inlined_vector.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/quic_connection_stats.h"
 #include "quiche/quic/core/quic_packet_number.h"
 #include "quiche/quic/core/quic_types.h"
@@ -127,7 +128,7 @@ QuicUnackedPacketMap::QuicUnackedPacketMap(Perspective perspective)
 
 QuicUnackedPacketMap::~QuicUnackedPacketMap() {
   for (QuicTransmissionInfo& transmission_info : unacked_packets_) {
-    DeleteFrames(&(transmission_info.retransmittable_frames));
+    DeleteRetransmittableFrames(&transmission_info);
   }
 }
 
@@ -146,13 +147,13 @@ void QuicUnackedPacketMap::AddSentPacket(SerializedPacket* mutable_packet,
   while (least_unacked_ + unacked_packets_.size() < packet_number) {
     unacked_packets_.push_back(QuicTransmissionInfo());
     unacked_packets_.back().state = NEVER_SENT;
+    cold_unacked_packets_.push_back(QuicTransmissionColdInfo());
   }
 
   const bool has_crypto_handshake = packet.has_crypto_handshake == IS_HANDSHAKE;
   QuicTransmissionInfo info(packet.encryption_level, transmission_type,
                             sent_time, bytes_sent, has_crypto_handshake,
                             packet.has_ack_frequency);
-  info.largest_acked = packet.largest_acked;
   largest_sent_largest_acked_.UpdateMax(packet.largest_acked);
 
   if (!measure_rtt) {
@@ -178,15 +179,16 @@ void QuicUnackedPacketMap::AddSentPacket(SerializedPacket* mutable_packet,
     last_inflight_packet_sent_time_ = sent_time;
     last_inflight_packets_sent_time_[packet_number_space] = sent_time;
   }
+  // The map takes over the contents of the frames.
+  info.SetRetransmittableFrames(mutable_packet->retransmittable_frames,
+                                &frame_arena_);
+  mutable_packet->retransmittable_frames.clear();
   unacked_packets_.push_back(std::move(info));
-  // Swap the retransmittable frames to avoid allocations.
-  // TODO(ianswett): Could use emplace_back when Chromium can.
+  cold_unacked_packets_.push_back(QuicTransmissionColdInfo());
+  cold_unacked_packets_.back().largest_acked = packet.largest_acked;
   if (has_crypto_handshake) {
     last_crypto_packet_sent_time_ = sent_time;
   }
-
-  mutable_packet->retransmittable_frames.swap(
-      unacked_packets_.back().retransmittable_frames);
 }
 
 void QuicUnackedPacketMap::RemoveObsoletePackets() {
@@ -194,8 +196,9 @@ void QuicUnackedPacketMap::RemoveObsoletePackets() {
     if (!IsPacketUseless(least_unacked_, unacked_packets_.front())) {
       break;
     }
-    DeleteFrames(&unacked_packets_.front().retransmittable_frames);
+    DeleteRetransmittableFrames(&unacked_packets_.front());
     unacked_packets_.pop_front();
+    cold_unacked_packets_.pop_front();
     ++least_unacked_;
   }
 }
@@ -214,7 +217,7 @@ bool QuicUnackedPacketMap::HasRetransmittableFrames(
     return false;
   }
 
-  for (const auto& frame : info.retransmittable_frames) {
+  for (const auto& frame : info.retransmittable_frames()) {
     if (session_notifier_->IsFrameOutstanding(frame)) {
       return true;
     }
@@ -223,9 +226,9 @@ bool QuicUnackedPacketMap::HasRetransmittableFrames(
 }
 
 void QuicUnackedPacketMap::RemoveRetransmittability(
-    QuicTransmissionInfo* info) {
-  DeleteFrames(&info->retransmittable_frames);
-  info->first_sent_after_loss.Clear();
+    QuicPacketNumber packet_number, QuicTransmissionInfo* info) {
+  DeleteRetransmittableFrames(info);
+  GetMutableColdTransmissionInfo(packet_number)->first_sent_after_loss.Clear();
 }
 
 void QuicUnackedPacketMap::RemoveRetransmittability(
@@ -234,7 +237,7 @@ void QuicUnackedPacketMap::RemoveRetransmittability(
   QUICHE_DCHECK_LT(packet_number, least_unacked_ + unacked_packets_.size());
   QuicTransmissionInfo* info =
       &unacked_packets_[packet_number - least_unacked_];
-  RemoveRetransmittability(info);
+  RemoveRetransmittability(packet_number, info);
 }
 
 void QuicUnackedPacketMap::IncreaseLargestAcked(
@@ -265,18 +268,28 @@ bool QuicUnackedPacketMap::IsPacketUsefulForCongestionControl(
 }
 
 bool QuicUnackedPacketMap::IsPacketUsefulForRetransmittableData(
-    const QuicTransmissionInfo& info) const {
+    QuicPacketNumber packet_number) const {
+  const QuicPacketNumber first_sent_after_loss =
+      GetColdTransmissionInfo(packet_number).first_sent_after_loss;
   // Wait for 1 RTT before giving up on the lost packet.
-  return info.first_sent_after_loss.IsInitialized() &&
+  return first_sent_after_loss.IsInitialized() &&
          (!largest_acked_.IsInitialized() ||
-          info.first_sent_after_loss > largest_acked_);
+          first_sent_after_loss > largest_acked_);
 }
 
 bool QuicUnackedPacketMap::IsPacketUseless(
     QuicPacketNumber packet_number, const QuicTransmissionInfo& info) const {
   return !IsPacketUsefulForMeasuringRtt(packet_number, info) &&
          !IsPacketUsefulForCongestionControl(info) &&
-         !IsPacketUsefulForRetransmittableData(info);
+         !IsPacketUsefulForRetransmittableData(packet_number);
+}
+
+void QuicUnackedPacketMap::DeleteRetransmittableFrames(
+    QuicTransmissionInfo* info) {
+  for (QuicFrame& frame : info->mutable_retransmittable_frames()) {
+    DeleteFrame(&frame);
+  }
+  info->ClearRetransmittableFrames(&frame_arena_);
 }
 
 bool QuicUnackedPacketMap::IsUnacked(QuicPacketNumber packet_number) const {
@@ -332,7 +345,7 @@ QuicUnackedPacketMap::NeuterUnencryptedPackets() {
   QuicPacketNumber packet_number = GetLeastUnacked();
   for (QuicUnackedPacketMap::iterator it = begin(); it != end();
        ++it, ++packet_number) {
-    if (!it->retransmittable_frames.empty() &&
+    if (!it->retransmittable_frames().empty() &&
         it->encryption_level == ENCRYPTION_INITIAL) {
       QUIC_DVLOG(2) << "Neutering unencrypted packet " << packet_number;
       // Once the connection swithes to forward secure, no unencrypted packets
@@ -360,7 +373,7 @@ QuicUnackedPacketMap::NeuterHandshakePackets() {
   QuicPacketNumber packet_number = GetLeastUnacked();
   for (QuicUnackedPacketMap::iterator it = begin(); it != end();
        ++it, ++packet_number) {
-    if (!it->retransmittable_frames.empty() &&
+    if (!it->retransmittable_frames().empty() &&
         GetPacketNumberSpace(it->encryption_level) == HANDSHAKE_DATA) {
       QUIC_DVLOG(2) << "Neutering handshake packet " << packet_number;
       RemoveFromInFlight(packet_number);
@@ -392,6 +405,16 @@ QuicTransmissionInfo* QuicUnackedPacketMap::GetMutableTransmissionInfo(
   return &unacked_packets_[packet_number - least_unacked_];
 }
 
+const QuicTransmissionColdInfo& QuicUnackedPacketMap::GetColdTransmissionInfo(
+    QuicPacketNumber packet_number) const {
+  return cold_unacked_packets_[packet_number - least_unacked_];
+}
+
+QuicTransmissionColdInfo* QuicUnackedPacketMap::GetMutableColdTransmissionInfo(
+    QuicPacketNumber packet_number) {
+  return &cold_unacked_packets_[packet_number - least_unacked_];
+}
+
 QuicTime QuicUnackedPacketMap::GetLastInFlightPacketSentTime() const {
   return last_inflight_packet_sent_time_;
 }
@@ -456,7 +479,7 @@ bool QuicUnackedPacketMap::NotifyFramesAcked(const QuicTransmissionInfo& info,
     return false;
   }
   bool new_data_acked = false;
-  for (const QuicFrame& frame : info.retransmittable_frames) {
+  for (const QuicFrame& frame : info.retransmittable_frames()) {
     if (session_notifier_->OnFrameAcked(frame, ack_delay, receive_timestamp)) {
       new_data_acked = true;
     }
@@ -466,7 +489,7 @@ bool QuicUnackedPacketMap::NotifyFramesAcked(const QuicTransmissionInfo& info,
 
 void QuicUnackedPacketMap::NotifyFramesLost(const QuicTransmissionInfo& info,
                                             TransmissionType /*type*/) {
-  for (const QuicFrame& frame : info.retransmittable_frames) {
+  for (const QuicFrame& frame : info.retransmittable_frames()) {
     session_notifier_->OnFrameLost(frame);
   }
 }
@@ -482,7 +505,7 @@ void QuicUnackedPacketMap::MaybeAggregateAckedStreamFrame(
   if (session_notifier_ == nullptr) {
     return;
   }
-  for (const auto& frame : info.retransmittable_frames) {
+  for (const auto& frame : info.retransmittable_frames()) {
     // Determine whether acked stream frame can be aggregated.
     const bool can_aggregate =
         frame.type == STREAM_FRAME &&
@@ -639,10 +662,10 @@ int32_t QuicUnackedPacketMap::GetLastPacketContent() const {
   }
   int32_t content = 0;
   const QuicTransmissionInfo& last_packet = unacked_packets_.back();
-  for (const auto& frame : last_packet.retransmittable_frames) {
+  for (const auto& frame : last_packet.retransmittable_frames()) {
     content |= GetFrameTypeBitfield(frame.type);
   }
-  if (last_packet.largest_acked.IsInitialized()) {
+  if (cold_unacked_packets_.back().largest_acked.IsInitialized()) {
     content |= GetFrameTypeBitfield(ACK_FRAME);
   }
   return content;
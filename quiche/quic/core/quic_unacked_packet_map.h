@@ -10,6 +10,7 @@
 
 #include "absl/container/inlined_vector.h"
 #include "absl/strings/str_cat.h"
+#include "quiche/quic/core/quic_frame_arena.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/core/quic_transmission_info.h"
 #include "quiche/quic/core/session_notifier_interface.h"
@@ -38,7 +39,7 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   // Marks the packet as in flight if |set_in_flight| is true.
   // Packets marked as in flight are expected to be marked as missing when they
   // don't arrive, indicating the need for retransmission.
-  // Any retransmittible_frames in |mutable_packet| are swapped from
+  // Any retransmittible_frames in |mutable_packet| are moved from
   // |mutable_packet| into the QuicTransmissionInfo.
   void AddSentPacket(SerializedPacket* mutable_packet,
                      TransmissionType transmission_type, QuicTime sent_time,
@@ -136,6 +137,16 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   QuicTransmissionInfo* GetMutableTransmissionInfo(
       QuicPacketNumber packet_number);
 
+  // Returns the QuicTransmissionColdInfo associated with |packet_number|,
+  // which must be unacked.
+  const QuicTransmissionColdInfo& GetColdTransmissionInfo(
+      QuicPacketNumber packet_number) const;
+
+  // Returns mutable QuicTransmissionColdInfo associated with |packet_number|,
+  // which must be unacked.
+  QuicTransmissionColdInfo* GetMutableColdTransmissionInfo(
+      QuicPacketNumber packet_number);
+
   // Returns the time that the last unacked packet was sent.
   QuicTime GetLastInFlightPacketSentTime() const;
 
@@ -159,8 +170,10 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
 
   // Removes any retransmittable frames from this transmission or an associated
   // transmission.  It removes now useless transmissions, and disconnects any
-  // other packets from other transmissions.
-  void RemoveRetransmittability(QuicTransmissionInfo* info);
+  // other packets from other transmissions. |info| must be the
+  // QuicTransmissionInfo of |packet_number|.
+  void RemoveRetransmittability(QuicPacketNumber packet_number,
+                                QuicTransmissionInfo* info);
 
   // Looks up the QuicTransmissionInfo by |packet_number| and calls
   // RemoveRetransmittability.
@@ -243,6 +256,7 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
 
   void ReserveInitialCapacity(size_t initial_capacity) {
     unacked_packets_.reserve(initial_capacity);
+    cold_unacked_packets_.reserve(initial_capacity);
   }
 
   std::string DebugString() const {
@@ -269,12 +283,16 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   // Returns true if packet may be associated with retransmittable data
   // directly or through retransmissions.
   bool IsPacketUsefulForRetransmittableData(
-      const QuicTransmissionInfo& info) const;
+      QuicPacketNumber packet_number) const;
 
   // Returns true if the packet no longer has a purpose in the map.
   bool IsPacketUseless(QuicPacketNumber packet_number,
                        const QuicTransmissionInfo& info) const;
 
+  // Deletes the retransmittable frames of |info| and returns their storage to
+  // frame_arena_.
+  void DeleteRetransmittableFrames(QuicTransmissionInfo* info);
+
   const Perspective perspective_;
 
   QuicPacketNumber largest_sent_packet_;
@@ -289,6 +307,10 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   // The largest received largest_acked from ACK frame per packet number space.
   QuicPacketNumber largest_acked_packets_[NUM_PACKET_NUMBER_SPACES];
 
+  // Stores the retransmittable frames of packets in unacked_packets_ which
+  // have more than one.
+  QuicFrameArena frame_arena_;
+
   // Newly serialized retransmittable packets are added to this map, which
   // contains owning pointers to any contained frames.  If a packet is
   // retransmitted, this map will contain entries for both the old and the new
@@ -298,6 +320,9 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   // be removed from the map and the new entry's retransmittable frames will be
   // set to nullptr.
   quiche::QuicheCircularDeque<QuicTransmissionInfo> unacked_packets_;
+  // The QuicTransmissionColdInfo of each packet in unacked_packets_, at the
+  // same index.
+  quiche::QuicheCircularDeque<QuicTransmissionColdInfo> cold_unacked_packets_;
 
   // The packet at the 0th index of unacked_packets_.
   QuicPacketNumber least_unacked_;
@@ -0,0 +1,168 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the heap memory QuicUnackedPacketMap holds per packet in flight,
+// and the time taken to send packets and process their acks, for packets with
+// one or more retransmittable frames.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/frames/quic_frame.h"
+#include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_unacked_packet_map.h"
+#include "quiche/quic/core/session_notifier_interface.h"
+
+namespace {
+
+// The bytes currently allocated with operator new. Allocations are prefixed
+// with their size, so this counts the bytes requested rather than what the
+// underlying allocator uses to serve them.
+std::atomic<int64_t> g_heap_bytes{0};
+constexpr size_t kAllocationHeaderSize = alignof(std::max_align_t);
+
+void* CountedAllocate(size_t size) {
+  char* memory = static_cast<char*>(malloc(kAllocationHeaderSize + size));
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<size_t*>(memory) = size;
+  g_heap_bytes.fetch_add(size, std::memory_order_relaxed);
+  return memory + kAllocationHeaderSize;
+}
+
+void CountedFree(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  char* memory = static_cast<char*>(ptr) - kAllocationHeaderSize;
+  g_heap_bytes.fetch_sub(*reinterpret_cast<size_t*>(memory),
+                         std::memory_order_relaxed);
+  free(memory);
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, size_t /*size*/) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, size_t /*size*/) noexcept {
+  CountedFree(ptr);
+}
+
+namespace quic {
+namespace {
+
+constexpr QuicPacketLength kPacketLength = 1350;
+constexpr QuicStreamId kStreamId = 3;
+constexpr QuicPacketLength kStreamFrameLength = 100;
+
+// Acks every frame, like a session with nothing left to retransmit.
+class AckingSessionNotifier : public SessionNotifierInterface {
+ public:
+  bool OnFrameAcked(const QuicFrame& /*frame*/, QuicTime::Delta /*ack_delay*/,
+                    QuicTime /*receive_timestamp*/) override {
+    return true;
+  }
+  void OnStreamFrameRetransmitted(const QuicStreamFrame& /*frame*/) override {}
+  void OnFrameLost(const QuicFrame& /*frame*/) override {}
+  bool RetransmitFrames(const QuicFrames& /*frames*/,
+                        TransmissionType /*type*/) override {
+    return true;
+  }
+  bool IsFrameOutstanding(const QuicFrame& /*frame*/) const override {
+    return true;
+  }
+  bool HasUnackedCryptoData() const override { return false; }
+  bool HasUnackedStreamData() const override { return true; }
+};
+
+// Adds |packet_number| to |map|, holding |frames_per_packet| stream frames.
+void SendPacket(QuicUnackedPacketMap* map, uint64_t packet_number,
+                int frames_per_packet) {
+  SerializedPacket packet(QuicPacketNumber(packet_number),
+                          PACKET_4BYTE_PACKET_NUMBER, nullptr, kPacketLength,
+                          /*has_ack=*/false, /*has_stop_waiting=*/false);
+  packet.encryption_level = ENCRYPTION_FORWARD_SECURE;
+  for (int i = 0; i < frames_per_packet; ++i) {
+    const QuicStreamOffset offset =
+        (packet_number * frames_per_packet + i) * kStreamFrameLength;
+    packet.retransmittable_frames.push_back(QuicFrame(
+        QuicStreamFrame(kStreamId, /*fin=*/false, offset, kStreamFrameLength)));
+  }
+  map->AddSentPacket(&packet, NOT_RETRANSMISSION, QuicTime::Zero(),
+                     /*set_in_flight=*/true, /*measure_rtt=*/true);
+}
+
+// Processes an ack of |packet_number|, as QuicSentPacketManager does.
+void AckPacket(QuicUnackedPacketMap* map, uint64_t packet_number) {
+  QuicTransmissionInfo* info =
+      map->GetMutableTransmissionInfo(QuicPacketNumber(packet_number));
+  map->MaybeAggregateAckedStreamFrame(*info, QuicTime::Delta::Zero(),
+                                      QuicTime::Zero());
+  map->RemoveFromInFlight(info);
+  map->RemoveRetransmittability(QuicPacketNumber(packet_number), info);
+  map->IncreaseLargestAcked(QuicPacketNumber(packet_number));
+}
+
+// Fills a map with range(1) packets of range(0) frames each, and reports the
+// heap bytes it holds per packet.
+void BM_MemoryPerPacket(benchmark::State& state) {
+  const int frames_per_packet = state.range(0);
+  const uint64_t num_packets = state.range(1);
+  AckingSessionNotifier notifier;
+  int64_t map_bytes = 0;
+  for (auto _ : state) {
+    const int64_t heap_bytes = g_heap_bytes.load(std::memory_order_relaxed);
+    QuicUnackedPacketMap map(Perspective::IS_SERVER);
+    map.SetSessionNotifier(&notifier);
+    for (uint64_t packet_number = 1; packet_number <= num_packets;
+         ++packet_number) {
+      SendPacket(&map, packet_number, frames_per_packet);
+    }
+    map_bytes = g_heap_bytes.load(std::memory_order_relaxed) - heap_bytes;
+  }
+  state.counters["bytes_per_packet"] =
+      static_cast<double>(map_bytes) / num_packets;
+  state.counters["sizeof_transmission_info"] = sizeof(QuicTransmissionInfo);
+}
+BENCHMARK(BM_MemoryPerPacket)
+    ->ArgsProduct({{1, 2, 4}, {1000, 50000}})
+    ->Unit(benchmark::kMillisecond);
+
+// Keeps range(1) packets of range(0) frames each in flight, sending a packet
+// and acking the oldest one on each iteration.
+void BM_SendAndAck(benchmark::State& state) {
+  const int frames_per_packet = state.range(0);
+  const uint64_t packets_in_flight = state.range(1);
+  AckingSessionNotifier notifier;
+  QuicUnackedPacketMap map(Perspective::IS_SERVER);
+  map.SetSessionNotifier(&notifier);
+  uint64_t packet_number = 1;
+  for (; packet_number <= packets_in_flight; ++packet_number) {
+    SendPacket(&map, packet_number, frames_per_packet);
+  }
+  for (auto _ : state) {
+    SendPacket(&map, packet_number, frames_per_packet);
+    AckPacket(&map, packet_number - packets_in_flight);
+    map.RemoveObsoletePackets();
+    ++packet_number;
+  }
+  map.NotifyAggregatedStreamFrameAcked(QuicTime::Delta::Zero());
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SendAndAck)->ArgsProduct({{1, 2, 4}, {100, 10000}});
+
+}  // namespace
+}  // namespace quic
+
+BENCHMARK_MAIN();
@@ -8,6 +8,7 @@
 #include <limits>
 
 #include "absl/base/macros.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/frames/quic_stream_frame.h"
 #include "quiche/quic/core/quic_packet_number.h"
 #include "quiche/quic/core/quic_transmission_info.h"
@@ -143,7 +144,7 @@ class QuicUnackedPacketMapTest : public QuicTestWithParam<Perspective> {
     QuicStreamId stream_id = QuicUtils::GetFirstBidirectionalStreamId(
         CurrentSupportedVersions()[0].transport_version,
         Perspective::IS_CLIENT);
-    for (const auto& frame : info->retransmittable_frames) {
+    for (const auto& frame : info->retransmittable_frames()) {
       if (frame.type == STREAM_FRAME) {
         stream_id = frame.stream_frame.stream_id;
         break;
@@ -152,13 +153,18 @@ class QuicUnackedPacketMapTest : public QuicTestWithParam<Perspective> {
     UpdatePacketState(
         old_packet_number,
         QuicUtils::RetransmissionTypeToPacketState(transmission_type));
-    info->first_sent_after_loss = QuicPacketNumber(new_packet_number);
+    unacked_packets_
+        .GetMutableColdTransmissionInfo(QuicPacketNumber(old_packet_number))
+        ->first_sent_after_loss = QuicPacketNumber(new_packet_number);
     SerializedPacket packet(
         CreateRetransmittablePacketForStream(new_packet_number, stream_id));
     unacked_packets_.AddSentPacket(&packet, transmission_type, now_, true,
                                    true);
   }
   QuicUnackedPacketMap unacked_packets_;
+  // Holds the retransmittable frames of QuicTransmissionInfos not added to
+  // unacked_packets_.
+  QuicFrameArena frame_arena_;
   QuicTime now_;
   StrictMock<MockSessionNotifier> notifier_;
 };
@@ -451,6 +457,37 @@ TEST_P(QuicUnackedPacketMapTest, SendWithGap) {
   EXPECT_EQ(QuicPacketNumber(5u), unacked_packets_.largest_sent_packet());
 }
 
+TEST_P(QuicUnackedPacketMapTest, AddSentPacketTakesRetransmittableFrames) {
+  SerializedPacket packet1(CreateRetransmittablePacketForStream(1, 3));
+  packet1.retransmittable_frames.push_back(
+      QuicFrame(QuicStreamFrame(5, false, 0, 100)));
+  packet1.retransmittable_frames.push_back(
+      QuicFrame(QuicWindowUpdateFrame(1, 5, 100)));
+  unacked_packets_.AddSentPacket(&packet1, NOT_RETRANSMISSION, now_, true,
+                                 true);
+  EXPECT_TRUE(packet1.retransmittable_frames.empty());
+  SerializedPacket packet2(CreateNonRetransmittablePacket(2));
+  unacked_packets_.AddSentPacket(&packet2, NOT_RETRANSMISSION, now_, false,
+                                 true);
+
+  absl::Span<const QuicFrame> frames =
+      unacked_packets_.GetTransmissionInfo(QuicPacketNumber(1))
+          .retransmittable_frames();
+  ASSERT_EQ(3u, frames.size());
+  EXPECT_EQ(3u, frames[0].stream_frame.stream_id);
+  EXPECT_EQ(5u, frames[1].stream_frame.stream_id);
+  EXPECT_EQ(WINDOW_UPDATE_FRAME, frames[2].type);
+  EXPECT_TRUE(unacked_packets_.GetTransmissionInfo(QuicPacketNumber(2))
+                  .retransmittable_frames()
+                  .empty());
+
+  unacked_packets_.RemoveRetransmittability(QuicPacketNumber(1));
+  EXPECT_TRUE(unacked_packets_.GetTransmissionInfo(QuicPacketNumber(1))
+                  .retransmittable_frames()
+                  .empty());
+  EXPECT_FALSE(unacked_packets_.HasRetransmittableFrames(QuicPacketNumber(1)));
+}
+
 TEST_P(QuicUnackedPacketMapTest, AggregateContiguousAckedStreamFrames) {
   testing::InSequence s;
   EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).Times(0);
@@ -458,19 +495,19 @@ TEST_P(QuicUnackedPacketMapTest, AggregateContiguousAckedStreamFrames) {
 
   QuicTransmissionInfo info1;
   QuicStreamFrame stream_frame1(3, false, 0, 100);
-  info1.retransmittable_frames.push_back(QuicFrame(stream_frame1));
+  info1.SetRetransmittableFrames({QuicFrame(stream_frame1)}, &frame_arena_);
 
   QuicTransmissionInfo info2;
   QuicStreamFrame stream_frame2(3, false, 100, 100);
-  info2.retransmittable_frames.push_back(QuicFrame(stream_frame2));
+  info2.SetRetransmittableFrames({QuicFrame(stream_frame2)}, &frame_arena_);
 
   QuicTransmissionInfo info3;
   QuicStreamFrame stream_frame3(3, false, 200, 100);
-  info3.retransmittable_frames.push_back(QuicFrame(stream_frame3));
+  info3.SetRetransmittableFrames({QuicFrame(stream_frame3)}, &frame_arena_);
 
   QuicTransmissionInfo info4;
   QuicStreamFrame stream_frame4(3, true, 300, 0);
-  info4.retransmittable_frames.push_back(QuicFrame(stream_frame4));
+  info4.SetRetransmittableFrames({QuicFrame(stream_frame4)}, &frame_arena_);
 
   // Verify stream frames are aggregated.
   EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).Times(0);
@@ -509,7 +546,7 @@ TEST_P(QuicUnackedPacketMapTest, CannotAggregateIfDataLengthOverflow) {
       QuicTransmissionInfo info;
       QuicStreamFrame stream_frame(stream_id, false, offset,
                                    acked_stream_length);
-      info.retransmittable_frames.push_back(QuicFrame(stream_frame));
+      info.SetRetransmittableFrames({QuicFrame(stream_frame)}, &frame_arena_);
 
       const QuicStreamFrame& aggregated_stream_frame =
           QuicUnackedPacketMapPeer::GetAggregatedStreamFrame(unacked_packets_);
@@ -538,7 +575,7 @@ TEST_P(QuicUnackedPacketMapTest, CannotAggregateIfDataLengthOverflow) {
     // Ack the last frame of the stream.
     QuicTransmissionInfo info;
     QuicStreamFrame stream_frame(stream_id, true, offset, acked_stream_length);
-    info.retransmittable_frames.push_back(QuicFrame(stream_frame));
+    info.SetRetransmittableFrames({QuicFrame(stream_frame)}, &frame_arena_);
     EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).Times(1);
     unacked_packets_.MaybeAggregateAckedStreamFrame(
         info, QuicTime::Delta::Zero(), QuicTime::Zero());
@@ -555,13 +592,14 @@ TEST_P(QuicUnackedPacketMapTest, CannotAggregateAckedControlFrames) {
   QuicGoAwayFrame go_away(3, QUIC_PEER_GOING_AWAY, 5, "Going away.");
 
   QuicTransmissionInfo info1;
-  info1.retransmittable_frames.push_back(QuicFrame(window_update));
-  info1.retransmittable_frames.push_back(QuicFrame(stream_frame1));
-  info1.retransmittable_frames.push_back(QuicFrame(stream_frame2));
+  info1.SetRetransmittableFrames({QuicFrame(window_update),
+                                  QuicFrame(stream_frame1),
+                                  QuicFrame(stream_frame2)},
+                                 &frame_arena_);
 
   QuicTransmissionInfo info2;
-  info2.retransmittable_frames.push_back(QuicFrame(blocked));
-  info2.retransmittable_frames.push_back(QuicFrame(&go_away));
+  info2.SetRetransmittableFrames({QuicFrame(blocked), QuicFrame(&go_away)},
+                                 &frame_arena_);
 
   // Verify 2 contiguous stream frames are aggregated.
   EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).Times(1);
@@ -667,6 +705,63 @@ TEST_P(QuicUnackedPacketMapTest, ReserveInitialCapacityTest) {
   ASSERT_EQ(QuicUnackedPacketMapPeer::GetCapacity(unacked_packets), 16u);
 }
 
+TEST_P(QuicUnackedPacketMapTest, MovingTransmissionInfoTransfersFrames) {
+  QuicStreamFrame stream_frame1(3, false, 0, 100);
+  QuicStreamFrame stream_frame2(3, false, 100, 100);
+  QuicTransmissionInfo info1;
+  info1.SetRetransmittableFrames(
+      {QuicFrame(stream_frame1), QuicFrame(stream_frame2)}, &frame_arena_);
+  const QuicFrame* frames = info1.retransmittable_frames().data();
+
+  QuicTransmissionInfo info2(std::move(info1));
+  EXPECT_TRUE(info1.retransmittable_frames().empty());
+  ASSERT_EQ(2u, info2.retransmittable_frames().size());
+  EXPECT_EQ(frames, info2.retransmittable_frames().data());
+
+  QuicTransmissionInfo info3;
+  info3 = std::move(info2);
+  EXPECT_TRUE(info2.retransmittable_frames().empty());
+  ASSERT_EQ(2u, info3.retransmittable_frames().size());
+  EXPECT_EQ(frames, info3.retransmittable_frames().data());
+
+  // Only the last owner returns the frames to the arena.
+  info1.ClearRetransmittableFrames(&frame_arena_);
+  info2.ClearRetransmittableFrames(&frame_arena_);
+  info3.ClearRetransmittableFrames(&frame_arena_);
+  EXPECT_TRUE(info3.retransmittable_frames().empty());
+}
+
+TEST_P(QuicUnackedPacketMapTest, ColdTransmissionInfoFollowsPacket) {
+  SerializedPacket packet1(CreateRetransmittablePacket(1));
+  unacked_packets_.AddSentPacket(&packet1, NOT_RETRANSMISSION, now_, true,
+                                 true);
+  // Packet 2 is skipped.
+  SerializedPacket packet3(CreateNonRetransmittablePacket(3));
+  packet3.largest_acked = QuicPacketNumber(7);
+  unacked_packets_.AddSentPacket(&packet3, NOT_RETRANSMISSION, now_, false,
+                                 true);
+  EXPECT_TRUE(unacked_packets_.GetLastPacketContent() & (1 << ACK_FRAME));
+  EXPECT_FALSE(unacked_packets_.GetColdTransmissionInfo(QuicPacketNumber(2))
+                   .largest_acked.IsInitialized());
+  EXPECT_EQ(QuicPacketNumber(7),
+            unacked_packets_.GetColdTransmissionInfo(QuicPacketNumber(3))
+                .largest_acked);
+
+  // Losing packet 1 keeps it for another RTT after it is out of flight.
+  unacked_packets_.IncreaseLargestAcked(QuicPacketNumber(3));
+  unacked_packets_.RemoveFromInFlight(QuicPacketNumber(1));
+  unacked_packets_.GetMutableTransmissionInfo(QuicPacketNumber(1))->state =
+      LOST;
+  unacked_packets_.GetMutableColdTransmissionInfo(QuicPacketNumber(1))
+      ->first_sent_after_loss = QuicPacketNumber(4);
+  unacked_packets_.RemoveObsoletePackets();
+  EXPECT_TRUE(unacked_packets_.IsUnacked(QuicPacketNumber(1)));
+
+  unacked_packets_.IncreaseLargestAcked(QuicPacketNumber(4));
+  unacked_packets_.RemoveObsoletePackets();
+  EXPECT_TRUE(unacked_packets_.empty());
+}
+
 TEST_P(QuicUnackedPacketMapTest, DebugString) {
   EXPECT_EQ(unacked_packets_.DebugString(),
             "{size: 0, least_unacked: 1, largest_sent_packet: uninitialized, "
@@ -0,0 +1,14 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/test_tools/quic_alarm_peer.h"
+
+namespace quic {
+namespace test {
+
+// static
+void QuicAlarmPeer::Fire(QuicAlarm* alarm) { alarm->Fire(); }
+
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,24 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TEST_TOOLS_QUIC_ALARM_PEER_H_
+#define QUICHE_QUIC_TEST_TOOLS_QUIC_ALARM_PEER_H_
+
+#include "quiche/quic/core/quic_alarm.h"
+
+namespace quic {
+namespace test {
+
+class QuicAlarmPeer {
+ public:
+  // Runs |alarm| if it is set, whichever factory created it. Unlike casting to
+  // TestAlarmFactory::TestAlarm, this also works for the alarms of a
+  // QuicAlarmMultiplexer.
+  static void Fire(QuicAlarm* alarm);
+};
+
+}  // namespace test
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TEST_TOOLS_QUIC_ALARM_PEER_H_
@@ -134,6 +134,12 @@ QuicAlarmFactory* QuicConnectionPeer::GetAlarmFactory(
   return connection->alarm_factory_;
 }
 
+// static
+QuicAlarmMultiplexer* QuicConnectionPeer::GetAlarmMultiplexer(
+    QuicConnection* connection) {
+  return connection->alarm_multiplexer_.get();
+}
+
 // static
 QuicFramer* QuicConnectionPeer::GetFramer(QuicConnection* connection) {
   return &connection->framer_;
@@ -317,6 +323,12 @@ bool QuicConnectionPeer::SupportsReleaseTime(QuicConnection* connection) {
   return connection->supports_release_time_;
 }
 
+// static
+PerPacketOptions* QuicConnectionPeer::GetPerPacketOptions(
+    QuicConnection* connection) {
+  return connection->per_packet_options_;
+}
+
 // static
 QuicConnection::PacketContent QuicConnectionPeer::GetCurrentPacketContent(
     QuicConnection* connection) {
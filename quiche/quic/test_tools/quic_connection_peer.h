@@ -19,6 +19,7 @@ namespace quic {
 
 struct QuicPacketHeader;
 class QuicAlarm;
+class QuicAlarmMultiplexer;
 class QuicConnectionHelperInterface;
 class QuicConnectionVisitorInterface;
 class QuicEncryptedPacket;
@@ -82,6 +83,10 @@ class QuicConnectionPeer {
 
   static QuicAlarmFactory* GetAlarmFactory(QuicConnection* connection);
 
+  // Returns null unless quic_multiplex_connection_alarms was enabled when
+  // |connection| was created.
+  static QuicAlarmMultiplexer* GetAlarmMultiplexer(QuicConnection* connection);
+
   static QuicFramer* GetFramer(QuicConnection* connection);
 
   static QuicAlarm* GetAckAlarm(QuicConnection* connection);
@@ -130,6 +135,7 @@ class QuicConnectionPeer {
   static void SetMaxConsecutiveNumPacketsWithNoRetransmittableFrames(
       QuicConnection* connection, size_t new_value);
   static bool SupportsReleaseTime(QuicConnection* connection);
+  static PerPacketOptions* GetPerPacketOptions(QuicConnection* connection);
   static QuicConnection::PacketContent GetCurrentPacketContent(
       QuicConnection* connection);
   static void AddBytesReceived(QuicConnection* connection, size_t length);
@@ -120,10 +120,7 @@ QuicSession* QuicDispatcherPeer::GetFirstSessionIfAny(
 // static
 const QuicSession* QuicDispatcherPeer::FindSession(
     const QuicDispatcher* dispatcher, QuicConnectionId id) {
-  auto it = dispatcher->reference_counted_session_map_.find(id);
-  return (it == dispatcher->reference_counted_session_map_.end())
-             ? nullptr
-             : it->second.get();
+  return dispatcher->FindSession(id);
 }
 
 // static
@@ -132,5 +129,11 @@ QuicAlarm* QuicDispatcherPeer::GetClearResetAddressesAlarm(
   return dispatcher->clear_stateless_reset_addresses_alarm_.get();
 }
 
+// static
+const QuicSessionTable* QuicDispatcherPeer::GetSessionTable(
+    const QuicDispatcher* dispatcher) {
+  return dispatcher->session_table_.get();
+}
+
 }  // namespace test
 }  // namespace quic
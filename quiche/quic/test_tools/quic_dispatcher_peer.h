@@ -74,6 +74,10 @@ class QuicDispatcherPeer {
                                         QuicConnectionId id);
 
   static QuicAlarm* GetClearResetAddressesAlarm(QuicDispatcher* dispatcher);
+
+  // Returns nullptr unless the dispatcher looks up sessions in a table.
+  static const QuicSessionTable* GetSessionTable(
+      const QuicDispatcher* dispatcher);
 };
 
 }  // namespace test
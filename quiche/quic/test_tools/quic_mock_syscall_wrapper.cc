@@ -16,6 +16,9 @@ MockQuicSyscallWrapper::MockQuicSyscallWrapper(QuicSyscallWrapper* delegate) {
 
   ON_CALL(*this, Sendmmsg(_, _, _, _))
       .WillByDefault(Invoke(delegate, &QuicSyscallWrapper::Sendmmsg));
+
+  ON_CALL(*this, Recvmsg(_, _, _))
+      .WillByDefault(Invoke(delegate, &QuicSyscallWrapper::Recvmsg));
 }
 
 }  // namespace test
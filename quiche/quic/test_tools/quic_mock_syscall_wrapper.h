@@ -25,6 +25,8 @@ class MockQuicSyscallWrapper : public QuicSyscallWrapper {
 
   MOCK_METHOD(int, Sendmmsg,
               (int sockfd, mmsghdr*, unsigned int vlen, int flags), (override));
+
+  MOCK_METHOD(ssize_t, Recvmsg, (int sockfd, msghdr*, int flags), (override));
 };
 
 }  // namespace test
@@ -108,7 +108,8 @@ SerializedPacket QuicPacketCreatorPeer::SerializeAllFrames(
   }
   const bool success =
       creator->SerializePacket(QuicOwnedPacketBuffer(buffer, nullptr),
-                               buffer_len, /*allow_padding=*/true);
+                               buffer_len, /*allow_padding=*/true,
+                               /*allow_deferred_sealing=*/false);
   QUICHE_DCHECK(success);
   SerializedPacket packet = std::move(creator->packet_);
   // The caller takes ownership of the QuicEncryptedPacket.
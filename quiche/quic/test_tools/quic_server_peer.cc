@@ -28,5 +28,22 @@ void QuicServerPeer::SetReader(QuicServer* server, QuicPacketReader* reader) {
   server->packet_reader_.reset(reader);
 }
 
+// static
+QuicIoUringBatchWriter* QuicServerPeer::GetIoUringBatchWriter(
+    QuicServer* server) {
+  return server->io_uring_batch_writer_;
+}
+
+// static
+QuicGsoBatchWriter* QuicServerPeer::GetZerocopyWriter(QuicServer* server) {
+  return server->zerocopy_writer_;
+}
+
+// static
+QuicThreadPoolProofSource* QuicServerPeer::GetThreadPoolProofSource(
+    QuicServer* server) {
+  return server->thread_pool_proof_source_;
+}
+
 }  // namespace test
 }  // namespace quic
@@ -8,8 +8,11 @@
 namespace quic {
 
 class QuicDispatcher;
+class QuicGsoBatchWriter;
+class QuicIoUringBatchWriter;
 class QuicServer;
 class QuicPacketReader;
+class QuicThreadPoolProofSource;
 
 namespace test {
 
@@ -20,6 +23,10 @@ class QuicServerPeer {
   static bool SetSmallSocket(QuicServer* server);
   static QuicDispatcher* GetDispatcher(QuicServer* server);
   static void SetReader(QuicServer* server, QuicPacketReader* reader);
+  static QuicIoUringBatchWriter* GetIoUringBatchWriter(QuicServer* server);
+  static QuicGsoBatchWriter* GetZerocopyWriter(QuicServer* server);
+  static QuicThreadPoolProofSource* GetThreadPoolProofSource(
+      QuicServer* server);
 };
 
 }  // namespace test
@@ -476,7 +476,12 @@ QuicArenaScopedPtr<QuicAlarm> MockAlarmFactory::CreateAlarm(
 
 quiche::QuicheBufferAllocator*
 MockQuicConnectionHelper::GetStreamSendBufferAllocator() {
-  return &buffer_allocator_;
+  return send_buffer_allocator_;
+}
+
+QuicStreamSequencerBufferBlockPool*
+MockQuicConnectionHelper::GetStreamSequencerBufferBlockPool() {
+  return block_pool_;
 }
 
 void MockQuicConnectionHelper::AdvanceTime(QuicTime::Delta delta) {
@@ -1292,9 +1297,12 @@ TestPacketWriter::~TestPacketWriter() {
 WriteResult TestPacketWriter::WritePacket(const char* buffer, size_t buf_len,
                                           const QuicIpAddress& self_address,
                                           const QuicSocketAddress& peer_address,
-                                          PerPacketOptions* /*options*/) {
+                                          PerPacketOptions* options) {
   last_write_source_address_ = self_address;
   last_write_peer_address_ = peer_address;
+  if (options != nullptr) {
+    release_time_delays_.push_back(options->release_time_delay);
+  }
   // If the buffer is allocated from the pool, return it back to the pool.
   // Note the buffer content doesn't change.
   if (packet_buffer_pool_index_.find(const_cast<char*>(buffer)) !=
@@ -37,6 +37,7 @@
 #include "quiche/quic/test_tools/mock_clock.h"
 #include "quiche/quic/test_tools/mock_quic_session_visitor.h"
 #include "quiche/quic/test_tools/mock_random.h"
+#include "quiche/quic/test_tools/quic_alarm_peer.h"
 #include "quiche/quic/test_tools/quic_framer_peer.h"
 #include "quiche/quic/test_tools/simple_quic_framer.h"
 #include "quiche/common/quiche_mem_slice_storage.h"
@@ -517,12 +518,27 @@ class MockQuicConnectionHelper : public QuicConnectionHelperInterface {
   const QuicClock* GetClock() const override;
   QuicRandom* GetRandomGenerator() override;
   quiche::QuicheBufferAllocator* GetStreamSendBufferAllocator() override;
+  QuicStreamSequencerBufferBlockPool* GetStreamSequencerBufferBlockPool()
+      override;
   void AdvanceTime(QuicTime::Delta delta);
 
+  void set_stream_send_buffer_allocator(
+      quiche::QuicheBufferAllocator* allocator) {
+    send_buffer_allocator_ = allocator;
+  }
+  void set_stream_sequencer_buffer_block_pool(
+      QuicStreamSequencerBufferBlockPool* block_pool) {
+    block_pool_ = block_pool;
+  }
+
  private:
   MockClock clock_;
   MockRandom random_generator_;
   quiche::SimpleBufferAllocator buffer_allocator_;
+  // Not owned unless it is |buffer_allocator_|.
+  quiche::QuicheBufferAllocator* send_buffer_allocator_ = &buffer_allocator_;
+  // Not owned; nullptr unless set by a test.
+  QuicStreamSequencerBufferBlockPool* block_pool_ = nullptr;
 };
 
 class MockAlarmFactory : public QuicAlarmFactory {
@@ -576,6 +592,25 @@ class TestAlarmFactory : public QuicAlarmFactory {
   }
 };
 
+// Gives tests access to an alarm whichever factory created it, including a
+// QuicAlarmMultiplexer whose alarms are not TestAlarmFactory::TestAlarms.
+// Stands in for an alarm pointer, so that alarm->Fire() keeps working.
+class QuicTestAlarmProxy {
+ public:
+  explicit QuicTestAlarmProxy(QuicAlarm* alarm) : alarm_(alarm) {}
+
+  bool IsSet() const { return alarm_->IsSet(); }
+  QuicTime deadline() const { return alarm_->deadline(); }
+  void Set(QuicTime new_deadline) { alarm_->Set(new_deadline); }
+  void Cancel() { alarm_->Cancel(); }
+  void Fire() { QuicAlarmPeer::Fire(alarm_); }
+
+  QuicTestAlarmProxy* operator->() { return this; }
+
+ private:
+  QuicAlarm* alarm_;  // Not owned.
+};
+
 class MockQuicConnection : public QuicConnection {
  public:
   // Uses a ConnectionId of 42 and 127.0.0.1:123.
@@ -1928,6 +1963,11 @@ class TestPacketWriter : public QuicPacketWriter {
     return last_write_peer_address_;
   }
 
+  // The release time delays of the packets written with per-packet options.
+  const std::vector<QuicTime::Delta>& release_time_delays() const {
+    return release_time_delays_;
+  }
+
  private:
   char* AllocPacketBuffer();
 
@@ -1972,6 +2012,7 @@ class TestPacketWriter : public QuicPacketWriter {
   // The soruce/peer address passed into WritePacket().
   QuicIpAddress last_write_source_address_;
   QuicSocketAddress last_write_peer_address_;
+  std::vector<QuicTime::Delta> release_time_delays_;
   int write_error_code_{0};
 };
 
@@ -0,0 +1,213 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// End to end benchmark of a QuicServer backed by QuicMemoryCacheBackend,
+// running on its own thread, and QuicTestClients talking to it over UDP on
+// 127.0.0.1. For every supported version it measures handshakes and requests
+// per second with 1 to 8 concurrent clients, and for every version and
+// congestion controller the bulk transfer rate and the CPU cycles spent per
+// byte. Both endpoints run in this process, so the CPU cost covers client and
+// server.
+
+#include <time.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "quiche/quic/core/crypto/crypto_protocol.h"
+#include "quiche/quic/core/quic_config.h"
+#include "quiche/quic/core/quic_tag.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/quic_test_client.h"
+#include "quiche/quic/test_tools/server_thread.h"
+#include "quiche/quic/tools/quic_memory_cache_backend.h"
+#include "quiche/quic/tools/quic_server.h"
+
+namespace quic {
+namespace {
+
+using test::QuicTestClient;
+using test::ServerThread;
+
+constexpr char kServerHostname[] = "test.example.com";
+constexpr char kSmallPath[] = "/small";
+constexpr char kBulkPath[] = "/bulk";
+constexpr int64_t kSmallBodySize = 1024;
+constexpr int64_t kBulkBodySize = 16 * 1024 * 1024;
+
+struct CongestionController {
+  const char* name;
+  QuicTag connection_option;
+};
+
+// The client requests the server's congestion controller through a
+// connection option. The server is the sender in the bulk benchmark.
+constexpr CongestionController kCongestionControllers[] = {
+    {"cubic", kQBIC},
+    {"reno", kRENO},
+    {"bbr", kTBBR},
+    {"bbr2", kB2ON},
+};
+
+// CPU time of the whole process, which includes the server thread.
+double ProcessCpuSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+class LoopbackServer {
+ public:
+  LoopbackServer() {
+    memory_cache_backend_.AddSimpleResponse(kServerHostname, kSmallPath, 200,
+                                            std::string(kSmallBodySize, 's'));
+    memory_cache_backend_.AddSimpleResponse(kServerHostname, kBulkPath, 200,
+                                            std::string(kBulkBodySize, 'b'));
+    server_thread_ = std::make_unique<ServerThread>(
+        std::make_unique<QuicServer>(crypto_test_utils::ProofSourceForTesting(),
+                                     &memory_cache_backend_),
+        QuicSocketAddress(QuicIpAddress::Loopback4(), 0));
+    server_thread_->Initialize();
+    address_ = QuicSocketAddress(QuicIpAddress::Loopback4(),
+                                 server_thread_->GetPort());
+    server_thread_->Start();
+  }
+
+  LoopbackServer(const LoopbackServer&) = delete;
+  LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+  ~LoopbackServer() {
+    server_thread_->Quit();
+    server_thread_->Join();
+  }
+
+  std::unique_ptr<QuicTestClient> CreateClient(
+      const ParsedQuicVersion& version,
+      const QuicTagVector& connection_options) const {
+    QuicConfig config;
+    config.SetConnectionOptionsToSend(connection_options);
+    return std::make_unique<QuicTestClient>(
+        address_, kServerHostname, config, ParsedQuicVersionVector{version},
+        crypto_test_utils::ProofVerifierForTesting());
+  }
+
+ private:
+  QuicMemoryCacheBackend memory_cache_backend_;
+  std::unique_ptr<ServerThread> server_thread_;
+  QuicSocketAddress address_;
+};
+
+// Each iteration is a full handshake on a new connection, without session
+// resumption.
+void BM_Handshake(benchmark::State& state, const LoopbackServer* server,
+                  ParsedQuicVersion version) {
+  for (auto _ : state) {
+    std::unique_ptr<QuicTestClient> client =
+        server->CreateClient(version, QuicTagVector());
+    client->Connect();
+    if (!client->connected()) {
+      state.SkipWithError("Handshake failed");
+      return;
+    }
+    client->Disconnect();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Each iteration is a GET of a small resource on an established connection.
+void BM_Request(benchmark::State& state, const LoopbackServer* server,
+                ParsedQuicVersion version) {
+  std::unique_ptr<QuicTestClient> client =
+      server->CreateClient(version, QuicTagVector());
+  client->Connect();
+  if (!client->connected()) {
+    state.SkipWithError("Handshake failed");
+    return;
+  }
+  for (auto _ : state) {
+    client->SendSynchronousRequest(kSmallPath);
+    if (client->response_body_size() != kSmallBodySize) {
+      state.SkipWithError("Request failed");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  client->Disconnect();
+}
+
+// Each iteration downloads a large resource on an established connection.
+void BM_BulkTransfer(benchmark::State& state, const LoopbackServer* server,
+                     ParsedQuicVersion version,
+                     CongestionController congestion_controller) {
+  std::unique_ptr<QuicTestClient> client = server->CreateClient(
+      version, QuicTagVector{congestion_controller.connection_option});
+  client->set_buffer_body(false);
+  client->Connect();
+  if (!client->connected()) {
+    state.SkipWithError("Handshake failed");
+    return;
+  }
+  int64_t bytes = 0;
+  const double cpu_start = ProcessCpuSeconds();
+  for (auto _ : state) {
+    client->SendSynchronousRequest(kBulkPath);
+    if (client->response_body_size() != kBulkBodySize) {
+      state.SkipWithError("Transfer failed");
+      return;
+    }
+    bytes += kBulkBodySize;
+  }
+  const double cpu_seconds = ProcessCpuSeconds() - cpu_start;
+  state.SetBytesProcessed(bytes);
+  state.counters["Gbit/s"] =
+      benchmark::Counter(bytes * 8 / 1e9, benchmark::Counter::kIsRate);
+  state.counters["cycles/byte"] =
+      cpu_seconds * benchmark::CPUInfo::Get().cycles_per_second / bytes;
+  client->Disconnect();
+}
+
+void RegisterBenchmarks(const LoopbackServer* server) {
+  for (const ParsedQuicVersion& version : CurrentSupportedVersions()) {
+    const std::string version_name = ParsedQuicVersionToString(version);
+    benchmark::RegisterBenchmark(
+        absl::StrCat("BM_Handshake/", version_name).c_str(), BM_Handshake,
+        server, version)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(
+        absl::StrCat("BM_Request/", version_name).c_str(), BM_Request, server,
+        version)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+    for (const CongestionController& congestion_controller :
+         kCongestionControllers) {
+      benchmark::RegisterBenchmark(
+          absl::StrCat("BM_BulkTransfer/", version_name, "/",
+                       congestion_controller.name)
+              .c_str(),
+          BM_BulkTransfer, server, version, congestion_controller)
+          ->UseRealTime();
+    }
+  }
+}
+
+}  // namespace
+}  // namespace quic
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  quic::LoopbackServer server;
+  quic::RegisterBenchmarks(&server);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
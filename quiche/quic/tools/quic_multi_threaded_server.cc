@@ -0,0 +1,414 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_multi_threaded_server.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "quiche/quic/core/quic_dispatcher.h"
+#include "quiche/quic/core/quic_epoll_alarm_factory.h"
+#include "quiche/quic/core/quic_epoll_connection_helper.h"
+#include "quiche/quic/core/quic_session.h"
+#include "quiche/quic/core/quic_time_wait_list_manager.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/tools/quic_simple_crypto_server_stream_helper.h"
+#include "quiche/quic/tools/quic_simple_dispatcher.h"
+
+namespace quic {
+
+namespace {
+
+// A dispatcher which records the connection IDs of its sessions in the shared
+// QuicConnectionIdOwnerMap, and hands packets for connections owned by other
+// workers over to them.
+class QuicWorkerDispatcher : public QuicSimpleDispatcher {
+ public:
+  QuicWorkerDispatcher(
+      const QuicConfig* config, const QuicCryptoServerConfig* crypto_config,
+      QuicVersionManager* version_manager,
+      std::unique_ptr<QuicConnectionHelperInterface> helper,
+      std::unique_ptr<QuicCryptoServerStreamBase::Helper> session_helper,
+      std::unique_ptr<QuicAlarmFactory> alarm_factory,
+      QuicSimpleServerBackend* quic_simple_server_backend,
+      uint8_t expected_server_connection_id_length, size_t worker_index,
+      QuicMultiThreadedServer* server)
+      : QuicSimpleDispatcher(config, crypto_config, version_manager,
+                             std::move(helper), std::move(session_helper),
+                             std::move(alarm_factory),
+                             quic_simple_server_backend,
+                             expected_server_connection_id_length),
+        worker_index_(worker_index),
+        server_(server) {}
+
+  void OnConnectionClosed(QuicConnectionId server_connection_id,
+                          QuicErrorCode error, const std::string& error_details,
+                          ConnectionCloseSource source) override {
+    QuicSession* session = FindSession(server_connection_id);
+    if (session != nullptr) {
+      for (const QuicConnectionId& connection_id :
+           session->connection()->GetActiveServerConnectionIds()) {
+        owners()->Unregister(connection_id);
+      }
+    }
+    QuicSimpleDispatcher::OnConnectionClosed(server_connection_id, error,
+                                             error_details, source);
+  }
+
+  void OnNewConnectionIdSent(
+      const QuicConnectionId& server_connection_id,
+      const QuicConnectionId& new_connection_id) override {
+    QuicSimpleDispatcher::OnNewConnectionIdSent(server_connection_id,
+                                                new_connection_id);
+    owners()->Register(new_connection_id, worker_index_);
+  }
+
+  void OnConnectionIdRetired(
+      const QuicConnectionId& server_connection_id) override {
+    QuicSimpleDispatcher::OnConnectionIdRetired(server_connection_id);
+    owners()->Unregister(server_connection_id);
+  }
+
+ protected:
+  // Gives new connections a connection ID which the steering program routes to
+  // this worker, so that they keep reaching it after the client's address
+  // changes.
+  QuicConnectionId MaybeReplaceServerConnectionId(
+      const QuicConnectionId& server_connection_id,
+      const ParsedQuicVersion& version) const override {
+    QuicConnectionId connection_id =
+        QuicSimpleDispatcher::MaybeReplaceServerConnectionId(
+            server_connection_id, version);
+    const QuicReuseportSteering* steering = server_->steering();
+    if (steering == nullptr || !version.AllowsVariableLengthConnectionIds() ||
+        connection_id.length() != steering->config().total_len()) {
+      return connection_id;
+    }
+    return steering->MakeRoutableConnectionId(connection_id, worker_index_);
+  }
+
+  std::unique_ptr<QuicSession> CreateQuicSession(
+      QuicConnectionId server_connection_id,
+      const QuicSocketAddress& self_address,
+      const QuicSocketAddress& peer_address, absl::string_view alpn,
+      const ParsedQuicVersion& version,
+      const ParsedClientHello& parsed_chlo) override {
+    std::unique_ptr<QuicSession> session =
+        QuicSimpleDispatcher::CreateQuicSession(server_connection_id,
+                                                self_address, peer_address,
+                                                alpn, version, parsed_chlo);
+    if (session != nullptr) {
+      owners()->Register(server_connection_id, worker_index_);
+    }
+    return session;
+  }
+
+  bool OnFailedToDispatchPacket(
+      const ReceivedPacketInfo& packet_info) override {
+    absl::optional<size_t> owner =
+        owners()->Lookup(packet_info.destination_connection_id);
+    if (!owner.has_value() || *owner == worker_index_) {
+      return QuicSimpleDispatcher::OnFailedToDispatchPacket(packet_info);
+    }
+    QUIC_DVLOG(1) << "Worker " << worker_index_ << " forwarding packet for "
+                  << packet_info.destination_connection_id << " to worker "
+                  << *owner;
+    server_->ForwardPacket(*owner, packet_info.self_address,
+                           packet_info.peer_address, packet_info.packet);
+    return true;
+  }
+
+  // Keeps closed connections in the store shared by all workers, so that a
+  // packet for a connection closed by one worker is answered by whichever
+  // worker receives it.
+  QuicTimeWaitListManager* CreateQuicTimeWaitListManager() override {
+    return new QuicTimeWaitListManager(writer(), this, helper()->GetClock(),
+                                       alarm_factory(),
+                                       server_->time_wait_store());
+  }
+
+ private:
+  QuicConnectionIdOwnerMap* owners() { return server_->connection_id_owners(); }
+
+  const size_t worker_index_;
+  QuicMultiThreadedServer* server_;  // Unowned.
+};
+
+}  // namespace
+
+QuicConnectionIdOwnerMap::Shard& QuicConnectionIdOwnerMap::GetShard(
+    const QuicConnectionId& connection_id) {
+  return shards_[QuicConnectionIdHash()(connection_id) % kNumShards];
+}
+
+const QuicConnectionIdOwnerMap::Shard& QuicConnectionIdOwnerMap::GetShard(
+    const QuicConnectionId& connection_id) const {
+  return shards_[QuicConnectionIdHash()(connection_id) % kNumShards];
+}
+
+void QuicConnectionIdOwnerMap::Register(const QuicConnectionId& connection_id,
+                                        size_t worker_index) {
+  Shard& shard = GetShard(connection_id);
+  QuicWriterMutexLock lock(&shard.mutex);
+  shard.owners[connection_id] = worker_index;
+}
+
+void QuicConnectionIdOwnerMap::Unregister(
+    const QuicConnectionId& connection_id) {
+  Shard& shard = GetShard(connection_id);
+  QuicWriterMutexLock lock(&shard.mutex);
+  shard.owners.erase(connection_id);
+}
+
+absl::optional<size_t> QuicConnectionIdOwnerMap::Lookup(
+    const QuicConnectionId& connection_id) const {
+  const Shard& shard = GetShard(connection_id);
+  QuicReaderMutexLock lock(&shard.mutex);
+  auto it = shard.owners.find(connection_id);
+  if (it == shard.owners.end()) {
+    return absl::nullopt;
+  }
+  return it->second;
+}
+
+size_t QuicConnectionIdOwnerMap::size() const {
+  size_t size = 0;
+  for (const Shard& shard : shards_) {
+    QuicReaderMutexLock lock(&shard.mutex);
+    size += shard.owners.size();
+  }
+  return size;
+}
+
+QuicServerWorker::QuicServerWorker(
+    size_t worker_index, QuicMultiThreadedServer* owner,
+    std::unique_ptr<ProofSource> proof_source, const QuicConfig& config,
+    const QuicCryptoServerConfig::ConfigOptions& crypto_config_options,
+    const ParsedQuicVersionVector& supported_versions,
+    QuicSimpleServerBackend* quic_simple_server_backend,
+    uint8_t expected_server_connection_id_length)
+    : QuicServer(std::move(proof_source), config, crypto_config_options,
+                 supported_versions, quic_simple_server_backend,
+                 expected_server_connection_id_length),
+      worker_index_(worker_index),
+      owner_(owner),
+      wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      forwarded_packet_listener_(this),
+      stop_requested_(false),
+      wake_pending_(false),
+      num_forwarded_packets_processed_(0) {
+  QUIC_BUG_IF(quic_server_worker_eventfd_failed, wake_fd_ < 0)
+      << "eventfd() failed: " << strerror(errno);
+  set_reuse_port(true);
+}
+
+QuicServerWorker::~QuicServerWorker() {
+  if (wake_fd_ >= 0) {
+    epoll_server()->UnregisterFD(wake_fd_);
+    close(wake_fd_);
+  }
+}
+
+bool QuicServerWorker::CreateUDPSocketAndListen(
+    const QuicSocketAddress& address) {
+  if (wake_fd_ < 0 || !QuicServer::CreateUDPSocketAndListen(address)) {
+    return false;
+  }
+  epoll_server()->RegisterFD(wake_fd_, &forwarded_packet_listener_, EPOLLIN);
+  return true;
+}
+
+QuicDispatcher* QuicServerWorker::CreateQuicDispatcher() {
+  return new QuicWorkerDispatcher(
+      &config(), &crypto_config(), version_manager(),
+      std::make_unique<QuicEpollConnectionHelper>(epoll_server(),
+                                                  allocator_type()),
+      std::make_unique<QuicSimpleCryptoServerStreamHelper>(),
+      std::make_unique<QuicEpollAlarmFactory>(epoll_server()),
+      server_backend(), expected_server_connection_id_length(), worker_index_,
+      owner_);
+}
+
+void QuicServerWorker::RunEventLoop() {
+  while (!stop_requested_.load(std::memory_order_acquire)) {
+    WaitForEvents();
+  }
+  Shutdown();
+}
+
+void QuicServerWorker::RequestStop() {
+  stop_requested_.store(true, std::memory_order_release);
+  Wake();
+}
+
+void QuicServerWorker::EnqueueForwardedPacket(
+    const QuicSocketAddress& self_address,
+    const QuicSocketAddress& peer_address, const QuicReceivedPacket& packet) {
+  forwarded_packets_.Push(
+      ForwardedPacket{self_address, peer_address, packet.Clone()});
+  if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+    Wake();
+  }
+}
+
+void QuicServerWorker::ProcessForwardedPackets() {
+  // Clear the flag before draining: a packet pushed after this point either is
+  // drained below or wakes the worker again.
+  wake_pending_.exchange(false, std::memory_order_acq_rel);
+  for (absl::optional<ForwardedPacket> forwarded = forwarded_packets_.Pop();
+       forwarded.has_value(); forwarded = forwarded_packets_.Pop()) {
+    dispatcher()->ProcessPacket(forwarded->self_address,
+                                forwarded->peer_address, *forwarded->packet);
+    num_forwarded_packets_processed_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void QuicServerWorker::Wake() {
+  uint64_t value = 1;
+  if (write(wake_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+    QUIC_LOG_FIRST_N(ERROR, 10)
+        << "Failed to wake worker " << worker_index_ << ": " << strerror(errno);
+  }
+}
+
+void QuicServerWorker::ForwardedPacketListener::OnEvent(
+    int fd, QuicEpollEvent* event) {
+  event->out_ready_mask = 0;
+  uint64_t value;
+  while (read(fd, &value, sizeof(value)) > 0) {
+  }
+  worker_->ProcessForwardedPackets();
+}
+
+QuicMultiThreadedServer::QuicMultiThreadedServer(
+    size_t num_workers, ProofSourceFactory proof_source_factory,
+    QuicSimpleServerBackend* quic_simple_server_backend)
+    : QuicMultiThreadedServer(
+          num_workers, std::move(proof_source_factory), QuicConfig(),
+          QuicCryptoServerConfig::ConfigOptions(), AllSupportedVersions(),
+          quic_simple_server_backend, kQuicDefaultConnectionIdLength) {}
+
+QuicMultiThreadedServer::QuicMultiThreadedServer(
+    size_t num_workers, ProofSourceFactory proof_source_factory,
+    const QuicConfig& config,
+    const QuicCryptoServerConfig::ConfigOptions& crypto_config_options,
+    const ParsedQuicVersionVector& supported_versions,
+    QuicSimpleServerBackend* quic_simple_server_backend,
+    uint8_t expected_server_connection_id_length)
+    : time_wait_store_(std::make_shared<QuicTimeWaitStore>()),
+      expected_server_connection_id_length_(
+          expected_server_connection_id_length),
+      port_(0) {
+  QUICHE_DCHECK_GT(num_workers, 0u);
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers_.push_back(std::make_unique<QuicServerWorker>(
+        i, this, proof_source_factory(), config, crypto_config_options,
+        supported_versions, quic_simple_server_backend,
+        expected_server_connection_id_length));
+  }
+}
+
+QuicMultiThreadedServer::~QuicMultiThreadedServer() { Shutdown(); }
+
+bool QuicMultiThreadedServer::SetSteeringConfig(
+    const LoadBalancerConfig& config) {
+  if (config.total_len() != expected_server_connection_id_length_) {
+    QUIC_LOG(ERROR) << "Steering config produces connection IDs of length "
+                    << static_cast<int>(config.total_len())
+                    << ", server expects "
+                    << static_cast<int>(expected_server_connection_id_length_);
+    return false;
+  }
+  steering_ = QuicReuseportSteering::Create(config, workers_.size());
+  return steering_.has_value();
+}
+
+void QuicMultiThreadedServer::SetAllocatorType(QuicAllocator allocator_type) {
+  for (const auto& worker : workers_) {
+    worker->set_allocator_type(allocator_type);
+  }
+}
+
+bool QuicMultiThreadedServer::CreateUDPSocketAndListen(
+    const QuicSocketAddress& address) {
+  QuicSocketAddress worker_address = address;
+  for (const auto& worker : workers_) {
+    if (!worker->CreateUDPSocketAndListen(worker_address)) {
+      QUIC_LOG(ERROR) << "Worker " << worker->worker_index()
+                      << " failed to listen on " << worker_address;
+      return false;
+    }
+    if (worker_address.port() == 0) {
+      // Bind the remaining workers to the port picked by the kernel.
+      worker_address = QuicSocketAddress(address.host(), worker->port());
+    }
+  }
+  port_ = worker_address.port();
+  // Workers joined the reuseport group in index order, so socket i of the
+  // group belongs to worker i.
+  if (steering_.has_value() && !steering_->AttachToSocket(workers_[0]->fd())) {
+    QUIC_LOG(WARNING) << "Reuseport steering unavailable, misrouted packets "
+                         "will be forwarded between workers";
+  }
+  return true;
+}
+
+void QuicMultiThreadedServer::HandleEventsForever() {
+  Start();
+  shutdown_notification_.WaitForNotification();
+}
+
+void QuicMultiThreadedServer::Start() {
+  QuicWriterMutexLock lock(&threads_mutex_);
+  if (!threads_.empty() || shutdown_notification_.HasBeenNotified()) {
+    return;
+  }
+  for (const auto& worker : workers_) {
+    threads_.push_back(std::make_unique<WorkerThread>(worker.get()));
+    threads_.back()->Start();
+  }
+}
+
+void QuicMultiThreadedServer::Shutdown() {
+  // Workers never take |threads_mutex_|, so holding it while joining them
+  // cannot deadlock.
+  QuicWriterMutexLock lock(&threads_mutex_);
+  if (!threads_.empty()) {
+    for (const auto& worker : workers_) {
+      worker->RequestStop();
+    }
+    for (const auto& thread : threads_) {
+      thread->Join();
+    }
+    threads_.clear();
+  }
+  // Notified even if no thread was started, so that a Start() or
+  // HandleEventsForever() which loses the race to the lock returns at once.
+  if (!shutdown_notification_.HasBeenNotified()) {
+    shutdown_notification_.Notify();
+  }
+}
+
+void QuicMultiThreadedServer::ForwardPacket(
+    size_t worker_index, const QuicSocketAddress& self_address,
+    const QuicSocketAddress& peer_address, const QuicReceivedPacket& packet) {
+  if (worker_index >= workers_.size()) {
+    QUIC_BUG(quic_multi_threaded_server_bad_worker_index)
+        << "Invalid worker index " << worker_index;
+    return;
+  }
+  workers_[worker_index]->EnqueueForwardedPacket(self_address, peer_address,
+                                                 packet);
+}
+
+}  // namespace quic
@@ -0,0 +1,301 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A server which spreads connections over several worker threads. Each worker
+// is a QuicServer with its own SO_REUSEPORT socket, epoll server and
+// dispatcher. The only per-packet state workers share is the time-wait list,
+// a QuicTimeWaitStore, since a closed connection's packets may reach any
+// worker.
+//
+// The kernel picks the socket for an incoming packet by hashing its 4-tuple,
+// which changes when a client migrates or is NAT-rebound. Connections are
+// therefore pinned to workers by server connection ID instead: every worker
+// records the connection IDs of the sessions it owns in a shared
+// QuicConnectionIdOwnerMap, and a packet that arrives at a worker which does
+// not own its connection is handed over to the owning worker.
+//
+// If a QUIC-LB config is set with SetSteeringConfig(), new connections are
+// given connection IDs which encode the index of their worker, and a reuseport
+// BPF program steers packets to the right socket in the kernel. Forwarding
+// stays in place as a fallback for kernels without reuseport BPF support and
+// for connection IDs which do not encode a worker.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_MULTI_THREADED_SERVER_H_
+#define QUICHE_QUIC_TOOLS_QUIC_MULTI_THREADED_SERVER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "quiche/quic/core/crypto/proof_source.h"
+#include "quiche/quic/core/crypto/quic_crypto_server_config.h"
+#include "quiche/quic/core/quic_config.h"
+#include "quiche/quic/core/quic_connection_id.h"
+#include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_reuseport_steering.h"
+#include "quiche/quic/core/quic_time_wait_store.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/load_balancer/load_balancer_config.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+#include "quiche/quic/tools/quic_server.h"
+#include "quiche/quic/tools/quic_simple_server_backend.h"
+#include "quiche/quic/tools/quic_spdy_server_base.h"
+#include "quiche/common/quiche_mpsc_queue.h"
+
+namespace quic {
+
+class QuicMultiThreadedServer;
+
+// Thread-safe map from server connection ID to the index of the worker that
+// owns the connection. Sharded by connection ID hash to keep lock contention
+// between workers low.
+class QUIC_NO_EXPORT QuicConnectionIdOwnerMap {
+ public:
+  QuicConnectionIdOwnerMap() = default;
+  QuicConnectionIdOwnerMap(const QuicConnectionIdOwnerMap&) = delete;
+  QuicConnectionIdOwnerMap& operator=(const QuicConnectionIdOwnerMap&) =
+      delete;
+
+  // Records that |connection_id| belongs to worker |worker_index|.
+  void Register(const QuicConnectionId& connection_id, size_t worker_index);
+
+  // Forgets |connection_id|. No-op if it is not registered.
+  void Unregister(const QuicConnectionId& connection_id);
+
+  // Returns the index of the worker that owns |connection_id|, if any.
+  absl::optional<size_t> Lookup(const QuicConnectionId& connection_id) const;
+
+  // Number of registered connection IDs.
+  size_t size() const;
+
+ private:
+  static constexpr size_t kNumShards = 16;
+
+  struct QUIC_NO_EXPORT Shard {
+    mutable QuicMutex mutex;
+    absl::flat_hash_map<QuicConnectionId, size_t, QuicConnectionIdHash>
+        owners QUIC_GUARDED_BY(mutex);
+  };
+
+  Shard& GetShard(const QuicConnectionId& connection_id);
+  const Shard& GetShard(const QuicConnectionId& connection_id) const;
+
+  std::array<Shard, kNumShards> shards_;
+};
+
+// One worker of a QuicMultiThreadedServer. All methods except
+// EnqueueForwardedPacket() and RequestStop() run on the worker's thread once
+// the worker has been started.
+class QUIC_NO_EXPORT QuicServerWorker : public QuicServer {
+ public:
+  QuicServerWorker(
+      size_t worker_index, QuicMultiThreadedServer* owner,
+      std::unique_ptr<ProofSource> proof_source, const QuicConfig& config,
+      const QuicCryptoServerConfig::ConfigOptions& crypto_config_options,
+      const ParsedQuicVersionVector& supported_versions,
+      QuicSimpleServerBackend* quic_simple_server_backend,
+      uint8_t expected_server_connection_id_length);
+  QuicServerWorker(const QuicServerWorker&) = delete;
+  QuicServerWorker& operator=(const QuicServerWorker&) = delete;
+
+  ~QuicServerWorker() override;
+
+  // QuicServer overrides. Also registers the wake-up fd used for packets
+  // forwarded by other workers.
+  bool CreateUDPSocketAndListen(const QuicSocketAddress& address) override;
+
+  // Runs the event loop on the calling thread until RequestStop() is called,
+  // then shuts the worker down.
+  void RunEventLoop();
+
+  // Asks the event loop to return. Can be called from any thread.
+  void RequestStop();
+
+  // Hands |packet| to this worker, which processes it on its own thread as if
+  // it had been read from its socket. Can be called from any thread.
+  void EnqueueForwardedPacket(const QuicSocketAddress& self_address,
+                              const QuicSocketAddress& peer_address,
+                              const QuicReceivedPacket& packet);
+
+  size_t worker_index() const { return worker_index_; }
+
+  // Number of forwarded packets this worker has handed to its dispatcher. Can
+  // be called from any thread.
+  size_t num_forwarded_packets_processed() const {
+    return num_forwarded_packets_processed_.load(std::memory_order_acquire);
+  }
+
+ protected:
+  QuicDispatcher* CreateQuicDispatcher() override;
+
+ private:
+  struct QUIC_NO_EXPORT ForwardedPacket {
+    QuicSocketAddress self_address;
+    QuicSocketAddress peer_address;
+    std::unique_ptr<QuicReceivedPacket> packet;
+  };
+
+  // Wakes up the event loop when other workers forward packets to this one.
+  class QUIC_NO_EXPORT ForwardedPacketListener
+      : public QuicEpollCallbackInterface {
+   public:
+    explicit ForwardedPacketListener(QuicServerWorker* worker)
+        : worker_(worker) {}
+
+    std::string Name() const override { return "ForwardedPacketListener"; }
+    void OnRegistration(QuicEpollServer* /*eps*/, int /*fd*/,
+                        int /*event_mask*/) override {}
+    void OnModification(int /*fd*/, int /*event_mask*/) override {}
+    void OnEvent(int fd, QuicEpollEvent* event) override;
+    void OnUnregistration(int /*fd*/, bool /*replaced*/) override {}
+    void OnShutdown(QuicEpollServer* /*eps*/, int /*fd*/) override {}
+
+   private:
+    QuicServerWorker* worker_;  // Unowned.
+  };
+
+  // Processes all packets currently queued by other workers.
+  void ProcessForwardedPackets();
+
+  // Makes the event loop return from its current wait.
+  void Wake();
+
+  const size_t worker_index_;
+  QuicMultiThreadedServer* owner_;  // Unowned.
+
+  // eventfd which becomes readable when packets are forwarded to this worker
+  // or a stop is requested.
+  int wake_fd_;
+  ForwardedPacketListener forwarded_packet_listener_;
+
+  std::atomic<bool> stop_requested_;
+
+  quiche::QuicheMpscQueue<ForwardedPacket> forwarded_packets_;
+  // True if |wake_fd_| has been written to since the worker last started
+  // draining |forwarded_packets_|, so that producers only write to it once per
+  // batch of forwarded packets.
+  std::atomic<bool> wake_pending_;
+  std::atomic<size_t> num_forwarded_packets_processed_;
+};
+
+class QUIC_NO_EXPORT QuicMultiThreadedServer : public QuicSpdyServerBase {
+ public:
+  // Creates the ProofSource of one worker. Called once per worker.
+  using ProofSourceFactory = std::function<std::unique_ptr<ProofSource>()>;
+
+  // |quic_simple_server_backend| is shared by all workers and must be
+  // thread-safe.
+  QuicMultiThreadedServer(size_t num_workers,
+                          ProofSourceFactory proof_source_factory,
+                          QuicSimpleServerBackend* quic_simple_server_backend);
+  QuicMultiThreadedServer(
+      size_t num_workers, ProofSourceFactory proof_source_factory,
+      const QuicConfig& config,
+      const QuicCryptoServerConfig::ConfigOptions& crypto_config_options,
+      const ParsedQuicVersionVector& supported_versions,
+      QuicSimpleServerBackend* quic_simple_server_backend,
+      uint8_t expected_server_connection_id_length);
+  QuicMultiThreadedServer(const QuicMultiThreadedServer&) = delete;
+  QuicMultiThreadedServer& operator=(const QuicMultiThreadedServer&) = delete;
+
+  ~QuicMultiThreadedServer() override;
+
+  // Steers connections to workers by the server ID bytes of |config|, which
+  // must be unencrypted and produce connection IDs of the length the server
+  // expects. Must be called before CreateUDPSocketAndListen(). Returns false if
+  // |config| cannot be used.
+  bool SetSteeringConfig(const LoadBalancerConfig& config);
+
+  // Selects the allocator every worker uses for stream send buffers. Since
+  // each worker has its own connection helper, QuicAllocator::SLAB gives each
+  // worker thread its own size classes. Must be called before
+  // CreateUDPSocketAndListen().
+  void SetAllocatorType(QuicAllocator allocator_type);
+
+  // Creates one SO_REUSEPORT socket per worker, all bound to |address|. If the
+  // port of |address| is 0, the port picked for the first worker is used for
+  // all of them.
+  bool CreateUDPSocketAndListen(const QuicSocketAddress& address) override;
+
+  // Starts the workers and blocks until Shutdown() is called from another
+  // thread.
+  void HandleEventsForever() override;
+
+  // Starts one thread per worker. Returns immediately. No-op once Shutdown()
+  // has been called.
+  void Start();
+
+  // Stops all workers and joins their threads. Can be called from any thread
+  // other than a worker thread, including while another thread is in Start()
+  // or HandleEventsForever().
+  void Shutdown();
+
+  // Hands |packet| to worker |worker_index|. Called by workers that received a
+  // packet for a connection owned by another worker.
+  void ForwardPacket(size_t worker_index, const QuicSocketAddress& self_address,
+                     const QuicSocketAddress& peer_address,
+                     const QuicReceivedPacket& packet);
+
+  QuicConnectionIdOwnerMap* connection_id_owners() {
+    return &connection_id_owners_;
+  }
+
+  // Connections in time wait, shared by the dispatchers of all workers.
+  const std::shared_ptr<QuicTimeWaitStore>& time_wait_store() const {
+    return time_wait_store_;
+  }
+
+  size_t num_workers() const { return workers_.size(); }
+
+  QuicServerWorker* worker(size_t worker_index) {
+    return workers_[worker_index].get();
+  }
+
+  int port() const { return port_; }
+
+  // Returns nullptr if no steering config is set.
+  const QuicReuseportSteering* steering() const {
+    return steering_.has_value() ? &*steering_ : nullptr;
+  }
+
+ private:
+  class QUIC_NO_EXPORT WorkerThread : public QuicThread {
+   public:
+    explicit WorkerThread(QuicServerWorker* worker)
+        : QuicThread("QuicServerWorker"), worker_(worker) {}
+
+    void Run() override { worker_->RunEventLoop(); }
+
+   private:
+    QuicServerWorker* worker_;  // Unowned.
+  };
+
+  QuicConnectionIdOwnerMap connection_id_owners_;
+  std::shared_ptr<QuicTimeWaitStore> time_wait_store_;
+  absl::optional<QuicReuseportSteering> steering_;
+  const uint8_t expected_server_connection_id_length_;
+  std::vector<std::unique_ptr<QuicServerWorker>> workers_;
+
+  // Held while threads are started or stopped, since Shutdown() is usually
+  // called from another thread than HandleEventsForever().
+  QuicMutex threads_mutex_;
+  std::vector<std::unique_ptr<WorkerThread>> threads_
+      QUIC_GUARDED_BY(threads_mutex_);
+
+  // Signaled by Shutdown() to release HandleEventsForever().
+  QuicNotification shutdown_notification_;
+
+  int port_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_MULTI_THREADED_SERVER_H_
@@ -0,0 +1,177 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_multi_threaded_server.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quiche/quic/load_balancer/load_balancer_config.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/platform/api/quic_test_loopback.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/first_flight.h"
+#include "quiche/quic/test_tools/quic_dispatcher_peer.h"
+#include "quiche/quic/test_tools/quic_server_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/quic/tools/quic_memory_cache_backend.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicConnectionIdOwnerMapTest : public QuicTest {};
+
+TEST_F(QuicConnectionIdOwnerMapTest, RegisterLookupAndUnregister) {
+  QuicConnectionIdOwnerMap owners;
+  EXPECT_FALSE(owners.Lookup(TestConnectionId(1)).has_value());
+
+  owners.Register(TestConnectionId(1), 0);
+  owners.Register(TestConnectionId(2), 3);
+  EXPECT_EQ(2u, owners.size());
+  EXPECT_EQ(0u, owners.Lookup(TestConnectionId(1)).value());
+  EXPECT_EQ(3u, owners.Lookup(TestConnectionId(2)).value());
+
+  // Re-registering moves the connection ID to the new owner.
+  owners.Register(TestConnectionId(1), 2);
+  EXPECT_EQ(2u, owners.Lookup(TestConnectionId(1)).value());
+  EXPECT_EQ(2u, owners.size());
+
+  owners.Unregister(TestConnectionId(1));
+  EXPECT_FALSE(owners.Lookup(TestConnectionId(1)).has_value());
+  owners.Unregister(TestConnectionId(1));
+  EXPECT_EQ(1u, owners.size());
+}
+
+class QuicMultiThreadedServerTest : public QuicTest {
+ protected:
+  QuicMultiThreadedServerTest()
+      : server_(/*num_workers=*/3,
+                [] { return crypto_test_utils::ProofSourceForTesting(); },
+                &backend_) {}
+
+  QuicMemoryCacheBackend backend_;
+  QuicMultiThreadedServer server_;
+};
+
+TEST_F(QuicMultiThreadedServerTest, WorkersShareOnePort) {
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(
+      QuicSocketAddress(TestLoopback(), /*port=*/0)));
+  ASSERT_NE(0, server_.port());
+  ASSERT_EQ(3u, server_.num_workers());
+  for (size_t i = 0; i < server_.num_workers(); ++i) {
+    EXPECT_EQ(i, server_.worker(i)->worker_index());
+    EXPECT_EQ(server_.port(), server_.worker(i)->port());
+  }
+}
+
+TEST_F(QuicMultiThreadedServerTest, SetSteeringConfig) {
+  EXPECT_EQ(nullptr, server_.steering());
+  // Connection IDs would be 10 bytes long, the server expects 8.
+  EXPECT_FALSE(server_.SetSteeringConfig(
+      *LoadBalancerConfig::CreateUnencrypted(0, 5, 4)));
+  EXPECT_EQ(nullptr, server_.steering());
+
+  ASSERT_TRUE(server_.SetSteeringConfig(
+      *LoadBalancerConfig::CreateUnencrypted(0, 3, 4)));
+  ASSERT_NE(nullptr, server_.steering());
+  EXPECT_EQ(3u, server_.steering()->num_sockets());
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(
+      QuicSocketAddress(TestLoopback(), /*port=*/0)));
+  server_.Start();
+  server_.Shutdown();
+}
+
+TEST_F(QuicMultiThreadedServerTest, StartAndShutdown) {
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(
+      QuicSocketAddress(TestLoopback(), /*port=*/0)));
+  server_.Start();
+  server_.Shutdown();
+  // Shutting down twice is a no-op.
+  server_.Shutdown();
+}
+
+TEST_F(QuicMultiThreadedServerTest, ForwardedPacketWakesOwningWorker) {
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(
+      QuicSocketAddress(TestLoopback(), /*port=*/0)));
+  server_.Start();
+
+  // A packet for an unknown connection is handled by the receiving worker's
+  // dispatcher like any other packet read from its socket. Worker i is handed
+  // i + 1 packets, so that each count can only come from its own queue.
+  char buffer[] = "not a valid QUIC packet";
+  QuicReceivedPacket packet(buffer, sizeof(buffer), QuicTime::Zero());
+  QuicSocketAddress self_address(TestLoopback(), server_.port());
+  QuicSocketAddress peer_address(TestLoopback(), 4433);
+  for (size_t i = 0; i < server_.num_workers(); ++i) {
+    for (size_t j = 0; j <= i; ++j) {
+      server_.ForwardPacket(i, self_address, peer_address, packet);
+    }
+  }
+
+  // Workers process forwarded packets on their own threads.
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  for (size_t i = 0; i < server_.num_workers(); ++i) {
+    while (server_.worker(i)->num_forwarded_packets_processed() < i + 1 &&
+           absl::Now() < deadline) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+  }
+  server_.Shutdown();
+  for (size_t i = 0; i < server_.num_workers(); ++i) {
+    EXPECT_EQ(i + 1, server_.worker(i)->num_forwarded_packets_processed());
+  }
+}
+
+TEST_F(QuicMultiThreadedServerTest, PacketReachesSessionOfOwningWorker) {
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(
+      QuicSocketAddress(TestLoopback(), /*port=*/0)));
+  // The workers are not started, the test thread runs each of them in turn.
+  QuicServerWorker* owner = server_.worker(0);
+  QuicServerWorker* receiver = server_.worker(1);
+  QuicDispatcher* owner_dispatcher = QuicServerPeer::GetDispatcher(owner);
+  const QuicSocketAddress self_address(TestLoopback(), server_.port());
+  const QuicSocketAddress peer_address(TestLoopback(), 4433);
+
+  // The owning worker accepts the connection.
+  QuicDispatcherPeer::set_new_sessions_allowed_per_event_loop(owner_dispatcher,
+                                                              1);
+  for (const auto& packet : GetFirstFlightOfPackets(
+           ParsedQuicVersion::RFCv1(), TestConnectionId(42))) {
+    owner_dispatcher->ProcessPacket(self_address, peer_address, *packet);
+  }
+  QuicSession* session =
+      QuicDispatcherPeer::GetFirstSessionIfAny(owner_dispatcher);
+  ASSERT_NE(nullptr, session);
+  const QuicConnectionId connection_id = session->connection()->connection_id();
+  ASSERT_EQ(0u, server_.connection_id_owners()->Lookup(connection_id).value());
+  const QuicByteCount bytes_received =
+      session->connection()->GetStats().bytes_received;
+
+  // The client migrates, and its next packet is read from the other worker's
+  // socket.
+  std::string data(100, 'a');
+  data[0] = 0x40;
+  memcpy(&data[1], connection_id.data(), connection_id.length());
+  QuicReceivedPacket packet(data.data(), data.size(), QuicTime::Zero());
+  QuicServerPeer::GetDispatcher(receiver)->ProcessPacket(
+      self_address, QuicSocketAddress(TestLoopback(), 4434), packet);
+  EXPECT_EQ(0u, receiver->num_forwarded_packets_processed());
+  EXPECT_EQ(bytes_received, session->connection()->GetStats().bytes_received);
+
+  // The owning worker picks the packet up when its wake-up fd fires, and its
+  // session receives it.
+  owner->WaitForEvents();
+  EXPECT_EQ(1u, owner->num_forwarded_packets_processed());
+  EXPECT_EQ(bytes_received + data.size(),
+            session->connection()->GetStats().bytes_received);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
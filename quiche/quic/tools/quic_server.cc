@@ -10,10 +10,14 @@
 #include <string.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <time.h>
 
 #include <cstdint>
 #include <memory>
 
+#include "quiche/quic/core/batch_writer/quic_batch_writer_buffer.h"
+#include "quiche/quic/core/batch_writer/quic_gso_batch_writer.h"
+#include "quiche/quic/core/batch_writer/quic_io_uring_batch_writer.h"
 #include "quiche/quic/core/crypto/crypto_handshake.h"
 #include "quiche/quic/core/crypto/quic_random.h"
 #include "quiche/quic/core/quic_clock.h"
@@ -24,6 +28,8 @@
 #include "quiche/quic/core/quic_epoll_alarm_factory.h"
 #include "quiche/quic/core/quic_epoll_clock.h"
 #include "quiche/quic/core/quic_epoll_connection_helper.h"
+#include "quiche/quic/core/quic_handshake_admission_controller.h"
+#include "quiche/quic/core/quic_io_uring_packet_reader.h"
 #include "quiche/quic/core/quic_packet_reader.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/platform/api/quic_flags.h"
@@ -66,12 +72,18 @@ QuicServer::QuicServer(
       packets_dropped_(0),
       overflow_supported_(false),
       silent_close_(false),
+      reuse_port_(false),
+      allocator_type_(QuicAllocator::BUFFER_POOL),
       config_(config),
+      thread_pool_proof_source_(nullptr),
       crypto_config_(kSourceAddressTokenSecret, QuicRandom::GetInstance(),
-                     std::move(proof_source), KeyExchangeSource::Default()),
+                     MaybeSignOnThreadPool(std::move(proof_source)),
+                     KeyExchangeSource::Default()),
       crypto_config_options_(crypto_config_options),
       version_manager_(supported_versions),
       packet_reader_(new QuicPacketReader()),
+      io_uring_batch_writer_(nullptr),
+      zerocopy_writer_(nullptr),
       quic_simple_server_backend_(quic_simple_server_backend),
       expected_server_connection_id_length_(
           expected_server_connection_id_length) {
@@ -101,11 +113,53 @@ void QuicServer::Initialize() {
 
   std::unique_ptr<CryptoHandshakeMessage> scfg(crypto_config_.AddDefaultConfig(
       QuicRandom::GetInstance(), &clock, crypto_config_options_));
+
+  if (thread_pool_proof_source_ != nullptr) {
+    thread_pool_proof_source_->RegisterWith(&epoll_server_);
+  }
+}
+
+std::unique_ptr<ProofSource> QuicServer::MaybeSignOnThreadPool(
+    std::unique_ptr<ProofSource> proof_source) {
+  const int32_t num_threads = GetQuicFlag(FLAGS_quic_server_signing_threads);
+  if (num_threads <= 0) {
+    return proof_source;
+  }
+  QuicThreadPoolProofSource::Options options;
+  options.num_threads = num_threads;
+  options.max_queue_depth =
+      GetQuicFlag(FLAGS_quic_server_signing_max_queue_depth);
+  const int32_t max_queue_delay_ms =
+      GetQuicFlag(FLAGS_quic_server_signing_max_queue_delay_ms);
+  if (max_queue_delay_ms > 0) {
+    options.max_queue_delay =
+        QuicTime::Delta::FromMilliseconds(max_queue_delay_ms);
+  }
+  auto thread_pool_proof_source = std::make_unique<QuicThreadPoolProofSource>(
+      std::move(proof_source), options);
+  thread_pool_proof_source_ = thread_pool_proof_source.get();
+  return thread_pool_proof_source;
 }
 
 QuicServer::~QuicServer() = default;
 
 bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
+  if (GetQuicFlag(FLAGS_quic_server_edt_pacing) &&
+      GetQuicFlag(FLAGS_quic_server_enable_io_uring)) {
+    // The io_uring writer does not pass release times to the kernel, so one
+    // of the two would silently be ignored.
+    QUIC_LOG(ERROR) << "--quic_server_edt_pacing cannot be combined with "
+                       "--quic_server_enable_io_uring.";
+    return false;
+  }
+  if (GetQuicFlag(FLAGS_quic_server_enable_zerocopy) &&
+      GetQuicFlag(FLAGS_quic_server_enable_io_uring)) {
+    // Neither does the io_uring writer send with MSG_ZEROCOPY.
+    QUIC_LOG(ERROR) << "--quic_server_enable_zerocopy cannot be combined with "
+                       "--quic_server_enable_io_uring.";
+    return false;
+  }
+
   QuicUdpSocketApi socket_api;
   fd_ = socket_api.Create(address.host().AddressFamilyToInt(),
                           /*receive_buffer_size =*/kDefaultSocketReceiveBuffer,
@@ -117,6 +171,16 @@ bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
 
   overflow_supported_ = socket_api.EnableDroppedPacketCount(fd_);
   socket_api.EnableReceiveTimestamp(fd_);
+  if (GetQuicFlag(FLAGS_quic_server_enable_udp_gro) &&
+      !packet_reader_->EnableUdpGro(fd_)) {
+    QUIC_LOG(WARNING) << "UDP GRO is not supported, reading one datagram at a "
+                         "time.";
+  }
+
+  if (reuse_port_ && !socket_api.EnableReusePort(fd_)) {
+    QUIC_LOG(ERROR) << "Failed to set SO_REUSEPORT: " << strerror(errno);
+    return false;
+  }
 
   sockaddr_storage addr = address.generic_address();
   int rc = bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
@@ -135,23 +199,87 @@ bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
     port_ = address.port();
   }
 
-  epoll_server_.RegisterFD(fd_, this, kEpollFlags);
+  if (GetQuicFlag(FLAGS_quic_server_enable_io_uring)) {
+    io_uring_packet_reader_ = QuicIoUringPacketReader::Create(
+        fd_, packet_reader_->udp_gro_enabled());
+    if (io_uring_packet_reader_ == nullptr) {
+      QUIC_LOG(WARNING) << "io_uring is not supported, reading with recvmmsg.";
+    }
+  }
+  if (io_uring_packet_reader_ != nullptr) {
+    // Packets are received by the kernel into the reader's buffers, and the
+    // ring polls readable once they are ready to be dispatched. The socket
+    // itself is only polled for writability.
+    epoll_server_.RegisterFD(io_uring_packet_reader_->ring_fd(), this,
+                             EPOLLIN | EPOLLET);
+    epoll_server_.RegisterFD(fd_, this, EPOLLOUT | EPOLLET);
+  } else {
+    epoll_server_.RegisterFD(fd_, this, kEpollFlags);
+  }
   dispatcher_.reset(CreateQuicDispatcher());
   dispatcher_->InitializeWithWriter(CreateWriter(fd_));
+  if (io_uring_batch_writer_ != nullptr) {
+    // Flushes do not wait for their sends, whose completions are reaped when
+    // the writer's ring polls readable.
+    epoll_server_.RegisterFD(io_uring_batch_writer_->completion_fd(), this,
+                             EPOLLIN | EPOLLET);
+  }
+  if (GetQuicFlag(FLAGS_quic_server_handshake_admission_control)) {
+    dispatcher_->SetHandshakeAdmissionController(
+        std::make_unique<QuicHandshakeAdmissionController>(
+            QuicHandshakeAdmissionController::Options()));
+  }
 
   return true;
 }
 
 QuicPacketWriter* QuicServer::CreateWriter(int fd) {
+  if (GetQuicFlag(FLAGS_quic_server_edt_pacing)) {
+    // The fq qdisc schedules packets by CLOCK_MONOTONIC release times.
+    auto writer = std::make_unique<QuicGsoBatchWriter>(fd, CLOCK_MONOTONIC);
+    if (writer->SupportsReleaseTime()) {
+      MaybeEnableZerocopy(writer.get());
+      return writer.release();
+    }
+    QUIC_LOG(WARNING) << "SO_TXTIME is not supported, pacing with timers.";
+  }
+  if (GetQuicFlag(FLAGS_quic_server_enable_zerocopy)) {
+    auto writer = std::make_unique<QuicGsoBatchWriter>(fd);
+    if (MaybeEnableZerocopy(writer.get())) {
+      return writer.release();
+    }
+  }
+  if (GetQuicFlag(FLAGS_quic_server_enable_io_uring)) {
+    std::unique_ptr<QuicIoUringBatchWriter> writer =
+        QuicIoUringBatchWriter::Create(
+            std::make_unique<QuicBatchWriterBuffer>(), fd);
+    if (writer != nullptr) {
+      io_uring_batch_writer_ = writer.get();
+      return writer.release();
+    }
+    QUIC_LOG(WARNING) << "io_uring is not supported, writing with sendmsg.";
+  }
   return new QuicDefaultPacketWriter(fd);
 }
 
+bool QuicServer::MaybeEnableZerocopy(QuicGsoBatchWriter* writer) {
+  if (!GetQuicFlag(FLAGS_quic_server_enable_zerocopy)) {
+    return false;
+  }
+  if (!writer->EnableZerocopy()) {
+    QUIC_LOG(WARNING) << "MSG_ZEROCOPY is not supported, copying writes.";
+    return false;
+  }
+  zerocopy_writer_ = writer;
+  return true;
+}
+
 QuicDispatcher* QuicServer::CreateQuicDispatcher() {
   QuicEpollAlarmFactory alarm_factory(&epoll_server_);
   return new QuicSimpleDispatcher(
       &config_, &crypto_config_, &version_manager_,
       std::unique_ptr<QuicEpollConnectionHelper>(new QuicEpollConnectionHelper(
-          &epoll_server_, QuicAllocator::BUFFER_POOL)),
+          &epoll_server_, allocator_type_)),
       std::unique_ptr<QuicCryptoServerStreamBase::Helper>(
           new QuicSimpleCryptoServerStreamHelper()),
       std::unique_ptr<QuicEpollAlarmFactory>(
@@ -178,13 +306,30 @@ void QuicServer::Shutdown() {
 
   epoll_server_.Shutdown();
 
+  // Cancels the pending receive before the socket is closed.
+  io_uring_packet_reader_.reset();
   close(fd_);
   fd_ = -1;
 }
 
 void QuicServer::OnEvent(int fd, QuicEpollEvent* event) {
-  QUICHE_DCHECK_EQ(fd, fd_);
   event->out_ready_mask = 0;
+  if (io_uring_batch_writer_ != nullptr &&
+      fd == io_uring_batch_writer_->completion_fd()) {
+    if (io_uring_batch_writer_->OnCompletionsAvailable()) {
+      dispatcher_->OnCanWrite();
+    }
+    return;
+  }
+  QUICHE_DCHECK(fd == fd_ || (io_uring_packet_reader_ != nullptr &&
+                              fd == io_uring_packet_reader_->ring_fd()));
+
+  if ((event->in_events & EPOLLERR) && zerocopy_writer_ != nullptr &&
+      fd == fd_) {
+    // The kernel reports completed zerocopy sends on the socket's error queue.
+    QUIC_DVLOG(1) << "EPOLLERR";
+    zerocopy_writer_->ReapZerocopyCompletions();
+  }
 
   if (event->in_events & EPOLLIN) {
     QUIC_DVLOG(1) << "EPOLLIN";
@@ -193,9 +338,15 @@ void QuicServer::OnEvent(int fd, QuicEpollEvent* event) {
 
     bool more_to_read = true;
     while (more_to_read) {
-      more_to_read = packet_reader_->ReadAndDispatchPackets(
-          fd_, port_, QuicEpollClock(&epoll_server_), dispatcher_.get(),
-          overflow_supported_ ? &packets_dropped_ : nullptr);
+      if (io_uring_packet_reader_ != nullptr) {
+        more_to_read = io_uring_packet_reader_->ReadAndDispatchPackets(
+            port_, QuicEpollClock(&epoll_server_), dispatcher_.get(),
+            overflow_supported_ ? &packets_dropped_ : nullptr);
+      } else {
+        more_to_read = packet_reader_->ReadAndDispatchPackets(
+            fd_, port_, QuicEpollClock(&epoll_server_), dispatcher_.get(),
+            overflow_supported_ ? &packets_dropped_ : nullptr);
+      }
     }
 
     if (dispatcher_->HasChlosBuffered()) {
@@ -25,6 +25,7 @@
 #include "quiche/quic/platform/api/quic_socket_address.h"
 #include "quiche/quic/tools/quic_simple_server_backend.h"
 #include "quiche/quic/tools/quic_spdy_server_base.h"
+#include "quiche/quic/tools/quic_thread_pool_proof_source.h"
 
 namespace quic {
 
@@ -33,6 +34,9 @@ class QuicServerPeer;
 }  // namespace test
 
 class QuicDispatcher;
+class QuicGsoBatchWriter;
+class QuicIoUringBatchWriter;
+class QuicIoUringPacketReader;
 class QuicPacketReader;
 
 class QuicServer : public QuicSpdyServerBase,
@@ -84,12 +88,25 @@ class QuicServer : public QuicSpdyServerBase,
     crypto_config_.set_pre_shared_key(key);
   }
 
+  // If true, the listening socket is created with SO_REUSEPORT so that several
+  // servers can listen on the same address. Must be set before
+  // CreateUDPSocketAndListen().
+  void set_reuse_port(bool value) { reuse_port_ = value; }
+
+  // Selects the allocator used for stream send buffers. Defaults to
+  // QuicAllocator::BUFFER_POOL. Must be set before CreateUDPSocketAndListen().
+  void set_allocator_type(QuicAllocator allocator_type) {
+    allocator_type_ = allocator_type;
+  }
+
   bool overflow_supported() { return overflow_supported_; }
 
   QuicPacketCount packets_dropped() { return packets_dropped_; }
 
   int port() { return port_; }
 
+  QuicUdpSocketFd fd() const { return fd_; }
+
   QuicEpollServer* epoll_server() { return &epoll_server_; }
 
  protected:
@@ -114,12 +131,23 @@ class QuicServer : public QuicSpdyServerBase,
     return expected_server_connection_id_length_;
   }
 
+  QuicAllocator allocator_type() const { return allocator_type_; }
+
  private:
   friend class quic::test::QuicServerPeer;
 
   // Initialize the internal state of the server.
   void Initialize();
 
+  // Wraps |proof_source| in a QuicThreadPoolProofSource, recorded in
+  // thread_pool_proof_source_, if --quic_server_signing_threads is positive.
+  std::unique_ptr<ProofSource> MaybeSignOnThreadPool(
+      std::unique_ptr<ProofSource> proof_source);
+
+  // Enables zerocopy sends on |writer|, recorded in zerocopy_writer_, if
+  // --quic_server_enable_zerocopy is set. Returns true if it was enabled.
+  bool MaybeEnableZerocopy(QuicGsoBatchWriter* writer);
+
   // Accepts data from the framer and demuxes clients to sessions.
   std::unique_ptr<QuicDispatcher> dispatcher_;
   // Frames incoming packets and hands them to the dispatcher.
@@ -144,9 +172,19 @@ class QuicServer : public QuicSpdyServerBase,
   // without sending a final connection close.
   bool silent_close_;
 
+  // If true, set SO_REUSEPORT on the listening socket before binding it.
+  bool reuse_port_;
+
+  // The allocator type of the dispatcher's connection helper.
+  QuicAllocator allocator_type_;
+
   // config_ contains non-crypto parameters that are negotiated in the crypto
   // handshake.
   QuicConfig config_;
+  // Computes the TLS signatures of crypto_config_ if
+  // --quic_server_signing_threads is positive, nullptr otherwise. Owned by
+  // crypto_config_, so declared before it.
+  QuicThreadPoolProofSource* thread_pool_proof_source_;
   // crypto_config_ contains crypto parameters for the handshake.
   QuicCryptoServerConfig crypto_config_;
   // crypto_config_options_ contains crypto parameters for the handshake.
@@ -159,6 +197,18 @@ class QuicServer : public QuicSpdyServerBase,
   // space than allowed on the stack.
   std::unique_ptr<QuicPacketReader> packet_reader_;
 
+  // Reads packets instead of |packet_reader_| if
+  // --quic_server_enable_io_uring is set and the kernel supports io_uring.
+  std::unique_ptr<QuicIoUringPacketReader> io_uring_packet_reader_;
+
+  // The dispatcher's writer if CreateWriter() chose io_uring, nullptr
+  // otherwise. Not owned.
+  QuicIoUringBatchWriter* io_uring_batch_writer_;
+
+  // The dispatcher's writer if --quic_server_enable_zerocopy is set and the
+  // socket supports it, nullptr otherwise. Not owned.
+  QuicGsoBatchWriter* zerocopy_writer_;
+
   QuicSimpleServerBackend* quic_simple_server_backend_;  // unowned.
 
   // Connection ID length expected to be read on incoming IETF short headers.
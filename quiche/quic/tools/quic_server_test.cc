@@ -4,7 +4,17 @@
 
 #include "quiche/quic/tools/quic_server.h"
 
+#include <poll.h>
+#include <time.h>
+
+#include <memory>
+#include <string>
+
 #include "absl/base/macros.h"
+#include "openssl/ssl.h"
+#include "quiche/quic/core/batch_writer/quic_batch_writer_buffer.h"
+#include "quiche/quic/core/batch_writer/quic_gso_batch_writer.h"
+#include "quiche/quic/core/batch_writer/quic_io_uring_batch_writer.h"
 #include "quiche/quic/core/crypto/quic_random.h"
 #include "quiche/quic/core/quic_epoll_alarm_factory.h"
 #include "quiche/quic/core/quic_epoll_connection_helper.h"
@@ -16,6 +26,7 @@
 #include "quiche/quic/platform/api/quic_test_loopback.h"
 #include "quiche/quic/test_tools/crypto_test_utils.h"
 #include "quiche/quic/test_tools/mock_quic_dispatcher.h"
+#include "quiche/quic/test_tools/quic_dispatcher_peer.h"
 #include "quiche/quic/test_tools/quic_server_peer.h"
 #include "quiche/quic/tools/quic_memory_cache_backend.h"
 #include "quiche/quic/tools/quic_simple_crypto_server_stream_helper.h"
@@ -58,6 +69,8 @@ class TestQuicServer : public QuicServer {
 
   MockQuicSimpleDispatcher* mock_dispatcher() { return mock_dispatcher_; }
 
+  using QuicServer::crypto_config;
+
  protected:
   QuicDispatcher* CreateQuicDispatcher() override {
     mock_dispatcher_ = new MockQuicSimpleDispatcher(
@@ -140,6 +153,169 @@ TEST_F(QuicServerEpollInTest, ProcessBufferedCHLOsOnEpollin) {
   }
 }
 
+// Tells writers apart by their capabilities, since tests are built without
+// RTTI.
+class QuicServerWriterTest : public QuicTest {
+ public:
+  QuicServerWriterTest() : server_address_(TestLoopback(), 0) {}
+
+  QuicPacketWriter* writer() {
+    return QuicDispatcherPeer::GetWriter(server_.mock_dispatcher());
+  }
+
+  bool IsDefaultWriter() {
+    return !writer()->IsBatchMode() && !writer()->SupportsReleaseTime() &&
+           QuicServerPeer::GetIoUringBatchWriter(&server_) == nullptr;
+  }
+
+ protected:
+  QuicSocketAddress server_address_;
+  TestQuicServer server_;
+};
+
+TEST_F(QuicServerWriterTest, DefaultWriter) {
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(server_address_));
+  EXPECT_TRUE(IsDefaultWriter());
+}
+
+TEST_F(QuicServerWriterTest, IoUringWriter) {
+  SetQuicFlag(FLAGS_quic_server_enable_io_uring, true);
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(server_address_));
+  if (QuicIoUringBatchWriter::Create(std::make_unique<QuicBatchWriterBuffer>(),
+                                     server_.fd()) == nullptr) {
+    // Falls back to sendmsg if the kernel does not support io_uring.
+    EXPECT_TRUE(IsDefaultWriter());
+    return;
+  }
+  EXPECT_EQ(writer(), QuicServerPeer::GetIoUringBatchWriter(&server_));
+  EXPECT_FALSE(writer()->SupportsReleaseTime());
+}
+
+TEST_F(QuicServerWriterTest, EdtPacingWriter) {
+  SetQuicRestartFlag(quic_support_release_time_for_gso, true);
+  SetQuicFlag(FLAGS_quic_server_edt_pacing, true);
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(server_address_));
+  if (!QuicGsoBatchWriter(server_.fd(), CLOCK_MONOTONIC)
+           .SupportsReleaseTime()) {
+    // Falls back to pacing with timers if SO_TXTIME is not supported.
+    EXPECT_TRUE(IsDefaultWriter());
+    return;
+  }
+  EXPECT_TRUE(writer()->IsBatchMode());
+  EXPECT_TRUE(writer()->SupportsReleaseTime());
+  EXPECT_EQ(nullptr, QuicServerPeer::GetIoUringBatchWriter(&server_));
+}
+
+TEST_F(QuicServerWriterTest, ZerocopyWriter) {
+  SetQuicFlag(FLAGS_quic_server_enable_zerocopy, true);
+  ASSERT_TRUE(server_.CreateUDPSocketAndListen(server_address_));
+  QuicGsoBatchWriter* zerocopy_writer =
+      QuicServerPeer::GetZerocopyWriter(&server_);
+  if (zerocopy_writer == nullptr) {
+    // Falls back to copying if the socket does not support SO_ZEROCOPY.
+    EXPECT_TRUE(IsDefaultWriter());
+    return;
+  }
+  EXPECT_EQ(writer(), zerocopy_writer);
+  EXPECT_TRUE(zerocopy_writer->zerocopy_enabled());
+
+  int receiver = socket(
+      AddressFamilyUnderTest() == IpAddressFamily::IP_V4 ? AF_INET : AF_INET6,
+      SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+  ASSERT_LT(0, receiver);
+  sockaddr_storage storage =
+      QuicSocketAddress(TestLoopback(), 0).generic_address();
+  ASSERT_EQ(0, bind(receiver, reinterpret_cast<sockaddr*>(&storage),
+                    sizeof(storage)));
+  QuicSocketAddress receiver_address;
+  ASSERT_EQ(0, receiver_address.FromSocket(receiver));
+
+  // A batch large enough to be sent with MSG_ZEROCOPY.
+  char packet[1200] = {};
+  const size_t num_packets =
+      QuicGsoBatchWriter::kDefaultMinZerocopyBatchSize / sizeof(packet) + 1;
+  for (size_t i = 0; i < num_packets; ++i) {
+    ASSERT_EQ(WRITE_STATUS_OK,
+              writer()
+                  ->WritePacket(packet, sizeof(packet), TestLoopback(),
+                                receiver_address, nullptr)
+                  .status);
+  }
+  ASSERT_EQ(WRITE_STATUS_OK, writer()->Flush().status);
+
+  // The completion of the send makes the socket poll as an error until the
+  // server reads it from the error queue.
+  pollfd server_poll = {server_.fd(), 0, 0};
+  ASSERT_EQ(1, poll(&server_poll, 1, /*timeout=*/1000));
+  EXPECT_TRUE(server_poll.revents & POLLERR);
+  QuicEpollEvent event(EPOLLERR);
+  server_.OnEvent(server_.fd(), &event);
+  EXPECT_EQ(0, poll(&server_poll, 1, /*timeout=*/0));
+  close(receiver);
+}
+
+// The io_uring writer does not send with MSG_ZEROCOPY, so the server refuses to
+// start rather than ignore either flag.
+TEST_F(QuicServerWriterTest, ZerocopyConflictsWithIoUring) {
+  SetQuicFlag(FLAGS_quic_server_enable_zerocopy, true);
+  SetQuicFlag(FLAGS_quic_server_enable_io_uring, true);
+  EXPECT_FALSE(server_.CreateUDPSocketAndListen(server_address_));
+  EXPECT_EQ(nullptr, server_.mock_dispatcher());
+}
+
+// The io_uring writer does not pass release times, so the server refuses to
+// start rather than ignore either flag.
+TEST_F(QuicServerWriterTest, EdtPacingConflictsWithIoUring) {
+  SetQuicFlag(FLAGS_quic_server_edt_pacing, true);
+  SetQuicFlag(FLAGS_quic_server_enable_io_uring, true);
+  EXPECT_FALSE(server_.CreateUDPSocketAndListen(server_address_));
+  EXPECT_EQ(nullptr, server_.mock_dispatcher());
+}
+
+class RecordingSignatureCallback : public ProofSource::SignatureCallback {
+ public:
+  explicit RecordingSignatureCallback(bool* done) : done_(done) {}
+
+  void Run(bool /*ok*/, std::string /*signature*/,
+           std::unique_ptr<ProofSource::Details> /*details*/) override {
+    *done_ = true;
+  }
+
+ private:
+  bool* done_;
+};
+
+class QuicServerSigningThreadsTest : public QuicTest {};
+
+TEST_F(QuicServerSigningThreadsTest, SignsOnEventLoopByDefault) {
+  TestQuicServer server;
+  EXPECT_EQ(nullptr, QuicServerPeer::GetThreadPoolProofSource(&server));
+}
+
+TEST_F(QuicServerSigningThreadsTest, SignsOnThreadPool) {
+  SetQuicFlag(FLAGS_quic_server_signing_threads, 2);
+  TestQuicServer server;
+  QuicThreadPoolProofSource* thread_pool_proof_source =
+      QuicServerPeer::GetThreadPoolProofSource(&server);
+  ASSERT_NE(nullptr, thread_pool_proof_source);
+  ASSERT_TRUE(thread_pool_proof_source->initialized());
+  EXPECT_EQ(thread_pool_proof_source, server.crypto_config().proof_source());
+
+  // Signatures are computed on a worker thread and completed on the server's
+  // event loop, which only happens if the pool registered with it.
+  bool done = false;
+  thread_pool_proof_source->ComputeTlsSignature(
+      QuicSocketAddress(), QuicSocketAddress(), "test.example.com",
+      SSL_SIGN_RSA_PSS_RSAE_SHA256, "data",
+      std::make_unique<RecordingSignatureCallback>(&done));
+  EXPECT_FALSE(done);
+  for (int i = 0; i < 100 && !done; ++i) {
+    server.WaitForEvents();
+  }
+  EXPECT_TRUE(done);
+  EXPECT_EQ(1u, thread_pool_proof_source->stats().signatures_computed);
+}
+
 class QuicServerDispatchPacketTest : public QuicTest {
  public:
   QuicServerDispatchPacketTest()
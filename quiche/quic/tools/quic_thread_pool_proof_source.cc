@@ -0,0 +1,297 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_thread_pool_proof_source.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <utility>
+
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_server_stats.h"
+
+namespace quic {
+
+namespace {
+
+// Returns the microseconds elapsed since |start|.
+int64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Adds |count| to the eventfd |fd|.
+void AddToEventFd(int fd, uint64_t count) {
+  if (write(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    QUIC_LOG_FIRST_N(ERROR, 10)
+        << "Failed to write to eventfd " << fd << ": " << strerror(errno);
+  }
+}
+
+}  // namespace
+
+QuicThreadPoolProofSource::QuicThreadPoolProofSource(
+    std::unique_ptr<ProofSource> delegate, const Options& options)
+    : delegate_(std::move(delegate)),
+      options_(options),
+      // Workers block on reads of this eventfd, each read taking one
+      // signature off the count.
+      queued_fd_(eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC)),
+      completed_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      initialized_(false),
+      stopping_(false),
+      epoll_server_(nullptr) {
+  QUIC_BUG_IF(quic_thread_pool_proof_source_eventfd_failed,
+              queued_fd_ < 0 || completed_fd_ < 0)
+      << "eventfd() failed: " << strerror(errno);
+  QUIC_BUG_IF(quic_thread_pool_proof_source_no_threads,
+              options_.num_threads == 0)
+      << "QuicThreadPoolProofSource needs at least one thread";
+  if (queued_fd_ < 0 || completed_fd_ < 0 || options_.num_threads == 0) {
+    return;
+  }
+  for (size_t i = 0; i < options_.num_threads; ++i) {
+    threads_.push_back(std::make_unique<WorkerThread>(this));
+    threads_.back()->Start();
+  }
+  initialized_ = true;
+}
+
+QuicThreadPoolProofSource::~QuicThreadPoolProofSource() {
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  if (!threads_.empty()) {
+    AddToEventFd(queued_fd_, threads_.size());
+  }
+  for (auto& thread : threads_) {
+    thread->Join();
+  }
+  if (epoll_server_ != nullptr) {
+    epoll_server_->UnregisterFD(completed_fd_);
+  }
+  // The workers are gone, so the results they completed are final, and what
+  // is still queued will never be computed.
+  DeliverCompletedSignatures();
+  std::deque<std::unique_ptr<PendingSignature>> queued;
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    queued.swap(queued_);
+  }
+  for (auto& pending : queued) {
+    pending->callback->Run(/*ok=*/false, "", nullptr);
+  }
+  if (queued_fd_ >= 0) {
+    close(queued_fd_);
+  }
+  if (completed_fd_ >= 0) {
+    close(completed_fd_);
+  }
+}
+
+void QuicThreadPoolProofSource::RegisterWith(QuicEpollServer* epoll_server) {
+  if (!initialized_) {
+    return;
+  }
+  epoll_server->RegisterFD(completed_fd_, this, EPOLLIN);
+}
+
+void QuicThreadPoolProofSource::GetProof(
+    const QuicSocketAddress& server_address,
+    const QuicSocketAddress& client_address, const std::string& hostname,
+    const std::string& server_config, QuicTransportVersion transport_version,
+    absl::string_view chlo_hash, std::unique_ptr<Callback> callback) {
+  delegate_->GetProof(server_address, client_address, hostname, server_config,
+                      transport_version, chlo_hash, std::move(callback));
+}
+
+quiche::QuicheReferenceCountedPointer<ProofSource::Chain>
+QuicThreadPoolProofSource::GetCertChain(const QuicSocketAddress& server_address,
+                                        const QuicSocketAddress& client_address,
+                                        const std::string& hostname,
+                                        bool* cert_matched_sni) {
+  return delegate_->GetCertChain(server_address, client_address, hostname,
+                                 cert_matched_sni);
+}
+
+void QuicThreadPoolProofSource::ComputeTlsSignature(
+    const QuicSocketAddress& server_address,
+    const QuicSocketAddress& client_address, const std::string& hostname,
+    uint16_t signature_algorithm, absl::string_view in,
+    std::unique_ptr<SignatureCallback> callback) {
+  if (!initialized_ || epoll_server_ == nullptr) {
+    QUIC_BUG_IF(quic_thread_pool_proof_source_not_registered, initialized_)
+        << "ComputeTlsSignature called before RegisterWith";
+    callback->Run(/*ok=*/false, "", nullptr);
+    return;
+  }
+
+  auto pending = std::make_unique<PendingSignature>();
+  pending->server_address = server_address;
+  pending->client_address = client_address;
+  pending->hostname = hostname;
+  pending->signature_algorithm = signature_algorithm;
+  pending->in = std::string(in);
+  pending->callback = std::move(callback);
+  pending->enqueue_time = std::chrono::steady_clock::now();
+
+  size_t queue_depth;
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    queue_depth = queued_.size();
+    if (queue_depth < options_.max_queue_depth) {
+      queued_.push_back(std::move(pending));
+    }
+  }
+  QUIC_SERVER_HISTOGRAM_COUNTS(
+      "thread_pool_proof_source_queue_depth", queue_depth, 1, 10000, 50,
+      "Signatures waiting for a thread when another one is queued.");
+  if (pending != nullptr) {
+    // The queue is full: failing this handshake right away is cheaper for
+    // everyone than making all handshakes wait longer.
+    ++stats_.shed_queue_full;
+    QUIC_DLOG(INFO) << "Signature queue full, failing signature for "
+                    << pending->hostname;
+    pending->callback->Run(/*ok=*/false, "", nullptr);
+    return;
+  }
+  AddToEventFd(queued_fd_, 1);
+}
+
+absl::InlinedVector<uint16_t, 8>
+QuicThreadPoolProofSource::SupportedTlsSignatureAlgorithms() const {
+  return delegate_->SupportedTlsSignatureAlgorithms();
+}
+
+ProofSource::TicketCrypter* QuicThreadPoolProofSource::GetTicketCrypter() {
+  return delegate_->GetTicketCrypter();
+}
+
+void QuicThreadPoolProofSource::OnEvent(int fd, QuicEpollEvent* event) {
+  event->out_ready_mask = 0;
+  uint64_t value;
+  while (read(fd, &value, sizeof(value)) > 0) {
+  }
+  DeliverCompletedSignatures();
+}
+
+void QuicThreadPoolProofSource::DeliverCompletedSignatures() {
+  std::vector<std::unique_ptr<PendingSignature>> completed;
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    completed.swap(completed_);
+  }
+  for (auto& pending : completed) {
+    Deliver(std::move(pending));
+  }
+}
+
+void QuicThreadPoolProofSource::Deliver(
+    std::unique_ptr<PendingSignature> pending) {
+  QUIC_SERVER_HISTOGRAM_TIMES(
+      "thread_pool_proof_source_total_latency",
+      MicrosecondsSince(pending->enqueue_time), 1, 10000000, 50,
+      "Time from queuing a signature to running its callback, in "
+      "microseconds.");
+  switch (pending->outcome) {
+    case Outcome::kComputed:
+      ++stats_.signatures_computed;
+      break;
+    case Outcome::kShedQueueDelay:
+      ++stats_.shed_queue_delay;
+      break;
+    case Outcome::kPending:
+      QUIC_BUG(quic_thread_pool_proof_source_incomplete_signature)
+          << "Delivering a signature which was not computed";
+      pending->ok = false;
+      break;
+  }
+  pending->callback->Run(pending->ok, std::move(pending->signature),
+                         std::move(pending->details));
+}
+
+void QuicThreadPoolProofSource::RunWorker() {
+  while (true) {
+    uint64_t value;
+    if (read(queued_fd_, &value, sizeof(value)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      QUIC_LOG(ERROR) << "Failed to read signature queue eventfd: "
+                      << strerror(errno);
+      return;
+    }
+    std::unique_ptr<PendingSignature> pending;
+    {
+      QuicWriterMutexLock lock(&mutex_);
+      if (stopping_ || queued_.empty()) {
+        return;
+      }
+      pending = std::move(queued_.front());
+      queued_.pop_front();
+    }
+    Compute(pending.get());
+    Complete(std::move(pending));
+  }
+}
+
+void QuicThreadPoolProofSource::Compute(PendingSignature* pending) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  const int64_t queue_delay_us = MicrosecondsSince(pending->enqueue_time);
+  QUIC_SERVER_HISTOGRAM_TIMES(
+      "thread_pool_proof_source_queue_delay", queue_delay_us, 1, 10000000, 50,
+      "Time a signature waited for a thread, in microseconds.");
+  if (!options_.max_queue_delay.IsInfinite() &&
+      queue_delay_us > options_.max_queue_delay.ToMicroseconds()) {
+    pending->outcome = Outcome::kShedQueueDelay;
+    pending->ok = false;
+    return;
+  }
+  delegate_->ComputeTlsSignature(
+      pending->server_address, pending->client_address, pending->hostname,
+      pending->signature_algorithm, pending->in,
+      std::make_unique<WorkerCallback>(pending));
+  QUIC_BUG_IF(quic_thread_pool_proof_source_async_delegate,
+              pending->outcome == Outcome::kPending)
+      << "The delegate of QuicThreadPoolProofSource must compute signatures "
+         "synchronously";
+  QUIC_SERVER_HISTOGRAM_TIMES(
+      "thread_pool_proof_source_sign_time", MicrosecondsSince(start), 1,
+      10000000, 50,
+      "Time taken to compute a signature on a thread, in microseconds.");
+}
+
+void QuicThreadPoolProofSource::Complete(
+    std::unique_ptr<PendingSignature> pending) {
+  bool was_empty;
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    was_empty = completed_.empty();
+    completed_.push_back(std::move(pending));
+  }
+  // The event loop takes every completed signature at once, so it only needs
+  // waking for the first one.
+  if (was_empty) {
+    AddToEventFd(completed_fd_, 1);
+  }
+}
+
+void QuicThreadPoolProofSource::WorkerCallback::Run(
+    bool ok, std::string signature, std::unique_ptr<Details> details) {
+  pending_->outcome = Outcome::kComputed;
+  pending_->ok = ok;
+  pending_->signature = std::move(signature);
+  pending_->details = std::move(details);
+}
+
+}  // namespace quic
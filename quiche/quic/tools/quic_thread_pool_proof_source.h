@@ -0,0 +1,216 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A ProofSource which computes TLS signatures on a pool of worker threads, so
+// that private key operations do not stall the event loop which runs the
+// handshakes. During a flood of handshakes, every RSA or ECDSA signature
+// computed on the event loop delays the packets of all the connections it
+// serves.
+//
+// Signatures are queued for the workers, which compute them with the wrapped
+// ProofSource, and the results are handed back to the event loop through an
+// eventfd registered with its QuicEpollServer. The SignatureCallbacks are
+// therefore always run on the event loop thread, as TlsServerHandshaker
+// expects. A bounded queue sheds load: once it is full, or once a signature has
+// waited too long for a worker, the signature fails and so does the handshake,
+// rather than every handshake slowing down.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_THREAD_POOL_PROOF_SOURCE_H_
+#define QUICHE_QUIC_TOOLS_QUIC_THREAD_POOL_PROOF_SOURCE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/proof_source.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_epoll.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+
+namespace quic {
+
+class QUIC_NO_EXPORT QuicThreadPoolProofSource
+    : public ProofSource,
+      public QuicEpollCallbackInterface {
+ public:
+  struct QUIC_NO_EXPORT Options {
+    // Number of threads computing signatures.
+    size_t num_threads = 2;
+    // Most signatures waiting for a thread. Once reached, ComputeTlsSignature()
+    // fails right away.
+    size_t max_queue_depth = 1024;
+    // Signatures which waited longer than this for a thread fail without being
+    // computed, since their clients have likely retransmitted or given up by
+    // then. Infinite for no limit.
+    QuicTime::Delta max_queue_delay = QuicTime::Delta::Infinite();
+  };
+
+  // Counts of ComputeTlsSignature() outcomes, updated as their callbacks run.
+  struct QUIC_NO_EXPORT Stats {
+    // Signatures computed by the wrapped ProofSource, whether or not it
+    // succeeded.
+    uint64_t signatures_computed = 0;
+    // Signatures failed because the queue was full.
+    uint64_t shed_queue_full = 0;
+    // Signatures failed because they waited longer than max_queue_delay.
+    uint64_t shed_queue_delay = 0;
+  };
+
+  // Starts the worker threads. |delegate| provides the certificates and
+  // computes the signatures. Its ComputeTlsSignature() is called concurrently
+  // on the worker threads, and must run its callback before returning.
+  QuicThreadPoolProofSource(std::unique_ptr<ProofSource> delegate,
+                            const Options& options);
+  QuicThreadPoolProofSource(const QuicThreadPoolProofSource&) = delete;
+  QuicThreadPoolProofSource& operator=(const QuicThreadPoolProofSource&) =
+      delete;
+
+  // Stops the worker threads. Signatures which have not completed yet fail.
+  // Must be called on the event loop thread.
+  ~QuicThreadPoolProofSource() override;
+
+  // Completes signatures on the thread running |epoll_server|. Must be called
+  // before the first ComputeTlsSignature().
+  void RegisterWith(QuicEpollServer* epoll_server);
+
+  // Runs the callbacks of the signatures computed so far. Called on the event
+  // loop thread when the workers signal completions.
+  void DeliverCompletedSignatures();
+
+  // Returns false if the eventfds or threads could not be created, in which
+  // case ComputeTlsSignature() fails every signature.
+  bool initialized() const { return initialized_; }
+
+  const Stats& stats() const { return stats_; }
+
+  // ProofSource implementation. Everything but ComputeTlsSignature() is passed
+  // through to the delegate on the calling thread.
+  void GetProof(const QuicSocketAddress& server_address,
+                const QuicSocketAddress& client_address,
+                const std::string& hostname, const std::string& server_config,
+                QuicTransportVersion transport_version,
+                absl::string_view chlo_hash,
+                std::unique_ptr<Callback> callback) override;
+  quiche::QuicheReferenceCountedPointer<Chain> GetCertChain(
+      const QuicSocketAddress& server_address,
+      const QuicSocketAddress& client_address, const std::string& hostname,
+      bool* cert_matched_sni) override;
+  void ComputeTlsSignature(
+      const QuicSocketAddress& server_address,
+      const QuicSocketAddress& client_address, const std::string& hostname,
+      uint16_t signature_algorithm, absl::string_view in,
+      std::unique_ptr<SignatureCallback> callback) override;
+  absl::InlinedVector<uint16_t, 8> SupportedTlsSignatureAlgorithms()
+      const override;
+  TicketCrypter* GetTicketCrypter() override;
+
+  // QuicEpollCallbackInterface implementation.
+  std::string Name() const override { return "QuicThreadPoolProofSource"; }
+  void OnRegistration(QuicEpollServer* eps, int /*fd*/,
+                      int /*event_mask*/) override {
+    epoll_server_ = eps;
+  }
+  void OnModification(int /*fd*/, int /*event_mask*/) override {}
+  void OnEvent(int fd, QuicEpollEvent* event) override;
+  void OnUnregistration(int /*fd*/, bool /*replaced*/) override {
+    epoll_server_ = nullptr;
+  }
+  void OnShutdown(QuicEpollServer* /*eps*/, int /*fd*/) override {
+    epoll_server_ = nullptr;
+  }
+
+ private:
+  // How a signature handed to the workers ended.
+  enum class Outcome {
+    kPending,
+    kComputed,
+    kShedQueueDelay,
+  };
+
+  struct QUIC_NO_EXPORT PendingSignature {
+    QuicSocketAddress server_address;
+    QuicSocketAddress client_address;
+    std::string hostname;
+    uint16_t signature_algorithm = 0;
+    std::string in;
+    std::unique_ptr<SignatureCallback> callback;
+    // Read from a monotonic clock, which unlike QuicEpollClock can be read on
+    // the worker threads, and unlike the wall clock does not step.
+    std::chrono::steady_clock::time_point enqueue_time;
+
+    // Filled in on the worker thread.
+    Outcome outcome = Outcome::kPending;
+    bool ok = false;
+    std::string signature;
+    std::unique_ptr<Details> details;
+  };
+
+  // Receives the result of the delegate's ComputeTlsSignature().
+  class QUIC_NO_EXPORT WorkerCallback : public SignatureCallback {
+   public:
+    explicit WorkerCallback(PendingSignature* pending) : pending_(pending) {}
+
+    void Run(bool ok, std::string signature,
+             std::unique_ptr<Details> details) override;
+
+   private:
+    PendingSignature* pending_;  // Unowned.
+  };
+
+  class QUIC_NO_EXPORT WorkerThread : public QuicThread {
+   public:
+    explicit WorkerThread(QuicThreadPoolProofSource* source)
+        : QuicThread("QuicThreadPoolProofSource"), source_(source) {}
+
+    void Run() override { source_->RunWorker(); }
+
+   private:
+    QuicThreadPoolProofSource* source_;  // Unowned.
+  };
+
+  // Computes queued signatures until the source is destroyed.
+  void RunWorker();
+
+  // Computes |pending| on the calling worker thread.
+  void Compute(PendingSignature* pending);
+
+  // Hands |pending| back to the event loop.
+  void Complete(std::unique_ptr<PendingSignature> pending);
+
+  // Runs the callback of |pending| with its result.
+  void Deliver(std::unique_ptr<PendingSignature> pending);
+
+  const std::unique_ptr<ProofSource> delegate_;
+  const Options options_;
+
+  // eventfd used as a semaphore counting the signatures queued for the
+  // workers, plus one per worker once they are asked to stop.
+  int queued_fd_;
+  // eventfd which becomes readable when signatures have completed.
+  int completed_fd_;
+  bool initialized_;
+
+  QuicMutex mutex_;
+  std::deque<std::unique_ptr<PendingSignature>> queued_
+      QUIC_GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<PendingSignature>> completed_
+      QUIC_GUARDED_BY(mutex_);
+  bool stopping_ QUIC_GUARDED_BY(mutex_);
+
+  std::vector<std::unique_ptr<WorkerThread>> threads_;
+  QuicEpollServer* epoll_server_;  // Unowned.
+  Stats stats_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_THREAD_POOL_PROOF_SOURCE_H_
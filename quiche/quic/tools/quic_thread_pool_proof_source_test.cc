@@ -0,0 +1,218 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_thread_pool_proof_source.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quiche/quic/platform/api/quic_epoll.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+// Signs by prefixing its input, optionally waiting for Release() first.
+class BlockingProofSource : public ProofSource {
+ public:
+  explicit BlockingProofSource(bool block) {
+    if (!block) {
+      release_.Notify();
+    }
+  }
+
+  void GetProof(const QuicSocketAddress& /*server_address*/,
+                const QuicSocketAddress& /*client_address*/,
+                const std::string& /*hostname*/,
+                const std::string& /*server_config*/,
+                QuicTransportVersion /*transport_version*/,
+                absl::string_view /*chlo_hash*/,
+                std::unique_ptr<Callback> /*callback*/) override {}
+
+  quiche::QuicheReferenceCountedPointer<Chain> GetCertChain(
+      const QuicSocketAddress& /*server_address*/,
+      const QuicSocketAddress& /*client_address*/,
+      const std::string& /*hostname*/, bool* /*cert_matched_sni*/) override {
+    return quiche::QuicheReferenceCountedPointer<Chain>();
+  }
+
+  void ComputeTlsSignature(
+      const QuicSocketAddress& /*server_address*/,
+      const QuicSocketAddress& /*client_address*/,
+      const std::string& /*hostname*/, uint16_t /*signature_algorithm*/,
+      absl::string_view in,
+      std::unique_ptr<SignatureCallback> callback) override {
+    if (!started_.HasBeenNotified()) {
+      started_.Notify();
+    }
+    release_.WaitForNotification();
+    callback->Run(/*ok=*/true, absl::StrCat("signature:", in), nullptr);
+  }
+
+  absl::InlinedVector<uint16_t, 8> SupportedTlsSignatureAlgorithms()
+      const override {
+    return {};
+  }
+
+  TicketCrypter* GetTicketCrypter() override { return nullptr; }
+
+  // Waits until a worker started computing the first signature.
+  void WaitForStart() { started_.WaitForNotification(); }
+
+  void Release() { release_.Notify(); }
+
+ private:
+  QuicNotification started_;
+  QuicNotification release_;
+};
+
+struct SignatureResult {
+  bool done = false;
+  bool ok = false;
+  std::string signature;
+};
+
+class RecordingSignatureCallback : public ProofSource::SignatureCallback {
+ public:
+  explicit RecordingSignatureCallback(SignatureResult* result)
+      : result_(result) {}
+
+  void Run(bool ok, std::string signature,
+           std::unique_ptr<ProofSource::Details> /*details*/) override {
+    result_->done = true;
+    result_->ok = ok;
+    result_->signature = std::move(signature);
+  }
+
+ private:
+  SignatureResult* result_;
+};
+
+class QuicThreadPoolProofSourceTest : public QuicTest {
+ protected:
+  QuicThreadPoolProofSourceTest() {
+    epoll_server_.set_timeout_in_us(10 * 1000);
+  }
+
+  void CreateProofSource(bool block,
+                         const QuicThreadPoolProofSource::Options& options) {
+    auto delegate = std::make_unique<BlockingProofSource>(block);
+    delegate_ = delegate.get();
+    proof_source_ = std::make_unique<QuicThreadPoolProofSource>(
+        std::move(delegate), options);
+    ASSERT_TRUE(proof_source_->initialized());
+    proof_source_->RegisterWith(&epoll_server_);
+  }
+
+  void Sign(absl::string_view in, SignatureResult* result) {
+    proof_source_->ComputeTlsSignature(
+        QuicSocketAddress(), QuicSocketAddress(), "example.org",
+        /*signature_algorithm=*/0, in,
+        std::make_unique<RecordingSignatureCallback>(result));
+  }
+
+  void RunUntilDone(const SignatureResult& result) {
+    const absl::Time deadline = absl::Now() + absl::Seconds(10);
+    while (!result.done && absl::Now() < deadline) {
+      epoll_server_.WaitForEventsAndExecuteCallbacks();
+    }
+  }
+
+  QuicEpollServer epoll_server_;
+  BlockingProofSource* delegate_ = nullptr;
+  std::unique_ptr<QuicThreadPoolProofSource> proof_source_;
+};
+
+TEST_F(QuicThreadPoolProofSourceTest, ComputesSignatureOnThreadPool) {
+  CreateProofSource(/*block=*/true, QuicThreadPoolProofSource::Options());
+
+  SignatureResult result;
+  Sign("hello", &result);
+  // The callback runs on the event loop once a worker computed the signature.
+  EXPECT_FALSE(result.done);
+  delegate_->Release();
+  RunUntilDone(result);
+
+  EXPECT_TRUE(result.done);
+  EXPECT_TRUE(result.ok);
+  EXPECT_EQ("signature:hello", result.signature);
+  EXPECT_EQ(1u, proof_source_->stats().signatures_computed);
+}
+
+TEST_F(QuicThreadPoolProofSourceTest, ShedsWhenQueueFull) {
+  QuicThreadPoolProofSource::Options options;
+  options.num_threads = 1;
+  options.max_queue_depth = 1;
+  CreateProofSource(/*block=*/true, options);
+
+  SignatureResult computing;
+  Sign("computing", &computing);
+  delegate_->WaitForStart();
+  SignatureResult queued;
+  Sign("queued", &queued);
+  SignatureResult shed;
+  Sign("shed", &shed);
+  EXPECT_TRUE(shed.done);
+  EXPECT_FALSE(shed.ok);
+  EXPECT_EQ(1u, proof_source_->stats().shed_queue_full);
+
+  delegate_->Release();
+  RunUntilDone(computing);
+  RunUntilDone(queued);
+  EXPECT_TRUE(computing.ok);
+  EXPECT_TRUE(queued.ok);
+  EXPECT_EQ("signature:queued", queued.signature);
+  EXPECT_EQ(2u, proof_source_->stats().signatures_computed);
+}
+
+TEST_F(QuicThreadPoolProofSourceTest, ShedsAfterMaxQueueDelay) {
+  QuicThreadPoolProofSource::Options options;
+  options.num_threads = 1;
+  options.max_queue_delay = QuicTime::Delta::FromMilliseconds(1);
+  CreateProofSource(/*block=*/true, options);
+
+  SignatureResult computing;
+  Sign("computing", &computing);
+  delegate_->WaitForStart();
+  SignatureResult delayed;
+  Sign("delayed", &delayed);
+  absl::SleepFor(absl::Milliseconds(20));
+  delegate_->Release();
+  RunUntilDone(computing);
+  RunUntilDone(delayed);
+
+  EXPECT_TRUE(computing.ok);
+  EXPECT_TRUE(delayed.done);
+  EXPECT_FALSE(delayed.ok);
+  EXPECT_EQ(1u, proof_source_->stats().signatures_computed);
+  EXPECT_EQ(1u, proof_source_->stats().shed_queue_delay);
+}
+
+TEST_F(QuicThreadPoolProofSourceTest,
+       DeliversCompletedSignaturesOnDestruction) {
+  CreateProofSource(/*block=*/true, QuicThreadPoolProofSource::Options());
+
+  SignatureResult result;
+  Sign("hello", &result);
+  delegate_->WaitForStart();
+  delegate_->Release();
+  EXPECT_FALSE(result.done);
+  // Destruction waits for the signature being computed, then runs its callback
+  // without going through the event loop.
+  proof_source_.reset();
+  EXPECT_TRUE(result.done);
+  EXPECT_TRUE(result.ok);
+  EXPECT_EQ("signature:hello", result.signature);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,100 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures HpackEncoder and HpackDecoderAdapter on a typical browser request
+// header block.
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "quiche/spdy/core/hpack/hpack_decoder_adapter.h"
+#include "quiche/spdy/core/hpack/hpack_encoder.h"
+#include "quiche/spdy/core/no_op_headers_handler.h"
+#include "quiche/spdy/core/spdy_header_block.h"
+
+namespace spdy {
+namespace {
+
+Http2HeaderBlock RequestHeaders() {
+  Http2HeaderBlock headers;
+  headers[":method"] = "GET";
+  headers[":scheme"] = "https";
+  headers[":authority"] = "www.example.com";
+  headers[":path"] = "/static/js/main.4f1c2a9b.chunk.js";
+  headers["user-agent"] =
+      "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+      "Chrome/104.0.0.0 Safari/537.36";
+  headers["accept"] = "*/*";
+  headers["accept-encoding"] = "gzip, deflate, br";
+  headers["accept-language"] = "en-US,en;q=0.9";
+  headers["referer"] = "https://www.example.com/";
+  headers["cookie"] = "session=0123456789abcdef0123456789abcdef; theme=dark";
+  return headers;
+}
+
+// Every block after the first on a connection mostly hits the dynamic table.
+void BM_HpackEncode(benchmark::State& state) {
+  const Http2HeaderBlock headers = RequestHeaders();
+  HpackEncoder encoder;
+  size_t encoded_bytes = 0;
+  for (auto _ : state) {
+    const std::string encoded = encoder.EncodeHeaderBlock(headers);
+    encoded_bytes += encoded.size();
+  }
+  state.SetBytesProcessed(encoded_bytes);
+}
+BENCHMARK(BM_HpackEncode);
+
+// Decodes the first block on a connection, i.e. literals with Huffman coding
+// being inserted into the dynamic table. This includes creating the decoder.
+void BM_HpackDecodeFirstBlock(benchmark::State& state) {
+  HpackEncoder encoder;
+  const std::string encoded = encoder.EncodeHeaderBlock(RequestHeaders());
+  NoOpHeadersHandler handler(/*listener=*/nullptr);
+  for (auto _ : state) {
+    HpackDecoderAdapter decoder;
+    decoder.HandleControlFrameHeadersStart(&handler);
+    if (!decoder.HandleControlFrameHeadersData(encoded.data(),
+                                               encoded.size()) ||
+        !decoder.HandleControlFrameHeadersComplete()) {
+      state.SkipWithError("Failed to decode header block");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_HpackDecodeFirstBlock);
+
+// Decodes blocks made of references to the dynamic table, as for all requests
+// after the first on a connection.
+void BM_HpackDecodeIndexedBlock(benchmark::State& state) {
+  const Http2HeaderBlock headers = RequestHeaders();
+  HpackEncoder encoder;
+  HpackDecoderAdapter decoder;
+  NoOpHeadersHandler handler(/*listener=*/nullptr);
+  const std::string first = encoder.EncodeHeaderBlock(headers);
+  decoder.HandleControlFrameHeadersStart(&handler);
+  if (!decoder.HandleControlFrameHeadersData(first.data(), first.size()) ||
+      !decoder.HandleControlFrameHeadersComplete()) {
+    state.SkipWithError("Failed to decode header block");
+    return;
+  }
+  const std::string encoded = encoder.EncodeHeaderBlock(headers);
+  for (auto _ : state) {
+    decoder.HandleControlFrameHeadersStart(&handler);
+    if (!decoder.HandleControlFrameHeadersData(encoded.data(),
+                                               encoded.size()) ||
+        !decoder.HandleControlFrameHeadersComplete()) {
+      state.SkipWithError("Failed to decode header block");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_HpackDecodeIndexedBlock);
+
+}  // namespace
+}  // namespace spdy
+
+BENCHMARK_MAIN();
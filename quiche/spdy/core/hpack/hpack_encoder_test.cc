@@ -7,9 +7,11 @@
 #include <cstdint>
 #include <utility>
 
+#include "absl/types/optional.h"
 #include "quiche/http2/hpack/huffman/hpack_huffman_encoder.h"
 #include "quiche/http2/test_tools/http2_random.h"
 #include "quiche/common/platform/api/quiche_test.h"
+#include "quiche/common/quiche_dynamic_header_table.h"
 #include "quiche/spdy/core/hpack/hpack_static_table.h"
 #include "quiche/spdy/core/spdy_simple_arena.h"
 
@@ -25,8 +27,8 @@ class HpackHeaderTablePeer {
     return &table_->static_entries_.front();
   }
 
-  HpackHeaderTable::DynamicEntryTable* dynamic_entries() {
-    return &table_->dynamic_entries_;
+  const HpackHeaderTable::DynamicEntryTable& dynamic_entries() const {
+    return table_->dynamic_entries_;
   }
 
  private:
@@ -154,6 +156,14 @@ class HpackEncoderTest
     // No further insertions may occur without evictions.
     peer_.table()->SetMaxSize(peer_.table()->size());
     QUICHE_CHECK_EQ(kInitialDynamicTableSize, peer_.table()->size());
+
+    // Later insertions may have moved earlier entries, so look them up again.
+    const HpackHeaderTable::DynamicEntryTable& dynamic_entries =
+        peer_.table_peer().dynamic_entries();
+    key_1_ = dynamic_entries.Get(key_1_index_);
+    key_2_ = dynamic_entries.Get(key_2_index_);
+    cookie_a_ = dynamic_entries.Get(cookie_a_index_);
+    cookie_c_ = dynamic_entries.Get(cookie_c_index_);
   }
 
   void SaveHeaders(absl::string_view name, absl::string_view value) {
@@ -257,10 +267,10 @@ class HpackEncoderTest
   const size_t kInitialDynamicTableSize = 4 * (10 + 32);
 
   const HpackEntry* static_;
-  const HpackEntry* key_1_;
-  const HpackEntry* key_2_;
-  const HpackEntry* cookie_a_;
-  const HpackEntry* cookie_c_;
+  absl::optional<quiche::QuicheHeaderTableEntry> key_1_;
+  absl::optional<quiche::QuicheHeaderTableEntry> key_2_;
+  absl::optional<quiche::QuicheHeaderTableEntry> cookie_a_;
+  absl::optional<quiche::QuicheHeaderTableEntry> cookie_c_;
   size_t key_1_index_;
   size_t key_2_index_;
   size_t cookie_a_index_;
@@ -371,7 +381,7 @@ TEST_P(HpackEncoderTest, SingleStaticIndexTooLarge) {
   headers[static_->name()] = static_->value();
   CompareWithExpectedEncoding(headers);
 
-  EXPECT_EQ(0u, peer_.table_peer().dynamic_entries()->size());
+  EXPECT_EQ(0u, peer_.table_peer().dynamic_entries().size());
 }
 
 TEST_P(HpackEncoderTest, SingleLiteralWithIndexName) {
@@ -382,9 +392,10 @@ TEST_P(HpackEncoderTest, SingleLiteralWithIndexName) {
   CompareWithExpectedEncoding(headers);
 
   // A new entry was inserted and added to the reference set.
-  HpackEntry* new_entry = peer_.table_peer().dynamic_entries()->front().get();
-  EXPECT_EQ(new_entry->name(), key_2_->name());
-  EXPECT_EQ(new_entry->value(), "value3");
+  const quiche::QuicheHeaderTableEntry new_entry =
+      peer_.table_peer().dynamic_entries().newest();
+  EXPECT_EQ(new_entry.name(), key_2_->name());
+  EXPECT_EQ(new_entry.value(), "value3");
 }
 
 TEST_P(HpackEncoderTest, SingleLiteralWithLiteralName) {
@@ -394,9 +405,10 @@ TEST_P(HpackEncoderTest, SingleLiteralWithLiteralName) {
   headers["key3"] = "value3";
   CompareWithExpectedEncoding(headers);
 
-  HpackEntry* new_entry = peer_.table_peer().dynamic_entries()->front().get();
-  EXPECT_EQ(new_entry->name(), "key3");
-  EXPECT_EQ(new_entry->value(), "value3");
+  const quiche::QuicheHeaderTableEntry new_entry =
+      peer_.table_peer().dynamic_entries().newest();
+  EXPECT_EQ(new_entry.name(), "key3");
+  EXPECT_EQ(new_entry.value(), "value3");
 }
 
 TEST_P(HpackEncoderTest, SingleLiteralTooLarge) {
@@ -410,7 +422,7 @@ TEST_P(HpackEncoderTest, SingleLiteralTooLarge) {
   headers["key3"] = "value3";
   CompareWithExpectedEncoding(headers);
 
-  EXPECT_EQ(0u, peer_.table_peer().dynamic_entries()->size());
+  EXPECT_EQ(0u, peer_.table_peer().dynamic_entries().size());
 }
 
 TEST_P(HpackEncoderTest, EmitThanEvict) {
@@ -694,9 +706,10 @@ TEST_P(HpackEncoderTest, HeaderTableSizeUpdate) {
   headers["key3"] = "value3";
   CompareWithExpectedEncoding(headers);
 
-  HpackEntry* new_entry = peer_.table_peer().dynamic_entries()->front().get();
-  EXPECT_EQ(new_entry->name(), "key3");
-  EXPECT_EQ(new_entry->value(), "value3");
+  const quiche::QuicheHeaderTableEntry new_entry =
+      peer_.table_peer().dynamic_entries().newest();
+  EXPECT_EQ(new_entry.name(), "key3");
+  EXPECT_EQ(new_entry.value(), "value3");
 }
 
 TEST_P(HpackEncoderTest, HeaderTableSizeUpdateWithMin) {
@@ -713,9 +726,10 @@ TEST_P(HpackEncoderTest, HeaderTableSizeUpdateWithMin) {
   headers["key3"] = "value3";
   CompareWithExpectedEncoding(headers);
 
-  HpackEntry* new_entry = peer_.table_peer().dynamic_entries()->front().get();
-  EXPECT_EQ(new_entry->name(), "key3");
-  EXPECT_EQ(new_entry->value(), "value3");
+  const quiche::QuicheHeaderTableEntry new_entry =
+      peer_.table_peer().dynamic_entries().newest();
+  EXPECT_EQ(new_entry.name(), "key3");
+  EXPECT_EQ(new_entry.value(), "value3");
 }
 
 TEST_P(HpackEncoderTest, HeaderTableSizeUpdateWithExistingSize) {
@@ -727,9 +741,10 @@ TEST_P(HpackEncoderTest, HeaderTableSizeUpdateWithExistingSize) {
   headers["key3"] = "value3";
   CompareWithExpectedEncoding(headers);
 
-  HpackEntry* new_entry = peer_.table_peer().dynamic_entries()->front().get();
-  EXPECT_EQ(new_entry->name(), "key3");
-  EXPECT_EQ(new_entry->value(), "value3");
+  const quiche::QuicheHeaderTableEntry new_entry =
+      peer_.table_peer().dynamic_entries().newest();
+  EXPECT_EQ(new_entry.name(), "key3");
+  EXPECT_EQ(new_entry.value(), "value3");
 }
 
 TEST_P(HpackEncoderTest, HeaderTableSizeUpdatesWithGreaterSize) {
@@ -744,9 +759,10 @@ TEST_P(HpackEncoderTest, HeaderTableSizeUpdatesWithGreaterSize) {
   headers["key3"] = "value3";
   CompareWithExpectedEncoding(headers);
 
-  HpackEntry* new_entry = peer_.table_peer().dynamic_entries()->front().get();
-  EXPECT_EQ(new_entry->name(), "key3");
-  EXPECT_EQ(new_entry->value(), "value3");
+  const quiche::QuicheHeaderTableEntry new_entry =
+      peer_.table_peer().dynamic_entries().newest();
+  EXPECT_EQ(new_entry.name(), "key3");
+  EXPECT_EQ(new_entry.value(), "value3");
 }
 
 }  // namespace
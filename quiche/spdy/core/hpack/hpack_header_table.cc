@@ -12,14 +12,18 @@
 
 namespace spdy {
 
+static_assert(kHpackEntrySizeOverhead ==
+                  quiche::kQuicheHeaderTableEntrySizeOverhead,
+              "HPACK entries are stored in a QuicheDynamicHeaderTable.");
+
 HpackHeaderTable::HpackHeaderTable()
     : static_entries_(ObtainHpackStaticTable().GetStaticEntries()),
       static_index_(ObtainHpackStaticTable().GetStaticIndex()),
       static_name_index_(ObtainHpackStaticTable().GetStaticNameIndex()),
       settings_size_bound_(kDefaultHeaderTableSizeSetting),
-      size_(0),
-      max_size_(kDefaultHeaderTableSizeSetting),
-      dynamic_table_insertions_(0) {}
+      max_size_(kDefaultHeaderTableSizeSetting) {
+  dynamic_entries_.SetCapacity(max_size_);
+}
 
 HpackHeaderTable::~HpackHeaderTable() = default;
 
@@ -31,9 +35,10 @@ size_t HpackHeaderTable::GetByName(absl::string_view name) {
     }
   }
   {
-    NameToEntryMap::const_iterator it = dynamic_name_index_.find(name);
-    if (it != dynamic_name_index_.end()) {
-      return dynamic_table_insertions_ - it->second + kStaticTableSize;
+    absl::optional<uint64_t> index = dynamic_entries_.FindName(name);
+    if (index.has_value()) {
+      return dynamic_entries_.inserted_entry_count() - *index +
+             kStaticTableSize;
     }
   }
   return kHpackEntryNotFound;
@@ -49,9 +54,11 @@ size_t HpackHeaderTable::GetByNameAndValue(absl::string_view name,
     }
   }
   {
-    auto it = dynamic_index_.find(query);
-    if (it != dynamic_index_.end()) {
-      return dynamic_table_insertions_ - it->second + kStaticTableSize;
+    absl::optional<uint64_t> index =
+        dynamic_entries_.FindNameAndValue(name, value);
+    if (index.has_value()) {
+      return dynamic_entries_.inserted_entry_count() - *index +
+             kStaticTableSize;
     }
   }
   return kHpackEntryNotFound;
@@ -61,10 +68,11 @@ void HpackHeaderTable::SetMaxSize(size_t max_size) {
   QUICHE_CHECK_LE(max_size, settings_size_bound_);
 
   max_size_ = max_size;
-  if (size_ > max_size_) {
-    Evict(EvictionCountToReclaim(size_ - max_size_));
-    QUICHE_CHECK_LE(size_, max_size_);
+  if (size() > max_size_) {
+    Evict(EvictionCountToReclaim(size() - max_size_));
+    QUICHE_CHECK_LE(size(), max_size_);
   }
+  dynamic_entries_.SetCapacity(max_size_);
 }
 
 void HpackHeaderTable::SetSettingsHeaderTableSize(size_t settings_size) {
@@ -72,18 +80,9 @@ void HpackHeaderTable::SetSettingsHeaderTableSize(size_t settings_size) {
   SetMaxSize(settings_size_bound_);
 }
 
-void HpackHeaderTable::EvictionSet(absl::string_view name,
-                                   absl::string_view value,
-                                   DynamicEntryTable::iterator* begin_out,
-                                   DynamicEntryTable::iterator* end_out) {
-  size_t eviction_count = EvictionCountForEntry(name, value);
-  *begin_out = dynamic_entries_.end() - eviction_count;
-  *end_out = dynamic_entries_.end();
-}
-
 size_t HpackHeaderTable::EvictionCountForEntry(absl::string_view name,
                                                absl::string_view value) const {
-  size_t available_size = max_size_ - size_;
+  size_t available_size = max_size_ - size();
   size_t entry_size = HpackEntry::Size(name, value);
 
   if (entry_size <= available_size) {
@@ -95,9 +94,10 @@ size_t HpackHeaderTable::EvictionCountForEntry(absl::string_view name,
 
 size_t HpackHeaderTable::EvictionCountToReclaim(size_t reclaim_size) const {
   size_t count = 0;
-  for (auto it = dynamic_entries_.rbegin();
-       it != dynamic_entries_.rend() && reclaim_size != 0; ++it, ++count) {
-    reclaim_size -= std::min(reclaim_size, (*it)->Size());
+  for (uint64_t index = dynamic_entries_.evicted_entry_count();
+       index != dynamic_entries_.inserted_entry_count() && reclaim_size != 0;
+       ++index, ++count) {
+    reclaim_size -= std::min(reclaim_size, dynamic_entries_.Get(index).Size());
   }
   return count;
 }
@@ -105,84 +105,27 @@ size_t HpackHeaderTable::EvictionCountToReclaim(size_t reclaim_size) const {
 void HpackHeaderTable::Evict(size_t count) {
   for (size_t i = 0; i != count; ++i) {
     QUICHE_CHECK(!dynamic_entries_.empty());
-
-    HpackEntry* entry = dynamic_entries_.back().get();
-    const size_t index = dynamic_table_insertions_ - dynamic_entries_.size();
-
-    size_ -= entry->Size();
-    auto it = dynamic_index_.find({entry->name(), entry->value()});
-    QUICHE_DCHECK(it != dynamic_index_.end());
-    // Only remove an entry from the index if its insertion index matches;
-    // otherwise, the index refers to another entry with the same name and
-    // value.
-    if (it->second == index) {
-      dynamic_index_.erase(it);
-    }
-    auto name_it = dynamic_name_index_.find(entry->name());
-    QUICHE_DCHECK(name_it != dynamic_name_index_.end());
-    // Only remove an entry from the literal index if its insertion index
-    /// matches; otherwise, the index refers to another entry with the same
-    // name.
-    if (name_it->second == index) {
-      dynamic_name_index_.erase(name_it);
-    }
-    dynamic_entries_.pop_back();
+    dynamic_entries_.EvictOldest();
   }
 }
 
-const HpackEntry* HpackHeaderTable::TryAddEntry(absl::string_view name,
-                                                absl::string_view value) {
-  // Since |dynamic_entries_| has iterator stability, |name| and |value| are
-  // valid even after evicting other entries and push_front() making room for
-  // the new one.
+absl::optional<quiche::QuicheHeaderTableEntry> HpackHeaderTable::TryAddEntry(
+    absl::string_view name, absl::string_view value) {
+  // The bytes of evicted entries are left in place until the new entry is
+  // copied, so |name| and |value| may point to them.
   Evict(EvictionCountForEntry(name, value));
 
   size_t entry_size = HpackEntry::Size(name, value);
-  if (entry_size > (max_size_ - size_)) {
+  if (entry_size > (max_size_ - size())) {
     // Entire table has been emptied, but there's still insufficient room.
     QUICHE_DCHECK(dynamic_entries_.empty());
-    QUICHE_DCHECK_EQ(0u, size_);
-    return nullptr;
-  }
-
-  const size_t index = dynamic_table_insertions_;
-  dynamic_entries_.push_front(
-      std::make_unique<HpackEntry>(std::string(name), std::string(value)));
-  HpackEntry* new_entry = dynamic_entries_.front().get();
-  auto index_result = dynamic_index_.insert(std::make_pair(
-      HpackLookupEntry{new_entry->name(), new_entry->value()}, index));
-  if (!index_result.second) {
-    // An entry with the same name and value already exists in the dynamic
-    // index. We should replace it with the newly added entry.
-    QUICHE_DVLOG(1) << "Found existing entry at: " << index_result.first->second
-                    << " replacing with: " << new_entry->GetDebugString()
-                    << " at: " << index;
-    QUICHE_DCHECK_GT(index, index_result.first->second);
-    dynamic_index_.erase(index_result.first);
-    auto insert_result = dynamic_index_.insert(std::make_pair(
-        HpackLookupEntry{new_entry->name(), new_entry->value()}, index));
-    QUICHE_CHECK(insert_result.second);
+    QUICHE_DCHECK_EQ(0u, size());
+    return absl::nullopt;
   }
 
-  auto name_result =
-      dynamic_name_index_.insert(std::make_pair(new_entry->name(), index));
-  if (!name_result.second) {
-    // An entry with the same name already exists in the dynamic index. We
-    // should replace it with the newly added entry.
-    QUICHE_DVLOG(1) << "Found existing entry at: " << name_result.first->second
-                    << " replacing with: " << new_entry->GetDebugString()
-                    << " at: " << index;
-    QUICHE_DCHECK_GT(index, name_result.first->second);
-    dynamic_name_index_.erase(name_result.first);
-    auto insert_result =
-        dynamic_name_index_.insert(std::make_pair(new_entry->name(), index));
-    QUICHE_CHECK(insert_result.second);
-  }
-
-  size_ += entry_size;
-  ++dynamic_table_insertions_;
-
-  return dynamic_entries_.front().get();
+  // |dynamic_entries_| replaces any older entry with the same name, or name
+  // and value, in its indexes.
+  return dynamic_entries_.Get(dynamic_entries_.Insert(name, value));
 }
 
 }  // namespace spdy
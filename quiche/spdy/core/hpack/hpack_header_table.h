@@ -7,16 +7,15 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <deque>
-#include <memory>
+#include <vector>
 
 #include "absl/base/attributes.h"
 #include "absl/container/flat_hash_map.h"
-#include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "quiche/common/platform/api/quiche_export.h"
-#include "quiche/common/quiche_circular_deque.h"
+#include "quiche/common/quiche_dynamic_header_table.h"
 #include "quiche/spdy/core/hpack/hpack_entry.h"
 
 // All section references below are to http://tools.ietf.org/html/rfc7541.
@@ -41,10 +40,9 @@ class QUICHE_EXPORT_PRIVATE HpackHeaderTable {
   // is initialized once and never changed after.
   using StaticEntryTable = std::vector<HpackEntry>;
 
-  // HpackHeaderTable takes advantage of the deque property that references
-  // remain valid, so long as insertions & deletions are at the head & tail.
-  using DynamicEntryTable =
-      quiche::QuicheCircularDeque<std::unique_ptr<HpackEntry>>;
+  // Names and values of dynamic entries are stored in a single arena, and
+  // remain valid until the entry is evicted or the table grows.
+  using DynamicEntryTable = quiche::QuicheDynamicHeaderTable;
 
   using NameValueToEntryMap = absl::flat_hash_map<HpackLookupEntry, size_t>;
   using NameToEntryMap = absl::flat_hash_map<absl::string_view, size_t>;
@@ -60,7 +58,7 @@ class QUICHE_EXPORT_PRIVATE HpackHeaderTable {
 
   // Current and maximum estimated byte size of the table, as described in
   // 4.1. Notably, this is /not/ the number of entries in the table.
-  size_t size() const { return size_; }
+  size_t size() const { return dynamic_entries_.entries_size(); }
   size_t max_size() const { return max_size_; }
 
   // The HPACK indexing scheme used by GetByName() and GetByNameAndValue() is
@@ -82,23 +80,19 @@ class QUICHE_EXPORT_PRIVATE HpackHeaderTable {
   // SetMaxSize() as needed to preserve max_size() <= settings_size_bound().
   void SetSettingsHeaderTableSize(size_t settings_size);
 
-  // Determine the set of entries which would be evicted by the insertion
-  // of |name| & |value| into the table, as per section 4.4. No eviction
-  // actually occurs. The set is returned via range [begin_out, end_out).
-  void EvictionSet(absl::string_view name, absl::string_view value,
-                   DynamicEntryTable::iterator* begin_out,
-                   DynamicEntryTable::iterator* end_out);
-
   // Adds an entry for the representation, evicting entries as needed. |name|
-  // and |value| must not point to an entry in |dynamic_entries_| which is about
-  // to be evicted, but they may point to an entry which is not.
-  // The added HpackEntry is returned, or NULL is returned if all entries were
+  // and |value| may point to any entry in |dynamic_entries_|, including one
+  // which is about to be evicted.
+  // The added entry is returned, or nullopt is returned if all entries were
   // evicted and the empty table is of insufficent size for the representation.
-  const HpackEntry* TryAddEntry(absl::string_view name,
-                                absl::string_view value);
+  // The returned name and value are valid until the entry is evicted or a
+  // later insertion grows the underlying arena.
+  absl::optional<quiche::QuicheHeaderTableEntry> TryAddEntry(
+      absl::string_view name, absl::string_view value);
 
  private:
-  // Returns number of evictions required to enter |name| & |value|.
+  // Returns number of evictions required to enter |name| & |value|, as per
+  // section 4.4.
   size_t EvictionCountForEntry(absl::string_view name,
                                absl::string_view value) const;
 
@@ -113,6 +107,10 @@ class QUICHE_EXPORT_PRIVATE HpackHeaderTable {
 
   // Stores HpackEntries.
   const StaticEntryTable& static_entries_;
+
+  // Stores dynamic entries, and tracks the index of the most recently inserted
+  // one for a given header name, and for a given header name and value.
+  // Indices count insertions, including those of evicted entries.
   DynamicEntryTable dynamic_entries_;
 
   // Tracks the index of the unique HpackEntry for a given header name and
@@ -125,27 +123,12 @@ class QUICHE_EXPORT_PRIVATE HpackHeaderTable {
   // |static_entries_|.
   const NameToEntryMap& static_name_index_;
 
-  // Tracks the index of the most recently inserted HpackEntry for a given
-  // header name and value.  Keys consist of string_views that point to strings
-  // stored in |dynamic_entries_|.
-  NameValueToEntryMap dynamic_index_;
-
-  // Tracks the index of the most recently inserted HpackEntry for a given
-  // header name.  Each key is a string_view that points to a name string stored
-  // in |dynamic_entries_|.
-  NameToEntryMap dynamic_name_index_;
-
   // Last acknowledged value for SETTINGS_HEADER_TABLE_SIZE.
   size_t settings_size_bound_;
 
-  // Estimated current and maximum byte size of the table.
+  // Estimated maximum byte size of the table.
   // |max_size_| <= |settings_size_bound_|
-  size_t size_;
   size_t max_size_;
-
-  // Total number of dynamic table insertions so far
-  // (including entries that have been evicted).
-  size_t dynamic_table_insertions_;
 };
 
 }  // namespace spdy
@@ -10,7 +10,9 @@
 #include <string>
 #include <vector>
 
+#include "absl/types/optional.h"
 #include "quiche/common/platform/api/quiche_test.h"
+#include "quiche/common/quiche_dynamic_header_table.h"
 #include "quiche/spdy/core/hpack/hpack_constants.h"
 #include "quiche/spdy/core/hpack/hpack_entry.h"
 #include "quiche/spdy/core/hpack/hpack_static_table.h"
@@ -37,18 +39,8 @@ class HpackHeaderTablePeer {
   const HpackEntry* GetLastStaticEntry() {
     return &table_->static_entries_.back();
   }
-  std::vector<HpackEntry*> EvictionSet(absl::string_view name,
-                                       absl::string_view value) {
-    HpackHeaderTable::DynamicEntryTable::iterator begin, end;
-    table_->EvictionSet(name, value, &begin, &end);
-    std::vector<HpackEntry*> result;
-    for (; begin != end; ++begin) {
-      result.push_back(begin->get());
-    }
-    return result;
-  }
   size_t dynamic_table_insertions() {
-    return table_->dynamic_table_insertions_;
+    return table_->dynamic_entries_.inserted_entry_count();
   }
   size_t EvictionCountForEntry(absl::string_view name,
                                absl::string_view value) {
@@ -103,13 +95,9 @@ class HpackHeaderTableTest : public quiche::test::QuicheTest {
   // expecting no eviction to happen.
   void AddEntriesExpectNoEviction(const HpackEntryVector& entries) {
     for (auto it = entries.begin(); it != entries.end(); ++it) {
-      HpackHeaderTable::DynamicEntryTable::iterator begin, end;
-
-      table_.EvictionSet(it->name(), it->value(), &begin, &end);
-      EXPECT_EQ(0, distance(begin, end));
+      EXPECT_EQ(0u, peer_.EvictionCountForEntry(it->name(), it->value()));
 
-      const HpackEntry* entry = table_.TryAddEntry(it->name(), it->value());
-      EXPECT_NE(entry, static_cast<HpackEntry*>(nullptr));
+      EXPECT_TRUE(table_.TryAddEntry(it->name(), it->value()).has_value());
     }
   }
 
@@ -143,7 +131,9 @@ TEST_F(HpackHeaderTableTest, BasicDynamicEntryInsertionAndEviction) {
   const HpackEntry* first_static_entry = peer_.GetFirstStaticEntry();
   const HpackEntry* last_static_entry = peer_.GetLastStaticEntry();
 
-  const HpackEntry* entry = table_.TryAddEntry("header-key", "Header Value");
+  absl::optional<quiche::QuicheHeaderTableEntry> entry =
+      table_.TryAddEntry("header-key", "Header Value");
+  ASSERT_TRUE(entry.has_value());
   EXPECT_EQ("header-key", entry->name());
   EXPECT_EQ("Header Value", entry->value());
 
@@ -246,9 +236,12 @@ TEST_F(HpackHeaderTableTest, EntryIndexing) {
 
 TEST_F(HpackHeaderTableTest, SetSizes) {
   std::string key = "key", value = "value";
-  const HpackEntry* entry1 = table_.TryAddEntry(key, value);
-  const HpackEntry* entry2 = table_.TryAddEntry(key, value);
-  const HpackEntry* entry3 = table_.TryAddEntry(key, value);
+  absl::optional<quiche::QuicheHeaderTableEntry> entry1 =
+      table_.TryAddEntry(key, value);
+  absl::optional<quiche::QuicheHeaderTableEntry> entry2 =
+      table_.TryAddEntry(key, value);
+  absl::optional<quiche::QuicheHeaderTableEntry> entry3 =
+      table_.TryAddEntry(key, value);
 
   // Set exactly large enough. No Evictions.
   size_t max_size = entry1->Size() + entry2->Size() + entry3->Size();
@@ -278,8 +271,10 @@ TEST_F(HpackHeaderTableTest, SetSizes) {
 
 TEST_F(HpackHeaderTableTest, EvictionCountForEntry) {
   std::string key = "key", value = "value";
-  const HpackEntry* entry1 = table_.TryAddEntry(key, value);
-  const HpackEntry* entry2 = table_.TryAddEntry(key, value);
+  absl::optional<quiche::QuicheHeaderTableEntry> entry1 =
+      table_.TryAddEntry(key, value);
+  absl::optional<quiche::QuicheHeaderTableEntry> entry2 =
+      table_.TryAddEntry(key, value);
   size_t entry3_size = HpackEntry::Size(key, value);
 
   // Just enough capacity for third entry.
@@ -295,8 +290,10 @@ TEST_F(HpackHeaderTableTest, EvictionCountForEntry) {
 
 TEST_F(HpackHeaderTableTest, EvictionCountToReclaim) {
   std::string key = "key", value = "value";
-  const HpackEntry* entry1 = table_.TryAddEntry(key, value);
-  const HpackEntry* entry2 = table_.TryAddEntry(key, value);
+  absl::optional<quiche::QuicheHeaderTableEntry> entry1 =
+      table_.TryAddEntry(key, value);
+  absl::optional<quiche::QuicheHeaderTableEntry> entry2 =
+      table_.TryAddEntry(key, value);
 
   EXPECT_EQ(1u, peer_.EvictionCountToReclaim(1));
   EXPECT_EQ(1u, peer_.EvictionCountToReclaim(entry1->Size()));
@@ -352,19 +349,20 @@ TEST_F(HpackHeaderTableTest, TryAddEntryEviction) {
   AddEntriesExpectNoEviction(entries);
 
   // The first entry in the dynamic table.
-  const HpackEntry* survivor_entry = peer_.dynamic_entries().front().get();
+  const quiche::QuicheHeaderTableEntry survivor_entry =
+      peer_.dynamic_entries().newest();
 
   HpackEntry long_entry =
-      MakeEntryOfSize(table_.max_size() - survivor_entry->Size());
+      MakeEntryOfSize(table_.max_size() - survivor_entry.Size());
 
   // All dynamic entries but the first are to be evicted.
   EXPECT_EQ(peer_.dynamic_entries().size() - 1,
-            peer_.EvictionSet(long_entry.name(), long_entry.value()).size());
+            peer_.EvictionCountForEntry(long_entry.name(), long_entry.value()));
 
   table_.TryAddEntry(long_entry.name(), long_entry.value());
   EXPECT_EQ(2u, peer_.dynamic_entries().size());
-  EXPECT_EQ(63u, table_.GetByNameAndValue(survivor_entry->name(),
-                                          survivor_entry->value()));
+  EXPECT_EQ(63u, table_.GetByNameAndValue(survivor_entry.name(),
+                                          survivor_entry.value()));
   EXPECT_EQ(62u,
             table_.GetByNameAndValue(long_entry.name(), long_entry.value()));
 }
@@ -379,11 +377,10 @@ TEST_F(HpackHeaderTableTest, TryAddTooLargeEntry) {
 
   // All entries are to be evicted.
   EXPECT_EQ(peer_.dynamic_entries().size(),
-            peer_.EvictionSet(long_entry.name(), long_entry.value()).size());
+            peer_.EvictionCountForEntry(long_entry.name(), long_entry.value()));
 
-  const HpackEntry* new_entry =
-      table_.TryAddEntry(long_entry.name(), long_entry.value());
-  EXPECT_EQ(new_entry, static_cast<HpackEntry*>(nullptr));
+  EXPECT_FALSE(
+      table_.TryAddEntry(long_entry.name(), long_entry.value()).has_value());
   EXPECT_EQ(0u, peer_.dynamic_entries().size());
 }
 